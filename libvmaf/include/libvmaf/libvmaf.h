@@ -44,6 +44,19 @@ enum VmafOutputFormat {
     VMAF_OUTPUT_FORMAT_JSON,
     VMAF_OUTPUT_FORMAT_CSV,
     VMAF_OUTPUT_FORMAT_SUB,
+    VMAF_OUTPUT_FORMAT_BINARY,
+};
+
+enum VmafScratchArenaFlags {
+    VMAF_SCRATCH_ARENA = 1 << 0,
+    VMAF_SCRATCH_ARENA_HUGE_PAGES = 1 << 1,
+    VMAF_SCRATCH_ARENA_PREFAULT = 1 << 2,
+};
+
+enum VmafScaleFilter {
+    VMAF_SCALE_FILTER_BICUBIC = 0,
+    VMAF_SCALE_FILTER_BILINEAR,
+    VMAF_SCALE_FILTER_LANCZOS,
 };
 
 enum VmafPoolingMethod {
@@ -55,6 +68,64 @@ enum VmafPoolingMethod {
     VMAF_POOL_METHOD_NB
 };
 
+typedef struct VmafExecutor VmafExecutor;
+
+/**
+ * @struct VmafExecutorConfiguration
+ * @brief  Configuration needed to create a `VmafExecutor`
+ *
+ * @param n_threads    How many worker threads run jobs. With `submit`, how
+ *                     many jobs the host runs at once, which sizes the
+ *                     per-context state of the contexts sharing it.
+ *
+ * @param cpu_affinity Optional placement of the workers, in the format of
+ *                     `VmafConfiguration.cpu_affinity`. Ignored with
+ *                     `submit`.
+ *
+ * @param submit       Optional, run jobs on the host's own task system
+ *                     instead of worker threads. Called once per job, from
+ *                     any thread, the host must eventually call
+ *                     `run(arg)` once on any thread. Returning non-zero
+ *                     runs the job on the calling thread instead.
+ *
+ * @param user_data    Passed to `submit`.
+ */
+typedef struct VmafExecutorConfiguration {
+    unsigned n_threads;
+    const char *cpu_affinity;
+    int (*submit)(void *user_data, void (*run)(void *arg), void *arg);
+    void *user_data;
+} VmafExecutorConfiguration;
+
+/**
+ * Create an executor which can be shared by many `VmafContext`s through
+ * `VmafConfiguration.executor`, instead of each context starting its own
+ * threads. Every context has its own queue, workers take jobs from the
+ * queues in turn, so a context with a deep backlog does not hold up the
+ * others.
+ *
+ * @param executor The executor to create.
+ *
+ * @param cfg      Configuration parameters.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_executor_create(VmafExecutor **executor,
+                         VmafExecutorConfiguration cfg);
+
+/**
+ * Destroy an executor. With `submit`, waits until the host has run every
+ * job submitted.
+ *
+ * @param executor The executor to destroy.
+ *
+ *
+ * @return 0 on success, -EBUSY while a context still uses it, or < 0
+ *         (a negative errno code) on error.
+ */
+int vmaf_executor_destroy(VmafExecutor *executor);
+
 /**
  * @struct VmafConfiguration
  * @brief  Configuration needed to initialize a `VmafContext`
@@ -79,6 +150,82 @@ enum VmafPoolingMethod {
  * 
  * @param gpumask     Restrict permitted GPU operations.
  *                    if gpumask: disable CUDA
+ *
+ * @param perf_stats  Collect performance statistics, see
+ *                    `vmaf_get_perf_stats()`. These are also written to
+ *                    the XML and JSON output. Has no effect when libvmaf
+ *                    is built without `enable_perf_stats`.
+ *
+ * @param autotune    Time every permitted SIMD variant of each kernel on
+ *                    the actual frame size the first time it is used and
+ *                    keep the fastest, instead of always using the widest
+ *                    instruction set. See `vmaf_get_kernel_selection()`.
+ *                    Only this context tunes, but the selections are
+ *                    shared by the process: a size tuned once is not timed
+ *                    again and its result is used by every context, while
+ *                    a size selected untuned is tuned again by the next
+ *                    context which selects it with autotuning enabled.
+ *
+ * @param autotune_cache Optional file to read autotune results from and
+ *                    append new ones to, so later runs can skip the timing.
+ *
+ * @param feature_cache Optional file caching per-frame feature scores across
+ *                    runs. Scores are keyed by the content of the reference
+ *                    and distorted pictures, the extractor with its
+ *                    options and the cpu flags, so re-scoring the same
+ *                    frames, e.g. with a different model, skips their
+ *                    extraction. Temporal
+ *                    extractors such as motion always run. The file is
+ *                    append-only and may be shared by concurrent processes.
+ *
+ * @param scratch_budget Bytes of per-context scratch buffers the feature
+ *                    extractors may allocate when `n_threads` > 0, 0 for no
+ *                    limit. Each extractor always gets one context, further
+ *                    ones are only created while they fit, otherwise frames
+ *                    wait for a context to be released. Only extractors
+ *                    that declare their scratch size are accounted for.
+ *
+ * @param cpu_affinity Optional placement of the thread pool workers when
+ *                    `n_threads` > 0, either a CPU list such as "0-7,16-23"
+ *                    or "node:N" for the CPUs of NUMA node N. Workers pinned
+ *                    to a node also prefer it for their allocations, so
+ *                    extractor scratch buffers are node-local. Use
+ *                    `vmaf_set_thread_affinity()` on the thread allocating
+ *                    pictures to keep those local as well. On multi-socket
+ *                    hosts, one context per node, each fed a share of the
+ *                    work, avoids cross-node traffic entirely. Linux only.
+ *                    `vmaf_init()` fails with -EINVAL if it is set while
+ *                    `n_threads` is 0 or an `executor` is given.
+ *
+ * @param scratch_arena `VmafScratchArenaFlags`, any of them allocates the
+ *                    feature extractors' scratch buffers from one arena
+ *                    which is released as a whole by `vmaf_close()`.
+ *                    `VMAF_SCRATCH_ARENA_HUGE_PAGES` backs it with 2 MiB
+ *                    pages (reserved huge pages where available, otherwise
+ *                    transparent huge pages), `VMAF_SCRATCH_ARENA_PREFAULT`
+ *                    faults all of it in when reserved instead of on first
+ *                    use. See `vmaf_get_arena_stats()`.
+ *
+ * @param subsample_adaptive Adapt the subsampling to the content, treating
+ *                    `n_subsample` as the longest stride, 8 if unset. Static
+ *                    shots are scored every `n_subsample` frames, more
+ *                    often as motion increases, up to every frame, as are
+ *                    the frames after a scene cut and frames whose
+ *                    distortion departs from the last scored frame. Pooled
+ *                    scores interpolate the frames in between, see
+ *                    `vmaf_score_pooled_error()` for an estimate of their
+ *                    error.
+ *
+ * @param scale_filter Filter used to scale distorted pictures whose size
+ *                    differs from the reference, to the reference size.
+ *                    Bicubic (B = 0, C = 0.6) by default, as ffmpeg's
+ *                    `scale` filter, or bilinear or lanczos (a = 3).
+ *
+ * @param executor    Optional executor created with `vmaf_executor_create()`
+ *                    to run feature extractors on, shared with other
+ *                    contexts. `n_threads` is then taken from the executor,
+ *                    whose workers are placed by its own `cpu_affinity`.
+ *                    It must outlive the context.
  */
 typedef struct VmafConfiguration {
     enum VmafLogLevel log_level;
@@ -86,6 +233,16 @@ typedef struct VmafConfiguration {
     unsigned n_subsample;
     uint64_t cpumask;
     uint64_t gpumask;
+    unsigned perf_stats;
+    unsigned autotune;
+    const char *autotune_cache;
+    const char *feature_cache;
+    uint64_t scratch_budget;
+    const char *cpu_affinity;
+    unsigned scratch_arena;
+    unsigned subsample_adaptive;
+    enum VmafScaleFilter scale_filter;
+    VmafExecutor *executor;
 } VmafConfiguration;
 
 typedef struct VmafContext VmafContext;
@@ -176,6 +333,82 @@ int vmaf_use_feature(VmafContext *vmaf, const char *feature_name,
 int vmaf_import_feature_score(VmafContext *vmaf, const char *feature_name,
                               double value, unsigned index);
 
+/**
+ * Import a run of externally-computed feature scores in a single call.
+ * Equivalent to calling `vmaf_import_feature_score()` for each score, but
+ * takes the collector lock once and grows its storage once. Fails without
+ * importing anything if a score in the run is already set.
+ *
+ * @param vmaf         The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param feature_name Name of feature.
+ *
+ * @param score        Scores for pictures `index` to `index + cnt - 1`.
+ *
+ * @param index        Picture index of the first score.
+ *
+ * @param cnt          Number of scores.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_import_feature_scores(VmafContext *vmaf, const char *feature_name,
+                               const double *score, unsigned index,
+                               unsigned cnt);
+
+/**
+ * Import all feature scores from an output file previously written by
+ * `vmaf_write_output()` with `VMAF_OUTPUT_FORMAT_BINARY` or
+ * `VMAF_OUTPUT_FORMAT_JSON`. Models can then be scored and pooled over the
+ * imported frames without reading any pictures. JSON scores are limited to
+ * the precision they were written with, binary scores are exact. Aggregate
+ * metrics are not imported.
+ *
+ * @param vmaf         The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param path         Path of the output file.
+ *
+ * @param exclude      Optional NULL terminated list of names to skip, e.g.
+ *                     the names of models about to be rescored. A feature is
+ *                     skipped if its name matches an entry, or starts with an
+ *                     entry followed by '_'.
+ *
+ * @param frame_cnt    Optional, set to one past the highest imported
+ *                     picture index.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_import_feature_scores_from_path(VmafContext *vmaf, const char *path,
+                                         const char *const *exclude,
+                                         unsigned *frame_cnt);
+
+/**
+ * Like `vmaf_import_feature_scores_from_path()`, for a segment of a clip
+ * scored with `vmaf_set_read_range()`. The bounds of the segment are those
+ * of the pictures it read, even where subsampling left the first or last of
+ * them without scores, so that segments can be checked for gaps and
+ * overlaps before they are merged. Outputs which do not record their bounds
+ * span the pictures they have scores for.
+ *
+ * @param vmaf         The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param path         Path of the output file.
+ *
+ * @param exclude      Optional NULL terminated list of names to skip, as for
+ *                     `vmaf_import_feature_scores_from_path()`.
+ *
+ * @param index_low    Set to the first picture index of the segment.
+ *
+ * @param index_high   Set to the last picture index of the segment.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_import_segment_from_path(VmafContext *vmaf, const char *path,
+                                  const char *const *exclude,
+                                  unsigned *index_low, unsigned *index_high);
+
 /**
  * Read a pair of pictures and queue them for eventual feature extraction.
  * This should be called after feature extractors are registered via
@@ -183,6 +416,10 @@ int vmaf_import_feature_score(VmafContext *vmaf, const char *feature_name,
  * `VmafContext` will take ownership of both `VmafPicture`s (`ref` and `dist`)
  * and `vmaf_picture_unref()`.
  *
+ * `dist` may be of another size than `ref`, in the same pixel format and
+ * bitdepth. It is then scaled to the size of `ref` with the configured
+ * `scale_filter` before feature extraction.
+ *
  * When you're done reading pictures call this function again with both `ref`
  * and `dist` set to NULL to flush all feature extractors.
  *
@@ -298,6 +535,186 @@ typedef struct VmafMetadataConfiguration {
 
 int vmaf_register_metadata_handler(VmafContext *vmaf, VmafMetadataConfiguration cfg);
 
+/**
+ * Final scores of a single frame, passed to a frame callback.
+ *
+ * @param index          Picture index.
+ *
+ * @param cnt            Number of scores.
+ *
+ * @param feature_name   Feature names, including those of the models
+ *                       used via `vmaf_use_features_from_model()`.
+ *
+ * @param score          Scores, in the same order as `feature_name`.
+ *
+ * @note Only valid for the duration of the callback.
+ */
+typedef struct VmafFrameScores {
+    unsigned index;
+    unsigned cnt;
+    const char *const *feature_name;
+    const double *score;
+} VmafFrameScores;
+
+enum VmafFrameCallbackFlags {
+    VMAF_FRAME_CALLBACK_IN_ORDER = 1 << 0,
+};
+
+/**
+ * Frame callback configuration.
+ *
+ * @param callback     Called once per picture index when all of its scores
+ *                     are final. Calls are never concurrent, but may come
+ *                     from a thread pool worker. The callback must not call
+ *                     `vmaf_read_pictures()` or `vmaf_read_pictures_async()`.
+ *
+ * @param data         User data to pass to the callback.
+ *
+ * @param flags        `VmafFrameCallbackFlags`. With
+ *                     `VMAF_FRAME_CALLBACK_IN_ORDER`, frames are passed in
+ *                     the order they were read, otherwise as they finish.
+ *
+ * @param max_pending  How many frames may be read but not yet passed to
+ *                     the callback, at least 2. 0 for twice `n_threads`.
+ */
+typedef struct VmafFrameCallbackConfiguration {
+    void (*callback)(void *data, const VmafFrameScores *frame);
+    void *data;
+    unsigned flags;
+    unsigned max_pending;
+} VmafFrameCallbackConfiguration;
+
+/**
+ * Register a callback to receive the scores of every frame read after it,
+ * as soon as they are final. Register it before reading pictures. Model
+ * scores are included for the models registered via
+ * `vmaf_use_features_from_model()`.
+ *
+ * Scores of frames depending on temporal features, such as motion, are
+ * only final once the next frame has been extracted, the last such frame
+ * is passed to the callback when flushing.
+ *
+ * A frame whose scores could not be collected is not passed to the
+ * callback. Its error is returned by every later `vmaf_read_pictures()` or
+ * `vmaf_read_pictures_async()` call, including the flush.
+ *
+ * @param vmaf The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param cfg  Frame callback configuration.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_register_frame_callback(VmafContext *vmaf,
+                                 VmafFrameCallbackConfiguration cfg);
+
+/**
+ * Like `vmaf_read_pictures()`, but never waits for the thread pool.
+ * Extraction is queued behind frames still using the feature extractors
+ * and the call returns right away. Requires a callback registered with
+ * `vmaf_register_frame_callback()`, which receives the scores.
+ *
+ * When `max_pending` frames are waiting for their callback, -EAGAIN is
+ * returned and `ref` and `dist` remain owned by the caller, to be read
+ * again once the callback has been called. Flush with
+ * `vmaf_read_pictures()`, which does block until every frame is passed to
+ * the callback.
+ *
+ * Without `n_threads`, pictures are extracted before returning.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param ref   Reference picture.
+ *
+ * @param dist  Distorted picture.
+ *
+ * @param index Picture index.
+ *
+ *
+ * @return 0 on success, -EAGAIN when too many frames are pending, or
+ *         < 0 (a negative errno code) on error.
+ */
+int vmaf_read_pictures_async(VmafContext *vmaf, VmafPicture *ref,
+                             VmafPicture *dist, unsigned index);
+
+/**
+ * Score only pictures `index_low` through `index_high` of those read from
+ * now on, for reading parts of a video out of order. Temporal feature
+ * extractors, such as motion, also need the picture before `index_low` and
+ * the one after `index_high`: read them too, with their own indices. Any
+ * number of pictures either side may be read this way as warm-up, one is
+ * enough for the built-in extractors. They are extracted by the temporal
+ * extractors only, and none of their scores are kept. Ranges may be read
+ * in any order, and adjacent ones may share these pictures, but their
+ * scored pictures must not overlap. The range ends when flushing.
+ *
+ * Segments of a clip may also be scored by separate contexts this way, each
+ * reading one range and flushing. Their per-picture scores match those of
+ * a context reading the whole clip, written with `VMAF_OUTPUT_FORMAT_BINARY`
+ * they are merged by importing them all into one context with
+ * `vmaf_import_segment_from_path()`.
+ *
+ * Not supported with a frame callback registered, or with features
+ * aggregated over all pictures at flush, such as psnr's `enable_apsnr`,
+ * which can not be merged.
+ *
+ * @param vmaf       The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param index_low  First picture index scored.
+ *
+ * @param index_high Last picture index scored.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_set_read_range(VmafContext *vmaf, unsigned index_low,
+                        unsigned index_high);
+
+/**
+ * Save the scores of the pictures read so far to `path`, from which
+ * `vmaf_read_checkpoint()` resumes reading after an interruption. Pictures
+ * are expected to be read in order. The last picture's temporal scores are
+ * not final until the next one is read, so with temporal extractors it is
+ * left out and read again on resume. The file is written beside `path` and
+ * renamed over it, so an interruption while writing leaves the previous
+ * checkpoint in place.
+ *
+ * Not supported with a frame callback registered, with CUDA, with
+ * `subsample_adaptive` or with features aggregated over all pictures at
+ * flush, such as psnr's `enable_apsnr`: their state is not saved.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param path  Checkpoint file.
+ *
+ * @param index Set to the number of pictures saved, may be NULL.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_write_checkpoint(VmafContext *vmaf, const char *path,
+                          unsigned *index);
+
+/**
+ * Resume from a checkpoint written by `vmaf_write_checkpoint()`, on a newly
+ * initialized context with the same features, models and `n_subsample` as
+ * the one which wrote it. Continue reading at picture `index`, reading the
+ * picture before it first for temporal extractors, as with
+ * `vmaf_set_read_range()`. Scores and output are then those of reading
+ * every picture in one go. Fails, like `vmaf_write_checkpoint()`, with
+ * features aggregated at flush.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param path  Checkpoint file.
+ *
+ * @param index Set to the first picture index not yet scored.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_read_checkpoint(VmafContext *vmaf, const char *path, unsigned *index);
+
 /**
  * Pooled VMAF score for a specific interval.
  *
@@ -320,6 +737,72 @@ int vmaf_score_pooled(VmafContext *vmaf, VmafModel *model,
                       enum VmafPoolingMethod pool_method, double *score,
                       unsigned index_low, unsigned index_high);
 
+/**
+ * Estimated error of `vmaf_score_pooled()` when subsampling, against
+ * scoring every frame of the interval. It is derived from the score
+ * differences across each gap of unscored frames and the variation between
+ * consecutive scored frames, so it is an estimate rather than a guarantee.
+ * 0 without subsampling.
+ *
+ * @param vmaf         The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param model        Opaque model context.
+ *
+ * @param pool_method  Temporal pooling method to use.
+ *
+ * @param error        Estimated absolute error of the pooled score.
+ *
+ * @param index_low    Low picture index of pooling interval.
+ *
+ * @param index_high   High picture index of pooling interval.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_score_pooled_error(VmafContext *vmaf, VmafModel *model,
+                            enum VmafPoolingMethod pool_method, double *error,
+                            unsigned index_low, unsigned index_high);
+
+typedef struct VmafPooledEstimate {
+    double score; ///< pooled over the frames scored so far
+    struct {
+        double lo, hi; ///< infinite until there are two runs of frames
+    } ci; ///< 95% confidence interval of pooling every frame
+    unsigned n_scored; ///< frames scored so far
+} VmafPooledEstimate;
+
+/**
+ * Estimate of `vmaf_score_pooled()` over an interval of which only some
+ * frames are scored yet, e.g. read with `vmaf_set_read_range()`. Frames
+ * which are not scored, or not yet completely extracted, are skipped.
+ * Consecutive scored frames are correlated, so the confidence interval is
+ * bootstrapped over runs of consecutive scored frames, resampled within
+ * pairs of neighbouring runs. It narrows to the score as the interval is
+ * completely scored. Only
+ * `VMAF_POOL_METHOD_MEAN` and `VMAF_POOL_METHOD_HARMONIC_MEAN` are
+ * supported.
+ *
+ * @param vmaf         The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param model        Opaque model context.
+ *
+ * @param pool_method  Temporal pooling method to use.
+ *
+ * @param estimate     Pooled estimate and its confidence interval.
+ *
+ * @param index_low    Low picture index of pooling interval.
+ *
+ * @param index_high   High picture index of pooling interval.
+ *
+ *
+ * @return 0 on success, -EAGAIN while no frame is scored, or < 0 (a
+ *         negative errno code) on error.
+ */
+int vmaf_score_pooled_estimate(VmafContext *vmaf, VmafModel *model,
+                               enum VmafPoolingMethod pool_method,
+                               VmafPooledEstimate *estimate,
+                               unsigned index_low, unsigned index_high);
+
 /**
  * Pooled VMAF score for a specific interval, using a model collection.
  *
@@ -366,6 +849,24 @@ int vmaf_feature_score_pooled(VmafContext *vmaf, const char *feature_name,
                               enum VmafPoolingMethod pool_method, double *score,
                               unsigned index_low, unsigned index_high);
 
+/**
+ * Like `vmaf_score_pooled_error()`, for a feature score.
+ */
+int vmaf_feature_score_pooled_error(VmafContext *vmaf, const char *feature_name,
+                                    enum VmafPoolingMethod pool_method,
+                                    double *error, unsigned index_low,
+                                    unsigned index_high);
+
+/**
+ * Like `vmaf_score_pooled_estimate()`, for a feature score.
+ */
+int vmaf_feature_score_pooled_estimate(VmafContext *vmaf,
+                                       const char *feature_name,
+                                       enum VmafPoolingMethod pool_method,
+                                       VmafPooledEstimate *estimate,
+                                       unsigned index_low,
+                                       unsigned index_high);
+
 /**
  * Close a VMAF instance and free all associated memory.
  *
@@ -376,6 +877,25 @@ int vmaf_feature_score_pooled(VmafContext *vmaf, const char *feature_name,
  */
 int vmaf_close(VmafContext *vmaf);
 
+/**
+ * Extend the pictures pooled by `vmaf_write_output()`, by default those read
+ * or imported, to `index_low` up to `index_high`. When only some of them are
+ * read, e.g. with `vmaf_set_read_range()`, the pictures read are pooled and
+ * the output also has the 95% confidence interval of each metric's mean over
+ * all of them, see `vmaf_score_pooled_estimate()`.
+ *
+ * @param vmaf       The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param index_low  Low picture index of pooling interval.
+ *
+ * @param index_high High picture index of pooling interval.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_set_output_range(VmafContext *vmaf, unsigned index_low,
+                          unsigned index_high);
+
 /**
  * Write VMAF stats to an output file.
  *
@@ -392,6 +912,189 @@ int vmaf_close(VmafContext *vmaf);
 int vmaf_write_output(VmafContext *vmaf, const char *output_path,
                       enum VmafOutputFormat fmt);
 
+#define VMAF_PERF_HISTOGRAM_BINS 24
+
+/**
+ * @struct VmafPerfTiming
+ * @brief  Accumulated timing of one instrumented operation.
+ *
+ * @param count       Number of timed calls.
+ *
+ * @param wall_ns     Total wall-clock time, in nanoseconds.
+ *
+ * @param cpu_ns      Total CPU time of the calling thread, in nanoseconds.
+ *                    Zero for waits, which are not expected to use the CPU.
+ *
+ * @param max_wall_ns Longest single call, in nanoseconds.
+ *
+ * @param histogram   Wall-clock time histogram with log2 microsecond bins.
+ *                    Bin 0 counts calls shorter than 1us, bin i counts calls
+ *                    in [2^(i-1), 2^i)us and the last bin everything longer.
+ */
+typedef struct VmafPerfTiming {
+    uint64_t count;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    uint64_t max_wall_ns;
+    uint64_t histogram[VMAF_PERF_HISTOGRAM_BINS];
+} VmafPerfTiming;
+
+/**
+ * @struct VmafPerfExtractorStats
+ * @brief  Performance statistics of one feature extractor.
+ *
+ * @param name      Feature extractor name.
+ *
+ * @param init      Time spent in the extractor's init callback.
+ *
+ * @param extract   Time spent in the extractor's extract callback.
+ *
+ * @param flush     Time spent in the extractor's flush callback.
+ *
+ * @param pool_wait Time blocked waiting for a free extractor context.
+ *                  Only recorded when `n_threads` > 0.
+ */
+typedef struct VmafPerfExtractorStats {
+    const char *name;
+    VmafPerfTiming init, extract, flush;
+    VmafPerfTiming pool_wait;
+} VmafPerfExtractorStats;
+
+/**
+ * @struct VmafPerfStats
+ * @brief  Performance statistics of a `VmafContext`.
+ *
+ * @param extractor       Per feature extractor statistics.
+ *
+ * @param n_extractors    Number of entries in `extractor`.
+ *
+ * @param queue_wait      Time jobs spent queued before a thread pool worker
+ *                        picked them up. Only recorded when `n_threads` > 0.
+ *
+ * @param collector_lock  Acquisitions of the feature collector lock, how many
+ *                        of them had to wait for another thread and for how
+ *                        long in total.
+ *
+ * @param bytes_allocated Bytes requested from the library's aligned allocator
+ *                        since `vmaf_init()`. This counter is process-wide,
+ *                        concurrently running contexts are all included.
+ *
+ * @param scratch_peak    Highest scratch declared by the feature extractor
+ *                        contexts of the thread pool at any one time, see
+ *                        `VmafConfiguration.scratch_budget`.
+ */
+typedef struct VmafPerfStats {
+    VmafPerfExtractorStats *extractor;
+    unsigned n_extractors;
+    VmafPerfTiming queue_wait;
+    struct {
+        uint64_t acquired;
+        uint64_t contended;
+        uint64_t wait_ns;
+    } collector_lock;
+    uint64_t bytes_allocated;
+    uint64_t scratch_peak;
+} VmafPerfStats;
+
+/**
+ * Get a snapshot of the performance statistics collected so far.
+ * Requires `VmafConfiguration.perf_stats`.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param stats Filled with the statistics. The `extractor` array is owned by
+ *              `vmaf` and valid until the next call or `vmaf_close()`.
+ *
+ *
+ * @return 0 on success, -ENOSYS if libvmaf was built without
+ *         `enable_perf_stats`, or another < 0 (a negative errno code) on
+ *         error.
+ */
+int vmaf_get_perf_stats(VmafContext *vmaf, VmafPerfStats *stats);
+
+/**
+ * @struct VmafKernelSelection
+ * @brief  SIMD variant chosen for one kernel and frame format.
+ *
+ * @param kernel    Kernel name, e.g. "integer_vif".
+ *
+ * @param variant   Variant name, e.g. "c", "avx2", "avx512" or "neon".
+ *
+ * @param bpc       Bitdepth the selection was made for.
+ *
+ * @param w         Width the selection was made for.
+ *
+ * @param h         Height the selection was made for.
+ *
+ * @param autotuned 1 if the variant was chosen by timing, either now or in a
+ *                  run recorded in `autotune_cache`, 0 if it is the default.
+ */
+typedef struct VmafKernelSelection {
+    const char *kernel;
+    const char *variant;
+    unsigned bpc, w, h;
+    unsigned autotuned;
+} VmafKernelSelection;
+
+/**
+ * Get the kernel variants selected so far. Selections are made when feature
+ * extractors are initialized on the first frame and are shared by all
+ * contexts in the process.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param index Selection index, starting at 0.
+ *
+ * @param sel   Filled with the selection. Strings are static.
+ *
+ *
+ * @return 0 on success, -EINVAL if `index` is past the last selection.
+ */
+int vmaf_get_kernel_selection(VmafContext *vmaf, unsigned index,
+                              VmafKernelSelection *sel);
+
+/**
+ * @struct VmafArenaStats
+ *
+ * @param peak       Bytes of scratch handed out by the arena. Nothing is
+ *                   returned before `vmaf_close()`, so this is also the peak.
+ *
+ * @param reserved   Bytes mapped for the arena, `peak` plus chunk slack.
+ *
+ * @param huge_pages Bytes of `reserved` backed by reserved huge pages.
+ */
+typedef struct VmafArenaStats {
+    uint64_t peak;
+    uint64_t reserved;
+    uint64_t huge_pages;
+} VmafArenaStats;
+
+/**
+ * Get the scratch arena usage, all zero without
+ * `VmafConfiguration.scratch_arena`.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param stats Filled with the arena usage.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_get_arena_stats(VmafContext *vmaf, VmafArenaStats *stats);
+
+/**
+ * Pin the calling thread, and prefer its NUMA node for allocations, see
+ * `VmafConfiguration.cpu_affinity` for the format. Pictures allocated with
+ * `vmaf_picture_alloc()` are placed by the thread which allocates them.
+ *
+ * @param affinity CPU list or "node:N".
+ *
+ *
+ * @return 0 on success, -EINVAL on malformed input, -ENOENT for an unknown
+ *         node, -ENOSYS where thread affinity is not supported.
+ */
+int vmaf_set_thread_affinity(const char *affinity);
+
 /**
  * Get libvmaf version.
  */
@@ -0,0 +1,171 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "affinity.h"
+
+#define NODE_PATH "/sys/devices/system/node"
+
+// value of the kernel's set_mempolicy() mode, see <linux/mempolicy.h>
+#define MPOL_PREFERRED 1
+
+static int parse_cpulist(VmafAffinity *aff, const char *str)
+{
+    unsigned cnt = 0;
+    const char *p = str;
+
+    while (*p && *p != '\n') {
+        char *end;
+        const unsigned long first = strtoul(p, &end, 10);
+        if (end == p) return -EINVAL;
+        unsigned long last = first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            last = strtoul(p, &end, 10);
+            if (end == p) return -EINVAL;
+            p = end;
+        }
+        if (last < first || last >= VMAF_AFFINITY_MAX_CPUS) return -EINVAL;
+        for (unsigned long i = first; i <= last; i++, cnt++)
+            aff->cpu[i / 64] |= 1ull << (i % 64);
+        if (*p == ',') p++;
+        else if (*p && *p != '\n') return -EINVAL;
+    }
+
+    return cnt ? 0 : -EINVAL;
+}
+
+int vmaf_affinity_parse(VmafAffinity *aff, const char *str)
+{
+    if (!aff) return -EINVAL;
+    if (!str) return -EINVAL;
+
+    memset(aff, 0, sizeof(*aff));
+    aff->node = -1;
+
+    if (strncmp(str, "node:", 5))
+        return parse_cpulist(aff, str);
+
+    char *end;
+    const long node = strtol(str + 5, &end, 10);
+    if (end == str + 5 || *end || node < 0 || node > 1023) return -EINVAL;
+
+    char path[64], cpulist[4096];
+    snprintf(path, sizeof(path), NODE_PATH "/node%ld/cpulist", node);
+    FILE *f = fopen(path, "r");
+    if (!f) return -ENOENT;
+    const char *line = fgets(cpulist, sizeof(cpulist), f);
+    fclose(f);
+    if (!line) return -ENOENT;
+
+    aff->node = node;
+    int err = parse_cpulist(aff, cpulist);
+    // memory-only nodes have an empty cpulist
+    return err ? -ENOENT : 0;
+}
+
+#ifdef __linux__
+
+int vmaf_affinity_apply(const VmafAffinity *aff)
+{
+    if (!aff) return -EINVAL;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned i = 0; i < VMAF_AFFINITY_MAX_CPUS && i < CPU_SETSIZE; i++) {
+        if (aff->cpu[i / 64] & (1ull << (i % 64)))
+            CPU_SET(i, &set);
+    }
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err) return -err;
+
+    // a CPU list leaves the memory policy to the host
+    if (aff->node < 0) return 0;
+
+    unsigned long nodemask[1024 / (8 * sizeof(unsigned long))] = { 0 };
+    const unsigned bits = 8 * sizeof(unsigned long);
+    nodemask[aff->node / bits] = 1ul << (aff->node % bits);
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask, 1024 + 1))
+        return -errno;
+    return 0;
+}
+
+int vmaf_affinity_get(VmafAffinity *aff)
+{
+    if (!aff) return -EINVAL;
+
+    cpu_set_t set;
+    int err = pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err) return -err;
+
+    memset(aff, 0, sizeof(*aff));
+    aff->node = -1;
+    for (unsigned i = 0; i < VMAF_AFFINITY_MAX_CPUS && i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &set))
+            aff->cpu[i / 64] |= 1ull << (i % 64);
+    }
+    return 0;
+}
+
+#else
+
+int vmaf_affinity_apply(const VmafAffinity *aff)
+{
+    (void) aff;
+    return -ENOSYS;
+}
+
+int vmaf_affinity_get(VmafAffinity *aff)
+{
+    (void) aff;
+    return -ENOSYS;
+}
+
+#endif
+
+unsigned vmaf_affinity_node_cnt(void)
+{
+    char online[4096];
+    FILE *f = fopen(NODE_PATH "/online", "r");
+    if (!f) return 1;
+    const char *line = fgets(online, sizeof(online), f);
+    fclose(f);
+
+    VmafAffinity nodes = { .node = -1 };
+    if (!line || parse_cpulist(&nodes, online)) return 1;
+
+    unsigned cnt = 0;
+    for (unsigned i = 0; i < VMAF_AFFINITY_MAX_CPUS; i++)
+        cnt += (nodes.cpu[i / 64] >> (i % 64)) & 1;
+    return cnt;
+}
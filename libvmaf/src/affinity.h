@@ -0,0 +1,62 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_AFFINITY_H__
+#define __VMAF_AFFINITY_H__
+
+#include <stdint.h>
+
+#define VMAF_AFFINITY_MAX_CPUS 1024
+
+/*
+ * A set of CPUs, and optionally the NUMA node they were selected from. Threads
+ * pinned to a node also prefer that node for their memory allocations, so
+ * buffers they first touch are node-local.
+ */
+typedef struct VmafAffinity {
+    uint64_t cpu[VMAF_AFFINITY_MAX_CPUS / 64];
+    int node;
+} VmafAffinity;
+
+/**
+ * Parse either a CPU list such as "0-7,16-23", or "node:N" for all CPUs of
+ * NUMA node N. Returns -EINVAL on malformed input and -ENOENT when the node
+ * does not exist.
+ */
+int vmaf_affinity_parse(VmafAffinity *aff, const char *str);
+
+/**
+ * Pin the calling thread to `aff`, and when `aff->node` >= 0 set its memory
+ * policy to prefer that node. A CPU list leaves the memory policy as it is.
+ * Returns -ENOSYS on platforms without thread affinity, and the negative
+ * errno of set_mempolicy() when the CPUs are pinned but the node could not
+ * be preferred, e.g. when the call is filtered.
+ */
+int vmaf_affinity_apply(const VmafAffinity *aff);
+
+/**
+ * CPUs the calling thread may currently run on, `node` is set to -1.
+ */
+int vmaf_affinity_get(VmafAffinity *aff);
+
+/**
+ * Number of online NUMA nodes, 1 when unknown.
+ */
+unsigned vmaf_affinity_node_cnt(void);
+
+#endif /* __VMAF_AFFINITY_H__ */
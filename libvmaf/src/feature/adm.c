@@ -70,7 +70,8 @@ static char *init_dwt_band_hvd(adm_dwt_band_t *band, char *data_top, size_t buf_
 
 int compute_adm(const float *ref, const float *dis, int w, int h, int ref_stride, int dis_stride, double *score,
                 double *score_num, double *score_den, double *scores, double border_factor, double adm_enhn_gain_limit,
-                double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode)
+                double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode,
+                const AdmFloatKernels *kernels)
 {
 #ifdef ADM_OPT_SINGLE_PRECISION
 	double numden_limit = 1e-2 * (w * h) / (1920.0 * 1080.0);
@@ -173,26 +174,26 @@ int compute_adm(const float *ref, const float *dis, int w, int h, int ref_stride
 		float den_scale = 0.0;
 	
 		dwt2_src_indices_filt(ind_y, ind_x, w, h);
-		adm_dwt2(curr_ref_scale, &ref_dwt2, ind_y, ind_x, w, h, curr_ref_stride, buf_stride);
-		adm_dwt2(curr_dis_scale, &dis_dwt2, ind_y, ind_x, w, h, curr_dis_stride, buf_stride);
+		adm_dwt2(curr_ref_scale, &ref_dwt2, ind_y, ind_x, w, h, curr_ref_stride, buf_stride, kernels);
+		adm_dwt2(curr_dis_scale, &dis_dwt2, ind_y, ind_x, w, h, curr_dis_stride, buf_stride, kernels);
 
 		w = (w + 1) / 2;
 		h = (h + 1) / 2;
 	
 		adm_decouple(&ref_dwt2, &dis_dwt2, &decouple_r, &decouple_a, w, h,
-		        buf_stride, buf_stride, buf_stride, buf_stride, border_factor, adm_enhn_gain_limit);
+		        buf_stride, buf_stride, buf_stride, buf_stride, border_factor, adm_enhn_gain_limit, kernels);
 
 		den_scale = adm_csf_den_scale(&ref_dwt2, orig_h, scale, w, h,
                                 buf_stride, border_factor,
-                                adm_norm_view_dist, adm_ref_display_height, adm_csf_mode);
+                                adm_norm_view_dist, adm_ref_display_height, adm_csf_mode, kernels);
 
 		adm_csf(&decouple_a, &csf_a, &csf_f, orig_h, scale, w, h, buf_stride,
           buf_stride, border_factor,
-          adm_norm_view_dist, adm_ref_display_height, adm_csf_mode);
+          adm_norm_view_dist, adm_ref_display_height, adm_csf_mode, kernels);
 	
 		num_scale = adm_cm(&decouple_r, &csf_f, &csf_a, w, h, buf_stride,
                      buf_stride, buf_stride, border_factor, scale,
-                     adm_norm_view_dist, adm_ref_display_height, adm_csf_mode);
+                     adm_norm_view_dist, adm_ref_display_height, adm_csf_mode, kernels);
 
 #ifdef ADM_OPT_DEBUG_DUMP
 		sprintf(pathbuf, "stage/ref[%d]_a.yuv", scale);
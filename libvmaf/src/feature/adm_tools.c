@@ -58,14 +58,6 @@ static const float dwt2_db2_coeffs_hi_s[4] = { -0.129409522550921, -0.2241438680
 static const double dwt2_db2_coeffs_lo_d[4] = { 0.482962913144690, 0.836516303737469, 0.224143868041857, -0.129409522550921 };
 static const double dwt2_db2_coeffs_hi_d[4] = { -0.129409522550921, -0.224143868041857, 0.836516303737469, -0.482962913144690 };
 
-#ifndef FLOAT_ONE_BY_30
-#define FLOAT_ONE_BY_30	0.0333333351
-#endif
-
-#ifndef FLOAT_ONE_BY_15
-#define FLOAT_ONE_BY_15 0.0666666701
-#endif
-
 float adm_sum_cube_s(const float *x, int w, int h, int stride, double border_factor)
 {
     int px_stride = stride / sizeof(float);
@@ -97,7 +89,8 @@ float adm_sum_cube_s(const float *x, int w, int h, int stride, double border_fac
 void adm_decouple_s(const adm_dwt_band_t_s *ref, const adm_dwt_band_t_s *dis,
         const adm_dwt_band_t_s *r, const adm_dwt_band_t_s *a, int w, int h,
         int ref_stride, int dis_stride, int r_stride, int a_stride,
-        double border_factor, double adm_enhn_gain_limit)
+        double border_factor, double adm_enhn_gain_limit,
+        const AdmFloatKernels *k)
 {
 #ifdef ADM_OPT_AVOID_ATAN
 	const float cos_1deg_sq = cos(1.0 * M_PI / 180.0) * cos(1.0 * M_PI / 180.0);
@@ -138,8 +131,34 @@ void adm_decouple_s(const adm_dwt_band_t_s *ref, const adm_dwt_band_t_s *dis,
 	int angle_flag;
 	int i, j;
 
+	/* the kernels multiply in float, which matches the double multiply of
+	 * the scalar code only for a gain limit representable as a float */
+	if (k && (double)(float)adm_enhn_gain_limit != adm_enhn_gain_limit)
+		k = NULL;
+
 	for (i = top; i < bottom; ++i) {
-		for (j = left; j < right; ++j) {
+		j = left;
+		if (k && k->decouple) {
+			const float *ref_row[3] = {
+				ref->band_h + i * ref_px_stride, ref->band_v + i * ref_px_stride,
+				ref->band_d + i * ref_px_stride,
+			};
+			const float *dis_row[3] = {
+				dis->band_h + i * dis_px_stride, dis->band_v + i * dis_px_stride,
+				dis->band_d + i * dis_px_stride,
+			};
+			float *r_row[3] = {
+				r->band_h + i * r_px_stride, r->band_v + i * r_px_stride,
+				r->band_d + i * r_px_stride,
+			};
+			float *a_row[3] = {
+				a->band_h + i * a_px_stride, a->band_v + i * a_px_stride,
+				a->band_d + i * a_px_stride,
+			};
+			j = k->decouple(ref_row, dis_row, r_row, a_row, left, right,
+			                adm_enhn_gain_limit);
+		}
+		for (; j < right; ++j) {
 			oh = ref->band_h[i * ref_px_stride + j];
 			ov = ref->band_v[i * ref_px_stride + j];
 			od = ref->band_d[i * ref_px_stride + j];
@@ -230,7 +249,8 @@ void adm_decouple_s(const adm_dwt_band_t_s *ref, const adm_dwt_band_t_s *dis,
 
 void adm_csf_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *dst, const adm_dwt_band_t_s *flt,
                int orig_h, int scale, int w, int h, int src_stride, int dst_stride, double border_factor,
-               double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode)
+               double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode,
+               const AdmFloatKernels *k)
 {
 	(void)orig_h;
 	(void)adm_csf_mode;
@@ -285,7 +305,12 @@ void adm_csf_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *dst, const a
 			src_offset = i * src_px_stride;
 			dst_offset = i * dst_px_stride;
 
-			for (j = left; j < right; ++j) {
+			j = left;
+			if (k && k->csf) {
+				j = k->csf(src_ptr + src_offset, dst_ptr + dst_offset,
+				           flt_ptr + dst_offset, rfactor[theta], left, right);
+			}
+			for (; j < right; ++j) {
 				dst_val = rfactor[theta] * src_ptr[src_offset + j];
 				dst_ptr[dst_offset + j] = dst_val;
 				flt_ptr[dst_offset + j] = FLOAT_ONE_BY_30 * fabsf(dst_val);
@@ -297,7 +322,8 @@ void adm_csf_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *dst, const a
 /* Combination of adm_csf_s and adm_sum_cube_s for csf_o based den_scale */
 float adm_csf_den_scale_s(const adm_dwt_band_t_s *src, int orig_h, int scale,
                           int w, int h, int src_stride, double border_factor,
-                          double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode)
+                          double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode,
+                          const AdmFloatKernels *k)
 {
 	(void)adm_csf_mode;
 	(void)orig_h;
@@ -315,7 +341,7 @@ float adm_csf_den_scale_s(const adm_dwt_band_t_s *src, int orig_h, int scale,
 	float rfactor[3] = { factor1, factor1, factor2 };
 
 	float accum_h = 0, accum_v = 0, accum_d = 0;
-	float accum_inner_h, accum_inner_v, accum_inner_d;
+	float accum_inner[ADM_KERNEL_MAX_ROWS][3];
 	float den_scale_h, den_scale_v, den_scale_d;
 
 	float val;
@@ -326,32 +352,41 @@ float adm_csf_den_scale_s(const adm_dwt_band_t_s *src, int orig_h, int scale,
 	int right = w - left;
 	int bottom = h - top;
 
-	int i, j;
-
-	for (i = top; i < bottom; ++i) {
-		accum_inner_h = 0;
-		accum_inner_v = 0;
-		accum_inner_d = 0;
-		src_h = src->band_h + i * src_px_stride;
-		src_v = src->band_v + i * src_px_stride;
-		src_d = src->band_d + i * src_px_stride;
-		for (j = left; j < right; ++j) {
-			float abs_csf_o_val_h = fabsf(rfactor[0] * src_h[j]);
-			float abs_csf_o_val_v = fabsf(rfactor[1] * src_v[j]);
-			float abs_csf_o_val_d = fabsf(rfactor[2] * src_d[j]);
-
-			val = abs_csf_o_val_h * abs_csf_o_val_h * abs_csf_o_val_h;
-			accum_inner_h += val;
-			val = abs_csf_o_val_v * abs_csf_o_val_v * abs_csf_o_val_v;
-			accum_inner_v += val;
-			val = abs_csf_o_val_d * abs_csf_o_val_d * abs_csf_o_val_d;
-			accum_inner_d += val;
+	int i, j, j_vec, r, n;
+
+	for (i = top; i < bottom; i += n) {
+		n = (k && k->csf_den_rows && bottom - i >= k->rows) ? k->rows : 1;
+		memset(accum_inner, 0, sizeof(accum_inner));
+		j_vec = left;
+		if (n > 1) {
+			const float *src_rows[3] = {
+				src->band_h + i * src_px_stride, src->band_v + i * src_px_stride,
+				src->band_d + i * src_px_stride,
+			};
+			j_vec = k->csf_den_rows(src_rows, src_px_stride, rfactor, left,
+			                        right, accum_inner);
 		}
+		for (r = 0; r < n; ++r) {
+			src_h = src->band_h + (i + r) * src_px_stride;
+			src_v = src->band_v + (i + r) * src_px_stride;
+			src_d = src->band_d + (i + r) * src_px_stride;
+			for (j = j_vec; j < right; ++j) {
+				float abs_csf_o_val_h = fabsf(rfactor[0] * src_h[j]);
+				float abs_csf_o_val_v = fabsf(rfactor[1] * src_v[j]);
+				float abs_csf_o_val_d = fabsf(rfactor[2] * src_d[j]);
+
+				val = abs_csf_o_val_h * abs_csf_o_val_h * abs_csf_o_val_h;
+				accum_inner[r][0] += val;
+				val = abs_csf_o_val_v * abs_csf_o_val_v * abs_csf_o_val_v;
+				accum_inner[r][1] += val;
+				val = abs_csf_o_val_d * abs_csf_o_val_d * abs_csf_o_val_d;
+				accum_inner[r][2] += val;
+			}
 
-		accum_h += accum_inner_h;
-		accum_v += accum_inner_v;
-		accum_d += accum_inner_d;
-
+			accum_h += accum_inner[r][0];
+			accum_v += accum_inner[r][1];
+			accum_d += accum_inner[r][2];
+		}
 	}
 
 	den_scale_h = powf(accum_h, 1.0f / 3.0f) + powf((bottom - top) * (right - left) / 32.0f, 1.0f / 3.0f);
@@ -362,10 +397,20 @@ float adm_csf_den_scale_s(const adm_dwt_band_t_s *src, int orig_h, int scale,
 
 }
 
+static inline void adm_cm_accum_s(float accum[3], const float x[3], float thr)
+{
+	for (int theta = 0; theta < 3; ++theta) {
+		float xt = fabsf(x[theta]) - thr;
+		xt = xt < 0.0f ? 0.0f : xt;
+		accum[theta] += (xt * xt * xt);
+	}
+}
+
 float adm_cm_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *csf_f,
                const adm_dwt_band_t_s *csf_a, int w, int h, int src_stride,
                int flt_stride, int csf_a_stride, double border_factor, int scale,
-               double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode)
+               double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode,
+               const AdmFloatKernels *k)
 {
 	(void)flt_stride;
 	(void)adm_csf_mode;
@@ -487,228 +532,69 @@ float adm_cm_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *csf_f,
 	accum_v += accum_inner_v;
 	accum_d += accum_inner_d;
 
-	if ((left > 0) && (right <= (w - 1))) /* Completely within frame */
-	{
-		for (i = start_row; i < end_row; ++i) {
-			accum_inner_h = 0;
-			accum_inner_v = 0;
-			accum_inner_d = 0;
-		for (j = start_col; j < end_col; ++j) {
-				xh = src->band_h[i * src_px_stride + j] * rfactor[0];
-				xv = src->band_v[i * src_px_stride + j] * rfactor[1];
-				xd = src->band_d[i * src_px_stride + j] * rfactor[2];
-				ADM_CM_THRESH_S_I_J(angles, flt_angles, csf_px_stride, &thr, w, h, i, j);
-
-			xh = fabsf(xh) - thr;
-			xv = fabsf(xv) - thr;
-			xd = fabsf(xd) - thr;
-
-			xh = xh < 0.0f ? 0.0f : xh;
-			xv = xv < 0.0f ? 0.0f : xv;
-			xd = xd < 0.0f ? 0.0f : xd;
-
-			val = (xh * xh * xh);
-			accum_inner_h += val;
-			val = (xv * xv * xv);
-			accum_inner_v += val;
-			val = (xd * xd * xd);
-			accum_inner_d += val;
-
+	/* i = 1,..,h-2, rows are handed to the kernel in groups of k->rows */
+	int left_edge = left <= 0;
+	int right_edge = right > (w - 1);
+	float accum_rows[ADM_KERNEL_MAX_ROWS][3];
+	float x[3];
+	int r, n, j_vec;
+
+	for (i = start_row; i < end_row; i += n) {
+		n = (k && k->cm_rows && end_row - i >= k->rows) ? k->rows : 1;
+		memset(accum_rows, 0, sizeof(accum_rows));
+
+		/* j = 0 */
+		for (r = 0; left_edge && r < n; ++r) {
+			x[0] = src->band_h[(i + r) * src_px_stride] * rfactor[0];
+			x[1] = src->band_v[(i + r) * src_px_stride] * rfactor[1];
+			x[2] = src->band_d[(i + r) * src_px_stride] * rfactor[2];
+			ADM_CM_THRESH_S_I_0(angles, flt_angles, csf_px_stride, &thr, w, h, (i + r), 0);
+			adm_cm_accum_s(accum_rows[r], x, thr);
 		}
-			accum_h += accum_inner_h;
-			accum_v += accum_inner_v;
-			accum_d += accum_inner_d;
-	}
-	}
-	else if ((left <= 0) && (right <= (w - 1))) /* Right border within frame, left outside */
-	{
-		for (i = start_row; i < end_row; ++i) {
-			accum_inner_h = 0;
-			accum_inner_v = 0;
-			accum_inner_d = 0;
-
-			/* j = 0 */
-			xh = src->band_h[i * src_px_stride] * rfactor[0];
-			xv = src->band_v[i * src_px_stride] * rfactor[1];
-			xd = src->band_d[i * src_px_stride] * rfactor[2];
-			ADM_CM_THRESH_S_I_0(angles, flt_angles, csf_px_stride, &thr, w, h, i, 0);
-
-
-			xh = fabsf(xh) - thr;
-			xv = fabsf(xv) - thr;
-			xd = fabsf(xd) - thr;
-
-			xh = xh < 0.0f ? 0.0f : xh;
-			xv = xv < 0.0f ? 0.0f : xv;
-			xd = xd < 0.0f ? 0.0f : xd;
 
-			val = (xh * xh * xh);
-			accum_inner_h += val;
-			val = (xv * xv * xv);
-			accum_inner_v += val;
-			val = (xd * xd * xd);
-			accum_inner_d += val;
-
-			/* j within frame */
-			for (j = start_col; j < end_col; ++j) {
-				xh = src->band_h[i * src_px_stride + j] * rfactor[0];
-				xv = src->band_v[i * src_px_stride + j] * rfactor[1];
-				xd = src->band_d[i * src_px_stride + j] * rfactor[2];
-				ADM_CM_THRESH_S_I_J(angles, flt_angles, csf_px_stride, &thr, w, h, i, j);
-
-				xh = fabsf(xh) - thr;
-				xv = fabsf(xv) - thr;
-				xd = fabsf(xd) - thr;
-
-				xh = xh < 0.0f ? 0.0f : xh;
-				xv = xv < 0.0f ? 0.0f : xv;
-				xd = xd < 0.0f ? 0.0f : xd;
-
-				val = (xh * xh * xh);
-				accum_inner_h += val;
-				val = (xv * xv * xv);
-				accum_inner_v += val;
-				val = (xd * xd * xd);
-				accum_inner_d += val;
-
-			}
-	accum_h += accum_inner_h;
-	accum_v += accum_inner_v;
-	accum_d += accum_inner_d;
+		/* j within frame */
+		j_vec = start_col;
+		if (n > 1) {
+			const float *src_rows[3] = {
+				src->band_h + i * src_px_stride, src->band_v + i * src_px_stride,
+				src->band_d + i * src_px_stride,
+			};
+			const float *a_rows[3] = {
+				angles[0] + i * csf_px_stride, angles[1] + i * csf_px_stride,
+				angles[2] + i * csf_px_stride,
+			};
+			const float *f_rows[3] = {
+				flt_angles[0] + i * csf_px_stride, flt_angles[1] + i * csf_px_stride,
+				flt_angles[2] + i * csf_px_stride,
+			};
+			j_vec = k->cm_rows(src_rows, src_px_stride, a_rows, f_rows,
+			                   csf_px_stride, rfactor, start_col, end_col,
+			                   accum_rows);
 		}
-	}
-	else if ((left > 0) && (right > (w - 1))) /* Left border within frame, right outside */
-	{
-		for (i = start_row; i < end_row; ++i) {
-			accum_inner_h = 0;
-			accum_inner_v = 0;
-			accum_inner_d = 0;
-			/* j within frame */
-			for (j = start_col; j < end_col; ++j) {
-				xh = src->band_h[i * src_px_stride + j] * rfactor[0];
-				xv = src->band_v[i * src_px_stride + j] * rfactor[1];
-				xd = src->band_d[i * src_px_stride + j] * rfactor[2];
-				ADM_CM_THRESH_S_I_J(angles, flt_angles, csf_px_stride, &thr, w, h, i, j);
-
-				xh = fabsf(xh) - thr;
-				xv = fabsf(xv) - thr;
-				xd = fabsf(xd) - thr;
-
-				xh = xh < 0.0f ? 0.0f : xh;
-				xv = xv < 0.0f ? 0.0f : xv;
-				xd = xd < 0.0f ? 0.0f : xd;
-
-				val = (xh * xh * xh);
-				accum_inner_h += val;
-				val = (xv * xv * xv);
-				accum_inner_v += val;
-				val = (xd * xd * xd);
-				accum_inner_d += val;
-
+		for (r = 0; r < n; ++r) {
+			for (j = j_vec; j < end_col; ++j) {
+				x[0] = src->band_h[(i + r) * src_px_stride + j] * rfactor[0];
+				x[1] = src->band_v[(i + r) * src_px_stride + j] * rfactor[1];
+				x[2] = src->band_d[(i + r) * src_px_stride + j] * rfactor[2];
+				ADM_CM_THRESH_S_I_J(angles, flt_angles, csf_px_stride, &thr, w, h, (i + r), j);
+				adm_cm_accum_s(accum_rows[r], x, thr);
 			}
-			/* j = w-1 */
-			xh = src->band_h[i * src_px_stride + w - 1] * rfactor[0];
-			xv = src->band_v[i * src_px_stride + w - 1] * rfactor[1];
-			xd = src->band_d[i * src_px_stride + w - 1] * rfactor[2];
-			ADM_CM_THRESH_S_I_W_M_1(angles, flt_angles, csf_px_stride, &thr, w, h, i, (w - 1));
-
-			xh = fabsf(xh) - thr;
-			xv = fabsf(xv) - thr;
-			xd = fabsf(xd) - thr;
 
-			xh = xh < 0.0f ? 0.0f : xh;
-			xv = xv < 0.0f ? 0.0f : xv;
-			xd = xd < 0.0f ? 0.0f : xd;
-
-			val = (xh * xh * xh);
-			accum_inner_h += val;
-			val = (xv * xv * xv);
-			accum_inner_v += val;
-			val = (xd * xd * xd);
-			accum_inner_d += val;
+			/* j = w-1 */
+			if (right_edge) {
+				x[0] = src->band_h[(i + r) * src_px_stride + w - 1] * rfactor[0];
+				x[1] = src->band_v[(i + r) * src_px_stride + w - 1] * rfactor[1];
+				x[2] = src->band_d[(i + r) * src_px_stride + w - 1] * rfactor[2];
+				ADM_CM_THRESH_S_I_W_M_1(angles, flt_angles, csf_px_stride, &thr, w, h, (i + r), (w - 1));
+				adm_cm_accum_s(accum_rows[r], x, thr);
+			}
 
-			accum_h += accum_inner_h;
-			accum_v += accum_inner_v;
-			accum_d += accum_inner_d;
+			accum_h += accum_rows[r][0];
+			accum_v += accum_rows[r][1];
+			accum_d += accum_rows[r][2];
 		}
 	}
-	else /* Both borders outside frame */
-	{
-		for (i = start_row; i < end_row; ++i) {
-			accum_inner_h = 0;
-			accum_inner_v = 0;
-			accum_inner_d = 0;
-
-			/* j = 0 */
-			xh = src->band_h[i * src_px_stride] * rfactor[0];
-			xv = src->band_v[i * src_px_stride] * rfactor[1];
-			xd = src->band_d[i * src_px_stride] * rfactor[2];
-			ADM_CM_THRESH_S_I_0(angles, flt_angles, csf_px_stride, &thr, w, h, i, 0);
-
-			xh = fabsf(xh) - thr;
-			xv = fabsf(xv) - thr;
-			xd = fabsf(xd) - thr;
-
-			xh = xh < 0.0f ? 0.0f : xh;
-			xv = xv < 0.0f ? 0.0f : xv;
-			xd = xd < 0.0f ? 0.0f : xd;
-
-			val = (xh * xh * xh);
-			accum_inner_h += val;
-			val = (xv * xv * xv);
-			accum_inner_v += val;
-			val = (xd * xd * xd);
-			accum_inner_d += val;
-
-			/* j within frame */
-			for (j = start_col; j < end_col; ++j) {
-				xh = src->band_h[i * src_px_stride + j] * rfactor[0];
-				xv = src->band_v[i * src_px_stride + j] * rfactor[1];
-				xd = src->band_d[i * src_px_stride + j] * rfactor[2];
-				ADM_CM_THRESH_S_I_J(angles, flt_angles, csf_px_stride, &thr, w, h, i, j);
-
-				xh = fabsf(xh) - thr;
-				xv = fabsf(xv) - thr;
-				xd = fabsf(xd) - thr;
-
-				xh = xh < 0.0f ? 0.0f : xh;
-				xv = xv < 0.0f ? 0.0f : xv;
-				xd = xd < 0.0f ? 0.0f : xd;
-
-				val = (xh * xh * xh);
-				accum_inner_h += val;
-				val = (xv * xv * xv);
-				accum_inner_v += val;
-				val = (xd * xd * xd);
-				accum_inner_d += val;
-
-			}
-			/* j = w-1 */
-			xh = src->band_h[i * src_px_stride + w - 1] * rfactor[0];
-			xv = src->band_v[i * src_px_stride + w - 1] * rfactor[1];
-			xd = src->band_d[i * src_px_stride + w - 1] * rfactor[2];
-			ADM_CM_THRESH_S_I_W_M_1(angles, flt_angles, csf_px_stride, &thr, w, h, i, (w - 1));
-
-		xh = fabsf(xh) - thr;
-		xv = fabsf(xv) - thr;
-		xd = fabsf(xd) - thr;
-
-		xh = xh < 0.0f ? 0.0f : xh;
-		xv = xv < 0.0f ? 0.0f : xv;
-		xd = xd < 0.0f ? 0.0f : xd;
-
-		val = (xh * xh * xh);
-		accum_inner_h += val;
-		val = (xv * xv * xv);
-		accum_inner_v += val;
-		val = (xd * xd * xd);
-		accum_inner_d += val;
 
-			accum_h += accum_inner_h;
-			accum_v += accum_inner_v;
-			accum_d += accum_inner_d;
-	}
-	}
 	accum_inner_h = 0;
 	accum_inner_v = 0;
 	accum_inner_d = 0;
@@ -850,7 +736,7 @@ void dwt2_src_indices_filt_s(int **src_ind_y, int **src_ind_x, int w, int h)
 	}
 }
 
-void adm_dwt2_s(const float *src, const adm_dwt_band_t_s *dst, int **ind_y, int **ind_x, int w, int h, int src_stride, int dst_stride)
+void adm_dwt2_s(const float *src, const adm_dwt_band_t_s *dst, int **ind_y, int **ind_x, int w, int h, int src_stride, int dst_stride, const AdmFloatKernels *k)
 {
 	const float *filter_lo = dwt2_db2_coeffs_lo_s;
 	const float *filter_hi = dwt2_db2_coeffs_hi_s;
@@ -863,12 +749,20 @@ void adm_dwt2_s(const float *src, const adm_dwt_band_t_s *dst, int **ind_y, int
 	float s0, s1, s2, s3;
 	float accum;
 
-	int i, j;
+	int i, j, j_vec;
 	int j0, j1, j2, j3;
 
 	for (i = 0; i < (h + 1) / 2; ++i) {
 		/* Vertical pass. */
-		for (j = 0; j < w; ++j) {
+		j = 0;
+		if (k && k->dwt2_v) {
+			const float *src_rows[4] = {
+				src + ind_y[0][i] * src_px_stride, src + ind_y[1][i] * src_px_stride,
+				src + ind_y[2][i] * src_px_stride, src + ind_y[3][i] * src_px_stride,
+			};
+			j = k->dwt2_v(src_rows, tmplo, tmphi, 0, w);
+		}
+		for (; j < w; ++j) {
 			s0 = src[ind_y[0][i] * src_px_stride + j];
 			s1 = src[ind_y[1][i] * src_px_stride + j];
 			s2 = src[ind_y[2][i] * src_px_stride + j];
@@ -889,8 +783,18 @@ void adm_dwt2_s(const float *src, const adm_dwt_band_t_s *dst, int **ind_y, int
 			tmphi[j] = accum;
 		}
 
-		/* Horizontal pass (lo and hi). */
-		for (j = 0; j < (w + 1) / 2; ++j) {
+		/* Horizontal pass (lo and hi). The kernel covers the columns whose
+		 * taps 2j-1..2j+2 need no mirroring, j = 0 and the right border are
+		 * done here. */
+		j_vec = 1;
+		if (k && k->dwt2_h) {
+			float *dst_rows[4] = {
+				dst->band_a + i * dst_px_stride, dst->band_v + i * dst_px_stride,
+				dst->band_h + i * dst_px_stride, dst->band_d + i * dst_px_stride,
+			};
+			j_vec = k->dwt2_h(tmplo, tmphi, dst_rows, 1, (w - 1) / 2);
+		}
+		for (j = 0; j < (w + 1) / 2; j = (j == 0) ? j_vec : j + 1) {
 
 			j0 = ind_x[0][j];
 			j1 = ind_x[1][j];
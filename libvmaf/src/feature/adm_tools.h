@@ -261,21 +261,66 @@ typedef struct adm_dwt_band_t_d {
     double *band_d; /* High-pass V + high-pass H. */
 } adm_dwt_band_t_d;
 
+#ifndef FLOAT_ONE_BY_30
+#define FLOAT_ONE_BY_30	0.0333333351
+#endif
+
+#ifndef FLOAT_ONE_BY_15
+#define FLOAT_ONE_BY_15 0.0666666701
+#endif
+
+#define ADM_KERNEL_MAX_ROWS 8
+
+/*
+ * Optional SIMD kernels for the float ADM, selected once per extractor. Each
+ * kernel processes a prefix of the column range [j_start, j_end) and returns
+ * the first column it did not process, the scalar code finishes the row. The
+ * *_rows kernels process `rows` consecutive rows and continue the per-row
+ * accumulators in `accum` in the same order as the scalar loops. Together
+ * with the float/double rounding of the scalar code this keeps the SIMD path
+ * bit-exact with the scalar path. A NULL kernel table, or a NULL entry,
+ * selects the scalar code.
+ */
+typedef struct AdmFloatKernels {
+    /* src: the 4 input rows of the vertical filter */
+    int (*dwt2_v)(const float *const src[4], float *tmplo, float *tmphi,
+                  int j_start, int j_end);
+    /* dst: output rows of band a, v, h and d, reads tmplo/tmphi up to 2*j_end */
+    int (*dwt2_h)(const float *tmplo, const float *tmphi, float *const dst[4],
+                  int j_start, int j_end);
+    /* ref, dis, r, a: rows of band h, v and d */
+    int (*decouple)(const float *const ref[3], const float *const dis[3],
+                    float *const r[3], float *const a[3], int j_start,
+                    int j_end, float adm_enhn_gain_limit);
+    int (*csf)(const float *src, float *dst, float *flt, float rfactor,
+               int j_start, int j_end);
+    int (*csf_den_rows)(const float *const src[3], int src_px_stride,
+                        const float rfactor[3], int j_start, int j_end,
+                        float (*accum)[3]);
+    /* csf_a, csf_f: rows of the csf bands, the kernel reads one row above
+     * and below as well as one column left and right of [j_start, j_end) */
+    int (*cm_rows)(const float *const src[3], int src_px_stride,
+                   const float *const csf_a[3], const float *const csf_f[3],
+                   int csf_px_stride, const float rfactor[3], int j_start,
+                   int j_end, float (*accum)[3]);
+    int rows;
+} AdmFloatKernels;
+
 float adm_sum_cube_s(const float *x, int w, int h, int stride, double border_factor);
 
-void adm_decouple_s(const adm_dwt_band_t_s *ref, const adm_dwt_band_t_s *dis, const adm_dwt_band_t_s *r, const adm_dwt_band_t_s *a, int w, int h, int ref_stride, int dis_stride, int r_stride, int a_stride, double border_factor, double adm_enhn_gain_limit);
+void adm_decouple_s(const adm_dwt_band_t_s *ref, const adm_dwt_band_t_s *dis, const adm_dwt_band_t_s *r, const adm_dwt_band_t_s *a, int w, int h, int ref_stride, int dis_stride, int r_stride, int a_stride, double border_factor, double adm_enhn_gain_limit, const AdmFloatKernels *k);
 
-void adm_csf_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *dst, const adm_dwt_band_t_s *flt, int orig_h, int scale, int w, int h, int src_stride, int dst_stride, double border_factor, double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode);
+void adm_csf_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *dst, const adm_dwt_band_t_s *flt, int orig_h, int scale, int w, int h, int src_stride, int dst_stride, double border_factor, double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode, const AdmFloatKernels *k);
 
 void adm_cm_thresh_s(const adm_dwt_band_t_s *src, float *dst, int w, int h, int src_stride, int dst_stride);
 
-float adm_csf_den_scale_s(const adm_dwt_band_t_s *src, int orig_h, int scale, int w, int h, int src_stride, double border_factor, double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode);
+float adm_csf_den_scale_s(const adm_dwt_band_t_s *src, int orig_h, int scale, int w, int h, int src_stride, double border_factor, double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode, const AdmFloatKernels *k);
 
-float adm_cm_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *dst, const adm_dwt_band_t_s *csf_a, int w, int h, int src_stride, int dst_stride, int csf_a_stride, double border_factor, int scale, double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode);
+float adm_cm_s(const adm_dwt_band_t_s *src, const adm_dwt_band_t_s *dst, const adm_dwt_band_t_s *csf_a, int w, int h, int src_stride, int dst_stride, int csf_a_stride, double border_factor, int scale, double adm_norm_view_dist, int adm_ref_display_height, int adm_csf_mode, const AdmFloatKernels *k);
 
 void dwt2_src_indices_filt_s(int **src_ind_y, int **src_ind_x, int w, int h);
 
-void adm_dwt2_s(const float *src, const adm_dwt_band_t_s *dst, int **ind_y, int **ind_x, int w, int h, int src_stride, int dst_stride);
+void adm_dwt2_s(const float *src, const adm_dwt_band_t_s *dst, int **ind_y, int **ind_x, int w, int h, int src_stride, int dst_stride, const AdmFloatKernels *k);
 
 void adm_dwt2_d(const double *src, const adm_dwt_band_t_d *dst, int **ind_y, int **ind_x, int w, int h, int src_stride, int dst_stride);
 
@@ -109,3 +109,15 @@ const char *vmaf_feature_name_alias(const char *feature_name)
 
     return feature_name;
 }
+
+const char *vmaf_feature_name_from_alias(const char *alias)
+{
+    unsigned alias_cnt = sizeof(alias_map) / sizeof(alias_map[0]);
+
+    for (unsigned i = 0; i < alias_cnt; i++) {
+       if (!strcmp(alias, alias_map[i].alias))
+           return alias_map[i].name;
+    }
+
+    return alias;
+}
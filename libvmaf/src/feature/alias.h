@@ -17,3 +17,5 @@
  */
 
 const char *vmaf_feature_name_alias(const char *feature_name);
+
+const char *vmaf_feature_name_from_alias(const char *alias);
@@ -34,8 +34,8 @@
     }
 
 void adm_dwt2_8_neon(const uint8_t *src, const adm_dwt_band_t *dst,
-                     AdmBuffer *buf, int w, int h, int src_stride,
-                     int dst_stride)
+                     AdmBuffer *buf, int w, int row_start, int row_end,
+                     int src_stride, int dst_stride)
 {
     const int16_t shift_VP = 8;
     const int16_t shift_HP = 16;
@@ -56,7 +56,7 @@ void adm_dwt2_8_neon(const uint8_t *src, const adm_dwt_band_t *dst,
     const int32x4_t add_shift_hp_vec = vdupq_n_s32(add_shift_HP);
     const int32x4_t shift_hp_vec = vdupq_n_s32(-shift_HP);
 
-    for (int i = 0; i < (h + 1) / 2; ++i)
+    for (int i = row_start; i < row_end; ++i)
     {
         /* Vertical pass. */
         const uint8_t *p_src_0 = src + ind_y[0][i] * src_stride;
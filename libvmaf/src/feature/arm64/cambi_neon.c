@@ -0,0 +1,242 @@
+#include "feature/arm64/cambi_neon.h"
+#include "feature/common/macros.h"
+
+#include <arm_neon.h>
+#include <stdbool.h>
+
+void cambi_increment_range_neon(uint16_t *arr, int left, int right) {
+    const uint16x8_t ones = vdupq_n_u16(1);
+    int col = left;
+    for (; col + 7 < right; col += 8) {
+        vst1q_u16(&arr[col], vaddq_u16(vld1q_u16(&arr[col]), ones));
+    }
+    for (; col < right; col++) {
+        arr[col]++;
+    }
+}
+
+void cambi_decrement_range_neon(uint16_t *arr, int left, int right) {
+    const uint16x8_t ones = vdupq_n_u16(1);
+    int col = left;
+    for (; col + 7 < right; col += 8) {
+        vst1q_u16(&arr[col], vsubq_u16(vld1q_u16(&arr[col]), ones));
+    }
+    for (; col < right; col++) {
+        arr[col]--;
+    }
+}
+
+void get_derivative_data_for_row_neon(const uint16_t *image_data, uint16_t *derivative_buffer, int width, int height, int row, int stride) {
+    const bool last_row = row == height - 1;
+    const uint16_t *curr = &image_data[row * stride];
+    // For the last row, we only compute horizontal derivatives
+    const uint16_t *next = last_row ? curr : &image_data[(row + 1) * stride];
+    const uint16x8_t ones = vdupq_n_u16(1);
+    int col = 0;
+    for (; col + 8 < width; col += 8) {
+        uint16x8_t vals = vld1q_u16(&curr[col]);
+        uint16x8_t result = vceqq_u16(vals, vld1q_u16(&curr[col + 1]));
+        result = vandq_u16(result, vceqq_u16(vals, vld1q_u16(&next[col])));
+        vst1q_u16(&derivative_buffer[col], vandq_u16(result, ones));
+    }
+    for (; col < width; col++) {
+        bool horizontal_derivative = (col == width - 1 || curr[col] == curr[col + 1]);
+        bool vertical_derivative = curr[col] == next[col];
+        derivative_buffer[col] = horizontal_derivative && vertical_derivative;
+    }
+}
+
+void get_spatial_mask_row_neon(uint16_t *mask_row, const uint32_t *dp_top, const uint32_t *dp_bottom,
+                               int width, uint16_t pad_size, uint16_t mask_index) {
+    const int right = 2 * pad_size + 1;
+    const int32x4_t threshold = vdupq_n_s32(mask_index);
+    int col = 0;
+    for (; col + 7 < width; col += 8) {
+        int32x4_t sum_lo = vreinterpretq_s32_u32(vsubq_u32(vld1q_u32(&dp_bottom[col + right]), vld1q_u32(&dp_bottom[col])));
+        sum_lo = vsubq_s32(sum_lo, vreinterpretq_s32_u32(vld1q_u32(&dp_top[col + right])));
+        sum_lo = vaddq_s32(sum_lo, vreinterpretq_s32_u32(vld1q_u32(&dp_top[col])));
+        int32x4_t sum_hi = vreinterpretq_s32_u32(vsubq_u32(vld1q_u32(&dp_bottom[col + 4 + right]), vld1q_u32(&dp_bottom[col + 4])));
+        sum_hi = vsubq_s32(sum_hi, vreinterpretq_s32_u32(vld1q_u32(&dp_top[col + 4 + right])));
+        sum_hi = vaddq_s32(sum_hi, vreinterpretq_s32_u32(vld1q_u32(&dp_top[col + 4])));
+        uint32x4_t mask_lo = vshrq_n_u32(vcgtq_s32(sum_lo, threshold), 31);
+        uint32x4_t mask_hi = vshrq_n_u32(vcgtq_s32(sum_hi, threshold), 31);
+        vst1q_u16(&mask_row[col], vcombine_u16(vmovn_u32(mask_lo), vmovn_u32(mask_hi)));
+    }
+    for (; col < width; col++) {
+        int result = dp_bottom[col + right] - dp_bottom[col] - dp_top[col + right] + dp_top[col];
+        mask_row[col] = (result > mask_index);
+    }
+}
+
+static FORCE_INLINE uint16_t mode3(uint16_t a, uint16_t b, uint16_t c) {
+    if (a == b || a == c) return a;
+    if (b == c) return b;
+    if (a <= b && a <= c) return a;
+    if (b <= c) return b;
+    return c;
+}
+
+static FORCE_INLINE uint16x8_t mode3_neon(uint16x8_t a, uint16x8_t b, uint16x8_t c) {
+    uint16x8_t a_repeated = vorrq_u16(vceqq_u16(a, b), vceqq_u16(a, c));
+    uint16x8_t min_abc = vminq_u16(vminq_u16(a, b), c);
+    uint16x8_t result = vbslq_u16(vceqq_u16(b, c), b, min_abc);
+    return vbslq_u16(a_repeated, a, result);
+}
+
+void filter_mode_neon(uint16_t *data, int width, int height, ptrdiff_t stride, uint16_t *buffer) {
+    int curr_line = 0;
+    for (int i = 0; i < height; i++) {
+        const uint16_t *row = &data[i * stride];
+        uint16_t *line = &buffer[curr_line * width];
+        line[0] = row[0];
+        int j = 1;
+        for (; j + 8 < width; j += 8) {
+            uint16x8_t mode = mode3_neon(vld1q_u16(&row[j - 1]), vld1q_u16(&row[j]), vld1q_u16(&row[j + 1]));
+            vst1q_u16(&line[j], mode);
+        }
+        for (; j < width - 1; j++) {
+            line[j] = mode3(row[j - 1], row[j], row[j + 1]);
+        }
+        line[width - 1] = row[width - 1];
+
+        if (i > 1) {
+            uint16_t *out = &data[(i - 1) * stride];
+            int j = 0;
+            for (; j + 7 < width; j += 8) {
+                uint16x8_t mode = mode3_neon(vld1q_u16(&buffer[0 * width + j]),
+                                             vld1q_u16(&buffer[1 * width + j]),
+                                             vld1q_u16(&buffer[2 * width + j]));
+                vst1q_u16(&out[j], mode);
+            }
+            for (; j < width; j++) {
+                out[j] = mode3(buffer[0 * width + j], buffer[1 * width + j], buffer[2 * width + j]);
+            }
+        }
+        curr_line = (curr_line + 1 == 3 ? 0 : curr_line + 1);
+    }
+}
+
+void decimate_neon(uint16_t *data, int width, int height, ptrdiff_t stride) {
+    for (int i = 0; i < height; i++) {
+        uint16_t *out = &data[i * stride];
+        const uint16_t *in = &data[(i << 1) * stride];
+        int j = 0;
+        // Stay one element short of the row end so that the odd lanes never read past the input row
+        for (; j + 8 < width; j += 8) {
+            uint16x8x2_t deinterleaved = vld2q_u16(&in[j << 1]);
+            vst1q_u16(&out[j], deinterleaved.val[0]);
+        }
+        for (; j < width; j++) {
+            out[j] = in[j << 1];
+        }
+    }
+}
+
+void anti_dithering_filter_neon(uint16_t *data, int width, int height, ptrdiff_t stride) {
+    for (int i = 0; i < height - 1; i++) {
+        uint16_t *curr = &data[i * stride];
+        const uint16_t *next = &data[(i + 1) * stride];
+        int j = 0;
+        for (; j + 8 < width; j += 8) {
+            uint16x8_t sum = vaddq_u16(vld1q_u16(&curr[j]), vld1q_u16(&curr[j + 1]));
+            sum = vaddq_u16(sum, vld1q_u16(&next[j]));
+            sum = vaddq_u16(sum, vld1q_u16(&next[j + 1]));
+            vst1q_u16(&curr[j], vshrq_n_u16(sum, 2));
+        }
+        for (; j < width - 1; j++) {
+            curr[j] = (curr[j] + curr[j + 1] + next[j] + next[j + 1]) >> 2;
+        }
+
+        // Last column
+        curr[width - 1] = (curr[width - 1] + next[width - 1]) >> 1;
+    }
+
+    // Last row
+    uint16_t *last = &data[(height - 1) * stride];
+    int j = 0;
+    for (; j + 8 < width; j += 8) {
+        uint16x8_t sum = vaddq_u16(vld1q_u16(&last[j]), vld1q_u16(&last[j + 1]));
+        vst1q_u16(&last[j], vshrq_n_u16(sum, 1));
+    }
+    for (; j < width - 1; j++) {
+        last[j] = (last[j] + last[j + 1]) >> 1;
+    }
+}
+
+static FORCE_INLINE uint32x4_t gather_histogram_neon(const uint16_t *histograms, uint32x4_t index) {
+    uint32_t lanes[4];
+    vst1q_u32(lanes, index);
+    uint32_t values[4] = {
+        histograms[lanes[0]], histograms[lanes[1]], histograms[lanes[2]], histograms[lanes[3]]
+    };
+    return vld1q_u32(values);
+}
+
+static FORCE_INLINE float c_value_pixel(const uint16_t *histograms, uint16_t value, const int *diff_weights,
+                                        const int *diffs, uint16_t num_diffs, const uint16_t *tvi_thresholds,
+                                        int histogram_col, int histogram_width) {
+    uint16_t p_0 = histograms[value * histogram_width + histogram_col];
+    float val, c_value = 0.0;
+    for (uint16_t d = 0; d < num_diffs; d++) {
+        if (value <= tvi_thresholds[d]) {
+            uint16_t p_1 = histograms[(value + diffs[num_diffs + d + 1]) * histogram_width + histogram_col];
+            uint16_t p_2 = histograms[(value + diffs[num_diffs - d - 1]) * histogram_width + histogram_col];
+            uint16_t p_max = p_1 > p_2 ? p_1 : p_2;
+            val = (float)(diff_weights[d] * p_0 * p_max) / (p_max + p_0);
+            if (val > c_value) {
+                c_value = val;
+            }
+        }
+    }
+    return c_value;
+}
+
+/*
+ * NEON has no gather, so the histogram counts are fetched per lane while
+ * the c-value arithmetic (including the float division) runs four columns wide.
+ */
+void calculate_c_values_row_neon(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                 const uint16_t *mask, int row, int col_start, int col_end,
+                                 int width, ptrdiff_t stride,
+                                 const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                 const int *diff_weights, const int *all_diffs) {
+    const uint32_t lane_offsets[4] = { 0, 1, 2, 3 };
+    const uint32x4_t lanes = vld1q_u32(lane_offsets);
+    const uint32x4_t v_width = vdupq_n_u32(width);
+
+    int col = col_start;
+    for (; col + 3 < col_end; col += 4) {
+        uint16x4_t mask_16 = vld1_u16(&mask[row * stride + col]);
+        if (!vmaxv_u16(mask_16)) continue;
+        uint32x4_t mask_32 = vcgtq_u32(vmovl_u16(mask_16), vdupq_n_u32(0));
+
+        uint32x4_t value = vaddq_u32(vmovl_u16(vld1_u16(&image[row * stride + col])), vdupq_n_u32(num_diffs));
+        uint32x4_t index_0 = vmlaq_u32(vaddq_u32(vdupq_n_u32(col), lanes), value, v_width);
+        uint32x4_t p_0 = gather_histogram_neon(histograms, index_0);
+
+        float32x4_t c_value = vdupq_n_f32(0.0f);
+        for (int d = 0; d < num_diffs; d++) {
+            uint32x4_t visible = vandq_u32(vcleq_u32(value, vdupq_n_u32(tvi_for_diff[d])), mask_32);
+            if (!vmaxvq_u32(visible)) continue;
+
+            uint32x4_t index_1 = vaddq_u32(index_0, vdupq_n_u32(all_diffs[num_diffs + d + 1] * width));
+            uint32x4_t index_2 = vaddq_u32(index_0, vdupq_n_u32(all_diffs[num_diffs - d - 1] * width));
+            uint32x4_t p_max = vmaxq_u32(gather_histogram_neon(histograms, index_1),
+                                         gather_histogram_neon(histograms, index_2));
+
+            int32x4_t numerator = vreinterpretq_s32_u32(vmulq_u32(vmulq_n_u32(p_0, diff_weights[d]), p_max));
+            float32x4_t val = vdivq_f32(vcvtq_f32_s32(numerator), vcvtq_f32_u32(vaddq_u32(p_max, p_0)));
+            val = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(val), visible));
+            c_value = vmaxq_f32(c_value, val);
+        }
+        float *out = &c_values[row * width + col];
+        vst1q_f32(out, vbslq_f32(mask_32, c_value, vld1q_f32(out)));
+    }
+    for (; col < col_end; col++) {
+        if (mask[row * stride + col]) {
+            c_values[row * width + col] = c_value_pixel(
+                histograms, image[row * stride + col] + num_diffs, diff_weights, all_diffs, num_diffs, tvi_for_diff, col, width
+            );
+        }
+    }
+}
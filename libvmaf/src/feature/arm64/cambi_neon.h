@@ -0,0 +1,29 @@
+
+#ifndef ARM64_CAMBI_H_
+#define ARM64_CAMBI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+void cambi_increment_range_neon(uint16_t *arr, int left, int right);
+
+void cambi_decrement_range_neon(uint16_t *arr, int left, int right);
+
+void get_derivative_data_for_row_neon(const uint16_t *image_data, uint16_t *derivative_buffer, int width, int height, int row, int stride);
+
+void get_spatial_mask_row_neon(uint16_t *mask_row, const uint32_t *dp_top, const uint32_t *dp_bottom,
+                               int width, uint16_t pad_size, uint16_t mask_index);
+
+void filter_mode_neon(uint16_t *data, int width, int height, ptrdiff_t stride, uint16_t *buffer);
+
+void decimate_neon(uint16_t *data, int width, int height, ptrdiff_t stride);
+
+void anti_dithering_filter_neon(uint16_t *data, int width, int height, ptrdiff_t stride);
+
+void calculate_c_values_row_neon(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                 const uint16_t *mask, int row, int col_start, int col_end,
+                                 int width, ptrdiff_t stride,
+                                 const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                 const int *diff_weights, const int *all_diffs);
+
+#endif /* ARM64_CAMBI_H_ */
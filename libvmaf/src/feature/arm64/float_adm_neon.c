@@ -0,0 +1,285 @@
+#include <arm_neon.h>
+#include <math.h>
+
+#include "feature/adm_tools.h"
+#include "feature/common/macros.h"
+#include "feature/arm64/float_adm_neon.h"
+
+/*
+ * NEON version of the float ADM kernels in x86/float_adm_avx2.c, working on
+ * 4 columns and 4 rows. Like the scalar code on this architecture divisions
+ * are true divisions. The order of operations follows the scalar code and
+ * this file is built with -ffp-contract=off, so results are bit-exact unless
+ * the compiler contracts the scalar code to fused multiply-adds, as clang
+ * does by default.
+ */
+
+static const float dwt2_db2_coeffs_lo_s[4] = { 0.482962913144690, 0.836516303737469, 0.224143868041857, -0.129409522550921 };
+static const float dwt2_db2_coeffs_hi_s[4] = { -0.129409522550921, -0.224143868041857, 0.836516303737469, -0.482962913144690 };
+
+static FORCE_INLINE float32x4_t filter4(const float *f, float32x4_t s0,
+                                        float32x4_t s1, float32x4_t s2,
+                                        float32x4_t s3)
+{
+    float32x4_t accum = vdupq_n_f32(0.0f);
+    accum = vaddq_f32(accum, vmulq_f32(vdupq_n_f32(f[0]), s0));
+    accum = vaddq_f32(accum, vmulq_f32(vdupq_n_f32(f[1]), s1));
+    accum = vaddq_f32(accum, vmulq_f32(vdupq_n_f32(f[2]), s2));
+    accum = vaddq_f32(accum, vmulq_f32(vdupq_n_f32(f[3]), s3));
+    return accum;
+}
+
+/* (float)((double)sum + c * (double)x), as done by `float += double` */
+static FORCE_INLINE float32x4_t add_scaled_f64(float32x4_t sum, float32x4_t x,
+                                               double c)
+{
+    const float64x2_t cd = vdupq_n_f64(c);
+    float64x2_t lo = vaddq_f64(vcvt_f64_f32(vget_low_f32(sum)),
+                               vmulq_f64(cd, vcvt_f64_f32(vget_low_f32(x))));
+    float64x2_t hi = vaddq_f64(vcvt_high_f64_f32(sum),
+                               vmulq_f64(cd, vcvt_high_f64_f32(x)));
+    return vcvt_high_f32_f64(vcvt_f32_f64(lo), hi);
+}
+
+static FORCE_INLINE float32x4_t mul_f64(float32x4_t x, double c)
+{
+    const float64x2_t cd = vdupq_n_f64(c);
+    float64x2_t lo = vmulq_f64(cd, vcvt_f64_f32(vget_low_f32(x)));
+    float64x2_t hi = vmulq_f64(cd, vcvt_high_f64_f32(x));
+    return vcvt_high_f32_f64(vcvt_f32_f64(lo), hi);
+}
+
+/* adds the values of 4 rows (one vector per row) column by column */
+static FORCE_INLINE float32x4_t accum_rows4(float32x4_t accum,
+                                            const float32x4_t v[4])
+{
+    const float32x4x2_t t01 = vtrnq_f32(v[0], v[1]);
+    const float32x4x2_t t23 = vtrnq_f32(v[2], v[3]);
+    accum = vaddq_f32(accum, vcombine_f32(vget_low_f32(t01.val[0]),
+                                          vget_low_f32(t23.val[0])));
+    accum = vaddq_f32(accum, vcombine_f32(vget_low_f32(t01.val[1]),
+                                          vget_low_f32(t23.val[1])));
+    accum = vaddq_f32(accum, vcombine_f32(vget_high_f32(t01.val[0]),
+                                          vget_high_f32(t23.val[0])));
+    accum = vaddq_f32(accum, vcombine_f32(vget_high_f32(t01.val[1]),
+                                          vget_high_f32(t23.val[1])));
+    return accum;
+}
+
+static FORCE_INLINE float32x4_t load_accum(float (*accum)[3], int theta)
+{
+    const float tmp[4] = {
+        accum[0][theta], accum[1][theta], accum[2][theta], accum[3][theta],
+    };
+    return vld1q_f32(tmp);
+}
+
+static FORCE_INLINE void store_accum(float (*accum)[3], int theta,
+                                     float32x4_t v)
+{
+    float tmp[4];
+    vst1q_f32(tmp, v);
+    for (int r = 0; r < 4; r++)
+        accum[r][theta] = tmp[r];
+}
+
+static int adm_dwt2_v_neon(const float *const src[4], float *tmplo,
+                           float *tmphi, int j_start, int j_end)
+{
+    int j;
+    for (j = j_start; j + 4 <= j_end; j += 4) {
+        const float32x4_t s0 = vld1q_f32(src[0] + j);
+        const float32x4_t s1 = vld1q_f32(src[1] + j);
+        const float32x4_t s2 = vld1q_f32(src[2] + j);
+        const float32x4_t s3 = vld1q_f32(src[3] + j);
+        vst1q_f32(tmplo + j, filter4(dwt2_db2_coeffs_lo_s, s0, s1, s2, s3));
+        vst1q_f32(tmphi + j, filter4(dwt2_db2_coeffs_hi_s, s0, s1, s2, s3));
+    }
+    return j;
+}
+
+static int adm_dwt2_h_neon(const float *tmplo, const float *tmphi,
+                           float *const dst[4], int j_start, int j_end)
+{
+    int j;
+    for (j = j_start; j + 4 <= j_end; j += 4) {
+        float32x4x2_t s01 = vld2q_f32(tmplo + 2 * j - 1);
+        float32x4x2_t s23 = vld2q_f32(tmplo + 2 * j + 1);
+        vst1q_f32(dst[0] + j, filter4(dwt2_db2_coeffs_lo_s, s01.val[0],
+                                      s01.val[1], s23.val[0], s23.val[1]));
+        vst1q_f32(dst[1] + j, filter4(dwt2_db2_coeffs_hi_s, s01.val[0],
+                                      s01.val[1], s23.val[0], s23.val[1]));
+        s01 = vld2q_f32(tmphi + 2 * j - 1);
+        s23 = vld2q_f32(tmphi + 2 * j + 1);
+        vst1q_f32(dst[2] + j, filter4(dwt2_db2_coeffs_lo_s, s01.val[0],
+                                      s01.val[1], s23.val[0], s23.val[1]));
+        vst1q_f32(dst[3] + j, filter4(dwt2_db2_coeffs_hi_s, s01.val[0],
+                                      s01.val[1], s23.val[0], s23.val[1]));
+    }
+    return j;
+}
+
+static FORCE_INLINE float32x4_t enhn_gain(float32x4_t rst, float32x4_t t,
+                                          uint32x4_t angle_flag,
+                                          float32x4_t egl)
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32x4_t m = vandq_u32(angle_flag, vcgtq_f32(rst, zero));
+    rst = vbslq_f32(m, vminq_f32(vmulq_f32(rst, egl), t), rst);
+    m = vandq_u32(angle_flag, vcltq_f32(rst, zero));
+    return vbslq_f32(m, vmaxq_f32(vmulq_f32(rst, egl), t), rst);
+}
+
+static int adm_decouple_neon(const float *const ref[3], const float *const dis[3],
+                             float *const r[3], float *const a[3], int j_start,
+                             int j_end, float adm_enhn_gain_limit)
+{
+    const float cos_1deg_sq = cos(1.0 * M_PI / 180.0) * cos(1.0 * M_PI / 180.0);
+    const float32x4_t cos_sq = vdupq_n_f32(cos_1deg_sq);
+    const float32x4_t eps = vdupq_n_f32(1e-30f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t egl = vdupq_n_f32(adm_enhn_gain_limit);
+
+    int j;
+    for (j = j_start; j + 4 <= j_end; j += 4) {
+        float32x4_t o[3], t[3], rst[3];
+        for (int b = 0; b < 3; b++) {
+            o[b] = vld1q_f32(ref[b] + j);
+            t[b] = vld1q_f32(dis[b] + j);
+            float32x4_t k = vdivq_f32(t[b], vaddq_f32(o[b], eps));
+            k = vmaxq_f32(zero, vminq_f32(one, k));
+            rst[b] = vmulq_f32(k, o[b]);
+        }
+
+        const float32x4_t ot_dp = vaddq_f32(vmulq_f32(o[0], t[0]),
+                                            vmulq_f32(o[1], t[1]));
+        const float32x4_t o_mag_sq = vaddq_f32(vmulq_f32(o[0], o[0]),
+                                               vmulq_f32(o[1], o[1]));
+        const float32x4_t t_mag_sq = vaddq_f32(vmulq_f32(t[0], t[0]),
+                                               vmulq_f32(t[1], t[1]));
+        const uint32x4_t angle_flag = vandq_u32(vcgeq_f32(ot_dp, zero),
+                vcgeq_f32(vmulq_f32(ot_dp, ot_dp),
+                          vmulq_f32(vmulq_f32(cos_sq, o_mag_sq), t_mag_sq)));
+
+        for (int b = 0; b < 3; b++) {
+            rst[b] = enhn_gain(rst[b], t[b], angle_flag, egl);
+            vst1q_f32(r[b] + j, rst[b]);
+            vst1q_f32(a[b] + j, vsubq_f32(t[b], rst[b]));
+        }
+    }
+    return j;
+}
+
+static int adm_csf_neon(const float *src, float *dst, float *flt, float rfactor,
+                        int j_start, int j_end)
+{
+    const float32x4_t rf = vdupq_n_f32(rfactor);
+    int j;
+    for (j = j_start; j + 4 <= j_end; j += 4) {
+        const float32x4_t dst_val = vmulq_f32(rf, vld1q_f32(src + j));
+        vst1q_f32(dst + j, dst_val);
+        vst1q_f32(flt + j, mul_f64(vabsq_f32(dst_val), FLOAT_ONE_BY_30));
+    }
+    return j;
+}
+
+static int adm_csf_den_rows_neon(const float *const src[3], int src_px_stride,
+                                 const float rfactor[3], int j_start, int j_end,
+                                 float (*accum)[3])
+{
+    int j = j_start;
+    for (int theta = 0; theta < 3; theta++) {
+        const float32x4_t rf = vdupq_n_f32(rfactor[theta]);
+        float32x4_t acc = load_accum(accum, theta);
+        for (j = j_start; j + 4 <= j_end; j += 4) {
+            float32x4_t v[4];
+            for (int r = 0; r < 4; r++) {
+                const float32x4_t x = vabsq_f32(vmulq_f32(rf,
+                        vld1q_f32(src[theta] + r * src_px_stride + j)));
+                v[r] = vmulq_f32(vmulq_f32(x, x), x);
+            }
+            acc = accum_rows4(acc, v);
+        }
+        store_accum(accum, theta, acc);
+    }
+    return j;
+}
+
+/* threshold of ADM_CM_THRESH_S_I_J for the 4 columns at j of one row */
+static FORCE_INLINE float32x4_t cm_thresh(const float *const csf_a[3],
+                                          const float *const csf_f[3],
+                                          int stride, int j)
+{
+    float32x4_t thr = vdupq_n_f32(0.0f);
+    for (int theta = 0; theta < 3; theta++) {
+        const float *a = csf_a[theta] + j;
+        const float *f = csf_f[theta] + j - stride;
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        sum = vaddq_f32(sum, vld1q_f32(f - 1));
+        sum = vaddq_f32(sum, vld1q_f32(f));
+        sum = vaddq_f32(sum, vld1q_f32(f + 1));
+        f += stride;
+        sum = vaddq_f32(sum, vld1q_f32(f - 1));
+        sum = add_scaled_f64(sum, vabsq_f32(vld1q_f32(a)), FLOAT_ONE_BY_15);
+        sum = vaddq_f32(sum, vld1q_f32(f + 1));
+        f += stride;
+        sum = vaddq_f32(sum, vld1q_f32(f - 1));
+        sum = vaddq_f32(sum, vld1q_f32(f));
+        sum = vaddq_f32(sum, vld1q_f32(f + 1));
+        thr = vaddq_f32(thr, sum);
+    }
+    return thr;
+}
+
+static int adm_cm_rows_neon(const float *const src[3], int src_px_stride,
+                            const float *const csf_a[3],
+                            const float *const csf_f[3], int csf_px_stride,
+                            const float rfactor[3], int j_start, int j_end,
+                            float (*accum)[3])
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t acc[3];
+    for (int theta = 0; theta < 3; theta++)
+        acc[theta] = load_accum(accum, theta);
+
+    int j;
+    for (j = j_start; j + 4 <= j_end; j += 4) {
+        float32x4_t v[3][4];
+        for (int r = 0; r < 4; r++) {
+            const float *a_rows[3] = {
+                csf_a[0] + r * csf_px_stride, csf_a[1] + r * csf_px_stride,
+                csf_a[2] + r * csf_px_stride,
+            };
+            const float *f_rows[3] = {
+                csf_f[0] + r * csf_px_stride, csf_f[1] + r * csf_px_stride,
+                csf_f[2] + r * csf_px_stride,
+            };
+            const float32x4_t thr = cm_thresh(a_rows, f_rows, csf_px_stride, j);
+            for (int theta = 0; theta < 3; theta++) {
+                float32x4_t x = vmulq_f32(
+                        vld1q_f32(src[theta] + r * src_px_stride + j),
+                        vdupq_n_f32(rfactor[theta]));
+                x = vmaxq_f32(zero, vsubq_f32(vabsq_f32(x), thr));
+                v[theta][r] = vmulq_f32(vmulq_f32(x, x), x);
+            }
+        }
+        for (int theta = 0; theta < 3; theta++)
+            acc[theta] = accum_rows4(acc[theta], v[theta]);
+    }
+
+    for (int theta = 0; theta < 3; theta++)
+        store_accum(accum, theta, acc[theta]);
+    return j;
+}
+
+void adm_float_kernels_neon(AdmFloatKernels *k)
+{
+    k->dwt2_v = adm_dwt2_v_neon;
+    k->dwt2_h = adm_dwt2_h_neon;
+    k->decouple = adm_decouple_neon;
+    k->csf = adm_csf_neon;
+    k->csf_den_rows = adm_csf_den_rows_neon;
+    k->cm_rows = adm_cm_rows_neon;
+    k->rows = 4;
+}
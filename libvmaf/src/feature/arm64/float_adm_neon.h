@@ -0,0 +1,8 @@
+#ifndef ARM64_FLOAT_ADM_H_
+#define ARM64_FLOAT_ADM_H_
+
+#include "feature/adm_tools.h"
+
+void adm_float_kernels_neon(AdmFloatKernels *k);
+
+#endif /* ARM64_FLOAT_ADM_H_ */
@@ -0,0 +1,116 @@
+#include <arm_neon.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "feature/common/macros.h"
+#include "feature/integer_motion.h"
+#include "feature/arm64/motion_neon.h"
+
+static FORCE_INLINE uint16x8_t filter5(uint16x8_t s0, uint16x8_t s1,
+                                       uint16x8_t s2, uint16x8_t s3,
+                                       uint16x8_t s4, uint32x4_t round,
+                                       int32x4_t shift)
+{
+    uint32x4_t lo = vmlal_n_u16(round, vget_low_u16(s0), filter[0]);
+    uint32x4_t hi = vmlal_high_n_u16(round, s0, filter[0]);
+    lo = vmlal_n_u16(lo, vget_low_u16(s1), filter[1]);
+    hi = vmlal_high_n_u16(hi, s1, filter[1]);
+    lo = vmlal_n_u16(lo, vget_low_u16(s2), filter[2]);
+    hi = vmlal_high_n_u16(hi, s2, filter[2]);
+    lo = vmlal_n_u16(lo, vget_low_u16(s3), filter[3]);
+    hi = vmlal_high_n_u16(hi, s3, filter[3]);
+    lo = vmlal_n_u16(lo, vget_low_u16(s4), filter[4]);
+    hi = vmlal_high_n_u16(hi, s4, filter[4]);
+    return vcombine_u16(vmovn_u32(vshlq_u32(lo, shift)),
+                        vmovn_u32(vshlq_u32(hi, shift)));
+}
+
+void y_convolution_8_neon(const void *const *src, uint16_t *dst,
+                          unsigned width, unsigned inp_size_bits)
+{
+    (void) inp_size_bits;
+    const uint8_t *const *s = (const uint8_t *const *) src;
+    const unsigned shift_var = 8;
+    const uint32x4_t round = vdupq_n_u32(1u << (shift_var - 1));
+    const int32x4_t shift = vdupq_n_s32(-(int) shift_var);
+
+    unsigned j = 0;
+    for (; j + 8 <= width; j += 8) {
+        uint16x8_t s0 = vmovl_u8(vld1_u8(&s[0][j]));
+        uint16x8_t s1 = vmovl_u8(vld1_u8(&s[1][j]));
+        uint16x8_t s2 = vmovl_u8(vld1_u8(&s[2][j]));
+        uint16x8_t s3 = vmovl_u8(vld1_u8(&s[3][j]));
+        uint16x8_t s4 = vmovl_u8(vld1_u8(&s[4][j]));
+        vst1q_u16(&dst[j], filter5(s0, s1, s2, s3, s4, round, shift));
+    }
+
+    for (; j < width; j++) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * s[k][j];
+        dst[j] = (accum + (1u << (shift_var - 1))) >> shift_var;
+    }
+}
+
+void y_convolution_16_neon(const void *const *src, uint16_t *dst,
+                           unsigned width, unsigned inp_size_bits)
+{
+    const uint16_t *const *s = (const uint16_t *const *) src;
+    const unsigned shift_var = inp_size_bits;
+    const uint32x4_t round = vdupq_n_u32(1u << (shift_var - 1));
+    const int32x4_t shift = vdupq_n_s32(-(int) shift_var);
+
+    unsigned j = 0;
+    for (; j + 8 <= width; j += 8) {
+        uint16x8_t s0 = vld1q_u16(&s[0][j]);
+        uint16x8_t s1 = vld1q_u16(&s[1][j]);
+        uint16x8_t s2 = vld1q_u16(&s[2][j]);
+        uint16x8_t s3 = vld1q_u16(&s[3][j]);
+        uint16x8_t s4 = vld1q_u16(&s[4][j]);
+        vst1q_u16(&dst[j], filter5(s0, s1, s2, s3, s4, round, shift));
+    }
+
+    for (; j < width; j++) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * s[k][j];
+        dst[j] = (accum + (1u << (shift_var - 1))) >> shift_var;
+    }
+}
+
+void x_convolution_16_neon(const uint16_t *src, uint16_t *dst, unsigned width)
+{
+    const int radius = filter_width / 2;
+    const uint32x4_t round = vdupq_n_u32(32768);
+    const int32x4_t shift = vdupq_n_s32(-16);
+
+    unsigned j = 0;
+    for (; j + 8 <= width; j += 8) {
+        const uint16_t *p = src + j - radius;
+        vst1q_u16(&dst[j], filter5(vld1q_u16(p + 0), vld1q_u16(p + 1),
+                                   vld1q_u16(p + 2), vld1q_u16(p + 3),
+                                   vld1q_u16(p + 4), round, shift));
+    }
+
+    for (; j < width; j++) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * src[(int) j - radius + k];
+        dst[j] = (accum + 32768) >> 16;
+    }
+}
+
+uint32_t sad_neon(const uint16_t *a, const uint16_t *b, unsigned width)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+
+    unsigned j = 0;
+    for (; j + 8 <= width; j += 8)
+        acc = vpadalq_u16(acc, vabdq_u16(vld1q_u16(&a[j]), vld1q_u16(&b[j])));
+
+    uint32_t sad = vaddvq_u32(acc);
+    for (; j < width; j++)
+        sad += abs(a[j] - b[j]);
+    return sad;
+}
@@ -0,0 +1,16 @@
+#ifndef ARM64_MOTION_H_
+#define ARM64_MOTION_H_
+
+#include <stdint.h>
+
+void y_convolution_8_neon(const void *const *src, uint16_t *dst,
+                          unsigned width, unsigned inp_size_bits);
+
+void y_convolution_16_neon(const void *const *src, uint16_t *dst,
+                           unsigned width, unsigned inp_size_bits);
+
+void x_convolution_16_neon(const uint16_t *src, uint16_t *dst, unsigned width);
+
+uint32_t sad_neon(const uint16_t *a, const uint16_t *b, unsigned width);
+
+#endif /* ARM64_MOTION_H_ */
@@ -0,0 +1,62 @@
+#include <arm_neon.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "feature/arm64/picture_copy_neon.h"
+
+/* NEON version of x86/picture_copy_avx2.c, bit exact with picture_copy(). */
+
+static inline void store_u16x8(float *dst, uint16x8_t s, float32x4_t scale,
+                               float32x4_t off)
+{
+    const float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(s)));
+    const float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(s)));
+    vst1q_f32(dst, vaddq_f32(vdivq_f32(lo, scale), off));
+    vst1q_f32(dst + 4, vaddq_f32(vdivq_f32(hi, scale), off));
+}
+
+void picture_copy_8_neon(float *dst, ptrdiff_t dst_stride,
+                         const uint8_t *src, ptrdiff_t src_stride,
+                         unsigned w, unsigned h, float offset)
+{
+    const float32x4_t off = vdupq_n_f32(offset);
+    const unsigned w16 = w & ~15u;
+
+    for (unsigned i = 0; i < h; i++) {
+        unsigned j = 0;
+        for (; j < w16; j += 16) {
+            const uint8x16_t s = vld1q_u8(src + j);
+            const uint16x8_t lo = vmovl_u8(vget_low_u8(s));
+            const uint16x8_t hi = vmovl_u8(vget_high_u8(s));
+            vst1q_f32(dst + j, vaddq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), off));
+            vst1q_f32(dst + j + 4, vaddq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), off));
+            vst1q_f32(dst + j + 8, vaddq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), off));
+            vst1q_f32(dst + j + 12, vaddq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), off));
+        }
+        for (; j < w; j++)
+            dst[j] = (float) src[j] + offset;
+        dst += dst_stride / sizeof(float);
+        src += src_stride;
+    }
+}
+
+void picture_copy_16_neon(float *dst, ptrdiff_t dst_stride,
+                          const uint16_t *src, ptrdiff_t src_stride,
+                          unsigned w, unsigned h, float scaler, float offset)
+{
+    const float32x4_t off = vdupq_n_f32(offset);
+    const float32x4_t scale = vdupq_n_f32(scaler);
+    const unsigned w16 = w & ~15u;
+
+    for (unsigned i = 0; i < h; i++) {
+        unsigned j = 0;
+        for (; j < w16; j += 16) {
+            store_u16x8(dst + j, vld1q_u16(src + j), scale, off);
+            store_u16x8(dst + j + 8, vld1q_u16(src + j + 8), scale, off);
+        }
+        for (; j < w; j++)
+            dst[j] = (float) src[j] / scaler + offset;
+        dst += dst_stride / sizeof(float);
+        src += src_stride / sizeof(uint16_t);
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef ARM64_PICTURE_COPY_H_
+#define ARM64_PICTURE_COPY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+void picture_copy_8_neon(float *dst, ptrdiff_t dst_stride,
+                         const uint8_t *src, ptrdiff_t src_stride,
+                         unsigned w, unsigned h, float offset);
+
+void picture_copy_16_neon(float *dst, ptrdiff_t dst_stride,
+                          const uint16_t *src, ptrdiff_t src_stride,
+                          unsigned w, unsigned h, float scaler, float offset);
+
+#endif /* ARM64_PICTURE_COPY_H_ */
@@ -0,0 +1,82 @@
+#include <arm_neon.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "feature/arm64/scale_neon.h"
+
+/*
+ * NEON version of x86/scale_avx2.c, bit exact with vmaf_scale_h_c() and
+ * vmaf_scale_v_c(). There is no gather, so the horizontal pass loads its
+ * four lanes one by one.
+ */
+
+void vmaf_scale_h_neon(const float *src, float *dst, unsigned w,
+                       const int32_t *pos, const float *coef,
+                       ptrdiff_t coef_stride, unsigned taps)
+{
+    const unsigned w4 = w & ~3u;
+
+    unsigned x = 0;
+    for (; x < w4; x += 4) {
+        const float *s0 = src + pos[x], *s1 = src + pos[x + 1];
+        const float *s2 = src + pos[x + 2], *s3 = src + pos[x + 3];
+        float32x4_t sum = vdupq_n_f32(0.f);
+        for (unsigned k = 0; k < taps; k++) {
+            float32x4_t s = vdupq_n_f32(s0[k]);
+            s = vsetq_lane_f32(s1[k], s, 1);
+            s = vsetq_lane_f32(s2[k], s, 2);
+            s = vsetq_lane_f32(s3[k], s, 3);
+            const float32x4_t c = vld1q_f32(coef + k * coef_stride + x);
+            sum = vaddq_f32(sum, vmulq_f32(s, c));
+        }
+        vst1q_f32(dst + x, sum);
+    }
+    for (; x < w; x++) {
+        float sum = 0.f;
+        for (unsigned k = 0; k < taps; k++)
+            sum += src[pos[x] + (int) k] * coef[k * coef_stride + x];
+        dst[x] = sum;
+    }
+}
+
+static inline uint16x4_t round_clip(float32x4_t sum, float32x4_t max)
+{
+    sum = vminq_f32(vmaxq_f32(sum, vdupq_n_f32(0.f)), max);
+    // round to nearest even, as lrintf()
+    return vqmovun_s32(vcvtnq_s32_f32(sum));
+}
+
+void vmaf_scale_v_neon(const float *const *src, const float *coef,
+                       unsigned taps, void *dst, unsigned w, unsigned bpc)
+{
+    const float max = (1 << bpc) - 1;
+    const float32x4_t vmax = vdupq_n_f32(max);
+    const unsigned w8 = w & ~7u;
+
+    unsigned x = 0;
+    for (; x < w8; x += 8) {
+        float32x4_t lo = vdupq_n_f32(0.f), hi = vdupq_n_f32(0.f);
+        for (unsigned k = 0; k < taps; k++) {
+            const float32x4_t c = vdupq_n_f32(coef[k]);
+            lo = vaddq_f32(lo, vmulq_f32(vld1q_f32(src[k] + x), c));
+            hi = vaddq_f32(hi, vmulq_f32(vld1q_f32(src[k] + x + 4), c));
+        }
+        const uint16x8_t u16 = vcombine_u16(round_clip(lo, vmax),
+                                            round_clip(hi, vmax));
+        if (bpc == 8)
+            vst1_u8((uint8_t *) dst + x, vqmovn_u16(u16));
+        else
+            vst1q_u16((uint16_t *) dst + x, u16);
+    }
+    for (; x < w; x++) {
+        float sum = 0.f;
+        for (unsigned k = 0; k < taps; k++)
+            sum += src[k][x] * coef[k];
+        sum = sum < 0.f ? 0.f : sum > max ? max : sum;
+        if (bpc == 8)
+            ((uint8_t *) dst)[x] = lrintf(sum);
+        else
+            ((uint16_t *) dst)[x] = lrintf(sum);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef ARM64_SCALE_H_
+#define ARM64_SCALE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+void vmaf_scale_h_neon(const float *src, float *dst, unsigned w,
+                       const int32_t *pos, const float *coef,
+                       ptrdiff_t coef_stride, unsigned taps);
+
+void vmaf_scale_v_neon(const float *const *src, const float *coef,
+                       unsigned taps, void *dst, unsigned w, unsigned bpc);
+
+#endif /* ARM64_SCALE_H_ */
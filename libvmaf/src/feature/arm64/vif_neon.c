@@ -505,7 +505,7 @@ void vif_subsample_rd_16_neon(VifBuffer buf, unsigned int w, unsigned int h, int
 }
 
 
-void vif_statistic_8_neon(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h)
+void vif_statistic_8_neon(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end)
 {
     const unsigned int uiw15 = (w > 15 ? w - 15 : 0);
     const unsigned int uiw7 = (w > 7 ? w - 7 : 0);
@@ -524,7 +524,7 @@ void vif_statistic_8_neon(struct VifPublicState *s, float *num, float *den, unsi
     const uint8_t *ref = (uint8_t *)buf.ref;
     const uint8_t *dis = (uint8_t *)buf.dis;
     const ptrdiff_t dst_stride = buf.stride_32 / sizeof(uint32_t);
-    ptrdiff_t i_dst_stride = 0;
+    ptrdiff_t i_dst_stride = row_start * dst_stride;
 
     const uint32x4_t offset_vec_v = vdupq_n_u32(128);
     const int32x4_t shift_vec_v = vdupq_n_s32(-8);
@@ -534,7 +534,7 @@ void vif_statistic_8_neon(struct VifPublicState *s, float *num, float *den, unsi
 
     int32_t xx[8], yy[8], xy[8];
 
-    for (unsigned i = 0; i < h; ++i, i_dst_stride += dst_stride)
+    for (unsigned i = row_start; i < row_end; ++i, i_dst_stride += dst_stride)
     {
         int ii = i - fwidth / 2;
         const uint8_t *p_ref = ref + ii * buf.stride;
@@ -767,11 +767,13 @@ void vif_statistic_8_neon(struct VifPublicState *s, float *num, float *den, unsi
             }
         }
     }
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 }
 
-void vif_statistic_16_neon(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h, int bpc, int scale)
+void vif_statistic_16_neon(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end, int bpc, int scale)
 {
     const unsigned int uiw7 = (w > 7 ? w - 7 : 0);
     const unsigned int fwidth = vif_filter1d_width[scale];
@@ -815,7 +817,7 @@ void vif_statistic_16_neon(struct VifPublicState *s, float *num, float *den, uns
 
     const ptrdiff_t stride_16 = buf.stride / sizeof(uint16_t);
     const ptrdiff_t stride_32 = buf.stride_32 / sizeof(uint32_t);
-    ptrdiff_t i_dst_stride = 0;
+    ptrdiff_t i_dst_stride = row_start * stride_32;
     int32_t xx[8], yy[8], xy[8];
     int64_t accum_num_log = 0.0;
     int64_t accum_den_log = 0.0;
@@ -823,7 +825,7 @@ void vif_statistic_16_neon(struct VifPublicState *s, float *num, float *den, uns
     int64_t accum_den_non_log = 0;
     static const int32_t sigma_nsq = 65536 << 1;
 
-    for (unsigned i = 0; i < h; ++i, i_dst_stride += stride_32)
+    for (unsigned i = row_start; i < row_end; ++i, i_dst_stride += stride_32)
     {
         int ii = i - fwidth / 2;
         const uint16_t *p_ref = ref + ii * stride_16;
@@ -1052,15 +1054,17 @@ void vif_statistic_16_neon(struct VifPublicState *s, float *num, float *den, uns
 
         if (j != w)
         {
-            VifResiduals residuals =
+            VifResiduals line_residuals =
                 vif_compute_line_residuals(s, j, w, scale);
-            accum_num_log += residuals.accum_num_log;
-            accum_den_log += residuals.accum_den_log;
-            accum_num_non_log += residuals.accum_num_non_log;
-            accum_den_non_log += residuals.accum_den_non_log;
+            accum_num_log += line_residuals.accum_num_log;
+            accum_den_log += line_residuals.accum_den_log;
+            accum_num_non_log += line_residuals.accum_num_non_log;
+            accum_den_non_log += line_residuals.accum_den_non_log;
         }
     }
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 }
 
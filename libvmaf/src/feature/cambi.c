@@ -24,14 +24,21 @@
 #include "cpu.h"
 #include "feature_collector.h"
 #include "feature_extractor.h"
+#include "kernel.h"
 #include "log.h"
 #include "luminance_tools.h"
 #include "mem.h"
 #include "mkdirp.h"
 #include "picture.h"
+#include "thread_pool.h"
 
 #if ARCH_X86
 #include "x86/cambi_avx2.h"
+#if HAVE_AVX512
+#include "x86/cambi_avx512.h"
+#endif
+#elif ARCH_AARCH64
+#include "arm64/cambi_neon.h"
 #endif
 
 /* Ratio of pixels for computation, must be 0 < topk <= 1.0 */
@@ -75,9 +82,12 @@ static const int g_contrast_weights[32] = {1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7
 
 #define PICS_BUFFER_SIZE 2
 #define MASK_FILTER_SIZE 7
+/* Narrowest column strip handed to a worker thread for the histogram pass */
+#define CAMBI_MIN_STRIP_WIDTH 256
 
 typedef struct CambiBuffers {
     float *c_values;
+    float *topk_buffer;
     uint32_t *mask_dp;
     uint16_t *c_values_histograms;
     uint16_t *filter_mode_buffer;
@@ -90,6 +100,16 @@ typedef struct CambiBuffers {
 
 typedef void (*VmafRangeUpdater)(uint16_t *arr, int left, int right);
 typedef void (*VmafDerivativeCalculator)(const uint16_t *image_data, uint16_t *derivative_buffer, int width, int height, int row, int stride);
+typedef void (*VmafSpatialMaskRowCalculator)(uint16_t *mask_row, const uint32_t *dp_top, const uint32_t *dp_bottom, int width, uint16_t pad_size, uint16_t mask_index);
+typedef void (*VmafFilterModeCalculator)(uint16_t *data, int width, int height, ptrdiff_t stride, uint16_t *buffer);
+typedef void (*VmafDecimateCalculator)(uint16_t *data, int width, int height, ptrdiff_t stride);
+typedef void (*VmafAntiDitheringCalculator)(uint16_t *data, int width, int height, ptrdiff_t stride);
+typedef void (*VmafCValuesRowCalculator)(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                         const uint16_t *mask, int row, int col_start, int col_end,
+                                         int width, ptrdiff_t stride,
+                                         const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                         const int *diff_weights, const int *all_diffs);
+typedef double (*VmafTopKAverager)(float *arr, int n, int k, float *buffer);
 
 typedef struct CambiState {
     VmafPicture pics[PICS_BUFFER_SIZE];
@@ -110,7 +130,18 @@ typedef struct CambiState {
     VmafRangeUpdater inc_range_callback;
     VmafRangeUpdater dec_range_callback;
     VmafDerivativeCalculator derivative_callback;
+    VmafSpatialMaskRowCalculator spatial_mask_row_callback;
+    VmafFilterModeCalculator filter_mode_callback;
+    VmafDecimateCalculator decimate_callback;
+    VmafAntiDitheringCalculator anti_dithering_callback;
+    VmafCValuesRowCalculator c_values_row_callback;
+    VmafTopKAverager topk_callback;
     CambiBuffers buffers;
+    // Separate working set for the source pipeline, so that it can run
+    // concurrently with the distorted one. Only allocated with a thread pool.
+    VmafPicture src_pics[PICS_BUFFER_SIZE];
+    CambiBuffers src_buffers;
+    VmafThreadPool *thread_pool;
 } CambiState;
 
 static const VmafOption options[] = {
@@ -333,16 +364,165 @@ static void get_derivative_data_for_row(const uint16_t *image_data, uint16_t *de
     }
 }
 
+static void get_spatial_mask_row(uint16_t *mask_row, const uint32_t *dp_top, const uint32_t *dp_bottom,
+                                 int width, uint16_t pad_size, uint16_t mask_index);
+static void filter_mode(uint16_t *data, int width, int height, ptrdiff_t stride, uint16_t *buffer);
+static void decimate(uint16_t *data, int width, int height, ptrdiff_t stride);
+static void anti_dithering_filter(uint16_t *data, int width, int height, ptrdiff_t stride);
+static void calculate_c_values_row(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                   const uint16_t *mask, int row, int col_start, int col_end,
+                                   int width, ptrdiff_t stride,
+                                   const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                   const int *diff_weights, const int *all_diffs);
+static double average_topk_elements_select(float *arr, int n, int k, float *buffer);
+
 #ifdef _WIN32
     #define PATH_SEPARATOR '\\'
 #else
     #define PATH_SEPARATOR '/'
 #endif
 
-static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
-                unsigned bpc, unsigned w, unsigned h) {
+static int alloc_working_buffers(VmafPicture *pics, CambiBuffers *buffers,
+                                 VmafArena *arena, int alloc_w, int alloc_h,
+                                 uint16_t num_bins) {
+    int err = 0;
+    for (unsigned i = 0; i < PICS_BUFFER_SIZE; i++) {
+        err |= vmaf_picture_alloc(&pics[i], VMAF_PIX_FMT_YUV400P, 10, alloc_w, alloc_h);
+    }
+    if (err) return err;
+
+    buffers->c_values = vmaf_arena_alloc(arena, ALIGN_CEIL(alloc_w * sizeof(float)) * alloc_h, 32);
+    if (!buffers->c_values) return -ENOMEM;
+
+    // Scratch space for the partitioning steps of the SIMD top-k selection.
+    buffers->topk_buffer = vmaf_arena_alloc(arena, ALIGN_CEIL(alloc_w * sizeof(float)) * alloc_h, 32);
+    if (!buffers->topk_buffer) return -ENOMEM;
+
+    // The SIMD c-value kernels gather 32-bit words from the histograms,
+    // pad the allocation so that the upper half of the last entry is readable.
+    buffers->c_values_histograms = vmaf_arena_alloc(arena, ALIGN_CEIL(alloc_w * num_bins * sizeof(uint16_t)) + 32, 32);
+    if (!buffers->c_values_histograms) return -ENOMEM;
+
+    int pad_size = MASK_FILTER_SIZE >> 1;
+    int dp_width = alloc_w + 2 * pad_size + 1;
+    int dp_height = 2 * pad_size + 2;
+
+    buffers->mask_dp = vmaf_arena_alloc(arena, ALIGN_CEIL(dp_height * dp_width * sizeof(uint32_t)), 32);
+    if (!buffers->mask_dp) return -ENOMEM;
+    buffers->filter_mode_buffer = vmaf_arena_alloc(arena, ALIGN_CEIL(3 * alloc_w * sizeof(uint16_t)), 32);
+    if (!buffers->filter_mode_buffer) return -ENOMEM;
+    buffers->derivative_buffer = vmaf_arena_alloc(arena, ALIGN_CEIL(alloc_w * sizeof(uint16_t)), 32);
+    if (!buffers->derivative_buffer) return -ENOMEM;
+
+    return 0;
+}
+
+static size_t working_buffers_size(int alloc_w, int alloc_h, uint16_t num_bins) {
+    const size_t pic_sz = (size_t)ALIGN_CEIL(alloc_w * sizeof(uint16_t)) * alloc_h;
+    const size_t frame_sz = (size_t)ALIGN_CEIL(alloc_w * sizeof(float)) * alloc_h;
+    int pad_size = MASK_FILTER_SIZE >> 1;
+    int dp_width = alloc_w + 2 * pad_size + 1;
+    int dp_height = 2 * pad_size + 2;
+
+    return PICS_BUFFER_SIZE * pic_sz + 2 * frame_sz +
+           ALIGN_CEIL(alloc_w * num_bins * sizeof(uint16_t)) + 32 +
+           ALIGN_CEIL(dp_height * dp_width * sizeof(uint32_t)) +
+           ALIGN_CEIL(3 * alloc_w * sizeof(uint16_t)) +
+           ALIGN_CEIL(alloc_w * sizeof(uint16_t));
+}
+
+static int free_working_buffers(VmafPicture *pics, CambiBuffers *buffers,
+                                VmafArena *arena) {
+    int err = 0;
+    for (unsigned i = 0; i < PICS_BUFFER_SIZE; i++)
+        err |= vmaf_picture_unref(&pics[i]);
+
+    vmaf_arena_free(arena, buffers->c_values);
+    vmaf_arena_free(arena, buffers->topk_buffer);
+    vmaf_arena_free(arena, buffers->c_values_histograms);
+    vmaf_arena_free(arena, buffers->mask_dp);
+    vmaf_arena_free(arena, buffers->filter_mode_buffer);
+    vmaf_arena_free(arena, buffers->derivative_buffer);
+
+    return err;
+}
+
+static void init_callbacks(CambiState *s, unsigned flags) {
+    s->inc_range_callback = increment_range;
+    s->dec_range_callback = decrement_range;
+    s->derivative_callback = get_derivative_data_for_row;
+    s->spatial_mask_row_callback = get_spatial_mask_row;
+    s->filter_mode_callback = filter_mode;
+    s->decimate_callback = decimate;
+    s->anti_dithering_callback = anti_dithering_filter;
+    s->c_values_row_callback = calculate_c_values_row;
+    s->topk_callback = average_topk_elements_select;
+
+#if ARCH_X86
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
+        s->inc_range_callback = cambi_increment_range_avx2;
+        s->dec_range_callback = cambi_decrement_range_avx2;
+        s->derivative_callback = get_derivative_data_for_row_avx2;
+        s->spatial_mask_row_callback = get_spatial_mask_row_avx2;
+        s->filter_mode_callback = filter_mode_avx2;
+        s->decimate_callback = decimate_avx2;
+        s->anti_dithering_callback = anti_dithering_filter_avx2;
+        s->c_values_row_callback = calculate_c_values_row_avx2;
+        s->topk_callback = average_topk_elements_select_avx2;
+    }
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        s->inc_range_callback = cambi_increment_range_avx512;
+        s->dec_range_callback = cambi_decrement_range_avx512;
+        s->c_values_row_callback = calculate_c_values_row_avx512;
+        s->topk_callback = average_topk_elements_select_avx512;
+    }
+#endif
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        s->inc_range_callback = cambi_increment_range_neon;
+        s->dec_range_callback = cambi_decrement_range_neon;
+        s->derivative_callback = get_derivative_data_for_row_neon;
+        s->spatial_mask_row_callback = get_spatial_mask_row_neon;
+        s->filter_mode_callback = filter_mode_neon;
+        s->decimate_callback = decimate_neon;
+        s->anti_dithering_callback = anti_dithering_filter_neon;
+        s->c_values_row_callback = calculate_c_values_row_neon;
+    }
+#else
+    (void)flags;
+#endif
+}
+
+static const VmafKernel cambi_kernel = {
+    .name = "cambi",
+    .feature_extractor = "cambi",
+    .variant = vmaf_kernel_variants_simd,
+};
+
+static size_t scratch_size(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
+                           unsigned bpc, unsigned w, unsigned h) {
     (void)pix_fmt;
+    (void)bpc;
+    CambiState *s = fex->priv;
 
+    unsigned enc_w = s->enc_width ? s->enc_width : w;
+    unsigned enc_h = s->enc_height ? s->enc_height : h;
+    unsigned src_w = s->src_width ? s->src_width : w;
+    unsigned src_h = s->src_height ? s->src_height : h;
+    int alloc_w = s->full_ref ? MAX(src_w, enc_w) : enc_w;
+    int alloc_h = s->full_ref ? MAX(src_h, enc_h) : enc_h;
+
+    const int num_diffs = 1 << s->max_log_contrast;
+    const uint16_t num_bins = 1024 + 2 * num_diffs;
+    size_t sz = working_buffers_size(alloc_w, alloc_h, num_bins);
+    if (s->full_ref && fex->thread_pool)
+        sz *= 2;
+    return sz;
+}
+
+static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
+                unsigned bpc, unsigned w, unsigned h) {
     CambiState *s = fex->priv;
 
     if (s->enc_bitdepth == 0) {
@@ -373,18 +553,12 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     int alloc_w = s->full_ref ? MAX(s->src_width, s->enc_width) : s->enc_width;
     int alloc_h = s->full_ref ? MAX(s->src_height, s->enc_height) : s->enc_height;
 
-    int err = 0;
-    for (unsigned i = 0; i < PICS_BUFFER_SIZE; i++) {
-        err |= vmaf_picture_alloc(&s->pics[i], VMAF_PIX_FMT_YUV400P, 10, alloc_w, alloc_h);
-    }
-    if (err) return err;
-
     const int num_diffs = 1 << s->max_log_contrast;
 
     set_contrast_arrays(num_diffs, &s->buffers.diffs_to_consider, &s->buffers.diff_weights, &s->buffers.all_diffs);
 
     VmafLumaRange luma_range;
-    err = vmaf_luminance_init_luma_range(&luma_range, 10, VMAF_PIXEL_RANGE_LIMITED);
+    int err = vmaf_luminance_init_luma_range(&luma_range, 10, VMAF_PIXEL_RANGE_LIMITED);
     if (err) return err;
 
     VmafEOTF eotf;
@@ -401,23 +575,24 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     s->src_window_size = s->window_size;
     adjust_window_size(&s->window_size, s->enc_width, s->enc_height);
     adjust_window_size(&s->src_window_size, s->src_width, s->src_height);
-    s->buffers.c_values = aligned_malloc(ALIGN_CEIL(alloc_w * sizeof(float)) * alloc_h, 32);
-    if (!s->buffers.c_values) return -ENOMEM;
 
     const uint16_t num_bins = 1024 + (s->buffers.all_diffs[2 * num_diffs] - s->buffers.all_diffs[0]);
-    s->buffers.c_values_histograms = aligned_malloc(ALIGN_CEIL(alloc_w * num_bins * sizeof(uint16_t)), 32);
-    if (!s->buffers.c_values_histograms) return -ENOMEM;
-
-    int pad_size = MASK_FILTER_SIZE >> 1;
-    int dp_width = alloc_w + 2 * pad_size + 1;
-    int dp_height = 2 * pad_size + 2;
+    err = alloc_working_buffers(s->pics, &s->buffers, fex->arena, alloc_w,
+                                alloc_h, num_bins);
+    if (err) return err;
 
-    s->buffers.mask_dp = aligned_malloc(ALIGN_CEIL(dp_height * dp_width * sizeof(uint32_t)), 32);
-    if (!s->buffers.mask_dp) return -ENOMEM;
-    s->buffers.filter_mode_buffer = aligned_malloc(ALIGN_CEIL(3 * alloc_w * sizeof(uint16_t)), 32);
-    if (!s->buffers.filter_mode_buffer) return -ENOMEM;
-    s->buffers.derivative_buffer = aligned_malloc(ALIGN_CEIL(alloc_w * sizeof(uint16_t)), 32);
-    if (!s->buffers.derivative_buffer) return -ENOMEM;
+    // With a thread pool the source pipeline runs concurrently with the
+    // distorted one and needs its own working set.
+    s->thread_pool = fex->thread_pool;
+    if (s->full_ref && s->thread_pool) {
+        err = alloc_working_buffers(s->src_pics, &s->src_buffers, fex->arena,
+                                    alloc_w, alloc_h, num_bins);
+        if (err) return err;
+        s->src_buffers.tvi_for_diff = s->buffers.tvi_for_diff;
+        s->src_buffers.diffs_to_consider = s->buffers.diffs_to_consider;
+        s->src_buffers.diff_weights = s->buffers.diff_weights;
+        s->src_buffers.all_diffs = s->buffers.all_diffs;
+    }
 
     if (s->heatmaps_path) {
         int err = mkdirp(s->heatmaps_path, 0770);
@@ -439,18 +614,10 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
         }
     }
 
-    s->inc_range_callback = increment_range;
-    s->dec_range_callback = decrement_range;
-    s->derivative_callback = get_derivative_data_for_row;
-
-#if ARCH_X86
-    unsigned flags = vmaf_get_cpu_flags();
-    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
-        s->inc_range_callback = cambi_increment_range_avx2;
-        s->dec_range_callback = cambi_decrement_range_avx2;
-        s->derivative_callback = get_derivative_data_for_row_avx2;
-    }
-#endif
+    const VmafKernelVariant *kernel =
+        vmaf_kernel_select(&cambi_kernel, fex->kernel_tuning, pix_fmt, bpc, w,
+                           h);
+    init_callbacks(s, kernel->cpu_flags);
 
     return err;
 }
@@ -582,12 +749,9 @@ static void decimate_generic_uint16_and_convert_to_10b(const VmafPicture *pic, V
     }
 }
 
-static void anti_dithering_filter(VmafPicture *pic, unsigned width, unsigned height) {
-    uint16_t *data = pic->data[0];
-    int stride = pic->stride[0] >> 1;
-
-    for (unsigned i = 0; i < height - 1; i++) {
-        for (unsigned j = 0; j < width - 1; j++) {
+static void anti_dithering_filter(uint16_t *data, int width, int height, ptrdiff_t stride) {
+    for (int i = 0; i < height - 1; i++) {
+        for (int j = 0; j < width - 1; j++) {
             data[i * stride + j] = (data[i * stride + j] +
                                     data[i * stride + j + 1] +
                                     data[(i + 1) * stride + j] +
@@ -595,14 +759,14 @@ static void anti_dithering_filter(VmafPicture *pic, unsigned width, unsigned hei
         }
 
         // Last column
-        unsigned j = width - 1;
+        int j = width - 1;
         data[i * stride + j] = (data[i * stride + j] +
                                 data[(i + 1) * stride + j]) >> 1;
     }
 
     // Last row
-    unsigned i = height - 1;
-    for (unsigned j = 0; j < width - 1; j++) {
+    int i = height - 1;
+    for (int j = 0; j < width - 1; j++) {
         data[i * stride + j] = (data[i * stride + j] +
                                 data[i * stride + j + 1]) >> 1;
     }
@@ -660,7 +824,8 @@ static int validate_image(const VmafPicture *pic) {
     }
 }
 
-static int cambi_preprocessing(const VmafPicture *image, VmafPicture *preprocessed, int width, int height, int enc_bitdepth) {
+static int cambi_preprocessing(const VmafPicture *image, VmafPicture *preprocessed, int width, int height, int enc_bitdepth,
+                               VmafAntiDitheringCalculator anti_dithering_callback) {
     if (validate_image(image)) {
         return -EINVAL;
     }
@@ -676,18 +841,16 @@ static int cambi_preprocessing(const VmafPicture *image, VmafPicture *preprocess
         }
     }
     if (enc_bitdepth < 10) {
-        anti_dithering_filter(preprocessed, width, height);
+        anti_dithering_callback(preprocessed->data[0], width, height, preprocessed->stride[0] >> 1);
     }
 
     return 0;
 }
 
 /* Banding detection functions */
-static void decimate(VmafPicture *image, unsigned width, unsigned height) {
-    uint16_t *data = image->data[0];
-    ptrdiff_t stride = image->stride[0] >> 1;
-    for (unsigned i = 0; i < height; i++) {
-        for (unsigned j = 0; j < width; j++) {
+static void decimate(uint16_t *data, int width, int height, ptrdiff_t stride) {
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
             data[i * stride + j] = data[(i << 1) * stride + (j << 1)];
         }
     }
@@ -705,9 +868,7 @@ static inline uint16_t mode3(uint16_t a, uint16_t b, uint16_t c) {
     return min3(a, b, c);
 }
 
-static void filter_mode(const VmafPicture *image, int width, int height, uint16_t *buffer) {
-    uint16_t *data = image->data[0];
-    ptrdiff_t stride = image->stride[0] >> 1;
+static void filter_mode(uint16_t *data, int width, int height, ptrdiff_t stride, uint16_t *buffer) {
     int curr_line = 0;
     for (int i = 0; i < height; i++) {
         buffer[curr_line * width + 0] = data[i * stride + 0];
@@ -744,17 +905,46 @@ static FORCE_INLINE uint16_t get_mask_index(unsigned input_width, unsigned input
     return (filter_size * filter_size + 3 * (ceil_log2(shifted_wh) - 11) - 1)>>1;
 }
 
+static FORCE_INLINE void update_dp_row(uint32_t *dp_curr, const uint32_t *dp_prev,
+                                      const uint16_t *derivative_buffer, int valid_width,
+                                      int dp_cols, uint16_t pad_size) {
+    uint32_t row_sum = 0;
+    int j = 0;
+    for (; j < valid_width; j++) {
+        row_sum += derivative_buffer[j];
+        dp_curr[j + pad_size + 1] = dp_prev[j + pad_size + 1] + row_sum;
+    }
+    for (; j < dp_cols; j++) {
+        dp_curr[j + pad_size + 1] = dp_prev[j + pad_size + 1] + row_sum;
+    }
+}
+
+static void get_spatial_mask_row(uint16_t *mask_row, const uint32_t *dp_top, const uint32_t *dp_bottom,
+                                 int width, uint16_t pad_size, uint16_t mask_index) {
+    for (int j = 0; j < width; j++) {
+        int result =
+            dp_bottom[j + 2 * pad_size + 1]
+            - dp_bottom[j]
+            - dp_top[j + 2 * pad_size + 1]
+            + dp_top[j];
+        mask_row[j] = (result > mask_index);
+    }
+}
+
 /*
 * This function calculates the horizontal and vertical derivatives of the image using 2x1 and 1x2 kernels.
 * We say a pixel has zero_derivative=1 if it's equal to its right and bottom neighbours, and =0 otherwise (edges also count as "equal").
 * This function then computes the sum of zero_derivative on the filter_size x filter_size square around each pixel
 * and stores 1 into the corresponding mask index iff this number is larger than mask_index.
 * To calculate the square sums, it uses a dynamic programming algorithm based on inclusion-exclusion.
+* Each DP row is the previous row plus the running prefix sum of the current derivative row.
 * To save memory, it uses a DP matrix of only the necessary size, rather than the full matrix, and indexes its rows cyclically.
 */
 static void get_spatial_mask_for_index(const VmafPicture *image, VmafPicture *mask,
                                        uint32_t *dp, uint16_t *derivative_buffer, uint16_t mask_index,
-                                       uint16_t filter_size, int width, int height, VmafDerivativeCalculator derivative_callback) {
+                                       uint16_t filter_size, int width, int height,
+                                       VmafDerivativeCalculator derivative_callback,
+                                       VmafSpatialMaskRowCalculator spatial_mask_row_callback) {
     uint16_t pad_size = filter_size >> 1;
     uint16_t *image_data = image->data[0];
     uint16_t *mask_data = mask->data[0];
@@ -769,16 +959,9 @@ static void get_spatial_mask_for_index(const VmafPicture *image, VmafPicture *ma
         if (i < height) {
             derivative_callback(image_data, derivative_buffer, width, height, i, stride);
         }
-        for (int j = 0; j < width + pad_size; j++) {
-            int value = (i < height && j < width ? derivative_buffer[j] : 0);
-            int curr_row = i + pad_size + 1;
-            int curr_col = j + pad_size + 1;
-            dp[curr_row * dp_width + curr_col] =
-                value
-                + dp[(curr_row - 1) * dp_width + curr_col]
-                + dp[curr_row * dp_width + curr_col - 1]
-                - dp[(curr_row - 1) * dp_width + curr_col - 1];
-        }
+        int curr_row = i + pad_size + 1;
+        update_dp_row(&dp[curr_row * dp_width], &dp[(curr_row - 1) * dp_width],
+                      derivative_buffer, i < height ? width : 0, width + pad_size, pad_size);
     }
 
     // Start from the last row in the dp matrix
@@ -792,30 +975,14 @@ static void get_spatial_mask_for_index(const VmafPicture *image, VmafPicture *ma
             derivative_callback(image_data, derivative_buffer, width, height, i, stride);
         }
         // First compute the values of dp for curr_row
-        for (int j = 0; j < width + pad_size; j++) {
-            int value = (i < height && j < width ? derivative_buffer[j] : 0);
-            int curr_col = j + pad_size + 1;
-            dp[curr_row * dp_width + curr_col] =
-                value
-                + dp[prev_row * dp_width + curr_col]
-                + dp[curr_row * dp_width + curr_col - 1]
-                - dp[prev_row * dp_width + curr_col - 1];
-        }
+        update_dp_row(&dp[curr_row * dp_width], &dp[prev_row * dp_width],
+                      derivative_buffer, i < height ? width : 0, width + pad_size, pad_size);
         prev_row = curr_row;
         curr_row = (curr_row + 1 == dp_height ? 0 : curr_row + 1);
 
         // Then use the values to compute the square sum for the curr_compute row.
-        for (int j = 0; j < width; j++) {
-            int curr_col = j + pad_size + 1;
-            int right = curr_col + pad_size;
-            int left = curr_col - pad_size - 1;
-            int result =
-                dp[bottom * dp_width + right]
-                - dp[bottom * dp_width + left]
-                - dp[top * dp_width + right]
-                + dp[top * dp_width + left];
-            mask_data[(i - pad_size) * stride + j] = (result > mask_index);
-        }
+        spatial_mask_row_callback(&mask_data[(i - pad_size) * stride], &dp[top * dp_width],
+                                  &dp[bottom * dp_width], width, pad_size, mask_index);
         curr_compute = (curr_compute + 1 == dp_height ? 0 : curr_compute + 1);
         bottom = (bottom + 1 == dp_height ? 0 : bottom + 1);
         top = (top + 1 == dp_height ? 0 : top + 1);
@@ -824,9 +991,11 @@ static void get_spatial_mask_for_index(const VmafPicture *image, VmafPicture *ma
 
 static void get_spatial_mask(const VmafPicture *image, VmafPicture *mask,
                              uint32_t *dp, uint16_t *derivative_buffer, unsigned width, unsigned height,
-                             VmafDerivativeCalculator derivative_callback) {
+                             VmafDerivativeCalculator derivative_callback,
+                             VmafSpatialMaskRowCalculator spatial_mask_row_callback) {
     uint16_t mask_index = get_mask_index(width, height, MASK_FILTER_SIZE);
-    get_spatial_mask_for_index(image, mask, dp, derivative_buffer, mask_index, MASK_FILTER_SIZE, width, height, derivative_callback);
+    get_spatial_mask_for_index(image, mask, dp, derivative_buffer, mask_index, MASK_FILTER_SIZE, width, height,
+                               derivative_callback, spatial_mask_row_callback);
 }
 
 static float c_value_pixel(const uint16_t *histograms, uint16_t value, const int *diff_weights,
@@ -853,71 +1022,32 @@ static float c_value_pixel(const uint16_t *histograms, uint16_t value, const int
     return c_value;
 }
 
-static FORCE_INLINE void update_histogram_subtract_edge(uint16_t *histograms, uint16_t *image, uint16_t *mask,
-                                                          int i, int j, int width, ptrdiff_t stride, uint16_t pad_size,
-                                                          const uint16_t num_diffs, VmafRangeUpdater dec_range_callback) {
-    uint16_t mask_val = mask[(i - pad_size - 1) * stride + j];
-    if (mask_val) {
-        uint16_t val = image[(i - pad_size - 1) * stride + j] + num_diffs;
-        dec_range_callback(&histograms[val * width], MAX(j - pad_size, 0), MIN(j + pad_size + 1, width));
-    }
-}
-
-static FORCE_INLINE void update_histogram_subtract(uint16_t *histograms, uint16_t *image, uint16_t *mask,
-                                                          int i, int j, int width, ptrdiff_t stride, uint16_t pad_size,
-                                                          const uint16_t num_diffs, VmafRangeUpdater dec_range_callback) {
-    uint16_t mask_val = mask[(i - pad_size - 1) * stride + j];
-    if (mask_val) {
-        uint16_t val = image[(i - pad_size - 1) * stride + j] + num_diffs;
-        dec_range_callback(&histograms[val * width], j - pad_size, j + pad_size + 1);
-    }
-}
-
-static FORCE_INLINE void update_histogram_add_edge(uint16_t *histograms, uint16_t *image, uint16_t *mask,
-                                                     int i, int j, int width, ptrdiff_t stride, uint16_t pad_size,
-                                                     const uint16_t num_diffs, VmafRangeUpdater inc_range_callback) {
-    uint16_t mask_val = mask[(i + pad_size) * stride + j];
-    if (mask_val) {
-        uint16_t val = image[(i + pad_size) * stride + j] + num_diffs;
-        inc_range_callback(&histograms[val * width], MAX(j - pad_size, 0), MIN(j + pad_size + 1, width));
-    }
-}
-
-static FORCE_INLINE void update_histogram_add(uint16_t *histograms, uint16_t *image, uint16_t *mask,
-                                                     int i, int j, int width, ptrdiff_t stride, uint16_t pad_size,
-                                                     const uint16_t num_diffs, VmafRangeUpdater inc_range_callback) {
-    uint16_t mask_val = mask[(i + pad_size) * stride + j];
-    if (mask_val) {
-        uint16_t val = image[(i + pad_size) * stride + j] + num_diffs;
-        inc_range_callback(&histograms[val * width], j - pad_size, j + pad_size + 1);
-    }
-}
-
-static FORCE_INLINE void update_histogram_add_edge_first_pass(uint16_t *histograms, uint16_t *image, uint16_t *mask,
-                                                     int i, int j, int width, ptrdiff_t stride, uint16_t pad_size,
-                                                     const uint16_t num_diffs, VmafRangeUpdater inc_range_callback) {
-    uint16_t mask_val = mask[i * stride + j];
-    if (mask_val) {
-        uint16_t val = image[i * stride + j] + num_diffs;
-        inc_range_callback(&histograms[val * width], MAX(j - pad_size, 0), MIN(j + pad_size + 1, width));
-    }
-}
-
-static FORCE_INLINE void update_histogram_add_first_pass(uint16_t *histograms, uint16_t *image, uint16_t *mask,
-                                                     int i, int j, int width, ptrdiff_t stride, uint16_t pad_size,
-                                                     const uint16_t num_diffs, VmafRangeUpdater inc_range_callback) {
-    uint16_t mask_val = mask[i * stride + j];
-    if (mask_val) {
-        uint16_t val = image[i * stride + j] + num_diffs;
-        inc_range_callback(&histograms[val * width], j - pad_size, j + pad_size + 1);
+/*
+* Adds (inc_range) or removes (dec_range) one image row to/from the histograms of the columns in [col_start, col_end).
+* Each masked pixel contributes to the histograms of all columns within pad_size of it.
+*/
+static FORCE_INLINE void update_histogram_row(uint16_t *histograms, const uint16_t *image, const uint16_t *mask,
+                                              int row, int col_start, int col_end, int width, ptrdiff_t stride,
+                                              uint16_t pad_size, const uint16_t num_diffs,
+                                              VmafRangeUpdater range_callback) {
+    const uint16_t *image_row = &image[row * stride];
+    const uint16_t *mask_row = &mask[row * stride];
+    const int first = MAX(col_start - pad_size, 0);
+    const int last = MIN(col_end + pad_size, width);
+    for (int j = first; j < last; j++) {
+        if (mask_row[j]) {
+            uint16_t val = image_row[j] + num_diffs;
+            range_callback(&histograms[val * width], MAX(j - pad_size, col_start), MIN(j + pad_size + 1, col_end));
+        }
     }
 }
 
-static FORCE_INLINE void calculate_c_values_row(float *c_values, uint16_t *histograms, uint16_t *image,
-                                                       uint16_t *mask, int row, int width, ptrdiff_t stride,
-                                                       const uint16_t num_diffs, const uint16_t *tvi_for_diff,
-                                                       const int *diff_weights, const int *all_diffs) {
-    for (int col = 0; col < width; col++) {
+static void calculate_c_values_row(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                   const uint16_t *mask, int row, int col_start, int col_end,
+                                   int width, ptrdiff_t stride,
+                                   const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                   const int *diff_weights, const int *all_diffs) {
+    for (int col = col_start; col < col_end; col++) {
         if (mask[row * stride + col]) {
             c_values[row * width + col] = c_value_pixel(
                 histograms, image[row * stride + col] + num_diffs, diff_weights, all_diffs, num_diffs, tvi_for_diff, col, width
@@ -926,85 +1056,62 @@ static FORCE_INLINE void calculate_c_values_row(float *c_values, uint16_t *histo
     }
 }
 
-static void calculate_c_values(VmafPicture *pic, const VmafPicture *mask_pic,
-                               float *c_values, uint16_t *histograms, uint16_t window_size,
-                               const uint16_t num_diffs, const uint16_t *tvi_for_diff,
-                               const int *diff_weights, const int *all_diffs, int width, int height,
-                               VmafRangeUpdater inc_range_callback, VmafRangeUpdater dec_range_callback) {
+/*
+* Computes the c-values of the columns in [col_start, col_end).
+* The per-column histograms only depend on the pixels within pad_size of their column,
+* so disjoint strips can be processed concurrently on the same histogram buffer.
+*/
+static void calculate_c_values_strip(const VmafPicture *pic, const VmafPicture *mask_pic,
+                                     float *c_values, uint16_t *histograms, uint16_t window_size,
+                                     const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                     const int *diff_weights, const int *all_diffs, int width, int height,
+                                     int col_start, int col_end,
+                                     VmafRangeUpdater inc_range_callback, VmafRangeUpdater dec_range_callback,
+                                     VmafCValuesRowCalculator c_values_row_callback) {
 
     uint16_t pad_size = window_size >> 1;
     const uint16_t num_bins = 1024 + (all_diffs[2*num_diffs] - all_diffs[0]);
 
-    uint16_t *image = pic->data[0];
-    uint16_t *mask = mask_pic->data[0];
+    const uint16_t *image = pic->data[0];
+    const uint16_t *mask = mask_pic->data[0];
     ptrdiff_t stride = pic->stride[0] >> 1;
 
-    memset(c_values, 0.0, sizeof(float) * width * height);
-
     // Use a histogram for each pixel in width
     // histograms[i * width + j] accesses the j'th histogram, i'th value
     // This is done for cache optimization reasons
-    memset(histograms, 0, width * num_bins * sizeof(uint16_t));
+    for (int b = 0; b < num_bins; b++)
+        memset(&histograms[b * width + col_start], 0, (col_end - col_start) * sizeof(uint16_t));
 
     // First pass: first pad_size rows
-    for (int i = 0; i < pad_size; i++) {
-        for (int j = 0; j < pad_size; j++) {
-            update_histogram_add_edge_first_pass(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-        }
-        for (int j = pad_size; j < width - pad_size - 1; j++) {
-            update_histogram_add_first_pass(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-        }
-        for (int j = MAX(width - pad_size - 1, pad_size); j < width; j++) {
-            update_histogram_add_edge_first_pass(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-        }
-    }
+    for (int i = 0; i < MIN(pad_size, height); i++)
+        update_histogram_row(histograms, image, mask, i, col_start, col_end, width, stride, pad_size, num_diffs, inc_range_callback);
 
-    // Iterate over all rows, unrolled into 3 loops to avoid conditions
-    for (int i = 0; i < pad_size + 1; i++) {
-        if (i + pad_size < height) {
-            for (int j = 0; j < pad_size; j++) {
-                update_histogram_add_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-            }
-            for (int j = pad_size; j < width - pad_size - 1; j++) {
-                update_histogram_add(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-            }
-            for (int j = MAX(width - pad_size - 1, pad_size); j < width; j++) {
-                update_histogram_add_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-            }
-        }
-        calculate_c_values_row(c_values, histograms, image, mask, i, width, stride, num_diffs, tvi_for_diff, diff_weights, all_diffs);
-    }
-    for (int i = pad_size + 1; i < height - pad_size; i++) {
-        for (int j = 0; j < pad_size; j++) {
-            update_histogram_subtract_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, dec_range_callback);
-            update_histogram_add_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-        }
-        for (int j = pad_size; j < width - pad_size - 1; j++) {
-            update_histogram_subtract(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, dec_range_callback);
-            update_histogram_add(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-        }
-        for (int j = MAX(width - pad_size - 1, pad_size); j < width; j++) {
-            update_histogram_subtract_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, dec_range_callback);
-            update_histogram_add_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, inc_range_callback);
-        }
-        calculate_c_values_row(c_values, histograms, image, mask, i, width, stride, num_diffs, tvi_for_diff, diff_weights, all_diffs);
-    }
-    for (int i = height - pad_size; i < height; i++) {
-        if (i - pad_size - 1 >= 0) {
-            for (int j = 0; j < pad_size; j++) {
-                update_histogram_subtract_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, dec_range_callback);
-            }
-            for (int j = pad_size; j < width - pad_size - 1; j++) {
-                update_histogram_subtract(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, dec_range_callback);
-            }
-            for (int j = MAX(width - pad_size - 1, pad_size); j < width; j++) {
-                update_histogram_subtract_edge(histograms, image, mask, i, j, width, stride, pad_size, num_diffs, dec_range_callback);
-            }
-        }
-        calculate_c_values_row(c_values, histograms, image, mask, i, width, stride, num_diffs, tvi_for_diff, diff_weights, all_diffs);
+    // Slide the window down: drop the row leaving it, add the row entering it
+    for (int i = 0; i < height; i++) {
+        if (i - pad_size - 1 >= 0)
+            update_histogram_row(histograms, image, mask, i - pad_size - 1, col_start, col_end, width, stride, pad_size, num_diffs, dec_range_callback);
+        if (i + pad_size < height)
+            update_histogram_row(histograms, image, mask, i + pad_size, col_start, col_end, width, stride, pad_size, num_diffs, inc_range_callback);
+        // The SIMD row kernels gather 32 bits per column, which reads the histogram of the
+        // next column too. The last column is left to the scalar path so that no strip reads
+        // the histograms another strip's thread is writing.
+        c_values_row_callback(c_values, histograms, image, mask, i, col_start, col_end - 1, width, stride, num_diffs, tvi_for_diff, diff_weights, all_diffs);
+        calculate_c_values_row(c_values, histograms, image, mask, i, col_end - 1, col_end, width, stride, num_diffs, tvi_for_diff, diff_weights, all_diffs);
     }
 }
 
+static void calculate_c_values(VmafPicture *pic, const VmafPicture *mask_pic,
+                               float *c_values, uint16_t *histograms, uint16_t window_size,
+                               const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                               const int *diff_weights, const int *all_diffs, int width, int height,
+                               VmafRangeUpdater inc_range_callback, VmafRangeUpdater dec_range_callback,
+                               VmafCValuesRowCalculator c_values_row_callback) {
+    memset(c_values, 0.0, sizeof(float) * width * height);
+    calculate_c_values_strip(pic, mask_pic, c_values, histograms, window_size, num_diffs, tvi_for_diff,
+                             diff_weights, all_diffs, width, height, 0, width,
+                             inc_range_callback, dec_range_callback, c_values_row_callback);
+}
+
 static double average_topk_elements(const float *arr, int topk_elements) {
     double sum = 0;
     for (int i = 0; i < topk_elements; i++)
@@ -1043,11 +1150,17 @@ static void quick_select(float *arr, int n, int k) {
     }
 }
 
-static double spatial_pooling(float *c_values, double topk, unsigned width, unsigned height) {
+static double average_topk_elements_select(float *arr, int n, int k, float *buffer) {
+    (void)buffer;
+    quick_select(arr, n, k);
+    return average_topk_elements(arr, k);
+}
+
+static double spatial_pooling(float *c_values, double topk, unsigned width, unsigned height,
+                              VmafTopKAverager topk_callback, float *topk_buffer) {
     int num_elements = height * width;
     int topk_num_elements = clip(topk * num_elements, 1, num_elements);
-    quick_select(c_values, num_elements, topk_num_elements);
-    return average_topk_elements(c_values, topk_num_elements);
+    return topk_callback(c_values, num_elements, topk_num_elements, topk_buffer);
 }
 
 static FORCE_INLINE uint16_t get_pixels_in_window(uint16_t window_length) {
@@ -1064,7 +1177,7 @@ static FORCE_INLINE double weight_scores_per_scale(double *scores_per_scale, uin
     return score / normalization;
 }
 
-static int dump_c_values(FILE *heatmaps_files[], const float *c_values, int width, int height, int scale,
+static int dump_c_values(FILE *const heatmaps_files[], const float *c_values, int width, int height, int scale,
                          int window_size, const uint16_t num_diffs, const int *diff_weights, int frame) {
     int max_diff_weight = diff_weights[0];
     for (int i = 0; i < num_diffs; i++) {
@@ -1090,41 +1203,103 @@ static int dump_c_values(FILE *heatmaps_files[], const float *c_values, int widt
     return 0;
 }
 
-static int cambi_score(VmafPicture *pics, uint16_t window_size, double topk,
-                       const uint16_t num_diffs, const uint16_t *tvi_for_diff,
-                       CambiBuffers buffers, VmafRangeUpdater inc_range_callback, VmafRangeUpdater dec_range_callback,
-                       VmafDerivativeCalculator derivative_callback, double *score, bool write_heatmaps, FILE *heatmaps_files[],
-                       int width, int height, int frame) {
+typedef struct CambiStripJob {
+    const CambiState *s;
+    const VmafPicture *image, *mask;
+    const CambiBuffers *buffers;
+    uint16_t window_size, num_diffs;
+    int width, height;
+    unsigned n_strips;
+} CambiStripJob;
+
+/*
+ * First column of strip idx. Strip boundaries are kept on 32 column multiples
+ * so that strips do not share cache lines in the histogram and c-value buffers.
+ */
+static int strip_col(const CambiStripJob *job, unsigned idx) {
+    if (idx >= job->n_strips) return job->width;
+    const int col = ALIGN_FLOOR(job->width * (int)idx / (int)job->n_strips);
+    return MIN(col, job->width);
+}
+
+static void c_values_strip_job(void *data, unsigned idx) {
+    const CambiStripJob *job = data;
+    const CambiBuffers *buffers = job->buffers;
+    const int col_start = strip_col(job, idx);
+    const int col_end = strip_col(job, idx + 1);
+    if (col_start >= col_end) return;
+
+    calculate_c_values_strip(job->image, job->mask, buffers->c_values, buffers->c_values_histograms,
+                             job->window_size, job->num_diffs, buffers->tvi_for_diff,
+                             buffers->diff_weights, buffers->all_diffs, job->width, job->height,
+                             col_start, col_end, job->s->inc_range_callback,
+                             job->s->dec_range_callback, job->s->c_values_row_callback);
+}
+
+static int calculate_c_values_threaded(const CambiState *s, const VmafPicture *image,
+                                       const VmafPicture *mask, const CambiBuffers *buffers,
+                                       uint16_t window_size, const uint16_t num_diffs,
+                                       int width, int height) {
+    CambiStripJob job = {
+        .s = s,
+        .image = image,
+        .mask = mask,
+        .buffers = buffers,
+        .window_size = window_size,
+        .num_diffs = num_diffs,
+        .width = width,
+        .height = height,
+        .n_strips = MAX(1, width / CAMBI_MIN_STRIP_WIDTH),
+    };
+
+    memset(buffers->c_values, 0.0, sizeof(float) * width * height);
+    return vmaf_thread_pool_parallel_for(s->thread_pool, job.n_strips,
+                                         c_values_strip_job, &job);
+}
+
+static int cambi_score(const CambiState *s, VmafPicture *pics, CambiBuffers buffers,
+                       uint16_t window_size, const uint16_t num_diffs, double *score,
+                       bool write_heatmaps, int width, int height, int frame) {
     double scores_per_scale[NUM_SCALES];
     VmafPicture *image = &pics[0];
     VmafPicture *mask = &pics[1];
+    ptrdiff_t stride = image->stride[0] >> 1;
 
     int scaled_width = width;
     int scaled_height = height;
 
-    get_spatial_mask(image, mask, buffers.mask_dp, buffers.derivative_buffer, width, height, derivative_callback);
+    get_spatial_mask(image, mask, buffers.mask_dp, buffers.derivative_buffer, width, height,
+                     s->derivative_callback, s->spatial_mask_row_callback);
     for (unsigned scale = 0; scale < NUM_SCALES; scale++) {
         if (scale > 0) {
             scaled_width = (scaled_width + 1) >> 1;
             scaled_height = (scaled_height + 1) >> 1;
-            decimate(image, scaled_width, scaled_height);
-            decimate(mask, scaled_width, scaled_height);
+            s->decimate_callback(image->data[0], scaled_width, scaled_height, stride);
+            s->decimate_callback(mask->data[0], scaled_width, scaled_height, stride);
         }
 
-        filter_mode(image, scaled_width, scaled_height, buffers.filter_mode_buffer);
+        s->filter_mode_callback(image->data[0], scaled_width, scaled_height, stride, buffers.filter_mode_buffer);
 
-        calculate_c_values(image, mask, buffers.c_values, buffers.c_values_histograms, window_size,
-                           num_diffs, tvi_for_diff, buffers.diff_weights, buffers.all_diffs, scaled_width, scaled_height,
-                           inc_range_callback, dec_range_callback);
+        if (s->thread_pool) {
+            int err = calculate_c_values_threaded(s, image, mask, &buffers, window_size, num_diffs,
+                                                  scaled_width, scaled_height);
+            if (err) return err;
+        } else {
+            calculate_c_values(image, mask, buffers.c_values, buffers.c_values_histograms, window_size,
+                               num_diffs, buffers.tvi_for_diff, buffers.diff_weights, buffers.all_diffs,
+                               scaled_width, scaled_height, s->inc_range_callback, s->dec_range_callback,
+                               s->c_values_row_callback);
+        }
 
         if (write_heatmaps) {
-            int err = dump_c_values(heatmaps_files, buffers.c_values, scaled_width, scaled_height, scale, window_size,
-                                    num_diffs, buffers.diff_weights, frame);
+            int err = dump_c_values(s->heatmaps_files, buffers.c_values, scaled_width, scaled_height,
+                                    scale, window_size, num_diffs, buffers.diff_weights, frame);
             if (err) return err;
         }
 
         scores_per_scale[scale] =
-            spatial_pooling(buffers.c_values, topk, scaled_width, scaled_height);
+            spatial_pooling(buffers.c_values, s->topk, scaled_width, scaled_height,
+                            s->topk_callback, buffers.topk_buffer);
     }
 
     uint16_t pixels_in_window = get_pixels_in_window(window_size);
@@ -1138,12 +1313,18 @@ static int preprocess_and_extract_cambi(CambiState *s, VmafPicture *pic, double
     int window_size = is_src ? s->src_window_size : s->window_size;
     int num_diffs = 1 << s->max_log_contrast;
 
-    int err = cambi_preprocessing(pic, &s->pics[0], width, height, s->enc_bitdepth);
+    // The source pipeline has its own working set when it runs concurrently.
+    const bool own_buffers = is_src && s->src_buffers.c_values;
+    VmafPicture *pics = own_buffers ? s->src_pics : s->pics;
+    CambiBuffers buffers = own_buffers ? s->src_buffers : s->buffers;
+
+    int err = cambi_preprocessing(pic, &pics[0], width, height, s->enc_bitdepth,
+                                  s->anti_dithering_callback);
     if (err) return err;
 
     bool write_heatmaps = s->heatmaps_path && !is_src;
-    err = cambi_score(s->pics, window_size, s->topk, num_diffs, s->buffers.tvi_for_diff,
-                      s->buffers, s->inc_range_callback, s->dec_range_callback, s->derivative_callback, score, write_heatmaps, s->heatmaps_files, width, height, frame);
+    err = cambi_score(s, pics, buffers, window_size, num_diffs, score,
+                      write_heatmaps, width, height, frame);
     if (err) return err;
 
     return 0;
@@ -1153,6 +1334,21 @@ static double combine_dist_src_scores(double dist_score, double src_score) {
     return MAX(0, dist_score - src_score);
 }
 
+typedef struct CambiPipelineJob {
+    CambiState *s;
+    VmafPicture *pic[2];
+    unsigned index;
+    double score[2];
+    int err[2];
+} CambiPipelineJob;
+
+// idx 0 runs the distorted pipeline, idx 1 the source pipeline.
+static void cambi_pipeline_job(void *data, unsigned idx) {
+    CambiPipelineJob *job = data;
+    job->err[idx] = preprocess_and_extract_cambi(job->s, job->pic[idx], &job->score[idx],
+                                                 idx == 1, job->index);
+}
+
 static int extract(VmafFeatureExtractor *fex,
                    VmafPicture *ref_pic, VmafPicture *ref_pic_90,
                    VmafPicture *dist_pic, VmafPicture *dist_pic_90,
@@ -1161,17 +1357,34 @@ static int extract(VmafFeatureExtractor *fex,
     (void)dist_pic_90;
 
     CambiState *s = fex->priv;
-    double dist_score;
-    int err = preprocess_and_extract_cambi(s, dist_pic, &dist_score, false, index);
-    if (err) return err;
+    double dist_score, src_score;
+    int err;
+
+    if (s->full_ref && s->src_buffers.c_values) {
+        CambiPipelineJob job = {
+            .s = s,
+            .pic = { dist_pic, ref_pic },
+            .index = index,
+        };
+        err = vmaf_thread_pool_parallel_for(s->thread_pool, 2, cambi_pipeline_job, &job);
+        if (err) return err;
+        if (job.err[0]) return job.err[0];
+        if (job.err[1]) return job.err[1];
+        dist_score = job.score[0];
+        src_score = job.score[1];
+    } else {
+        err = preprocess_and_extract_cambi(s, dist_pic, &dist_score, false, index);
+        if (err) return err;
+        if (s->full_ref) {
+            err = preprocess_and_extract_cambi(s, ref_pic, &src_score, true, index);
+            if (err) return err;
+        }
+    }
 
     err = vmaf_feature_collector_append(feature_collector, "cambi", dist_score, index);
     if (err) return err;
 
     if (s->full_ref) {
-        double src_score;
-        int err = preprocess_and_extract_cambi(s, ref_pic, &src_score, true, index);
-        if (err) return err;
 
         err = vmaf_feature_collector_append(feature_collector, "cambi_source", src_score, index);
         if (err) return err;
@@ -1187,19 +1400,14 @@ static int extract(VmafFeatureExtractor *fex,
 static int close_cambi(VmafFeatureExtractor *fex) {
     CambiState *s = fex->priv;
 
-    int err = 0;
-    for (unsigned i = 0; i < PICS_BUFFER_SIZE; i++)
-        err |= vmaf_picture_unref(&s->pics[i]);
+    int err = free_working_buffers(s->pics, &s->buffers, fex->arena);
+    if (s->thread_pool && s->full_ref)
+        err |= free_working_buffers(s->src_pics, &s->src_buffers, fex->arena);
 
     aligned_free(s->buffers.tvi_for_diff);
-    aligned_free(s->buffers.c_values);
-    aligned_free(s->buffers.c_values_histograms);
-    aligned_free(s->buffers.mask_dp);
-    aligned_free(s->buffers.filter_mode_buffer);
     aligned_free(s->buffers.diffs_to_consider);
     aligned_free(s->buffers.diff_weights);
     aligned_free(s->buffers.all_diffs);
-    aligned_free(s->buffers.derivative_buffer);
 
     if (s->heatmaps_path) {
         for (int scale = 0; scale < NUM_SCALES; scale++) {
@@ -1221,6 +1429,7 @@ VmafFeatureExtractor vmaf_fex_cambi = {
     .extract = extract,
     .options = options,
     .close = close_cambi,
+    .scratch_size = scratch_size,
     .priv_size = sizeof(CambiState),
     .provided_features = provided_features,
 };
@@ -17,10 +17,8 @@
  */
 
 #include "alignment.h"
-#include "config.h"
 #include "convolution.h"
 #include "convolution_internal.h"
-#include "cpu.h"
 
 extern int vmaf_floorn(int, int);
 extern int vmaf_ceiln(int, int);
@@ -79,19 +77,6 @@ void convolution_y_c_s(const float *filter, int filter_width, const float *src,
 
 void convolution_f32_c_s(const float *filter, int filter_width, const float *src, float *dst, float *tmp, int width, int height, int src_stride, int dst_stride)
 {
-    /* if support avx */
-
-#if ARCH_X86
-    const unsigned flags = vmaf_get_cpu_flags();
-    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
-        convolution_f32_avx_s(filter, filter_width, src, dst, tmp, width,
-                              height, src_stride, dst_stride);
-        return;
-    }
-#endif
-
-    /* fall back */
-
 	// convolve along y first then x
 	convolution_y_c_s(filter, filter_width, src, tmp, width, height, src_stride, dst_stride, 1);
 	convolution_x_c_s(filter, filter_width, tmp, dst, width, height, src_stride, dst_stride, 1);
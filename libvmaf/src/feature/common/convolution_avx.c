@@ -798,7 +798,9 @@ void convolution_f32_avx_s_1d(
 	int tmp_stride = vmaf_ceiln(width, 8);
 
 	int i_vec_end = height - radius;
-	int j_vec_end = width_mod8 - vmaf_ceiln(radius + 1, 8);
+	// the horizontal scanline reads 2 * radius past its last output
+	int j_vec_end = width_mod8 - vmaf_ceiln(2 * radius, 8);
+	if (j_vec_end < 0) j_vec_end = 0;
 
 	// Vertical pass.
 	for (int i = 0; i < radius; ++i) {
@@ -1549,7 +1551,9 @@ void convolution_f32_avx_s_1d_sq(
 	int tmp_stride = vmaf_ceiln(width, 8);
 
 	int i_vec_end = height - radius;
-	int j_vec_end = width_mod8 - vmaf_ceiln(radius + 1, 8);
+	// the horizontal scanline reads 2 * radius past its last output
+	int j_vec_end = width_mod8 - vmaf_ceiln(2 * radius, 8);
+	if (j_vec_end < 0) j_vec_end = 0;
 
 	// Vertical pass.
 	for (int i = 0; i < radius; ++i) {
@@ -2377,7 +2381,9 @@ void convolution_f32_avx_s_1d_xy(
 	int tmp_stride = vmaf_ceiln(width, 8);
 
 	int i_vec_end = height - radius;
-	int j_vec_end = width_mod8 - vmaf_ceiln(radius + 1, 8);
+	// the horizontal scanline reads 2 * radius past its last output
+	int j_vec_end = width_mod8 - vmaf_ceiln(2 * radius, 8);
+	if (j_vec_end < 0) j_vec_end = 0;
 
 	// Vertical pass.
 	for (int i = 0; i < radius; ++i) {
@@ -0,0 +1,279 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <arm_neon.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "alignment.h"
+#include "convolution.h"
+#include "convolution_internal.h"
+
+/*
+ * NEON port of convolution_avx.c. The vectorized region of the frame and
+ * the order of the float operations per output pixel are the same as in the
+ * AVX kernels (taps in blocks of 9, four partial sums per block, ascending
+ * for the 5/9/17-tap kernels and descending for the generic one), so the
+ * output is bit-identical to the x86 AVX2 path for every filter width. This
+ * file must be compiled with -ffp-contract=off, otherwise the multiply-add
+ * pairs are fused. The vectorized widths are multiples of 8, so no tail
+ * handling is needed.
+ */
+
+enum { CONV_PLAIN, CONV_SQ, CONV_XY };
+
+static FORCE_INLINE float32x4_t conv_tap(int kind, float32x4_t f,
+                                         const float *src1, const float *src2)
+{
+	float32x4_t g = vld1q_f32(src1);
+
+	if (kind == CONV_SQ)
+		g = vmulq_f32(g, g);
+	else if (kind == CONV_XY)
+		g = vmulq_f32(g, vld1q_f32(src2));
+
+	return vmulq_f32(f, g);
+}
+
+/*
+ * Sum of taps [x, x + n) for 4 output pixels. The taps are read at
+ * src + k * step, step is 1 in the horizontal pass and the stride in the
+ * vertical pass.
+ */
+static FORCE_INLINE float32x4_t conv_block(int kind, bool specialized, int n,
+                                           const float32x4_t *f, const float *src1,
+                                           const float *src2, ptrdiff_t step1,
+                                           ptrdiff_t step2)
+{
+#define TAP(k) conv_tap(kind, f[k], src1 + (k) * step1, src2 + (k) * step2)
+	float32x4_t sum0, sum1, sum2, sum3;
+
+	if (specialized) {
+		sum0 = TAP(0);
+		sum1 = TAP(1);
+		sum2 = TAP(2);
+		sum3 = TAP(3);
+		if (n > 4) sum0 = vaddq_f32(sum0, TAP(4));
+		if (n > 5) sum1 = vaddq_f32(sum1, TAP(5));
+		if (n > 6) sum2 = vaddq_f32(sum2, TAP(6));
+		if (n > 7) sum3 = vaddq_f32(sum3, TAP(7));
+		if (n > 8) sum0 = vaddq_f32(sum0, TAP(8));
+	} else {
+		sum0 = sum1 = sum2 = sum3 = vdupq_n_f32(0.f);
+		if (n > 8) sum0 = TAP(8);
+		if (n > 7) sum3 = TAP(7);
+		if (n > 6) sum2 = TAP(6);
+		if (n > 5) sum1 = TAP(5);
+		if (n > 4) sum0 = vaddq_f32(sum0, TAP(4));
+		if (n > 3) sum3 = vaddq_f32(sum3, TAP(3));
+		if (n > 2) sum2 = vaddq_f32(sum2, TAP(2));
+		if (n > 1) sum1 = vaddq_f32(sum1, TAP(1));
+		sum0 = vaddq_f32(sum0, TAP(0));
+	}
+#undef TAP
+
+	sum0 = vaddq_f32(sum0, sum2);
+	sum1 = vaddq_f32(sum1, sum3);
+	return vaddq_f32(sum0, sum1);
+}
+
+static FORCE_INLINE void conv_store(int kind, bool horizontal, bool specialized,
+                                    int x, int n, const float32x4_t *f,
+                                    const float *src1, const float *src2,
+                                    float *dst, ptrdiff_t step1, ptrdiff_t step2)
+{
+	float32x4_t accum = conv_block(kind, specialized, n, f, src1, src2, step1, step2);
+
+	if (!specialized || (horizontal && !x))
+		accum = vaddq_f32(vdupq_n_f32(0.f), accum);
+	if (x)
+		accum = vaddq_f32(vld1q_f32(dst), accum);
+
+	vst1q_f32(dst, accum);
+}
+
+static FORCE_INLINE void conv_chunk(int kind, bool horizontal, bool specialized,
+                                    int x, int n, const float * RESTRICT filter,
+                                    const float * RESTRICT src1, const float * RESTRICT src2,
+                                    float * RESTRICT dst, int src1_stride, int src2_stride,
+                                    int j_end)
+{
+	const ptrdiff_t step1 = horizontal ? 1 : src1_stride;
+	const ptrdiff_t step2 = horizontal ? 1 : src2_stride;
+	float32x4_t f[9];
+
+	for (int k = 0; k < 9; k++)
+		f[k] = k < n ? vdupq_n_f32(filter[x + k]) : vdupq_n_f32(0.f);
+
+	src1 += x * step1;
+	src2 += x * step2;
+
+	for (int j = 0; j < j_end; j += 4)
+		conv_store(kind, horizontal, specialized, x, n, f, src1 + j, src2 + j, dst + j, step1, step2);
+}
+
+static FORCE_INLINE void conv_scanline(int kind, bool horizontal, int N,
+                                       const float * RESTRICT filter, int filter_width,
+                                       const float * RESTRICT src1, const float * RESTRICT src2,
+                                       float * RESTRICT dst, int src1_stride, int src2_stride,
+                                       int j_end)
+{
+	if (horizontal) {
+		dst += filter_width / 2;
+	} else {
+		src1 -= filter_width / 2 * src1_stride;
+		src2 -= filter_width / 2 * src2_stride;
+	}
+
+	switch (N) {
+	case 5:
+		conv_chunk(kind, horizontal, true, 0, 5, filter, src1, src2, dst, src1_stride, src2_stride, j_end);
+		break;
+	case 9:
+		conv_chunk(kind, horizontal, true, 0, 9, filter, src1, src2, dst, src1_stride, src2_stride, j_end);
+		break;
+	case 17:
+		conv_chunk(kind, horizontal, true, 0, 9, filter, src1, src2, dst, src1_stride, src2_stride, j_end);
+		conv_chunk(kind, horizontal, true, 9, 8, filter, src1, src2, dst, src1_stride, src2_stride, j_end);
+		break;
+	default:
+		for (int x = 0; x < filter_width; x += 9) {
+			const int n = filter_width - x < 9 ? filter_width - x : 9;
+			conv_chunk(kind, horizontal, false, x, n, filter, src1, src2, dst, src1_stride, src2_stride, j_end);
+		}
+		break;
+	}
+}
+
+static FORCE_INLINE float conv_edge(int kind, bool horizontal, const float *filter,
+                                    int filter_width, const float *src1,
+                                    const float *src2, int width, int height,
+                                    int stride1, int stride2, int i, int j)
+{
+	if (kind == CONV_SQ)
+		return convolution_edge_sq_s(horizontal, filter, filter_width, src1, width, height, stride1, i, j);
+	if (kind == CONV_XY)
+		return convolution_edge_xy_s(horizontal, filter, filter_width, src1, src2, width, height, stride1, stride2, i, j);
+	return convolution_edge_s(horizontal, filter, filter_width, src1, width, height, stride1, i, j);
+}
+
+static FORCE_INLINE void convolution_f32_neon_s_1d(int kind, int N,
+                                                     const float * RESTRICT filter,
+                                                     int filter_width,
+                                                     const float * RESTRICT src1,
+                                                     const float * RESTRICT src2,
+                                                     float * RESTRICT dst,
+                                                     float * RESTRICT tmp,
+                                                     int width, int height,
+                                                     int src1_stride, int src2_stride,
+                                                     int dst_stride)
+{
+	int radius = filter_width / 2;
+	int width_mod8 = vmaf_floorn(width, 8);
+	int tmp_stride = vmaf_ceiln(width, 8);
+
+	int i_vec_end = height - radius;
+	// the horizontal scanline reads 2 * radius past its last output
+	int j_vec_end = width_mod8 - vmaf_ceiln(2 * radius, 8);
+	if (j_vec_end < 0) j_vec_end = 0;
+
+	// Vertical pass.
+	for (int i = 0; i < radius; ++i) {
+		for (int j = 0; j < width; ++j) {
+			tmp[i * tmp_stride + j] = conv_edge(kind, false, filter, filter_width, src1, src2, width, height, src1_stride, src2_stride, i, j);
+		}
+	}
+	for (int i = radius; i < i_vec_end; ++i) {
+		conv_scanline(kind, false, N, filter, filter_width, src1 + i * src1_stride, src2 + i * src2_stride, tmp + i * tmp_stride, src1_stride, src2_stride, width_mod8);
+
+		for (int j = width_mod8; j < width; ++j) {
+			tmp[i * tmp_stride + j] = conv_edge(kind, false, filter, filter_width, src1, src2, width, height, src1_stride, src2_stride, i, j);
+		}
+	}
+	for (int i = i_vec_end; i < height; ++i) {
+		for (int j = 0; j < width; ++j) {
+			tmp[i * tmp_stride + j] = conv_edge(kind, false, filter, filter_width, src1, src2, width, height, src1_stride, src2_stride, i, j);
+		}
+	}
+
+	// Horizontal pass.
+	for (int i = 0; i < height; ++i) {
+		for (int j = 0; j < radius; ++j) {
+			dst[i * dst_stride + j] = convolution_edge_s(true, filter, filter_width, tmp, width, height, tmp_stride, i, j);
+		}
+
+		conv_scanline(CONV_PLAIN, true, N, filter, filter_width, tmp + i * tmp_stride, tmp + i * tmp_stride, dst + i * dst_stride, tmp_stride, tmp_stride, j_vec_end);
+
+		for (int j = j_vec_end + radius; j < width; ++j) {
+			dst[i * dst_stride + j] = convolution_edge_s(true, filter, filter_width, tmp, width, height, tmp_stride, i, j);
+		}
+	}
+}
+
+void convolution_f32_neon_s(const float *filter, int filter_width, const float *src, float *dst, float *tmp, int width, int height, int src_stride, int dst_stride)
+{
+	switch (filter_width) {
+	case 17:
+		convolution_f32_neon_s_1d(CONV_PLAIN, 17, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	case 9:
+		convolution_f32_neon_s_1d(CONV_PLAIN, 9, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	case 5:
+		convolution_f32_neon_s_1d(CONV_PLAIN, 5, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	default:
+		convolution_f32_neon_s_1d(CONV_PLAIN, 0, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	}
+}
+
+void convolution_f32_neon_sq_s(const float *filter, int filter_width, const float *src, float *dst, float *tmp, int width, int height, int src_stride, int dst_stride)
+{
+	switch (filter_width) {
+	case 17:
+		convolution_f32_neon_s_1d(CONV_SQ, 17, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	case 9:
+		convolution_f32_neon_s_1d(CONV_SQ, 9, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	case 5:
+		convolution_f32_neon_s_1d(CONV_SQ, 5, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	default:
+		convolution_f32_neon_s_1d(CONV_SQ, 0, filter, filter_width, src, src, dst, tmp, width, height, src_stride, src_stride, dst_stride);
+		break;
+	}
+}
+
+void convolution_f32_neon_xy_s(const float *filter, int filter_width, const float *src1, const float *src2, float *dst, float *tmp, int width, int height, int src1_stride, int src2_stride, int dst_stride)
+{
+	switch (filter_width) {
+	case 17:
+		convolution_f32_neon_s_1d(CONV_XY, 17, filter, filter_width, src1, src2, dst, tmp, width, height, src1_stride, src2_stride, dst_stride);
+		break;
+	case 9:
+		convolution_f32_neon_s_1d(CONV_XY, 9, filter, filter_width, src1, src2, dst, tmp, width, height, src1_stride, src2_stride, dst_stride);
+		break;
+	case 5:
+		convolution_f32_neon_s_1d(CONV_XY, 5, filter, filter_width, src1, src2, dst, tmp, width, height, src1_stride, src2_stride, dst_stride);
+		break;
+	default:
+		convolution_f32_neon_s_1d(CONV_XY, 0, filter, filter_width, src1, src2, dst, tmp, width, height, src1_stride, src2_stride, dst_stride);
+		break;
+	}
+}
@@ -17,6 +17,7 @@
  */
 
 #include <errno.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -29,8 +30,26 @@
 #include "feature_name.h"
 #include "libvmaf/libvmaf.h"
 #include "log.h"
+#include "perf.h"
 #include "predict.h"
 
+static void collector_lock(VmafFeatureCollector *fc)
+{
+#if VMAF_PERF_STATS
+    if (fc->perf) {
+        if (pthread_mutex_trylock(&(fc->lock))) {
+            const uint64_t t = vmaf_perf_wall_ns();
+            pthread_mutex_lock(&(fc->lock));
+            fc->lock_stats.contended++;
+            fc->lock_stats.wait_ns += vmaf_perf_wall_ns() - t;
+        }
+        fc->lock_stats.acquired++;
+        return;
+    }
+#endif
+    pthread_mutex_lock(&(fc->lock));
+}
+
 static int aggregate_vector_init(AggregateVector *aggregate_vector)
 {
     if (!aggregate_vector) return -EINVAL;
@@ -101,7 +120,7 @@ int vmaf_feature_collector_set_aggregate(VmafFeatureCollector *feature_collector
     if (!feature_collector) return -EINVAL;
     if (!feature_name) return -EINVAL;
 
-    pthread_mutex_lock(&(feature_collector->lock));
+    collector_lock(feature_collector);
     int err = aggregate_vector_append(&feature_collector->aggregate_vector,
                                       feature_name, score);
     pthread_mutex_unlock(&(feature_collector->lock));
@@ -116,7 +135,7 @@ int vmaf_feature_collector_get_aggregate(VmafFeatureCollector *feature_collector
     if (!feature_name) return -EINVAL;
     if (!score) return -EINVAL;
 
-    pthread_mutex_lock(&(feature_collector->lock));
+    collector_lock(feature_collector);
     int err = 0;
 
     double *s = NULL;
@@ -171,9 +190,66 @@ static void feature_vector_destroy(FeatureVector *feature_vector)
     if (!feature_vector) return;
     free(feature_vector->name);
     free(feature_vector->score);
+    free(feature_vector->dependent);
     free(feature_vector);
 }
 
+static bool model_reads(const VmafPredictModel *m, const char *feature_name)
+{
+    for (unsigned i = 0; i < m->n_features; i++) {
+        if (!strcmp(m->feature[i], feature_name))
+            return true;
+    }
+    return false;
+}
+
+static int add_dependent(FeatureVector *feature_vector, VmafPredictModel *m)
+{
+    const size_t sz = sizeof(*feature_vector->dependent) *
+                      (feature_vector->n_dependents + 1);
+    VmafPredictModel **dependent = realloc(feature_vector->dependent, sz);
+    if (!dependent) return -ENOMEM;
+    dependent[feature_vector->n_dependents++] = m;
+    feature_vector->dependent = dependent;
+    return 0;
+}
+
+static void remove_dependent(FeatureVector *feature_vector, VmafPredictModel *m)
+{
+    for (unsigned i = 0; i < feature_vector->n_dependents; i++) {
+        if (feature_vector->dependent[i] != m) continue;
+        feature_vector->dependent[i] =
+            feature_vector->dependent[--feature_vector->n_dependents];
+        return;
+    }
+}
+
+static int count_arrival(VmafPredictModel *m, unsigned index, bool *complete)
+{
+    if (index >= m->capacity) {
+        unsigned capacity = m->capacity ? m->capacity : 256;
+        while (index >= capacity) capacity *= 2;
+        unsigned *arrived = realloc(m->arrived, sizeof(*arrived) * capacity);
+        if (!arrived) return -ENOMEM;
+        memset(arrived + m->capacity, 0,
+               sizeof(*arrived) * (capacity - m->capacity));
+        m->arrived = arrived;
+        m->capacity = capacity;
+    }
+
+    *complete = ++m->arrived[index] == m->n_features;
+    return 0;
+}
+
+static void predict_model_free(VmafPredictModel *m)
+{
+    for (unsigned i = 0; i < m->n_features; i++)
+        free(m->feature[i]);
+    free(m->feature);
+    free(m->arrived);
+    free(m);
+}
+
 static int feature_vector_append(FeatureVector *feature_vector,
                                  unsigned index, double score)
 {
@@ -240,29 +316,64 @@ int vmaf_feature_collector_mount_model(VmafFeatureCollector *feature_collector,
     if (!feature_collector) return -EINVAL;
     if (!model) return -EINVAL;
 
+    int err = 0;
     VmafPredictModel *m = malloc(sizeof(VmafPredictModel));
     if (!m) return -ENOMEM;
+    memset(m, 0, sizeof(*m));
     m->model = model;
-    m->next = NULL;
+    m->feature = malloc(sizeof(*m->feature) * (model->n_features + 1));
+    if (!m->feature) {
+        err = -ENOMEM;
+        goto free_m;
+    }
+    for (unsigned i = 0; i < model->n_features; i++) {
+        char *name = vmaf_predict_feature_name(model, i);
+        if (!name) {
+            err = -EINVAL;
+            goto free_m;
+        }
+        if (model_reads(m, name))
+            free(name);
+        else
+            m->feature[m->n_features++] = name;
+    }
 
-    VmafPredictModel **head = &feature_collector->models;
-    while (*head && (*head)->next != NULL)
-        *head = (*head)->next;
+    collector_lock(feature_collector);
+
+    // count scores written before the model was mounted
+    for (unsigned i = 0; i < feature_collector->cnt; i++) {
+        FeatureVector *fv = feature_collector->feature_vector[i];
+        if (!model_reads(m, fv->name)) continue;
+        err = add_dependent(fv, m);
+        for (unsigned j = 0; !err && j < fv->capacity; j++) {
+            bool complete;
+            if (fv->score[j].written)
+                err = count_arrival(m, j, &complete);
+        }
+        if (err) {
+            for (unsigned k = 0; k <= i; k++)
+                remove_dependent(feature_collector->feature_vector[k], m);
+            pthread_mutex_unlock(&(feature_collector->lock));
+            goto free_m;
+        }
+    }
 
-    if (!(*head))
-        *head = m;
-    else
-        (*head)->next = m;
+    VmafPredictModel **tail = &feature_collector->models;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = m;
 
+    pthread_mutex_unlock(&(feature_collector->lock));
     return 0;
+
+free_m:
+    predict_model_free(m);
+    return err;
 }
 
-int vmaf_feature_collector_unmount_model(VmafFeatureCollector *feature_collector,
-                                         VmafModel *model)
+static int unmount_model(VmafFeatureCollector *feature_collector,
+                         VmafModel *model)
 {
-    if (!feature_collector) return -EINVAL;
-    if (!model) return -EINVAL;
-
     VmafPredictModel **head = &feature_collector->models;
     while (*head && (*head)->model != model)
         head = &(*head)->next;
@@ -271,11 +382,25 @@ int vmaf_feature_collector_unmount_model(VmafFeatureCollector *feature_collector
 
     VmafPredictModel *m = *head;
     *head = m->next;
-    free(m);
+    for (unsigned i = 0; i < feature_collector->cnt; i++)
+        remove_dependent(feature_collector->feature_vector[i], m);
+    predict_model_free(m);
 
     return 0;
 }
 
+int vmaf_feature_collector_unmount_model(VmafFeatureCollector *feature_collector,
+                                         VmafModel *model)
+{
+    if (!feature_collector) return -EINVAL;
+    if (!model) return -EINVAL;
+
+    collector_lock(feature_collector);
+    int err = unmount_model(feature_collector, model);
+    pthread_mutex_unlock(&(feature_collector->lock));
+    return err;
+}
+
 int vmaf_feature_collector_register_metadata(VmafFeatureCollector *feature_collector,
                                              VmafMetadataConfiguration metadata_cfg)
 {
@@ -304,94 +429,256 @@ static FeatureVector *find_feature_vector(VmafFeatureCollector *fc,
     return feature_vector;
 }
 
-int vmaf_feature_collector_append(VmafFeatureCollector *feature_collector,
-                                  const char *feature_name, double score,
-                                  unsigned picture_index)
+static int find_or_add_feature_vector(VmafFeatureCollector *feature_collector,
+                                      const char *feature_name,
+                                      FeatureVector **feature_vector)
+{
+    *feature_vector = find_feature_vector(feature_collector, feature_name);
+    if (*feature_vector) return 0;
+
+    int err = feature_vector_init(feature_vector, feature_name);
+    if (err) return err;
+    for (VmafPredictModel *m = feature_collector->models; m; m = m->next) {
+        if (!model_reads(m, feature_name)) continue;
+        err = add_dependent(*feature_vector, m);
+        if (err) {
+            feature_vector_destroy(*feature_vector);
+            return err;
+        }
+    }
+    if (feature_collector->cnt + 1 > feature_collector->capacity) {
+        size_t initial_size = sizeof(feature_collector->feature_vector[0]) *
+            (*feature_vector)->capacity;
+        FeatureVector **fv =
+            realloc(feature_collector->feature_vector,
+            sizeof(*(feature_collector->feature_vector)) *
+            initial_size * 2);
+        if (!fv) {
+            feature_vector_destroy(*feature_vector);
+            return -ENOMEM;
+        }
+        memset(fv + feature_collector->capacity, 0, initial_size);
+        feature_collector->feature_vector = fv;
+        feature_collector->capacity *= 2;
+    }
+    feature_collector->feature_vector[feature_collector->cnt++]
+        = *feature_vector;
+    return 0;
+}
+
+static bool in_range(const VmafFeatureCollector *feature_collector,
+                     unsigned index)
+{
+    return !feature_collector->range.set ||
+           (index >= feature_collector->range.low &&
+            index <= feature_collector->range.high);
+}
+
+static int record_append(FeatureRecord *record, const char *feature_name,
+                         double score, unsigned picture_index)
+{
+    if (record->cnt == record->capacity) {
+        const unsigned capacity = record->capacity ? record->capacity * 2 : 8;
+        void *entry = realloc(record->entry, sizeof(*record->entry) * capacity);
+        if (!entry) return -ENOMEM;
+        record->entry = entry;
+        record->capacity = capacity;
+    }
+
+    char *name = strdup(feature_name);
+    if (!name) return -ENOMEM;
+    record->entry[record->cnt].name = name;
+    record->entry[record->cnt].value = score;
+    record->entry[record->cnt].index = picture_index;
+    record->cnt++;
+    return 0;
+}
+
+int vmaf_feature_collector_append_scores(VmafFeatureCollector *feature_collector,
+                                         const char *feature_name,
+                                         const double *score, unsigned index,
+                                         unsigned cnt)
 {
     if (!feature_collector) return -EINVAL;
     if (!feature_name) return -EINVAL;
+    if (!score && cnt) return -EINVAL;
+    if (cnt > UINT_MAX - index) return -EINVAL;
+
+    // metadata callbacks are per score, so they keep the per score path,
+    // as do partially dropped runs
+    if (feature_collector->record || feature_collector->range.set ||
+        (feature_collector->metadata && feature_collector->metadata->head))
+    {
+        for (unsigned i = 0; i < cnt; i++) {
+            int err = vmaf_feature_collector_append(feature_collector,
+                                                    feature_name, score[i],
+                                                    index + i);
+            if (err) return err;
+        }
+        return 0;
+    }
 
-    pthread_mutex_lock(&(feature_collector->lock));
+    collector_lock(feature_collector);
     int err = 0;
 
     if (!feature_collector->timer.begin)
         feature_collector->timer.begin = clock();
 
-    FeatureVector *feature_vector =
-        find_feature_vector(feature_collector, feature_name);
+    FeatureVector *feature_vector;
+    err = find_or_add_feature_vector(feature_collector, feature_name,
+                                     &feature_vector);
+    if (err) goto unlock;
 
-    if (!feature_vector) {
-        err = feature_vector_init(&feature_vector, feature_name);
-        if (err) goto unlock;
-        if (feature_collector->cnt + 1 > feature_collector->capacity) {
-            size_t initial_size = sizeof(feature_collector->feature_vector[0]) *
-                feature_vector->capacity;
-            FeatureVector **fv =
-                realloc(feature_collector->feature_vector,
-                sizeof(*(feature_collector->feature_vector)) *
-                initial_size * 2);
-            if (!fv) {
-                err = -ENOMEM;
-                goto unlock;
-            }
-            memset(fv + feature_collector->capacity, 0, initial_size);
-            feature_collector->feature_vector = fv;
-            feature_collector->capacity *= 2;
+    const unsigned end = index + cnt;
+    unsigned capacity = feature_vector->capacity;
+    while (end > capacity) capacity *= 2;
+    if (capacity > feature_vector->capacity) {
+        const size_t initial_size =
+            sizeof(feature_vector->score[0]) * feature_vector->capacity;
+        void *s = realloc(feature_vector->score,
+                          sizeof(feature_vector->score[0]) * capacity);
+        if (!s) {
+            err = -ENOMEM;
+            goto unlock;
         }
-        feature_collector->feature_vector[feature_collector->cnt++]
-            = feature_vector;
+        memset((char *) s + initial_size, 0,
+               sizeof(feature_vector->score[0]) * capacity - initial_size);
+        feature_vector->score = s;
+        feature_vector->capacity = capacity;
     }
 
-    err = feature_vector_append(feature_vector, picture_index, score);
-    if (err) goto unlock;
-
-    int res = 0;
-
-    VmafCallbackItem *metadata_iter = feature_collector->metadata ?
-                                      feature_collector->metadata->head : NULL;
-    while (metadata_iter) {
-        // Check current feature name is the same as the metadata feature name
-        if (!strcmp(metadata_iter->metadata_cfg.feature_name, feature_name)) {
-
-            // Call the callback function with the metadata feature name
-            VmafMetadata data = {
-                .feature_name = metadata_iter->metadata_cfg.feature_name,
-                .picture_index = picture_index,
-                .score = score,
-            };
-            metadata_iter->metadata_cfg.callback(metadata_iter->metadata_cfg.data, &data);
-            // Move to the next metadata
-            goto next_metadata;
+    for (unsigned i = index; i < end; i++) {
+        if (feature_vector->score[i].written) {
+            vmaf_log(VMAF_LOG_LEVEL_WARNING,
+                     "feature \"%s\" cannot be overwritten at index %d\n",
+                     feature_vector->name, i);
+            err = -EINVAL;
+            goto unlock;
         }
+    }
+    for (unsigned i = 0; i < cnt; i++) {
+        feature_vector->score[index + i].written = true;
+        feature_vector->score[index + i].value = score[i];
+    }
+    // without metadata callbacks, completed frames need no prediction
+    for (unsigned j = 0; j < feature_vector->n_dependents; j++) {
+        for (unsigned i = index; i < end; i++) {
+            bool complete;
+            err = count_arrival(feature_vector->dependent[j], i, &complete);
+            if (err) goto unlock;
+        }
+    }
 
-        VmafPredictModel *model_iter = feature_collector->models;
+unlock:
+    feature_collector->timer.end = clock();
+    pthread_mutex_unlock(&(feature_collector->lock));
+    return err;
+}
 
-        // If metadata feature name is not the same as the current feature feature_name
-        // Check if metadata feature name is the predicted feature
-        while (model_iter) {
-            VmafModel *model = model_iter->model;
+int vmaf_feature_record_replay(const FeatureRecord *record,
+                               VmafFeatureCollector *feature_collector)
+{
+    if (!record) return -EINVAL;
 
-            pthread_mutex_unlock(&(feature_collector->lock));
-            res = vmaf_feature_collector_get_score(feature_collector,
-                    model->name, &score, picture_index);
-            pthread_mutex_lock(&(feature_collector->lock));
-
-            if (res) {
-                pthread_mutex_unlock(&(feature_collector->lock));
-                res |= vmaf_predict_score_at_index(model, feature_collector,
-                        picture_index, &score, true, true, 0);
-                pthread_mutex_lock(&(feature_collector->lock));
-            }
-            model_iter = model_iter->next;
+    int err = 0;
+    for (unsigned i = 0; i < record->cnt; i++) {
+        err = vmaf_feature_collector_append(feature_collector,
+                                            record->entry[i].name,
+                                            record->entry[i].value,
+                                            record->entry[i].index);
+        if (err) return err;
+    }
+    return 0;
+}
+
+void vmaf_feature_record_free(FeatureRecord *record)
+{
+    if (!record) return;
+    for (unsigned i = 0; i < record->cnt; i++)
+        free(record->entry[i].name);
+    free(record->entry);
+    memset(record, 0, sizeof(*record));
+}
+
+int vmaf_feature_collector_append(VmafFeatureCollector *feature_collector,
+                                  const char *feature_name, double score,
+                                  unsigned picture_index)
+{
+    if (!feature_collector) return -EINVAL;
+    if (!feature_name) return -EINVAL;
+
+    if (feature_collector->record) {
+        return record_append(feature_collector->record, feature_name, score,
+                             picture_index);
+    }
+
+    if (!in_range(feature_collector, picture_index))
+        return 0;
+
+    VmafCallbackItem *metadata = feature_collector->metadata ?
+                                 feature_collector->metadata->head : NULL;
+    VmafPredictModel *ready_buf[8], **ready = ready_buf;
+    unsigned n_ready = 0;
+
+    collector_lock(feature_collector);
+    int err = 0;
+
+    if (!feature_collector->timer.begin)
+        feature_collector->timer.begin = clock();
+
+    FeatureVector *feature_vector;
+    err = find_or_add_feature_vector(feature_collector, feature_name,
+                                     &feature_vector);
+    if (err) goto unlock;
+
+    err = feature_vector_append(feature_vector, picture_index, score);
+    if (err) goto unlock;
+
+    if (feature_vector->n_dependents > 8) {
+        ready = malloc(sizeof(*ready) * feature_vector->n_dependents);
+        if (!ready) {
+            ready = ready_buf;
+            err = -ENOMEM;
+            goto unlock;
         }
+    }
 
-    next_metadata:
-        metadata_iter = metadata_iter->next;
+    // only the append which delivers a model's last feature for this
+    // frame sees it complete, so every prediction below happens once
+    for (unsigned i = 0; i < feature_vector->n_dependents; i++) {
+        VmafPredictModel *m = feature_vector->dependent[i];
+        bool complete;
+        err = count_arrival(m, picture_index, &complete);
+        if (err) goto unlock;
+        if (complete && metadata)
+            ready[n_ready++] = m;
     }
 
 unlock:
     feature_collector->timer.end = clock();
     pthread_mutex_unlock(&(feature_collector->lock));
+    if (err) goto free_ready;
+
+    for (VmafCallbackItem *m = metadata; m; m = m->next) {
+        if (strcmp(m->metadata_cfg.feature_name, feature_name)) continue;
+        VmafMetadata data = {
+            .feature_name = m->metadata_cfg.feature_name,
+            .picture_index = picture_index,
+            .score = score,
+        };
+        m->metadata_cfg.callback(m->metadata_cfg.data, &data);
+    }
+
+    // the prediction is appended in turn, which notifies its callbacks
+    for (unsigned i = 0; i < n_ready; i++) {
+        double prediction;
+        vmaf_predict_score_at_index(ready[i]->model, feature_collector,
+                                    picture_index, &prediction, true, true, 0);
+    }
+
+free_ready:
+    if (ready != ready_buf)
+        free(ready);
     return err;
 }
 
@@ -415,7 +702,7 @@ int vmaf_feature_collector_get_score(VmafFeatureCollector *feature_collector,
     if (!feature_name) return -EINVAL;
     if (!score) return -EINVAL;
 
-    pthread_mutex_lock(&(feature_collector->lock));
+    collector_lock(feature_collector);
     int err = 0;
 
     FeatureVector *feature_vector =
@@ -438,17 +725,37 @@ unlock:
     return err;
 }
 
+int vmaf_feature_collector_get_record(VmafFeatureCollector *feature_collector,
+                                      unsigned index, FeatureRecord *record)
+{
+    if (!feature_collector) return -EINVAL;
+    if (!record) return -EINVAL;
+
+    collector_lock(feature_collector);
+    int err = 0;
+
+    for (unsigned i = 0; i < feature_collector->cnt; i++) {
+        FeatureVector *fv = feature_collector->feature_vector[i];
+        if (index >= fv->capacity || !fv->score[index].written)
+            continue;
+        err = record_append(record, fv->name, fv->score[index].value, index);
+        if (err) break;
+    }
+
+    pthread_mutex_unlock(&(feature_collector->lock));
+    return err;
+}
+
 void vmaf_feature_collector_destroy(VmafFeatureCollector *feature_collector)
 {
     if (!feature_collector) return;
 
     pthread_mutex_lock(&(feature_collector->lock));
     aggregate_vector_destroy(&(feature_collector->aggregate_vector));
+    while (feature_collector->models)
+        unmount_model(feature_collector, feature_collector->models->model);
     for (unsigned i = 0; i < feature_collector->cnt; i++)
         feature_vector_destroy(feature_collector->feature_vector[i]);
-    while (feature_collector->models)
-        vmaf_feature_collector_unmount_model(feature_collector,
-                                             feature_collector->models->model);
     vmaf_metadata_destroy(feature_collector->metadata);
     free(feature_collector->feature_vector);
     pthread_mutex_unlock(&(feature_collector->lock));
@@ -26,6 +26,7 @@
 #include "dict.h"
 #include "model.h"
 #include "metadata_handler.h"
+#include "perf.h"
 
 typedef struct {
     char *name;
@@ -34,6 +35,8 @@ typedef struct {
         double value;
     } *score;
     unsigned capacity;
+    struct VmafPredictModel **dependent; ///< mounted models reading this feature
+    unsigned n_dependents;
 } FeatureVector;
 
 typedef struct {
@@ -44,8 +47,26 @@ typedef struct {
     unsigned cnt, capacity;
 } AggregateVector;
 
+typedef struct {
+    struct {
+        char *name;
+        double value;
+        unsigned index;
+    } *entry;
+    unsigned cnt, capacity;
+} FeatureRecord;
+
+/*
+ * A mounted model tracks, per frame, how many of its distinct input features
+ * have been written. The append which completes a frame predicts it, once,
+ * when metadata callbacks are registered.
+ */
 typedef struct VmafPredictModel {
     VmafModel *model;
+    char **feature; ///< distinct collector names of the model's features
+    unsigned n_features;
+    unsigned *arrived; ///< per index, how many of `feature` are written
+    unsigned capacity;
     struct VmafPredictModel *next;
 } VmafPredictModel;
 
@@ -57,16 +78,38 @@ typedef struct VmafFeatureCollector {
     unsigned cnt, capacity;
     struct { clock_t begin, end; } timer;
     pthread_mutex_t lock;
+    struct {
+        uint64_t acquired, contended, wait_ns;
+    } lock_stats; ///< Updated with `lock` held, only with perf stats.
+    VmafPerf *perf; ///< Extractor timing, set by framework. Optional.
+    struct VmafFeatureCache *cache; ///< Feature cache, set by framework. Optional.
+    FeatureRecord *record; ///< When set, appends only go here. Not locked.
+    struct {
+        bool set;
+        unsigned low, high;
+    } range; ///< When set, appends outside are dropped. Set by framework.
 } VmafFeatureCollector;
 
 int vmaf_feature_collector_init(VmafFeatureCollector **const feature_collector);
 
 int vmaf_feature_collector_mount_model(VmafFeatureCollector *feature_collector, VmafModel *model);
 
+int vmaf_feature_collector_unmount_model(VmafFeatureCollector *feature_collector,
+                                         VmafModel *model);
+
 int vmaf_feature_collector_append(VmafFeatureCollector *feature_collector,
                                   const char *feature_name, double score,
                                   unsigned index);
 
+/**
+ * Append `cnt` consecutive scores starting at `index` with a single lock
+ * and lookup. Nothing is written if any of them already exists.
+ */
+int vmaf_feature_collector_append_scores(VmafFeatureCollector *feature_collector,
+                                         const char *feature_name,
+                                         const double *score, unsigned index,
+                                         unsigned cnt);
+
 int vmaf_feature_collector_register_metadata(VmafFeatureCollector *feature_collector,
                                              VmafMetadataConfiguration metadata_cfg);
 
@@ -78,6 +121,13 @@ int vmaf_feature_collector_get_score(VmafFeatureCollector *feature_collector,
                                      const char *feature_name, double *score,
                                      unsigned index);
 
+/**
+ * Append every score written at `index` to `record`, in the order the
+ * features were first written.
+ */
+int vmaf_feature_collector_get_record(VmafFeatureCollector *feature_collector,
+                                      unsigned index, FeatureRecord *record);
+
 int vmaf_feature_collector_set_aggregate(VmafFeatureCollector *feature_collector,
                                          const char *feature_name,
                                          double score);
@@ -88,4 +138,9 @@ int vmaf_feature_collector_get_aggregate(VmafFeatureCollector *feature_collector
 
 void vmaf_feature_collector_destroy(VmafFeatureCollector *feature_collector);
 
+int vmaf_feature_record_replay(const FeatureRecord *record,
+                               VmafFeatureCollector *feature_collector);
+
+void vmaf_feature_record_free(FeatureRecord *record);
+
 #endif /* __VMAF_FEATURE_COLLECTOR_H__ */
@@ -22,9 +22,11 @@
 #include <stdlib.h>
 
 #include "config.h"
+#include "feature_cache.h"
 #include "feature_extractor.h"
 #include "feature_name.h"
 #include "log.h"
+#include "perf.h"
 #include "picture.h"
 
 #ifdef HAVE_NVTX
@@ -47,6 +49,7 @@ extern VmafFeatureExtractor vmaf_fex_psnr_hvs;
 extern VmafFeatureExtractor vmaf_fex_integer_adm;
 extern VmafFeatureExtractor vmaf_fex_integer_motion;
 extern VmafFeatureExtractor vmaf_fex_integer_vif;
+extern VmafFeatureExtractor vmaf_fex_integer_vmaf_core;
 extern VmafFeatureExtractor vmaf_fex_cambi;
 #if HAVE_CUDA
 extern VmafFeatureExtractor vmaf_fex_integer_adm_cuda;
@@ -72,6 +75,7 @@ static VmafFeatureExtractor *feature_extractor_list[] = {
     &vmaf_fex_integer_adm,
     &vmaf_fex_integer_motion,
     &vmaf_fex_integer_vif,
+    &vmaf_fex_integer_vmaf_core,
     &vmaf_fex_cambi,
 #if HAVE_CUDA
     &vmaf_fex_integer_adm_cuda,
@@ -95,6 +99,13 @@ VmafFeatureExtractor *vmaf_get_feature_extractor_by_name(const char *name)
     return NULL;
 }
 
+VmafFeatureExtractor *vmaf_get_feature_extractor_by_index(unsigned index)
+{
+    const unsigned cnt =
+        sizeof(feature_extractor_list) / sizeof(feature_extractor_list[0]) - 1;
+    return index < cnt ? feature_extractor_list[index] : NULL;
+}
+
 VmafFeatureExtractor *vmaf_get_feature_extractor_by_feature_name(const char *name,
         unsigned flags)
 {
@@ -137,6 +148,7 @@ int vmaf_feature_extractor_context_create(VmafFeatureExtractorContext **fex_ctx,
     if (!f) return -ENOMEM;
     memset(f, 0, sizeof(*f));
 
+    int err = -ENOMEM;
     VmafFeatureExtractor *x = malloc(sizeof(*x));
     if (!x) goto free_f;
     memcpy(x, fex, sizeof(*x));
@@ -151,17 +163,20 @@ int vmaf_feature_extractor_context_create(VmafFeatureExtractorContext **fex_ctx,
 
     f->opts_dict = opts_dict;
     if (f->fex->options && f->fex->priv) {
-        int err = vmaf_fex_ctx_parse_options(f);
-        if (err) return err;
+        // opts_dict stays with the caller on failure
+        err = vmaf_fex_ctx_parse_options(f);
+        if (err) goto free_priv;
     }
 
     return 0;
 
+free_priv:
+    free(f->fex->priv);
 free_x:
     free(x);
 free_f:
     free(f);
-    return -ENOMEM;
+    return err;
 }
 
 int vmaf_feature_extractor_context_init(VmafFeatureExtractorContext *fex_ctx,
@@ -210,19 +225,31 @@ int vmaf_feature_extractor_context_extract(VmafFeatureExtractorContext *fex_ctx,
         }
     }
 
+    const unsigned uncacheable =
+        VMAF_FEATURE_EXTRACTOR_TEMPORAL | VMAF_FEATURE_EXTRACTOR_CUDA;
+    if (vfc->cache && !(fex_ctx->fex->flags & uncacheable)) {
+        return vmaf_feature_cache_extract(vfc->cache, fex_ctx, ref, ref_90,
+                                          dist, dist_90, pic_index, vfc);
+    }
+
 #ifdef HAVE_NVTX
     nvtxRangePushA(fex_ctx->fex->name);
 #endif
 
     if (!fex_ctx->is_initialized) {
+        VMAF_PERF_BEGIN(vfc->perf, init_clk, VMAF_PERF_STAGE_INIT);
         int err =
             vmaf_feature_extractor_context_init(fex_ctx, ref->pix_fmt, ref->bpc,
                                                 ref->w[0], ref->h[0]);
+        VMAF_PERF_END(vfc->perf, init_clk, fex_ctx->fex->name,
+                      VMAF_PERF_STAGE_INIT);
         if (err) return err;
     }
 
+    VMAF_PERF_BEGIN(vfc->perf, clk, VMAF_PERF_STAGE_EXTRACT);
     int err = fex_ctx->fex->extract(fex_ctx->fex, ref, ref_90, dist, dist_90,
                                     pic_index, vfc);
+    VMAF_PERF_END(vfc->perf, clk, fex_ctx->fex->name, VMAF_PERF_STAGE_EXTRACT);
     if (err) {
         vmaf_log(VMAF_LOG_LEVEL_WARNING,
                  "problem with feature extractor \"%s\" at index %d\n",
@@ -244,8 +271,12 @@ int vmaf_feature_extractor_context_flush(VmafFeatureExtractorContext *fex_ctx,
     if (fex_ctx->is_closed) return 0;
 
     int err = 0;
-    if (fex_ctx->fex->flush)
+    if (fex_ctx->fex->flush) {
+        VMAF_PERF_BEGIN(vfc->perf, clk, VMAF_PERF_STAGE_FLUSH);
         while (!(err = fex_ctx->fex->flush(fex_ctx->fex, vfc)));
+        VMAF_PERF_END(vfc->perf, clk, fex_ctx->fex->name,
+                      VMAF_PERF_STAGE_FLUSH);
+    }
     return err < 0 ? err : 0;
 }
 
@@ -277,6 +308,20 @@ int vmaf_feature_extractor_context_destroy(VmafFeatureExtractorContext *fex_ctx)
     return 0;
 }
 
+bool vmaf_feature_extractor_context_has_flush_aggregate(
+    const VmafFeatureExtractorContext *fex_ctx)
+{
+    const VmafFeatureExtractor *fex = fex_ctx->fex;
+    if (!fex->options || !fex->priv) return false;
+
+    for (const VmafOption *opt = fex->options; opt->name; opt++) {
+        if (!(opt->flags & VMAF_OPT_FLAG_FLUSH_AGGREGATE)) continue;
+        if (*(const bool *) ((const char *) fex->priv + opt->offset))
+            return true;
+    }
+    return false;
+}
+
 int vmaf_fex_ctx_pool_create(VmafFeatureExtractorContextPool **pool,
                              unsigned n_threads)
 {
@@ -353,10 +398,60 @@ fail:
     return NULL;
 }
 
-int vmaf_fex_ctx_pool_aquire(VmafFeatureExtractorContextPool *pool,
-                             VmafFeatureExtractor *fex,
-                             VmafDictionary *opts_dict,
-                             VmafFeatureExtractorContext **fex_ctx)
+int vmaf_fex_ctx_pool_set_scratch_budget(VmafFeatureExtractorContextPool *pool,
+                                         size_t budget,
+                                         enum VmafPixelFormat pix_fmt,
+                                         unsigned bpc, unsigned w, unsigned h)
+{
+    if (!pool) return -EINVAL;
+
+    pthread_mutex_lock(&(pool->lock));
+    pool->scratch.budget = budget;
+    pool->scratch.pix_fmt = pix_fmt;
+    pool->scratch.bpc = bpc;
+    pool->scratch.w = w;
+    pool->scratch.h = h;
+    pthread_mutex_unlock(&(pool->lock));
+    return 0;
+}
+
+static int create_ctx(VmafFeatureExtractorContextPool *pool,
+                      struct fex_list_entry *entry, VmafFeatureExtractor *fex,
+                      VmafDictionary *opts_dict,
+                      VmafFeatureExtractorContext **fex_ctx)
+{
+    VmafDictionary *d = NULL;
+    if (opts_dict) {
+        int err = vmaf_dictionary_copy(&opts_dict, &d);
+        if (err) return err;
+    }
+    VmafFeatureExtractorContext *f;
+    int err = vmaf_feature_extractor_context_create(&f, entry->fex, d);
+    if (err) return err;
+    if (f->fex->flags & VMAF_FEATURE_FRAME_SYNC)
+        f->fex->framesync = (fex->framesync);
+    f->fex->thread_pool = fex->thread_pool;
+    f->fex->arena = fex->arena;
+    f->fex->kernel_tuning = fex->kernel_tuning;
+
+    if (f->fex->scratch_size && pool->scratch.w) {
+        entry->scratch =
+            f->fex->scratch_size(f->fex, pool->scratch.pix_fmt,
+                                 pool->scratch.bpc, pool->scratch.w,
+                                 pool->scratch.h);
+    }
+    pool->scratch.used += entry->scratch;
+    if (pool->scratch.used > pool->scratch.peak)
+        pool->scratch.peak = pool->scratch.used;
+
+    *fex_ctx = f;
+    return 0;
+}
+
+static int aquire(VmafFeatureExtractorContextPool *pool,
+                  VmafFeatureExtractor *fex, VmafDictionary *opts_dict,
+                  VmafFeatureExtractorContext **fex_ctx, bool create,
+                  bool wait)
 {
     if (!pool) return -EINVAL;
     if (!fex) return -EINVAL;
@@ -371,35 +466,73 @@ int vmaf_fex_ctx_pool_aquire(VmafFeatureExtractorContextPool *pool,
         goto unlock;
     }
 
-    while (atomic_load(&entry->capacity) == atomic_load(&entry->in_use))
-        pthread_cond_wait(&(entry->full), &(pool->lock));
+    for (;;) {
+        const int capacity = atomic_load(&entry->capacity);
+        int idle = -1, empty = -1;
+        for (int i = 0; i < capacity; i++) {
+            if (!entry->ctx_list[i].fex_ctx) {
+                if (empty < 0) empty = i;
+            } else if (!entry->ctx_list[i].in_use) {
+                idle = i;
+                break;
+            }
+        }
 
-    for (int i = 0; i < atomic_load(&entry->capacity); i++) {
-        VmafFeatureExtractorContext *f = entry->ctx_list[i].fex_ctx;
-        if (!f) {
-            VmafDictionary *d = NULL;
-            if (opts_dict) {
-                err = vmaf_dictionary_copy(&opts_dict, &d);
-                if (err) return err;
+        if (idle < 0 && empty >= 0 && create) {
+            // the first context is always created, further ones only while
+            // their scratch fits the budget
+            const bool fits = !pool->scratch.budget || !empty ||
+                pool->scratch.used + entry->scratch <= pool->scratch.budget;
+            if (fits) {
+                err = create_ctx(pool, entry, fex, opts_dict,
+                                 &entry->ctx_list[empty].fex_ctx);
+                if (err) goto unlock;
+                idle = empty;
             }
-            err = vmaf_feature_extractor_context_create(&f, entry->fex, d);
-            if (err) goto unlock;
-            if (f->fex->flags & VMAF_FEATURE_FRAME_SYNC)
-                f->fex->framesync = (fex->framesync);
         }
-        if (!entry->ctx_list[i].in_use) {
-            entry->ctx_list[i].fex_ctx = *fex_ctx = f;
-            entry->ctx_list[i].in_use = true;
-            break;
+
+        if (idle >= 0) {
+            *fex_ctx = entry->ctx_list[idle].fex_ctx;
+            entry->ctx_list[idle].in_use = true;
+            atomic_fetch_add(&entry->in_use, 1);
+            goto unlock;
+        }
+        if (!wait) {
+            err = -EAGAIN;
+            goto unlock;
         }
+        pthread_cond_wait(&(entry->full), &(pool->lock));
     }
-    atomic_fetch_add(&entry->in_use, 1);
 
 unlock:
     pthread_mutex_unlock(&(pool->lock));
     return err;
 }
 
+int vmaf_fex_ctx_pool_aquire(VmafFeatureExtractorContextPool *pool,
+                             VmafFeatureExtractor *fex,
+                             VmafDictionary *opts_dict,
+                             VmafFeatureExtractorContext **fex_ctx)
+{
+    return aquire(pool, fex, opts_dict, fex_ctx, true, true);
+}
+
+int vmaf_fex_ctx_pool_try_aquire(VmafFeatureExtractorContextPool *pool,
+                                 VmafFeatureExtractor *fex,
+                                 VmafDictionary *opts_dict,
+                                 VmafFeatureExtractorContext **fex_ctx)
+{
+    return aquire(pool, fex, opts_dict, fex_ctx, false, false);
+}
+
+int vmaf_fex_ctx_pool_aquire_nowait(VmafFeatureExtractorContextPool *pool,
+                                    VmafFeatureExtractor *fex,
+                                    VmafDictionary *opts_dict,
+                                    VmafFeatureExtractorContext **fex_ctx)
+{
+    return aquire(pool, fex, opts_dict, fex_ctx, true, false);
+}
+
 int vmaf_fex_ctx_pool_release(VmafFeatureExtractorContextPool *pool,
                               VmafFeatureExtractorContext *fex_ctx)
 {
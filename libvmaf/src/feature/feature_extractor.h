@@ -26,7 +26,10 @@
 #include "dict.h"
 #include "framesync.h"
 #include "feature_collector.h"
+#include "kernel.h"
+#include "mem.h"
 #include "opt.h"
+#include "thread_pool.h"
 
 #include "libvmaf/picture.h"
 
@@ -86,6 +89,20 @@ typedef struct VmafFeatureExtractor {
      * @param               fex self.
      */
     int (*close)(struct VmafFeatureExtractor *fex);
+    /**
+     * Scratch size callback. Optional, bytes allocated by `init` for
+     * pictures of these dimensions. Used to fit threaded contexts within
+     * `VmafConfiguration.scratch_budget`.
+     *
+     * @param     fex self, with options parsed but not yet initialized.
+     * @param pix_fmt VmafPixelFormat of all subsequent pictures.
+     * @param     bpc Bitdepth of all subsequent pictures.
+     * @param       w Width of all subsequent pictures.
+     * @param       h Height of all subsequent pictures.
+     */
+    size_t (*scratch_size)(struct VmafFeatureExtractor *fex,
+                           enum VmafPixelFormat pix_fmt, unsigned bpc,
+                           unsigned w, unsigned h);
     const VmafOption *options; ///< Optional initialization options.
     void *priv; ///< Custom data.
     size_t priv_size; ///< sizeof private data.
@@ -97,12 +114,19 @@ typedef struct VmafFeatureExtractor {
     #endif
 
     VmafFrameSyncContext *framesync;
+    VmafThreadPool *thread_pool; ///< Library thread pool, set by framework. NULL when running single-threaded.
+    VmafArena *arena; ///< Scratch arena, set by framework. NULL to allocate from the heap.
+    const VmafKernelTuning *kernel_tuning; ///< Autotuning settings, set by framework. NULL to use the default kernels.
 
 } VmafFeatureExtractor;
 
 VmafFeatureExtractor *vmaf_get_feature_extractor_by_name(const char *name);
 VmafFeatureExtractor *vmaf_get_feature_extractor_by_feature_name(const char *name,
                                                                  unsigned flags);
+/**
+ * Iterate over the built-in feature extractors, NULL past the last one.
+ */
+VmafFeatureExtractor *vmaf_get_feature_extractor_by_index(unsigned index);
 
 enum VmafFeatureExtractorContextFlags {
     VMAF_FEATURE_EXTRACTOR_CONTEXT_DO_NOT_OVERWRITE = 1 << 0,
@@ -137,6 +161,13 @@ int vmaf_feature_extractor_context_delete(VmafFeatureExtractorContext *fex_ctx);
 
 int vmaf_feature_extractor_context_destroy(VmafFeatureExtractorContext *fex_ctx);
 
+/**
+ * Whether `fex_ctx` writes aggregates at flush from state accumulated over
+ * every picture it read, see `VMAF_OPT_FLAG_FLUSH_AGGREGATE`.
+ */
+bool vmaf_feature_extractor_context_has_flush_aggregate(
+    const VmafFeatureExtractorContext *fex_ctx);
+
 typedef struct VmafFeatureExtractorContextPool {
     struct fex_list_entry {
         VmafFeatureExtractor *fex;
@@ -147,20 +178,55 @@ typedef struct VmafFeatureExtractorContextPool {
         } *ctx_list;
         atomic_int capacity, in_use;
         pthread_cond_t full;
+        size_t scratch; ///< per context, known once the first is created
     } *fex_list;
     unsigned cnt, capacity;
     pthread_mutex_t lock;
     unsigned n_threads;
+    struct {
+        size_t budget, used, peak;
+        enum VmafPixelFormat pix_fmt;
+        unsigned bpc, w, h;
+    } scratch;
 } VmafFeatureExtractorContextPool;
 
 int vmaf_fex_ctx_pool_create(VmafFeatureExtractorContextPool **pool,
                              unsigned n_threads);
 
+/**
+ * Limit the declared scratch of all contexts to `budget` bytes, 0 for no
+ * limit. Every extractor still gets one context, further contexts are only
+ * created while they fit. Picture parameters are needed to evaluate the
+ * `scratch_size` callbacks, call this before the first context is aquired.
+ */
+int vmaf_fex_ctx_pool_set_scratch_budget(VmafFeatureExtractorContextPool *pool,
+                                         size_t budget,
+                                         enum VmafPixelFormat pix_fmt,
+                                         unsigned bpc, unsigned w, unsigned h);
+
 int vmaf_fex_ctx_pool_aquire(VmafFeatureExtractorContextPool *pool,
                              VmafFeatureExtractor *fex,
                              VmafDictionary *opts_dict,
                              VmafFeatureExtractorContext **fex_ctx);
 
+/**
+ * Like `vmaf_fex_ctx_pool_aquire()`, but only hands out an idle context.
+ * Returns -EAGAIN instead of creating a context or waiting for one.
+ */
+int vmaf_fex_ctx_pool_try_aquire(VmafFeatureExtractorContextPool *pool,
+                                 VmafFeatureExtractor *fex,
+                                 VmafDictionary *opts_dict,
+                                 VmafFeatureExtractorContext **fex_ctx);
+
+/**
+ * Like `vmaf_fex_ctx_pool_aquire()`, creating a context within the scratch
+ * budget if none is idle, but returns -EAGAIN instead of waiting for one.
+ */
+int vmaf_fex_ctx_pool_aquire_nowait(VmafFeatureExtractorContextPool *pool,
+                                    VmafFeatureExtractor *fex,
+                                    VmafDictionary *opts_dict,
+                                    VmafFeatureExtractorContext **fex_ctx);
+
 int vmaf_fex_ctx_pool_release(VmafFeatureExtractorContextPool *pool,
                              VmafFeatureExtractorContext *fex_ctx);
 
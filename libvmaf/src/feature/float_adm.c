@@ -28,18 +28,29 @@
 
 #include "adm.h"
 #include "adm_options.h"
+#include "adm_tools.h"
+#include "config.h"
+#include "cpu.h"
+#include "kernel.h"
 #include "mem.h"
 #include "picture_copy.h"
 
+#if ARCH_X86
+#include "x86/float_adm_avx2.h"
+#if HAVE_AVX512
+#include "x86/float_adm_avx512.h"
+#endif
+#elif ARCH_AARCH64
+#include "arm64/float_adm_neon.h"
+#endif
+
 typedef struct AdmState {
-    size_t float_stride;
-    float *ref;
-    float *dist;
     bool debug;
     double adm_enhn_gain_limit;
     double adm_norm_view_dist;
     int adm_ref_display_height;
     int adm_csf_mode;
+    AdmFloatKernels kernels;
     VmafDictionary *feature_name_dict;
 } AdmState;
 
@@ -99,18 +110,33 @@ static const VmafOption options[] = {
     { 0 }
 };
 
+static const VmafKernel adm_kernel = {
+    .name = "float_adm",
+    .feature_extractor = "float_adm",
+    .variant = vmaf_kernel_variants_simd,
+};
+
 static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
                 unsigned bpc, unsigned w, unsigned h)
 {
-    (void)pix_fmt;
-    (void)bpc;
-
     AdmState *s = fex->priv;
-    s->float_stride = ALIGN_CEIL(w * sizeof(float));
-    s->ref = aligned_malloc(s->float_stride * h, 32);
-    if (!s->ref) goto fail;
-    s->dist = aligned_malloc(s->float_stride * h, 32);
-    if (!s->dist) goto fail;
+    memset(&s->kernels, 0, sizeof(s->kernels));
+    const unsigned flags =
+        vmaf_kernel_select(&adm_kernel, fex->kernel_tuning, pix_fmt, bpc, w,
+                           h)->cpu_flags;
+#if ARCH_X86
+    if (flags & VMAF_X86_CPU_FLAG_AVX2)
+        adm_float_kernels_avx2(&s->kernels);
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512)
+        adm_float_kernels_avx512(&s->kernels);
+#endif
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON)
+        adm_float_kernels_neon(&s->kernels);
+#else
+    (void)flags;
+#endif
 
     s->feature_name_dict =
         vmaf_feature_name_dict_from_provided_features(fex->provided_features,
@@ -120,8 +146,6 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     return 0;
 
 fail:
-    if (s->ref) aligned_free(s->ref);
-    if (s->dist) aligned_free(s->dist);
     vmaf_dictionary_free(&s->feature_name_dict);
     return -ENOMEM;
 }
@@ -137,17 +161,21 @@ static int extract(VmafFeatureExtractor *fex,
     (void) ref_pic_90;
     (void) dist_pic_90;
 
-    picture_copy(s->ref, s->float_stride, ref_pic, -128, ref_pic->bpc);
-    picture_copy(s->dist, s->float_stride, dist_pic, -128, dist_pic->bpc);
+    const float *ref, *dist;
+    ptrdiff_t ref_stride, dist_stride;
+    err = picture_copy_shared(ref_pic, -128, &ref, &ref_stride);
+    if (err) return err;
+    err = picture_copy_shared(dist_pic, -128, &dist, &dist_stride);
+    if (err) return err;
 
     double score, score_num, score_den;
     double scores[8];
-    err = compute_adm(s->ref, s->dist, ref_pic->w[0], ref_pic->h[0],
-                      s->float_stride, s->float_stride, &score, &score_num,
+    err = compute_adm(ref, dist, ref_pic->w[0], ref_pic->h[0],
+                      ref_stride, dist_stride, &score, &score_num,
                       &score_den, scores, ADM_BORDER_FACTOR,
                       s->adm_enhn_gain_limit,
                       s->adm_norm_view_dist, s->adm_ref_display_height,
-                      s->adm_csf_mode);
+                      s->adm_csf_mode, &s->kernels);
     if (err) return err;
 
     err |= vmaf_feature_collector_append_with_dict(feature_collector,
@@ -210,8 +238,6 @@ static int extract(VmafFeatureExtractor *fex,
 static int close(VmafFeatureExtractor *fex)
 {
     AdmState *s = fex->priv;
-    if (s->ref) aligned_free(s->ref);
-    if (s->dist) aligned_free(s->dist);
     vmaf_dictionary_free(&s->feature_name_dict);
     return 0;
 }
@@ -21,9 +21,12 @@
 #include <stddef.h>
 
 #include "common/convolution.h"
+#include "config.h"
+#include "cpu.h"
 #include "feature_collector.h"
 #include "feature_extractor.h"
 #include "feature_name.h"
+#include "kernel.h"
 #include "mem.h"
 #include "motion.h"
 #include "motion_tools.h"
@@ -32,9 +35,11 @@
 
 typedef struct MotionState {
     size_t float_stride;
-    float *ref;
     float *tmp;
     float *blur[3];
+    void (*convolution)(const float *filter, int filter_width,
+                        const float *src, float *dst, float *tmp,
+                        int width, int height, int src_stride, int dst_stride);
     unsigned index;
     double score;
     bool debug;
@@ -62,26 +67,46 @@ static const VmafOption options[] = {
     { 0 }
 };
 
+static const VmafKernel motion_kernel = {
+    .name = "float_motion",
+    .feature_extractor = "float_motion",
+    .variant = vmaf_kernel_variants_simd,
+};
+
 static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
                 unsigned bpc, unsigned w, unsigned h)
 {
-    (void)pix_fmt;
-    (void)bpc;
-
     MotionState *s = fex->priv;
 
     s->float_stride = ALIGN_CEIL(w * sizeof(float));
-    s->ref = aligned_malloc(s->float_stride * h, 32);
-    s->tmp = aligned_malloc(s->float_stride * h, 32);
-    s->blur[0] = aligned_malloc(s->float_stride * h, 32);
-    s->blur[1] = aligned_malloc(s->float_stride * h, 32);
-    s->blur[2] = aligned_malloc(s->float_stride * h, 32);
-    if (!s->ref || !s->tmp || !s->blur[0] || !s->blur[1] || !s->blur[2])
+    s->tmp = vmaf_arena_alloc(fex->arena, s->float_stride * h, 32);
+    s->blur[0] = vmaf_arena_alloc(fex->arena, s->float_stride * h, 32);
+    s->blur[1] = vmaf_arena_alloc(fex->arena, s->float_stride * h, 32);
+    s->blur[2] = vmaf_arena_alloc(fex->arena, s->float_stride * h, 32);
+    if (!s->tmp || !s->blur[0] || !s->blur[1] || !s->blur[2])
         goto fail;
     if (s->motion_force_zero)
         fex->flush = NULL;
     s->score = 0;
 
+    s->convolution = convolution_f32_c_s;
+    const unsigned flags =
+        vmaf_kernel_select(&motion_kernel, fex->kernel_tuning, pix_fmt, bpc, w,
+                           h)->cpu_flags;
+#if ARCH_X86
+    if (flags & VMAF_X86_CPU_FLAG_AVX2)
+        s->convolution = convolution_f32_avx_s;
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512)
+        s->convolution = convolution_f32_avx512_s;
+#endif
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON)
+        s->convolution = convolution_f32_neon_s;
+#else
+    (void)flags;
+#endif
+
     s->feature_name_dict =
         vmaf_feature_name_dict_from_provided_features(fex->provided_features,
                 fex->options, s);
@@ -90,11 +115,10 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     return 0;
 
 fail:
-    if (s->ref) aligned_free(s->ref);
-    if (s->blur[0]) aligned_free(s->blur[0]);
-    if (s->blur[1]) aligned_free(s->blur[1]);
-    if (s->blur[2]) aligned_free(s->blur[2]);
-    if (s->tmp) aligned_free(s->tmp);
+    if (s->blur[0]) vmaf_arena_free(fex->arena, s->blur[0]);
+    if (s->blur[1]) vmaf_arena_free(fex->arena, s->blur[1]);
+    if (s->blur[2]) vmaf_arena_free(fex->arena, s->blur[2]);
+    if (s->tmp) vmaf_arena_free(fex->arena, s->tmp);
     vmaf_dictionary_free(&s->feature_name_dict);
     return -ENOMEM;
 
@@ -146,11 +170,14 @@ static int extract(VmafFeatureExtractor *fex,
     unsigned blur_idx_1 = (index + 1) % 3;
     unsigned blur_idx_2 = (index + 2) % 3;
 
-    picture_copy(s->ref, s->float_stride, ref_pic, -128, ref_pic->bpc);
-    convolution_f32_c_s(FILTER_5_s, 5, s->ref, s->blur[blur_idx_0], s->tmp,
-                        ref_pic->w[0], ref_pic->h[0],
-                        s->float_stride / sizeof(float),
-                        s->float_stride / sizeof(float));
+    const float *ref;
+    ptrdiff_t ref_stride;
+    err = picture_copy_shared(ref_pic, -128, &ref, &ref_stride);
+    if (err) return err;
+    s->convolution(FILTER_5_s, 5, ref, s->blur[blur_idx_0], s->tmp,
+                   ref_pic->w[0], ref_pic->h[0],
+                   ref_stride / sizeof(float),
+                   s->float_stride / sizeof(float));
 
     if (index == 0) {
         err = vmaf_feature_collector_append(feature_collector,
@@ -199,11 +226,10 @@ static int close(VmafFeatureExtractor *fex)
 {
     MotionState *s = fex->priv;
 
-    if (s->ref) aligned_free(s->ref);
-    if (s->blur[0]) aligned_free(s->blur[0]);
-    if (s->blur[1]) aligned_free(s->blur[1]);
-    if (s->blur[2]) aligned_free(s->blur[2]);
-    if (s->tmp) aligned_free(s->tmp);
+    if (s->blur[0]) vmaf_arena_free(fex->arena, s->blur[0]);
+    if (s->blur[1]) vmaf_arena_free(fex->arena, s->blur[1]);
+    if (s->blur[2]) vmaf_arena_free(fex->arena, s->blur[2]);
+    if (s->tmp) vmaf_arena_free(fex->arena, s->tmp);
     vmaf_dictionary_free(&s->feature_name_dict);
     return 0;
 }
@@ -27,9 +27,6 @@
 #include "picture_copy.h"
 
 typedef struct PsnrState {
-    size_t float_stride;
-    float *ref;
-    float *dist;
     double peak;
     double psnr_max;
 } PsnrState;
@@ -38,13 +35,10 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
                 unsigned bpc, unsigned w, unsigned h)
 {
     (void)pix_fmt;
+    (void)w;
+    (void)h;
 
     PsnrState *s = fex->priv;
-    s->float_stride = ALIGN_CEIL(w * sizeof(float));
-    s->ref = aligned_malloc(s->float_stride * h, 32);
-    if (!s->ref) goto fail;
-    s->dist = aligned_malloc(s->float_stride * h, 32);
-    if (!s->dist) goto free_ref;
 
     if (bpc == 8) {
         s->peak = 255.0;
@@ -64,8 +58,6 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
 
     return 0;
 
-free_ref:
-    free(s->ref);
 fail:
     return -ENOMEM;
 }
@@ -81,12 +73,16 @@ static int extract(VmafFeatureExtractor *fex,
     (void) ref_pic_90;
     (void) dist_pic_90;
 
-    picture_copy(s->ref, s->float_stride, ref_pic, 0, ref_pic->bpc);
-    picture_copy(s->dist, s->float_stride, dist_pic, 0, dist_pic->bpc);
+    const float *ref, *dist;
+    ptrdiff_t ref_stride, dist_stride;
+    err = picture_copy_shared(ref_pic, 0, &ref, &ref_stride);
+    if (err) return err;
+    err = picture_copy_shared(dist_pic, 0, &dist, &dist_stride);
+    if (err) return err;
 
     double score;
-    err = compute_psnr(s->ref, s->dist, ref_pic->w[0], ref_pic->h[0],
-                       s->float_stride, s->float_stride, &score,
+    err = compute_psnr(ref, dist, ref_pic->w[0], ref_pic->h[0],
+                       ref_stride, dist_stride, &score,
                        s->peak, s->psnr_max);
 
     if (err) return err;
@@ -96,14 +92,6 @@ static int extract(VmafFeatureExtractor *fex,
     return 0;
 }
 
-static int close(VmafFeatureExtractor *fex)
-{
-    PsnrState *s = fex->priv;
-    if (s->ref) aligned_free(s->ref);
-    if (s->dist) aligned_free(s->dist);
-    return 0;
-}
-
 static const char *provided_features[] = {
     "float_psnr",
     NULL
@@ -113,7 +101,6 @@ VmafFeatureExtractor vmaf_fex_float_psnr = {
     .name = "float_psnr",
     .init = init,
     .extract = extract,
-    .close = close,
     .priv_size = sizeof(PsnrState),
     .provided_features = provided_features,
 };
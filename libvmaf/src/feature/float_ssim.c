@@ -28,9 +28,6 @@
 #include "picture_copy.h"
 
 typedef struct SsimState {
-    size_t float_stride;
-    float *ref;
-    float *dist;
     bool enable_lcs;
     bool enable_db;
     bool clip_db;
@@ -77,18 +74,7 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
         s->max_db = INFINITY;
     }
 
-    s->float_stride = ALIGN_CEIL(w * sizeof(float));
-    s->ref = aligned_malloc(s->float_stride * h, 32);
-    if (!s->ref) goto fail;
-    s->dist = aligned_malloc(s->float_stride * h, 32);
-    if (!s->dist) goto free_ref;
-
     return 0;
-
-free_ref:
-    free(s->ref);
-fail:
-    return -ENOMEM;
 }
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
@@ -109,12 +95,16 @@ static int extract(VmafFeatureExtractor *fex,
     (void) ref_pic_90;
     (void) dist_pic_90;
 
-    picture_copy(s->ref, s->float_stride, ref_pic, 0, ref_pic->bpc);
-    picture_copy(s->dist, s->float_stride, dist_pic, 0, dist_pic->bpc);
+    const float *ref, *dist;
+    ptrdiff_t ref_stride, dist_stride;
+    err = picture_copy_shared(ref_pic, 0, &ref, &ref_stride);
+    if (err) return err;
+    err = picture_copy_shared(dist_pic, 0, &dist, &dist_stride);
+    if (err) return err;
 
     double score, l_score, c_score, s_score;
-    err = compute_ssim(s->ref, s->dist, ref_pic->w[0], ref_pic->h[0],
-                       s->float_stride, s->float_stride,
+    err = compute_ssim(ref, dist, ref_pic->w[0], ref_pic->h[0],
+                       ref_stride, dist_stride,
                        &score, &l_score, &c_score, &s_score);
     if (err) return err;
 
@@ -135,14 +125,6 @@ static int extract(VmafFeatureExtractor *fex,
     return err;
 }
 
-static int close(VmafFeatureExtractor *fex)
-{
-    SsimState *s = fex->priv;
-    if (s->ref) aligned_free(s->ref);
-    if (s->dist) aligned_free(s->dist);
-    return 0;
-}
-
 static const char *provided_features[] = {
     "float_ssim",
     NULL
@@ -153,7 +135,6 @@ VmafFeatureExtractor vmaf_fex_float_ssim = {
     .init = init,
     .extract = extract,
     .options = options,
-    .close = close,
     .priv_size = sizeof(SsimState),
     .provided_features = provided_features,
 };
@@ -31,9 +31,6 @@
 #include "picture_copy.h"
 
 typedef struct VifState {
-    size_t float_stride;
-    float *ref;
-    float *dist;
     bool debug;
     double vif_enhn_gain_limit;
     double vif_kernelscale;
@@ -80,14 +77,10 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
 {
     (void)pix_fmt;
     (void)bpc;
+    (void)w;
+    (void)h;
 
     VifState *s = fex->priv;
-    s->float_stride = ALIGN_CEIL(w * sizeof(float));
-    s->ref = aligned_malloc(s->float_stride * h, 32);
-    if (!s->ref) goto fail;
-    s->dist = aligned_malloc(s->float_stride * h, 32);
-    if (!s->dist) goto fail;
-
     s->feature_name_dict =
         vmaf_feature_name_dict_from_provided_features(fex->provided_features,
                 fex->options, s);
@@ -96,8 +89,6 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     return 0;
 
 fail:
-    if (s->ref) aligned_free(s->ref);
-    if (s->dist) aligned_free(s->dist);
     vmaf_dictionary_free(&s->feature_name_dict);
     return -ENOMEM;
 }
@@ -113,13 +104,17 @@ static int extract(VmafFeatureExtractor *fex,
     (void) ref_pic_90;
     (void) dist_pic_90;
 
-    picture_copy(s->ref, s->float_stride, ref_pic, -128, ref_pic->bpc);
-    picture_copy(s->dist, s->float_stride, dist_pic, -128, dist_pic->bpc);
+    const float *ref, *dist;
+    ptrdiff_t ref_stride, dist_stride;
+    err = picture_copy_shared(ref_pic, -128, &ref, &ref_stride);
+    if (err) return err;
+    err = picture_copy_shared(dist_pic, -128, &dist, &dist_stride);
+    if (err) return err;
 
     double score, score_num, score_den;
     double scores[8];
-    err = compute_vif(s->ref, s->dist, ref_pic->w[0], ref_pic->h[0],
-                      s->float_stride, s->float_stride,
+    err = compute_vif(ref, dist, ref_pic->w[0], ref_pic->h[0],
+                      ref_stride, dist_stride,
                       &score, &score_num, &score_den, scores,
                       s->vif_enhn_gain_limit,
                       s->vif_kernelscale);
@@ -182,8 +177,6 @@ static int extract(VmafFeatureExtractor *fex,
 static int close(VmafFeatureExtractor *fex)
 {
     VifState *s = fex->priv;
-    if (s->ref) aligned_free(s->ref);
-    if (s->dist) aligned_free(s->dist);
     vmaf_dictionary_free(&s->feature_name_dict);
     return 0;
 }
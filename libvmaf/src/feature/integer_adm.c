@@ -22,6 +22,8 @@
 #include "feature_extractor.h"
 #include "feature_name.h"
 #include "integer_adm.h"
+#include "kernel.h"
+#include "integer_vmaf_core.h"
 #include "log.h"
 
 #if ARCH_X86
@@ -39,8 +41,8 @@ typedef struct AdmState {
     double adm_norm_view_dist;
     int adm_ref_display_height;
     void (*dwt2_8)(const uint8_t *src, const adm_dwt_band_t *dst,
-                   AdmBuffer *buf, int w, int h, int src_stride,
-                   int dst_stride);
+                   AdmBuffer *buf, int w, int row_start, int row_end,
+                   int src_stride, int dst_stride);
     VmafDictionary *feature_name_dict;
 } AdmState;
 
@@ -2065,8 +2067,8 @@ static void i16_to_i32(adm_dwt_band_t *src, i4_adm_dwt_band_t *dst,
 }
 
 static void adm_dwt2_8(const uint8_t *src, const adm_dwt_band_t *dst,
-                       AdmBuffer *buf, int w, int h, int src_stride,
-                       int dst_stride)
+                       AdmBuffer *buf, int w, int row_start, int row_end,
+                       int src_stride, int dst_stride)
 {
     const int16_t *filter_lo = dwt2_db2_coeffs_lo;
     const int16_t *filter_hi = dwt2_db2_coeffs_hi;
@@ -2083,7 +2085,7 @@ static void adm_dwt2_8(const uint8_t *src, const adm_dwt_band_t *dst,
     int16_t *tmphi = tmplo + w;
     int32_t accum;
 
-    for (int i = 0; i < (h + 1) / 2; ++i) {
+    for (int i = row_start; i < row_end; ++i) {
         /* Vertical pass. */
         for (int j = 0; j < w; ++j) {
             uint16_t u_s0 = src[ind_y[0][i] * src_stride + j];
@@ -2162,8 +2164,8 @@ static void adm_dwt2_8(const uint8_t *src, const adm_dwt_band_t *dst,
     }
 }
 
-static void adm_dwt2_16(const uint16_t *src, const adm_dwt_band_t *dst, AdmBuffer *buf, int w, int h,
-                        int src_stride, int dst_stride, int inp_size_bits)
+static void adm_dwt2_16(const uint16_t *src, const adm_dwt_band_t *dst, AdmBuffer *buf, int w,
+                        int row_start, int row_end, int src_stride, int dst_stride, int inp_size_bits)
 {
     const int16_t *filter_lo = dwt2_db2_coeffs_lo;
     const int16_t *filter_hi = dwt2_db2_coeffs_hi;
@@ -2180,7 +2182,7 @@ static void adm_dwt2_16(const uint16_t *src, const adm_dwt_band_t *dst, AdmBuffe
     int16_t *tmphi = tmplo + w;
     int32_t accum;
 
-    for (int i = 0; i < (h + 1) / 2; ++i) {
+    for (int i = row_start; i < row_end; ++i) {
         /* Vertical pass. */
         for (int j = 0; j < w; ++j) {
             uint16_t u_s0 = src[ind_y[0][i] * src_stride + j];
@@ -2422,7 +2424,35 @@ static void adm_dwt2_s123_combined(const int32_t *i4_ref_scale, const int32_t *i
     }
 }
 
-void integer_compute_adm(AdmState *s, VmafPicture *ref_pic, VmafPicture *dis_pic,
+/*
+ * Scale 0 DWT of output rows [row_start, row_end) of both pictures. The
+ * source indices must have been generated for the full resolution first.
+ */
+static void adm_dwt2_rows(AdmState *s, VmafPicture *ref_pic,
+                          VmafPicture *dis_pic, AdmBuffer *buf,
+                          int row_start, int row_end)
+{
+    const int w = ref_pic->w[0];
+    const size_t buf_stride = buf->ind_size_x >> 2;
+
+    if (ref_pic->bpc == 8) {
+        s->dwt2_8(ref_pic->data[0], &buf->ref_dwt2, buf, w, row_start, row_end,
+                  ref_pic->stride[0], buf_stride);
+        s->dwt2_8(dis_pic->data[0], &buf->dis_dwt2, buf, w, row_start, row_end,
+                  dis_pic->stride[0], buf_stride);
+    }
+    else {
+        adm_dwt2_16(ref_pic->data[0], &buf->ref_dwt2, buf, w, row_start,
+                    row_end, ref_pic->stride[0] >> 1, buf_stride, ref_pic->bpc);
+        adm_dwt2_16(dis_pic->data[0], &buf->dis_dwt2, buf, w, row_start,
+                    row_end, dis_pic->stride[0] >> 1, buf_stride, dis_pic->bpc);
+    }
+}
+
+/*
+ * Expects the scale 0 DWT to be complete, see adm_dwt2_rows().
+ */
+void integer_compute_adm(VmafPicture *ref_pic,
                          double *score, double *score_num, double *score_den, double *scores, AdmBuffer *buf,
                          double adm_enhn_gain_limit,
                          double adm_norm_view_dist, int adm_ref_display_height)
@@ -2432,43 +2462,20 @@ void integer_compute_adm(AdmState *s, VmafPicture *ref_pic, VmafPicture *dis_pic
 
     const double numden_limit = 1e-10 * (w * h) / (1920.0 * 1080.0);
 
-    size_t curr_ref_stride;
-    size_t curr_dis_stride;
     size_t buf_stride = buf->ind_size_x >> 2;
+    size_t curr_ref_stride = buf_stride;
+    size_t curr_dis_stride = buf_stride;
 
     int32_t *i4_curr_ref_scale = NULL;
     int32_t *i4_curr_dis_scale = NULL;
 
-    if (ref_pic->bpc == 8) {
-        curr_ref_stride = ref_pic->stride[0];
-        curr_dis_stride = dis_pic->stride[0];
-    }
-    else {
-        curr_ref_stride = ref_pic->stride[0] >> 1;
-        curr_dis_stride = dis_pic->stride[0] >> 1;
-    }
-
     double num = 0;
     double den = 0;
 	for (unsigned scale = 0; scale < 4; ++scale) {
 		float num_scale = 0.0;
 		float den_scale = 0.0;
 
-        dwt2_src_indices_filt(buf->ind_y, buf->ind_x, w, h);
 		if(scale==0) {
-            if (ref_pic->bpc == 8) {
-                s->dwt2_8(ref_pic->data[0], &buf->ref_dwt2, buf, w, h,
-                          curr_ref_stride, buf_stride);
-                s->dwt2_8(dis_pic->data[0], &buf->dis_dwt2, buf, w, h,
-                          curr_dis_stride, buf_stride);
-            }
-            else {
-                adm_dwt2_16(ref_pic->data[0], &buf->ref_dwt2, buf, w, h,
-                            curr_ref_stride, buf_stride, ref_pic->bpc);
-                adm_dwt2_16(dis_pic->data[0], &buf->dis_dwt2, buf, w, h,
-                            curr_dis_stride, buf_stride, dis_pic->bpc);
-            }
-
 			i16_to_i32(&buf->ref_dwt2, &buf->i4_ref_dwt2, w, h, buf_stride);
 			i16_to_i32(&buf->dis_dwt2, &buf->i4_dis_dwt2, w, h, buf_stride);
 
@@ -2486,6 +2493,7 @@ void integer_compute_adm(AdmState *s, VmafPicture *ref_pic, VmafPicture *dis_pic
                                adm_norm_view_dist, adm_ref_display_height);
 		}
 		else {
+            dwt2_src_indices_filt(buf->ind_y, buf->ind_x, w, h);
             adm_dwt2_s123_combined(i4_curr_ref_scale, i4_curr_dis_scale, buf, w, h, curr_ref_stride,
                                    curr_dis_stride, buf_stride, scale);
 
@@ -2577,12 +2585,51 @@ static inline void *i4_init_dwt_band_hvd(i4_adm_dwt_band_t *band, char *data_top
     return data_top;
 }
 
+// the vectorized dwt2 processes 8 columns at a time
+static const VmafKernelVariant adm_kernel_variants[] = {
+    { .name = "c" },
+#if ARCH_X86
+    {
+        .name = "avx2",
+        .cpu_flags = VMAF_X86_CPU_FLAG_AVX2,
+        .w_align = 8,
+    },
+#elif ARCH_AARCH64
+    {
+        .name = "neon",
+        .cpu_flags = VMAF_ARM_CPU_FLAG_NEON,
+        .w_align = 8,
+    },
+#endif
+    { 0 }
+};
+
+static const VmafKernel adm_kernel = {
+    .name = "integer_adm",
+    .feature_extractor = "adm",
+    .variant = adm_kernel_variants,
+};
+
+static size_t scratch_size(VmafFeatureExtractor *fex,
+                           enum VmafPixelFormat pix_fmt, unsigned bpc,
+                           unsigned w, unsigned h)
+{
+    (void)fex;
+    (void)pix_fmt;
+    (void)bpc;
+
+    const size_t integer_stride = ALIGN_CEIL(w * sizeof(int32_t));
+    const size_t ind_size_x = ALIGN_CEIL(((w + 1) / 2) * sizeof(int32_t));
+    const size_t ind_size_y = ALIGN_CEIL(((h + 1) / 2) * sizeof(int32_t));
+    const size_t buf_sz_one = ind_size_x * ((h + 1) / 2);
+    return buf_sz_one * NUM_BUFS_ADM + integer_stride * 4 +
+           ind_size_x * 4 + ind_size_y * 4;
+}
+
 static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
                 unsigned bpc, unsigned w, unsigned h)
 {
     AdmState *s = fex->priv;
-    (void) pix_fmt;
-    (void) bpc;
 
     if (w <= 32 || h <= 32) {
         vmaf_log(VMAF_LOG_LEVEL_ERROR,
@@ -2594,16 +2641,17 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
 
     s->dwt2_8 = adm_dwt2_8;
 
+    const unsigned flags =
+        vmaf_kernel_select(&adm_kernel, fex->kernel_tuning, pix_fmt, bpc, w,
+                           h)->cpu_flags;
 #if ARCH_X86
-    unsigned flags = vmaf_get_cpu_flags();
-    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
-        if (!(w % 8)) s->dwt2_8 = adm_dwt2_8_avx2;
-    }
+    if (flags & VMAF_X86_CPU_FLAG_AVX2)
+        s->dwt2_8 = adm_dwt2_8_avx2;
 #elif ARCH_AARCH64
-    unsigned flags = vmaf_get_cpu_flags();
-    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
-        if (!(w % 8)) s->dwt2_8 = adm_dwt2_8_neon;
-    }
+    if (flags & VMAF_ARM_CPU_FLAG_NEON)
+        s->dwt2_8 = adm_dwt2_8_neon;
+#else
+    (void)flags;
 #endif
 
     s->integer_stride   = ALIGN_CEIL(w * sizeof(int32_t));
@@ -2611,13 +2659,13 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     s->buf.ind_size_y   = ALIGN_CEIL(((h + 1) / 2) * sizeof(int32_t));
     size_t buf_sz_one   = s->buf.ind_size_x * ((h + 1) / 2);
 
-    s->buf.data_buf     = aligned_malloc(buf_sz_one * NUM_BUFS_ADM, MAX_ALIGN);
+    s->buf.data_buf     = vmaf_arena_alloc(fex->arena, buf_sz_one * NUM_BUFS_ADM, MAX_ALIGN);
     if (!s->buf.data_buf) goto fail;
-    s->buf.tmp_ref      = aligned_malloc(s->integer_stride * 4, MAX_ALIGN);
+    s->buf.tmp_ref      = vmaf_arena_alloc(fex->arena, s->integer_stride * 4, MAX_ALIGN);
     if (!s->buf.tmp_ref) goto fail;
-    s->buf.buf_x_orig   = aligned_malloc(s->buf.ind_size_x * 4, MAX_ALIGN);
+    s->buf.buf_x_orig   = vmaf_arena_alloc(fex->arena, s->buf.ind_size_x * 4, MAX_ALIGN);
     if (!s->buf.buf_x_orig) goto fail;
-    s->buf.buf_y_orig   = aligned_malloc(s->buf.ind_size_y * 4, MAX_ALIGN);
+    s->buf.buf_y_orig   = vmaf_arena_alloc(fex->arena, s->buf.ind_size_y * 4, MAX_ALIGN);
     if (!s->buf.buf_y_orig) goto fail;
 
     void *data_top = s->buf.data_buf;
@@ -2650,27 +2698,19 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     return 0;
 
 fail:
-    if (s->buf.data_buf)    aligned_free(s->buf.data_buf);
-    if (s->buf.tmp_ref)     aligned_free(s->buf.tmp_ref);
-    if (s->buf.buf_x_orig)  aligned_free(s->buf.buf_x_orig);
-    if (s->buf.buf_y_orig)  aligned_free(s->buf.buf_y_orig);
+    if (s->buf.data_buf)    vmaf_arena_free(fex->arena, s->buf.data_buf);
+    if (s->buf.tmp_ref)     vmaf_arena_free(fex->arena, s->buf.tmp_ref);
+    if (s->buf.buf_x_orig)  vmaf_arena_free(fex->arena, s->buf.buf_x_orig);
+    if (s->buf.buf_y_orig)  vmaf_arena_free(fex->arena, s->buf.buf_y_orig);
     vmaf_dictionary_free(&s->feature_name_dict);
     return -ENOMEM;
 }
 
-static int extract(VmafFeatureExtractor *fex,
-                   VmafPicture *ref_pic, VmafPicture *ref_pic_90,
-                   VmafPicture *dist_pic, VmafPicture *dist_pic_90,
-                   unsigned index, VmafFeatureCollector *feature_collector)
+int integer_adm_extract_rows(VmafFeatureExtractor *fex,
+                             VmafPicture *ref_pic, VmafPicture *dist_pic,
+                             unsigned row_start, unsigned row_end)
 {
     AdmState *s = fex->priv;
-    int err = 0;
-
-    (void) ref_pic_90;
-    (void) dist_pic_90;
-
-    double score, score_num, score_den;
-    double scores[8];
 
     // current implementation is limited by the 16-bit data pipeline, thus
     // cannot handle an angular frequency smaller than 1080p * 3H
@@ -2679,7 +2719,32 @@ static int extract(VmafFeatureExtractor *fex,
         return -EINVAL;
     }
 
-    integer_compute_adm(s, ref_pic, dist_pic, &score, &score_num, &score_den,
+    if (row_start == 0) {
+        dwt2_src_indices_filt(s->buf.ind_y, s->buf.ind_x, ref_pic->w[0],
+                              ref_pic->h[0]);
+    }
+
+    // each output row of the DWT consumes two source rows
+    adm_dwt2_rows(s, ref_pic, dist_pic, &s->buf, (row_start + 1) / 2,
+                  (row_end + 1) / 2);
+
+    return 0;
+}
+
+int integer_adm_extract_finish(VmafFeatureExtractor *fex,
+                               VmafPicture *ref_pic, VmafPicture *dist_pic,
+                               unsigned index,
+                               VmafFeatureCollector *feature_collector)
+{
+    AdmState *s = fex->priv;
+    int err = 0;
+
+    (void) dist_pic;
+
+    double score, score_num, score_den;
+    double scores[8];
+
+    integer_compute_adm(ref_pic, &score, &score_num, &score_den,
                         scores, &s->buf,
                         s->adm_enhn_gain_limit,
                         s->adm_norm_view_dist, s->adm_ref_display_height);
@@ -2742,14 +2807,29 @@ static int extract(VmafFeatureExtractor *fex,
     return err;
 }
 
+static int extract(VmafFeatureExtractor *fex,
+                   VmafPicture *ref_pic, VmafPicture *ref_pic_90,
+                   VmafPicture *dist_pic, VmafPicture *dist_pic_90,
+                   unsigned index, VmafFeatureCollector *feature_collector)
+{
+    (void) ref_pic_90;
+    (void) dist_pic_90;
+
+    int err = integer_adm_extract_rows(fex, ref_pic, dist_pic, 0,
+                                       ref_pic->h[0]);
+    if (err) return err;
+    return integer_adm_extract_finish(fex, ref_pic, dist_pic, index,
+                                      feature_collector);
+}
+
 static int close(VmafFeatureExtractor *fex)
 {
     AdmState *s = fex->priv;
 
-    if (s->buf.data_buf)    aligned_free(s->buf.data_buf);
-    if (s->buf.tmp_ref)     aligned_free(s->buf.tmp_ref);
-    if (s->buf.buf_x_orig)  aligned_free(s->buf.buf_x_orig);
-    if (s->buf.buf_y_orig)  aligned_free(s->buf.buf_y_orig);
+    if (s->buf.data_buf)    vmaf_arena_free(fex->arena, s->buf.data_buf);
+    if (s->buf.tmp_ref)     vmaf_arena_free(fex->arena, s->buf.tmp_ref);
+    if (s->buf.buf_x_orig)  vmaf_arena_free(fex->arena, s->buf.buf_x_orig);
+    if (s->buf.buf_y_orig)  vmaf_arena_free(fex->arena, s->buf.buf_y_orig);
     vmaf_dictionary_free(&s->feature_name_dict);
 
     return 0;
@@ -2771,6 +2851,7 @@ VmafFeatureExtractor vmaf_fex_integer_adm = {
     .extract = extract,
     .options = options,
     .close = close,
+    .scratch_size = scratch_size,
     .priv_size = sizeof(AdmState),
     .provided_features = provided_features,
 };
@@ -18,6 +18,7 @@
 
 #include <errno.h>
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "cpu.h"
@@ -26,7 +27,9 @@
 #include "feature_collector.h"
 #include "feature_extractor.h"
 #include "feature_name.h"
+#include "kernel.h"
 #include "integer_motion.h"
+#include "integer_vmaf_core.h"
 #include "mem.h"
 #include "picture.h"
 
@@ -35,22 +38,22 @@
 #if HAVE_AVX512
 #include "x86/motion_avx512.h"
 #endif
+#elif ARCH_AARCH64
+#include "arm64/motion_neon.h"
 #endif
 
 typedef struct MotionState {
-    VmafPicture tmp;
-    VmafPicture blur[3];
+    uint16_t *tmp;
+    VmafPicture blur[2];
     unsigned index;
     double score;
+    uint64_t sad_accum; ///< SAD of the current frame, accumulated over row ranges
     bool debug;
     bool motion_force_zero;
-    void (*y_convolution)(void *src, uint16_t *dst, unsigned width,
-                          unsigned height, ptrdiff_t src_stride,
-                          ptrdiff_t dst_stride, unsigned inp_size_bits);
-    void (*x_convolution)(const uint16_t *src, uint16_t *dst, unsigned width,
-                          unsigned height, ptrdiff_t src_stride,
-                          ptrdiff_t dst_stride);
-    void (*sad)(VmafPicture *pic_a, VmafPicture *pic_b, uint64_t *sad);
+    void (*y_convolution)(const void *const *src, uint16_t *dst,
+                          unsigned width, unsigned inp_size_bits);
+    void (*x_convolution)(const uint16_t *src, uint16_t *dst, unsigned width);
+    uint32_t (*sad)(const uint16_t *a, const uint16_t *b, unsigned width);
     VmafDictionary *feature_name_dict;
 } MotionState;
 
@@ -74,170 +77,107 @@ static const VmafOption options[] = {
     { 0 }
 };
 
-static inline void
-x_convolution_16(const uint16_t *src, uint16_t *dst, unsigned width,
-                 unsigned height, ptrdiff_t src_stride,
-                 ptrdiff_t dst_stride)
-{
-    const unsigned radius = filter_width / 2;
-    const unsigned left_edge = vmaf_ceiln(radius, 1);
-    const unsigned right_edge = vmaf_floorn(width - (filter_width - radius), 1);
-    const unsigned shift_add_round = 32768;
-
-    uint16_t *src_p = (uint16_t*) src + (left_edge - radius);
-    for (unsigned i = 0; i < height; ++i) {
-        for (unsigned j = 0; j < left_edge; j++) {
-            dst[i * dst_stride + j] =
-                (edge_16(true, src, width, height, src_stride, i, j) +
-                 shift_add_round) >> 16;
-        }
-
-        uint16_t *src_p1 = src_p;
-        for (unsigned j = left_edge; j < right_edge; j++) {
-            uint32_t accum = 0;
-            uint16_t *src_p2 = src_p1;
-            for (int k = 0; k < filter_width; ++k) {
-                accum += filter[k] * (*src_p2);
-                src_p2++;
-            }
-            src_p1++;
-            dst[i * dst_stride + j] = (accum + shift_add_round) >> 16;
-        }
+/*
+ * The blur is computed one row at a time: the vertical pass writes a single
+ * row into a padded line buffer, the horizontal pass filters that line into
+ * the blurred frame and the SAD against the previous blurred frame is taken
+ * while the row is still in cache.
+ */
 
-        for (unsigned j = right_edge; j < width; j++) {
-            dst[i * dst_stride + j] =
-                (edge_16(true, src, width, height, src_stride, i, j) +
-                 shift_add_round) >> 16;
-        }
+static void y_convolution_8(const void *const *src, uint16_t *dst,
+                            unsigned width, unsigned inp_size_bits)
+{
+    (void) inp_size_bits;
+    const uint8_t *const *src_8 = (const uint8_t *const *) src;
+    const unsigned shift_var = 8;
+    const unsigned add_before_shift = 1u << (shift_var - 1);
 
-        src_p += src_stride;
+    for (unsigned j = 0; j < width; ++j) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * src_8[k][j];
+        dst[j] = (accum + add_before_shift) >> shift_var;
     }
 }
 
-static inline void
-y_convolution_16(void *src, uint16_t *dst, unsigned width,
-                 unsigned height, ptrdiff_t src_stride,
-                 ptrdiff_t dst_stride, unsigned inp_size_bits)
+static void y_convolution_16(const void *const *src, uint16_t *dst,
+                             unsigned width, unsigned inp_size_bits)
 {
-    const unsigned radius = filter_width / 2;
-    const unsigned top_edge = vmaf_ceiln(radius, 1);
-    const unsigned bottom_edge = vmaf_floorn(height - (filter_width - radius), 1);
-    const unsigned add_before_shift = (int) pow(2, (inp_size_bits - 1));
+    const uint16_t *const *src_16 = (const uint16_t *const *) src;
     const unsigned shift_var = inp_size_bits;
+    const unsigned add_before_shift = 1u << (shift_var - 1);
 
-    uint16_t *src_p = (uint16_t*) src + (top_edge - radius) * src_stride;
-    for (unsigned i = 0; i < top_edge; i++) {
-        for (unsigned j = 0; j < width; ++j) {
-            dst[i * dst_stride + j] =
-                (edge_16(false, src, width, height, src_stride, i, j) +
-                 add_before_shift) >> shift_var;
-        }
+    for (unsigned j = 0; j < width; ++j) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * src_16[k][j];
+        dst[j] = (accum + add_before_shift) >> shift_var;
     }
+}
 
-    for (unsigned i = top_edge; i < bottom_edge; i++) {
-        uint16_t *src_p1 = src_p;
-        for (unsigned j = 0; j < width; ++j) {
-            uint16_t *src_p2 = src_p1;
-            uint32_t accum = 0;
-            for (int k = 0; k < filter_width; ++k) {
-                accum += filter[k] * (*src_p2);
-                src_p2 += src_stride;
-            }
-            dst[i * dst_stride + j] = (accum + add_before_shift) >> shift_var;
-            src_p1++;
-        }
-        src_p += src_stride;
-    }
+static void x_convolution_16(const uint16_t *src, uint16_t *dst,
+                             unsigned width)
+{
+    const int radius = filter_width / 2;
+    const unsigned shift_add_round = 32768;
 
-    for (unsigned i = bottom_edge; i < height; i++) {
-        for (unsigned j = 0; j < width; ++j) {
-            dst[i * dst_stride + j] =
-                (edge_16(false, src, width, height, src_stride, i, j) +
-                 add_before_shift) >> shift_var;
-        }
+    for (unsigned j = 0; j < width; ++j) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * src[(int) j - radius + k];
+        dst[j] = (accum + shift_add_round) >> 16;
     }
 }
 
-static inline uint32_t
-edge_8(const uint8_t *src, int height, int stride, int i, int j)
+static uint32_t sad_c(const uint16_t *a, const uint16_t *b, unsigned width)
 {
-    int radius = filter_width / 2;
-    uint32_t accum = 0;
+    uint32_t sad = 0;
+    for (unsigned j = 0; j < width; j++)
+        sad += abs(a[j] - b[j]);
+    return sad;
+}
 
+static inline int mirror(int idx, int size)
+{
     // MIRROR | ЯOЯЯIM
-    for (int k = 0; k < filter_width; ++k) {
-        int i_tap = i - radius + k;
-        int j_tap = j;
-
-        if (i_tap < 0)
-            i_tap = -i_tap;
-        else if (i_tap >= height)
-            i_tap = height - (i_tap - height + 1);
-
-        accum += filter[k] * src[i_tap * stride + j_tap];
-    }
-    return accum;
+    if (idx < 0)
+        return -idx;
+    if (idx >= size)
+        return size - (idx - size + 1);
+    return idx;
 }
 
-static inline void
-y_convolution_8(void *src, uint16_t *dst, unsigned width,
-                unsigned height, ptrdiff_t src_stride, ptrdiff_t dst_stride,
-                unsigned inp_size_bits)
+static void blur_frame(MotionState *s, VmafPicture *pic, VmafPicture *blur,
+                       VmafPicture *prev, uint64_t *sad,
+                       int row_start, int row_end)
 {
-    (void) inp_size_bits;
-    const unsigned radius = filter_width / 2;
-    const unsigned top_edge = vmaf_ceiln(radius, 1);
-    const unsigned bottom_edge = vmaf_floorn(height - (filter_width - radius), 1);
-    const unsigned shift_var = 8;
-    const unsigned add_before_shift = (int) pow(2, (shift_var - 1));
-
-    for (unsigned i = 0; i < top_edge; i++) {
-        for (unsigned j = 0; j < width; ++j) {
-            dst[i * dst_stride + j] =
-                (edge_8(src, height, src_stride, i, j) +
-                 add_before_shift) >> shift_var;
+    const int radius = filter_width / 2;
+    const unsigned w = pic->w[0];
+    const int h = pic->h[0];
+    uint16_t *line = s->tmp + radius;
+
+    for (int i = row_start; i < row_end; i++) {
+        const void *rows[5];
+        for (int k = 0; k < filter_width; k++) {
+            rows[k] = (uint8_t *) pic->data[0] +
+                      mirror(i - radius + k, h) * pic->stride[0];
         }
-    }
+        s->y_convolution(rows, line, w, pic->bpc);
 
-    uint8_t *src_p = (uint8_t*) src + (top_edge - radius) * src_stride;
-    for (unsigned i = top_edge; i < bottom_edge; i++) {
-        uint8_t *src_p1 = src_p;
-        for (unsigned j = 0; j < width; ++j) {
-            uint8_t *src_p2 = src_p1;
-            uint32_t accum = 0;
-            for (int k = 0; k < filter_width; ++k) {
-                accum += filter[k] * (*src_p2);
-                src_p2 += src_stride;
-            }
-            dst[i * dst_stride + j] = (accum + add_before_shift) >> shift_var;
-            src_p1++;
+        // mirror the line buffer so that the horizontal pass has no edge cases
+        for (int k = 1; k <= radius; k++) {
+            line[-k] = line[k];
+            line[w - 1 + k] = line[w - k];
         }
-        src_p += src_stride;
-    }
 
-    for (unsigned i = bottom_edge; i < height; i++) {
-        for (unsigned j = 0; j < width; ++j) {
-            dst[i * dst_stride + j] =
-                (edge_8(src, height, src_stride, i, j) +
-                 add_before_shift) >> shift_var;
-        }
-    }
-}
+        uint16_t *dst = (uint16_t *)((uint8_t *) blur->data[0] + i * blur->stride[0]);
+        s->x_convolution(line, dst, w);
 
-static void sad_c(VmafPicture *pic_a, VmafPicture *pic_b, uint64_t *sad)
-{
-    *sad = 0;
-
-    uint16_t *a = pic_a->data[0];
-    uint16_t *b = pic_b->data[0];
-    for (unsigned i = 0; i < pic_a->h[0]; i++) {
-        uint32_t inner_sad = 0;
-        for (unsigned j = 0; j < pic_a->w[0]; j++) {
-            inner_sad += abs(a[j] - b[j]);
+        if (prev) {
+            const uint16_t *ref =
+                (uint16_t *)((uint8_t *) prev->data[0] + i * prev->stride[0]);
+            *sad += s->sad(ref, dst, w);
         }
-        *sad += inner_sad;
-        a += (pic_a->stride[0] / 2);
-        b += (pic_b->stride[0] / 2);
     }
 }
 
@@ -269,11 +209,15 @@ static int extract_force_zero(VmafFeatureExtractor *fex,
     return err;
 }
 
+static const VmafKernel motion_kernel = {
+    .name = "integer_motion",
+    .feature_extractor = "motion",
+    .variant = vmaf_kernel_variants_simd,
+};
+
 static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
                 unsigned bpc, unsigned w, unsigned h)
 {
-    (void) pix_fmt;
-
     MotionState *s = fex->priv;
     int err = 0;
 
@@ -289,26 +233,47 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
         return 0;
     }
 
-    err |= vmaf_picture_alloc(&s->tmp, VMAF_PIX_FMT_YUV400P, 16, w, h);
+    // one line with room for the mirrored edges on both sides
+    s->tmp = aligned_malloc(ALIGN_CEIL((w + filter_width) * sizeof(uint16_t)), 32);
+    if (!s->tmp) {
+        err = -ENOMEM;
+        goto fail;
+    }
+
     err |= vmaf_picture_alloc(&s->blur[0], VMAF_PIX_FMT_YUV400P, 16, w, h);
     err |= vmaf_picture_alloc(&s->blur[1], VMAF_PIX_FMT_YUV400P, 16, w, h);
-    err |= vmaf_picture_alloc(&s->blur[2], VMAF_PIX_FMT_YUV400P, 16, w, h);
     if (err) goto fail;
 
     s->y_convolution = bpc == 8 ? y_convolution_8 : y_convolution_16;
     s->x_convolution = x_convolution_16;
+    s->sad = sad_c;
 
+    const unsigned flags =
+        vmaf_kernel_select(&motion_kernel, fex->kernel_tuning, pix_fmt, bpc, w,
+                           h)->cpu_flags;
 #if ARCH_X86
-    unsigned flags = vmaf_get_cpu_flags();
-    if (flags & VMAF_X86_CPU_FLAG_AVX2)
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
+        s->y_convolution = bpc == 8 ? y_convolution_8_avx2 : y_convolution_16_avx2;
         s->x_convolution = x_convolution_16_avx2;
+        s->sad = sad_avx2;
+    }
 #if HAVE_AVX512
-    if (flags & VMAF_X86_CPU_FLAG_AVX512)
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        s->y_convolution = bpc == 8 ? y_convolution_8_avx512 : y_convolution_16_avx512;
         s->x_convolution = x_convolution_16_avx512;
+        s->sad = sad_avx512;
+    }
 #endif
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        s->y_convolution = bpc == 8 ? y_convolution_8_neon : y_convolution_16_neon;
+        s->x_convolution = x_convolution_16_neon;
+        s->sad = sad_neon;
+    }
+#else
+    (void)flags;
 #endif
 
-    s->sad = sad_c;
     s->score = 0.;
 
     return 0;
@@ -316,8 +281,7 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
 fail:
     err |= vmaf_picture_unref(&s->blur[0]);
     err |= vmaf_picture_unref(&s->blur[1]);
-    err |= vmaf_picture_unref(&s->blur[2]);
-    err |= vmaf_picture_unref(&s->tmp);
+    aligned_free(s->tmp);
     err |= vmaf_dictionary_free(&s->feature_name_dict);
     return err;
 }
@@ -343,33 +307,54 @@ static inline double normalize_and_scale_sad(uint64_t sad,
     return (float) (sad / 256.) / (w * h);
 }
 
-static int extract(VmafFeatureExtractor *fex,
-                   VmafPicture *ref_pic, VmafPicture *ref_pic_90,
-                   VmafPicture *dist_pic, VmafPicture *dist_pic_90,
-                   unsigned index, VmafFeatureCollector *feature_collector)
+int integer_motion_extract_rows(VmafFeatureExtractor *fex,
+                                VmafPicture *ref_pic, VmafPicture *dist_pic,
+                                unsigned index,
+                                unsigned row_start, unsigned row_end)
 {
     MotionState *s = fex->priv;
-    int err = 0;
 
     (void) dist_pic;
-    (void) ref_pic_90;
-    (void) dist_pic_90;
 
-    s->index = index;
-    const unsigned blur_idx_0 = (index + 0) % 3;
-    const unsigned blur_idx_1 = (index + 1) % 3;
-    const unsigned blur_idx_2 = (index + 2) % 3;
+    if (s->motion_force_zero) return 0;
+
+    const unsigned blur_idx_0 = (index + 0) % 2;
+    const unsigned blur_idx_1 = (index + 1) % 2;
+
+    // an unchanged frame blurs to the previous blur and has zero SAD
+    VmafPicturePrivate *ref_priv = ref_pic->priv;
+    if (index > 0 && ref_priv->unchanged) {
+        if (row_start == 0) {
+            VmafPicture blur = s->blur[blur_idx_0];
+            s->blur[blur_idx_0] = s->blur[blur_idx_1];
+            s->blur[blur_idx_1] = blur;
+            s->sad_accum = 0;
+        }
+        return 0;
+    }
+
+    if (row_start == 0) s->sad_accum = 0;
+    blur_frame(s, ref_pic, &s->blur[blur_idx_0],
+               index > 0 ? &s->blur[blur_idx_1] : NULL, &s->sad_accum,
+               row_start, row_end);
+
+    return 0;
+}
 
-    const ptrdiff_t y_src_stride =
-        ref_pic->bpc == 8 ? ref_pic->stride[0] : ref_pic->stride[0] / 2;
+int integer_motion_extract_finish(VmafFeatureExtractor *fex,
+                                  VmafPicture *ref_pic, VmafPicture *dist_pic,
+                                  unsigned index,
+                                  VmafFeatureCollector *feature_collector)
+{
+    MotionState *s = fex->priv;
+    int err = 0;
 
-    s->y_convolution(ref_pic->data[0], s->tmp.data[0], ref_pic->w[0],
-                     ref_pic->h[0], y_src_stride, s->tmp.stride[0] / 2,
-                     ref_pic->bpc);
+    if (s->motion_force_zero) {
+        return extract_force_zero(fex, ref_pic, NULL, dist_pic, NULL, index,
+                                  feature_collector);
+    }
 
-    s->x_convolution(s->tmp.data[0], s->blur[blur_idx_0].data[0],
-                     s->tmp.w[0], s->tmp.h[0], s->tmp.stride[0] / 2,
-                     s->blur[blur_idx_0].stride[0] / 2);
+    s->index = index;
 
     if (index == 0) {
         err = vmaf_feature_collector_append(feature_collector,
@@ -383,10 +368,11 @@ static int extract(VmafFeatureExtractor *fex,
         return err;
     }
 
-    uint64_t sad;
-    s->sad(&s->blur[blur_idx_2], &s->blur[blur_idx_0], &sad);
+    // motion2 of the previous frame also needs SAD(blur[i - 1], blur[i - 2]),
+    // which is the motion score computed on the previous call
+    const double prev_score = s->score;
     double score = s->score =
-        normalize_and_scale_sad(sad, ref_pic->w[0], ref_pic->h[0]);
+        normalize_and_scale_sad(s->sad_accum, ref_pic->w[0], ref_pic->h[0]);
 
     if (s->debug) {
         err |= vmaf_feature_collector_append(feature_collector,
@@ -398,17 +384,28 @@ static int extract(VmafFeatureExtractor *fex,
     if (index == 1)
         return 0;
 
-    uint64_t sad2;
-    s->sad(&s->blur[blur_idx_2], &s->blur[blur_idx_1], &sad2);
-    double score2 = normalize_and_scale_sad(sad2, ref_pic->w[0], ref_pic->h[0]);
-
-    score2 = score2 < score ? score2 : score;
+    double score2 = prev_score < score ? prev_score : score;
     err = vmaf_feature_collector_append(feature_collector,
                                         "VMAF_integer_feature_motion2_score",
                                         score2, index - 1);
     return err;
 }
 
+static int extract(VmafFeatureExtractor *fex,
+                   VmafPicture *ref_pic, VmafPicture *ref_pic_90,
+                   VmafPicture *dist_pic, VmafPicture *dist_pic_90,
+                   unsigned index, VmafFeatureCollector *feature_collector)
+{
+    (void) ref_pic_90;
+    (void) dist_pic_90;
+
+    int err = integer_motion_extract_rows(fex, ref_pic, dist_pic, index, 0,
+                                          ref_pic->h[0]);
+    if (err) return err;
+    return integer_motion_extract_finish(fex, ref_pic, dist_pic, index,
+                                         feature_collector);
+}
+
 static int close(VmafFeatureExtractor *fex)
 {
     MotionState *s = fex->priv;
@@ -416,8 +413,7 @@ static int close(VmafFeatureExtractor *fex)
     int err = 0;
     err |= vmaf_picture_unref(&s->blur[0]);
     err |= vmaf_picture_unref(&s->blur[1]);
-    err |= vmaf_picture_unref(&s->blur[2]);
-    err |= vmaf_picture_unref(&s->tmp);
+    aligned_free(s->tmp);
     err |= vmaf_dictionary_free(&s->feature_name_dict);
     return err;
 }
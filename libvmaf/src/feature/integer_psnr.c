@@ -62,6 +62,7 @@ static const VmafOption options[] = {
         .offset = offsetof(PsnrState, enable_apsnr),
         .type = VMAF_OPT_TYPE_BOOL,
         .default_val.b = false,
+        .flags = VMAF_OPT_FLAG_FLUSH_AGGREGATE,
     },
     {
         .name = "reduced_hbd_peak",
@@ -27,10 +27,12 @@
 #include "feature_collector.h"
 #include "feature_extractor.h"
 #include "feature_name.h"
+#include "kernel.h"
 #include "mem.h"
 
 #include "picture.h"
 #include "integer_vif.h"
+#include "integer_vmaf_core.h"
 
 #if ARCH_X86
 #include "x86/vif_avx2.h"
@@ -46,8 +48,10 @@ typedef struct VifState {
     bool debug;
     void (*subsample_rd_8)(VifBuffer buf, unsigned w, unsigned h);
     void (*subsample_rd_16)(VifBuffer buf, unsigned w, unsigned h, int scale, int bpc);
-    void (*vif_statistic_8)(VifPublicState *s, float *num, float *den, unsigned w, unsigned h);
-    void (*vif_statistic_16)(VifPublicState *s, float *num, float *den, unsigned w, unsigned h, int bpc, int scale);
+    void (*vif_statistic_8)(VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end);
+    void (*vif_statistic_16)(VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end, int bpc, int scale);
+    VifResiduals residuals; ///< scale 0, accumulated over row ranges
+    unsigned rows_copied;
     VmafDictionary *feature_name_dict;
 } VifState;
 
@@ -93,6 +97,35 @@ pad_top_and_bottom(VifBuffer buf, unsigned h, int fwidth)
     }
 }
 
+static FORCE_INLINE void
+pad_top(VifBuffer buf, int fwidth)
+{
+    const unsigned fwidth_half = fwidth / 2;
+    unsigned char *ref = buf.ref;
+    unsigned char *dis = buf.dis;
+    for (unsigned i = 1; i <= fwidth_half; ++i) {
+        size_t offset = buf.stride * i;
+        memcpy(ref - offset, ref + offset, buf.stride);
+        memcpy(dis - offset, dis + offset, buf.stride);
+    }
+}
+
+static FORCE_INLINE void
+pad_bottom(VifBuffer buf, unsigned h, int fwidth)
+{
+    const unsigned fwidth_half = fwidth / 2;
+    unsigned char *ref = buf.ref;
+    unsigned char *dis = buf.dis;
+    for (unsigned i = 1; i <= fwidth_half; ++i) {
+        memcpy(ref + buf.stride * (h - 1) + buf.stride * i,
+               ref + buf.stride * (h - 1) - buf.stride * i,
+               buf.stride);
+        memcpy(dis + buf.stride * (h - 1) + buf.stride * i,
+               dis + buf.stride * (h - 1) - buf.stride * i,
+               buf.stride);
+    }
+}
+
 static FORCE_INLINE void
 decimate_and_pad(VifBuffer buf, unsigned w, unsigned h, int scale)
 {
@@ -219,7 +252,7 @@ static inline void log_generate(uint16_t *log2_table)
     }
 }
 
-void vif_statistic_8(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h) {
+void vif_statistic_8(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end) {
     const unsigned fwidth = vif_filter1d_width[0];
     const uint16_t *vif_filt_s0 = vif_filter1d_table[0];
     VifBuffer buf = s->buf;
@@ -231,7 +264,7 @@ void vif_statistic_8(struct VifPublicState *s, float *num, float *den, unsigned
     uint16_t *log2_table = s->log2_table;
     double vif_enhn_gain_limit = s->vif_enhn_gain_limit;
 
-    for (unsigned i = 0; i < h; ++i) {
+    for (unsigned i = row_start; i < row_end; ++i) {
         //VERTICAL
         for (unsigned j = 0; j < w; ++j) {
             uint32_t accum_mu1 = 0;
@@ -338,11 +371,13 @@ void vif_statistic_8(struct VifPublicState *s, float *num, float *den, unsigned
             }
         }
     }
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 }
 
-void vif_statistic_16(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h, int bpc, int scale) {
+void vif_statistic_16(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end, int bpc, int scale) {
     const unsigned fwidth = vif_filter1d_width[scale];
     const uint16_t *vif_filt = vif_filter1d_table[scale];
     VifBuffer buf = s->buf;
@@ -373,7 +408,7 @@ void vif_statistic_16(struct VifPublicState *s, float *num, float *den, unsigned
         add_shift_round_VP_sq = 32768;
     }
 
-    for (unsigned i = 0; i < h; ++i) {
+    for (unsigned i = row_start; i < row_end; ++i) {
         //VERTICAL
         for (unsigned j = 0; j < w; ++j) {
             uint32_t accum_mu1 = 0;
@@ -481,8 +516,10 @@ void vif_statistic_16(struct VifPublicState *s, float *num, float *den, unsigned
             }
         }
     }
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 }
 
 VifResiduals vif_compute_line_residuals(VifPublicState *s, unsigned from,
@@ -575,6 +612,38 @@ VifResiduals vif_compute_line_residuals(VifPublicState *s, unsigned from,
 }
 
 
+static const VmafKernel vif_kernel = {
+    .name = "integer_vif",
+    .feature_extractor = "vif",
+    .variant = vmaf_kernel_variants_simd,
+};
+
+static size_t buf_init(VifBuffer *buf, unsigned bpc, unsigned w, unsigned h)
+{
+    const bool hbd = bpc > 8;
+
+    buf->stride = ALIGN_CEIL(w << hbd);
+    buf->stride_16 = ALIGN_CEIL(w * sizeof(uint16_t));
+    buf->stride_32 = ALIGN_CEIL(w * sizeof(uint32_t));
+    buf->stride_tmp =
+        ALIGN_CEIL((MAX_ALIGN + w + MAX_ALIGN) * sizeof(uint32_t));
+    const size_t frame_size = buf->stride * h;
+    const size_t pad_size = buf->stride * 8;
+    return 2 * (pad_size + frame_size + pad_size) + 2 * (h * buf->stride_16) +
+           5 * (buf->stride_32) + 7 * buf->stride_tmp;
+}
+
+static size_t scratch_size(VmafFeatureExtractor *fex,
+                           enum VmafPixelFormat pix_fmt, unsigned bpc,
+                           unsigned w, unsigned h)
+{
+    (void)fex;
+    (void)pix_fmt;
+
+    VifBuffer buf;
+    return buf_init(&buf, bpc, w, h);
+}
+
 static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
                 unsigned bpc, unsigned w, unsigned h)
 {
@@ -585,8 +654,10 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     s->vif_statistic_8 = vif_statistic_8;
     s->vif_statistic_16 = vif_statistic_16;
 
+    const unsigned flags =
+        vmaf_kernel_select(&vif_kernel, fex->kernel_tuning, pix_fmt, bpc, w,
+                           h)->cpu_flags;
 #if ARCH_X86
-    unsigned flags = vmaf_get_cpu_flags();
     if (flags & VMAF_X86_CPU_FLAG_AVX2) {
         s->subsample_rd_8 = vif_subsample_rd_8_avx2;
         s->subsample_rd_16 = vif_subsample_rd_16_avx2;
@@ -602,31 +673,22 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     }
 #endif
 #elif ARCH_AARCH64
-    unsigned flags = vmaf_get_cpu_flags();
     if (flags & VMAF_ARM_CPU_FLAG_NEON) {
         s->subsample_rd_8 = vif_subsample_rd_8_neon;
         s->subsample_rd_16 = vif_subsample_rd_16_neon;
         s->vif_statistic_8 = vif_statistic_8_neon;
         s->vif_statistic_16 = vif_statistic_16_neon;
     }
+#else
+    (void)flags;
 #endif
 
     log_generate(s->public.log2_table);
 
-    (void)pix_fmt;
-    const bool hbd = bpc > 8;
-
-    s->public.buf.stride = ALIGN_CEIL(w << hbd);
-    s->public.buf.stride_16 = ALIGN_CEIL(w * sizeof(uint16_t));
-    s->public.buf.stride_32 = ALIGN_CEIL(w * sizeof(uint32_t));
-    s->public.buf.stride_tmp =
-        ALIGN_CEIL((MAX_ALIGN + w + MAX_ALIGN) * sizeof(uint32_t));
+    const size_t data_sz = buf_init(&s->public.buf, bpc, w, h);
     const size_t frame_size = s->public.buf.stride * h;
     const size_t pad_size = s->public.buf.stride * 8;
-    const size_t data_sz =
-        2 * (pad_size + frame_size + pad_size) + 2 * (h * s->public.buf.stride_16) +
-        5 * (s->public.buf.stride_32) + 7 * s->public.buf.stride_tmp;
-    void *data = aligned_malloc(data_sz, MAX_ALIGN);
+    void *data = vmaf_arena_alloc(fex->arena, data_sz, MAX_ALIGN);
     if (!data) return -ENOMEM;
     memset(data, 0, data_sz);
 
@@ -656,7 +718,7 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
     return 0;
 
 fail:
-    if (data) aligned_free(data);
+    vmaf_arena_free(fex->arena, s->public.buf.data);
     vmaf_dictionary_free(&s->feature_name_dict);
     return -ENOMEM;
 }
@@ -746,61 +808,110 @@ static int write_scores(VmafFeatureCollector *feature_collector, unsigned index,
     return err;
 }
 
-static int extract(VmafFeatureExtractor *fex,
-                   VmafPicture *ref_pic, VmafPicture *ref_pic_90,
-                   VmafPicture *dist_pic, VmafPicture *dist_pic_90,
-                   unsigned index, VmafFeatureCollector *feature_collector)
+int integer_vif_extract_rows(VmafFeatureExtractor *fex,
+                             VmafPicture *ref_pic, VmafPicture *dist_pic,
+                             unsigned row_start, unsigned row_end)
 {
     VifState *s = fex->priv;
 
-    (void)ref_pic_90;
-    (void)dist_pic_90;
+    const unsigned w = ref_pic->w[0];
+    const unsigned h = dist_pic->h[0];
+    const int fwidth = vif_filter1d_width[0];
 
-    unsigned w = ref_pic->w[0];
-    unsigned h = dist_pic->h[0];
-
-    unsigned char *ref_in = ref_pic->data[0];
-    unsigned char *dis_in = dist_pic->data[0];
-    unsigned char *ref_out = s->public.buf.ref;
-    unsigned char *dis_out = s->public.buf.dis;
-
-    for (unsigned i = 0; i < h; i++) {
-        memcpy(ref_out, ref_in, ref_pic->stride[0]);
-        memcpy(dis_out, dis_in, dist_pic->stride[0]);
-        ref_in += ref_pic->stride[0];
-        dis_in += dist_pic->stride[0];
-        ref_out += s->public.buf.stride;
-        dis_out += s->public.buf.stride;
+    if (row_start == 0) {
+        memset(&s->residuals, 0, sizeof(s->residuals));
+        s->rows_copied = 0;
     }
-    pad_top_and_bottom(s->public.buf, h, vif_filter1d_width[0]);
 
-    VifScore vif_score;
-    for (unsigned scale = 0; scale < 4; ++scale) {
-        if (scale > 0) {
-            if (ref_pic->bpc == 8 && scale == 1)
-                s->subsample_rd_8(s->public.buf, w, h);
-            else
-                s->subsample_rd_16(s->public.buf, w, h, scale - 1, ref_pic->bpc);
-
-            w /= 2; h /= 2;
+    // the vertical filter reaches fwidth / 2 rows below the last output row
+    const unsigned copy_end =
+        row_end + fwidth / 2 < h ? row_end + fwidth / 2 : h;
+    if (copy_end > s->rows_copied) {
+        const unsigned i0 = s->rows_copied;
+        unsigned char *ref_in = (unsigned char *)ref_pic->data[0] + i0 * ref_pic->stride[0];
+        unsigned char *dis_in = (unsigned char *)dist_pic->data[0] + i0 * dist_pic->stride[0];
+        unsigned char *ref_out = (unsigned char *)s->public.buf.ref + i0 * s->public.buf.stride;
+        unsigned char *dis_out = (unsigned char *)s->public.buf.dis + i0 * s->public.buf.stride;
+
+        for (unsigned i = i0; i < copy_end; i++) {
+            memcpy(ref_out, ref_in, ref_pic->stride[0]);
+            memcpy(dis_out, dis_in, dist_pic->stride[0]);
+            ref_in += ref_pic->stride[0];
+            dis_in += dist_pic->stride[0];
+            ref_out += s->public.buf.stride;
+            dis_out += s->public.buf.stride;
         }
 
-        if (ref_pic->bpc == 8 && scale == 0) {
-            s->vif_statistic_8(&s->public, &vif_score.scale[scale].num, &vif_score.scale[scale].den, w, h);
-        }
-        else {
-            s->vif_statistic_16(&s->public, &vif_score.scale[scale].num, &vif_score.scale[scale].den, w, h, ref_pic->bpc, scale);
-        }
+        if (i0 == 0 && copy_end == h)
+            pad_top_and_bottom(s->public.buf, h, fwidth);
+        else if (i0 == 0)
+            pad_top(s->public.buf, fwidth);
+        else if (copy_end == h)
+            pad_bottom(s->public.buf, h, fwidth);
+        s->rows_copied = copy_end;
+    }
 
+    if (ref_pic->bpc == 8) {
+        s->vif_statistic_8(&s->public, &s->residuals, w, row_start, row_end);
+    } else {
+        s->vif_statistic_16(&s->public, &s->residuals, w, row_start, row_end,
+                            ref_pic->bpc, 0);
+    }
+
+    return 0;
+}
+
+int integer_vif_extract_finish(VmafFeatureExtractor *fex,
+                               VmafPicture *ref_pic, VmafPicture *dist_pic,
+                               unsigned index,
+                               VmafFeatureCollector *feature_collector)
+{
+    VifState *s = fex->priv;
+
+    unsigned w = ref_pic->w[0];
+    unsigned h = dist_pic->h[0];
+
+    VifScore vif_score;
+    vif_residuals_to_scores(&s->residuals, &vif_score.scale[0].num,
+                            &vif_score.scale[0].den);
+
+    for (unsigned scale = 1; scale < 4; ++scale) {
+        if (ref_pic->bpc == 8 && scale == 1)
+            s->subsample_rd_8(s->public.buf, w, h);
+        else
+            s->subsample_rd_16(s->public.buf, w, h, scale - 1, ref_pic->bpc);
+
+        w /= 2; h /= 2;
+
+        VifResiduals residuals = { 0 };
+        s->vif_statistic_16(&s->public, &residuals, w, 0, h, ref_pic->bpc,
+                            scale);
+        vif_residuals_to_scores(&residuals, &vif_score.scale[scale].num,
+                                &vif_score.scale[scale].den);
     }
 
     return write_scores(feature_collector, index, vif_score, s);
 }
 
+static int extract(VmafFeatureExtractor *fex,
+                   VmafPicture *ref_pic, VmafPicture *ref_pic_90,
+                   VmafPicture *dist_pic, VmafPicture *dist_pic_90,
+                   unsigned index, VmafFeatureCollector *feature_collector)
+{
+    (void)ref_pic_90;
+    (void)dist_pic_90;
+
+    int err = integer_vif_extract_rows(fex, ref_pic, dist_pic, 0,
+                                       dist_pic->h[0]);
+    if (err) return err;
+    return integer_vif_extract_finish(fex, ref_pic, dist_pic, index,
+                                      feature_collector);
+}
+
 static int close(VmafFeatureExtractor *fex)
 {
     VifState *s = fex->priv;
-    if (s->public.buf.data) aligned_free(s->public.buf.data);
+    if (s->public.buf.data) vmaf_arena_free(fex->arena, s->public.buf.data);
     vmaf_dictionary_free(&s->feature_name_dict);
     return 0;
 }
@@ -821,6 +932,7 @@ VmafFeatureExtractor vmaf_fex_integer_vif = {
     .extract = extract,
     .options = options,
     .close = close,
+    .scratch_size = scratch_size,
     .priv_size = sizeof(VifState),
     .provided_features = provided_features,
 };
@@ -115,8 +115,13 @@ static inline void PADDING_SQ_DATA_2(VifBuffer buf, int w, unsigned fwidth_half)
     }
 }
 
-void vif_statistic_8(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h);
-void vif_statistic_16(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h, int bpc, int scale);
+/*
+ * Accumulate the vif statistic of output rows [row_start, row_end) of the
+ * current scale into `residuals`. The sums are integer, so splitting a frame
+ * into several row ranges gives the same result as a single call.
+ */
+void vif_statistic_8(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end);
+void vif_statistic_16(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end, int bpc, int scale);
 
 /*
  * Compute vif residuals on a vertically filtered line 
@@ -126,6 +131,19 @@ void vif_statistic_16(struct VifPublicState *s, float *num, float *den, unsigned
 VifResiduals vif_compute_line_residuals(VifPublicState *s, unsigned from,
                                         unsigned to, int scale);
 
+/*
+ * Convert accumulated residuals to the num/den of one scale. The log values
+ * are scaled by 2048 since the log2 table stores log2(i) * 2048.
+ */
+static inline void vif_residuals_to_scores(const VifResiduals *residuals,
+                                           float *num, float *den)
+{
+    num[0] = residuals->accum_num_log / 2048.0 +
+        (residuals->accum_den_non_log -
+         ((residuals->accum_num_non_log) / 16384.0) / (65025.0));
+    den[0] = residuals->accum_den_log / 2048.0 + residuals->accum_den_non_log;
+}
+
 
 #ifdef _MSC_VER
 #include <intrin.h>
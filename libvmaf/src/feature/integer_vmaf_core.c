@@ -0,0 +1,366 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "feature_collector.h"
+#include "feature_extractor.h"
+#include "integer_adm.h"
+#include "integer_vif.h"
+#include "integer_vmaf_core.h"
+#include "opt.h"
+#include "picture.h"
+
+/*
+ * Fused integer vif, adm and motion. Instead of three whole-frame passes,
+ * the frame is walked in horizontal stripes sized to stay resident in L2
+ * and each stripe is fed to the vif filter, the adm dwt and the motion blur
+ * while it is still hot. The coarser scales, which work on 1/4 of the data
+ * or less, run once the last stripe is done.
+ *
+ * The three extractors do the actual work through their staged entry
+ * points and write the scores under their own feature names, so the output
+ * is identical to running them separately.
+ */
+
+extern VmafFeatureExtractor vmaf_fex_integer_vif;
+extern VmafFeatureExtractor vmaf_fex_integer_adm;
+extern VmafFeatureExtractor vmaf_fex_integer_motion;
+
+#define VMAF_CORE_STRIPE_BYTES (256 * 1024)
+#define VMAF_CORE_STRIPE_MIN_ROWS 16
+
+typedef struct VmafCoreState {
+    double vif_enhn_gain_limit;
+    double adm_enhn_gain_limit;
+    double adm_norm_view_dist;
+    int adm_ref_display_height;
+    bool motion_force_zero;
+    int stripe_height;
+    unsigned stripe_rows;
+    VmafFeatureExtractorContext *vif, *adm, *motion;
+    struct {
+        FeatureRecord record;
+        unsigned index;
+        bool valid;
+    } spatial; ///< vif and adm scores of the last frame
+} VmafCoreState;
+
+static const VmafOption options[] = {
+    {
+        .name = "vif_enhn_gain_limit",
+        .help = "enhancement gain imposed on vif, must be >= 1.0, "
+                "where 1.0 means the gain is completely disabled",
+        .offset = offsetof(VmafCoreState, vif_enhn_gain_limit),
+        .type = VMAF_OPT_TYPE_DOUBLE,
+        .default_val.d = DEFAULT_VIF_ENHN_GAIN_LIMIT,
+        .min = 1.0,
+        .max = DEFAULT_VIF_ENHN_GAIN_LIMIT,
+        .flags = VMAF_OPT_FLAG_FEATURE_PARAM,
+    },
+    {
+        .name = "adm_enhn_gain_limit",
+        .help = "enhancement gain imposed on adm, must be >= 1.0, "
+                "where 1.0 means the gain is completely disabled",
+        .offset = offsetof(VmafCoreState, adm_enhn_gain_limit),
+        .type = VMAF_OPT_TYPE_DOUBLE,
+        .default_val.d = DEFAULT_ADM_ENHN_GAIN_LIMIT,
+        .min = 1.0,
+        .max = DEFAULT_ADM_ENHN_GAIN_LIMIT,
+        .flags = VMAF_OPT_FLAG_FEATURE_PARAM,
+    },
+    {
+        .name = "adm_norm_view_dist",
+        .help = "normalized viewing distance = viewing distance / ref display's physical height",
+        .offset = offsetof(VmafCoreState, adm_norm_view_dist),
+        .type = VMAF_OPT_TYPE_DOUBLE,
+        .default_val.d = DEFAULT_ADM_NORM_VIEW_DIST,
+        .min = 0.75,
+        .max = 24.0,
+        .flags = VMAF_OPT_FLAG_FEATURE_PARAM,
+    },
+    {
+        .name = "adm_ref_display_height",
+        .help = "reference display height in pixels",
+        .offset = offsetof(VmafCoreState, adm_ref_display_height),
+        .type = VMAF_OPT_TYPE_INT,
+        .default_val.i = DEFAULT_ADM_REF_DISPLAY_HEIGHT,
+        .min = 1,
+        .max = 4320,
+        .flags = VMAF_OPT_FLAG_FEATURE_PARAM,
+    },
+    {
+        .name = "motion_force_zero",
+        .help = "forcing motion score to zero",
+        .offset = offsetof(VmafCoreState, motion_force_zero),
+        .type = VMAF_OPT_TYPE_BOOL,
+        .default_val.b = false,
+        .flags = VMAF_OPT_FLAG_FEATURE_PARAM,
+    },
+    {
+        .name = "stripe_height",
+        .help = "rows per stripe, 0 sizes the stripe to fit in L2",
+        .offset = offsetof(VmafCoreState, stripe_height),
+        .type = VMAF_OPT_TYPE_INT,
+        .default_val.i = 0,
+        .min = 0,
+        .max = 4320,
+    },
+    { 0 }
+};
+
+static size_t option_size(enum VmafOptionType type)
+{
+    switch (type) {
+    case VMAF_OPT_TYPE_BOOL:
+        return sizeof(bool);
+    case VMAF_OPT_TYPE_INT:
+        return sizeof(int);
+    case VMAF_OPT_TYPE_DOUBLE:
+        return sizeof(double);
+    default:
+        return 0;
+    }
+}
+
+static const VmafOption *find_option(const VmafOption *opts, const char *name)
+{
+    for (const VmafOption *opt = opts; opt && opt->name; opt++) {
+        if (!strcmp(opt->name, name))
+            return opt;
+    }
+    return NULL;
+}
+
+/*
+ * Walks the feature parameters of `sub` that the fused extractor shares.
+ * With `copy` set they are copied from `core` into `sub`, otherwise the
+ * return value tells whether they are all equal.
+ */
+static bool feature_params(const VmafFeatureExtractor *core,
+                           VmafFeatureExtractor *sub, bool copy)
+{
+    for (const VmafOption *opt = sub->options; opt && opt->name; opt++) {
+        if (!(opt->flags & VMAF_OPT_FLAG_FEATURE_PARAM)) continue;
+        const VmafOption *core_opt = find_option(core->options, opt->name);
+        if (!core_opt || core_opt->type != opt->type) return false;
+        const size_t sz = option_size(opt->type);
+        if (!sz) return false;
+
+        uint8_t *dst = (uint8_t *)sub->priv + opt->offset;
+        const uint8_t *src = (const uint8_t *)core->priv + core_opt->offset;
+        if (copy)
+            memcpy(dst, src, sz);
+        else if (memcmp(dst, src, sz))
+            return false;
+    }
+    return true;
+}
+
+bool vmaf_core_provides(const VmafFeatureExtractorContext *core_ctx,
+                        const VmafFeatureExtractorContext *fex_ctx)
+{
+    if (!core_ctx || !fex_ctx) return false;
+    if (strcmp(core_ctx->fex->name, "vmaf_core")) return false;
+
+    const char *name = fex_ctx->fex->name;
+    if (strcmp(name, vmaf_fex_integer_vif.name) &&
+        strcmp(name, vmaf_fex_integer_adm.name) &&
+        strcmp(name, vmaf_fex_integer_motion.name))
+    {
+        return false;
+    }
+
+    return feature_params(core_ctx->fex, fex_ctx->fex, false);
+}
+
+static int sub_init(VmafFeatureExtractor *fex, VmafFeatureExtractor *sub_fex,
+                    VmafFeatureExtractorContext **sub,
+                    enum VmafPixelFormat pix_fmt, unsigned bpc,
+                    unsigned w, unsigned h)
+{
+    int err = vmaf_feature_extractor_context_create(sub, sub_fex, NULL);
+    if (err) return err;
+
+    feature_params(fex, (*sub)->fex, true);
+    (*sub)->fex->framesync = fex->framesync;
+    (*sub)->fex->thread_pool = fex->thread_pool;
+    (*sub)->fex->arena = fex->arena;
+    (*sub)->fex->kernel_tuning = fex->kernel_tuning;
+
+    err = vmaf_feature_extractor_context_init(*sub, pix_fmt, bpc, w, h);
+    if (err) {
+        vmaf_feature_extractor_context_destroy(*sub);
+        *sub = NULL;
+    }
+    return err;
+}
+
+static int close(VmafFeatureExtractor *fex);
+
+static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
+                unsigned bpc, unsigned w, unsigned h)
+{
+    VmafCoreState *s = fex->priv;
+    int err = 0;
+
+    err = sub_init(fex, &vmaf_fex_integer_vif, &s->vif, pix_fmt, bpc, w, h);
+    if (err) goto fail;
+    err = sub_init(fex, &vmaf_fex_integer_adm, &s->adm, pix_fmt, bpc, w, h);
+    if (err) goto fail;
+    err = sub_init(fex, &vmaf_fex_integer_motion, &s->motion, pix_fmt, bpc,
+                   w, h);
+    if (err) goto fail;
+
+    if (s->stripe_height) {
+        s->stripe_rows = s->stripe_height;
+    } else {
+        // ref and dist rows of one stripe should fit in L2 together
+        const size_t row_bytes = 2 * (size_t)w * (bpc > 8 ? 2 : 1);
+        s->stripe_rows = VMAF_CORE_STRIPE_BYTES / row_bytes;
+        if (s->stripe_rows < VMAF_CORE_STRIPE_MIN_ROWS)
+            s->stripe_rows = VMAF_CORE_STRIPE_MIN_ROWS;
+    }
+    // keep stripes aligned to the 2:1 row decimation of the adm dwt
+    s->stripe_rows = (s->stripe_rows + 1) & ~1u;
+
+    return 0;
+
+fail:
+    close(fex);
+    return err;
+}
+
+static int extract(VmafFeatureExtractor *fex,
+                   VmafPicture *ref_pic, VmafPicture *ref_pic_90,
+                   VmafPicture *dist_pic, VmafPicture *dist_pic_90,
+                   unsigned index, VmafFeatureCollector *feature_collector)
+{
+    VmafCoreState *s = fex->priv;
+    int err = 0;
+
+    (void) ref_pic_90;
+    (void) dist_pic_90;
+
+    const unsigned h = ref_pic->h[0];
+
+    // a repeated frame pair only needs the (trivial) motion update
+    const VmafPicturePrivate *ref_priv = ref_pic->priv;
+    const VmafPicturePrivate *dist_priv = dist_pic->priv;
+    if (ref_priv->unchanged && dist_priv->unchanged && s->spatial.valid &&
+        s->spatial.index + 1 == index)
+    {
+        err = integer_motion_extract_rows(s->motion->fex, ref_pic, dist_pic,
+                                          index, 0, h);
+        if (err) return err;
+        for (unsigned i = 0; i < s->spatial.record.cnt; i++)
+            s->spatial.record.entry[i].index = index;
+        s->spatial.index = index;
+        err = vmaf_feature_record_replay(&s->spatial.record, feature_collector);
+        if (err) return err;
+        return integer_motion_extract_finish(s->motion->fex, ref_pic, dist_pic,
+                                             index, feature_collector);
+    }
+
+    for (unsigned row_start = 0; row_start < h; row_start += s->stripe_rows) {
+        const unsigned row_end = row_start + s->stripe_rows < h ?
+                                 row_start + s->stripe_rows : h;
+
+        err = integer_motion_extract_rows(s->motion->fex, ref_pic, dist_pic,
+                                          index, row_start, row_end);
+        if (err) return err;
+        err = integer_vif_extract_rows(s->vif->fex, ref_pic, dist_pic,
+                                       row_start, row_end);
+        if (err) return err;
+        err = integer_adm_extract_rows(s->adm->fex, ref_pic, dist_pic,
+                                       row_start, row_end);
+        if (err) return err;
+    }
+
+    vmaf_feature_record_free(&s->spatial.record);
+    VmafFeatureCollector recorder = {
+        .perf = feature_collector->perf,
+        .record = &s->spatial.record,
+    };
+    err = integer_vif_extract_finish(s->vif->fex, ref_pic, dist_pic, index,
+                                     &recorder);
+    if (!err) {
+        err = integer_adm_extract_finish(s->adm->fex, ref_pic, dist_pic, index,
+                                         &recorder);
+    }
+    s->spatial.index = index;
+    s->spatial.valid = !err;
+    err |= vmaf_feature_record_replay(&s->spatial.record, feature_collector);
+    if (err) return err;
+    return integer_motion_extract_finish(s->motion->fex, ref_pic, dist_pic,
+                                         index, feature_collector);
+}
+
+static int flush(VmafFeatureExtractor *fex,
+                 VmafFeatureCollector *feature_collector)
+{
+    VmafCoreState *s = fex->priv;
+    int err = 0;
+
+    err |= vmaf_feature_extractor_context_flush(s->vif, feature_collector);
+    err |= vmaf_feature_extractor_context_flush(s->adm, feature_collector);
+    err |= vmaf_feature_extractor_context_flush(s->motion, feature_collector);
+
+    return (err < 0) ? err : 1;
+}
+
+static int close(VmafFeatureExtractor *fex)
+{
+    VmafCoreState *s = fex->priv;
+    VmafFeatureExtractorContext **sub[] = { &s->vif, &s->adm, &s->motion };
+    int err = 0;
+
+    for (unsigned i = 0; i < 3; i++) {
+        if (!*sub[i]) continue;
+        err |= vmaf_feature_extractor_context_close(*sub[i]);
+        err |= vmaf_feature_extractor_context_destroy(*sub[i]);
+        *sub[i] = NULL;
+    }
+    vmaf_feature_record_free(&s->spatial.record);
+
+    return err;
+}
+
+static const char *provided_features[] = {
+    "VMAF_integer_feature_vif_scale0_score", "VMAF_integer_feature_vif_scale1_score",
+    "VMAF_integer_feature_vif_scale2_score", "VMAF_integer_feature_vif_scale3_score",
+    "VMAF_integer_feature_adm2_score", "integer_adm_scale0",
+    "integer_adm_scale1", "integer_adm_scale2", "integer_adm_scale3",
+    "VMAF_integer_feature_motion_score", "VMAF_integer_feature_motion2_score",
+    NULL
+};
+
+VmafFeatureExtractor vmaf_fex_integer_vmaf_core = {
+    .name = "vmaf_core",
+    .init = init,
+    .extract = extract,
+    .flush = flush,
+    .close = close,
+    .options = options,
+    .priv_size = sizeof(VmafCoreState),
+    .provided_features = provided_features,
+    .flags = VMAF_FEATURE_EXTRACTOR_TEMPORAL,
+};
@@ -0,0 +1,72 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef FEATURE_VMAF_CORE_H_
+#define FEATURE_VMAF_CORE_H_
+
+#include <stdbool.h>
+
+#include "feature_collector.h"
+#include "feature_extractor.h"
+
+/*
+ * Staged extraction used by the fused "vmaf_core" extractor. A frame is fed
+ * to the *_extract_rows() functions as consecutive source row ranges
+ * [row_start, row_end), starting at row 0 and ending at the picture height.
+ * *_extract_finish() then completes the coarser scales and writes the scores.
+ * Running all rows in a single call is exactly what the extractor's own
+ * extract() callback does, so both paths give identical scores.
+ */
+
+int integer_vif_extract_rows(VmafFeatureExtractor *fex,
+                             VmafPicture *ref_pic, VmafPicture *dist_pic,
+                             unsigned row_start, unsigned row_end);
+
+int integer_vif_extract_finish(VmafFeatureExtractor *fex,
+                               VmafPicture *ref_pic, VmafPicture *dist_pic,
+                               unsigned index,
+                               VmafFeatureCollector *feature_collector);
+
+int integer_adm_extract_rows(VmafFeatureExtractor *fex,
+                             VmafPicture *ref_pic, VmafPicture *dist_pic,
+                             unsigned row_start, unsigned row_end);
+
+int integer_adm_extract_finish(VmafFeatureExtractor *fex,
+                               VmafPicture *ref_pic, VmafPicture *dist_pic,
+                               unsigned index,
+                               VmafFeatureCollector *feature_collector);
+
+int integer_motion_extract_rows(VmafFeatureExtractor *fex,
+                                VmafPicture *ref_pic, VmafPicture *dist_pic,
+                                unsigned index,
+                                unsigned row_start, unsigned row_end);
+
+int integer_motion_extract_finish(VmafFeatureExtractor *fex,
+                                  VmafPicture *ref_pic, VmafPicture *dist_pic,
+                                  unsigned index,
+                                  VmafFeatureCollector *feature_collector);
+
+/**
+ * True if `fex_ctx` is a vif, adm or motion extractor whose feature
+ * parameters match those of the fused `core_ctx`, i.e. registering it
+ * next to `core_ctx` would write the same features twice.
+ */
+bool vmaf_core_provides(const VmafFeatureExtractorContext *core_ctx,
+                        const VmafFeatureExtractorContext *fex_ctx);
+
+#endif /* FEATURE_VMAF_CORE_H_ */
@@ -16,13 +16,40 @@
  *
  */
 
+
+#include <stddef.h>
 #include <stdint.h>
 
 #include <libvmaf/picture.h>
 
+#include "config.h"
+#include "cpu.h"
+#include "picture.h"
+#include "picture_copy.h"
+
+#if ARCH_X86
+#include "x86/picture_copy_avx2.h"
+#elif ARCH_AARCH64
+#include "arm64/picture_copy_neon.h"
+#endif
+
 void picture_copy_hbd(float *dst, ptrdiff_t dst_stride,
                       VmafPicture *src, int offset, float scaler)
 {
+#if ARCH_X86
+    if (vmaf_get_cpu_flags() & VMAF_X86_CPU_FLAG_AVX2) {
+        picture_copy_16_avx2(dst, dst_stride, src->data[0], src->stride[0],
+                             src->w[0], src->h[0], scaler, offset);
+        return;
+    }
+#elif ARCH_AARCH64
+    if (vmaf_get_cpu_flags() & VMAF_ARM_CPU_FLAG_NEON) {
+        picture_copy_16_neon(dst, dst_stride, src->data[0], src->stride[0],
+                             src->w[0], src->h[0], scaler, offset);
+        return;
+    }
+#endif
+
     float *float_data = dst;
     uint16_t *data = src->data[0];
 
@@ -50,6 +77,20 @@ void picture_copy(float *dst, ptrdiff_t dst_stride,
         return;
     }
 
+#if ARCH_X86
+    if (vmaf_get_cpu_flags() & VMAF_X86_CPU_FLAG_AVX2) {
+        picture_copy_8_avx2(dst, dst_stride, src->data[0], src->stride[0],
+                            src->w[0], src->h[0], offset);
+        return;
+    }
+#elif ARCH_AARCH64
+    if (vmaf_get_cpu_flags() & VMAF_ARM_CPU_FLAG_NEON) {
+        picture_copy_8_neon(dst, dst_stride, src->data[0], src->stride[0],
+                            src->w[0], src->h[0], offset);
+        return;
+    }
+#endif
+
     float *float_data = dst;
     uint8_t *data = src->data[0];
 
@@ -63,3 +104,21 @@ void picture_copy(float *dst, ptrdiff_t dst_stride,
 
     return;
 }
+
+static int derive_float_luma(VmafPicture *pic, void *dst, ptrdiff_t dst_stride,
+                             int offset)
+{
+    picture_copy(dst, dst_stride, pic, offset, pic->bpc);
+    return 0;
+}
+
+int picture_copy_shared(VmafPicture *src, int offset,
+                        const float **dst, ptrdiff_t *dst_stride)
+{
+    const void *data;
+    int err = vmaf_picture_get_derived(src, VMAF_PICTURE_DERIVED_FLOAT_LUMA,
+                                       offset, src->w[0] * sizeof(float),
+                                       derive_float_luma, &data, dst_stride);
+    *dst = data;
+    return err;
+}
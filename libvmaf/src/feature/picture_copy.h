@@ -19,3 +19,11 @@
 
 void picture_copy(float *dst, ptrdiff_t dst_stride, VmafPicture *src,
                   int offset, unsigned bpc);
+
+/**
+ * Like picture_copy(), but the float luma plane is cached on `src` and shared
+ * with every other extractor asking for the same `offset` on the same frame.
+ * The returned plane is read-only and lives as long as `src`.
+ */
+int picture_copy_shared(VmafPicture *src, int offset,
+                        const float **dst, ptrdiff_t *dst_stride);
@@ -398,11 +398,25 @@ void vif_filter1d_s(const float *f, const float *src, float *dst, float *tmpbuf,
 
 #if ARCH_X86
     const unsigned flags = vmaf_get_cpu_flags();
-    if ((flags & VMAF_X86_CPU_FLAG_AVX2) && (fwidth == 17 || fwidth == 9 || fwidth == 5 || fwidth == 3)) {
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        convolution_f32_avx512_s(f, fwidth, src, dst, tmpbuf, w, h,
+                                 src_px_stride, dst_px_stride);
+        return;
+    }
+#endif
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
         convolution_f32_avx_s(f, fwidth, src, dst, tmpbuf, w, h,
                               src_px_stride, dst_px_stride);
         return;
     }
+#elif ARCH_AARCH64
+    const unsigned flags = vmaf_get_cpu_flags();
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        convolution_f32_neon_s(f, fwidth, src, dst, tmpbuf, w, h,
+                               src_px_stride, dst_px_stride);
+        return;
+    }
 #endif
 
     /* fall back */
@@ -466,11 +480,25 @@ void vif_filter1d_sq_s(const float *f, const float *src, float *dst, float *tmpb
     
 #if ARCH_X86
     const unsigned flags = vmaf_get_cpu_flags();
-    if ((flags & VMAF_X86_CPU_FLAG_AVX2) && (fwidth == 17 || fwidth == 9 || fwidth == 5 || fwidth == 3)) {
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        convolution_f32_avx512_sq_s(f, fwidth, src, dst, tmpbuf, w, h,
+                                    src_px_stride, dst_px_stride);
+        return;
+    }
+#endif
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
         convolution_f32_avx_sq_s(f, fwidth, src, dst, tmpbuf, w, h,
                                  src_px_stride, dst_px_stride);
         return;
     }
+#elif ARCH_AARCH64
+    const unsigned flags = vmaf_get_cpu_flags();
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        convolution_f32_neon_sq_s(f, fwidth, src, dst, tmpbuf, w, h,
+                                  src_px_stride, dst_px_stride);
+        return;
+    }
 #endif
 
     /* fall back */
@@ -532,11 +560,25 @@ void vif_filter1d_xy_s(const float *f, const float *src1, const float *src2, flo
 
 #if ARCH_X86
     const unsigned flags = vmaf_get_cpu_flags();
-    if ((flags & VMAF_X86_CPU_FLAG_AVX2) && (fwidth == 17 || fwidth == 9 || fwidth == 5 || fwidth == 3)) {
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        convolution_f32_avx512_xy_s(f, fwidth, src1, src2, dst, tmpbuf, w, h,
+                                    src1_px_stride, src2_px_stride, dst_px_stride);
+        return;
+    }
+#endif
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
         convolution_f32_avx_xy_s(f, fwidth, src1, src2, dst, tmpbuf, w, h,
                                  src1_px_stride, src2_px_stride, dst_px_stride);
         return;
     }
+#elif ARCH_AARCH64
+    const unsigned flags = vmaf_get_cpu_flags();
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        convolution_f32_neon_xy_s(f, fwidth, src1, src2, dst, tmpbuf, w, h,
+                                  src1_px_stride, src2_px_stride, dst_px_stride);
+        return;
+    }
 #endif
 
     /* fall back */
@@ -21,8 +21,8 @@
 #include <immintrin.h>
 
 void adm_dwt2_8_avx2(const uint8_t *src, const adm_dwt_band_t *dst,
-                     AdmBuffer *buf, int w, int h, int src_stride,
-                     int dst_stride)
+                     AdmBuffer *buf, int w, int row_start, int row_end,
+                     int src_stride, int dst_stride)
 {
     const int16_t *filter_lo = dwt2_db2_coeffs_lo;
     const int16_t *filter_hi = dwt2_db2_coeffs_hi;
@@ -49,7 +49,7 @@ void adm_dwt2_8_avx2(const uint8_t *src, const adm_dwt_band_t *dst,
     __m256i pad_register = _mm256_setzero_si256();
     __m256i add_shift_HP_vex = _mm256_set1_epi32(32768);
 
-    for (int i = 0; i < (h + 1) / 2; ++i) {
+    for (int i = row_start; i < row_end; ++i) {
         /* Vertical pass. */
 
         for (int j = 0; j < w; j = j + 16) {
@@ -22,7 +22,7 @@
 #include "feature/integer_adm.h"
 
 void adm_dwt2_8_avx2(const uint8_t *src, const adm_dwt_band_t *dst,
-                     AdmBuffer *buf, int w, int h, int src_stride,
-                     int dst_stride);
+                     AdmBuffer *buf, int w, int row_start, int row_end,
+                     int src_stride, int dst_stride);
 
 #endif /* X86_AVX2_ADM_H_ */
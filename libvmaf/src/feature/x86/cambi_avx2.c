@@ -17,9 +17,15 @@
  */
 
 #include <immintrin.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "feature/common/macros.h"
+#include "cambi_avx2.h"
+
+#define TOPK_SCALAR_THRESHOLD 64
+
 void cambi_increment_range_avx2(uint16_t *arr, int left, int right) {
     __m256i val_vector = _mm256_set1_epi16(1);
     int col = left;
@@ -80,4 +86,383 @@ void get_derivative_data_for_row_avx2(const uint16_t *image_data, uint16_t *deri
             derivative_buffer[col] =  horizontal_derivative && vertical_derivative;
         }
     }
-}
\ No newline at end of file
+}
+
+void get_spatial_mask_row_avx2(uint16_t *mask_row, const uint32_t *dp_top, const uint32_t *dp_bottom,
+                               int width, uint16_t pad_size, uint16_t mask_index) {
+    const int right = 2 * pad_size + 1;
+    const __m256i threshold = _mm256_set1_epi32(mask_index);
+    int col = 0;
+    for (; col + 15 < width; col += 16) {
+        __m256i sum_lo = _mm256_sub_epi32(_mm256_loadu_si256((__m256i*) &dp_bottom[col + right]),
+                                          _mm256_loadu_si256((__m256i*) &dp_bottom[col]));
+        sum_lo = _mm256_sub_epi32(sum_lo, _mm256_loadu_si256((__m256i*) &dp_top[col + right]));
+        sum_lo = _mm256_add_epi32(sum_lo, _mm256_loadu_si256((__m256i*) &dp_top[col]));
+        __m256i sum_hi = _mm256_sub_epi32(_mm256_loadu_si256((__m256i*) &dp_bottom[col + 8 + right]),
+                                          _mm256_loadu_si256((__m256i*) &dp_bottom[col + 8]));
+        sum_hi = _mm256_sub_epi32(sum_hi, _mm256_loadu_si256((__m256i*) &dp_top[col + 8 + right]));
+        sum_hi = _mm256_add_epi32(sum_hi, _mm256_loadu_si256((__m256i*) &dp_top[col + 8]));
+        __m256i mask_lo = _mm256_srli_epi32(_mm256_cmpgt_epi32(sum_lo, threshold), 31);
+        __m256i mask_hi = _mm256_srli_epi32(_mm256_cmpgt_epi32(sum_hi, threshold), 31);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(mask_lo, mask_hi), 0xD8);
+        _mm256_storeu_si256((__m256i*) &mask_row[col], packed);
+    }
+    for (; col < width; col++) {
+        int result = dp_bottom[col + right] - dp_bottom[col] - dp_top[col + right] + dp_top[col];
+        mask_row[col] = (result > mask_index);
+    }
+}
+
+static FORCE_INLINE uint16_t mode3(uint16_t a, uint16_t b, uint16_t c) {
+    if (a == b || a == c) return a;
+    if (b == c) return b;
+    if (a <= b && a <= c) return a;
+    if (b <= c) return b;
+    return c;
+}
+
+static FORCE_INLINE __m256i mode3_avx2(__m256i a, __m256i b, __m256i c) {
+    __m256i eq_ab = _mm256_cmpeq_epi16(a, b);
+    __m256i eq_ac = _mm256_cmpeq_epi16(a, c);
+    __m256i eq_bc = _mm256_cmpeq_epi16(b, c);
+    __m256i min_abc = _mm256_min_epu16(_mm256_min_epu16(a, b), c);
+    __m256i result = _mm256_blendv_epi8(min_abc, b, eq_bc);
+    return _mm256_blendv_epi8(result, a, _mm256_or_si256(eq_ab, eq_ac));
+}
+
+void filter_mode_avx2(uint16_t *data, int width, int height, ptrdiff_t stride, uint16_t *buffer) {
+    int curr_line = 0;
+    for (int i = 0; i < height; i++) {
+        const uint16_t *row = &data[i * stride];
+        uint16_t *line = &buffer[curr_line * width];
+        line[0] = row[0];
+        int j = 1;
+        for (; j + 16 < width; j += 16) {
+            __m256i left = _mm256_loadu_si256((__m256i*) &row[j - 1]);
+            __m256i center = _mm256_loadu_si256((__m256i*) &row[j]);
+            __m256i right = _mm256_loadu_si256((__m256i*) &row[j + 1]);
+            _mm256_storeu_si256((__m256i*) &line[j], mode3_avx2(left, center, right));
+        }
+        for (; j < width - 1; j++) {
+            line[j] = mode3(row[j - 1], row[j], row[j + 1]);
+        }
+        line[width - 1] = row[width - 1];
+
+        if (i > 1) {
+            uint16_t *out = &data[(i - 1) * stride];
+            int j = 0;
+            for (; j + 15 < width; j += 16) {
+                __m256i top = _mm256_loadu_si256((__m256i*) &buffer[0 * width + j]);
+                __m256i middle = _mm256_loadu_si256((__m256i*) &buffer[1 * width + j]);
+                __m256i bottom = _mm256_loadu_si256((__m256i*) &buffer[2 * width + j]);
+                _mm256_storeu_si256((__m256i*) &out[j], mode3_avx2(top, middle, bottom));
+            }
+            for (; j < width; j++) {
+                out[j] = mode3(buffer[0 * width + j], buffer[1 * width + j], buffer[2 * width + j]);
+            }
+        }
+        curr_line = (curr_line + 1 == 3 ? 0 : curr_line + 1);
+    }
+}
+
+void decimate_avx2(uint16_t *data, int width, int height, ptrdiff_t stride) {
+    const __m256i even_mask = _mm256_set1_epi32(0xFFFF);
+    for (int i = 0; i < height; i++) {
+        uint16_t *out = &data[i * stride];
+        const uint16_t *in = &data[(i << 1) * stride];
+        int j = 0;
+        // Stay one element short of the row end so that the odd lanes never read past the input row
+        for (; j + 16 < width; j += 16) {
+            __m256i lo = _mm256_and_si256(_mm256_loadu_si256((__m256i*) &in[j << 1]), even_mask);
+            __m256i hi = _mm256_and_si256(_mm256_loadu_si256((__m256i*) &in[(j << 1) + 16]), even_mask);
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+            _mm256_storeu_si256((__m256i*) &out[j], packed);
+        }
+        for (; j < width; j++) {
+            out[j] = in[j << 1];
+        }
+    }
+}
+
+void anti_dithering_filter_avx2(uint16_t *data, int width, int height, ptrdiff_t stride) {
+    for (int i = 0; i < height - 1; i++) {
+        uint16_t *curr = &data[i * stride];
+        const uint16_t *next = &data[(i + 1) * stride];
+        int j = 0;
+        for (; j + 16 < width; j += 16) {
+            __m256i sum = _mm256_add_epi16(_mm256_loadu_si256((__m256i*) &curr[j]),
+                                           _mm256_loadu_si256((__m256i*) &curr[j + 1]));
+            sum = _mm256_add_epi16(sum, _mm256_loadu_si256((__m256i*) &next[j]));
+            sum = _mm256_add_epi16(sum, _mm256_loadu_si256((__m256i*) &next[j + 1]));
+            _mm256_storeu_si256((__m256i*) &curr[j], _mm256_srli_epi16(sum, 2));
+        }
+        for (; j < width - 1; j++) {
+            curr[j] = (curr[j] + curr[j + 1] + next[j] + next[j + 1]) >> 2;
+        }
+
+        // Last column
+        curr[width - 1] = (curr[width - 1] + next[width - 1]) >> 1;
+    }
+
+    // Last row
+    uint16_t *last = &data[(height - 1) * stride];
+    int j = 0;
+    for (; j + 16 < width; j += 16) {
+        __m256i sum = _mm256_add_epi16(_mm256_loadu_si256((__m256i*) &last[j]),
+                                       _mm256_loadu_si256((__m256i*) &last[j + 1]));
+        _mm256_storeu_si256((__m256i*) &last[j], _mm256_srli_epi16(sum, 1));
+    }
+    for (; j < width - 1; j++) {
+        last[j] = (last[j] + last[j + 1]) >> 1;
+    }
+}
+
+static FORCE_INLINE float c_value_pixel(const uint16_t *histograms, uint16_t value, const int *diff_weights,
+                                        const int *diffs, uint16_t num_diffs, const uint16_t *tvi_thresholds,
+                                        int histogram_col, int histogram_width) {
+    uint16_t p_0 = histograms[value * histogram_width + histogram_col];
+    float val, c_value = 0.0;
+    for (uint16_t d = 0; d < num_diffs; d++) {
+        if (value <= tvi_thresholds[d]) {
+            uint16_t p_1 = histograms[(value + diffs[num_diffs + d + 1]) * histogram_width + histogram_col];
+            uint16_t p_2 = histograms[(value + diffs[num_diffs - d - 1]) * histogram_width + histogram_col];
+            uint16_t p_max = p_1 > p_2 ? p_1 : p_2;
+            val = (float)(diff_weights[d] * p_0 * p_max) / (p_max + p_0);
+            if (val > c_value) {
+                c_value = val;
+            }
+        }
+    }
+    return c_value;
+}
+
+/*
+ * Eight histogram columns are handled per iteration. The histogram counts are fetched with
+ * 32-bit gathers (scale 2) and masked down to 16 bits, so the count of column col_end is
+ * read as well: it must not be written concurrently, and the histogram buffer needs 2 bytes
+ * of readable padding past its last entry. The arithmetic mirrors the scalar path exactly:
+ * the weighted product is formed in 32-bit integers and converted before the float division.
+ */
+void calculate_c_values_row_avx2(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                 const uint16_t *mask, int row, int col_start, int col_end,
+                                 int width, ptrdiff_t stride,
+                                 const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                 const int *diff_weights, const int *all_diffs) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i low_16 = _mm256_set1_epi32(0xFFFF);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i v_num_diffs = _mm256_set1_epi32(num_diffs);
+    const __m256i v_width = _mm256_set1_epi32(width);
+    const int *hist = (const int *)histograms;
+
+    int col = col_start;
+    for (; col + 7 < col_end; col += 8) {
+        __m128i mask_16 = _mm_loadu_si128((__m128i*) &mask[row * stride + col]);
+        if (_mm_testz_si128(mask_16, mask_16)) continue;
+        __m256i mask_32 = _mm256_cmpgt_epi32(_mm256_cvtepu16_epi32(mask_16), zero);
+
+        __m256i value = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i*) &image[row * stride + col]));
+        value = _mm256_add_epi32(value, v_num_diffs);
+        __m256i index_0 = _mm256_add_epi32(_mm256_mullo_epi32(value, v_width),
+                                           _mm256_add_epi32(_mm256_set1_epi32(col), lanes));
+        __m256i p_0 = _mm256_and_si256(_mm256_i32gather_epi32(hist, index_0, 2), low_16);
+
+        __m256 c_value = _mm256_setzero_ps();
+        for (int d = 0; d < num_diffs; d++) {
+            __m256i visible = _mm256_cmpgt_epi32(_mm256_set1_epi32(tvi_for_diff[d] + 1), value);
+            visible = _mm256_and_si256(visible, mask_32);
+            if (_mm256_testz_si256(visible, visible)) continue;
+
+            __m256i index_1 = _mm256_add_epi32(index_0, _mm256_set1_epi32(all_diffs[num_diffs + d + 1] * width));
+            __m256i index_2 = _mm256_add_epi32(index_0, _mm256_set1_epi32(all_diffs[num_diffs - d - 1] * width));
+            __m256i p_1 = _mm256_and_si256(_mm256_i32gather_epi32(hist, index_1, 2), low_16);
+            __m256i p_2 = _mm256_and_si256(_mm256_i32gather_epi32(hist, index_2, 2), low_16);
+            __m256i p_max = _mm256_max_epi32(p_1, p_2);
+
+            __m256i numerator = _mm256_mullo_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(diff_weights[d]), p_0), p_max);
+            __m256 val = _mm256_div_ps(_mm256_cvtepi32_ps(numerator),
+                                       _mm256_cvtepi32_ps(_mm256_add_epi32(p_max, p_0)));
+            val = _mm256_and_ps(val, _mm256_castsi256_ps(visible));
+            c_value = _mm256_max_ps(c_value, val);
+        }
+        _mm256_maskstore_ps(&c_values[row * width + col], mask_32, c_value);
+    }
+    for (; col < col_end; col++) {
+        if (mask[row * stride + col]) {
+            c_values[row * width + col] = c_value_pixel(
+                histograms, image[row * stride + col] + num_diffs, diff_weights, all_diffs, num_diffs, tvi_for_diff, col, width
+            );
+        }
+    }
+}
+
+/*
+ * Compress permutations for _mm256_permutevar8x32_ps, indexed by a movemask.
+ * Bits 3*i..3*i+2 hold the source lane of output lane i, bits 24..27 the popcount.
+ */
+static const uint32_t compress_lut[256] = {
+    0x0000000, 0x1000000, 0x1000001, 0x2000008, 0x1000002, 0x2000010, 0x2000011, 0x3000088,
+    0x1000003, 0x2000018, 0x2000019, 0x30000c8, 0x200001a, 0x30000d0, 0x30000d1, 0x4000688,
+    0x1000004, 0x2000020, 0x2000021, 0x3000108, 0x2000022, 0x3000110, 0x3000111, 0x4000888,
+    0x2000023, 0x3000118, 0x3000119, 0x40008c8, 0x300011a, 0x40008d0, 0x40008d1, 0x5004688,
+    0x1000005, 0x2000028, 0x2000029, 0x3000148, 0x200002a, 0x3000150, 0x3000151, 0x4000a88,
+    0x200002b, 0x3000158, 0x3000159, 0x4000ac8, 0x300015a, 0x4000ad0, 0x4000ad1, 0x5005688,
+    0x200002c, 0x3000160, 0x3000161, 0x4000b08, 0x3000162, 0x4000b10, 0x4000b11, 0x5005888,
+    0x3000163, 0x4000b18, 0x4000b19, 0x50058c8, 0x4000b1a, 0x50058d0, 0x50058d1, 0x602c688,
+    0x1000006, 0x2000030, 0x2000031, 0x3000188, 0x2000032, 0x3000190, 0x3000191, 0x4000c88,
+    0x2000033, 0x3000198, 0x3000199, 0x4000cc8, 0x300019a, 0x4000cd0, 0x4000cd1, 0x5006688,
+    0x2000034, 0x30001a0, 0x30001a1, 0x4000d08, 0x30001a2, 0x4000d10, 0x4000d11, 0x5006888,
+    0x30001a3, 0x4000d18, 0x4000d19, 0x50068c8, 0x4000d1a, 0x50068d0, 0x50068d1, 0x6034688,
+    0x2000035, 0x30001a8, 0x30001a9, 0x4000d48, 0x30001aa, 0x4000d50, 0x4000d51, 0x5006a88,
+    0x30001ab, 0x4000d58, 0x4000d59, 0x5006ac8, 0x4000d5a, 0x5006ad0, 0x5006ad1, 0x6035688,
+    0x30001ac, 0x4000d60, 0x4000d61, 0x5006b08, 0x4000d62, 0x5006b10, 0x5006b11, 0x6035888,
+    0x4000d63, 0x5006b18, 0x5006b19, 0x60358c8, 0x5006b1a, 0x60358d0, 0x60358d1, 0x71ac688,
+    0x1000007, 0x2000038, 0x2000039, 0x30001c8, 0x200003a, 0x30001d0, 0x30001d1, 0x4000e88,
+    0x200003b, 0x30001d8, 0x30001d9, 0x4000ec8, 0x30001da, 0x4000ed0, 0x4000ed1, 0x5007688,
+    0x200003c, 0x30001e0, 0x30001e1, 0x4000f08, 0x30001e2, 0x4000f10, 0x4000f11, 0x5007888,
+    0x30001e3, 0x4000f18, 0x4000f19, 0x50078c8, 0x4000f1a, 0x50078d0, 0x50078d1, 0x603c688,
+    0x200003d, 0x30001e8, 0x30001e9, 0x4000f48, 0x30001ea, 0x4000f50, 0x4000f51, 0x5007a88,
+    0x30001eb, 0x4000f58, 0x4000f59, 0x5007ac8, 0x4000f5a, 0x5007ad0, 0x5007ad1, 0x603d688,
+    0x30001ec, 0x4000f60, 0x4000f61, 0x5007b08, 0x4000f62, 0x5007b10, 0x5007b11, 0x603d888,
+    0x4000f63, 0x5007b18, 0x5007b19, 0x603d8c8, 0x5007b1a, 0x603d8d0, 0x603d8d1, 0x71ec688,
+    0x200003e, 0x30001f0, 0x30001f1, 0x4000f88, 0x30001f2, 0x4000f90, 0x4000f91, 0x5007c88,
+    0x30001f3, 0x4000f98, 0x4000f99, 0x5007cc8, 0x4000f9a, 0x5007cd0, 0x5007cd1, 0x603e688,
+    0x30001f4, 0x4000fa0, 0x4000fa1, 0x5007d08, 0x4000fa2, 0x5007d10, 0x5007d11, 0x603e888,
+    0x4000fa3, 0x5007d18, 0x5007d19, 0x603e8c8, 0x5007d1a, 0x603e8d0, 0x603e8d1, 0x71f4688,
+    0x30001f5, 0x4000fa8, 0x4000fa9, 0x5007d48, 0x4000faa, 0x5007d50, 0x5007d51, 0x603ea88,
+    0x4000fab, 0x5007d58, 0x5007d59, 0x603eac8, 0x5007d5a, 0x603ead0, 0x603ead1, 0x71f5688,
+    0x4000fac, 0x5007d60, 0x5007d61, 0x603eb08, 0x5007d62, 0x603eb10, 0x603eb11, 0x71f5888,
+    0x5007d63, 0x603eb18, 0x603eb19, 0x71f58c8, 0x603eb1a, 0x71f58d0, 0x71f58d1, 0x8fac688,
+};
+
+static FORCE_INLINE int compress_store_ps(float *dst, __m256 v, int mask) {
+    const __m256i shifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    uint32_t entry = compress_lut[mask];
+    int count = entry >> 24;
+    __m256i permutation = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(entry), shifts),
+                                           _mm256_set1_epi32(7));
+    __m256i store_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), lanes);
+    _mm256_maskstore_ps(dst, store_mask, _mm256_permutevar8x32_ps(v, permutation));
+    return count;
+}
+
+static double sum_elements_avx2(const float *arr, int n) {
+    __m256d acc_lo = _mm256_setzero_pd();
+    __m256d acc_hi = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 7 < n; i += 8) {
+        __m256 v = _mm256_loadu_ps(&arr[i]);
+        acc_lo = _mm256_add_pd(acc_lo, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        acc_hi = _mm256_add_pd(acc_hi, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+    __m256d acc = _mm256_add_pd(acc_lo, acc_hi);
+    __m128d acc_128 = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(acc_128, _mm_unpackhi_pd(acc_128, acc_128)));
+    for (; i < n; i++) {
+        sum += arr[i];
+    }
+    return sum;
+}
+
+static double topk_sum_scalar(float *arr, int n, int k) {
+    if (k < n) {
+        int left = 0;
+        int right = n - 1;
+        while (left < right) {
+            float pivot = arr[k];
+            int i = left;
+            int j = right;
+            do {
+                while (arr[i] > pivot) {
+                    i++;
+                }
+                while (arr[j] < pivot) {
+                    j--;
+                }
+                if (i <= j) {
+                    float tmp = arr[i];
+                    arr[i] = arr[j];
+                    arr[j] = tmp;
+                    i++;
+                    j--;
+                }
+            } while (i <= j);
+            if (j < k) {
+                left = i;
+            }
+            if (k < i) {
+                right = j;
+            }
+        }
+    }
+    double sum = 0;
+    for (int i = 0; i < k; i++)
+        sum += arr[i];
+    return sum;
+}
+
+static FORCE_INLINE float median3(float a, float b, float c) {
+    if (a > b) {
+        float tmp = a;
+        a = b;
+        b = tmp;
+    }
+    return c <= a ? a : (c >= b ? b : c);
+}
+
+/*
+ * Averages the k largest elements of arr (which is reordered in the process).
+ * Each round partitions the candidates three-way around a median-of-3 pivot:
+ * greater elements are compressed into buffer, smaller ones in place into arr.
+ * Whenever the greater side is entirely part of the top-k it is summed and
+ * dropped, so only one side is ever carried into the next round.
+ * buffer needs room for n floats.
+ */
+double average_topk_elements_select_avx2(float *arr, int n, int k, float *buffer) {
+    const int topk_elements = k;
+    double sum = 0.0;
+    float *src = arr;
+    float *dst = buffer;
+    int len = n;
+
+    while (len > TOPK_SCALAR_THRESHOLD && k < len) {
+        const float pivot = median3(src[0], src[len >> 1], src[len - 1]);
+        const __m256 v_pivot = _mm256_set1_ps(pivot);
+        int num_greater = 0;
+        int num_less = 0;
+        int i = 0;
+        for (; i + 7 < len; i += 8) {
+            __m256 v = _mm256_loadu_ps(&src[i]);
+            int greater = _mm256_movemask_ps(_mm256_cmp_ps(v, v_pivot, _CMP_GT_OQ));
+            int less = _mm256_movemask_ps(_mm256_cmp_ps(v, v_pivot, _CMP_LT_OQ));
+            num_greater += compress_store_ps(&dst[num_greater], v, greater);
+            num_less += compress_store_ps(&src[num_less], v, less);
+        }
+        for (; i < len; i++) {
+            float v = src[i];
+            if (v > pivot) dst[num_greater++] = v;
+            else if (v < pivot) src[num_less++] = v;
+        }
+        const int num_equal = len - num_greater - num_less;
+
+        if (k <= num_greater) {
+            float *tmp = src;
+            src = dst;
+            dst = tmp;
+            len = num_greater;
+            continue;
+        }
+        sum += sum_elements_avx2(dst, num_greater);
+        if (k <= num_greater + num_equal) {
+            sum += (double)pivot * (k - num_greater);
+            return sum / topk_elements;
+        }
+        sum += (double)pivot * num_equal;
+        k -= num_greater + num_equal;
+        len = num_less;
+    }
+
+    sum += topk_sum_scalar(src, len, k);
+    return sum / topk_elements;
+}
@@ -28,4 +28,21 @@ void cambi_decrement_range_avx2(uint16_t *arr, int left, int right);
 
 void get_derivative_data_for_row_avx2(const uint16_t *image_data, uint16_t *derivative_buffer, int width, int height, int row, int stride);
 
+void get_spatial_mask_row_avx2(uint16_t *mask_row, const uint32_t *dp_top, const uint32_t *dp_bottom,
+                               int width, uint16_t pad_size, uint16_t mask_index);
+
+void filter_mode_avx2(uint16_t *data, int width, int height, ptrdiff_t stride, uint16_t *buffer);
+
+void decimate_avx2(uint16_t *data, int width, int height, ptrdiff_t stride);
+
+void anti_dithering_filter_avx2(uint16_t *data, int width, int height, ptrdiff_t stride);
+
+void calculate_c_values_row_avx2(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                 const uint16_t *mask, int row, int col_start, int col_end,
+                                 int width, ptrdiff_t stride,
+                                 const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                 const int *diff_weights, const int *all_diffs);
+
+double average_topk_elements_select_avx2(float *arr, int n, int k, float *buffer);
+
 #endif /* X86_AVX2_CAMBI_H_ */
@@ -0,0 +1,182 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "feature/common/macros.h"
+#include "cambi_avx512.h"
+
+void cambi_increment_range_avx512(uint16_t *arr, int left, int right) {
+    const __m512i ones = _mm512_set1_epi16(1);
+    int col = left;
+    for (; col + 31 < right; col += 32) {
+        __m512i data = _mm512_loadu_si512((__m512i*) &arr[col]);
+        _mm512_storeu_si512((__m512i*) &arr[col], _mm512_add_epi16(data, ones));
+    }
+    if (col < right) {
+        __mmask32 tail = (__mmask32)((1ULL << (right - col)) - 1);
+        __m512i data = _mm512_maskz_loadu_epi16(tail, &arr[col]);
+        _mm512_mask_storeu_epi16(&arr[col], tail, _mm512_add_epi16(data, ones));
+    }
+}
+
+void cambi_decrement_range_avx512(uint16_t *arr, int left, int right) {
+    const __m512i ones = _mm512_set1_epi16(1);
+    int col = left;
+    for (; col + 31 < right; col += 32) {
+        __m512i data = _mm512_loadu_si512((__m512i*) &arr[col]);
+        _mm512_storeu_si512((__m512i*) &arr[col], _mm512_sub_epi16(data, ones));
+    }
+    if (col < right) {
+        __mmask32 tail = (__mmask32)((1ULL << (right - col)) - 1);
+        __m512i data = _mm512_maskz_loadu_epi16(tail, &arr[col]);
+        _mm512_mask_storeu_epi16(&arr[col], tail, _mm512_sub_epi16(data, ones));
+    }
+}
+
+/*
+ * Same scheme as the AVX2 kernel with sixteen columns per iteration, reading the count of
+ * column col_end as well; the row tail is handled with a lane mask, so only the histogram
+ * padding of 2 bytes is required.
+ */
+void calculate_c_values_row_avx512(float *c_values, const uint16_t *histograms, const uint16_t *image,
+                                   const uint16_t *mask, int row, int col_start, int col_end,
+                                   int width, ptrdiff_t stride,
+                                   const uint16_t num_diffs, const uint16_t *tvi_for_diff,
+                                   const int *diff_weights, const int *all_diffs) {
+    const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i low_16 = _mm512_set1_epi32(0xFFFF);
+    const __m512i v_num_diffs = _mm512_set1_epi32(num_diffs);
+    const __m512i v_width = _mm512_set1_epi32(width);
+    const int *hist = (const int *)histograms;
+
+    for (int col = col_start; col < col_end; col += 16) {
+        __mmask16 tail = col_end - col >= 16 ? 0xFFFF : (__mmask16)((1u << (col_end - col)) - 1);
+        __m512i mask_32 = _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(tail, &mask[row * stride + col]));
+        __mmask16 active = _mm512_test_epi32_mask(mask_32, mask_32);
+        if (!active) continue;
+
+        __m512i value = _mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(tail, &image[row * stride + col]));
+        value = _mm512_add_epi32(value, v_num_diffs);
+        __m512i index_0 = _mm512_add_epi32(_mm512_mullo_epi32(value, v_width),
+                                           _mm512_add_epi32(_mm512_set1_epi32(col), lanes));
+        __m512i p_0 = _mm512_and_si512(_mm512_mask_i32gather_epi32(_mm512_setzero_si512(), active, index_0, hist, 2),
+                                       low_16);
+
+        __m512 c_value = _mm512_setzero_ps();
+        for (int d = 0; d < num_diffs; d++) {
+            __mmask16 visible = _mm512_mask_cmple_epi32_mask(active, value, _mm512_set1_epi32(tvi_for_diff[d]));
+            if (!visible) continue;
+
+            __m512i index_1 = _mm512_add_epi32(index_0, _mm512_set1_epi32(all_diffs[num_diffs + d + 1] * width));
+            __m512i index_2 = _mm512_add_epi32(index_0, _mm512_set1_epi32(all_diffs[num_diffs - d - 1] * width));
+            __m512i p_1 = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), visible, index_1, hist, 2);
+            __m512i p_2 = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), visible, index_2, hist, 2);
+            __m512i p_max = _mm512_max_epi32(_mm512_and_si512(p_1, low_16), _mm512_and_si512(p_2, low_16));
+
+            __m512i numerator = _mm512_mullo_epi32(_mm512_mullo_epi32(_mm512_set1_epi32(diff_weights[d]), p_0), p_max);
+            __m512 val = _mm512_maskz_div_ps(visible, _mm512_cvtepi32_ps(numerator),
+                                             _mm512_cvtepi32_ps(_mm512_add_epi32(p_max, p_0)));
+            c_value = _mm512_max_ps(c_value, val);
+        }
+        _mm512_mask_storeu_ps(&c_values[row * width + col], active, c_value);
+    }
+}
+
+static FORCE_INLINE int popcount16(__mmask16 mask) {
+    unsigned v = mask;
+    v = v - ((v >> 1) & 0x5555);
+    v = (v & 0x3333) + ((v >> 2) & 0x3333);
+    v = (v + (v >> 4)) & 0x0F0F;
+    return (v + (v >> 8)) & 0x1F;
+}
+
+static FORCE_INLINE float median3(float a, float b, float c) {
+    if (a > b) {
+        float tmp = a;
+        a = b;
+        b = tmp;
+    }
+    return c <= a ? a : (c >= b ? b : c);
+}
+
+static double sum_elements_avx512(const float *arr, int n) {
+    __m512d acc_lo = _mm512_setzero_pd();
+    __m512d acc_hi = _mm512_setzero_pd();
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 tail = n - i >= 16 ? 0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+        __m512 v = _mm512_maskz_loadu_ps(tail, &arr[i]);
+        acc_lo = _mm512_add_pd(acc_lo, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+        acc_hi = _mm512_add_pd(acc_hi, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1))));
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc_lo, acc_hi));
+}
+
+/*
+ * Averages the k largest elements of arr (which is reordered in the process), see
+ * average_topk_elements_select_avx2(). The compress stores make the partitioning
+ * cheap enough to run all the way down, so there is no scalar fallback here.
+ * buffer needs room for n floats.
+ */
+double average_topk_elements_select_avx512(float *arr, int n, int k, float *buffer) {
+    const int topk_elements = k;
+    double sum = 0.0;
+    float *src = arr;
+    float *dst = buffer;
+    int len = n;
+
+    while (k < len) {
+        const float pivot = median3(src[0], src[len >> 1], src[len - 1]);
+        const __m512 v_pivot = _mm512_set1_ps(pivot);
+        int num_greater = 0;
+        int num_less = 0;
+        for (int i = 0; i < len; i += 16) {
+            __mmask16 tail = len - i >= 16 ? 0xFFFF : (__mmask16)((1u << (len - i)) - 1);
+            __m512 v = _mm512_maskz_loadu_ps(tail, &src[i]);
+            __mmask16 greater = _mm512_mask_cmp_ps_mask(tail, v, v_pivot, _CMP_GT_OQ);
+            __mmask16 less = _mm512_mask_cmp_ps_mask(tail, v, v_pivot, _CMP_LT_OQ);
+            _mm512_mask_compressstoreu_ps(&dst[num_greater], greater, v);
+            num_greater += popcount16(greater);
+            _mm512_mask_compressstoreu_ps(&src[num_less], less, v);
+            num_less += popcount16(less);
+        }
+        const int num_equal = len - num_greater - num_less;
+
+        if (k <= num_greater) {
+            float *tmp = src;
+            src = dst;
+            dst = tmp;
+            len = num_greater;
+            continue;
+        }
+        sum += sum_elements_avx512(dst, num_greater);
+        if (k <= num_greater + num_equal) {
+            sum += (double)pivot * (k - num_greater);
+            return sum / topk_elements;
+        }
+        sum += (double)pivot * num_equal;
+        k -= num_greater + num_equal;
+        len = num_less;
+    }
+
+    sum += sum_elements_avx512(src, len);
+    return sum / topk_elements;
+}
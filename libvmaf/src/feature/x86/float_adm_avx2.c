@@ -0,0 +1,344 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "feature/adm_tools.h"
+#include "feature/common/macros.h"
+#include "float_adm_avx2.h"
+
+/*
+ * These kernels reproduce the scalar float ADM operation by operation: the
+ * `accum = 0; accum += ...` chains start from zero, the terms the scalar code
+ * evaluates in double (FLOAT_ONE_BY_15 and FLOAT_ONE_BY_30 are double
+ * literals) are evaluated in double, and divisions use the same refined
+ * rcpps estimate as DIVS(). Row reductions are transposed so that every lane
+ * accumulates one row in column order.
+ */
+
+static const float dwt2_db2_coeffs_lo_s[4] = { 0.482962913144690, 0.836516303737469, 0.224143868041857, -0.129409522550921 };
+static const float dwt2_db2_coeffs_hi_s[4] = { -0.129409522550921, -0.224143868041857, 0.836516303737469, -0.482962913144690 };
+
+static FORCE_INLINE __m256 abs_ps(__m256 x)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+static FORCE_INLINE __m256 filter4(const float *f, __m256 s0, __m256 s1,
+                                   __m256 s2, __m256 s3)
+{
+    __m256 accum = _mm256_setzero_ps();
+    accum = _mm256_add_ps(accum, _mm256_mul_ps(_mm256_set1_ps(f[0]), s0));
+    accum = _mm256_add_ps(accum, _mm256_mul_ps(_mm256_set1_ps(f[1]), s1));
+    accum = _mm256_add_ps(accum, _mm256_mul_ps(_mm256_set1_ps(f[2]), s2));
+    accum = _mm256_add_ps(accum, _mm256_mul_ps(_mm256_set1_ps(f[3]), s3));
+    return accum;
+}
+
+/* (float)((double)sum + c * (double)x), as done by `float += double` */
+static FORCE_INLINE __m256 add_scaled_pd(__m256 sum, __m256 x, double c)
+{
+    const __m256d cd = _mm256_set1_pd(c);
+    __m256d lo = _mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(sum)),
+            _mm256_mul_pd(cd, _mm256_cvtps_pd(_mm256_castps256_ps128(x))));
+    __m256d hi = _mm256_add_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(sum, 1)),
+            _mm256_mul_pd(cd, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1))));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)),
+                                _mm256_cvtpd_ps(hi), 1);
+}
+
+static FORCE_INLINE __m256 mul_pd(__m256 x, double c)
+{
+    const __m256d cd = _mm256_set1_pd(c);
+    __m256d lo = _mm256_mul_pd(cd, _mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+    __m256d hi = _mm256_mul_pd(cd, _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)),
+                                _mm256_cvtpd_ps(hi), 1);
+}
+
+static FORCE_INLINE __m256 divs_ps(__m256 n, __m256 d)
+{
+    const __m256 xi = _mm256_rcp_ps(d);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 r = _mm256_add_ps(xi,
+            _mm256_mul_ps(xi, _mm256_sub_ps(one, _mm256_mul_ps(d, xi))));
+    return _mm256_mul_ps(n, r);
+}
+
+static FORCE_INLINE void transpose8(__m256 r[8])
+{
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44);
+    __m256 u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44);
+    __m256 u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44);
+    __m256 u5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44);
+    __m256 u7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+/* adds the values of 8 rows (one vector per row) column by column */
+static FORCE_INLINE __m256 accum_rows8(__m256 accum, __m256 v[8])
+{
+    transpose8(v);
+    for (int c = 0; c < 8; c++)
+        accum = _mm256_add_ps(accum, v[c]);
+    return accum;
+}
+
+static FORCE_INLINE __m256 load_accum(float (*accum)[3], int theta)
+{
+    return _mm256_setr_ps(accum[0][theta], accum[1][theta], accum[2][theta],
+                          accum[3][theta], accum[4][theta], accum[5][theta],
+                          accum[6][theta], accum[7][theta]);
+}
+
+static FORCE_INLINE void store_accum(float (*accum)[3], int theta, __m256 v)
+{
+    float tmp[8];
+    _mm256_storeu_ps(tmp, v);
+    for (int r = 0; r < 8; r++)
+        accum[r][theta] = tmp[r];
+}
+
+/* even and odd elements of p[0..15] */
+static FORCE_INLINE void deinterleave(const float *p, __m256 *even, __m256 *odd)
+{
+    const __m256 a = _mm256_loadu_ps(p);
+    const __m256 b = _mm256_loadu_ps(p + 8);
+    *even = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                _mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xD8));
+    *odd = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                _mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xDD)), 0xD8));
+}
+
+static int adm_dwt2_v_avx2(const float *const src[4], float *tmplo,
+                           float *tmphi, int j_start, int j_end)
+{
+    int j;
+    for (j = j_start; j + 8 <= j_end; j += 8) {
+        const __m256 s0 = _mm256_loadu_ps(src[0] + j);
+        const __m256 s1 = _mm256_loadu_ps(src[1] + j);
+        const __m256 s2 = _mm256_loadu_ps(src[2] + j);
+        const __m256 s3 = _mm256_loadu_ps(src[3] + j);
+        _mm256_storeu_ps(tmplo + j, filter4(dwt2_db2_coeffs_lo_s, s0, s1, s2, s3));
+        _mm256_storeu_ps(tmphi + j, filter4(dwt2_db2_coeffs_hi_s, s0, s1, s2, s3));
+    }
+    return j;
+}
+
+static int adm_dwt2_h_avx2(const float *tmplo, const float *tmphi,
+                           float *const dst[4], int j_start, int j_end)
+{
+    int j;
+    for (j = j_start; j + 8 <= j_end; j += 8) {
+        __m256 s0, s1, s2, s3;
+        deinterleave(tmplo + 2 * j - 1, &s0, &s1);
+        deinterleave(tmplo + 2 * j + 1, &s2, &s3);
+        _mm256_storeu_ps(dst[0] + j, filter4(dwt2_db2_coeffs_lo_s, s0, s1, s2, s3));
+        _mm256_storeu_ps(dst[1] + j, filter4(dwt2_db2_coeffs_hi_s, s0, s1, s2, s3));
+        deinterleave(tmphi + 2 * j - 1, &s0, &s1);
+        deinterleave(tmphi + 2 * j + 1, &s2, &s3);
+        _mm256_storeu_ps(dst[2] + j, filter4(dwt2_db2_coeffs_lo_s, s0, s1, s2, s3));
+        _mm256_storeu_ps(dst[3] + j, filter4(dwt2_db2_coeffs_hi_s, s0, s1, s2, s3));
+    }
+    return j;
+}
+
+static FORCE_INLINE __m256 enhn_gain(__m256 rst, __m256 t, __m256 angle_flag,
+                                     __m256 egl)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 m = _mm256_and_ps(angle_flag, _mm256_cmp_ps(rst, zero, _CMP_GT_OQ));
+    rst = _mm256_blendv_ps(rst, _mm256_min_ps(_mm256_mul_ps(rst, egl), t), m);
+    m = _mm256_and_ps(angle_flag, _mm256_cmp_ps(rst, zero, _CMP_LT_OQ));
+    return _mm256_blendv_ps(rst, _mm256_max_ps(_mm256_mul_ps(rst, egl), t), m);
+}
+
+static int adm_decouple_avx2(const float *const ref[3], const float *const dis[3],
+                             float *const r[3], float *const a[3], int j_start,
+                             int j_end, float adm_enhn_gain_limit)
+{
+    const float cos_1deg_sq = cos(1.0 * M_PI / 180.0) * cos(1.0 * M_PI / 180.0);
+    const __m256 cos_sq = _mm256_set1_ps(cos_1deg_sq);
+    const __m256 eps = _mm256_set1_ps(1e-30f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 egl = _mm256_set1_ps(adm_enhn_gain_limit);
+
+    int j;
+    for (j = j_start; j + 8 <= j_end; j += 8) {
+        __m256 o[3], t[3], rst[3];
+        for (int b = 0; b < 3; b++) {
+            o[b] = _mm256_loadu_ps(ref[b] + j);
+            t[b] = _mm256_loadu_ps(dis[b] + j);
+            __m256 k = divs_ps(t[b], _mm256_add_ps(o[b], eps));
+            k = _mm256_max_ps(zero, _mm256_min_ps(one, k));
+            rst[b] = _mm256_mul_ps(k, o[b]);
+        }
+
+        const __m256 ot_dp = _mm256_add_ps(_mm256_mul_ps(o[0], t[0]),
+                                           _mm256_mul_ps(o[1], t[1]));
+        const __m256 o_mag_sq = _mm256_add_ps(_mm256_mul_ps(o[0], o[0]),
+                                              _mm256_mul_ps(o[1], o[1]));
+        const __m256 t_mag_sq = _mm256_add_ps(_mm256_mul_ps(t[0], t[0]),
+                                              _mm256_mul_ps(t[1], t[1]));
+        const __m256 angle_flag = _mm256_and_ps(
+                _mm256_cmp_ps(ot_dp, zero, _CMP_GE_OQ),
+                _mm256_cmp_ps(_mm256_mul_ps(ot_dp, ot_dp),
+                              _mm256_mul_ps(_mm256_mul_ps(cos_sq, o_mag_sq), t_mag_sq),
+                              _CMP_GE_OQ));
+
+        for (int b = 0; b < 3; b++) {
+            rst[b] = enhn_gain(rst[b], t[b], angle_flag, egl);
+            _mm256_storeu_ps(r[b] + j, rst[b]);
+            _mm256_storeu_ps(a[b] + j, _mm256_sub_ps(t[b], rst[b]));
+        }
+    }
+    return j;
+}
+
+static int adm_csf_avx2(const float *src, float *dst, float *flt, float rfactor,
+                        int j_start, int j_end)
+{
+    const __m256 rf = _mm256_set1_ps(rfactor);
+    int j;
+    for (j = j_start; j + 8 <= j_end; j += 8) {
+        const __m256 dst_val = _mm256_mul_ps(rf, _mm256_loadu_ps(src + j));
+        _mm256_storeu_ps(dst + j, dst_val);
+        _mm256_storeu_ps(flt + j, mul_pd(abs_ps(dst_val), FLOAT_ONE_BY_30));
+    }
+    return j;
+}
+
+static int adm_csf_den_rows_avx2(const float *const src[3], int src_px_stride,
+                                 const float rfactor[3], int j_start, int j_end,
+                                 float (*accum)[3])
+{
+    int j = j_start;
+    for (int theta = 0; theta < 3; theta++) {
+        const __m256 rf = _mm256_set1_ps(rfactor[theta]);
+        __m256 acc = load_accum(accum, theta);
+        for (j = j_start; j + 8 <= j_end; j += 8) {
+            __m256 v[8];
+            for (int r = 0; r < 8; r++) {
+                const __m256 x = abs_ps(_mm256_mul_ps(rf,
+                        _mm256_loadu_ps(src[theta] + r * src_px_stride + j)));
+                v[r] = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+            }
+            acc = accum_rows8(acc, v);
+        }
+        store_accum(accum, theta, acc);
+    }
+    return j;
+}
+
+/* threshold of ADM_CM_THRESH_S_I_J for the 8 columns at j of one row */
+static FORCE_INLINE __m256 cm_thresh(const float *const csf_a[3],
+                                     const float *const csf_f[3],
+                                     int stride, int j)
+{
+    __m256 thr = _mm256_setzero_ps();
+    for (int theta = 0; theta < 3; theta++) {
+        const float *a = csf_a[theta] + j;
+        const float *f = csf_f[theta] + j - stride;
+        __m256 sum = _mm256_setzero_ps();
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f - 1));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f + 1));
+        f += stride;
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f - 1));
+        sum = add_scaled_pd(sum, abs_ps(_mm256_loadu_ps(a)), FLOAT_ONE_BY_15);
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f + 1));
+        f += stride;
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f - 1));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f));
+        sum = _mm256_add_ps(sum, _mm256_loadu_ps(f + 1));
+        thr = _mm256_add_ps(thr, sum);
+    }
+    return thr;
+}
+
+static int adm_cm_rows_avx2(const float *const src[3], int src_px_stride,
+                            const float *const csf_a[3],
+                            const float *const csf_f[3], int csf_px_stride,
+                            const float rfactor[3], int j_start, int j_end,
+                            float (*accum)[3])
+{
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 acc[3];
+    for (int theta = 0; theta < 3; theta++)
+        acc[theta] = load_accum(accum, theta);
+
+    int j;
+    for (j = j_start; j + 8 <= j_end; j += 8) {
+        __m256 v[3][8];
+        for (int r = 0; r < 8; r++) {
+            const float *a_rows[3] = {
+                csf_a[0] + r * csf_px_stride, csf_a[1] + r * csf_px_stride,
+                csf_a[2] + r * csf_px_stride,
+            };
+            const float *f_rows[3] = {
+                csf_f[0] + r * csf_px_stride, csf_f[1] + r * csf_px_stride,
+                csf_f[2] + r * csf_px_stride,
+            };
+            const __m256 thr = cm_thresh(a_rows, f_rows, csf_px_stride, j);
+            for (int theta = 0; theta < 3; theta++) {
+                __m256 x = _mm256_mul_ps(
+                        _mm256_loadu_ps(src[theta] + r * src_px_stride + j),
+                        _mm256_set1_ps(rfactor[theta]));
+                x = _mm256_max_ps(zero, _mm256_sub_ps(abs_ps(x), thr));
+                v[theta][r] = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+            }
+        }
+        for (int theta = 0; theta < 3; theta++)
+            acc[theta] = accum_rows8(acc[theta], v[theta]);
+    }
+
+    for (int theta = 0; theta < 3; theta++)
+        store_accum(accum, theta, acc[theta]);
+    return j;
+}
+
+void adm_float_kernels_avx2(AdmFloatKernels *k)
+{
+    k->dwt2_v = adm_dwt2_v_avx2;
+    k->dwt2_h = adm_dwt2_h_avx2;
+    k->decouple = adm_decouple_avx2;
+    k->csf = adm_csf_avx2;
+    k->csf_den_rows = adm_csf_den_rows_avx2;
+    k->cm_rows = adm_cm_rows_avx2;
+    k->rows = 8;
+}
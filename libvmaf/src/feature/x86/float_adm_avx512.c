@@ -0,0 +1,349 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <immintrin.h>
+#include <math.h>
+
+#include "feature/adm_tools.h"
+#include "feature/common/macros.h"
+#include "float_adm_avx512.h"
+
+/*
+ * 16 column variant of the kernels in float_adm_avx2.c, bit-exact with them
+ * and with the scalar code. Reciprocals are taken with two 256-bit rcpps
+ * rather than rcp14ps so that DIVS() is reproduced exactly, and row
+ * reductions transpose the low and high 8 columns separately.
+ */
+
+static const float dwt2_db2_coeffs_lo_s[4] = { 0.482962913144690, 0.836516303737469, 0.224143868041857, -0.129409522550921 };
+static const float dwt2_db2_coeffs_hi_s[4] = { -0.129409522550921, -0.224143868041857, 0.836516303737469, -0.482962913144690 };
+
+static FORCE_INLINE __m512 filter4(const float *f, __m512 s0, __m512 s1,
+                                   __m512 s2, __m512 s3)
+{
+    __m512 accum = _mm512_setzero_ps();
+    accum = _mm512_add_ps(accum, _mm512_mul_ps(_mm512_set1_ps(f[0]), s0));
+    accum = _mm512_add_ps(accum, _mm512_mul_ps(_mm512_set1_ps(f[1]), s1));
+    accum = _mm512_add_ps(accum, _mm512_mul_ps(_mm512_set1_ps(f[2]), s2));
+    accum = _mm512_add_ps(accum, _mm512_mul_ps(_mm512_set1_ps(f[3]), s3));
+    return accum;
+}
+
+/* (float)((double)sum + c * (double)x), as done by `float += double` */
+static FORCE_INLINE __m512 add_scaled_pd(__m512 sum, __m512 x, double c)
+{
+    const __m512d cd = _mm512_set1_pd(c);
+    __m512d lo = _mm512_add_pd(_mm512_cvtps_pd(_mm512_castps512_ps256(sum)),
+            _mm512_mul_pd(cd, _mm512_cvtps_pd(_mm512_castps512_ps256(x))));
+    __m512d hi = _mm512_add_pd(_mm512_cvtps_pd(_mm512_extractf32x8_ps(sum, 1)),
+            _mm512_mul_pd(cd, _mm512_cvtps_pd(_mm512_extractf32x8_ps(x, 1))));
+    return _mm512_insertf32x8(_mm512_castps256_ps512(_mm512_cvtpd_ps(lo)),
+                              _mm512_cvtpd_ps(hi), 1);
+}
+
+static FORCE_INLINE __m512 mul_pd(__m512 x, double c)
+{
+    const __m512d cd = _mm512_set1_pd(c);
+    __m512d lo = _mm512_mul_pd(cd, _mm512_cvtps_pd(_mm512_castps512_ps256(x)));
+    __m512d hi = _mm512_mul_pd(cd, _mm512_cvtps_pd(_mm512_extractf32x8_ps(x, 1)));
+    return _mm512_insertf32x8(_mm512_castps256_ps512(_mm512_cvtpd_ps(lo)),
+                              _mm512_cvtpd_ps(hi), 1);
+}
+
+static FORCE_INLINE __m512 divs_ps(__m512 n, __m512 d)
+{
+    const __m256 xi_lo = _mm256_rcp_ps(_mm512_castps512_ps256(d));
+    const __m256 xi_hi = _mm256_rcp_ps(_mm512_extractf32x8_ps(d, 1));
+    const __m512 xi = _mm512_insertf32x8(_mm512_castps256_ps512(xi_lo), xi_hi, 1);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 r = _mm512_add_ps(xi,
+            _mm512_mul_ps(xi, _mm512_sub_ps(one, _mm512_mul_ps(d, xi))));
+    return _mm512_mul_ps(n, r);
+}
+
+static FORCE_INLINE void transpose8(__m256 r[8])
+{
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44);
+    __m256 u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44);
+    __m256 u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44);
+    __m256 u5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44);
+    __m256 u7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+/* adds the 16 column values of 8 rows (one vector per row) column by column */
+static FORCE_INLINE __m256 accum_rows8x16(__m256 accum, const __m512 v[8])
+{
+    __m256 lo[8], hi[8];
+    for (int r = 0; r < 8; r++) {
+        lo[r] = _mm512_castps512_ps256(v[r]);
+        hi[r] = _mm512_extractf32x8_ps(v[r], 1);
+    }
+    transpose8(lo);
+    transpose8(hi);
+    for (int c = 0; c < 8; c++)
+        accum = _mm256_add_ps(accum, lo[c]);
+    for (int c = 0; c < 8; c++)
+        accum = _mm256_add_ps(accum, hi[c]);
+    return accum;
+}
+
+static FORCE_INLINE __m256 load_accum(float (*accum)[3], int theta)
+{
+    return _mm256_setr_ps(accum[0][theta], accum[1][theta], accum[2][theta],
+                          accum[3][theta], accum[4][theta], accum[5][theta],
+                          accum[6][theta], accum[7][theta]);
+}
+
+static FORCE_INLINE void store_accum(float (*accum)[3], int theta, __m256 v)
+{
+    float tmp[8];
+    _mm256_storeu_ps(tmp, v);
+    for (int r = 0; r < 8; r++)
+        accum[r][theta] = tmp[r];
+}
+
+/* even and odd elements of p[0..31] */
+static FORCE_INLINE void deinterleave(const float *p, __m512 *even, __m512 *odd)
+{
+    const __m512i idx_even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14,
+                                               16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i idx_odd = _mm512_add_epi32(idx_even, _mm512_set1_epi32(1));
+    const __m512 a = _mm512_loadu_ps(p);
+    const __m512 b = _mm512_loadu_ps(p + 16);
+    *even = _mm512_permutex2var_ps(a, idx_even, b);
+    *odd = _mm512_permutex2var_ps(a, idx_odd, b);
+}
+
+static int adm_dwt2_v_avx512(const float *const src[4], float *tmplo,
+                             float *tmphi, int j_start, int j_end)
+{
+    int j;
+    for (j = j_start; j + 16 <= j_end; j += 16) {
+        const __m512 s0 = _mm512_loadu_ps(src[0] + j);
+        const __m512 s1 = _mm512_loadu_ps(src[1] + j);
+        const __m512 s2 = _mm512_loadu_ps(src[2] + j);
+        const __m512 s3 = _mm512_loadu_ps(src[3] + j);
+        _mm512_storeu_ps(tmplo + j, filter4(dwt2_db2_coeffs_lo_s, s0, s1, s2, s3));
+        _mm512_storeu_ps(tmphi + j, filter4(dwt2_db2_coeffs_hi_s, s0, s1, s2, s3));
+    }
+    return j;
+}
+
+static int adm_dwt2_h_avx512(const float *tmplo, const float *tmphi,
+                             float *const dst[4], int j_start, int j_end)
+{
+    int j;
+    for (j = j_start; j + 16 <= j_end; j += 16) {
+        __m512 s0, s1, s2, s3;
+        deinterleave(tmplo + 2 * j - 1, &s0, &s1);
+        deinterleave(tmplo + 2 * j + 1, &s2, &s3);
+        _mm512_storeu_ps(dst[0] + j, filter4(dwt2_db2_coeffs_lo_s, s0, s1, s2, s3));
+        _mm512_storeu_ps(dst[1] + j, filter4(dwt2_db2_coeffs_hi_s, s0, s1, s2, s3));
+        deinterleave(tmphi + 2 * j - 1, &s0, &s1);
+        deinterleave(tmphi + 2 * j + 1, &s2, &s3);
+        _mm512_storeu_ps(dst[2] + j, filter4(dwt2_db2_coeffs_lo_s, s0, s1, s2, s3));
+        _mm512_storeu_ps(dst[3] + j, filter4(dwt2_db2_coeffs_hi_s, s0, s1, s2, s3));
+    }
+    return j;
+}
+
+static FORCE_INLINE __m512 enhn_gain(__m512 rst, __m512 t,
+                                     __mmask16 angle_flag, __m512 egl)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    __mmask16 m = _mm512_mask_cmp_ps_mask(angle_flag, rst, zero, _CMP_GT_OQ);
+    rst = _mm512_mask_blend_ps(m, rst, _mm512_min_ps(_mm512_mul_ps(rst, egl), t));
+    m = _mm512_mask_cmp_ps_mask(angle_flag, rst, zero, _CMP_LT_OQ);
+    return _mm512_mask_blend_ps(m, rst, _mm512_max_ps(_mm512_mul_ps(rst, egl), t));
+}
+
+static int adm_decouple_avx512(const float *const ref[3],
+                               const float *const dis[3], float *const r[3],
+                               float *const a[3], int j_start, int j_end,
+                               float adm_enhn_gain_limit)
+{
+    const float cos_1deg_sq = cos(1.0 * M_PI / 180.0) * cos(1.0 * M_PI / 180.0);
+    const __m512 cos_sq = _mm512_set1_ps(cos_1deg_sq);
+    const __m512 eps = _mm512_set1_ps(1e-30f);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 egl = _mm512_set1_ps(adm_enhn_gain_limit);
+
+    int j;
+    for (j = j_start; j + 16 <= j_end; j += 16) {
+        __m512 o[3], t[3], rst[3];
+        for (int b = 0; b < 3; b++) {
+            o[b] = _mm512_loadu_ps(ref[b] + j);
+            t[b] = _mm512_loadu_ps(dis[b] + j);
+            __m512 k = divs_ps(t[b], _mm512_add_ps(o[b], eps));
+            k = _mm512_max_ps(zero, _mm512_min_ps(one, k));
+            rst[b] = _mm512_mul_ps(k, o[b]);
+        }
+
+        const __m512 ot_dp = _mm512_add_ps(_mm512_mul_ps(o[0], t[0]),
+                                           _mm512_mul_ps(o[1], t[1]));
+        const __m512 o_mag_sq = _mm512_add_ps(_mm512_mul_ps(o[0], o[0]),
+                                              _mm512_mul_ps(o[1], o[1]));
+        const __m512 t_mag_sq = _mm512_add_ps(_mm512_mul_ps(t[0], t[0]),
+                                              _mm512_mul_ps(t[1], t[1]));
+        const __mmask16 angle_flag =
+            _mm512_cmp_ps_mask(ot_dp, zero, _CMP_GE_OQ) &
+            _mm512_cmp_ps_mask(_mm512_mul_ps(ot_dp, ot_dp),
+                               _mm512_mul_ps(_mm512_mul_ps(cos_sq, o_mag_sq), t_mag_sq),
+                               _CMP_GE_OQ);
+
+        for (int b = 0; b < 3; b++) {
+            rst[b] = enhn_gain(rst[b], t[b], angle_flag, egl);
+            _mm512_storeu_ps(r[b] + j, rst[b]);
+            _mm512_storeu_ps(a[b] + j, _mm512_sub_ps(t[b], rst[b]));
+        }
+    }
+    return j;
+}
+
+static int adm_csf_avx512(const float *src, float *dst, float *flt,
+                          float rfactor, int j_start, int j_end)
+{
+    const __m512 rf = _mm512_set1_ps(rfactor);
+    int j;
+    for (j = j_start; j + 16 <= j_end; j += 16) {
+        const __m512 dst_val = _mm512_mul_ps(rf, _mm512_loadu_ps(src + j));
+        _mm512_storeu_ps(dst + j, dst_val);
+        _mm512_storeu_ps(flt + j, mul_pd(_mm512_abs_ps(dst_val), FLOAT_ONE_BY_30));
+    }
+    return j;
+}
+
+static int adm_csf_den_rows_avx512(const float *const src[3], int src_px_stride,
+                                   const float rfactor[3], int j_start,
+                                   int j_end, float (*accum)[3])
+{
+    int j = j_start;
+    for (int theta = 0; theta < 3; theta++) {
+        const __m512 rf = _mm512_set1_ps(rfactor[theta]);
+        __m256 acc = load_accum(accum, theta);
+        for (j = j_start; j + 16 <= j_end; j += 16) {
+            __m512 v[8];
+            for (int r = 0; r < 8; r++) {
+                const __m512 x = _mm512_abs_ps(_mm512_mul_ps(rf,
+                        _mm512_loadu_ps(src[theta] + r * src_px_stride + j)));
+                v[r] = _mm512_mul_ps(_mm512_mul_ps(x, x), x);
+            }
+            acc = accum_rows8x16(acc, v);
+        }
+        store_accum(accum, theta, acc);
+    }
+    return j;
+}
+
+/* threshold of ADM_CM_THRESH_S_I_J for the 16 columns at j of one row */
+static FORCE_INLINE __m512 cm_thresh(const float *const csf_a[3],
+                                     const float *const csf_f[3],
+                                     int stride, int j)
+{
+    __m512 thr = _mm512_setzero_ps();
+    for (int theta = 0; theta < 3; theta++) {
+        const float *a = csf_a[theta] + j;
+        const float *f = csf_f[theta] + j - stride;
+        __m512 sum = _mm512_setzero_ps();
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f - 1));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f + 1));
+        f += stride;
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f - 1));
+        sum = add_scaled_pd(sum, _mm512_abs_ps(_mm512_loadu_ps(a)), FLOAT_ONE_BY_15);
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f + 1));
+        f += stride;
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f - 1));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f));
+        sum = _mm512_add_ps(sum, _mm512_loadu_ps(f + 1));
+        thr = _mm512_add_ps(thr, sum);
+    }
+    return thr;
+}
+
+static int adm_cm_rows_avx512(const float *const src[3], int src_px_stride,
+                              const float *const csf_a[3],
+                              const float *const csf_f[3], int csf_px_stride,
+                              const float rfactor[3], int j_start, int j_end,
+                              float (*accum)[3])
+{
+    const __m512 zero = _mm512_setzero_ps();
+    __m256 acc[3];
+    for (int theta = 0; theta < 3; theta++)
+        acc[theta] = load_accum(accum, theta);
+
+    int j;
+    for (j = j_start; j + 16 <= j_end; j += 16) {
+        __m512 v[3][8];
+        for (int r = 0; r < 8; r++) {
+            const float *a_rows[3] = {
+                csf_a[0] + r * csf_px_stride, csf_a[1] + r * csf_px_stride,
+                csf_a[2] + r * csf_px_stride,
+            };
+            const float *f_rows[3] = {
+                csf_f[0] + r * csf_px_stride, csf_f[1] + r * csf_px_stride,
+                csf_f[2] + r * csf_px_stride,
+            };
+            const __m512 thr = cm_thresh(a_rows, f_rows, csf_px_stride, j);
+            for (int theta = 0; theta < 3; theta++) {
+                __m512 x = _mm512_mul_ps(
+                        _mm512_loadu_ps(src[theta] + r * src_px_stride + j),
+                        _mm512_set1_ps(rfactor[theta]));
+                x = _mm512_max_ps(zero, _mm512_sub_ps(_mm512_abs_ps(x), thr));
+                v[theta][r] = _mm512_mul_ps(_mm512_mul_ps(x, x), x);
+            }
+        }
+        for (int theta = 0; theta < 3; theta++)
+            acc[theta] = accum_rows8x16(acc[theta], v[theta]);
+    }
+
+    for (int theta = 0; theta < 3; theta++)
+        store_accum(accum, theta, acc[theta]);
+    return j;
+}
+
+void adm_float_kernels_avx512(AdmFloatKernels *k)
+{
+    k->dwt2_v = adm_dwt2_v_avx512;
+    k->dwt2_h = adm_dwt2_h_avx512;
+    k->decouple = adm_decouple_avx512;
+    k->csf = adm_csf_avx512;
+    k->csf_den_rows = adm_csf_den_rows_avx512;
+    k->cm_rows = adm_cm_rows_avx512;
+    k->rows = 8;
+}
@@ -17,118 +17,145 @@
  */
 
 #include <immintrin.h>
-#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 
+#include "feature/common/macros.h"
 #include "feature/integer_motion.h"
-#include "feature/common/alignment.h"
+#include "feature/x86/motion_avx2.h"
 
-void x_convolution_16_avx2(const uint16_t *src, uint16_t *dst, unsigned width,
-                           unsigned height, ptrdiff_t src_stride,
-                           ptrdiff_t dst_stride)
+/*
+ * 5-tap filter of 16 unsigned 16-bit lanes. The 32-bit products are formed
+ * with mullo/mulhi pairs, so the full 16-bit input range is supported.
+ */
+static FORCE_INLINE void mul_acc(__m256i *lo, __m256i *hi, __m256i src,
+                                 uint16_t coeff)
+{
+    const __m256i f = _mm256_set1_epi16(coeff);
+    const __m256i p_lo = _mm256_mullo_epi16(src, f);
+    const __m256i p_hi = _mm256_mulhi_epu16(src, f);
+    *lo = _mm256_add_epi32(*lo, _mm256_unpacklo_epi16(p_lo, p_hi));
+    *hi = _mm256_add_epi32(*hi, _mm256_unpackhi_epi16(p_lo, p_hi));
+}
+
+static FORCE_INLINE __m256i filter5(__m256i s0, __m256i s1, __m256i s2,
+                                    __m256i s3, __m256i s4, __m256i round,
+                                    __m128i shift)
+{
+    __m256i lo = round, hi = round;
+    mul_acc(&lo, &hi, s0, filter[0]);
+    mul_acc(&lo, &hi, s1, filter[1]);
+    mul_acc(&lo, &hi, s2, filter[2]);
+    mul_acc(&lo, &hi, s3, filter[3]);
+    mul_acc(&lo, &hi, s4, filter[4]);
+    return _mm256_packus_epi32(_mm256_srl_epi32(lo, shift),
+                               _mm256_srl_epi32(hi, shift));
+}
+
+void y_convolution_8_avx2(const void *const *src, uint16_t *dst,
+                          unsigned width, unsigned inp_size_bits)
 {
-    const unsigned radius = filter_width / 2;
-    const unsigned left_edge = vmaf_ceiln(radius, 1);
-    const unsigned right_edge = vmaf_floorn(width - (filter_width - radius), 1);
-    const unsigned shift_add_round = 32768;
-    const unsigned vector_loop = width < 16 ? 0 : (width >> 4) - 1;
-
-    uint16_t *src_p = (uint16_t*) src + (left_edge - radius);
-    unsigned nr = left_edge + 16 * vector_loop;
-    uint16_t *src_pt = (uint16_t*) src + nr -radius;
-    for (unsigned i = 0; i < height; ++i) {
-        for (unsigned j = 0; j < left_edge; j++) {
-            dst[i * dst_stride + j] =
-                (edge_16(true, src, width, height, src_stride, i, j) +
-                 shift_add_round) >> 16;
-        }
+    (void) inp_size_bits;
+    const uint8_t *const *s = (const uint8_t *const *) src;
+    const unsigned shift_var = 8;
+    const __m256i round = _mm256_set1_epi32(1u << (shift_var - 1));
+    const __m128i shift = _mm_cvtsi32_si128(shift_var);
+
+    unsigned j = 0;
+    for (; j + 16 <= width; j += 16) {
+        __m256i s0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &s[0][j]));
+        __m256i s1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &s[1][j]));
+        __m256i s2 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &s[2][j]));
+        __m256i s3 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &s[3][j]));
+        __m256i s4 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &s[4][j]));
+        _mm256_storeu_si256((__m256i *) &dst[j],
+                            filter5(s0, s1, s2, s3, s4, round, shift));
     }
 
-    for (unsigned i = 0; i < height; ++i) {
-        uint16_t *src_p1 = src_p;
-        for (unsigned j = 0; j < vector_loop; j = j + 1) {
-            __m256i src1 = _mm256_loadu_si256((__m256i*) src_p1);
-            __m256i kernel1 = _mm256_set1_epi16(3571);
-            __m256i kernel2 = _mm256_set1_epi16(16004);
-            __m256i kernel3 = _mm256_set1_epi16(26386);
-            __m256i result = _mm256_mulhi_epu16(src1, kernel1);
-            __m256i resultlo = _mm256_mullo_epi16(src1, kernel1);
-
-            //src1 = src1 >> 16; //shift by a  pixel
-            __m256i src2 = _mm256_loadu_si256((__m256i*) (src_p1 + 1));
-            __m256i result2 = _mm256_mulhi_epu16(src2, kernel2);
-            __m256i result2lo = _mm256_mullo_epi16(src2, kernel2);
-            __m256i accum1_lo = _mm256_unpacklo_epi16(resultlo, result);
-            __m256i accum1_hi = _mm256_unpackhi_epi16(resultlo, result);
-            __m256i accum2_lo = _mm256_unpacklo_epi16(result2lo, result2);
-            __m256i accum2_hi = _mm256_unpackhi_epi16(result2lo, result2);
-
-            //Filter[3] value
-            // src1= src1>>32;
-            __m256i src3 = _mm256_loadu_si256((__m256i*) (src_p1 + 2));
-            __m256i result3 = _mm256_mulhi_epu16(src3, kernel3);
-            __m256i result3lo = _mm256_mullo_epi16(src3, kernel3);
-            __m256i accum3_lo = _mm256_unpacklo_epi16(result3lo, result3);
-            __m256i accum3_hi = _mm256_unpackhi_epi16(result3lo, result3);
-
-            //filter 4
-            src1 = _mm256_loadu_si256((__m256i*) (src_p1 + 3));
-            result = _mm256_mulhi_epu16(src1, kernel2);
-            resultlo = _mm256_mullo_epi16(src1, kernel2);
-
-            //Filter 5
-            src2 = _mm256_loadu_si256((__m256i*) (src_p1 + 4));
-            result2 = _mm256_mulhi_epu16(src2, kernel1);
-            result2lo = _mm256_mullo_epi16(src2, kernel1);
-
-            __m256i accum4_lo =_mm256_unpacklo_epi16(resultlo, result);
-            __m256i accum4_hi =_mm256_unpackhi_epi16(resultlo, result);
-            __m256i accum5_lo =_mm256_unpacklo_epi16(result2lo, result2);
-            __m256i accum5_hi =_mm256_unpackhi_epi16(result2lo, result2);
-
-            __m256i addnum = _mm256_set1_epi32(32768);
-            __m256i accum_lo = _mm256_add_epi32(accum1_lo, accum2_lo);
-            __m256i accumi_lo = _mm256_add_epi32(accum3_lo, accum4_lo);
-            accum5_lo = _mm256_add_epi32(accum5_lo, addnum);
-            accum_lo = _mm256_add_epi32(accum5_lo, accum_lo);
-            accum_lo = _mm256_add_epi32(accumi_lo, accum_lo);
-            __m256i accum_hi = _mm256_add_epi32(accum1_hi, accum2_hi);
-            __m256i accumi_hi = _mm256_add_epi32(accum3_hi, accum4_hi);
-            accum_hi = _mm256_add_epi32(accum5_hi, accum_hi);
-            accumi_hi = _mm256_add_epi32(accumi_hi, addnum);
-            accum_hi = _mm256_add_epi32(accumi_hi, accum_hi);
-            accum_lo = _mm256_srli_epi32(accum_lo, 0x10);
-            accum_hi = _mm256_srli_epi32(accum_hi, 0x10);
-
-            result = _mm256_packus_epi32(accum_lo, accum_hi);
-            _mm256_storeu_si256(
-                (__m256i*) (dst + i * dst_stride + j * 16 + left_edge), result);
-
-            src_p1 += 16;
-        }
-        src_p += src_stride;
+    for (; j < width; j++) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * s[k][j];
+        dst[j] = (accum + (1u << (shift_var - 1))) >> shift_var;
     }
+}
+
+void y_convolution_16_avx2(const void *const *src, uint16_t *dst,
+                           unsigned width, unsigned inp_size_bits)
+{
+    const uint16_t *const *s = (const uint16_t *const *) src;
+    const unsigned shift_var = inp_size_bits;
+    const __m256i round = _mm256_set1_epi32(1u << (shift_var - 1));
+    const __m128i shift = _mm_cvtsi32_si128(shift_var);
 
-    for (unsigned i = 0; i < height; ++i) {
-        uint16_t *src_p1 = src_pt;
-        for (unsigned j = nr; j < (right_edge); j++) {
-            uint32_t accum = 0;
-            uint16_t *src_p2 = src_p1;
-            for (int k = 0; k < filter_width; ++k) {
-                accum += filter[k] * (*src_p2);
-                src_p2++;
-            }
-            src_p1++;
-            dst[i * dst_stride + j] = (accum + shift_add_round) >> 16;
-        }
-        src_pt += src_stride;
+    unsigned j = 0;
+    for (; j + 16 <= width; j += 16) {
+        __m256i s0 = _mm256_loadu_si256((const __m256i *) &s[0][j]);
+        __m256i s1 = _mm256_loadu_si256((const __m256i *) &s[1][j]);
+        __m256i s2 = _mm256_loadu_si256((const __m256i *) &s[2][j]);
+        __m256i s3 = _mm256_loadu_si256((const __m256i *) &s[3][j]);
+        __m256i s4 = _mm256_loadu_si256((const __m256i *) &s[4][j]);
+        _mm256_storeu_si256((__m256i *) &dst[j],
+                            filter5(s0, s1, s2, s3, s4, round, shift));
     }
 
-    for (unsigned i = 0; i < height; ++i) {
-        for (unsigned j = right_edge; j < width; j++) {
-            dst[i * dst_stride + j] =
-                (edge_16(true, src, width, height, src_stride, i, j) +
-                 shift_add_round) >> 16;
-        }
+    for (; j < width; j++) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * s[k][j];
+        dst[j] = (accum + (1u << (shift_var - 1))) >> shift_var;
     }
 }
+
+void x_convolution_16_avx2(const uint16_t *src, uint16_t *dst, unsigned width)
+{
+    const int radius = filter_width / 2;
+    const __m256i round = _mm256_set1_epi32(32768);
+    const __m128i shift = _mm_cvtsi32_si128(16);
+
+    unsigned j = 0;
+    for (; j + 16 <= width; j += 16) {
+        const uint16_t *p = src + j - radius;
+        __m256i s0 = _mm256_loadu_si256((const __m256i *) (p + 0));
+        __m256i s1 = _mm256_loadu_si256((const __m256i *) (p + 1));
+        __m256i s2 = _mm256_loadu_si256((const __m256i *) (p + 2));
+        __m256i s3 = _mm256_loadu_si256((const __m256i *) (p + 3));
+        __m256i s4 = _mm256_loadu_si256((const __m256i *) (p + 4));
+        _mm256_storeu_si256((__m256i *) &dst[j],
+                            filter5(s0, s1, s2, s3, s4, round, shift));
+    }
+
+    for (; j < width; j++) {
+        uint32_t accum = 0;
+        for (int k = 0; k < filter_width; ++k)
+            accum += filter[k] * src[(int) j - radius + k];
+        dst[j] = (accum + 32768) >> 16;
+    }
+}
+
+uint32_t sad_avx2(const uint16_t *a, const uint16_t *b, unsigned width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+
+    unsigned j = 0;
+    for (; j + 16 <= width; j += 16) {
+        __m256i va = _mm256_loadu_si256((const __m256i *) &a[j]);
+        __m256i vb = _mm256_loadu_si256((const __m256i *) &b[j]);
+        __m256i d = _mm256_or_si256(_mm256_subs_epu16(va, vb),
+                                    _mm256_subs_epu16(vb, va));
+        acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(d, zero));
+        acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(d, zero));
+    }
+
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t sad = _mm_cvtsi128_si32(sum);
+
+    for (; j < width; j++)
+        sad += abs(a[j] - b[j]);
+    return sad;
+}
@@ -21,8 +21,14 @@
 
 #include <stdint.h>
 
-void x_convolution_16_avx2(const uint16_t *src, uint16_t *dst, unsigned width,
-                           unsigned height, ptrdiff_t src_stride,
-                           ptrdiff_t dst_stride);
+void y_convolution_8_avx2(const void *const *src, uint16_t *dst,
+                          unsigned width, unsigned inp_size_bits);
+
+void y_convolution_16_avx2(const void *const *src, uint16_t *dst,
+                           unsigned width, unsigned inp_size_bits);
+
+void x_convolution_16_avx2(const uint16_t *src, uint16_t *dst, unsigned width);
+
+uint32_t sad_avx2(const uint16_t *a, const uint16_t *b, unsigned width);
 
 #endif /* X86_AVX2_MOTION_H_ */
@@ -16,121 +16,122 @@
  *
  */
 
-#include <errno.h>
-#include <math.h>
-#include <stdbool.h>
+#include <immintrin.h>
 #include <stddef.h>
-#include <string.h>
+#include <stdint.h>
 
+#include "feature/common/macros.h"
 #include "feature/integer_motion.h"
-#include "feature/common/alignment.h"
-
-#include <immintrin.h>
+#include "feature/x86/motion_avx512.h"
 
-void x_convolution_16_avx512(const uint16_t *src, uint16_t *dst, unsigned width,
-                             unsigned height, ptrdiff_t src_stride,
-                             ptrdiff_t dst_stride)
+static FORCE_INLINE __mmask32 tail_mask(unsigned n)
 {
-    const unsigned radius = filter_width / 2;
-    const unsigned left_edge = vmaf_ceiln(radius, 1);
-    const unsigned right_edge = vmaf_floorn(width - (filter_width - radius), 1);
-    const unsigned shift_add_round = 32768;
-    const unsigned vector_loop = width < 32 ? 0 : (width>>5) -1;
-    uint16_t *src_p = (uint16_t*) src + (left_edge - radius);
-    unsigned nr = left_edge + 32 *vector_loop;
-    uint16_t *src_pt = (uint16_t*) src + nr -radius;
-    for (unsigned i = 0; i < height; ++i) {
-        for (unsigned j = 0; j < left_edge; j++) {
-            dst[i * dst_stride + j] =
-                (edge_16(true, src, width, height, src_stride, i, j) +
-                 shift_add_round) >> 16;
-        }
-
-    }
+    return n >= 32 ? 0xFFFFFFFF : (__mmask32) ((1u << n) - 1);
+}
 
-    for (unsigned i = 0; i < height; ++i) {
-        uint16_t *src_p1 = src_p;
-        for (unsigned j = 0; j <vector_loop; j=j+1) {
-            __m512i src1            = _mm512_loadu_si512 ((__m512i *)src_p1);
-            __m512i kernel1         = _mm512_set1_epi16( 3571);
-            __m512i kernel2         = _mm512_set1_epi16( 16004);
-            __m512i kernel3         = _mm512_set1_epi16( 26386) ;
-            __m512i result          = _mm512_mulhi_epu16(src1,kernel1);
-            __m512i resultlo        = _mm512_mullo_epi16(src1,kernel1);
+static FORCE_INLINE void mul_acc(__m512i *lo, __m512i *hi, __m512i src,
+                                 uint16_t coeff)
+{
+    const __m512i f = _mm512_set1_epi16(coeff);
+    const __m512i p_lo = _mm512_mullo_epi16(src, f);
+    const __m512i p_hi = _mm512_mulhi_epu16(src, f);
+    *lo = _mm512_add_epi32(*lo, _mm512_unpacklo_epi16(p_lo, p_hi));
+    *hi = _mm512_add_epi32(*hi, _mm512_unpackhi_epi16(p_lo, p_hi));
+}
 
-            // src1= src1>>16; //shift by a  pixel
-            __m512i src2            = _mm512_loadu_si512 ((__m512i *)(src_p1+1));
-            __m512i result2         = _mm512_mulhi_epu16(src2,kernel2);
-            __m512i result2lo       = _mm512_mullo_epi16(src2,kernel2);
-            __m512i accum1_lo       = _mm512_unpacklo_epi16(resultlo, result);
-            __m512i accum1_hi       = _mm512_unpackhi_epi16(resultlo, result);
-            __m512i accum2_lo       = _mm512_unpacklo_epi16(result2lo, result2);
-            __m512i accum2_hi       = _mm512_unpackhi_epi16(result2lo, result2);
+static FORCE_INLINE __m512i filter5(__m512i s0, __m512i s1, __m512i s2,
+                                    __m512i s3, __m512i s4, __m512i round,
+                                    __m128i shift)
+{
+    __m512i lo = round, hi = round;
+    mul_acc(&lo, &hi, s0, filter[0]);
+    mul_acc(&lo, &hi, s1, filter[1]);
+    mul_acc(&lo, &hi, s2, filter[2]);
+    mul_acc(&lo, &hi, s3, filter[3]);
+    mul_acc(&lo, &hi, s4, filter[4]);
+    return _mm512_packus_epi32(_mm512_srl_epi32(lo, shift),
+                               _mm512_srl_epi32(hi, shift));
+}
 
-            // Filter[3] value
-            // src1= src1>>32;
-            __m512i src3            = _mm512_loadu_si512 ((__m512i *)(src_p1+2));
-            __m512i result3         = _mm512_mulhi_epu16(src3,kernel3);
-            __m512i result3lo       = _mm512_mullo_epi16(src3,kernel3);
-            __m512i accum3_lo       = _mm512_unpacklo_epi16 (result3lo, result3);
-            __m512i accum3_hi       = _mm512_unpackhi_epi16 (result3lo, result3);
-            //filter 4
-            src1      = _mm512_loadu_si512 ((__m512i *)(src_p1+3));
-            result    = _mm512_mulhi_epu16(src1,kernel2);
-            resultlo  = _mm512_mullo_epi16(src1,kernel2);
+/*
+ * The row tails are handled with masked loads and stores, so no scalar
+ * fallback is needed.
+ */
+void y_convolution_8_avx512(const void *const *src, uint16_t *dst,
+                            unsigned width, unsigned inp_size_bits)
+{
+    (void) inp_size_bits;
+    const uint8_t *const *s = (const uint8_t *const *) src;
+    const unsigned shift_var = 8;
+    const __m512i round = _mm512_set1_epi32(1u << (shift_var - 1));
+    const __m128i shift = _mm_cvtsi32_si128(shift_var);
 
-            //Filter 5
-            src2      = _mm512_loadu_si512((__m512i *)(src_p1+4));
-            result2   = _mm512_mulhi_epu16(src2,kernel1);
-            result2lo = _mm512_mullo_epi16(src2,kernel1);
+    for (unsigned j = 0; j < width; j += 32) {
+        const __mmask32 m = tail_mask(width - j);
+        __m512i s0 = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, &s[0][j]));
+        __m512i s1 = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, &s[1][j]));
+        __m512i s2 = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, &s[2][j]));
+        __m512i s3 = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, &s[3][j]));
+        __m512i s4 = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, &s[4][j]));
+        _mm512_mask_storeu_epi16(&dst[j], m,
+                                 filter5(s0, s1, s2, s3, s4, round, shift));
+    }
+}
 
-            __m512i accum4_lo =_mm512_unpacklo_epi16(resultlo, result);
-            __m512i accum4_hi =_mm512_unpackhi_epi16(resultlo, result);
-            __m512i accum5_lo =_mm512_unpacklo_epi16(result2lo, result2);
-            __m512i accum5_hi =_mm512_unpackhi_epi16(result2lo, result2);
+void y_convolution_16_avx512(const void *const *src, uint16_t *dst,
+                             unsigned width, unsigned inp_size_bits)
+{
+    const uint16_t *const *s = (const uint16_t *const *) src;
+    const unsigned shift_var = inp_size_bits;
+    const __m512i round = _mm512_set1_epi32(1u << (shift_var - 1));
+    const __m128i shift = _mm_cvtsi32_si128(shift_var);
 
-            __m512i addnum    = _mm512_set1_epi32(32768);
-            __m512i accum_lo  = _mm512_add_epi32(accum1_lo,accum2_lo);
-            __m512i accumi_lo = _mm512_add_epi32(accum3_lo,accum4_lo);
-                    accum5_lo = _mm512_add_epi32(accum5_lo,addnum);
-                    accum_lo  = _mm512_add_epi32(accum5_lo,accum_lo);
-                    accum_lo  = _mm512_add_epi32(accumi_lo,accum_lo);
-            __m512i accum_hi  = _mm512_add_epi32(accum1_hi,accum2_hi);
-            __m512i accumi_hi = _mm512_add_epi32(accum3_hi,accum4_hi);
-                    accum_hi  = _mm512_add_epi32(accum5_hi,accum_hi);
-                    accumi_hi = _mm512_add_epi32(accumi_hi,addnum);
-                    accum_hi  = _mm512_add_epi32(accumi_hi,accum_hi);
-                    accum_lo  = _mm512_srli_epi32(accum_lo, 0x10);
-                    accum_hi  = _mm512_srli_epi32(accum_hi, 0x10);
+    for (unsigned j = 0; j < width; j += 32) {
+        const __mmask32 m = tail_mask(width - j);
+        __m512i s0 = _mm512_maskz_loadu_epi16(m, &s[0][j]);
+        __m512i s1 = _mm512_maskz_loadu_epi16(m, &s[1][j]);
+        __m512i s2 = _mm512_maskz_loadu_epi16(m, &s[2][j]);
+        __m512i s3 = _mm512_maskz_loadu_epi16(m, &s[3][j]);
+        __m512i s4 = _mm512_maskz_loadu_epi16(m, &s[4][j]);
+        _mm512_mask_storeu_epi16(&dst[j], m,
+                                 filter5(s0, s1, s2, s3, s4, round, shift));
+    }
+}
 
-            result = _mm512_packus_epi32(accum_lo,accum_hi);
-            _mm512_storeu_si512((__m512i *) (dst+ i * dst_stride + j*32+ left_edge),result);
-            src_p1+=32;
-        }
+void x_convolution_16_avx512(const uint16_t *src, uint16_t *dst,
+                             unsigned width)
+{
+    const int radius = filter_width / 2;
+    const __m512i round = _mm512_set1_epi32(32768);
+    const __m128i shift = _mm_cvtsi32_si128(16);
 
-        src_p += src_stride;
+    for (unsigned j = 0; j < width; j += 32) {
+        const __mmask32 m = tail_mask(width - j);
+        const uint16_t *p = src + j - radius;
+        __m512i s0 = _mm512_maskz_loadu_epi16(m, p + 0);
+        __m512i s1 = _mm512_maskz_loadu_epi16(m, p + 1);
+        __m512i s2 = _mm512_maskz_loadu_epi16(m, p + 2);
+        __m512i s3 = _mm512_maskz_loadu_epi16(m, p + 3);
+        __m512i s4 = _mm512_maskz_loadu_epi16(m, p + 4);
+        _mm512_mask_storeu_epi16(&dst[j], m,
+                                 filter5(s0, s1, s2, s3, s4, round, shift));
     }
+}
 
-   for (unsigned i = 0; i < height; ++i) {
-        uint16_t *src_p1 = src_pt;
-        for (unsigned j = nr; j < right_edge; j++) {
-            uint32_t accum = 0;
-            uint16_t *src_p2 = src_p1;
-            for (int k = 0; k < filter_width; ++k) {
-                accum += filter[k] * (*src_p2);
-                src_p2++;
-            }
-            src_p1++;
-            dst[i * dst_stride + j] = (accum + shift_add_round) >> 16;
-        }
-        src_pt += src_stride;
-    }
+uint32_t sad_avx512(const uint16_t *a, const uint16_t *b, unsigned width)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i acc = _mm512_setzero_si512();
 
-    for (unsigned i = 0; i < height; ++i) {
-        for (unsigned j = right_edge; j < width; j++) {
-            dst[i * dst_stride + j] =
-                (edge_16(true, src, width, height, src_stride, i, j) +
-                 shift_add_round) >> 16;
-        }
+    for (unsigned j = 0; j < width; j += 32) {
+        const __mmask32 m = tail_mask(width - j);
+        __m512i va = _mm512_maskz_loadu_epi16(m, &a[j]);
+        __m512i vb = _mm512_maskz_loadu_epi16(m, &b[j]);
+        __m512i d = _mm512_or_si512(_mm512_subs_epu16(va, vb),
+                                    _mm512_subs_epu16(vb, va));
+        acc = _mm512_add_epi32(acc, _mm512_unpacklo_epi16(d, zero));
+        acc = _mm512_add_epi32(acc, _mm512_unpackhi_epi16(d, zero));
     }
+
+    return _mm512_reduce_add_epi32(acc);
 }
@@ -0,0 +1,79 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "picture_copy_avx2.h"
+
+/*
+ * Integer to float conversion is exact for 8 to 16 bit samples, and the
+ * division and offset addition are the same single roundings the scalar code
+ * performs, so these match picture_copy() bit for bit.
+ */
+
+void picture_copy_8_avx2(float *dst, ptrdiff_t dst_stride,
+                         const uint8_t *src, ptrdiff_t src_stride,
+                         unsigned w, unsigned h, float offset)
+{
+    const __m256 off = _mm256_set1_ps(offset);
+    const unsigned w16 = w & ~15u;
+
+    for (unsigned i = 0; i < h; i++) {
+        unsigned j = 0;
+        for (; j < w16; j += 16) {
+            const __m128i s = _mm_loadu_si128((const __m128i *)(src + j));
+            const __m256i lo = _mm256_cvtepu8_epi32(s);
+            const __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(s, 8));
+            _mm256_storeu_ps(dst + j, _mm256_add_ps(_mm256_cvtepi32_ps(lo), off));
+            _mm256_storeu_ps(dst + j + 8, _mm256_add_ps(_mm256_cvtepi32_ps(hi), off));
+        }
+        for (; j < w; j++)
+            dst[j] = (float) src[j] + offset;
+        dst += dst_stride / sizeof(float);
+        src += src_stride;
+    }
+}
+
+void picture_copy_16_avx2(float *dst, ptrdiff_t dst_stride,
+                          const uint16_t *src, ptrdiff_t src_stride,
+                          unsigned w, unsigned h, float scaler, float offset)
+{
+    const __m256 off = _mm256_set1_ps(offset);
+    const __m256 scale = _mm256_set1_ps(scaler);
+    const unsigned w16 = w & ~15u;
+
+    for (unsigned i = 0; i < h; i++) {
+        unsigned j = 0;
+        for (; j < w16; j += 16) {
+            const __m256i s = _mm256_loadu_si256((const __m256i *)(src + j));
+            const __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(s));
+            const __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(s, 1));
+            const __m256 flo = _mm256_div_ps(_mm256_cvtepi32_ps(lo), scale);
+            const __m256 fhi = _mm256_div_ps(_mm256_cvtepi32_ps(hi), scale);
+            _mm256_storeu_ps(dst + j, _mm256_add_ps(flo, off));
+            _mm256_storeu_ps(dst + j + 8, _mm256_add_ps(fhi, off));
+        }
+        for (; j < w; j++)
+            dst[j] = (float) src[j] / scaler + offset;
+        dst += dst_stride / sizeof(float);
+        src += src_stride / sizeof(uint16_t);
+    }
+}
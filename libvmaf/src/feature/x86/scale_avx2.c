@@ -0,0 +1,93 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <immintrin.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scale_avx2.h"
+
+/*
+ * Products are summed tap by tap without fused multiply-add, the same
+ * roundings as vmaf_scale_h_c() and vmaf_scale_v_c(), so these match them
+ * bit for bit.
+ */
+
+void vmaf_scale_h_avx2(const float *src, float *dst, unsigned w,
+                       const int32_t *pos, const float *coef,
+                       ptrdiff_t coef_stride, unsigned taps)
+{
+    const unsigned w8 = w & ~7u;
+
+    unsigned x = 0;
+    for (; x < w8; x += 8) {
+        const __m256i p = _mm256_loadu_si256((const __m256i *)(pos + x));
+        __m256 sum = _mm256_setzero_ps();
+        for (unsigned k = 0; k < taps; k++) {
+            const __m256 s = _mm256_i32gather_ps(src + k, p, 4);
+            const __m256 c = _mm256_loadu_ps(coef + k * coef_stride + x);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(s, c));
+        }
+        _mm256_storeu_ps(dst + x, sum);
+    }
+    for (; x < w; x++) {
+        float sum = 0.f;
+        for (unsigned k = 0; k < taps; k++)
+            sum += src[pos[x] + (int) k] * coef[k * coef_stride + x];
+        dst[x] = sum;
+    }
+}
+
+void vmaf_scale_v_avx2(const float *const *src, const float *coef,
+                       unsigned taps, void *dst, unsigned w, unsigned bpc)
+{
+    const float max = (1 << bpc) - 1;
+    const __m256 vmax = _mm256_set1_ps(max);
+    const __m256 zero = _mm256_setzero_ps();
+    const unsigned w8 = w & ~7u;
+
+    unsigned x = 0;
+    for (; x < w8; x += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (unsigned k = 0; k < taps; k++) {
+            const __m256 c = _mm256_set1_ps(coef[k]);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(src[k] + x), c));
+        }
+        sum = _mm256_min_ps(_mm256_max_ps(sum, zero), vmax);
+        // round to nearest even, as lrintf()
+        const __m256i i = _mm256_cvtps_epi32(sum);
+        const __m128i u16 = _mm_packus_epi32(_mm256_castsi256_si128(i),
+                                             _mm256_extracti128_si256(i, 1));
+        if (bpc == 8)
+            _mm_storel_epi64((__m128i *)((uint8_t *) dst + x),
+                             _mm_packus_epi16(u16, u16));
+        else
+            _mm_storeu_si128((__m128i *)((uint16_t *) dst + x), u16);
+    }
+    for (; x < w; x++) {
+        float sum = 0.f;
+        for (unsigned k = 0; k < taps; k++)
+            sum += src[k][x] * coef[k];
+        sum = sum < 0.f ? 0.f : sum > max ? max : sum;
+        if (bpc == 8)
+            ((uint8_t *) dst)[x] = lrintf(sum);
+        else
+            ((uint16_t *) dst)[x] = lrintf(sum);
+    }
+}
@@ -0,0 +1,32 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef X86_AVX2_SCALE_H_
+#define X86_AVX2_SCALE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+void vmaf_scale_h_avx2(const float *src, float *dst, unsigned w,
+                       const int32_t *pos, const float *coef,
+                       ptrdiff_t coef_stride, unsigned taps);
+
+void vmaf_scale_v_avx2(const float *const *src, const float *coef,
+                       unsigned taps, void *dst, unsigned w, unsigned bpc);
+
+#endif /* X86_AVX2_SCALE_H_ */
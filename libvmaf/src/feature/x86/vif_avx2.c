@@ -118,7 +118,7 @@ acc_right = _mm256_madd_epi16(_mm256_unpackhi_epi16(r0, zero), f); \
 }
 
 
-void vif_statistic_8_avx2(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h) {
+void vif_statistic_8_avx2(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end) {
     assert(vif_filter1d_width[0] == 17);
     static const unsigned fwidth = 17;
     const uint16_t *vif_filt_s0 = vif_filter1d_table[0];
@@ -139,7 +139,7 @@ void vif_statistic_8_avx2(struct VifPublicState *s, float *num, float *den, unsi
     ALIGNED(32) uint32_t yy[16];
     ALIGNED(32) uint32_t xy[16];
     // loop on row, each iteration produces one line of output
-    for (unsigned i = 0; i < h; ++i) {
+    for (unsigned i = row_start; i < row_end; ++i) {
         // Filter vertically
         // First consider all blocks of 16 elements until it's not possible anymore
         unsigned n = w >> 4;
@@ -528,25 +528,22 @@ void vif_statistic_8_avx2(struct VifPublicState *s, float *num, float *den, unsi
             }
         }
         if ((n << 4) != w) {
-            VifResiduals residuals = vif_compute_line_residuals(s, n << 4, w, 0);
-            accum_num_log += residuals.accum_num_log;
-            accum_den_log += residuals.accum_den_log;
-            accum_num_non_log += residuals.accum_num_non_log;
-            accum_den_non_log += residuals.accum_den_non_log;
+            VifResiduals line_residuals = vif_compute_line_residuals(s, n << 4, w, 0);
+            accum_num_log += line_residuals.accum_num_log;
+            accum_den_log += line_residuals.accum_den_log;
+            accum_num_non_log += line_residuals.accum_num_non_log;
+            accum_den_non_log += line_residuals.accum_den_non_log;
         }
     }
 
-    //log has to be divided by 2048 as log_value = log2(i*2048)  i=16384 to 65535
-    //num[0] = accum_num_log / 2048.0 + (accum_den_non_log - (accum_num_non_log / 65536.0) / (255.0*255.0));
-    //den[0] = accum_den_log / 2048.0 + accum_den_non_log;
-
-    //changed calculation to increase performance
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 
 }
 
-void vif_statistic_16_avx2(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h, int bpc, int scale) {
+void vif_statistic_16_avx2(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end, int bpc, int scale) {
     const unsigned fwidth = vif_filter1d_width[scale];
     const uint16_t *vif_filt = vif_filter1d_table[scale];
     VifBuffer buf = s->buf;
@@ -583,7 +580,7 @@ void vif_statistic_16_avx2(struct VifPublicState *s, float *num, float *den, uns
         add_shift_round_VP_sq = 32768;
     }
 
-    for (unsigned i = 0; i < h; ++i) {
+    for (unsigned i = row_start; i < row_end; ++i) {
         // VERTICAL
         int ii = i - fwidth_half;
         unsigned n = w >> 4;
@@ -1082,17 +1079,19 @@ void vif_statistic_16_avx2(struct VifPublicState *s, float *num, float *den, uns
 
 
         if ((n << 4) != w) {
-            VifResiduals residuals =
+            VifResiduals line_residuals =
                 vif_compute_line_residuals(s, n << 4, w, scale);
-            accum_num_log += residuals.accum_num_log;
-            accum_den_log += residuals.accum_den_log;
-            accum_num_non_log += residuals.accum_num_non_log;
-            accum_den_non_log += residuals.accum_den_non_log;
+            accum_num_log += line_residuals.accum_num_log;
+            accum_den_log += line_residuals.accum_den_log;
+            accum_num_non_log += line_residuals.accum_num_non_log;
+            accum_den_non_log += line_residuals.accum_den_non_log;
         }
     }
 
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 }
 
 void vif_subsample_rd_8_avx2(VifBuffer buf, unsigned w, unsigned h) {
@@ -141,7 +141,7 @@ static inline void vif_statistic_avx512(Residuals512 *out, __m512i xx, __m512i x
     out->maccum_den_non_log = maccum_den_non_log;
 }
 
-void vif_statistic_8_avx512(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h) {
+void vif_statistic_8_avx512(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end) {
     const unsigned fwidth = vif_filter1d_width[0];
     const uint16_t *vif_filt = vif_filter1d_table[0];
     VifBuffer buf = s->buf;
@@ -167,12 +167,12 @@ void vif_statistic_8_avx512(struct VifPublicState *s, float *num, float *den, un
     __m512i round_128 = _mm512_set1_epi32(128);
     __m512i mask2 = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
 
-    Residuals512 residuals;
-    residuals.maccum_den_log = _mm512_setzero_si512();
-    residuals.maccum_num_log = _mm512_setzero_si512();
-    residuals.maccum_den_non_log = _mm512_setzero_si512();
-    residuals.maccum_num_non_log = _mm512_setzero_si512();
-    for (unsigned i = 0; i < h; ++i)
+    Residuals512 mresiduals;
+    mresiduals.maccum_den_log = _mm512_setzero_si512();
+    mresiduals.maccum_num_log = _mm512_setzero_si512();
+    mresiduals.maccum_den_non_log = _mm512_setzero_si512();
+    mresiduals.maccum_num_non_log = _mm512_setzero_si512();
+    for (unsigned i = row_start; i < row_end; ++i)
     {
         // VERTICAL
         int i_back = i - fwidth_half;
@@ -364,27 +364,29 @@ void vif_statistic_8_avx512(struct VifPublicState *s, float *num, float *den, un
                 __m512i refdis = _mm512_permutex2var_epi32(refdis_lo, mask2, refdis_hi);
                 xy = _mm512_sub_epi32(refdis, mu1mu2);
             }
-            vif_statistic_avx512(&residuals, xx, xy, yy, log2_table, vif_enhn_gain_limit);
+            vif_statistic_avx512(&mresiduals, xx, xy, yy, log2_table, vif_enhn_gain_limit);
         }
 
         if ((n << 4) != w) {
-            VifResiduals residuals = vif_compute_line_residuals(s, n << 4, w, 0);
-            accum_num_log += residuals.accum_num_log;
-            accum_den_log += residuals.accum_den_log;
-            accum_num_non_log += residuals.accum_num_non_log;
-            accum_den_non_log += residuals.accum_den_non_log;
+            VifResiduals line_residuals = vif_compute_line_residuals(s, n << 4, w, 0);
+            accum_num_log += line_residuals.accum_num_log;
+            accum_den_log += line_residuals.accum_den_log;
+            accum_num_non_log += line_residuals.accum_num_non_log;
+            accum_den_non_log += line_residuals.accum_den_non_log;
         }
     }
 
-    accum_num_log += _mm512_reduce_add_epi64(residuals.maccum_num_log);
-    accum_den_log += _mm512_reduce_add_epi64(residuals.maccum_den_log);
-    accum_num_non_log += _mm512_reduce_add_epi64(residuals.maccum_num_non_log);
-    accum_den_non_log += _mm512_reduce_add_epi64(residuals.maccum_den_non_log);
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    accum_num_log += _mm512_reduce_add_epi64(mresiduals.maccum_num_log);
+    accum_den_log += _mm512_reduce_add_epi64(mresiduals.maccum_den_log);
+    accum_num_non_log += _mm512_reduce_add_epi64(mresiduals.maccum_num_non_log);
+    accum_den_non_log += _mm512_reduce_add_epi64(mresiduals.maccum_den_non_log);
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 }
 
-void vif_statistic_16_avx512(struct VifPublicState *s, float *num, float *den, unsigned w, unsigned h, int bpc, int scale) {
+void vif_statistic_16_avx512(struct VifPublicState *s, VifResiduals *residuals, unsigned w, unsigned row_start, unsigned row_end, int bpc, int scale) {
     const unsigned fwidth = vif_filter1d_width[scale];
     const uint16_t *vif_filt = vif_filter1d_table[scale];
     VifBuffer buf = s->buf;
@@ -397,11 +399,11 @@ void vif_statistic_16_avx512(struct VifPublicState *s, float *num, float *den, u
     double vif_enhn_gain_limit = s->vif_enhn_gain_limit;
     __m512i mask2 = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
 
-    Residuals512 residuals;
-    residuals.maccum_den_log = _mm512_setzero_si512();
-    residuals.maccum_num_log = _mm512_setzero_si512();
-    residuals.maccum_den_non_log = _mm512_setzero_si512();
-    residuals.maccum_num_non_log = _mm512_setzero_si512();
+    Residuals512 mresiduals;
+    mresiduals.maccum_den_log = _mm512_setzero_si512();
+    mresiduals.maccum_num_log = _mm512_setzero_si512();
+    mresiduals.maccum_den_non_log = _mm512_setzero_si512();
+    mresiduals.maccum_num_non_log = _mm512_setzero_si512();
 
     int64_t accum_num_log = 0;
     int64_t accum_den_log = 0;
@@ -427,7 +429,7 @@ void vif_statistic_16_avx512(struct VifPublicState *s, float *num, float *den, u
     uint16_t *ref = buf.ref;
     uint16_t *dis = buf.dis;
 
-    for (unsigned i = 0; i < h; ++i)
+    for (unsigned i = row_start; i < row_end; ++i)
     {
         //VERTICAL
         int ii = i - fwidth_half;
@@ -718,23 +720,23 @@ void vif_statistic_16_avx512(struct VifPublicState *s, float *num, float *den, u
                 __m512i refdis = _mm512_permutex2var_epi32(refdis_lo, mask2, refdis_hi);
                 xy = _mm512_sub_epi32(refdis, mu1mu2);
             }
-            vif_statistic_avx512(&residuals, xx, xy, yy, log2_table, vif_enhn_gain_limit);
+            vif_statistic_avx512(&mresiduals, xx, xy, yy, log2_table, vif_enhn_gain_limit);
         }
 
         if ((n << 4) != (int)w) {
-            VifResiduals residuals =
+            VifResiduals line_residuals =
                 vif_compute_line_residuals(s, n << 4, w, scale);
-            accum_num_log += residuals.accum_num_log;
-            accum_den_log += residuals.accum_den_log;
-            accum_num_non_log += residuals.accum_num_non_log;
-            accum_den_non_log += residuals.accum_den_non_log;
+            accum_num_log += line_residuals.accum_num_log;
+            accum_den_log += line_residuals.accum_den_log;
+            accum_num_non_log += line_residuals.accum_num_non_log;
+            accum_den_non_log += line_residuals.accum_den_non_log;
         }
     }
 
-    accum_num_log += _mm512_reduce_add_epi64(residuals.maccum_num_log);
-    accum_den_log += _mm512_reduce_add_epi64(residuals.maccum_den_log);
-    accum_num_non_log += _mm512_reduce_add_epi64(residuals.maccum_num_non_log);
-    accum_den_non_log += _mm512_reduce_add_epi64(residuals.maccum_den_non_log);
+    accum_num_log += _mm512_reduce_add_epi64(mresiduals.maccum_num_log);
+    accum_den_log += _mm512_reduce_add_epi64(mresiduals.maccum_den_log);
+    accum_num_non_log += _mm512_reduce_add_epi64(mresiduals.maccum_num_non_log);
+    accum_den_non_log += _mm512_reduce_add_epi64(mresiduals.maccum_den_non_log);
 
 
     /**
@@ -747,13 +749,10 @@ void vif_statistic_16_avx512(struct VifPublicState *s, float *num, float *den, u
         * log based values are separately accumulated.
         * While adding both accumulator values the non-log accumulator is converted such that it is equivalent to 1 - sigma1_sq * constant(1's are accumulated with non-log denominator accumulator)
     */
-    //log has to be divided by 2048 as log_value = log2(i*2048)  i=16384 to 65535
-    //num[0] = accum_num_log / 2048.0 + (accum_den_non_log - (accum_num_non_log / 65536.0) / (255.0*255.0));
-    //den[0] = accum_den_log / 2048.0 + accum_den_non_log;
-
-    //changed calculation to increase performance
-    num[0] = accum_num_log / 2048.0 + (accum_den_non_log - ((accum_num_non_log) / 16384.0) / (65025.0));
-    den[0] = accum_den_log / 2048.0 + accum_den_non_log;
+    residuals->accum_num_log += accum_num_log;
+    residuals->accum_den_log += accum_den_log;
+    residuals->accum_num_non_log += accum_num_non_log;
+    residuals->accum_den_non_log += accum_den_non_log;
 }
 
 void vif_subsample_rd_8_avx512(VifBuffer buf, unsigned w, unsigned h)
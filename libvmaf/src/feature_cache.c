@@ -0,0 +1,551 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "cpu.h"
+#include "feature_cache.h"
+#include "log.h"
+#include "picture.h"
+#include "libvmaf/version.h"
+
+#define CACHE_MAGIC "VMAFFEAT"
+#define CACHE_VERSION 1
+#define CACHE_HEADER_SIZE 16
+#define RECORD_MAGIC 0x52434656 // "VFCR"
+#define RECORD_HEADER_SIZE 32
+
+typedef struct CacheEntry {
+    uint64_t key[2];
+    const uint8_t *payload;
+    uint32_t size;
+    bool owned;
+} CacheEntry;
+
+struct VmafFeatureCache {
+    pthread_mutex_t lock;
+    FILE *file;
+    uint8_t *map;
+    size_t map_size;
+    CacheEntry *entry;
+    unsigned cnt, capacity;
+    uint32_t *slot; ///< entry index + 1, 0 if empty
+    unsigned n_slots;
+    uint64_t hits, misses;
+};
+
+/*
+ * 128-bit non-cryptographic hash. Four independent lanes keep a frame hash
+ * well below the cost of running any extractor on it.
+ */
+
+#define P1 0x9e3779b185ebca87ULL
+#define P2 0xc2b2ae3d27d4eb4fULL
+#define P3 0x165667b19e3779f9ULL
+#define P4 0x85ebca77c2b2ae63ULL
+
+typedef struct Hash {
+    uint64_t lane[4];
+    uint64_t len;
+} Hash;
+
+static inline uint64_t rotl64(uint64_t x, unsigned r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t v)
+{
+    acc += v * P2;
+    acc = rotl64(acc, 31);
+    return acc * P1;
+}
+
+static inline uint64_t fmix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void hash_init(Hash *h)
+{
+    h->lane[0] = P1 + P2;
+    h->lane[1] = P2;
+    h->lane[2] = 0;
+    h->lane[3] = -P1;
+    h->len = 0;
+}
+
+static void hash_update(Hash *h, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    h->len += len;
+
+    for (; len >= 32; len -= 32, p += 32) {
+        uint64_t v[4];
+        memcpy(v, p, sizeof(v));
+        h->lane[0] = hash_round(h->lane[0], v[0]);
+        h->lane[1] = hash_round(h->lane[1], v[1]);
+        h->lane[2] = hash_round(h->lane[2], v[2]);
+        h->lane[3] = hash_round(h->lane[3], v[3]);
+    }
+    for (unsigned i = 0; len; i++) {
+        uint64_t v = 0;
+        const size_t n = len < 8 ? len : 8;
+        memcpy(&v, p, n);
+        h->lane[i] = hash_round(h->lane[i], v ^ ((uint64_t) n << 59));
+        len -= n;
+        p += n;
+    }
+}
+
+static void hash_final(const Hash *h, uint64_t out[2])
+{
+    const uint64_t *l = h->lane;
+    out[0] = fmix64(rotl64(l[0], 1) + rotl64(l[1], 7) + rotl64(l[2], 12) +
+                    rotl64(l[3], 18) + h->len);
+    out[1] = fmix64((l[0] * P3) ^ rotl64(l[1], 23) ^ rotl64(l[2], 41) ^
+                    (l[3] * P4) ^ (h->len * P1));
+}
+
+static int picture_hash(VmafPicture *pic, uint64_t out[2])
+{
+    VmafPicturePrivate *priv = pic->priv;
+    if (!priv) return -EINVAL;
+
+    pthread_mutex_lock(&priv->derived.lock);
+    if (!priv->hash.valid) {
+        Hash h;
+        hash_init(&h);
+        const uint32_t params[4] = {
+            pic->pix_fmt, pic->bpc, pic->w[0], pic->h[0],
+        };
+        hash_update(&h, params, sizeof(params));
+
+        const unsigned n_planes = pic->pix_fmt == VMAF_PIX_FMT_YUV400P ? 1 : 3;
+        for (unsigned p = 0; p < n_planes; p++) {
+            const size_t row_size = (size_t) pic->w[p] << (pic->bpc > 8);
+            const uint8_t *data = pic->data[p];
+            for (unsigned i = 0; i < pic->h[p]; i++)
+                hash_update(&h, data + i * pic->stride[p], row_size);
+        }
+        hash_final(&h, priv->hash.value);
+        priv->hash.valid = 1;
+    }
+    out[0] = priv->hash.value[0];
+    out[1] = priv->hash.value[1];
+    pthread_mutex_unlock(&priv->derived.lock);
+    return 0;
+}
+
+static int cache_key(VmafFeatureExtractorContext *fex_ctx, VmafPicture *ref,
+                     VmafPicture *dist, uint64_t key[2])
+{
+    uint64_t pics[4];
+    int err = picture_hash(ref, &pics[0]);
+    if (err) return err;
+    err = picture_hash(dist, &pics[2]);
+    if (err) return err;
+
+    // option order does not matter, so entries are combined by summation
+    uint64_t opts[3] = { 0 };
+    VmafDictionary *d = fex_ctx->opts_dict;
+    for (unsigned i = 0; d && i < d->cnt; i++) {
+        Hash h;
+        hash_init(&h);
+        hash_update(&h, d->entry[i].key, strlen(d->entry[i].key) + 1);
+        hash_update(&h, d->entry[i].val, strlen(d->entry[i].val) + 1);
+        uint64_t e[2];
+        hash_final(&h, e);
+        opts[0] += e[0];
+        opts[1] += e[1];
+        opts[2]++;
+    }
+
+    // float extractors are not bit-exact across SIMD variants, so scores
+    // only match for the same set of cpu flags
+    const uint32_t version[5] = {
+        CACHE_VERSION, VMAF_API_VERSION_MAJOR, VMAF_API_VERSION_MINOR,
+        VMAF_API_VERSION_PATCH, vmaf_get_cpu_flags(),
+    };
+
+    Hash h;
+    hash_init(&h);
+    hash_update(&h, version, sizeof(version));
+    hash_update(&h, pics, sizeof(pics));
+    hash_update(&h, fex_ctx->fex->name, strlen(fex_ctx->fex->name) + 1);
+    hash_update(&h, opts, sizeof(opts));
+    hash_final(&h, key);
+    return 0;
+}
+
+static uint64_t payload_check(const uint8_t *payload, size_t size)
+{
+    Hash h;
+    hash_init(&h);
+    hash_update(&h, payload, size);
+    uint64_t out[2];
+    hash_final(&h, out);
+    return out[0];
+}
+
+static CacheEntry *lookup(VmafFeatureCache *cache, const uint64_t key[2])
+{
+    if (!cache->n_slots) return NULL;
+    const unsigned mask = cache->n_slots - 1;
+    for (unsigned i = key[0] & mask; cache->slot[i]; i = (i + 1) & mask) {
+        CacheEntry *e = &cache->entry[cache->slot[i] - 1];
+        if (e->key[0] == key[0] && e->key[1] == key[1])
+            return e;
+    }
+    return NULL;
+}
+
+static int grow_slots(VmafFeatureCache *cache)
+{
+    const unsigned n_slots = cache->n_slots ? cache->n_slots * 2 : 1024;
+    uint32_t *slot = calloc(n_slots, sizeof(*slot));
+    if (!slot) return -ENOMEM;
+
+    const unsigned mask = n_slots - 1;
+    for (unsigned j = 0; j < cache->cnt; j++) {
+        unsigned i = cache->entry[j].key[0] & mask;
+        while (slot[i]) i = (i + 1) & mask;
+        slot[i] = j + 1;
+    }
+    free(cache->slot);
+    cache->slot = slot;
+    cache->n_slots = n_slots;
+    return 0;
+}
+
+static int insert(VmafFeatureCache *cache, const uint64_t key[2],
+                  const uint8_t *payload, uint32_t size, bool owned)
+{
+    if (lookup(cache, key)) return -EEXIST;
+
+    if (cache->cnt == cache->capacity) {
+        const unsigned capacity = cache->capacity ? cache->capacity * 2 : 256;
+        CacheEntry *entry = realloc(cache->entry, sizeof(*entry) * capacity);
+        if (!entry) return -ENOMEM;
+        cache->entry = entry;
+        cache->capacity = capacity;
+    }
+    if ((cache->cnt + 1) * 2 > cache->n_slots) {
+        int err = grow_slots(cache);
+        if (err) return err;
+    }
+
+    CacheEntry *e = &cache->entry[cache->cnt];
+    e->key[0] = key[0];
+    e->key[1] = key[1];
+    e->payload = payload;
+    e->size = size;
+    e->owned = owned;
+
+    const unsigned mask = cache->n_slots - 1;
+    unsigned i = key[0] & mask;
+    while (cache->slot[i]) i = (i + 1) & mask;
+    cache->slot[i] = ++cache->cnt;
+    return 0;
+}
+
+static int load(VmafFeatureCache *cache, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    if (size <= 0) {
+        fclose(f);
+        return 0;
+    }
+
+    int err = 0;
+#ifdef _WIN32
+    cache->map = malloc(size);
+    if (!cache->map) {
+        err = -ENOMEM;
+        goto close;
+    }
+    fseek(f, 0, SEEK_SET);
+    if (fread(cache->map, 1, size, f) != (size_t) size) {
+        free(cache->map);
+        cache->map = NULL;
+        err = -EIO;
+        goto close;
+    }
+#else
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (map == MAP_FAILED) {
+        err = -errno;
+        goto close;
+    }
+    cache->map = map;
+#endif
+    cache->map_size = size;
+
+    if (cache->map_size < CACHE_HEADER_SIZE ||
+        memcmp(cache->map, CACHE_MAGIC, strlen(CACHE_MAGIC)))
+    {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "\"%s\" is not a feature cache\n", path);
+        err = -EINVAL;
+        goto close;
+    }
+
+    // records are 8 byte aligned, so a torn one is skipped by searching
+    // for the next magic
+    size_t pos = CACHE_HEADER_SIZE;
+    while (pos + RECORD_HEADER_SIZE <= cache->map_size) {
+        const uint8_t *r = cache->map + pos;
+        uint32_t magic, payload_size;
+        uint64_t key[2], check;
+        memcpy(&magic, r, 4);
+        memcpy(&payload_size, r + 4, 4);
+        memcpy(key, r + 8, 16);
+        memcpy(&check, r + 24, 8);
+
+        if (magic != RECORD_MAGIC ||
+            payload_size > cache->map_size - pos - RECORD_HEADER_SIZE ||
+            payload_check(r + RECORD_HEADER_SIZE, payload_size) != check)
+        {
+            pos += 8;
+            continue;
+        }
+
+        err = insert(cache, key, r + RECORD_HEADER_SIZE, payload_size, false);
+        if (err && err != -EEXIST) goto close;
+        err = 0;
+        pos += (RECORD_HEADER_SIZE + payload_size + 7) & ~(size_t) 7;
+    }
+
+close:
+    fclose(f);
+    return err;
+}
+
+int vmaf_feature_cache_open(VmafFeatureCache **cache, const char *path)
+{
+    if (!cache) return -EINVAL;
+    if (!path) return -EINVAL;
+
+    VmafFeatureCache *const c = *cache = malloc(sizeof(*c));
+    if (!c) return -ENOMEM;
+    memset(c, 0, sizeof(*c));
+    pthread_mutex_init(&c->lock, NULL);
+
+    int err = load(c, path);
+    if (err) goto fail;
+
+    c->file = fopen(path, "ab");
+    if (!c->file) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "could not open feature cache \"%s\"\n", path);
+        err = -EIO;
+        goto fail;
+    }
+    fseek(c->file, 0, SEEK_END);
+    if (!ftell(c->file)) {
+        uint8_t header[CACHE_HEADER_SIZE] = { 0 };
+        const uint32_t version = CACHE_VERSION;
+        memcpy(header, CACHE_MAGIC, strlen(CACHE_MAGIC));
+        memcpy(header + 8, &version, sizeof(version));
+        fwrite(header, sizeof(header), 1, c->file);
+        fflush(c->file);
+    }
+
+    return 0;
+
+fail:
+    vmaf_feature_cache_close(c);
+    *cache = NULL;
+    return err;
+}
+
+int vmaf_feature_cache_close(VmafFeatureCache *cache)
+{
+    if (!cache) return -EINVAL;
+
+    if (cache->file)
+        fclose(cache->file);
+    for (unsigned i = 0; i < cache->cnt; i++) {
+        if (cache->entry[i].owned)
+            free((void *) cache->entry[i].payload);
+    }
+    if (cache->map) {
+#ifdef _WIN32
+        free(cache->map);
+#else
+        munmap(cache->map, cache->map_size);
+#endif
+    }
+    free(cache->entry);
+    free(cache->slot);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+    return 0;
+}
+
+static int replay(const uint8_t *payload, uint32_t size, unsigned index,
+                  VmafFeatureCollector *vfc)
+{
+    uint32_t cnt;
+    if (size < 4) return -EINVAL;
+    memcpy(&cnt, payload, 4);
+
+    size_t pos = 4;
+    for (unsigned i = 0; i < cnt; i++) {
+        double value;
+        uint32_t name_len;
+        if (size - pos < 12) return -EINVAL;
+        memcpy(&value, payload + pos, 8);
+        memcpy(&name_len, payload + pos + 8, 4);
+        pos += 12;
+        if (!name_len || name_len > size - pos) return -EINVAL;
+        const char *name = (const char *) payload + pos;
+        if (name[name_len - 1]) return -EINVAL;
+        pos += name_len;
+
+        int err = vmaf_feature_collector_append(vfc, name, value, index);
+        if (err) return err;
+    }
+    return 0;
+}
+
+static int store(VmafFeatureCache *cache, const uint64_t key[2],
+                 FeatureRecord *record, unsigned index)
+{
+    size_t payload_size = 4;
+    for (unsigned i = 0; i < record->cnt; i++) {
+        // scores for other frames could not be replayed for this one
+        if (record->entry[i].index != index) return 0;
+        payload_size += 12 + strlen(record->entry[i].name) + 1;
+    }
+    if (payload_size > UINT32_MAX) return -EINVAL;
+
+    const size_t record_size = (RECORD_HEADER_SIZE + payload_size + 7) & ~7;
+    uint8_t *r = calloc(1, record_size);
+    if (!r) return -ENOMEM;
+
+    uint8_t *p = r + RECORD_HEADER_SIZE;
+    memcpy(p, &record->cnt, 4);
+    size_t pos = 4;
+    for (unsigned i = 0; i < record->cnt; i++) {
+        const uint32_t name_len = strlen(record->entry[i].name) + 1;
+        memcpy(p + pos, &record->entry[i].value, 8);
+        memcpy(p + pos + 8, &name_len, 4);
+        memcpy(p + pos + 12, record->entry[i].name, name_len);
+        pos += 12 + name_len;
+    }
+
+    const uint32_t magic = RECORD_MAGIC, size = payload_size;
+    const uint64_t check = payload_check(p, payload_size);
+    memcpy(r, &magic, 4);
+    memcpy(r + 4, &size, 4);
+    memcpy(r + 8, key, 16);
+    memcpy(r + 24, &check, 8);
+
+    uint8_t *payload = malloc(payload_size);
+    if (!payload) {
+        free(r);
+        return -ENOMEM;
+    }
+    memcpy(payload, p, payload_size);
+
+    pthread_mutex_lock(&cache->lock);
+    int err = insert(cache, key, payload, size, true);
+    if (!err) {
+        if (fwrite(r, record_size, 1, cache->file) != 1 ||
+            fflush(cache->file))
+        {
+            vmaf_log(VMAF_LOG_LEVEL_WARNING,
+                     "problem writing to feature cache\n");
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    free(r);
+    if (err) free(payload);
+    return err == -EEXIST ? 0 : err;
+}
+
+int vmaf_feature_cache_extract(VmafFeatureCache *cache,
+                               VmafFeatureExtractorContext *fex_ctx,
+                               VmafPicture *ref, VmafPicture *ref_90,
+                               VmafPicture *dist, VmafPicture *dist_90,
+                               unsigned index, VmafFeatureCollector *vfc)
+{
+    if (!cache) return -EINVAL;
+    if (!fex_ctx) return -EINVAL;
+    if (!vfc) return -EINVAL;
+
+    uint64_t key[2];
+    int err = cache_key(fex_ctx, ref, dist, key);
+    if (err) return err;
+
+    pthread_mutex_lock(&cache->lock);
+    CacheEntry *e = lookup(cache, key);
+    const uint8_t *payload = e ? e->payload : NULL;
+    const uint32_t size = e ? e->size : 0;
+    if (e) cache->hits++;
+    else cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    // payloads are never freed or moved before vmaf_feature_cache_close()
+    if (payload && !replay(payload, size, index, vfc))
+        return 0;
+
+    FeatureRecord record = { 0 };
+    VmafFeatureCollector recorder = {
+        .perf = vfc->perf,
+        .record = &record,
+    };
+    err = vmaf_feature_extractor_context_extract(fex_ctx, ref, ref_90, dist,
+                                                 dist_90, index, &recorder);
+    err |= vmaf_feature_record_replay(&record, vfc);
+    if (!err && !payload)
+        err = store(cache, key, &record, index);
+
+    vmaf_feature_record_free(&record);
+    return err;
+}
+
+void vmaf_feature_cache_stats(VmafFeatureCache *cache, uint64_t *hits,
+                              uint64_t *misses)
+{
+    pthread_mutex_lock(&cache->lock);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    pthread_mutex_unlock(&cache->lock);
+}
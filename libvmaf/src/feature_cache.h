@@ -0,0 +1,69 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_SRC_FEATURE_CACHE_H__
+#define __VMAF_SRC_FEATURE_CACHE_H__
+
+#include <stdint.h>
+
+#include "feature/feature_collector.h"
+#include "feature/feature_extractor.h"
+#include "libvmaf/picture.h"
+
+/*
+ * On-disk cache of per-frame feature scores, see
+ * `VmafConfiguration.feature_cache`. Entries are keyed by a hash of the
+ * reference and distorted pictures, the extractor name, its options, the
+ * libvmaf version and the cpu flags, so a hit yields exactly what extraction
+ * would have.
+ *
+ * The file is append-only: a 16 byte header followed by records of
+ *
+ *     uint32_t magic, size;   // size of the payload in bytes
+ *     uint64_t key[2];
+ *     uint64_t check;         // hash of the payload
+ *     payload: uint32_t cnt, then cnt times
+ *              { double value; uint32_t name_len; char name[name_len]; }
+ *     zero padding to a multiple of 8 bytes
+ *
+ * in native byte order. Each record is written with a single append, so
+ * several processes can share a cache file. It is mapped read-only on open;
+ * records which are torn or fail the check are skipped.
+ */
+
+typedef struct VmafFeatureCache VmafFeatureCache;
+
+int vmaf_feature_cache_open(VmafFeatureCache **cache, const char *path);
+
+int vmaf_feature_cache_close(VmafFeatureCache *cache);
+
+/**
+ * Extract features through the cache: on a hit the stored scores are
+ * appended to `vfc` and the extractor is not run, on a miss it is run and
+ * its scores are stored. Only for non-temporal extractors.
+ */
+int vmaf_feature_cache_extract(VmafFeatureCache *cache,
+                               VmafFeatureExtractorContext *fex_ctx,
+                               VmafPicture *ref, VmafPicture *ref_90,
+                               VmafPicture *dist, VmafPicture *dist_90,
+                               unsigned index, VmafFeatureCollector *vfc);
+
+void vmaf_feature_cache_stats(VmafFeatureCache *cache, uint64_t *hits,
+                              uint64_t *misses);
+
+#endif /* __VMAF_SRC_FEATURE_CACHE_H__ */
@@ -21,6 +21,7 @@
 
 #include "feature/feature_extractor.h"
 #include "feature/feature_name.h"
+#include "feature/integer_vmaf_core.h"
 #include "fex_ctx_vector.h"
 #include "log.h"
 
@@ -45,6 +46,10 @@ int feature_extractor_vector_append(RegisteredFeatureExtractors *rfe,
     (void) flags;
 
     for (unsigned i = 0; i < rfe->cnt; i++) {
+        // already covered by a fused vmaf_core extractor
+        if (vmaf_core_provides(rfe->fex_ctx[i], fex_ctx))
+            return vmaf_feature_extractor_context_destroy(fex_ctx);
+
         char *feature_a =
             vmaf_feature_name_from_options(rfe->fex_ctx[i]->fex->name,
                     rfe->fex_ctx[i]->fex->options, rfe->fex_ctx[i]->fex->priv);
@@ -0,0 +1,217 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_queue.h"
+
+typedef struct VmafFrameQueue {
+    struct {
+        unsigned index;
+        unsigned refs;
+        bool held, delivered;
+    } *frame; ///< in submission order, frame[0] has id `first`
+    unsigned cnt, capacity;
+    uint64_t first;
+    unsigned pending, max_pending;
+    bool in_order, delivering;
+    void (*deliver)(void *data, unsigned index);
+    void *data;
+    pthread_mutex_t lock;
+    pthread_cond_t room;
+} VmafFrameQueue;
+
+int vmaf_frame_queue_create(VmafFrameQueue **queue, unsigned max_pending,
+                            bool in_order,
+                            void (*deliver)(void *data, unsigned index),
+                            void *data)
+{
+    if (!queue) return -EINVAL;
+    if (!max_pending) return -EINVAL;
+    if (!deliver) return -EINVAL;
+
+    VmafFrameQueue *const q = *queue = malloc(sizeof(*q));
+    if (!q) return -ENOMEM;
+    memset(q, 0, sizeof(*q));
+    q->max_pending = max_pending;
+    q->in_order = in_order;
+    q->deliver = deliver;
+    q->data = data;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->room, NULL);
+    return 0;
+}
+
+static int find_deliverable(VmafFrameQueue *q)
+{
+    for (unsigned i = 0; i < q->cnt; i++) {
+        if (q->frame[i].delivered) continue;
+        if (!q->frame[i].refs && !q->frame[i].held) return i;
+        if (q->in_order) break;
+    }
+    return -1;
+}
+
+static void deliver(VmafFrameQueue *q)
+{
+    if (q->delivering) return;
+    q->delivering = true;
+
+    int i;
+    while ((i = find_deliverable(q)) >= 0) {
+        const unsigned index = q->frame[i].index;
+        q->frame[i].delivered = true;
+
+        pthread_mutex_unlock(&q->lock);
+        q->deliver(q->data, index);
+        pthread_mutex_lock(&q->lock);
+
+        unsigned n = 0;
+        while (n < q->cnt && q->frame[n].delivered) n++;
+        memmove(q->frame, q->frame + n, sizeof(*q->frame) * (q->cnt - n));
+        q->cnt -= n;
+        q->first += n;
+        q->pending--;
+        pthread_cond_broadcast(&q->room);
+    }
+
+    q->delivering = false;
+}
+
+int vmaf_frame_queue_push(VmafFrameQueue *queue, unsigned index, bool held,
+                          bool wait, uint64_t *id)
+{
+    if (!queue) return -EINVAL;
+    if (!id) return -EINVAL;
+
+    VmafFrameQueue *const q = queue;
+    int err = 0;
+    pthread_mutex_lock(&q->lock);
+
+    while (q->pending >= q->max_pending) {
+        if (!wait) {
+            err = -EAGAIN;
+            goto unlock;
+        }
+        pthread_cond_wait(&q->room, &q->lock);
+    }
+
+    if (q->cnt == q->capacity) {
+        const unsigned capacity = q->capacity ? q->capacity * 2 : 16;
+        void *frame = realloc(q->frame, sizeof(*q->frame) * capacity);
+        if (!frame) {
+            err = -ENOMEM;
+            goto unlock;
+        }
+        q->frame = frame;
+        q->capacity = capacity;
+    }
+
+    q->frame[q->cnt].index = index;
+    q->frame[q->cnt].refs = 1;
+    q->frame[q->cnt].held = held;
+    q->frame[q->cnt].delivered = false;
+    *id = q->first + q->cnt++;
+    q->pending++;
+
+unlock:
+    pthread_mutex_unlock(&q->lock);
+    return err;
+}
+
+int vmaf_frame_queue_ref(VmafFrameQueue *queue, uint64_t id)
+{
+    if (!queue) return -EINVAL;
+
+    VmafFrameQueue *const q = queue;
+    int err = 0;
+    pthread_mutex_lock(&q->lock);
+
+    if (id < q->first || id - q->first >= q->cnt) {
+        err = -EINVAL;
+        goto unlock;
+    }
+    q->frame[id - q->first].refs++;
+
+unlock:
+    pthread_mutex_unlock(&q->lock);
+    return err;
+}
+
+int vmaf_frame_queue_unref(VmafFrameQueue *queue, uint64_t id)
+{
+    if (!queue) return -EINVAL;
+
+    VmafFrameQueue *const q = queue;
+    int err = 0;
+    pthread_mutex_lock(&q->lock);
+
+    if (id < q->first || id - q->first >= q->cnt ||
+        !q->frame[id - q->first].refs)
+    {
+        err = -EINVAL;
+        goto unlock;
+    }
+
+    const unsigned i = id - q->first;
+    if (!--q->frame[i].refs && i > 0)
+        q->frame[i - 1].held = false;
+    deliver(q);
+
+unlock:
+    pthread_mutex_unlock(&q->lock);
+    return err;
+}
+
+int vmaf_frame_queue_release(VmafFrameQueue *queue)
+{
+    if (!queue) return -EINVAL;
+
+    VmafFrameQueue *const q = queue;
+    pthread_mutex_lock(&q->lock);
+    if (q->cnt)
+        q->frame[q->cnt - 1].held = false;
+    deliver(q);
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+unsigned vmaf_frame_queue_pending(VmafFrameQueue *queue)
+{
+    if (!queue) return 0;
+
+    pthread_mutex_lock(&queue->lock);
+    const unsigned pending = queue->pending;
+    pthread_mutex_unlock(&queue->lock);
+    return pending;
+}
+
+void vmaf_frame_queue_destroy(VmafFrameQueue *queue)
+{
+    if (!queue) return;
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->room);
+    free(queue->frame);
+    free(queue);
+}
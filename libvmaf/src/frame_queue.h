@@ -0,0 +1,65 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_FRAME_QUEUE_H__
+#define __VMAF_FRAME_QUEUE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Tracks submitted frames until their scores are final. A frame holds one
+ * reference per outstanding extraction, it is delivered once they have all
+ * been dropped. Temporal extractors write a frame's scores while extracting
+ * the next one, so a `held` frame additionally waits for the references of
+ * the frame submitted after it, or for `vmaf_frame_queue_release()`.
+ *
+ * `deliver` is called without the queue locked and never concurrently, on
+ * whichever thread dropped the last reference, in submission order when
+ * `in_order` is set.
+ */
+
+typedef struct VmafFrameQueue VmafFrameQueue;
+
+int vmaf_frame_queue_create(VmafFrameQueue **queue, unsigned max_pending,
+                            bool in_order,
+                            void (*deliver)(void *data, unsigned index),
+                            void *data);
+
+/**
+ * Add a frame holding a single reference and return its `id`. Returns
+ * -EAGAIN when `max_pending` frames are undelivered, unless `wait` is set,
+ * then blocks until one of them is.
+ */
+int vmaf_frame_queue_push(VmafFrameQueue *queue, unsigned index, bool held,
+                          bool wait, uint64_t *id);
+
+int vmaf_frame_queue_ref(VmafFrameQueue *queue, uint64_t id);
+
+int vmaf_frame_queue_unref(VmafFrameQueue *queue, uint64_t id);
+
+/**
+ * Drop the hold of the last frame pushed, when no further frames follow.
+ */
+int vmaf_frame_queue_release(VmafFrameQueue *queue);
+
+unsigned vmaf_frame_queue_pending(VmafFrameQueue *queue);
+
+void vmaf_frame_queue_destroy(VmafFrameQueue *queue);
+
+#endif /* __VMAF_FRAME_QUEUE_H__ */
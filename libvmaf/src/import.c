@@ -0,0 +1,347 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "feature/alias.h"
+#include "import.h"
+#include "libvmaf/libvmaf.h"
+#include "log.h"
+#include "output.h"
+#include "pdjson.h"
+
+#define MAX_NAME_LEN 4096
+
+static bool excluded(const char *name, const char *const *exclude)
+{
+    for (unsigned i = 0; exclude && exclude[i]; i++) {
+        const size_t len = strlen(exclude[i]);
+        if (!strncmp(name, exclude[i], len) &&
+            (name[len] == '\0' || name[len] == '_'))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int read_u32(FILE *in, uint32_t *x)
+{
+    return fread(x, sizeof(*x), 1, in) == 1 ? 0 : -EINVAL;
+}
+
+int vmaf_import_binary(VmafFeatureCollector *fc, FILE *in,
+                       const char *const *exclude, unsigned *index_low,
+                       unsigned *frame_cnt)
+{
+    char magic[8];
+    uint32_t version, low = UINT32_MAX, high = 0, n_features;
+    if (fread(magic, sizeof(magic), 1, in) != 1 ||
+        memcmp(magic, VMAF_OUTPUT_BINARY_MAGIC, sizeof(magic)) ||
+        read_u32(in, &version) || !version ||
+        version > VMAF_OUTPUT_BINARY_VERSION ||
+        (version > 1 && (read_u32(in, &low) || read_u32(in, &high))) ||
+        read_u32(in, &n_features))
+    {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "unsupported binary feature scores\n");
+        return -EINVAL;
+    }
+    // without bounds, the scores are taken to cover the pictures they span
+    const bool bounded = version > 1;
+    if (bounded) {
+        *index_low = low;
+        *frame_cnt = high;
+    }
+
+    int err = 0;
+    char *name = malloc(MAX_NAME_LEN);
+    double *score = NULL;
+    unsigned score_capacity = 0;
+    if (!name) return -ENOMEM;
+
+    for (unsigned i = 0; i < n_features; i++) {
+        uint32_t name_len, n_runs;
+        err = read_u32(in, &name_len);
+        if (err || !name_len || name_len > MAX_NAME_LEN) goto truncated;
+        if (fread(name, 1, name_len, in) != name_len || name[name_len - 1])
+            goto truncated;
+        err = read_u32(in, &n_runs);
+        if (err) goto truncated;
+
+        const bool skip = excluded(name, exclude);
+        for (unsigned j = 0; j < n_runs; j++) {
+            uint32_t index, cnt;
+            if (read_u32(in, &index) || read_u32(in, &cnt) ||
+                cnt > UINT32_MAX - index)
+            {
+                goto truncated;
+            }
+            if (cnt > score_capacity) {
+                void *s = realloc(score, sizeof(*score) * cnt);
+                if (!s) {
+                    err = -ENOMEM;
+                    goto free;
+                }
+                score = s;
+                score_capacity = cnt;
+            }
+            if (fread(score, sizeof(*score), cnt, in) != cnt)
+                goto truncated;
+            if (skip) continue;
+
+            err = vmaf_feature_collector_append_scores(fc, name, score, index,
+                                                       cnt);
+            if (err) goto free;
+            if (bounded) continue;
+            if (index < *index_low)
+                *index_low = index;
+            if (index + cnt > *frame_cnt)
+                *frame_cnt = index + cnt;
+        }
+    }
+
+free:
+    free(name);
+    free(score);
+    return err;
+
+truncated:
+    vmaf_log(VMAF_LOG_LEVEL_ERROR, "binary feature scores are truncated\n");
+    err = -EINVAL;
+    goto free;
+}
+
+int vmaf_import_checkpoint(VmafFeatureCollector *fc, FILE *in,
+                           unsigned n_subsample, unsigned *index)
+{
+    char magic[8];
+    uint32_t version, idx, subsample;
+    if (fread(magic, sizeof(magic), 1, in) != 1 ||
+        memcmp(magic, VMAF_CHECKPOINT_MAGIC, sizeof(magic)) ||
+        read_u32(in, &version) || version != VMAF_CHECKPOINT_VERSION ||
+        read_u32(in, &idx) || read_u32(in, &subsample))
+    {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "unsupported checkpoint\n");
+        return -EINVAL;
+    }
+    if (subsample != n_subsample) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "checkpoint was written with a subsample of %u\n", subsample);
+        return -EINVAL;
+    }
+
+    unsigned index_low = UINT_MAX, frame_cnt = 0;
+    int err = vmaf_import_binary(fc, in, NULL, &index_low, &frame_cnt);
+    if (err) return err;
+    if (frame_cnt > idx) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "checkpoint is corrupt\n");
+        return -EINVAL;
+    }
+
+    *index = idx;
+    return 0;
+}
+
+typedef struct Column {
+    char *name;
+    double *score;
+    bool *written;
+    unsigned capacity;
+} Column;
+
+typedef struct Columns {
+    Column *column;
+    unsigned cnt, capacity;
+} Columns;
+
+static Column *find_column(Columns *c, const char *name, unsigned hint)
+{
+    // metrics are written in the same order for every frame
+    if (hint < c->cnt && !strcmp(c->column[hint].name, name))
+        return &c->column[hint];
+    for (unsigned i = 0; i < c->cnt; i++) {
+        if (!strcmp(c->column[i].name, name))
+            return &c->column[i];
+    }
+
+    if (c->cnt == c->capacity) {
+        const unsigned capacity = c->capacity ? c->capacity * 2 : 16;
+        Column *column = realloc(c->column, sizeof(*column) * capacity);
+        if (!column) return NULL;
+        c->column = column;
+        c->capacity = capacity;
+    }
+    Column *column = &c->column[c->cnt];
+    memset(column, 0, sizeof(*column));
+    column->name = strdup(name);
+    if (!column->name) return NULL;
+    c->cnt++;
+    return column;
+}
+
+static int column_set(Column *column, unsigned index, double score)
+{
+    if (index >= column->capacity) {
+        unsigned capacity = column->capacity ? column->capacity : 256;
+        while (index >= capacity) capacity *= 2;
+        double *s = realloc(column->score, sizeof(*s) * capacity);
+        if (!s) return -ENOMEM;
+        column->score = s;
+        bool *w = realloc(column->written, sizeof(*w) * capacity);
+        if (!w) return -ENOMEM;
+        memset(w + column->capacity, 0,
+               sizeof(*w) * (capacity - column->capacity));
+        column->written = w;
+        column->capacity = capacity;
+    }
+    column->score[index] = score;
+    column->written[index] = true;
+    return 0;
+}
+
+static int parse_frame(json_stream *s, Columns *c, unsigned *index_low,
+                       unsigned *frame_cnt)
+{
+    int err = 0;
+    unsigned index = 0;
+    bool have_index = false;
+
+    while (json_peek(s) != JSON_OBJECT_END && !json_get_error(s)) {
+        if (json_next(s) != JSON_STRING) return -EINVAL;
+        const char *key = json_get_string(s, NULL);
+
+        if (!strcmp(key, "frameNum")) {
+            if (json_next(s) != JSON_NUMBER) return -EINVAL;
+            index = json_get_number(s);
+            have_index = true;
+        } else if (!strcmp(key, "metrics") && have_index) {
+            if (json_next(s) != JSON_OBJECT) return -EINVAL;
+            for (unsigned i = 0; json_peek(s) != JSON_OBJECT_END &&
+                 !json_get_error(s); i++)
+            {
+                if (json_next(s) != JSON_STRING) return -EINVAL;
+                Column *column = find_column(c, json_get_string(s, NULL), i);
+                if (!column) return -ENOMEM;
+                const enum json_type type = json_next(s);
+                if (type == JSON_NULL) continue;
+                if (type != JSON_NUMBER) return -EINVAL;
+                err = column_set(column, index, json_get_number(s));
+                if (err) return err;
+            }
+            json_next(s);
+            if (index < *index_low)
+                *index_low = index;
+            if (index + 1 > *frame_cnt)
+                *frame_cnt = index + 1;
+        } else {
+            json_skip(s);
+        }
+    }
+    json_next(s);
+    return json_get_error(s) ? -EINVAL : 0;
+}
+
+static int import_column(VmafFeatureCollector *fc, Column *column)
+{
+    const char *name = vmaf_feature_name_from_alias(column->name);
+    for (unsigned i = 0; i < column->capacity;) {
+        if (!column->written[i]) {
+            i++;
+            continue;
+        }
+        const unsigned index = i;
+        while (i < column->capacity && column->written[i]) i++;
+        int err = vmaf_feature_collector_append_scores(fc, name,
+                                                       &column->score[index],
+                                                       index, i - index);
+        if (err) return err;
+    }
+    return 0;
+}
+
+int vmaf_import_json(VmafFeatureCollector *fc, FILE *in,
+                     const char *const *exclude, unsigned *index_low,
+                     unsigned *frame_cnt)
+{
+    int err = 0;
+    Columns c = { 0 };
+
+    json_stream s;
+    json_open_stream(&s, in);
+
+    if (json_next(&s) != JSON_OBJECT) {
+        err = -EINVAL;
+        goto close;
+    }
+    while (json_peek(&s) != JSON_OBJECT_END && !json_get_error(&s)) {
+        if (json_next(&s) != JSON_STRING) {
+            err = -EINVAL;
+            goto close;
+        }
+        if (strcmp(json_get_string(&s, NULL), "frames")) {
+            json_skip(&s);
+            continue;
+        }
+        if (json_next(&s) != JSON_ARRAY) {
+            err = -EINVAL;
+            goto close;
+        }
+        while (json_peek(&s) != JSON_ARRAY_END && !json_get_error(&s)) {
+            if (json_next(&s) != JSON_OBJECT) {
+                err = -EINVAL;
+                goto close;
+            }
+            err = parse_frame(&s, &c, index_low, frame_cnt);
+            if (err) goto close;
+        }
+        json_next(&s);
+    }
+    if (json_get_error(&s)) {
+        err = -EINVAL;
+        goto close;
+    }
+
+    for (unsigned i = 0; i < c.cnt; i++) {
+        const char *name = vmaf_feature_name_from_alias(c.column[i].name);
+        if (excluded(name, exclude) || excluded(c.column[i].name, exclude))
+            continue;
+        err = import_column(fc, &c.column[i]);
+        if (err) goto close;
+    }
+
+close:
+    if (err == -EINVAL) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "could not parse JSON feature scores%s%s\n",
+                 json_get_error(&s) ? ": " : "",
+                 json_get_error(&s) ? json_get_error(&s) : "");
+    }
+    json_close(&s);
+    for (unsigned i = 0; i < c.cnt; i++) {
+        free(c.column[i].name);
+        free(c.column[i].score);
+        free(c.column[i].written);
+    }
+    free(c.column);
+    return err;
+}
@@ -0,0 +1,51 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_IMPORT_H__
+#define __VMAF_IMPORT_H__
+
+#include <stdio.h>
+
+#include "feature/feature_collector.h"
+
+/*
+ * Readers for the outputs written by `vmaf_write_output_binary()` and
+ * `vmaf_write_output_json()`. Scores are imported a column at a time, features
+ * named in the NULL terminated `exclude` list (or prefixed with one of them
+ * and '_') are skipped. `index_low` and `frame_cnt` are set to the first
+ * picture the scores cover and one past the last, or lowered and raised to
+ * the lowest and one past the highest index with a score when the file does
+ * not record them. The caller sets them to UINT_MAX and 0.
+ */
+
+int vmaf_import_binary(VmafFeatureCollector *fc, FILE *in,
+                       const char *const *exclude, unsigned *index_low,
+                       unsigned *frame_cnt);
+
+int vmaf_import_json(VmafFeatureCollector *fc, FILE *in,
+                     const char *const *exclude, unsigned *index_low,
+                     unsigned *frame_cnt);
+
+/*
+ * Reader for `vmaf_write_checkpoint_file()`, checking it was written with
+ * the same `n_subsample`. `index` is set to the first picture to score.
+ */
+int vmaf_import_checkpoint(VmafFeatureCollector *fc, FILE *in,
+                           unsigned n_subsample, unsigned *index);
+
+#endif /* __VMAF_IMPORT_H__ */
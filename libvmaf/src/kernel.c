@@ -0,0 +1,463 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "cpu.h"
+#include "kernel.h"
+#include "log.h"
+#include "feature/feature_collector.h"
+#include "feature/feature_extractor.h"
+
+#define AUTOTUNE_FRAMES 3
+
+const VmafKernelVariant vmaf_kernel_variants_simd[] = {
+    { .name = "c" },
+#if ARCH_X86
+    {
+        .name = "avx2",
+        .cpu_flags = VMAF_X86_CPU_FLAG_AVX2,
+    },
+#if HAVE_AVX512
+    {
+        .name = "avx512",
+        .cpu_flags = VMAF_X86_CPU_FLAG_AVX2 | VMAF_X86_CPU_FLAG_AVX512,
+    },
+#endif
+#elif ARCH_AARCH64
+    {
+        .name = "neon",
+        .cpu_flags = VMAF_ARM_CPU_FLAG_NEON,
+    },
+#endif
+    { 0 }
+};
+
+typedef struct KernelEntry {
+    char kernel[32], variant[16];
+    unsigned cpu_flags, bpc, w, h;
+    bool autotuned;
+    const VmafKernel *selected_kernel; ///< NULL until used by this process
+    const VmafKernelVariant *selected_variant;
+} KernelEntry;
+
+static struct {
+    pthread_mutex_t lock, tune_lock;
+    KernelEntry *entry;
+    unsigned cnt, capacity;
+    struct {
+        bool active;
+        pthread_t thread;
+        const VmafKernel *kernel;
+        const VmafKernelVariant *variant;
+    } tuning;
+} registry = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .tune_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static bool is_supported(const VmafKernelVariant *v, unsigned flags,
+                         unsigned w)
+{
+    if (v->cpu_flags & ~flags) return false;
+    if (v->w_align && (w % v->w_align)) return false;
+    return true;
+}
+
+static const VmafKernelVariant *default_variant(const VmafKernel *kernel,
+                                                unsigned flags, unsigned w)
+{
+    const VmafKernelVariant *v = &kernel->variant[0];
+    for (unsigned i = 1; kernel->variant[i].name; i++) {
+        if (is_supported(&kernel->variant[i], flags, w))
+            v = &kernel->variant[i];
+    }
+    return v;
+}
+
+static const VmafKernelVariant *variant_by_name(const VmafKernel *kernel,
+                                                const char *name,
+                                                unsigned flags, unsigned w)
+{
+    for (unsigned i = 0; kernel->variant[i].name; i++) {
+        const VmafKernelVariant *v = &kernel->variant[i];
+        if (!strcmp(v->name, name) && is_supported(v, flags, w))
+            return v;
+    }
+    return NULL;
+}
+
+static KernelEntry *find(const char *kernel, unsigned flags, unsigned bpc,
+                         unsigned w, unsigned h)
+{
+    for (unsigned i = 0; i < registry.cnt; i++) {
+        KernelEntry *e = &registry.entry[i];
+        if (e->cpu_flags == flags && e->bpc == bpc && e->w == w &&
+            e->h == h && !strcmp(e->kernel, kernel))
+            return e;
+    }
+    return NULL;
+}
+
+static KernelEntry *add(const char *kernel, const char *variant,
+                        unsigned flags, unsigned bpc, unsigned w, unsigned h)
+{
+    if (strlen(kernel) >= sizeof(registry.entry->kernel)) return NULL;
+    if (strlen(variant) >= sizeof(registry.entry->variant)) return NULL;
+
+    if (registry.cnt == registry.capacity) {
+        const unsigned capacity = registry.capacity ? registry.capacity * 2 : 8;
+        KernelEntry *entry =
+            realloc(registry.entry, sizeof(*entry) * capacity);
+        if (!entry) return NULL;
+        registry.entry = entry;
+        registry.capacity = capacity;
+    }
+
+    KernelEntry *e = &registry.entry[registry.cnt++];
+    memset(e, 0, sizeof(*e));
+    strcpy(e->kernel, kernel);
+    strcpy(e->variant, variant);
+    e->cpu_flags = flags;
+    e->bpc = bpc;
+    e->w = w;
+    e->h = h;
+    return e;
+}
+
+static void log_selection(const KernelEntry *e)
+{
+    vmaf_log(e->autotuned ? VMAF_LOG_LEVEL_INFO : VMAF_LOG_LEVEL_DEBUG,
+             "kernel %s: %s (%ux%u, %u-bit%s)\n", e->kernel, e->variant,
+             e->w, e->h, e->bpc, e->autotuned ? ", autotuned" : "");
+}
+
+static void mark_selected(KernelEntry *e, const VmafKernel *kernel,
+                          const VmafKernelVariant *v)
+{
+    if (e->selected_kernel) return;
+    e->selected_kernel = kernel;
+    e->selected_variant = v;
+    log_selection(e);
+}
+
+static uint64_t wall_ns(void)
+{
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint32_t hash32(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+static int synthetic_picture(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
+                             unsigned bpc, unsigned w, unsigned h,
+                             uint32_t seed)
+{
+    int err = vmaf_picture_alloc(pic, pix_fmt, bpc, w, h);
+    if (err) return err;
+
+    const unsigned n_planes = pix_fmt == VMAF_PIX_FMT_YUV400P ? 1 : 3;
+    for (unsigned p = 0; p < n_planes; p++) {
+        const unsigned cell = (pic->w[p] / 30) | 1;
+        for (unsigned i = 0; i < pic->h[p]; i++) {
+            for (unsigned j = 0; j < pic->w[p]; j++) {
+                unsigned v = 48 + (((i + j) * 128) / (pic->w[p] + pic->h[p]));
+                v += (((i / cell) ^ (j / cell)) & 1) * 40;
+                v += hash32(seed ^ (i * 65537 + j)) & 15;
+                if (bpc == 8) {
+                    uint8_t *data = pic->data[p];
+                    data[i * pic->stride[p] + j] = v;
+                } else {
+                    uint16_t *data = pic->data[p];
+                    data[i * (pic->stride[p] / 2) + j] = v << (bpc - 8);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static void set_tuning(const VmafKernel *kernel, const VmafKernelVariant *v)
+{
+    pthread_mutex_lock(&registry.lock);
+    registry.tuning.active = !!kernel;
+    registry.tuning.thread = pthread_self();
+    registry.tuning.kernel = kernel;
+    registry.tuning.variant = v;
+    pthread_mutex_unlock(&registry.lock);
+}
+
+static int time_variant(const VmafKernel *kernel, const VmafKernelVariant *v,
+                        VmafPicture *ref, VmafPicture *dist, uint64_t *ns)
+{
+    VmafFeatureExtractor *fex =
+        vmaf_get_feature_extractor_by_name(kernel->feature_extractor);
+    if (!fex) return -EINVAL;
+
+    VmafFeatureCollector *fc;
+    int err = vmaf_feature_collector_init(&fc);
+    if (err) return err;
+    VmafFeatureExtractorContext *fex_ctx;
+    err = vmaf_feature_extractor_context_create(&fex_ctx, fex, NULL);
+    if (err) goto free_fc;
+
+    set_tuning(kernel, v);
+    err = vmaf_feature_extractor_context_init(fex_ctx, ref->pix_fmt,
+                                              ref->bpc, ref->w[0], ref->h[0]);
+    if (err) goto close;
+
+    // the first frame warms up caches and is not counted
+    uint64_t best = UINT64_MAX;
+    for (unsigned i = 0; i < AUTOTUNE_FRAMES + 1; i++) {
+        const uint64_t t0 = wall_ns();
+        err = vmaf_feature_extractor_context_extract(fex_ctx, ref, NULL,
+                                                     dist, NULL, i, fc);
+        const uint64_t t = wall_ns() - t0;
+        if (err) goto close;
+        if (i && t < best) best = t;
+    }
+    *ns = best;
+
+close:
+    set_tuning(NULL, NULL);
+    vmaf_feature_extractor_context_close(fex_ctx);
+    vmaf_feature_extractor_context_destroy(fex_ctx);
+free_fc:
+    vmaf_feature_collector_destroy(fc);
+    return err;
+}
+
+static void append_to_cache(const char *path, const KernelEntry *e)
+{
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        vmaf_log(VMAF_LOG_LEVEL_WARNING,
+                 "could not open kernel autotune cache \"%s\"\n", path);
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    if (!ftell(f))
+        fprintf(f, "# libvmaf kernel autotune cache\n"
+                   "# kernel wxh bpc cpu_flags variant\n");
+    fprintf(f, "%s %ux%u %u 0x%x %s\n", e->kernel, e->w, e->h, e->bpc,
+            e->cpu_flags, e->variant);
+    fclose(f);
+}
+
+static const VmafKernelVariant *autotune(const VmafKernel *kernel,
+                                         enum VmafPixelFormat pix_fmt,
+                                         unsigned bpc, unsigned w, unsigned h,
+                                         unsigned flags, const char *cache_path)
+{
+    const VmafKernelVariant *best = NULL;
+    pthread_mutex_lock(&registry.tune_lock);
+
+    // another thread may have tuned this kernel while we were waiting
+    pthread_mutex_lock(&registry.lock);
+    KernelEntry *e = find(kernel->name, flags, bpc, w, h);
+    if (e && e->autotuned) {
+        best = variant_by_name(kernel, e->variant, flags, w);
+        if (best) mark_selected(e, kernel, best);
+    }
+    pthread_mutex_unlock(&registry.lock);
+    if (best) goto unlock;
+
+    unsigned n_supported = 0;
+    for (unsigned i = 0; kernel->variant[i].name; i++)
+        n_supported += is_supported(&kernel->variant[i], flags, w);
+    if (n_supported < 2) goto unlock;
+
+    VmafPicture ref, dist;
+    if (synthetic_picture(&ref, pix_fmt, bpc, w, h, 1)) goto unlock;
+    if (synthetic_picture(&dist, pix_fmt, bpc, w, h, 2)) goto unref_ref;
+
+    uint64_t best_ns = UINT64_MAX;
+    for (unsigned i = 0; kernel->variant[i].name; i++) {
+        const VmafKernelVariant *v = &kernel->variant[i];
+        if (!is_supported(v, flags, w)) continue;
+        uint64_t ns;
+        int err = time_variant(kernel, v, &ref, &dist, &ns);
+        if (err) {
+            vmaf_log(VMAF_LOG_LEVEL_WARNING,
+                     "kernel %s: could not time %s variant\n",
+                     kernel->name, v->name);
+            continue;
+        }
+        vmaf_log(VMAF_LOG_LEVEL_DEBUG, "kernel %s: %s %.3f ms/frame\n",
+                 kernel->name, v->name, ns / 1e6);
+        if (ns < best_ns) {
+            best_ns = ns;
+            best = v;
+        }
+    }
+    vmaf_picture_unref(&dist);
+
+    if (best) {
+        pthread_mutex_lock(&registry.lock);
+        // replaces the default picked by a context which did not autotune
+        e = find(kernel->name, flags, bpc, w, h);
+        if (e) {
+            strcpy(e->variant, best->name);
+            e->selected_kernel = NULL;
+        } else {
+            e = add(kernel->name, best->name, flags, bpc, w, h);
+        }
+        if (e) {
+            e->autotuned = true;
+            mark_selected(e, kernel, best);
+            if (cache_path) append_to_cache(cache_path, e);
+        }
+        pthread_mutex_unlock(&registry.lock);
+    }
+
+unref_ref:
+    vmaf_picture_unref(&ref);
+unlock:
+    pthread_mutex_unlock(&registry.tune_lock);
+    return best;
+}
+
+const VmafKernelVariant *vmaf_kernel_select(const VmafKernel *kernel,
+                                            const VmafKernelTuning *tuning,
+                                            enum VmafPixelFormat pix_fmt,
+                                            unsigned bpc, unsigned w,
+                                            unsigned h)
+{
+    const unsigned flags = vmaf_get_cpu_flags();
+    const VmafKernelVariant *v = default_variant(kernel, flags, w);
+
+    pthread_mutex_lock(&registry.lock);
+    if (registry.tuning.active &&
+        pthread_equal(registry.tuning.thread, pthread_self()))
+    {
+        // called from time_variant(), other kernels keep their default
+        if (registry.tuning.kernel == kernel)
+            v = registry.tuning.variant;
+        pthread_mutex_unlock(&registry.lock);
+        return v;
+    }
+
+    // a default pick is only kept until a context autotunes
+    const unsigned tune = tuning && tuning->autotune;
+    KernelEntry *e = find(kernel->name, flags, bpc, w, h);
+    if (e && (e->autotuned || !tune)) {
+        const VmafKernelVariant *cached =
+            variant_by_name(kernel, e->variant, flags, w);
+        if (cached) {
+            mark_selected(e, kernel, cached);
+            pthread_mutex_unlock(&registry.lock);
+            return cached;
+        }
+    }
+    pthread_mutex_unlock(&registry.lock);
+
+    if (tune) {
+        const VmafKernelVariant *best =
+            autotune(kernel, pix_fmt, bpc, w, h, flags, tuning->cache_path);
+        if (best) return best;
+    }
+
+    pthread_mutex_lock(&registry.lock);
+    e = find(kernel->name, flags, bpc, w, h);
+    if (!e) e = add(kernel->name, v->name, flags, bpc, w, h);
+    if (e) mark_selected(e, kernel, v);
+    pthread_mutex_unlock(&registry.lock);
+    return v;
+}
+
+static int load_cache(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return 0; // written on first use
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        char kernel[32], variant[16];
+        unsigned w, h, bpc, flags;
+        if (sscanf(line, "%31s %ux%u %u %x %15s", kernel, &w, &h, &bpc,
+                   &flags, variant) != 6)
+        {
+            continue;
+        }
+        if (find(kernel, flags, bpc, w, h)) continue;
+        KernelEntry *e = add(kernel, variant, flags, bpc, w, h);
+        if (!e) {
+            fclose(f);
+            return -ENOMEM;
+        }
+        e->autotuned = true;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+int vmaf_kernel_load_cache(const char *cache_path)
+{
+    if (!cache_path) return -EINVAL;
+
+    pthread_mutex_lock(&registry.lock);
+    const int err = load_cache(cache_path);
+    pthread_mutex_unlock(&registry.lock);
+    return err;
+}
+
+int vmaf_kernel_selection(unsigned index, VmafKernelSelection *sel)
+{
+    if (!sel) return -EINVAL;
+
+    int err = -EINVAL;
+    pthread_mutex_lock(&registry.lock);
+    for (unsigned i = 0; i < registry.cnt; i++) {
+        const KernelEntry *e = &registry.entry[i];
+        if (!e->selected_kernel) continue;
+        if (index--) continue;
+        sel->kernel = e->selected_kernel->name;
+        sel->variant = e->selected_variant->name;
+        sel->bpc = e->bpc;
+        sel->w = e->w;
+        sel->h = e->h;
+        sel->autotuned = e->autotuned;
+        err = 0;
+        break;
+    }
+    pthread_mutex_unlock(&registry.lock);
+    return err;
+}
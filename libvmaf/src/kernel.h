@@ -0,0 +1,84 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_SRC_KERNEL_H__
+#define __VMAF_SRC_KERNEL_H__
+
+#include "libvmaf/libvmaf.h"
+#include "libvmaf/picture.h"
+
+/*
+ * Kernel registry. A kernel is the set of vectorized routines a feature
+ * extractor dispatches on in its init callback, and each variant names the
+ * cpu flags it needs. Instead of testing vmaf_get_cpu_flags() directly, init
+ * asks vmaf_kernel_select() for a variant and dispatches on its cpu_flags.
+ *
+ * By default the last variant the cpu supports is selected, i.e. the widest.
+ * With autotuning enabled every supported variant is timed on synthetic
+ * frames of the actual size the first time a kernel is selected for it, and
+ * the fastest one is kept for the rest of the process and, optionally,
+ * written to a cache file for later runs. Whether to autotune is up to each
+ * context, the selections themselves are shared by all of them.
+ */
+
+typedef struct VmafKernelVariant {
+    const char *name;
+    unsigned cpu_flags; ///< Required cpu flags, cumulative over narrower variants.
+    unsigned w_align; ///< Width must be a multiple of this, 0 if unconstrained.
+} VmafKernelVariant;
+
+typedef struct VmafKernel {
+    const char *name;
+    const char *feature_extractor; ///< Extractor used to time the variants.
+    const VmafKernelVariant *variant; ///< Narrowest first, zero terminated.
+} VmafKernel;
+
+/**
+ * Autotuning settings of a context, see `VmafConfiguration.autotune`.
+ */
+typedef struct VmafKernelTuning {
+    unsigned autotune;
+    char *cache_path; ///< Optional, new results are appended to it.
+} VmafKernelTuning;
+
+/**
+ * c, avx2 and avx512 or c and neon, for extractors whose wider variants
+ * build on the narrower ones.
+ */
+extern const VmafKernelVariant vmaf_kernel_variants_simd[];
+
+/**
+ * Pick the variant of `kernel` to use for pictures of the given format,
+ * autotuning it if `tuning` asks for it. `tuning` may be NULL.
+ * Never fails, falls back to the default choice if autotuning does.
+ */
+const VmafKernelVariant *vmaf_kernel_select(const VmafKernel *kernel,
+                                            const VmafKernelTuning *tuning,
+                                            enum VmafPixelFormat pix_fmt,
+                                            unsigned bpc, unsigned w,
+                                            unsigned h);
+
+/**
+ * Read previous autotune results from `cache_path`. Kernels and sizes
+ * already selected keep their selection.
+ */
+int vmaf_kernel_load_cache(const char *cache_path);
+
+int vmaf_kernel_selection(unsigned index, VmafKernelSelection *sel);
+
+#endif /* __VMAF_SRC_KERNEL_H__ */
@@ -17,7 +17,11 @@
  */
 
 #include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -29,16 +33,24 @@
 #include "libvmaf/feature.h"
 #include "libvmaf/picture.h"
 
+#include "affinity.h"
 #include "cpu.h"
+#include "feature_cache.h"
 #include "feature/feature_extractor.h"
 #include "feature/feature_collector.h"
 #include "metadata_handler.h"
 #include "fex_ctx_vector.h"
+#include "frame_queue.h"
+#include "import.h"
+#include "kernel.h"
 #include "log.h"
 #include "model.h"
 #include "output.h"
+#include "perf.h"
 #include "picture.h"
 #include "predict.h"
+#include "scale.h"
+#include "subsample.h"
 #include "thread_pool.h"
 #include "vcs_version.h"
 
@@ -58,6 +70,10 @@ typedef struct VmafContext {
     VmafFeatureExtractorContextPool *fex_ctx_pool;
     VmafThreadPool *thread_pool;
     VmafFrameSyncContext *framesync;
+    VmafArena *arena;
+    VmafKernelTuning kernel_tuning;
+    VmafSubsampler *subsampler;
+    VmafScaler *scaler; ///< created for the first distorted picture to scale
 #ifdef HAVE_CUDA
     struct {
         struct {
@@ -82,7 +98,48 @@ typedef struct VmafContext {
         enum VmafPictureBufferType buf_type;
     } pic_params;
     unsigned pic_cnt;
+    struct {
+        unsigned low, end; ///< empty while equal
+    } covered; ///< pictures read in range, imported or output
     bool flushed;
+    VmafPerf *perf;
+    struct {
+        unsigned *index; ///< extractors with no idle context, per frame
+        unsigned capacity;
+    } deferred;
+    VmafFeatureCache *feature_cache;
+    struct {
+        VmafPicture ref, dist;
+        unsigned index;
+        struct {
+            FeatureRecord record;
+            unsigned index;
+            bool valid;
+        } *spatial; ///< last scores of each registered spatial extractor
+        unsigned cnt;
+        unsigned record; ///< frames left to record spatial scores for
+    } prev;
+    struct {
+        VmafFrameCallbackConfiguration cfg;
+        VmafFrameQueue *queue;
+        pthread_mutex_t lock; ///< guards `waiting` and `blocked`
+        struct WaitingExtraction {
+            unsigned rfe;
+            VmafPicture ref, dist;
+            unsigned index;
+            uint64_t frame;
+        } *waiting; ///< extractions queued behind a busy extractor
+        unsigned cnt, capacity;
+        bool *blocked; ///< per registered extractor, has waiting extractions
+        unsigned blocked_cnt;
+        int err; ///< first error of a waiting extraction
+        atomic_int deliver_err; ///< first error of deliver_frame()
+        struct {
+            const char **name;
+            double *score;
+            unsigned capacity;
+        } scores;
+    } frames;
 } VmafContext;
 
 
@@ -92,7 +149,7 @@ int vmaf_init(VmafContext **vmaf, VmafConfiguration cfg)
     int err = 0;
 
     VmafContext *const v = *vmaf = malloc(sizeof(*v));
-    if (!v) goto fail;
+    if (!v) return -ENOMEM;
     memset(v, 0, sizeof(*v));
     v->cfg = cfg;
 
@@ -101,22 +158,95 @@ int vmaf_init(VmafContext **vmaf, VmafConfiguration cfg)
 
     vmaf_set_log_level(cfg.log_level);
 
+    if (cfg.cpu_affinity && (cfg.executor || !cfg.n_threads)) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "cpu affinity requires n_threads > 0 and no executor\n");
+        err = -EINVAL;
+        goto free_v;
+    }
+
+    v->kernel_tuning.autotune = cfg.autotune;
+    if (cfg.autotune && cfg.autotune_cache) {
+        v->kernel_tuning.cache_path = strdup(cfg.autotune_cache);
+        if (!v->kernel_tuning.cache_path) {
+            err = -ENOMEM;
+            goto free_v;
+        }
+        err = vmaf_kernel_load_cache(cfg.autotune_cache);
+        if (err) goto free_kernel_tuning;
+    }
+
+    if (cfg.scratch_arena) {
+        unsigned flags = 0;
+        if (cfg.scratch_arena & VMAF_SCRATCH_ARENA_HUGE_PAGES)
+            flags |= VMAF_ARENA_HUGE_PAGES;
+        if (cfg.scratch_arena & VMAF_SCRATCH_ARENA_PREFAULT)
+            flags |= VMAF_ARENA_PREFAULT;
+        err = vmaf_arena_create(&v->arena, flags);
+        if (err) goto free_kernel_tuning;
+    }
+
+    if (cfg.n_subsample > 1 || cfg.subsample_adaptive) {
+        const unsigned n_subsample =
+            cfg.subsample_adaptive && cfg.n_subsample <= 1 ? 8 : cfg.n_subsample;
+        err = vmaf_subsampler_init(&v->subsampler, n_subsample,
+                                   cfg.subsample_adaptive);
+        if (err) goto free_arena;
+    }
+
     err = vmaf_framesync_init(&(v->framesync));
-    if (err) goto free_v;
+    if (err) goto free_subsampler;
     err = vmaf_feature_collector_init(&(v->feature_collector));
     if (err) goto free_framesync;
     err = feature_extractor_vector_init(&(v->registered_feature_extractors));
     if (err) goto free_feature_collector;
 
-    if (v->cfg.n_threads > 0) {
-        err = vmaf_thread_pool_create(&v->thread_pool, v->cfg.n_threads);
+    if (v->cfg.executor) {
+        v->cfg.n_threads = vmaf_executor_n_threads(v->cfg.executor);
+        err = vmaf_thread_pool_create_shared(&v->thread_pool, v->cfg.executor);
+        if (err) goto free_feature_extractor_vector;
+        err = vmaf_fex_ctx_pool_create(&v->fex_ctx_pool, v->cfg.n_threads);
+        if (err) goto free_thread_pool;
+    } else if (v->cfg.n_threads > 0) {
+        VmafAffinity affinity;
+        if (v->cfg.cpu_affinity) {
+            err = vmaf_affinity_parse(&affinity, v->cfg.cpu_affinity);
+            if (err) {
+                vmaf_log(VMAF_LOG_LEVEL_ERROR, "invalid cpu affinity: %s\n",
+                         v->cfg.cpu_affinity);
+                goto free_feature_extractor_vector;
+            }
+        }
+        err = vmaf_thread_pool_create_pinned(&v->thread_pool, v->cfg.n_threads,
+                                             v->cfg.cpu_affinity ? &affinity : NULL);
         if (err) goto free_feature_extractor_vector;
         err = vmaf_fex_ctx_pool_create(&v->fex_ctx_pool, v->cfg.n_threads);
         if (err) goto free_thread_pool;
     }
 
+#if VMAF_PERF_STATS
+    if (v->cfg.perf_stats) {
+        err = vmaf_perf_init(&v->perf);
+        if (err) goto free_fex_ctx_pool;
+        v->feature_collector->perf = v->perf;
+        vmaf_thread_pool_time_queue(v->thread_pool);
+    }
+#endif
+
+    if (v->cfg.feature_cache) {
+        err = vmaf_feature_cache_open(&v->feature_cache, v->cfg.feature_cache);
+        if (err) goto free_perf;
+        v->feature_collector->cache = v->feature_cache;
+    }
+
     return 0;
 
+free_perf:
+#if VMAF_PERF_STATS
+    vmaf_perf_destroy(v->perf);
+free_fex_ctx_pool:
+#endif
+    vmaf_fex_ctx_pool_destroy(v->fex_ctx_pool);
 free_thread_pool:
     vmaf_thread_pool_destroy(v->thread_pool);
 free_feature_extractor_vector:
@@ -125,10 +255,15 @@ free_feature_collector:
     vmaf_feature_collector_destroy(v->feature_collector);
 free_framesync:
     vmaf_framesync_destroy(v->framesync);
+free_subsampler:
+    vmaf_subsampler_destroy(v->subsampler);
+free_arena:
+    vmaf_arena_destroy(v->arena);
+free_kernel_tuning:
+    free(v->kernel_tuning.cache_path);
 free_v:
     free(v);
-fail:
-    return -ENOMEM;
+    return err;
 }
 
 #ifdef HAVE_CUDA
@@ -249,16 +384,80 @@ static int set_fex_framesync(VmafFeatureExtractorContext *fex_ctx,
     return 0;
 }
 
+static int set_fex_thread_pool(VmafFeatureExtractorContext *fex_ctx,
+                               VmafContext *vmaf)
+{
+    fex_ctx->fex->thread_pool = vmaf->thread_pool;
+    fex_ctx->fex->arena = vmaf->arena;
+    fex_ctx->fex->kernel_tuning = &vmaf->kernel_tuning;
+    return 0;
+}
+
+static void release_prev(VmafContext *vmaf)
+{
+    if (vmaf->prev.ref.priv)
+        vmaf_picture_unref(&vmaf->prev.ref);
+    if (vmaf->prev.dist.priv)
+        vmaf_picture_unref(&vmaf->prev.dist);
+}
+
 int vmaf_close(VmafContext *vmaf)
 {
     if (!vmaf) return -EINVAL;
 
     vmaf_thread_pool_wait(vmaf->thread_pool);
+    release_prev(vmaf);
+    for (unsigned i = 0; i < vmaf->prev.cnt; i++)
+        vmaf_feature_record_free(&vmaf->prev.spatial[i].record);
+    free(vmaf->prev.spatial);
     vmaf_framesync_destroy(vmaf->framesync);
     feature_extractor_vector_destroy(&(vmaf->registered_feature_extractors));
     vmaf_feature_collector_destroy(vmaf->feature_collector);
     vmaf_thread_pool_destroy(vmaf->thread_pool);
+    if (vmaf->fex_ctx_pool && vmaf->cfg.scratch_budget) {
+        vmaf_log(VMAF_LOG_LEVEL_INFO,
+                 "feature extractor scratch: %.1f MiB peak, %.1f MiB budget\n",
+                 vmaf->fex_ctx_pool->scratch.peak / (1024. * 1024.),
+                 vmaf->cfg.scratch_budget / (1024. * 1024.));
+    }
     vmaf_fex_ctx_pool_destroy(vmaf->fex_ctx_pool);
+    vmaf_subsampler_destroy(vmaf->subsampler);
+    vmaf_scaler_destroy(vmaf->scaler);
+    if (vmaf->arena) {
+        VmafArenaStats stats;
+        vmaf_get_arena_stats(vmaf, &stats);
+        vmaf_log(VMAF_LOG_LEVEL_INFO,
+                 "scratch arena: %.1f MiB peak, %.1f MiB reserved, "
+                 "%.1f MiB huge pages\n", stats.peak / (1024. * 1024.),
+                 stats.reserved / (1024. * 1024.),
+                 stats.huge_pages / (1024. * 1024.));
+        vmaf_arena_destroy(vmaf->arena);
+    }
+    free(vmaf->kernel_tuning.cache_path);
+    free(vmaf->deferred.index);
+    if (vmaf->frames.queue) {
+        for (unsigned i = 0; i < vmaf->frames.cnt; i++) {
+            vmaf_picture_unref(&vmaf->frames.waiting[i].ref);
+            vmaf_picture_unref(&vmaf->frames.waiting[i].dist);
+        }
+        free(vmaf->frames.waiting);
+        free(vmaf->frames.blocked);
+        free(vmaf->frames.scores.name);
+        free(vmaf->frames.scores.score);
+        pthread_mutex_destroy(&vmaf->frames.lock);
+        vmaf_frame_queue_destroy(vmaf->frames.queue);
+    }
+#if VMAF_PERF_STATS
+    vmaf_perf_destroy(vmaf->perf);
+#endif
+    if (vmaf->feature_cache) {
+        uint64_t hits, misses;
+        vmaf_feature_cache_stats(vmaf->feature_cache, &hits, &misses);
+        vmaf_log(VMAF_LOG_LEVEL_INFO,
+                 "feature cache: %"PRIu64" hits, %"PRIu64" misses\n",
+                 hits, misses);
+        vmaf_feature_cache_close(vmaf->feature_cache);
+    }
 #ifdef HAVE_CUDA
     if (vmaf->cuda.ring_buffer)
         vmaf_ring_buffer_close(vmaf->cuda.ring_buffer);
@@ -270,14 +469,106 @@ int vmaf_close(VmafContext *vmaf)
     return 0;
 }
 
+static void cover(VmafContext *vmaf, unsigned low, unsigned end)
+{
+    if (low >= end) return;
+    if (vmaf->covered.low == vmaf->covered.end) {
+        vmaf->covered.low = low;
+        vmaf->covered.end = end;
+        return;
+    }
+    if (low < vmaf->covered.low) vmaf->covered.low = low;
+    if (end > vmaf->covered.end) vmaf->covered.end = end;
+}
+
 int vmaf_import_feature_score(VmafContext *vmaf, const char *feature_name,
                               double value, unsigned index)
 {
     if (!vmaf) return -EINVAL;
     if (!feature_name) return -EINVAL;
 
-    return vmaf_feature_collector_append(vmaf->feature_collector, feature_name,
-                                         value, index);
+    int err = vmaf_feature_collector_append(vmaf->feature_collector,
+                                            feature_name, value, index);
+    if (!err) cover(vmaf, index, index + 1);
+    return err;
+}
+
+int vmaf_import_feature_scores(VmafContext *vmaf, const char *feature_name,
+                               const double *score, unsigned index,
+                               unsigned cnt)
+{
+    if (!vmaf) return -EINVAL;
+    if (!feature_name) return -EINVAL;
+    if (!score && cnt) return -EINVAL;
+
+    int err = vmaf_feature_collector_append_scores(vmaf->feature_collector,
+                                                   feature_name, score, index,
+                                                   cnt);
+    if (!err) cover(vmaf, index, index + cnt);
+    return err;
+}
+
+static int import_from_path(VmafContext *vmaf, const char *path,
+                            const char *const *exclude, unsigned *index_low,
+                            unsigned *frame_cnt)
+{
+    if (!vmaf) return -EINVAL;
+    if (!path) return -EINVAL;
+
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "could not open file: %s\n", path);
+        return -EINVAL;
+    }
+
+    char magic[8];
+    const bool binary = fread(magic, sizeof(magic), 1, in) == 1 &&
+                        !memcmp(magic, VMAF_OUTPUT_BINARY_MAGIC, sizeof(magic));
+    rewind(in);
+
+    unsigned low = UINT_MAX, cnt = 0;
+    int err = binary ? vmaf_import_binary(vmaf->feature_collector, in,
+                                          exclude, &low, &cnt)
+                     : vmaf_import_json(vmaf->feature_collector, in,
+                                        exclude, &low, &cnt);
+    fclose(in);
+    if (err) return err;
+
+    cover(vmaf, low, cnt);
+    if (cnt > vmaf->pic_cnt)
+        vmaf->pic_cnt = cnt;
+    *index_low = low < cnt ? low : cnt;
+    *frame_cnt = cnt;
+    return 0;
+}
+
+int vmaf_import_feature_scores_from_path(VmafContext *vmaf, const char *path,
+                                         const char *const *exclude,
+                                         unsigned *frame_cnt)
+{
+    unsigned low, cnt;
+    int err = import_from_path(vmaf, path, exclude, &low, &cnt);
+    if (err) return err;
+    if (frame_cnt) *frame_cnt = cnt;
+    return 0;
+}
+
+int vmaf_import_segment_from_path(VmafContext *vmaf, const char *path,
+                                  const char *const *exclude,
+                                  unsigned *index_low, unsigned *index_high)
+{
+    if (!index_low || !index_high) return -EINVAL;
+
+    unsigned low, cnt;
+    int err = import_from_path(vmaf, path, exclude, &low, &cnt);
+    if (err) return err;
+    if (low >= cnt) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "no feature scores in: %s\n", path);
+        return -EINVAL;
+    }
+    *index_low = low;
+    *index_high = cnt - 1;
+    return 0;
 }
 
 int vmaf_use_feature(VmafContext *vmaf, const char *feature_name,
@@ -308,6 +599,7 @@ int vmaf_use_feature(VmafContext *vmaf, const char *feature_name,
     err |= set_fex_cuda_state(fex_ctx, vmaf);
 #endif
     err |= set_fex_framesync(fex_ctx, vmaf);
+    err |= set_fex_thread_pool(fex_ctx, vmaf);
     if (err) return err;
 
     RegisteredFeatureExtractors *rfe = &(vmaf->registered_feature_extractors);
@@ -318,6 +610,112 @@ int vmaf_use_feature(VmafContext *vmaf, const char *feature_name,
     return err;
 }
 
+static bool is_vmaf_core_part(const VmafFeatureExtractor *fex)
+{
+    return !strcmp(fex->name, "vif") || !strcmp(fex->name, "adm") ||
+           !strcmp(fex->name, "motion");
+}
+
+/*
+ * Registers the fused "vmaf_core" extractor in place of the separate integer
+ * vif, adm and motion extractors when a model needs all three. It only runs
+ * single threaded without subsampling: as a temporal extractor it would
+ * otherwise serialize vif and adm and score every frame. Any option that
+ * vmaf_core does not mirror, or parts that are already registered, keep the
+ * separate extractors. With a feature cache the separate extractors are kept
+ * too, so that vif and adm scores can be cached.
+ */
+static int use_vmaf_core_from_model(VmafContext *vmaf, VmafModel *model,
+                                    unsigned fex_flags, bool *fused)
+{
+    *fused = false;
+    if (fex_flags || vmaf->thread_pool || vmaf->subsampler ||
+        vmaf->feature_cache)
+        return 0;
+
+    RegisteredFeatureExtractors *rfe = &(vmaf->registered_feature_extractors);
+    for (unsigned i = 0; i < rfe->cnt; i++) {
+        VmafFeatureExtractor *fex = rfe->fex_ctx[i]->fex;
+        if (is_vmaf_core_part(fex) || !strcmp(fex->name, "vmaf_core"))
+            return 0;
+    }
+
+    VmafFeatureExtractor *core = vmaf_get_feature_extractor_by_name("vmaf_core");
+    if (!core) return 0;
+
+    struct {
+        const char *name;
+        bool used;
+        VmafDictionary *opts_dict;
+    } part[] = {
+        { "vif", false, NULL }, { "adm", false, NULL }, { "motion", false, NULL },
+    };
+
+    for (unsigned i = 0; i < model->n_features; i++) {
+        VmafFeatureExtractor *fex =
+            vmaf_get_feature_extractor_by_feature_name(model->feature[i].name,
+                                                       fex_flags);
+        if (!fex || !is_vmaf_core_part(fex)) continue;
+
+        for (unsigned j = 0; j < 3; j++) {
+            if (strcmp(fex->name, part[j].name)) continue;
+            VmafDictionary *d = model->feature[i].opts_dict;
+            if (part[j].used && vmaf_dictionary_compare(d, part[j].opts_dict))
+                return 0;
+            part[j].used = true;
+            part[j].opts_dict = d;
+
+            const unsigned cnt = d ? d->cnt : 0;
+            for (unsigned k = 0; k < cnt; k++) {
+                bool mirrored = false;
+                for (const VmafOption *opt = core->options; opt->name; opt++) {
+                    if ((opt->flags & VMAF_OPT_FLAG_FEATURE_PARAM) &&
+                        !strcmp(opt->name, d->entry[k].key))
+                    {
+                        mirrored = true;
+                    }
+                }
+                if (!mirrored) return 0;
+            }
+        }
+    }
+
+    VmafDictionary *d = NULL;
+    int err = 0;
+    for (unsigned j = 0; j < 3; j++) {
+        if (!part[j].used) {
+            vmaf_dictionary_free(&d);
+            return 0;
+        }
+        const unsigned cnt = part[j].opts_dict ? part[j].opts_dict->cnt : 0;
+        for (unsigned k = 0; k < cnt; k++) {
+            err = vmaf_dictionary_set(&d, part[j].opts_dict->entry[k].key,
+                                      part[j].opts_dict->entry[k].val, 0);
+            if (err) goto fail;
+        }
+    }
+
+    VmafFeatureExtractorContext *fex_ctx;
+    err = vmaf_feature_extractor_context_create(&fex_ctx, core, d);
+    if (err) goto fail;
+    err |= set_fex_framesync(fex_ctx, vmaf);
+    err |= set_fex_thread_pool(fex_ctx, vmaf);
+    if (err) goto destroy_fex_ctx;
+    err = feature_extractor_vector_append(rfe, fex_ctx, 0);
+    if (err) goto destroy_fex_ctx;
+
+    *fused = true;
+    return 0;
+
+destroy_fex_ctx:
+    // frees d as well
+    vmaf_feature_extractor_context_destroy(fex_ctx);
+    return err;
+fail:
+    vmaf_dictionary_free(&d);
+    return err;
+}
+
 int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model)
 {
     if (!vmaf) return -EINVAL;
@@ -334,6 +732,10 @@ int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model)
 
     RegisteredFeatureExtractors *rfe = &(vmaf->registered_feature_extractors);
 
+    bool fused;
+    err = use_vmaf_core_from_model(vmaf, model, fex_flags, &fused);
+    if (err) return err;
+
     for (unsigned i = 0; i < model->n_features; i++) {
         VmafFeatureExtractor *fex =
             vmaf_get_feature_extractor_by_feature_name(model->feature[i].name,
@@ -344,6 +746,7 @@ int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model)
                      model->feature[i].name);
             return -EINVAL;
         }
+        if (fused && is_vmaf_core_part(fex)) continue;
 
         VmafFeatureExtractorContext *fex_ctx;
         VmafDictionary *d = NULL;
@@ -356,6 +759,7 @@ int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model)
         err |= set_fex_cuda_state(fex_ctx, vmaf);
 #endif
         err |= set_fex_framesync(fex_ctx, vmaf);
+        err |= set_fex_thread_pool(fex_ctx, vmaf);
         if (err) return err;
         err = feature_extractor_vector_append(rfe, fex_ctx, 0);
         if (err) {
@@ -389,9 +793,13 @@ struct ThreadData {
     unsigned index;
     VmafFeatureCollector *feature_collector;
     VmafFeatureExtractorContextPool *fex_ctx_pool;
+    VmafContext *vmaf; ///< set for frames tracked by `frames.queue`
+    uint64_t frame;
     int err;
 };
 
+static void dispatch_waiting(VmafContext *vmaf);
+
 static void threaded_extract_func(void *e)
 {
     struct ThreadData *f = e;
@@ -401,6 +809,186 @@ static void threaded_extract_func(void *e)
     f->err = vmaf_fex_ctx_pool_release(f->fex_ctx_pool, f->fex_ctx);
     vmaf_picture_unref(&f->ref);
     vmaf_picture_unref(&f->dist);
+
+    if (f->vmaf) {
+        dispatch_waiting(f->vmaf);
+        vmaf_frame_queue_unref(f->vmaf->frames.queue, f->frame);
+    }
+}
+
+static int threaded_extract(VmafContext *vmaf,
+                            VmafFeatureExtractorContext *fex_ctx,
+                            VmafPicture *ref, VmafPicture *dist,
+                            unsigned index, const uint64_t *frame)
+{
+    VmafPicture pic_a, pic_b;
+    vmaf_picture_ref(&pic_a, ref);
+    vmaf_picture_ref(&pic_b, dist);
+
+    struct ThreadData data = {
+        .fex_ctx = fex_ctx,
+        .ref = pic_a,
+        .dist = pic_b,
+        .index = index,
+        .feature_collector = vmaf->feature_collector,
+        .fex_ctx_pool = vmaf->fex_ctx_pool,
+        .vmaf = frame ? vmaf : NULL,
+        .frame = frame ? *frame : 0,
+        .err = 0,
+    };
+
+    int err = vmaf_thread_pool_enqueue(vmaf->thread_pool, threaded_extract_func,
+                                       &data, sizeof(data));
+    if (err) {
+        vmaf_fex_ctx_pool_release(vmaf->fex_ctx_pool, fex_ctx);
+        vmaf_picture_unref(&pic_a);
+        vmaf_picture_unref(&pic_b);
+    }
+    return err;
+}
+
+static void dispatch_waiting(VmafContext *vmaf)
+{
+    pthread_mutex_lock(&vmaf->frames.lock);
+    if (!vmaf->frames.cnt) goto unlock;
+
+    // an extractor's waiting extractions keep their order, a temporal one
+    // has a single context and depends on it
+    memset(vmaf->frames.blocked, 0,
+           sizeof(*vmaf->frames.blocked) * vmaf->frames.blocked_cnt);
+    unsigned n = 0;
+    for (unsigned i = 0; i < vmaf->frames.cnt; i++) {
+        struct WaitingExtraction w = vmaf->frames.waiting[i];
+        VmafFeatureExtractorContext *rfe =
+            vmaf->registered_feature_extractors.fex_ctx[w.rfe];
+        VmafFeatureExtractorContext *fex_ctx;
+        int err = -EAGAIN;
+        if (!vmaf->frames.blocked[w.rfe]) {
+            err = vmaf_fex_ctx_pool_aquire_nowait(vmaf->fex_ctx_pool, rfe->fex,
+                                                  rfe->opts_dict, &fex_ctx);
+        }
+        if (err == -EAGAIN) {
+            vmaf->frames.blocked[w.rfe] = true;
+            vmaf->frames.waiting[n++] = w;
+            continue;
+        }
+        if (!err)
+            err = threaded_extract(vmaf, fex_ctx, &w.ref, &w.dist, w.index,
+                                   &w.frame);
+        vmaf_picture_unref(&w.ref);
+        vmaf_picture_unref(&w.dist);
+        if (err) {
+            if (!vmaf->frames.err) vmaf->frames.err = err;
+            vmaf_frame_queue_unref(vmaf->frames.queue, w.frame);
+        }
+    }
+    vmaf->frames.cnt = n;
+
+unlock:
+    pthread_mutex_unlock(&vmaf->frames.lock);
+}
+
+/*
+ * Whether non-temporal extractors see frame `index`: it is in the read
+ * range, if any, and selected by the subsampler.
+ */
+static bool frame_scored(VmafContext *vmaf, unsigned index)
+{
+    const VmafFeatureCollector *fc = vmaf->feature_collector;
+    if (fc->range.set && (index < fc->range.low || index > fc->range.high))
+        return false;
+    return vmaf_subsampler_selected(vmaf->subsampler, index);
+}
+
+static int queue_extract(VmafContext *vmaf, unsigned i, VmafPicture *ref,
+                         VmafPicture *dist, unsigned index, uint64_t frame)
+{
+    VmafFeatureExtractorContext *rfe =
+        vmaf->registered_feature_extractors.fex_ctx[i];
+    VmafFeatureExtractorContext *fex_ctx;
+    int err = -EAGAIN;
+    if (!vmaf->frames.blocked[i]) {
+        err = vmaf_fex_ctx_pool_aquire_nowait(vmaf->fex_ctx_pool, rfe->fex,
+                                              rfe->opts_dict, &fex_ctx);
+    }
+    if (err && err != -EAGAIN) return err;
+
+    if (!err) {
+        err = vmaf_frame_queue_ref(vmaf->frames.queue, frame);
+        if (err) {
+            vmaf_fex_ctx_pool_release(vmaf->fex_ctx_pool, fex_ctx);
+            return err;
+        }
+        err = threaded_extract(vmaf, fex_ctx, ref, dist, index, &frame);
+        if (err) vmaf_frame_queue_unref(vmaf->frames.queue, frame);
+        return err;
+    }
+
+    if (vmaf->frames.cnt == vmaf->frames.capacity) {
+        const unsigned capacity =
+            vmaf->frames.capacity ? vmaf->frames.capacity * 2 : 16;
+        void *waiting = realloc(vmaf->frames.waiting,
+                                sizeof(*vmaf->frames.waiting) * capacity);
+        if (!waiting) return -ENOMEM;
+        vmaf->frames.waiting = waiting;
+        vmaf->frames.capacity = capacity;
+    }
+    err = vmaf_frame_queue_ref(vmaf->frames.queue, frame);
+    if (err) return err;
+
+    struct WaitingExtraction *w = &vmaf->frames.waiting[vmaf->frames.cnt++];
+    w->rfe = i;
+    vmaf_picture_ref(&w->ref, ref);
+    vmaf_picture_ref(&w->dist, dist);
+    w->index = index;
+    w->frame = frame;
+    vmaf->frames.blocked[i] = true;
+    return 0;
+}
+
+static int queued_read_pictures(VmafContext *vmaf, VmafPicture *ref,
+                                VmafPicture *dist, unsigned index,
+                                uint64_t frame)
+{
+    int err = 0;
+
+    const unsigned cnt = vmaf->registered_feature_extractors.cnt;
+    pthread_mutex_lock(&vmaf->frames.lock);
+    if (cnt > vmaf->frames.blocked_cnt) {
+        bool *blocked = realloc(vmaf->frames.blocked, sizeof(*blocked) * cnt);
+        if (!blocked) {
+            err = -ENOMEM;
+            goto unlock;
+        }
+        memset(blocked + vmaf->frames.blocked_cnt, 0,
+               sizeof(*blocked) * (cnt - vmaf->frames.blocked_cnt));
+        vmaf->frames.blocked = blocked;
+        vmaf->frames.blocked_cnt = cnt;
+    }
+
+    for (unsigned i = 0; i < cnt; i++) {
+        VmafFeatureExtractor *fex =
+            vmaf->registered_feature_extractors.fex_ctx[i]->fex;
+        if (fex->flags & VMAF_FEATURE_EXTRACTOR_CUDA)
+            continue;
+        if (!frame_scored(vmaf, index) &&
+            !(fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL))
+        {
+            continue;
+        }
+
+        fex->framesync = vmaf->framesync;
+        fex->thread_pool = vmaf->thread_pool;
+        fex->arena = vmaf->arena;
+        fex->kernel_tuning = &vmaf->kernel_tuning;
+        err = queue_extract(vmaf, i, ref, dist, index, frame);
+        if (err) goto unlock;
+    }
+    err = vmaf->frames.err;
+
+unlock:
+    pthread_mutex_unlock(&vmaf->frames.lock);
+    return err | vmaf_picture_unref(ref) | vmaf_picture_unref(dist);
 }
 
 static int threaded_read_pictures(VmafContext *vmaf, VmafPicture *ref,
@@ -412,7 +1000,20 @@ static int threaded_read_pictures(VmafContext *vmaf, VmafPicture *ref,
 
     int err = 0;
 
-    for (unsigned i = 0; i < vmaf->registered_feature_extractors.cnt; i++) {
+    const unsigned cnt = vmaf->registered_feature_extractors.cnt;
+    if (cnt > vmaf->deferred.capacity) {
+        unsigned *deferred =
+            realloc(vmaf->deferred.index, sizeof(*deferred) * cnt);
+        if (!deferred) return -ENOMEM;
+        vmaf->deferred.index = deferred;
+        vmaf->deferred.capacity = cnt;
+    }
+    unsigned deferred_cnt = 0;
+
+    // Extractors with an idle context are dispatched first, a busy one
+    // is more likely to have finished by the time the others are queued
+    // than a new context is to be worth its scratch.
+    for (unsigned i = 0; i < cnt; i++) {
         VmafFeatureExtractor *fex =
             vmaf->registered_feature_extractors.fex_ctx[i]->fex;
         if (fex->flags & VMAF_FEATURE_EXTRACTOR_CUDA)
@@ -420,39 +1021,44 @@ static int threaded_read_pictures(VmafContext *vmaf, VmafPicture *ref,
         VmafDictionary *opts_dict =
             vmaf->registered_feature_extractors.fex_ctx[i]->opts_dict;
 
-        if ((vmaf->cfg.n_subsample > 1) && (index % vmaf->cfg.n_subsample) &&
+        if (!frame_scored(vmaf, index) &&
             !(fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL))
         {
             continue;
         }
 
         fex->framesync = vmaf->framesync;
+        fex->thread_pool = vmaf->thread_pool;
+        fex->arena = vmaf->arena;
+        fex->kernel_tuning = &vmaf->kernel_tuning;
         VmafFeatureExtractorContext *fex_ctx;
-        err = vmaf_fex_ctx_pool_aquire(vmaf->fex_ctx_pool, fex, opts_dict,
+        VMAF_PERF_BEGIN(vmaf->perf, clk, VMAF_PERF_STAGE_POOL_WAIT);
+        err = vmaf_fex_ctx_pool_try_aquire(vmaf->fex_ctx_pool, fex, opts_dict,
+                                           &fex_ctx);
+        if (err == -EAGAIN) {
+            vmaf->deferred.index[deferred_cnt++] = i;
+            continue;
+        }
+        VMAF_PERF_END(vmaf->perf, clk, fex->name, VMAF_PERF_STAGE_POOL_WAIT);
+        if (err) return err;
+
+        err = threaded_extract(vmaf, fex_ctx, ref, dist, index, NULL);
+        if (err) return err;
+    }
+
+    for (unsigned i = 0; i < deferred_cnt; i++) {
+        VmafFeatureExtractorContext *rfe =
+            vmaf->registered_feature_extractors.fex_ctx[vmaf->deferred.index[i]];
+        VmafFeatureExtractor *fex = rfe->fex;
+        VmafFeatureExtractorContext *fex_ctx;
+        VMAF_PERF_BEGIN(vmaf->perf, clk, VMAF_PERF_STAGE_POOL_WAIT);
+        err = vmaf_fex_ctx_pool_aquire(vmaf->fex_ctx_pool, fex, rfe->opts_dict,
                                        &fex_ctx);
+        VMAF_PERF_END(vmaf->perf, clk, fex->name, VMAF_PERF_STAGE_POOL_WAIT);
         if (err) return err;
 
-        VmafPicture pic_a, pic_b;
-        vmaf_picture_ref(&pic_a, ref);
-        vmaf_picture_ref(&pic_b, dist);
-
-        struct ThreadData data = {
-            .fex_ctx = fex_ctx,
-            .ref = pic_a,
-            .dist = pic_b,
-            .index = index,
-            .feature_collector = vmaf->feature_collector,
-            .fex_ctx_pool = vmaf->fex_ctx_pool,
-            .err = 0,
-        };
-
-        err = vmaf_thread_pool_enqueue(vmaf->thread_pool, threaded_extract_func,
-                                       &data, sizeof(data));
-        if (err) {
-            vmaf_picture_unref(&pic_a);
-            vmaf_picture_unref(&pic_b);
-            return err;
-        }
+        err = threaded_extract(vmaf, fex_ctx, ref, dist, index, NULL);
+        if (err) return err;
     }
 
     return vmaf_picture_unref(ref) | vmaf_picture_unref(dist);
@@ -469,13 +1075,24 @@ static int validate_pic_params(VmafContext *vmaf, VmafPicture *ref,
         vmaf->pic_params.h = ref->h[0];
         vmaf->pic_params.pix_fmt = ref->pix_fmt;
         vmaf->pic_params.bpc = ref->bpc;
+        if (vmaf->fex_ctx_pool) {
+            int err = vmaf_fex_ctx_pool_set_scratch_budget(vmaf->fex_ctx_pool,
+                                vmaf->cfg.scratch_budget, ref->pix_fmt,
+                                ref->bpc, ref->w[0], ref->h[0]);
+            if (err) return err;
+        }
     }
     vmaf->pic_params.buf_type = ref_priv->buf_type;
 
-    if ((ref->w[0] != dist->w[0]) || (ref->w[0] != vmaf->pic_params.w))
+    if ((ref->w[0] != vmaf->pic_params.w) || (ref->h[0] != vmaf->pic_params.h))
         return -EINVAL;
-    if ((ref->h[0] != dist->h[0]) || (ref->h[0] != vmaf->pic_params.h))
+    // distorted pictures of another size are scaled on the host
+    if (((ref->w[0] != dist->w[0]) || (ref->h[0] != dist->h[0])) &&
+        ((ref->bpc != dist->bpc) ||
+         (dist_priv->buf_type != VMAF_PICTURE_BUFFER_TYPE_HOST)))
+    {
         return -EINVAL;
+    }
     if ((ref->pix_fmt != dist->pix_fmt) ||
         (ref->pix_fmt != vmaf->pic_params.pix_fmt))
     {
@@ -507,6 +1124,9 @@ static int flush_context(VmafContext *vmaf)
     else {
         RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
         for (unsigned i = 0; i < rfe.cnt; i++) {
+            // an extractor whose every frame came from the feature cache
+            // never ran, so there is nothing to flush
+            if (!rfe.fex_ctx[i]->is_initialized) continue;
             if (!(rfe.fex_ctx[i]->fex->flags & VMAF_FEATURE_EXTRACTOR_CUDA))
                 err |= vmaf_feature_extractor_context_flush(rfe.fex_ctx[i],
                                                             vmaf->feature_collector);
@@ -651,19 +1271,125 @@ static unsigned rfe_hw_flags(RegisteredFeatureExtractors *rfe)
 
 #endif
 
-int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
-                       unsigned index)
+static bool picture_equal(VmafPicture *a, VmafPicture *b)
 {
-    if (!vmaf) return -EINVAL;
-    if (vmaf->flushed) return -EINVAL;
-    if (!ref != !dist) return -EINVAL;
-    if (!ref && !dist) return flush_context(vmaf);
+    const unsigned n_planes = a->pix_fmt == VMAF_PIX_FMT_YUV400P ? 1 : 3;
+    for (unsigned p = 0; p < n_planes; p++) {
+        const size_t row_size = (size_t) a->w[p] << (a->bpc > 8);
+        const uint8_t *data_a = a->data[p];
+        const uint8_t *data_b = b->data[p];
+        for (unsigned i = 0; i < a->h[p]; i++) {
+            if (memcmp(data_a + i * a->stride[p], data_b + i * b->stride[p],
+                       row_size))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Telecined content, slideshows and paused feeds repeat frames. Pictures
+ * identical to the previously read ones are marked so that temporal
+ * extractors can skip work, see integer_motion, and when both are unchanged
+ * the spatial scores of the previous frame are copied instead of extracted.
+ * The comparison bails out on the first differing row, so it is cheap for
+ * frames that do change. Spatial scores are only recorded for copying for
+ * REPEAT_WINDOW frames after a repeat, so content which does not repeat
+ * frames extracts straight into the feature collector.
+ */
+#define REPEAT_WINDOW 8 // longer than the 5 frame cadence of 3:2 pulldown
 
+static int mark_unchanged(VmafContext *vmaf, VmafPicture *ref,
+                          VmafPicture *dist, unsigned index)
+{
+    VmafPicturePrivate *ref_priv = ref->priv;
+    VmafPicturePrivate *dist_priv = dist->priv;
+    if (ref_priv->buf_type == VMAF_PICTURE_BUFFER_TYPE_CUDA_DEVICE)
+        return 0;
+
+    if (vmaf->prev.ref.priv) {
+        ref_priv->unchanged = picture_equal(&vmaf->prev.ref, ref);
+        dist_priv->unchanged = picture_equal(&vmaf->prev.dist, dist);
+    }
+    release_prev(vmaf);
+
+    int err = 0;
+    err |= vmaf_picture_ref(&vmaf->prev.ref, ref);
+    err |= vmaf_picture_ref(&vmaf->prev.dist, dist);
+    vmaf->prev.index = index;
+    return err;
+}
+
+static int extract_spatial(VmafContext *vmaf, unsigned i,
+                           VmafFeatureExtractorContext *fex_ctx,
+                           VmafPicture *ref, VmafPicture *dist,
+                           unsigned index, bool copy)
+{
+    if (vmaf->prev.cnt < vmaf->registered_feature_extractors.cnt) {
+        const unsigned cnt = vmaf->registered_feature_extractors.cnt;
+        void *spatial = realloc(vmaf->prev.spatial,
+                                sizeof(*vmaf->prev.spatial) * cnt);
+        if (!spatial) return -ENOMEM;
+        vmaf->prev.spatial = spatial;
+        memset(&vmaf->prev.spatial[vmaf->prev.cnt], 0,
+               sizeof(*vmaf->prev.spatial) * (cnt - vmaf->prev.cnt));
+        vmaf->prev.cnt = cnt;
+    }
+
+    FeatureRecord *record = &vmaf->prev.spatial[i].record;
+    if (copy && vmaf->prev.spatial[i].valid) {
+        for (unsigned j = 0; j < record->cnt; j++)
+            record->entry[j].index = index;
+        vmaf->prev.spatial[i].index = index;
+        return vmaf_feature_record_replay(record, vmaf->feature_collector);
+    }
+
+    vmaf_feature_record_free(record);
+    VmafFeatureCollector recorder = {
+        .perf = vmaf->feature_collector->perf,
+        .cache = vmaf->feature_collector->cache,
+        .record = record,
+    };
+    int err = vmaf_feature_extractor_context_extract(fex_ctx, ref, NULL, dist,
+                                                     NULL, index, &recorder);
+
+    bool valid = !err;
+    for (unsigned j = 0; j < record->cnt; j++)
+        valid &= record->entry[j].index == index;
+    vmaf->prev.spatial[i].index = index;
+    vmaf->prev.spatial[i].valid = valid;
+
+    return err | vmaf_feature_record_replay(record, vmaf->feature_collector);
+}
+
+static int read_pictures(VmafContext *vmaf, VmafPicture *ref,
+                         VmafPicture *dist, unsigned index,
+                         const uint64_t *frame)
+{
     int err = 0;
 
-    vmaf->pic_cnt++;
-    err = validate_pic_params(vmaf, ref, dist);
+    if (vmaf->subsampler) {
+        const bool host = ((VmafPicturePrivate *) ref->priv)->buf_type !=
+                          VMAF_PICTURE_BUFFER_TYPE_CUDA_DEVICE;
+        const VmafPicture *prev_ref = vmaf->prev.ref.priv ? &vmaf->prev.ref : NULL;
+        bool selected;
+        err = vmaf_subsampler_select(vmaf->subsampler, host ? prev_ref : NULL,
+                                     host ? ref : NULL, host ? dist : NULL,
+                                     index, &selected);
+        if (err) return err;
+    }
+
+    const unsigned prev_index = vmaf->prev.index;
+    err = mark_unchanged(vmaf, ref, dist, index);
     if (err) return err;
+    const bool unchanged = ((VmafPicturePrivate *) ref->priv)->unchanged &&
+                           ((VmafPicturePrivate *) dist->priv)->unchanged;
+    if (unchanged)
+        vmaf->prev.record = REPEAT_WINDOW;
+    else if (vmaf->prev.record)
+        vmaf->prev.record--;
 
 #ifdef HAVE_CUDA
     err = check_ring_buffer(vmaf);
@@ -685,13 +1411,25 @@ int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
             vmaf->registered_feature_extractors.fex_ctx[i];
 
         if (!(fex_ctx->fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL)) {
-            if ((vmaf->cfg.n_subsample > 1) && (index % vmaf->cfg.n_subsample))
+            if (!frame_scored(vmaf, index))
                 continue;
         }
 
         if (!(fex_ctx->fex->flags & VMAF_FEATURE_EXTRACTOR_CUDA) && vmaf->thread_pool) {
             continue;
         }
+
+        const unsigned uncopyable =
+            VMAF_FEATURE_EXTRACTOR_TEMPORAL | VMAF_FEATURE_EXTRACTOR_CUDA;
+        if (!(fex_ctx->fex->flags & uncopyable) && vmaf->prev.record) {
+            const bool copy = unchanged && i < vmaf->prev.cnt &&
+                              vmaf->prev.spatial[i].index == prev_index;
+            err = extract_spatial(vmaf, i, fex_ctx, ref, dist, index, copy);
+            if (err) return err;
+            continue;
+        }
+        if (i < vmaf->prev.cnt)
+            vmaf->prev.spatial[i].valid = false;
 #ifdef HAVE_CUDA
         ref = fex_ctx->fex->flags & VMAF_FEATURE_EXTRACTOR_CUDA ?
             &ref_device : &ref_host;
@@ -713,6 +1451,8 @@ int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
     //multithreading for GPU does not yield performance benefits
     //disabled for now
     if (vmaf->thread_pool){
+        if (frame)
+            return queued_read_pictures(vmaf, ref, dist, index, *frame);
         return threaded_read_pictures(vmaf, ref, dist, index);
     }
 #ifdef HAVE_CUDA
@@ -745,6 +1485,328 @@ int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
     return err;
 }
 
+static bool has_temporal_extractor(VmafContext *vmaf)
+{
+    RegisteredFeatureExtractors *rfe = &vmaf->registered_feature_extractors;
+    for (unsigned i = 0; i < rfe->cnt; i++) {
+        if (rfe->fex_ctx[i]->fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Replaces `dist` by a copy scaled to the size of `ref`.
+ */
+static int scale_dist(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist)
+{
+    int err = 0;
+    if (!vmaf->scaler) {
+        err = vmaf_scaler_init(&vmaf->scaler, vmaf->cfg.scale_filter);
+        if (err) return err;
+    }
+
+    VmafPicture scaled;
+    err = vmaf_picture_alloc(&scaled, dist->pix_fmt, dist->bpc,
+                             ref->w[0], ref->h[0]);
+    if (err) return err;
+    err = vmaf_scaler_scale(vmaf->scaler, &scaled, dist);
+    if (err) {
+        vmaf_picture_unref(&scaled);
+        return err;
+    }
+
+    err = vmaf_picture_unref(dist);
+    *dist = scaled;
+    return err;
+}
+
+static int submit_pictures(VmafContext *vmaf, VmafPicture *ref,
+                           VmafPicture *dist, unsigned index, bool async)
+{
+    int err = validate_pic_params(vmaf, ref, dist);
+    if (err) return err;
+
+    if ((dist->w[0] != ref->w[0]) || (dist->h[0] != ref->h[0])) {
+        err = scale_dist(vmaf, ref, dist);
+        if (err) return err;
+    }
+
+    // pictures outside the read range are not counted
+    const VmafFeatureCollector *fc = vmaf->feature_collector;
+    const bool counted =
+        !fc->range.set || (index >= fc->range.low && index <= fc->range.high);
+
+    if (counted) cover(vmaf, index, index + 1);
+
+    if (!vmaf->frames.queue) {
+        vmaf->pic_cnt += counted;
+        return read_pictures(vmaf, ref, dist, index, NULL);
+    }
+
+    uint64_t frame;
+    err = vmaf_frame_queue_push(vmaf->frames.queue, index,
+                                has_temporal_extractor(vmaf), !async, &frame);
+    if (err) return err;
+    vmaf->pic_cnt += counted;
+    err = read_pictures(vmaf, ref, dist, index, &frame);
+    err |= vmaf_frame_queue_unref(vmaf->frames.queue, frame);
+    return err ? err : atomic_load(&vmaf->frames.deliver_err);
+}
+
+int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
+                       unsigned index)
+{
+    if (!vmaf) return -EINVAL;
+    if (vmaf->flushed) return -EINVAL;
+    if (!ref != !dist) return -EINVAL;
+    if (!ref && !dist) {
+        release_prev(vmaf);
+        int err = flush_context(vmaf);
+        if (vmaf->frames.queue) {
+            err |= vmaf->frames.err;
+            err |= vmaf_frame_queue_release(vmaf->frames.queue);
+            if (!err) err = atomic_load(&vmaf->frames.deliver_err);
+        }
+        vmaf->feature_collector->range.set = false;
+        return err;
+    }
+
+    return submit_pictures(vmaf, ref, dist, index, false);
+}
+
+int vmaf_read_pictures_async(VmafContext *vmaf, VmafPicture *ref,
+                             VmafPicture *dist, unsigned index)
+{
+    if (!vmaf) return -EINVAL;
+    if (vmaf->flushed) return -EINVAL;
+    if (!ref || !dist) return -EINVAL;
+    if (!vmaf->frames.queue) return -EINVAL;
+
+    return submit_pictures(vmaf, ref, dist, index, true);
+}
+
+/*
+ * Name of an extractor writing aggregates at flush from every picture it
+ * read, NULL if there is none. Such aggregates can not be resumed from a
+ * checkpoint or merged from ranges scored apart.
+ */
+static const char *flush_aggregate_extractor(VmafContext *vmaf)
+{
+    RegisteredFeatureExtractors *rfe = &vmaf->registered_feature_extractors;
+    for (unsigned i = 0; i < rfe->cnt; i++) {
+        VmafFeatureExtractorContext *fex_ctx = rfe->fex_ctx[i];
+        if (vmaf_feature_extractor_context_has_flush_aggregate(fex_ctx))
+            return fex_ctx->fex->name;
+    }
+    return NULL;
+}
+
+static int check_checkpoint_aggregates(VmafContext *vmaf)
+{
+    const char *name = flush_aggregate_extractor(vmaf);
+    if (!name) return 0;
+    vmaf_log(VMAF_LOG_LEVEL_ERROR,
+             "checkpoints do not carry the aggregates of %s\n", name);
+    return -EINVAL;
+}
+
+int vmaf_set_read_range(VmafContext *vmaf, unsigned index_low,
+                        unsigned index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (vmaf->flushed) return -EINVAL;
+    if (index_low > index_high) return -EINVAL;
+    if (vmaf->frames.queue) return -EINVAL;
+#ifdef HAVE_CUDA
+    if (vmaf->cuda.state.ctx) return -EINVAL;
+#endif
+    const char *aggregating = flush_aggregate_extractor(vmaf);
+    if (aggregating) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "the aggregates of %s need every picture, not a range\n",
+                 aggregating);
+        return -EINVAL;
+    }
+
+    // the previous range's scores are dropped or kept as they are written
+    if (vmaf->thread_pool) {
+        int err = vmaf_thread_pool_wait(vmaf->thread_pool);
+        if (err) return err;
+    }
+
+    // the first frame read is not a repeat, whatever was read last
+    release_prev(vmaf);
+
+    VmafFeatureCollector *fc = vmaf->feature_collector;
+    fc->range.low = index_low;
+    fc->range.high = index_high;
+    fc->range.set = true;
+    return 0;
+}
+
+int vmaf_write_checkpoint(VmafContext *vmaf, const char *path,
+                          unsigned *index)
+{
+    if (!vmaf) return -EINVAL;
+    if (!path) return -EINVAL;
+    if (vmaf->flushed) return -EINVAL;
+    if (vmaf->frames.queue) return -EINVAL;
+    if (vmaf_subsampler_adaptive(vmaf->subsampler)) return -EINVAL;
+#ifdef HAVE_CUDA
+    if (vmaf->cuda.state.ctx) return -EINVAL;
+#endif
+
+    // only a resumed context's open ended range is read in order
+    VmafFeatureCollector *fc = vmaf->feature_collector;
+    if (fc->range.set && fc->range.high != UINT_MAX) return -EINVAL;
+    int err = check_checkpoint_aggregates(vmaf);
+    if (err) return err;
+
+    if (vmaf->thread_pool) {
+        err = vmaf_thread_pool_wait(vmaf->thread_pool);
+        if (err) return err;
+    }
+
+    // temporal scores of the last picture are written with the next one
+    unsigned idx = vmaf->pic_cnt;
+    if (idx && has_temporal_extractor(vmaf))
+        idx--;
+
+    const size_t tmp_sz = strlen(path) + 5;
+    char *tmp = malloc(tmp_sz);
+    if (!tmp) return -ENOMEM;
+    snprintf(tmp, tmp_sz, "%s.tmp", path);
+
+    // written aside and renamed, a checkpoint is never left half written
+    FILE *outfile = fopen(tmp, "wb");
+    if (!outfile) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "could not open file: %s\n", tmp);
+        err = -EINVAL;
+        goto free_tmp;
+    }
+    const unsigned n_subsample =
+        vmaf->cfg.n_subsample > 1 ? vmaf->cfg.n_subsample : 1;
+    err = vmaf_write_checkpoint_file(fc, outfile, idx, n_subsample);
+    if (fclose(outfile) && !err) err = -EIO;
+    if (!err && rename(tmp, path)) err = -EIO;
+    if (err) remove(tmp);
+    if (!err && index) *index = idx;
+
+free_tmp:
+    free(tmp);
+    return err;
+}
+
+int vmaf_read_checkpoint(VmafContext *vmaf, const char *path, unsigned *index)
+{
+    if (!vmaf) return -EINVAL;
+    if (!path) return -EINVAL;
+    if (!index) return -EINVAL;
+    if (vmaf->flushed || vmaf->pic_cnt) return -EINVAL;
+    if (vmaf->frames.queue) return -EINVAL;
+    int err = check_checkpoint_aggregates(vmaf);
+    if (err) return err;
+
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR, "could not open file: %s\n", path);
+        return -EINVAL;
+    }
+    const unsigned n_subsample =
+        vmaf->cfg.n_subsample > 1 ? vmaf->cfg.n_subsample : 1;
+    unsigned idx = 0;
+    err = vmaf_import_checkpoint(vmaf->feature_collector, in, n_subsample,
+                                     &idx);
+    fclose(in);
+    if (err) return err;
+
+    err = vmaf_set_read_range(vmaf, idx, UINT_MAX);
+    if (err) return err;
+    vmaf->pic_cnt = idx;
+    cover(vmaf, 0, idx);
+    *index = idx;
+    return 0;
+}
+
+static void deliver_frame(void *data, unsigned index)
+{
+    VmafContext *vmaf = data;
+    VmafFeatureCollector *fc = vmaf->feature_collector;
+
+    // predictions are only written as features arrive with metadata
+    // callbacks, otherwise here, quietly skipping frames missing features
+    for (VmafPredictModel *m = fc->models; m; m = m->next) {
+        double score;
+        if (vmaf_feature_collector_get_score(fc, m->model->name, &score, index))
+            vmaf_predict_score_at_index(m->model, fc, index, &score, true,
+                                        true, 0);
+    }
+
+    FeatureRecord record = { 0 };
+    int err = vmaf_feature_collector_get_record(fc, index, &record);
+    if (err) goto free_record;
+
+    // the capacity is only raised once both arrays have grown to it
+    if (record.cnt > vmaf->frames.scores.capacity) {
+        const char **name = realloc(vmaf->frames.scores.name,
+                                    sizeof(*name) * record.cnt);
+        if (name) vmaf->frames.scores.name = name;
+        double *score = !name ? NULL :
+            realloc(vmaf->frames.scores.score, sizeof(*score) * record.cnt);
+        if (score) vmaf->frames.scores.score = score;
+        if (!name || !score) {
+            err = -ENOMEM;
+            goto free_record;
+        }
+        vmaf->frames.scores.capacity = record.cnt;
+    }
+    for (unsigned i = 0; i < record.cnt; i++) {
+        vmaf->frames.scores.name[i] = record.entry[i].name;
+        vmaf->frames.scores.score[i] = record.entry[i].value;
+    }
+
+    VmafFrameScores frame = {
+        .index = index,
+        .cnt = record.cnt,
+        .feature_name = vmaf->frames.scores.name,
+        .score = vmaf->frames.scores.score,
+    };
+    vmaf->frames.cfg.callback(vmaf->frames.cfg.data, &frame);
+
+free_record:
+    if (err) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "could not collect scores of frame %d\n", index);
+        // may run with frames.lock held, see dispatch_waiting()
+        int none = 0;
+        atomic_compare_exchange_strong(&vmaf->frames.deliver_err, &none, err);
+    }
+    vmaf_feature_record_free(&record);
+}
+
+int vmaf_register_frame_callback(VmafContext *vmaf,
+                                 VmafFrameCallbackConfiguration cfg)
+{
+    if (!vmaf) return -EINVAL;
+    if (!cfg.callback) return -EINVAL;
+    if (vmaf->frames.queue || vmaf->pic_cnt) return -EINVAL;
+
+    const unsigned n_threads = vmaf->cfg.n_threads ? vmaf->cfg.n_threads : 1;
+    const unsigned max_pending =
+        cfg.max_pending ? cfg.max_pending : 2 * n_threads;
+    if (max_pending < 2) return -EINVAL;
+
+    int err = vmaf_frame_queue_create(&vmaf->frames.queue, max_pending,
+                                      cfg.flags & VMAF_FRAME_CALLBACK_IN_ORDER,
+                                      deliver_frame, vmaf);
+    if (err) return err;
+    pthread_mutex_init(&vmaf->frames.lock, NULL);
+    atomic_init(&vmaf->frames.deliver_err, 0);
+    vmaf->frames.cfg = cfg;
+    return 0;
+}
+
 int vmaf_register_metadata_handler(VmafContext *vmaf, VmafMetadataConfiguration cfg)
 {
     if (!vmaf) return -EINVAL;
@@ -796,6 +1858,37 @@ int vmaf_score_at_index_model_collection(VmafContext *vmaf,
                                                         index, score);
 }
 
+/*
+ * Pools the scored frames of the interval, interpolating the others, see
+ * vmaf_subsample_pool().
+ */
+static int subsample_pool(VmafContext *vmaf, const char *feature_name,
+                          enum VmafPoolingMethod pool_method, double *score,
+                          double *error, unsigned index_low,
+                          unsigned index_high)
+{
+    const unsigned cnt = index_high - index_low + 1;
+    double *s = malloc(sizeof(*s) * cnt);
+    bool *written = malloc(sizeof(*written) * cnt);
+    int err = -ENOMEM;
+    if (!s || !written) goto free_scores;
+
+    for (unsigned i = 0; i < cnt; i++) {
+        written[i] = vmaf_subsampler_selected(vmaf->subsampler, index_low + i);
+        if (!written[i]) continue;
+        err = vmaf_feature_score_at_index(vmaf, feature_name, &s[i],
+                                          index_low + i);
+        if (err) goto free_scores;
+    }
+
+    err = vmaf_subsample_pool(s, written, cnt, pool_method, score, error);
+
+free_scores:
+    free(s);
+    free(written);
+    return err;
+}
+
 int vmaf_feature_score_pooled(VmafContext *vmaf, const char *feature_name,
                               enum VmafPoolingMethod pool_method, double *score,
                               unsigned index_low, unsigned index_high)
@@ -805,10 +1898,16 @@ int vmaf_feature_score_pooled(VmafContext *vmaf, const char *feature_name,
     if (index_low > index_high) return -EINVAL;
     if (!pool_method) return -EINVAL;
 
+    if (vmaf_subsampler_adaptive(vmaf->subsampler)) {
+        double error;
+        return subsample_pool(vmaf, feature_name, pool_method, score, &error,
+                              index_low, index_high);
+    }
+
     unsigned pic_cnt = 0;
     double min = 0., max = 0., sum = 0., i_sum = 0.;
     for (unsigned i = index_low; i <= index_high; i++) {
-        if ((vmaf->cfg.n_subsample > 1) && (i % vmaf->cfg.n_subsample))
+        if (!vmaf_subsampler_selected(vmaf->subsampler, i))
             continue;
         pic_cnt++;
         double s;
@@ -853,7 +1952,7 @@ int vmaf_score_pooled(VmafContext *vmaf, VmafModel *model,
     if (!pool_method) return -EINVAL;
 
     for (unsigned i = index_low; i <= index_high; i++) {
-        if ((vmaf->cfg.n_subsample > 1) && (i % vmaf->cfg.n_subsample))
+        if (!vmaf_subsampler_selected(vmaf->subsampler, i))
             continue;
         double vmaf_score;
         int err = vmaf_score_at_index(vmaf, model, &vmaf_score, i);
@@ -864,6 +1963,187 @@ int vmaf_score_pooled(VmafContext *vmaf, VmafModel *model,
                                      index_low, index_high);
 }
 
+int vmaf_feature_score_pooled_error(VmafContext *vmaf, const char *feature_name,
+                                    enum VmafPoolingMethod pool_method,
+                                    double *error, unsigned index_low,
+                                    unsigned index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (!feature_name) return -EINVAL;
+    if (!error) return -EINVAL;
+    if (index_low > index_high) return -EINVAL;
+    if (!pool_method) return -EINVAL;
+
+    *error = 0.;
+    if (!vmaf->subsampler) return 0;
+
+    double score;
+    return subsample_pool(vmaf, feature_name, pool_method, &score, error,
+                          index_low, index_high);
+}
+
+int vmaf_score_pooled_error(VmafContext *vmaf, VmafModel *model,
+                            enum VmafPoolingMethod pool_method, double *error,
+                            unsigned index_low, unsigned index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (!model) return -EINVAL;
+    if (!error) return -EINVAL;
+    if (index_low > index_high) return -EINVAL;
+    if (!pool_method) return -EINVAL;
+
+    for (unsigned i = index_low; i <= index_high; i++) {
+        if (!vmaf_subsampler_selected(vmaf->subsampler, i))
+            continue;
+        double vmaf_score;
+        int err = vmaf_score_at_index(vmaf, model, &vmaf_score, i);
+        if (err) return err;
+    }
+
+    return vmaf_feature_score_pooled_error(vmaf, model->name, pool_method,
+                                           error, index_low, index_high);
+}
+
+/*
+ * Pooled estimate of `feature_name`, where frames which are not scored are
+ * predicted with `model`, if any.
+ */
+static int pooled_estimate(VmafContext *vmaf, const char *feature_name,
+                           VmafModel *model, enum VmafPoolingMethod pool_method,
+                           VmafPooledEstimate *estimate, unsigned index_low,
+                           unsigned index_high)
+{
+    if (index_low > index_high) return -EINVAL;
+    if (pool_method != VMAF_POOL_METHOD_MEAN &&
+        pool_method != VMAF_POOL_METHOD_HARMONIC_MEAN)
+    {
+        return -EINVAL;
+    }
+
+    // per run of consecutive scored frames, the sum of what is averaged
+    // and the number of frames
+    double *num = NULL, *den = NULL;
+    unsigned cnt = 0, capacity = 0, n_scored = 0;
+    double sum = 0.;
+    bool in_run = false;
+    int err = 0;
+
+    VmafFeatureCollector *fc = vmaf->feature_collector;
+    for (unsigned i = index_low; i <= index_high; i++) {
+        double score;
+        // quietly, frames still being extracted are missing features
+        const bool scored = vmaf_subsampler_selected(vmaf->subsampler, i) &&
+            (!vmaf_feature_collector_get_score(fc, feature_name, &score, i) ||
+             (model &&
+              !vmaf_predict_score_at_index(model, fc, i, &score, true, true, 0)));
+        if (!scored) {
+            in_run = false;
+            continue;
+        }
+
+        if (!in_run && cnt == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            double *n = realloc(num, sizeof(*n) * capacity);
+            if (!n) {
+                err = -ENOMEM;
+                goto free_runs;
+            }
+            num = n;
+            double *d = realloc(den, sizeof(*d) * capacity);
+            if (!d) {
+                err = -ENOMEM;
+                goto free_runs;
+            }
+            den = d;
+        }
+        if (!in_run) {
+            num[cnt] = den[cnt] = 0.;
+            cnt++;
+            in_run = true;
+        }
+
+        const double v = pool_method == VMAF_POOL_METHOD_MEAN ?
+                         score : 1. / (score + 1.);
+        num[cnt - 1] += v;
+        den[cnt - 1] += 1.;
+        sum += v;
+        n_scored++;
+    }
+
+    if (!n_scored) {
+        err = -EAGAIN;
+        goto free_runs;
+    }
+
+    const double mean = sum / n_scored;
+    const double pooled =
+        pool_method == VMAF_POOL_METHOD_MEAN ? mean : 1. / mean - 1.;
+    const unsigned n_frames = index_high - index_low + 1;
+
+    double lo = pooled, hi = pooled;
+    if (n_scored < n_frames && cnt < 2) {
+        lo = -INFINITY;
+        hi = INFINITY;
+    } else if (n_scored < n_frames) {
+        // neighbouring runs are strata, frames are read spread over the range
+        const unsigned stratum = cnt < 4 ? cnt : 2;
+        double mean_lo, mean_hi;
+        err = vmaf_bootstrap_ratio_ci(num, den, cnt, stratum, 1000,
+                                      &mean_lo, &mean_hi);
+        if (err) goto free_runs;
+        if (pool_method == VMAF_POOL_METHOD_MEAN) {
+            lo = mean_lo;
+            hi = mean_hi;
+        } else {
+            lo = 1. / mean_hi - 1.;
+            hi = 1. / mean_lo - 1.;
+        }
+
+        // the frames scored are drawn without replacement from the interval
+        const double fpc = sqrt(1. - (double) n_scored / n_frames);
+        lo = pooled - (pooled - lo) * fpc;
+        hi = pooled + (hi - pooled) * fpc;
+    }
+
+    estimate->score = pooled;
+    estimate->ci.lo = lo;
+    estimate->ci.hi = hi;
+    estimate->n_scored = n_scored;
+
+free_runs:
+    free(num);
+    free(den);
+    return err;
+}
+
+int vmaf_score_pooled_estimate(VmafContext *vmaf, VmafModel *model,
+                               enum VmafPoolingMethod pool_method,
+                               VmafPooledEstimate *estimate,
+                               unsigned index_low, unsigned index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (!model) return -EINVAL;
+    if (!estimate) return -EINVAL;
+
+    return pooled_estimate(vmaf, model->name, model, pool_method, estimate,
+                           index_low, index_high);
+}
+
+int vmaf_feature_score_pooled_estimate(VmafContext *vmaf,
+                                       const char *feature_name,
+                                       enum VmafPoolingMethod pool_method,
+                                       VmafPooledEstimate *estimate,
+                                       unsigned index_low,
+                                       unsigned index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (!feature_name) return -EINVAL;
+    if (!estimate) return -EINVAL;
+
+    return pooled_estimate(vmaf, feature_name, NULL, pool_method, estimate,
+                           index_low, index_high);
+}
+
 int vmaf_score_pooled_model_collection(VmafContext *vmaf,
                                        VmafModelCollection *model_collection,
                                        enum VmafPoolingMethod pool_method,
@@ -878,7 +2158,7 @@ int vmaf_score_pooled_model_collection(VmafContext *vmaf,
 
     int err = 0;
     for (unsigned i = index_low; i <= index_high; i++) {
-        if ((vmaf->cfg.n_subsample > 1) && (i % vmaf->cfg.n_subsample))
+        if (!vmaf_subsampler_selected(vmaf->subsampler, i))
             continue;
         VmafModelCollectionScore s;
         err = vmaf_score_at_index_model_collection(vmaf, model_collection, &s, i);
@@ -920,15 +2200,91 @@ int vmaf_score_pooled_model_collection(VmafContext *vmaf,
     return err;
 }
 
+int vmaf_get_perf_stats(VmafContext *vmaf, VmafPerfStats *stats)
+{
+    if (!vmaf) return -EINVAL;
+    if (!stats) return -EINVAL;
+
+#if VMAF_PERF_STATS
+    if (!vmaf->perf) return -EINVAL;
+
+    memset(stats, 0, sizeof(*stats));
+    int err = vmaf_perf_snapshot(vmaf->perf, stats);
+    if (err) return err;
+
+    if (vmaf->thread_pool) {
+        err = vmaf_thread_pool_queue_wait(vmaf->thread_pool,
+                                          &stats->queue_wait);
+        if (err) return err;
+    }
+
+    VmafFeatureCollector *fc = vmaf->feature_collector;
+    pthread_mutex_lock(&(fc->lock));
+    stats->collector_lock.acquired = fc->lock_stats.acquired;
+    stats->collector_lock.contended = fc->lock_stats.contended;
+    stats->collector_lock.wait_ns = fc->lock_stats.wait_ns;
+    pthread_mutex_unlock(&(fc->lock));
+
+    if (vmaf->fex_ctx_pool) {
+        pthread_mutex_lock(&(vmaf->fex_ctx_pool->lock));
+        stats->scratch_peak = vmaf->fex_ctx_pool->scratch.peak;
+        pthread_mutex_unlock(&(vmaf->fex_ctx_pool->lock));
+    }
+
+    return 0;
+#else
+    return -ENOSYS;
+#endif
+}
+
+int vmaf_get_kernel_selection(VmafContext *vmaf, unsigned index,
+                              VmafKernelSelection *sel)
+{
+    if (!vmaf) return -EINVAL;
+    if (!sel) return -EINVAL;
+
+    return vmaf_kernel_selection(index, sel);
+}
+
+int vmaf_get_arena_stats(VmafContext *vmaf, VmafArenaStats *stats)
+{
+    if (!vmaf) return -EINVAL;
+    if (!stats) return -EINVAL;
+
+    vmaf_arena_stats(vmaf->arena, &stats->peak, &stats->reserved,
+                     &stats->huge_pages);
+    return 0;
+}
+
+int vmaf_set_thread_affinity(const char *affinity)
+{
+    VmafAffinity aff;
+    int err = vmaf_affinity_parse(&aff, affinity);
+    if (err) return err;
+    return vmaf_affinity_apply(&aff);
+}
+
 const char *vmaf_version(void)
 {
     return VMAF_VERSION;
 }
 
+int vmaf_set_output_range(VmafContext *vmaf, unsigned index_low,
+                          unsigned index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (index_low > index_high) return -EINVAL;
+    if (index_high == UINT_MAX) return -EINVAL;
+
+    cover(vmaf, index_low, index_high + 1);
+    return 0;
+}
+
 int vmaf_write_output(VmafContext *vmaf, const char *output_path,
                       enum VmafOutputFormat fmt)
 {
-    FILE *outfile = fopen(output_path, "w");
+    FILE *outfile =
+        fopen(output_path, fmt == VMAF_OUTPUT_FORMAT_BINARY ? "wb" : "w");
     if (!outfile) {
         fprintf(stderr, "could not open file: %s\n", output_path);
         return -EINVAL;
@@ -942,21 +2298,26 @@ int vmaf_write_output(VmafContext *vmaf, const char *output_path,
     switch (fmt) {
     case VMAF_OUTPUT_FORMAT_XML:
         ret = vmaf_write_output_xml(vmaf, vmaf->feature_collector, outfile,
-                                    vmaf->cfg.n_subsample,
+                                    vmaf->subsampler,
                                     vmaf->pic_params.w, vmaf->pic_params.h,
-                                    fps, vmaf->pic_cnt);
+                                    fps, vmaf->covered.low, vmaf->covered.end);
         break;
     case VMAF_OUTPUT_FORMAT_JSON:
         ret = vmaf_write_output_json(vmaf, vmaf->feature_collector, outfile,
-                                     vmaf->cfg.n_subsample, fps, vmaf->pic_cnt);
+                                     vmaf->subsampler, fps,
+                                     vmaf->covered.low, vmaf->covered.end);
         break;
     case VMAF_OUTPUT_FORMAT_CSV:
         ret = vmaf_write_output_csv(vmaf->feature_collector, outfile,
-                                    vmaf->cfg.n_subsample);
+                                    vmaf->subsampler);
         break;
     case VMAF_OUTPUT_FORMAT_SUB:
         ret = vmaf_write_output_sub(vmaf->feature_collector, outfile,
-                                    vmaf->cfg.n_subsample);
+                                    vmaf->subsampler);
+        break;
+    case VMAF_OUTPUT_FORMAT_BINARY:
+        ret = vmaf_write_output_binary(vmaf->feature_collector, outfile,
+                                       vmaf->covered.low, vmaf->covered.end);
         break;
     default:
         ret = -EINVAL;
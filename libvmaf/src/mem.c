@@ -17,11 +17,38 @@
  */
 
 #define _POSIX_C_SOURCE 200112L
+#define _DEFAULT_SOURCE
 
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#endif
+
+#include "config.h"
 #include "mem.h"
 
+#if VMAF_PERF_STATS
+#include <stdatomic.h>
+
+static atomic_uint_fast64_t bytes_allocated;
+// number of perf stats users, allocations are only counted while nonzero
+static atomic_uint counting;
+
+static void count_bytes(size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed))
+        atomic_fetch_add_explicit(&bytes_allocated, size, memory_order_relaxed);
+}
+#endif
+
 void *aligned_malloc(size_t size, size_t alignment)
 {
 	void *ptr;
@@ -32,8 +59,11 @@ void *aligned_malloc(size_t size, size_t alignment)
     if (posix_memalign(&ptr, alignment, size))
 #endif
 		return 0;
-	else
-		return ptr;
+
+#if VMAF_PERF_STATS
+    count_bytes(size);
+#endif
+	return ptr;
 }
 
 void aligned_free(void *ptr)
@@ -44,3 +74,186 @@ void aligned_free(void *ptr)
 	free(ptr);
 #endif
 }
+
+uint64_t vmaf_mem_bytes_allocated(void)
+{
+#if VMAF_PERF_STATS
+    return atomic_load_explicit(&bytes_allocated, memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+void vmaf_mem_count_bytes(bool enable)
+{
+#if VMAF_PERF_STATS
+    if (enable)
+        atomic_fetch_add_explicit(&counting, 1, memory_order_relaxed);
+    else
+        atomic_fetch_sub_explicit(&counting, 1, memory_order_relaxed);
+#else
+    (void) enable;
+#endif
+}
+
+#define ARENA_PAGE_SIZE 4096
+#define ARENA_HUGE_PAGE_SIZE (2u << 20)
+#define ARENA_MIN_CHUNK_SIZE (4u << 20)
+
+typedef struct VmafArenaChunk {
+    struct VmafArenaChunk *next;
+    char *data;
+    size_t size, used;
+    bool huge;
+} VmafArenaChunk;
+
+struct VmafArena {
+    unsigned flags;
+    pthread_mutex_t lock;
+    VmafArenaChunk *chunk;
+    uint64_t used, reserved, huge;
+};
+
+int vmaf_arena_create(VmafArena **arena, unsigned flags)
+{
+    if (!arena) return -EINVAL;
+
+    VmafArena *const a = *arena = malloc(sizeof(*a));
+    if (!a) return -ENOMEM;
+    memset(a, 0, sizeof(*a));
+    a->flags = flags;
+    pthread_mutex_init(&(a->lock), NULL);
+    return 0;
+}
+
+static int chunk_map(VmafArenaChunk *c, unsigned flags)
+{
+#if HAVE_MMAP
+    const int prot = PROT_READ | PROT_WRITE;
+    const int map = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // needs pages reserved through vm.nr_hugepages, commonly unavailable
+    if (flags & VMAF_ARENA_HUGE_PAGES) {
+        data = mmap(NULL, c->size, prot, map | MAP_HUGETLB, -1, 0);
+        c->huge = data != MAP_FAILED;
+    }
+#endif
+    if (data == MAP_FAILED)
+        data = mmap(NULL, c->size, prot, map, -1, 0);
+    if (data == MAP_FAILED) return -ENOMEM;
+#ifdef MADV_HUGEPAGE
+    // transparent huge pages, the chunk size keeps them 2 MiB aligned in size
+    if ((flags & VMAF_ARENA_HUGE_PAGES) && !c->huge)
+        madvise(data, c->size, MADV_HUGEPAGE);
+#endif
+    c->data = data;
+    return 0;
+#else
+    (void) flags;
+    c->data = aligned_malloc(c->size, 64);
+    return c->data ? 0 : -ENOMEM;
+#endif
+}
+
+static VmafArenaChunk *chunk_create(VmafArena *a, size_t size)
+{
+    VmafArenaChunk *c = malloc(sizeof(*c));
+    if (!c) return NULL;
+    memset(c, 0, sizeof(*c));
+    size = size > ARENA_MIN_CHUNK_SIZE ? size : ARENA_MIN_CHUNK_SIZE;
+    const size_t huge = ARENA_HUGE_PAGE_SIZE;
+    c->size = (size + huge - 1) / huge * huge;
+
+    if (chunk_map(c, a->flags)) {
+        free(c);
+        return NULL;
+    }
+    // touch every page now, on the thread which will use the memory
+    if (a->flags & VMAF_ARENA_PREFAULT) {
+        for (size_t i = 0; i < c->size; i += ARENA_PAGE_SIZE)
+            c->data[i] = 0;
+    }
+
+    a->reserved += c->size;
+    if (c->huge) a->huge += c->size;
+#if VMAF_PERF_STATS
+    count_bytes(c->size);
+#endif
+    return c;
+}
+
+void *vmaf_arena_alloc(VmafArena *arena, size_t size, size_t alignment)
+{
+    if (!arena) return aligned_malloc(size, alignment);
+    if (!size || !alignment || alignment > ARENA_PAGE_SIZE) return NULL;
+
+    pthread_mutex_lock(&(arena->lock));
+    VmafArenaChunk *c = arena->chunk;
+    size_t offset = 0;
+    if (c) {
+        offset = (c->used + alignment - 1) / alignment * alignment;
+        if (offset > c->size || size > c->size - offset) c = NULL;
+    }
+    if (!c) {
+        // chunks are page aligned, so any alignment up to a page holds
+        c = chunk_create(arena, size);
+        if (!c) {
+            pthread_mutex_unlock(&(arena->lock));
+            return NULL;
+        }
+        // keep allocating from whichever chunk has more room left
+        VmafArenaChunk *head = arena->chunk;
+        if (head && c->size - size < head->size - head->used) {
+            c->next = head->next;
+            head->next = c;
+        } else {
+            c->next = head;
+            arena->chunk = c;
+        }
+        offset = 0;
+    }
+    void *ptr = c->data + offset;
+    c->used = offset + size;
+    arena->used += size;
+    pthread_mutex_unlock(&(arena->lock));
+    return ptr;
+}
+
+void vmaf_arena_free(VmafArena *arena, void *ptr)
+{
+    if (!arena) aligned_free(ptr);
+}
+
+void vmaf_arena_stats(VmafArena *arena, uint64_t *used, uint64_t *reserved,
+                      uint64_t *huge)
+{
+    if (!arena) {
+        *used = *reserved = *huge = 0;
+        return;
+    }
+    pthread_mutex_lock(&(arena->lock));
+    *used = arena->used;
+    *reserved = arena->reserved;
+    *huge = arena->huge;
+    pthread_mutex_unlock(&(arena->lock));
+}
+
+void vmaf_arena_destroy(VmafArena *arena)
+{
+    if (!arena) return;
+
+    VmafArenaChunk *c = arena->chunk;
+    while (c) {
+        VmafArenaChunk *next = c->next;
+#if HAVE_MMAP
+        munmap(c->data, c->size);
+#else
+        aligned_free(c->data);
+#endif
+        free(c);
+        c = next;
+    }
+    pthread_mutex_destroy(&(arena->lock));
+    free(arena);
+}
@@ -19,7 +19,9 @@
 #ifndef __VMAF_MEM_H__
 #define __VMAF_MEM_H__
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define MAX_ALIGN 32
 
@@ -30,4 +32,48 @@ void *aligned_malloc(size_t size, size_t alignment);
 
 void aligned_free(void *ptr);
 
+/**
+ * Total bytes requested through aligned_malloc() by this process.
+ * Only counted when built with perf stats and while counting is enabled,
+ * 0 otherwise.
+ */
+uint64_t vmaf_mem_bytes_allocated(void);
+
+/*
+ * Enable or disable counting, calls nest. The perf stats of each context
+ * count while the context exists.
+ */
+void vmaf_mem_count_bytes(bool enable);
+
+/*
+ * Bump allocator for feature extractor scratch. Memory is reserved in chunks,
+ * optionally backed by 2 MiB huge pages and prefaulted by the thread which
+ * reserves them, and only released as a whole by vmaf_arena_destroy().
+ * Allocation is thread-safe. A NULL arena falls back to aligned_malloc() and
+ * aligned_free(), so extractors can use these unconditionally.
+ */
+
+enum VmafArenaFlags {
+    VMAF_ARENA_HUGE_PAGES = 1 << 0,
+    VMAF_ARENA_PREFAULT = 1 << 1,
+};
+
+typedef struct VmafArena VmafArena;
+
+int vmaf_arena_create(VmafArena **arena, unsigned flags);
+
+void *vmaf_arena_alloc(VmafArena *arena, size_t size, size_t alignment);
+
+/* No-op for arena memory, aligned_free() when `arena` is NULL. */
+void vmaf_arena_free(VmafArena *arena, void *ptr);
+
+/**
+ * Bytes handed out so far (nothing is returned before destruction, so this is
+ * also the peak), bytes reserved, and how many of those are huge pages.
+ */
+void vmaf_arena_stats(VmafArena *arena, uint64_t *used, uint64_t *reserved,
+                      uint64_t *huge);
+
+void vmaf_arena_destroy(VmafArena *arena);
+
 #endif /* __VMAF_MEM_H__ */
@@ -31,6 +31,7 @@ enum VmafOptionType {
 
 enum VmafOptionFlag {
     VMAF_OPT_FLAG_FEATURE_PARAM = 1 << 0,
+    VMAF_OPT_FLAG_FLUSH_AGGREGATE = 1 << 1, ///< Bool, when set aggregates over all pictures are written at flush.
 };
 
 typedef struct VmafOption {
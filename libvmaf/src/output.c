@@ -17,13 +17,19 @@
  */
 
 #include <errno.h>
+#include <inttypes.h>
 #include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "feature/alias.h"
 #include "feature/feature_collector.h"
 
 #include "libvmaf/libvmaf.h"
+#include "output.h"
 
 static unsigned max_capacity(VmafFeatureCollector *fc)
 {
@@ -64,9 +70,193 @@ static int count_leading_zeros_d(double x)
     return leading_zeros_count;
 }
 
+/*
+ * Whether frames of the interval which the subsampler selected are not
+ * scored, e.g. the frames a progressive run did not read.
+ */
+static bool partially_scored(const FeatureVector *fv,
+                             const VmafSubsampler *subsampler,
+                             unsigned index_low, unsigned frame_cnt)
+{
+    for (unsigned i = index_low; i < frame_cnt; i++) {
+        if (!vmaf_subsampler_selected(subsampler, i))
+            continue;
+        if (i >= fv->capacity || !fv->score[i].written)
+            return true;
+    }
+    return false;
+}
+
+static int pool_scored(const FeatureVector *fv,
+                       const VmafSubsampler *subsampler,
+                       enum VmafPoolingMethod pool_method, double *score,
+                       unsigned index_low, unsigned frame_cnt)
+{
+    unsigned n_scored = 0;
+    double min = 0., max = 0., sum = 0., i_sum = 0.;
+    for (unsigned i = index_low; i < frame_cnt && i < fv->capacity; i++) {
+        if (!vmaf_subsampler_selected(subsampler, i))
+            continue;
+        if (!fv->score[i].written)
+            continue;
+        const double s = fv->score[i].value;
+        if (!n_scored || s < min)
+            min = s;
+        if (!n_scored || s > max)
+            max = s;
+        sum += s;
+        i_sum += 1. / (s + 1.);
+        n_scored++;
+    }
+    if (!n_scored) return -EINVAL;
+
+    switch (pool_method) {
+    case VMAF_POOL_METHOD_MEAN:
+        *score = sum / n_scored;
+        break;
+    case VMAF_POOL_METHOD_MIN:
+        *score = min;
+        break;
+    case VMAF_POOL_METHOD_MAX:
+        *score = max;
+        break;
+    case VMAF_POOL_METHOD_HARMONIC_MEAN:
+        *score = n_scored / i_sum - 1.0;
+        break;
+    default:
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/*
+ * Pools a feature over the interval. Where only some of its frames are
+ * scored, the frames scored are pooled and `estimate` is set, with the
+ * confidence interval of the mean over every frame.
+ */
+static int pool_feature(VmafContext *vmaf, const FeatureVector *fv,
+                        const VmafSubsampler *subsampler, double *score,
+                        VmafPooledEstimate *estimate, unsigned index_low,
+                        unsigned frame_cnt)
+{
+    estimate->n_scored = 0;
+    for (unsigned j = 1; j < VMAF_POOL_METHOD_NB; j++)
+        score[j] = NAN;
+    if (index_low >= frame_cnt) return -EINVAL;
+
+    if (!partially_scored(fv, subsampler, index_low, frame_cnt)) {
+        for (unsigned j = 1; j < VMAF_POOL_METHOD_NB; j++) {
+            if (vmaf_feature_score_pooled(vmaf, fv->name, j, &score[j],
+                                          index_low, frame_cnt - 1))
+            {
+                return -EINVAL;
+            }
+        }
+        return 0;
+    }
+
+    for (unsigned j = 1; j < VMAF_POOL_METHOD_NB; j++) {
+        int err = pool_scored(fv, subsampler, j, &score[j], index_low,
+                              frame_cnt);
+        if (err) return err;
+    }
+    return vmaf_feature_score_pooled_estimate(vmaf, fv->name,
+                                              VMAF_POOL_METHOD_MEAN, estimate,
+                                              index_low, frame_cnt - 1);
+}
+
+static void write_perf_timing_xml(FILE *outfile, const char *indent,
+                                  const char *tag, const VmafPerfTiming *t)
+{
+    fprintf(outfile, "%s<%s count=\"%" PRIu64 "\" wall_ns=\"%" PRIu64 "\" "
+            "cpu_ns=\"%" PRIu64 "\" max_wall_ns=\"%" PRIu64 "\" "
+            "histogram_us=\"", indent, tag, t->count, t->wall_ns, t->cpu_ns,
+            t->max_wall_ns);
+    for (unsigned i = 0; i < VMAF_PERF_HISTOGRAM_BINS; i++)
+        fprintf(outfile, "%s%" PRIu64, i ? " " : "", t->histogram[i]);
+    fprintf(outfile, "\" />\n");
+}
+
+static void write_perf_xml(VmafContext *vmaf, FILE *outfile)
+{
+    VmafPerfStats stats;
+    if (vmaf_get_perf_stats(vmaf, &stats)) return;
+
+    fprintf(outfile, "  <perf bytes_allocated=\"%" PRIu64 "\" "
+            "scratch_peak=\"%" PRIu64 "\">\n",
+            stats.bytes_allocated, stats.scratch_peak);
+    write_perf_timing_xml(outfile, "    ", "queue_wait", &stats.queue_wait);
+    fprintf(outfile, "    <collector_lock acquired=\"%" PRIu64 "\" "
+            "contended=\"%" PRIu64 "\" wait_ns=\"%" PRIu64 "\" />\n",
+            stats.collector_lock.acquired, stats.collector_lock.contended,
+            stats.collector_lock.wait_ns);
+    for (unsigned i = 0; i < stats.n_extractors; i++) {
+        const VmafPerfExtractorStats *e = &stats.extractor[i];
+        fprintf(outfile, "    <extractor name=\"%s\">\n", e->name);
+        write_perf_timing_xml(outfile, "      ", "init", &e->init);
+        write_perf_timing_xml(outfile, "      ", "extract", &e->extract);
+        write_perf_timing_xml(outfile, "      ", "flush", &e->flush);
+        write_perf_timing_xml(outfile, "      ", "pool_wait", &e->pool_wait);
+        fprintf(outfile, "    </extractor>\n");
+    }
+    fprintf(outfile, "  </perf>\n");
+}
+
+static void write_perf_timing_json(FILE *outfile, const char *indent,
+                                   const char *key, const VmafPerfTiming *t)
+{
+    fprintf(outfile, "%s\"%s\": {\n", indent, key);
+    fprintf(outfile, "%s  \"count\": %" PRIu64 ",\n", indent, t->count);
+    fprintf(outfile, "%s  \"wall_ns\": %" PRIu64 ",\n", indent, t->wall_ns);
+    fprintf(outfile, "%s  \"cpu_ns\": %" PRIu64 ",\n", indent, t->cpu_ns);
+    fprintf(outfile, "%s  \"max_wall_ns\": %" PRIu64 ",\n", indent,
+            t->max_wall_ns);
+    fprintf(outfile, "%s  \"histogram_us\": [", indent);
+    for (unsigned i = 0; i < VMAF_PERF_HISTOGRAM_BINS; i++)
+        fprintf(outfile, "%s%" PRIu64, i ? ", " : "", t->histogram[i]);
+    fprintf(outfile, "]\n%s}", indent);
+}
+
+static void write_perf_json(VmafContext *vmaf, FILE *outfile)
+{
+    VmafPerfStats stats;
+    if (vmaf_get_perf_stats(vmaf, &stats)) return;
+
+    fprintf(outfile, ",\n  \"perf\": {\n");
+    fprintf(outfile, "    \"bytes_allocated\": %" PRIu64 ",\n",
+            stats.bytes_allocated);
+    fprintf(outfile, "    \"scratch_peak\": %" PRIu64 ",\n",
+            stats.scratch_peak);
+    write_perf_timing_json(outfile, "    ", "queue_wait", &stats.queue_wait);
+    fprintf(outfile, ",\n    \"collector_lock\": {\n");
+    fprintf(outfile, "      \"acquired\": %" PRIu64 ",\n",
+            stats.collector_lock.acquired);
+    fprintf(outfile, "      \"contended\": %" PRIu64 ",\n",
+            stats.collector_lock.contended);
+    fprintf(outfile, "      \"wait_ns\": %" PRIu64 "\n",
+            stats.collector_lock.wait_ns);
+    fprintf(outfile, "    },\n");
+    fprintf(outfile, "    \"extractors\": {");
+    for (unsigned i = 0; i < stats.n_extractors; i++) {
+        const VmafPerfExtractorStats *e = &stats.extractor[i];
+        fprintf(outfile, "%s\n      \"%s\": {\n", i ? "," : "", e->name);
+        write_perf_timing_json(outfile, "        ", "init", &e->init);
+        fprintf(outfile, ",\n");
+        write_perf_timing_json(outfile, "        ", "extract", &e->extract);
+        fprintf(outfile, ",\n");
+        write_perf_timing_json(outfile, "        ", "flush", &e->flush);
+        fprintf(outfile, ",\n");
+        write_perf_timing_json(outfile, "        ", "pool_wait", &e->pool_wait);
+        fprintf(outfile, "\n      }");
+    }
+    fprintf(outfile, "\n    }\n");
+    fprintf(outfile, "  }");
+}
+
 int vmaf_write_output_xml(VmafContext *vmaf, VmafFeatureCollector *fc,
-                          FILE *outfile, unsigned subsample, unsigned width,
-                          unsigned height, double fps, unsigned pic_cnt)
+                          FILE *outfile, const VmafSubsampler *subsampler,
+                          unsigned width, unsigned height, double fps,
+                          unsigned index_low, unsigned frame_cnt)
 {
     if (!vmaf) return -EINVAL;
     if (!fc) return -EINVAL;
@@ -81,7 +271,7 @@ int vmaf_write_output_xml(VmafContext *vmaf, VmafFeatureCollector *fc,
     int leading_zeros_count;
     fprintf(outfile, "  <frames>\n");
     for (unsigned i = 0 ; i < max_capacity(fc); i++) {
-        if ((subsample > 1) && (i % subsample))
+        if (!vmaf_subsampler_selected(subsampler, i))
             continue;
 
         unsigned cnt = 0;
@@ -120,18 +310,32 @@ int vmaf_write_output_xml(VmafContext *vmaf, VmafFeatureCollector *fc,
         fprintf(outfile, "    <metric name=\"%s\" ",
                 vmaf_feature_name_alias(feature_name));
 
-        for (unsigned j = 1; j < VMAF_POOL_METHOD_NB; j++) {
-            double score;
-            int err = vmaf_feature_score_pooled(vmaf, feature_name, j, &score,
-                                                0, pic_cnt - 1);
-            if (!err)
-            {
-                leading_zeros_count = count_leading_zeros_d(score);
-                if (leading_zeros_count <= 6)
-                    fprintf(outfile, "%s=\"%.6f\" ", pool_method_name[j], score);
-                else
-                    fprintf(outfile, "%s=\"%.16f\" ", pool_method_name[j], score);
+        double pooled[VMAF_POOL_METHOD_NB];
+        VmafPooledEstimate est;
+        int err = pool_feature(vmaf, fc->feature_vector[i], subsampler,
+                               pooled, &est, index_low, frame_cnt);
+        for (unsigned j = 1; j < VMAF_POOL_METHOD_NB && !err; j++) {
+            const double score = pooled[j];
+            leading_zeros_count = count_leading_zeros_d(score);
+            if (leading_zeros_count <= 6)
+                fprintf(outfile, "%s=\"%.6f\" ", pool_method_name[j], score);
+            else
+                fprintf(outfile, "%s=\"%.16f\" ", pool_method_name[j], score);
+        }
+        double error;
+        if (!err && !est.n_scored && subsampler &&
+            !vmaf_feature_score_pooled_error(vmaf, feature_name,
+                                             VMAF_POOL_METHOD_MEAN, &error,
+                                             index_low, frame_cnt - 1))
+        {
+            fprintf(outfile, "mean_error=\"%.6f\" ", error);
+        }
+        if (!err && est.n_scored) {
+            if (isfinite(est.ci.lo) && isfinite(est.ci.hi)) {
+                fprintf(outfile, "ci_p95_lo=\"%.6f\" ci_p95_hi=\"%.6f\" ",
+                        est.ci.lo, est.ci.hi);
             }
+            fprintf(outfile, "n_scored=\"%u\" ", est.n_scored);
         }
         fprintf(outfile, "/>\n");
     }
@@ -152,14 +356,17 @@ int vmaf_write_output_xml(VmafContext *vmaf, VmafFeatureCollector *fc,
     }
     fprintf(outfile, "/>\n");
 
+    write_perf_xml(vmaf, outfile);
+
     fprintf(outfile, "</VMAF>\n");
 
     return 0;
 }
 
 int vmaf_write_output_json(VmafContext *vmaf, VmafFeatureCollector *fc,
-                           FILE *outfile, unsigned subsample, double fps,
-                           unsigned pic_cnt)
+                           FILE *outfile, const VmafSubsampler *subsampler,
+                           double fps, unsigned index_low,
+                           unsigned frame_cnt)
 {
     int leading_zeros_count;
     fprintf(outfile, "{\n");
@@ -178,7 +385,7 @@ int vmaf_write_output_json(VmafContext *vmaf, VmafFeatureCollector *fc,
     unsigned n_frames = 0;
     fprintf(outfile, "  \"frames\": [");
     for (unsigned i = 0 ; i < max_capacity(fc); i++) {
-        if ((subsample > 1) && (i % subsample))
+        if (!vmaf_subsampler_selected(subsampler, i))
             continue;
 
         unsigned cnt = 0;
@@ -189,7 +396,7 @@ int vmaf_write_output_json(VmafContext *vmaf, VmafFeatureCollector *fc,
                 cnt++;
         }
         if (!cnt) continue;
-        fprintf(outfile, "%s", i > 0 ? ",\n" : "\n");
+        fprintf(outfile, "%s", n_frames ? ",\n" : "\n");
 
         fprintf(outfile, "    {\n");
         fprintf(outfile, "      \"frameNum\": %d,\n", i);
@@ -239,32 +446,52 @@ int vmaf_write_output_json(VmafContext *vmaf, VmafFeatureCollector *fc,
         fprintf(outfile, "%s", i > 0 ? ",\n" : "\n");
         fprintf(outfile, "    \"%s\": {",
                 vmaf_feature_name_alias(feature_name));
-        for (unsigned j = 1; j < VMAF_POOL_METHOD_NB; j++) {
-            double score;
-            int err = vmaf_feature_score_pooled(vmaf, feature_name, j, &score,
-                                                0, pic_cnt - 1);
-            if (!err) {
-                fprintf(outfile, "%s", j > 1 ? ",\n" : "\n");
-                switch(fpclassify(score)) {
-                case FP_NORMAL:
-                case FP_ZERO:
-                case FP_SUBNORMAL:
-                    leading_zeros_count = count_leading_zeros_d((double)score);
-                    if (leading_zeros_count <= 6)
-                        fprintf(outfile, "      \"%s\": %.6f",
-                            pool_method_name[j], score);
-                    else
-                        fprintf(outfile, "      \"%s\": %.16f",
-                            pool_method_name[j], score);
-                    break;
-                case FP_INFINITE:
-                case FP_NAN:
-                    fprintf(outfile, "      \"%s\": null",
-                            pool_method_name[j]);
-                    break;
-                }
+        double pooled[VMAF_POOL_METHOD_NB];
+        VmafPooledEstimate est;
+        int err = pool_feature(vmaf, fc->feature_vector[i], subsampler,
+                               pooled, &est, index_low, frame_cnt);
+        for (unsigned j = 1; j < VMAF_POOL_METHOD_NB && !err; j++) {
+            const double score = pooled[j];
+            fprintf(outfile, "%s", j > 1 ? ",\n" : "\n");
+            switch(fpclassify(score)) {
+            case FP_NORMAL:
+            case FP_ZERO:
+            case FP_SUBNORMAL:
+                leading_zeros_count = count_leading_zeros_d((double)score);
+                if (leading_zeros_count <= 6)
+                    fprintf(outfile, "      \"%s\": %.6f",
+                        pool_method_name[j], score);
+                else
+                    fprintf(outfile, "      \"%s\": %.16f",
+                        pool_method_name[j], score);
+                break;
+            case FP_INFINITE:
+            case FP_NAN:
+                fprintf(outfile, "      \"%s\": null",
+                        pool_method_name[j]);
+                break;
             }
         }
+        // subsampled, the estimated error of the mean against every frame
+        double error;
+        if (!err && !est.n_scored && subsampler &&
+            !vmaf_feature_score_pooled_error(vmaf, feature_name,
+                                             VMAF_POOL_METHOD_MEAN, &error,
+                                             index_low, frame_cnt - 1))
+        {
+            fprintf(outfile, ",\n      \"mean_error\": %.6f", error);
+        }
+        if (!err && est.n_scored) {
+            // the interval is infinite until there are two runs of frames
+            if (isfinite(est.ci.lo) && isfinite(est.ci.hi)) {
+                fprintf(outfile, ",\n      \"ci_p95_lo\": %.6f", est.ci.lo);
+                fprintf(outfile, ",\n      \"ci_p95_hi\": %.6f", est.ci.hi);
+            } else {
+                fprintf(outfile, ",\n      \"ci_p95_lo\": null");
+                fprintf(outfile, ",\n      \"ci_p95_hi\": null");
+            }
+            fprintf(outfile, ",\n      \"n_scored\": %u", est.n_scored);
+        }
         fprintf(outfile, "\n");
         fprintf(outfile, "    }");
     }
@@ -296,14 +523,15 @@ int vmaf_write_output_json(VmafContext *vmaf, VmafFeatureCollector *fc,
         }
         fprintf(outfile, "%s", i < fc->aggregate_vector.cnt - 1 ? "," : "");
     }
-    fprintf(outfile, "\n  }\n");
-    fprintf(outfile, "}\n");
+    fprintf(outfile, "\n  }");
+    write_perf_json(vmaf, outfile);
+    fprintf(outfile, "\n}\n");
 
     return 0;
 }
 
 int vmaf_write_output_csv(VmafFeatureCollector *fc, FILE *outfile,
-                           unsigned subsample)
+                           const VmafSubsampler *subsampler)
 {
     int leading_zeros_count;
     fprintf(outfile, "Frame,");
@@ -314,7 +542,7 @@ int vmaf_write_output_csv(VmafFeatureCollector *fc, FILE *outfile,
     fprintf(outfile, "\n");
 
     for (unsigned i = 0 ; i < max_capacity(fc); i++) {
-        if ((subsample > 1) && (i % subsample))
+        if (!vmaf_subsampler_selected(subsampler, i))
             continue;
 
         unsigned cnt = 0;
@@ -346,11 +574,11 @@ int vmaf_write_output_csv(VmafFeatureCollector *fc, FILE *outfile,
 }
 
 int vmaf_write_output_sub(VmafFeatureCollector *fc, FILE *outfile,
-                          unsigned subsample)
+                          const VmafSubsampler *subsampler)
 {
     int leading_zeros_count;
     for (unsigned i = 0 ; i < max_capacity(fc); i++) {
-        if ((subsample > 1) && (i % subsample))
+        if (!vmaf_subsampler_selected(subsampler, i))
             continue;
 
         unsigned cnt = 0;
@@ -383,3 +611,77 @@ int vmaf_write_output_sub(VmafFeatureCollector *fc, FILE *outfile,
 
     return 0;
 }
+
+static void write_u32(FILE *outfile, uint32_t x)
+{
+    fwrite(&x, sizeof(x), 1, outfile);
+}
+
+int vmaf_write_output_binary(VmafFeatureCollector *fc, FILE *outfile,
+                             unsigned index_low, unsigned frame_cnt)
+{
+    double *value = NULL;
+    unsigned value_capacity = 0;
+
+    fwrite(VMAF_OUTPUT_BINARY_MAGIC, 1, strlen(VMAF_OUTPUT_BINARY_MAGIC),
+           outfile);
+    write_u32(outfile, VMAF_OUTPUT_BINARY_VERSION);
+    write_u32(outfile, index_low);
+    write_u32(outfile, frame_cnt);
+    write_u32(outfile, fc->cnt);
+
+    for (unsigned i = 0; i < fc->cnt; i++) {
+        FeatureVector *fv = fc->feature_vector[i];
+        const uint32_t name_len = strlen(fv->name) + 1;
+        write_u32(outfile, name_len);
+        fwrite(fv->name, 1, name_len, outfile);
+
+        if (fv->capacity > value_capacity) {
+            void *v = realloc(value, sizeof(*value) * fv->capacity);
+            if (!v) {
+                free(value);
+                return -ENOMEM;
+            }
+            value = v;
+            value_capacity = fv->capacity;
+        }
+
+        const unsigned cnt =
+            fv->capacity < frame_cnt ? fv->capacity : frame_cnt;
+        uint32_t n_runs = 0;
+        for (unsigned j = index_low; j < cnt; j++) {
+            if (fv->score[j].written &&
+                (j == index_low || !fv->score[j - 1].written))
+            {
+                n_runs++;
+            }
+        }
+        write_u32(outfile, n_runs);
+
+        for (unsigned j = index_low; j < cnt;) {
+            if (!fv->score[j].written) {
+                j++;
+                continue;
+            }
+            const unsigned index = j;
+            for (; j < cnt && fv->score[j].written; j++)
+                value[j - index] = fv->score[j].value;
+            write_u32(outfile, index);
+            write_u32(outfile, j - index);
+            fwrite(value, sizeof(*value), j - index, outfile);
+        }
+    }
+
+    free(value);
+    return ferror(outfile) ? -EIO : 0;
+}
+
+int vmaf_write_checkpoint_file(VmafFeatureCollector *fc, FILE *outfile,
+                               unsigned index, unsigned n_subsample)
+{
+    fwrite(VMAF_CHECKPOINT_MAGIC, 1, strlen(VMAF_CHECKPOINT_MAGIC), outfile);
+    write_u32(outfile, VMAF_CHECKPOINT_VERSION);
+    write_u32(outfile, index);
+    write_u32(outfile, n_subsample);
+    return vmaf_write_output_binary(fc, outfile, 0, index);
+}
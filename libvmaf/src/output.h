@@ -19,18 +19,62 @@
 #ifndef __VMAF_OUTPUT_H__
 #define __VMAF_OUTPUT_H__
 
+#include "subsample.h"
+
+/*
+ * Metrics are pooled over pictures `index_low` up to `frame_cnt`. Where only
+ * some of them are scored, e.g. by a progressive run, the pictures scored
+ * are pooled and the confidence interval of the mean and the number of
+ * pictures scored are written next to the pooled scores. When subsampling,
+ * the estimated error of the mean is.
+ */
 int vmaf_write_output_xml(VmafContext *vmaf, VmafFeatureCollector *fc, FILE *outfile,
-                          unsigned subsample, unsigned width, unsigned height,
-                          double fps, unsigned pic_cnt);
+                          const VmafSubsampler *subsampler, unsigned width,
+                          unsigned height, double fps, unsigned index_low,
+                          unsigned frame_cnt);
 
 int vmaf_write_output_json(VmafContext *vmaf, VmafFeatureCollector *fc,
-                           FILE *outfile, unsigned subsample, double fps,
-                           unsigned pic_cnt);
+                           FILE *outfile, const VmafSubsampler *subsampler,
+                           double fps, unsigned index_low, unsigned frame_cnt);
 
 int vmaf_write_output_csv(VmafFeatureCollector *fc, FILE *outfile,
-                           unsigned subsample);
+                           const VmafSubsampler *subsampler);
 
 int vmaf_write_output_sub(VmafFeatureCollector *fc, FILE *outfile,
-                          unsigned subsample);
+                          const VmafSubsampler *subsampler);
+
+/*
+ * Lossless dump of every feature score of pictures `index_low` up to
+ * `frame_cnt`, the pictures the scores cover, read back by
+ * `vmaf_import_feature_scores_from_path()`. Segments are checked for gaps
+ * and overlaps by these bounds, as subsampled pictures have no scores. In
+ * native byte order:
+ *
+ *     char magic[8]; uint32_t version, index_low, frame_cnt, n_features;
+ *     n_features times:
+ *         uint32_t name_len; char name[name_len];    // includes the NUL
+ *         uint32_t n_runs;
+ *         n_runs times:
+ *             uint32_t index, cnt; double score[cnt]; // consecutive frames
+ */
+#define VMAF_OUTPUT_BINARY_MAGIC "VMAFSCRS"
+#define VMAF_OUTPUT_BINARY_VERSION 2 ///< version 1 has no bounds
+
+int vmaf_write_output_binary(VmafFeatureCollector *fc, FILE *outfile,
+                             unsigned index_low, unsigned frame_cnt);
+
+/*
+ * Checkpoint of a context reading pictures in order, where `index` is the
+ * first picture whose scores are incomplete. `n_subsample` is the one the
+ * scores were selected with. In native byte order:
+ *
+ *     char magic[8]; uint32_t version, index, n_subsample;
+ *     the binary dump of the pictures below `index`
+ */
+#define VMAF_CHECKPOINT_MAGIC "VMAFCKPT"
+#define VMAF_CHECKPOINT_VERSION 1
+
+int vmaf_write_checkpoint_file(VmafFeatureCollector *fc, FILE *outfile,
+                               unsigned index, unsigned n_subsample);
 
 #endif /* __VMAF_OUTPUT_H__ */
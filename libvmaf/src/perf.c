@@ -0,0 +1,189 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem.h"
+#include "perf.h"
+
+#if VMAF_PERF_STATS
+
+/*
+ * Entries are only ever appended, and never move or get freed before
+ * vmaf_perf_destroy(), so vmaf_perf_record() finds them without the list
+ * lock. Each entry has its own lock, so only threads timing the same
+ * extractor contend.
+ */
+typedef struct PerfEntry {
+    pthread_mutex_t lock;
+    VmafPerfExtractorStats stats;
+    _Atomic(struct PerfEntry *) next;
+} PerfEntry;
+
+struct VmafPerf {
+    pthread_mutex_t lock; ///< serializes appends and snapshots
+    _Atomic(PerfEntry *) head;
+    PerfEntry *tail;
+    unsigned cnt;
+    VmafPerfExtractorStats *snapshot;
+    unsigned snapshot_capacity;
+    uint64_t bytes_allocated_at_init;
+};
+
+int vmaf_perf_init(VmafPerf **perf)
+{
+    if (!perf) return -EINVAL;
+
+    VmafPerf *const p = *perf = malloc(sizeof(*p));
+    if (!p) return -ENOMEM;
+    memset(p, 0, sizeof(*p));
+    atomic_init(&p->head, NULL);
+
+    vmaf_mem_count_bytes(true);
+    p->bytes_allocated_at_init = vmaf_mem_bytes_allocated();
+    pthread_mutex_init(&(p->lock), NULL);
+    return 0;
+}
+
+// extractor names are static strings, so pointers usually match
+static PerfEntry *find(PerfEntry *e, const char *name)
+{
+    for (; e; e = atomic_load_explicit(&e->next, memory_order_acquire)) {
+        if (e->stats.name == name || !strcmp(e->stats.name, name))
+            return e;
+    }
+    return NULL;
+}
+
+static PerfEntry *find_or_add(VmafPerf *perf, const char *name)
+{
+    PerfEntry *e =
+        find(atomic_load_explicit(&perf->head, memory_order_acquire), name);
+    if (e) return e;
+
+    pthread_mutex_lock(&(perf->lock));
+    // another thread may have added it in the meantime
+    e = find(atomic_load_explicit(&perf->head, memory_order_relaxed), name);
+    if (e) goto unlock;
+
+    e = malloc(sizeof(*e));
+    if (!e) goto unlock;
+    memset(e, 0, sizeof(*e));
+    pthread_mutex_init(&(e->lock), NULL);
+    e->stats.name = name;
+    atomic_init(&e->next, NULL);
+    if (perf->tail)
+        atomic_store_explicit(&perf->tail->next, e, memory_order_release);
+    else
+        atomic_store_explicit(&perf->head, e, memory_order_release);
+    perf->tail = e;
+    perf->cnt++;
+
+unlock:
+    pthread_mutex_unlock(&(perf->lock));
+    return e;
+}
+
+void vmaf_perf_record(VmafPerf *perf, const char *name,
+                      enum VmafPerfStage stage, uint64_t wall_ns,
+                      uint64_t cpu_ns)
+{
+    if (!perf) return;
+    if (!name) return;
+
+    PerfEntry *e = find_or_add(perf, name);
+    if (!e) return;
+
+    pthread_mutex_lock(&(e->lock));
+    switch (stage) {
+    case VMAF_PERF_STAGE_INIT:
+        vmaf_perf_timing_add(&e->stats.init, wall_ns, cpu_ns);
+        break;
+    case VMAF_PERF_STAGE_EXTRACT:
+        vmaf_perf_timing_add(&e->stats.extract, wall_ns, cpu_ns);
+        break;
+    case VMAF_PERF_STAGE_FLUSH:
+        vmaf_perf_timing_add(&e->stats.flush, wall_ns, cpu_ns);
+        break;
+    case VMAF_PERF_STAGE_POOL_WAIT:
+        vmaf_perf_timing_add(&e->stats.pool_wait, wall_ns, cpu_ns);
+        break;
+    }
+    pthread_mutex_unlock(&(e->lock));
+}
+
+int vmaf_perf_snapshot(VmafPerf *perf, VmafPerfStats *stats)
+{
+    if (!perf) return -EINVAL;
+    if (!stats) return -EINVAL;
+
+    int err = 0;
+    pthread_mutex_lock(&(perf->lock));
+
+    if (perf->snapshot_capacity < perf->cnt) {
+        VmafPerfExtractorStats *snapshot =
+            realloc(perf->snapshot, sizeof(*snapshot) * perf->cnt);
+        if (!snapshot) {
+            err = -ENOMEM;
+            goto unlock;
+        }
+        perf->snapshot = snapshot;
+        perf->snapshot_capacity = perf->cnt;
+    }
+
+    unsigned i = 0;
+    for (PerfEntry *e = atomic_load_explicit(&perf->head, memory_order_relaxed);
+         e; e = atomic_load_explicit(&e->next, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&(e->lock));
+        perf->snapshot[i++] = e->stats;
+        pthread_mutex_unlock(&(e->lock));
+    }
+
+    stats->extractor = perf->snapshot;
+    stats->n_extractors = perf->cnt;
+    stats->bytes_allocated =
+        vmaf_mem_bytes_allocated() - perf->bytes_allocated_at_init;
+
+unlock:
+    pthread_mutex_unlock(&(perf->lock));
+    return err;
+}
+
+void vmaf_perf_destroy(VmafPerf *perf)
+{
+    if (!perf) return;
+    PerfEntry *e = atomic_load_explicit(&perf->head, memory_order_relaxed);
+    while (e) {
+        PerfEntry *next = atomic_load_explicit(&e->next, memory_order_relaxed);
+        pthread_mutex_destroy(&(e->lock));
+        free(e);
+        e = next;
+    }
+    vmaf_mem_count_bytes(false);
+    pthread_mutex_destroy(&(perf->lock));
+    free(perf->snapshot);
+    free(perf);
+}
+
+#endif /* VMAF_PERF_STATS */
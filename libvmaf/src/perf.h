@@ -0,0 +1,138 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_SRC_PERF_H__
+#define __VMAF_SRC_PERF_H__
+
+#include <stdint.h>
+#include <time.h>
+
+#include "config.h"
+#include "libvmaf/libvmaf.h"
+
+/*
+ * Performance instrumentation, see `vmaf_get_perf_stats()`.
+ * With VMAF_PERF_STATS disabled the VMAF_PERF_* macros expand to nothing and
+ * none of the clock reads or counters below are compiled in.
+ */
+
+enum VmafPerfStage {
+    VMAF_PERF_STAGE_INIT = 0,
+    VMAF_PERF_STAGE_EXTRACT,
+    VMAF_PERF_STAGE_FLUSH,
+    VMAF_PERF_STAGE_POOL_WAIT,
+};
+
+typedef struct VmafPerf VmafPerf;
+
+typedef struct VmafPerfClock {
+    uint64_t wall_ns, cpu_ns;
+} VmafPerfClock;
+
+#if VMAF_PERF_STATS
+
+static inline uint64_t vmaf_perf_wall_ns(void)
+{
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint64_t vmaf_perf_cpu_ns(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+static inline void vmaf_perf_timing_add(VmafPerfTiming *t, uint64_t wall_ns,
+                                        uint64_t cpu_ns)
+{
+    t->count++;
+    t->wall_ns += wall_ns;
+    t->cpu_ns += cpu_ns;
+    if (wall_ns > t->max_wall_ns)
+        t->max_wall_ns = wall_ns;
+
+    unsigned bin = 0;
+    for (uint64_t us = wall_ns / 1000; us && bin < VMAF_PERF_HISTOGRAM_BINS - 1;
+         us >>= 1)
+    {
+        bin++;
+    }
+    t->histogram[bin]++;
+}
+
+int vmaf_perf_init(VmafPerf **perf);
+
+void vmaf_perf_record(VmafPerf *perf, const char *name,
+                      enum VmafPerfStage stage, uint64_t wall_ns,
+                      uint64_t cpu_ns);
+
+/**
+ * Fills `extractor`, `n_extractors` and `bytes_allocated` of `stats`.
+ * The extractor array is owned by `perf`.
+ */
+int vmaf_perf_snapshot(VmafPerf *perf, VmafPerfStats *stats);
+
+void vmaf_perf_destroy(VmafPerf *perf);
+
+static inline VmafPerfClock vmaf_perf_clock_start(VmafPerf *perf,
+                                                  enum VmafPerfStage stage)
+{
+    VmafPerfClock clk = { 0 };
+    if (!perf) return clk;
+    clk.wall_ns = vmaf_perf_wall_ns();
+    if (stage != VMAF_PERF_STAGE_POOL_WAIT)
+        clk.cpu_ns = vmaf_perf_cpu_ns();
+    return clk;
+}
+
+static inline void vmaf_perf_clock_stop(VmafPerf *perf, VmafPerfClock *clk,
+                                        const char *name,
+                                        enum VmafPerfStage stage)
+{
+    if (!perf) return;
+    const uint64_t wall_ns = vmaf_perf_wall_ns() - clk->wall_ns;
+    const uint64_t cpu_ns = stage != VMAF_PERF_STAGE_POOL_WAIT ?
+                            vmaf_perf_cpu_ns() - clk->cpu_ns : 0;
+    vmaf_perf_record(perf, name, stage, wall_ns, cpu_ns);
+}
+
+#define VMAF_PERF_BEGIN(perf, clk, stage) \
+    VmafPerfClock clk = vmaf_perf_clock_start(perf, stage)
+
+#define VMAF_PERF_END(perf, clk, name, stage) \
+    vmaf_perf_clock_stop(perf, &(clk), name, stage)
+
+#else
+
+#define VMAF_PERF_BEGIN(perf, clk, stage)
+#define VMAF_PERF_END(perf, clk, name, stage)
+
+#endif /* VMAF_PERF_STATS */
+
+#endif /* __VMAF_SRC_PERF_H__ */
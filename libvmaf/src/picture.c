@@ -53,9 +53,77 @@ int vmaf_picture_priv_init(VmafPicture *pic)
     pic->priv = malloc(priv_sz);
     if (!pic->priv) return -EINVAL;
     memset(pic->priv, 0, priv_sz);
+    VmafPicturePrivate *priv = pic->priv;
+    pthread_mutex_init(&priv->derived.lock, NULL);
+    pthread_cond_init(&priv->derived.produced, NULL);
     return 0;
 }
 
+static void picture_priv_close(VmafPicturePrivate *priv)
+{
+    for (unsigned i = 0; i < priv->derived.cnt; i++)
+        aligned_free(priv->derived.plane[i].data);
+    pthread_cond_destroy(&priv->derived.produced);
+    pthread_mutex_destroy(&priv->derived.lock);
+    free(priv);
+}
+
+int vmaf_picture_get_derived(VmafPicture *pic,
+                             enum VmafPictureDerivedType type, int offset,
+                             size_t row_size, VmafPictureDeriveCallback derive,
+                             const void **data, ptrdiff_t *stride)
+{
+    if (!pic) return -EINVAL;
+    if (!pic->priv) return -EINVAL;
+    if (!derive) return -EINVAL;
+    if (!data || !stride) return -EINVAL;
+
+    VmafPicturePrivate *priv = pic->priv;
+    VmafPictureDerived *plane = NULL;
+    int err = 0;
+
+    pthread_mutex_lock(&priv->derived.lock);
+    for (unsigned i = 0; i < priv->derived.cnt; i++) {
+        VmafPictureDerived *p = &priv->derived.plane[i];
+        if (p->type != type || p->offset != offset) continue;
+        while (!p->ready)
+            pthread_cond_wait(&priv->derived.produced, &priv->derived.lock);
+        err = p->err;
+        *data = p->data;
+        *stride = p->stride;
+        pthread_mutex_unlock(&priv->derived.lock);
+        return err;
+    }
+    if (priv->derived.cnt == VMAF_PICTURE_DERIVED_MAX) {
+        pthread_mutex_unlock(&priv->derived.lock);
+        return -ENOMEM;
+    }
+    plane = &priv->derived.plane[priv->derived.cnt++];
+    memset(plane, 0, sizeof(*plane));
+    plane->type = type;
+    plane->offset = offset;
+    pthread_mutex_unlock(&priv->derived.lock);
+
+    const ptrdiff_t plane_stride = ALIGN_CEIL(row_size);
+    void *plane_data = aligned_malloc(plane_stride * pic->h[0], MAX_ALIGN);
+    if (!plane_data)
+        err = -ENOMEM;
+    else
+        err = derive(pic, plane_data, plane_stride, offset);
+
+    pthread_mutex_lock(&priv->derived.lock);
+    plane->data = plane_data;
+    plane->stride = plane_stride;
+    plane->err = err;
+    plane->ready = 1;
+    pthread_cond_broadcast(&priv->derived.produced);
+    pthread_mutex_unlock(&priv->derived.lock);
+
+    *data = plane_data;
+    *stride = plane_stride;
+    return err;
+}
+
 int vmaf_picture_alloc(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
                        unsigned bpc, unsigned w, unsigned h)
 {
@@ -105,7 +173,7 @@ int vmaf_picture_alloc(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
     return 0;
 
 free_priv:
-    free(pic->priv);
+    picture_priv_close(pic->priv);
 free_data:
     aligned_free(data);
 fail:
@@ -126,9 +194,9 @@ int vmaf_picture_unref(VmafPicture *pic) {
 
     const long old_cnt = vmaf_ref_fetch_decrement(pic->ref);
     if (old_cnt == 1) {
-        const VmafPicturePrivate *priv = pic->priv;
+        VmafPicturePrivate *priv = pic->priv;
         priv->release_picture(pic, priv->cookie);
-        free(pic->priv);
+        picture_priv_close(pic->priv);
         vmaf_ref_close(pic->ref);
     }
     memset(pic, 0, sizeof(*pic));
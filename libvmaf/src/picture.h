@@ -23,6 +23,10 @@
 #include <ffnvcodec/dynlink_cuda.h>
 #include "libvmaf/libvmaf_cuda.h"
 #endif
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "libvmaf/picture.h"
 
 enum VmafPictureBufferType {
@@ -31,6 +35,24 @@ enum VmafPictureBufferType {
     VMAF_PICTURE_BUFFER_TYPE_CUDA_DEVICE,
 };
 
+enum VmafPictureDerivedType {
+    VMAF_PICTURE_DERIVED_FLOAT_LUMA = 0,
+};
+
+#define VMAF_PICTURE_DERIVED_MAX 4
+
+typedef struct VmafPictureDerived {
+    enum VmafPictureDerivedType type;
+    int offset;
+    void *data;
+    ptrdiff_t stride;
+    int err;
+    int ready;
+} VmafPictureDerived;
+
+typedef int (*VmafPictureDeriveCallback)(VmafPicture *pic, void *dst,
+                                         ptrdiff_t dst_stride, int offset);
+
 typedef struct VmafPicturePrivate {
     void *cookie;
     int (*release_picture)(VmafPicture *pic, void *cookie);
@@ -43,6 +65,17 @@ typedef struct VmafPicturePrivate {
     } cuda;
 #endif
     enum VmafPictureBufferType buf_type;
+    struct {
+        pthread_mutex_t lock;
+        pthread_cond_t produced;
+        unsigned cnt;
+        VmafPictureDerived plane[VMAF_PICTURE_DERIVED_MAX];
+    } derived;
+    struct {
+        int valid; ///< guarded by derived.lock
+        uint64_t value[2];
+    } hash;
+    int unchanged; ///< identical to the previous picture, set on read
 } VmafPicturePrivate;
 
 int vmaf_picture_priv_init(VmafPicture *pic);
@@ -52,4 +85,17 @@ int vmaf_picture_ref(VmafPicture *dst, VmafPicture *src);
 int vmaf_picture_set_release_callback(VmafPicture *pic, void *cookie,
                         int (*release_picture)(VmafPicture *pic, void *cookie));
 
+/**
+ * Get a plane derived from `pic`, e.g. the luma plane converted to float.
+ * Derived planes are keyed by (`type`, `offset`) and shared by every
+ * reference to `pic`: the first caller produces the plane with `derive`,
+ * concurrent callers wait for it, and later callers reuse it. The plane is
+ * `row_size` bytes wide (padded to `MAX_ALIGN`), `pic->h[0]` rows high, and
+ * is freed together with the picture.
+ */
+int vmaf_picture_get_derived(VmafPicture *pic,
+                             enum VmafPictureDerivedType type, int offset,
+                             size_t row_size, VmafPictureDeriveCallback derive,
+                             const void **data, ptrdiff_t *stride);
+
 #endif /* __VMAF_SRC_PICTURE_H__ */
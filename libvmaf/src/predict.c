@@ -18,6 +18,7 @@
 
 #include <errno.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -224,6 +225,51 @@ static int clip(const VmafModel *model, double *prediction,
     return 0;
 }
 
+char *vmaf_predict_feature_name(VmafModel *model, unsigned i)
+{
+    if (!model) return NULL;
+    if (i >= model->n_features) return NULL;
+
+    VmafFeatureExtractor *fex =
+        vmaf_get_feature_extractor_by_feature_name(model->feature[i].name, 0);
+
+    if (!fex) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "vmaf_predict_score_at_index(): no feature extractor "
+                 "providing feature '%s'\n", model->feature[i].name);
+        return NULL;
+    }
+
+    VmafDictionary *opts_dict = NULL;
+    if (model->feature[i].opts_dict) {
+        int err = vmaf_dictionary_copy(&model->feature[i].opts_dict, &opts_dict);
+        if (err) return NULL;
+    }
+
+    VmafFeatureExtractorContext *fex_ctx;
+    int err = vmaf_feature_extractor_context_create(&fex_ctx, fex, opts_dict);
+    if (err) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "vmaf_predict_score_at_index(): could not generate "
+                 "feature extractor context\n");
+        vmaf_dictionary_free(&opts_dict);
+        return NULL;
+    }
+
+    char *feature_name =
+        vmaf_feature_name_from_options(model->feature[i].name,
+                fex_ctx->fex->options, fex_ctx->fex->priv);
+
+    vmaf_feature_extractor_context_destroy(fex_ctx);
+
+    if (!feature_name) {
+        vmaf_log(VMAF_LOG_LEVEL_ERROR,
+                 "vmaf_predict_score_at_index(): could not generate "
+                 "feature name\n");
+    }
+    return feature_name;
+}
+
 int vmaf_predict_score_at_index(VmafModel *model,
                                 VmafFeatureCollector *feature_collector,
                                 unsigned index, double *vmaf_score,
@@ -241,44 +287,9 @@ int vmaf_predict_score_at_index(VmafModel *model,
     if (!node) return -ENOMEM;
 
     for (unsigned i = 0; i < model->n_features; i++) {
-        VmafFeatureExtractor *fex =
-            vmaf_get_feature_extractor_by_feature_name(model->feature[i].name, 0);
-
-        if (!fex) {
-            vmaf_log(VMAF_LOG_LEVEL_ERROR,
-                     "vmaf_predict_score_at_index(): no feature extractor "
-                     "providing feature '%s'\n", model->feature[i].name);
-            err = -EINVAL;
-            goto free_node;
-        }
-
-        VmafDictionary *opts_dict = NULL;
-        if (model->feature[i].opts_dict) {
-            err = vmaf_dictionary_copy(&model->feature[i].opts_dict, &opts_dict);
-            if (err) return err;
-        }
-
-        VmafFeatureExtractorContext *fex_ctx;
-        err = vmaf_feature_extractor_context_create(&fex_ctx, fex, opts_dict);
-        if (err) {
-            vmaf_log(VMAF_LOG_LEVEL_ERROR,
-                     "vmaf_predict_score_at_index(): could not generate "
-                     "feature extractor context\n");
-            vmaf_dictionary_free(&opts_dict);
-            return err;
-        }
-
-        char *feature_name =
-            vmaf_feature_name_from_options(model->feature[i].name,
-                    fex_ctx->fex->options, fex_ctx->fex->priv);
-
-        vmaf_feature_extractor_context_destroy(fex_ctx);
-
+        char *feature_name = vmaf_predict_feature_name(model, i);
         if (!feature_name) {
-            vmaf_log(VMAF_LOG_LEVEL_ERROR,
-                     "vmaf_predict_score_at_index(): could not generate "
-                     "feature name\n");
-            err = -ENOMEM;
+            err = -EINVAL;
             goto free_node;
         }
 
@@ -351,6 +362,51 @@ static double percentile(double *scores, unsigned n_scores, double perc)
         scores[idx_l] * (idx_r - p) + scores[idx_r] * (p - idx_l);
 }
 
+int vmaf_bootstrap_ratio_ci(const double *num, const double *den,
+                            unsigned cnt, unsigned stratum,
+                            unsigned n_resample, double *lo, double *hi)
+{
+    if (!num) return -EINVAL;
+    if (!den) return -EINVAL;
+    if (stratum < 2) return -EINVAL;
+    if (cnt < stratum) return -EINVAL;
+    if (!n_resample) return -EINVAL;
+    if (!lo) return -EINVAL;
+    if (!hi) return -EINVAL;
+
+    double *ratio = malloc(sizeof(*ratio) * n_resample);
+    if (!ratio) return -ENOMEM;
+
+    // xorshift64, fixed seed so that the interval is reproducible
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (unsigned i = 0; i < n_resample; i++) {
+        double sum_num = 0., sum_den = 0.;
+        for (unsigned s = 0; s < cnt; s += stratum) {
+            // the remainder goes with the last stratum
+            const unsigned n = cnt - s < 2 * stratum ? cnt - s : stratum;
+            // rescaled, n - 1 draws keep the variance of the mean unbiased
+            const double w = (double) n / (n - 1);
+            for (unsigned j = 0; j < n - 1; j++) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                const unsigned k = s + x % n;
+                sum_num += w * num[k];
+                sum_den += w * den[k];
+            }
+            s += n - stratum;
+        }
+        ratio[i] = sum_num / sum_den;
+    }
+
+    qsort(ratio, n_resample, sizeof(double), score_compare);
+    *lo = percentile(ratio, n_resample, 2.5);
+    *hi = percentile(ratio, n_resample, 97.5);
+
+    free(ratio);
+    return 0;
+}
+
 static int vmaf_bootstrap_predict_score_at_index(
                                         VmafModelCollection *model_collection,
                                         VmafFeatureCollector *feature_collector,
@@ -22,6 +22,13 @@
 #include "feature/feature_collector.h"
 #include "model.h"
 
+/**
+ * Name under which `model->feature[i]` is stored in the feature collector,
+ * i.e. with the model's extractor options applied. Returns NULL on error,
+ * the caller frees the name.
+ */
+char *vmaf_predict_feature_name(VmafModel *model, unsigned i);
+
 int vmaf_predict_score_at_index(VmafModel *model,
                                 VmafFeatureCollector *feature_collector,
                                 unsigned index, double *vmaf_score,
@@ -35,4 +42,16 @@ int vmaf_predict_score_at_index_model_collection(
                                 unsigned index,
                                 VmafModelCollectionScore *score);
 
+/**
+ * 95% bootstrap confidence interval of `sum(num) / sum(den)` over `cnt`
+ * clusters, from `n_resample` resamplings of the clusters with replacement.
+ * Consecutive clusters are grouped into strata of `stratum` clusters, the
+ * remainder joining the last, and resampled within each stratum. Pass
+ * `stratum` = `cnt` for an unstratified interval. Resampling is seeded, so
+ * the interval is reproducible.
+ */
+int vmaf_bootstrap_ratio_ci(const double *num, const double *den,
+                            unsigned cnt, unsigned stratum,
+                            unsigned n_resample, double *lo, double *hi);
+
 #endif /* __VMAF_PREDICT_H__ */
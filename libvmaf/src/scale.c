@@ -0,0 +1,326 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "cpu.h"
+#include "mem.h"
+#include "scale.h"
+
+#if ARCH_X86
+#include "feature/x86/scale_avx2.h"
+#elif ARCH_AARCH64
+#include "feature/arm64/scale_neon.h"
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define BICUBIC_C 0.6 ///< B = 0, as the default bicubic of ffmpeg's scaler
+#define LANCZOS_A 3
+
+typedef struct ScaleAxis {
+    unsigned src, dst;
+    unsigned taps;
+    int32_t *pos; ///< first source sample, per output sample
+    float *coef; ///< tap major
+    unsigned stride; ///< of coef, dst rounded up to a multiple of 8
+} ScaleAxis;
+
+typedef struct VmafScaler {
+    enum VmafScaleFilter filter;
+    ScaleAxis hor[2], ver[2]; ///< luma and chroma
+    float *row; ///< padded source row
+    size_t row_sz;
+    float *ring; ///< horizontally filtered rows
+    size_t ring_sz;
+    int *ring_row; ///< source row held by each ring slot
+    unsigned ring_cnt;
+    void (*scale_h)(const float *src, float *dst, unsigned w,
+                    const int32_t *pos, const float *coef,
+                    ptrdiff_t coef_stride, unsigned taps);
+    void (*scale_v)(const float *const *src, const float *coef,
+                    unsigned taps, void *dst, unsigned w, unsigned bpc);
+} VmafScaler;
+
+int vmaf_scaler_init(VmafScaler **scaler, enum VmafScaleFilter filter)
+{
+    if (!scaler) return -EINVAL;
+    if (filter != VMAF_SCALE_FILTER_BICUBIC &&
+        filter != VMAF_SCALE_FILTER_BILINEAR &&
+        filter != VMAF_SCALE_FILTER_LANCZOS)
+    {
+        return -EINVAL;
+    }
+
+    VmafScaler *const s = *scaler = malloc(sizeof(*s));
+    if (!s) return -ENOMEM;
+    memset(s, 0, sizeof(*s));
+    s->filter = filter;
+    s->scale_h = vmaf_scale_h_c;
+    s->scale_v = vmaf_scale_v_c;
+
+#if ARCH_X86
+    if (vmaf_get_cpu_flags() & VMAF_X86_CPU_FLAG_AVX2) {
+        s->scale_h = vmaf_scale_h_avx2;
+        s->scale_v = vmaf_scale_v_avx2;
+    }
+#elif ARCH_AARCH64
+    if (vmaf_get_cpu_flags() & VMAF_ARM_CPU_FLAG_NEON) {
+        s->scale_h = vmaf_scale_h_neon;
+        s->scale_v = vmaf_scale_v_neon;
+    }
+#endif
+
+    return 0;
+}
+
+static double filter_support(enum VmafScaleFilter filter)
+{
+    switch (filter) {
+    case VMAF_SCALE_FILTER_BILINEAR:
+        return 1.;
+    case VMAF_SCALE_FILTER_LANCZOS:
+        return LANCZOS_A;
+    default:
+        return 2.;
+    }
+}
+
+static double filter_weight(enum VmafScaleFilter filter, double x)
+{
+    x = fabs(x);
+    switch (filter) {
+    case VMAF_SCALE_FILTER_BILINEAR:
+        return x < 1. ? 1. - x : 0.;
+    case VMAF_SCALE_FILTER_LANCZOS:
+        if (x < 1e-9) return 1.;
+        if (x >= LANCZOS_A) return 0.;
+        return LANCZOS_A * sin(M_PI * x) * sin(M_PI * x / LANCZOS_A) /
+               (M_PI * M_PI * x * x);
+    default: {
+        const double c = BICUBIC_C;
+        if (x < 1.) return ((2. - c) * x - (3. - c)) * x * x + 1.;
+        if (x < 2.) return ((-c * x + 5. * c) * x - 8. * c) * x + 4. * c;
+        return 0.;
+    }
+    }
+}
+
+static void axis_close(ScaleAxis *axis)
+{
+    aligned_free(axis->pos);
+    aligned_free(axis->coef);
+    memset(axis, 0, sizeof(*axis));
+}
+
+/*
+ * Sample centers are aligned, so a source sample at `x` maps to
+ * `(x + 0.5) * dst / src - 0.5`. When downscaling the filter is stretched
+ * to cover the source samples between output samples.
+ */
+static int axis_init(ScaleAxis *axis, enum VmafScaleFilter filter,
+                     unsigned src, unsigned dst)
+{
+    if (axis->src == src && axis->dst == dst) return 0;
+    axis_close(axis);
+
+    const double ratio = (double) src / dst;
+    const double stretch = ratio > 1. ? ratio : 1.;
+    const double support = filter_support(filter) * stretch;
+    axis->taps = ceil(2. * support);
+    axis->stride = (dst + 7) & ~7u;
+    axis->pos = aligned_malloc(sizeof(*axis->pos) * axis->stride, 32);
+    axis->coef =
+        aligned_malloc(sizeof(*axis->coef) * axis->stride * axis->taps, 32);
+    if (!axis->pos || !axis->coef) {
+        axis_close(axis);
+        return -ENOMEM;
+    }
+    memset(axis->pos, 0, sizeof(*axis->pos) * axis->stride);
+    memset(axis->coef, 0, sizeof(*axis->coef) * axis->stride * axis->taps);
+
+    double weight[axis->taps];
+    for (unsigned x = 0; x < dst; x++) {
+        const double center = (x + 0.5) * ratio - 0.5;
+        const int first = (int) floor(center - support) + 1;
+        double sum = 0.;
+        for (unsigned k = 0; k < axis->taps; k++) {
+            weight[k] = filter_weight(filter, (first + k - center) / stretch);
+            sum += weight[k];
+        }
+        axis->pos[x] = first;
+        for (unsigned k = 0; k < axis->taps; k++)
+            axis->coef[k * axis->stride + x] = weight[k] / sum;
+    }
+
+    axis->src = src;
+    axis->dst = dst;
+    return 0;
+}
+
+static int grow(void **buf, size_t *sz, size_t new_sz)
+{
+    if (new_sz <= *sz) return 0;
+    aligned_free(*buf);
+    *buf = aligned_malloc(new_sz, 32);
+    *sz = *buf ? new_sz : 0;
+    return *buf ? 0 : -ENOMEM;
+}
+
+void vmaf_scale_h_c(const float *src, float *dst, unsigned w,
+                    const int32_t *pos, const float *coef,
+                    ptrdiff_t coef_stride, unsigned taps)
+{
+    for (unsigned x = 0; x < w; x++) {
+        float sum = 0.f;
+        for (unsigned k = 0; k < taps; k++)
+            sum += src[pos[x] + (int) k] * coef[k * coef_stride + x];
+        dst[x] = sum;
+    }
+}
+
+void vmaf_scale_v_c(const float *const *src, const float *coef,
+                    unsigned taps, void *dst, unsigned w, unsigned bpc)
+{
+    const float max = (1 << bpc) - 1;
+    for (unsigned x = 0; x < w; x++) {
+        float sum = 0.f;
+        for (unsigned k = 0; k < taps; k++)
+            sum += src[k][x] * coef[k];
+        sum = sum < 0.f ? 0.f : sum > max ? max : sum;
+        if (bpc == 8)
+            ((uint8_t *) dst)[x] = lrintf(sum);
+        else
+            ((uint16_t *) dst)[x] = lrintf(sum);
+    }
+}
+
+static void load_row(float *row, const VmafPicture *src, unsigned plane,
+                     unsigned y, unsigned pad)
+{
+    const unsigned w = src->w[plane];
+    const uint8_t *data =
+        (const uint8_t *) src->data[plane] + y * src->stride[plane];
+
+    if (src->bpc == 8) {
+        for (unsigned x = 0; x < w; x++)
+            row[pad + x] = data[x];
+    } else {
+        const uint16_t *data16 = (const uint16_t *) data;
+        for (unsigned x = 0; x < w; x++)
+            row[pad + x] = data16[x];
+    }
+
+    // edges are repeated
+    for (unsigned x = 0; x < pad; x++) {
+        row[x] = row[pad];
+        row[pad + w + x] = row[pad + w - 1];
+    }
+}
+
+static int scale_plane(VmafScaler *s, VmafPicture *dst, const VmafPicture *src,
+                       unsigned plane)
+{
+    ScaleAxis *hor = &s->hor[!!plane];
+    ScaleAxis *ver = &s->ver[!!plane];
+    int err = 0;
+    err |= axis_init(hor, s->filter, src->w[plane], dst->w[plane]);
+    err |= axis_init(ver, s->filter, src->h[plane], dst->h[plane]);
+    if (err) return err;
+
+    // pad so that any tap of the first or last output sample is in the row
+    const unsigned pad = hor->taps + 1;
+    err |= grow((void **) &s->row, &s->row_sz,
+                sizeof(float) * (src->w[plane] + 2 * pad));
+    err |= grow((void **) &s->ring, &s->ring_sz,
+                sizeof(float) * hor->stride * ver->taps);
+    if (err) return err;
+    if (s->ring_cnt < ver->taps) {
+        int *ring_row = realloc(s->ring_row, sizeof(*ring_row) * ver->taps);
+        if (!ring_row) return -ENOMEM;
+        s->ring_row = ring_row;
+        s->ring_cnt = ver->taps;
+    }
+    for (unsigned i = 0; i < ver->taps; i++)
+        s->ring_row[i] = -1;
+
+    const float *rows[ver->taps];
+    float coef[ver->taps];
+    const int last = src->h[plane] - 1;
+    for (unsigned y = 0; y < dst->h[plane]; y++) {
+        // output rows need consecutive source rows, as many as the ring holds
+        for (unsigned k = 0; k < ver->taps; k++) {
+            int r = ver->pos[y] + (int) k;
+            r = r < 0 ? 0 : r > last ? last : r;
+            const unsigned slot = r % ver->taps;
+            float *ring = s->ring + slot * hor->stride;
+            if (s->ring_row[slot] != r) {
+                load_row(s->row, src, plane, r, pad);
+                s->scale_h(s->row + pad, ring, dst->w[plane], hor->pos,
+                           hor->coef, hor->stride, hor->taps);
+                s->ring_row[slot] = r;
+            }
+            rows[k] = ring;
+            coef[k] = ver->coef[k * ver->stride + y];
+        }
+
+        uint8_t *out = (uint8_t *) dst->data[plane] + y * dst->stride[plane];
+        s->scale_v(rows, coef, ver->taps, out, dst->w[plane], dst->bpc);
+    }
+
+    return 0;
+}
+
+int vmaf_scaler_scale(VmafScaler *scaler, VmafPicture *dst,
+                      const VmafPicture *src)
+{
+    if (!scaler) return -EINVAL;
+    if (!dst || !src) return -EINVAL;
+    if (dst->pix_fmt != src->pix_fmt) return -EINVAL;
+    if (dst->bpc != src->bpc) return -EINVAL;
+
+    for (unsigned i = 0; i < 3; i++) {
+        if (!src->w[i] || !src->h[i] || !dst->w[i] || !dst->h[i])
+            continue;
+        int err = scale_plane(scaler, dst, src, i);
+        if (err) return err;
+    }
+
+    return 0;
+}
+
+void vmaf_scaler_destroy(VmafScaler *scaler)
+{
+    if (!scaler) return;
+    for (unsigned i = 0; i < 2; i++) {
+        axis_close(&scaler->hor[i]);
+        axis_close(&scaler->ver[i]);
+    }
+    aligned_free(scaler->row);
+    aligned_free(scaler->ring);
+    free(scaler->ring_row);
+    free(scaler);
+}
@@ -0,0 +1,63 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_SRC_SCALE_H__
+#define __VMAF_SRC_SCALE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libvmaf/libvmaf.h"
+#include "libvmaf/picture.h"
+
+/*
+ * Separable picture scaler, for scoring a distorted picture against a
+ * reference of another size. Each plane is filtered horizontally into a
+ * ring of float rows, which are then filtered vertically, rounded and
+ * clipped. Filter positions and coefficients are kept for the last sizes
+ * scaled, as every picture of a video has the same size.
+ */
+
+typedef struct VmafScaler VmafScaler;
+
+int vmaf_scaler_init(VmafScaler **scaler, enum VmafScaleFilter filter);
+
+/**
+ * Scale `src` to the size of `dst`, which has the same pixel format and
+ * bitdepth. Not thread safe, a scaler is used by one reader at a time.
+ */
+int vmaf_scaler_scale(VmafScaler *scaler, VmafPicture *dst,
+                      const VmafPicture *src);
+
+void vmaf_scaler_destroy(VmafScaler *scaler);
+
+/*
+ * Kernels. Coefficients are tap major, `coef_stride` apart. The horizontal
+ * pass reads `src[pos[x] + k]`, so `src` is padded at both ends. The
+ * vertical pass reads the `taps` rows in `src` and writes 8 or 16-bit
+ * samples.
+ */
+
+void vmaf_scale_h_c(const float *src, float *dst, unsigned w,
+                    const int32_t *pos, const float *coef,
+                    ptrdiff_t coef_stride, unsigned taps);
+
+void vmaf_scale_v_c(const float *const *src, const float *coef,
+                    unsigned taps, void *dst, unsigned w, unsigned bpc);
+
+#endif /* __VMAF_SRC_SCALE_H__ */
@@ -0,0 +1,284 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "subsample.h"
+
+#define GRID 4 ///< difference sample spacing, in luma pixels
+
+// mean absolute differences, in 8-bit levels
+#define MOTION_LOW 1.0 ///< and below, the longest stride
+#define MOTION_HIGH 12.0 ///< and above, every frame
+#define CUT_MIN 20.0
+#define CUT_RATIO 4.0 ///< times the recent average motion
+#define CUT_DENSE 2 ///< frames scored after a cut
+#define DRIFT_MIN 0.5
+#define DRIFT_RATIO 0.2
+
+typedef struct VmafSubsampler {
+    unsigned n_subsample;
+    bool adaptive;
+    uint8_t *selected;
+    unsigned capacity;
+    unsigned cnt; ///< frames seen
+    double credit; ///< fraction of a stride since the last scored frame
+    double motion_avg;
+    double diff; ///< reference to distorted difference of the last scored
+    unsigned dense;
+} VmafSubsampler;
+
+int vmaf_subsampler_init(VmafSubsampler **subsampler, unsigned n_subsample,
+                         bool adaptive)
+{
+    if (!subsampler) return -EINVAL;
+
+    VmafSubsampler *const s = *subsampler = malloc(sizeof(*s));
+    if (!s) return -ENOMEM;
+    memset(s, 0, sizeof(*s));
+    s->n_subsample = n_subsample ? n_subsample : 1;
+    s->adaptive = adaptive;
+    return 0;
+}
+
+static double mean_abs_diff(const VmafPicture *a, const VmafPicture *b)
+{
+    const unsigned w = a->w[0], h = a->h[0];
+    uint64_t sum = 0, cnt = 0;
+
+    for (unsigned y = GRID / 2; y < h; y += GRID) {
+        if (a->bpc == 8) {
+            const uint8_t *pa = (uint8_t *) a->data[0] + y * a->stride[0];
+            const uint8_t *pb = (uint8_t *) b->data[0] + y * b->stride[0];
+            for (unsigned x = GRID / 2; x < w; x += GRID)
+                sum += abs(pa[x] - pb[x]);
+        } else {
+            const uint16_t *pa =
+                (uint16_t *) ((uint8_t *) a->data[0] + y * a->stride[0]);
+            const uint16_t *pb =
+                (uint16_t *) ((uint8_t *) b->data[0] + y * b->stride[0]);
+            for (unsigned x = GRID / 2; x < w; x += GRID)
+                sum += abs(pa[x] - pb[x]);
+        }
+        cnt += (w - GRID / 2 + GRID - 1) / GRID;
+    }
+
+    if (!cnt) return 0.;
+    return (double) sum / cnt / (1 << (a->bpc - 8));
+}
+
+static bool select_adaptive(VmafSubsampler *s, const VmafPicture *prev_ref,
+                            const VmafPicture *ref, const VmafPicture *dist)
+{
+    if (!ref || !dist) {
+        s->credit += 1. / s->n_subsample;
+        if (s->cnt > 1 && s->credit < 1.) return false;
+        s->credit = 0.;
+        return true;
+    }
+
+    const double motion = prev_ref ? mean_abs_diff(prev_ref, ref) : 0.;
+    const double diff = mean_abs_diff(ref, dist);
+
+    const bool cut = prev_ref && motion > CUT_MIN &&
+                     motion > CUT_RATIO * s->motion_avg;
+    s->motion_avg = s->cnt > 1 ? 0.9 * s->motion_avg + 0.1 * motion : motion;
+
+    double t = (motion - MOTION_LOW) / (MOTION_HIGH - MOTION_LOW);
+    t = t < 0. ? 0. : t > 1. ? 1. : t;
+    s->credit += 1. / pow(s->n_subsample, 1. - t);
+
+    bool selected = s->cnt == 1 || s->credit >= 1. - 1e-9 ||
+                    fabs(diff - s->diff) > fmax(DRIFT_MIN, DRIFT_RATIO * s->diff);
+    if (cut) {
+        s->dense = CUT_DENSE;
+        selected = true;
+    } else if (s->dense) {
+        s->dense--;
+        selected = true;
+    }
+
+    if (selected) {
+        s->credit = 0.;
+        s->diff = diff;
+    }
+    return selected;
+}
+
+int vmaf_subsampler_select(VmafSubsampler *subsampler,
+                           const VmafPicture *prev_ref, const VmafPicture *ref,
+                           const VmafPicture *dist, unsigned index,
+                           bool *selected)
+{
+    if (!subsampler) return -EINVAL;
+    if (!selected) return -EINVAL;
+
+    VmafSubsampler *const s = subsampler;
+    s->cnt++;
+    if (!s->adaptive) {
+        *selected = !(index % s->n_subsample);
+        return 0;
+    }
+
+    if (index >= s->capacity) {
+        unsigned capacity = s->capacity ? s->capacity : 1024;
+        while (index >= capacity) capacity *= 2;
+        uint8_t *sel = realloc(s->selected, capacity);
+        if (!sel) return -ENOMEM;
+        memset(sel + s->capacity, 0, capacity - s->capacity);
+        s->selected = sel;
+        s->capacity = capacity;
+    }
+
+    *selected = select_adaptive(s, prev_ref, ref, dist);
+    s->selected[index] = *selected;
+    return 0;
+}
+
+bool vmaf_subsampler_selected(const VmafSubsampler *subsampler,
+                              unsigned index)
+{
+    if (!subsampler) return true;
+    if (!subsampler->adaptive)
+        return !(index % subsampler->n_subsample);
+    return index < subsampler->capacity && subsampler->selected[index];
+}
+
+bool vmaf_subsampler_adaptive(const VmafSubsampler *subsampler)
+{
+    return subsampler && subsampler->adaptive;
+}
+
+int vmaf_subsample_pool(const double *score, const bool *written,
+                        unsigned cnt, enum VmafPoolingMethod pool_method,
+                        double *pooled, double *error)
+{
+    if (!score) return -EINVAL;
+    if (!written) return -EINVAL;
+    if (!pooled) return -EINVAL;
+    if (!error) return -EINVAL;
+
+    // frame to frame variation, from consecutively scored frames
+    double sq_sum = 0.;
+    unsigned pairs = 0, n_written = 0;
+    for (unsigned i = 0; i < cnt; i++) {
+        n_written += written[i];
+        if (i && written[i] && written[i - 1]) {
+            const double d = score[i] - score[i - 1];
+            sq_sum += d * d;
+            pairs++;
+        }
+    }
+    if (!n_written) return -EINVAL;
+    const double jitter = pairs ? sqrt(sq_sum / (2. * pairs)) : 0.;
+
+    // past either end, the closest pair of scored frames bounds the error
+    unsigned first = 0, last = cnt - 1;
+    while (!written[first]) first++;
+    while (!written[last]) last--;
+    unsigned second = first, second_last = last;
+    for (unsigned i = first + 1; i < cnt; i++) {
+        if (written[i]) {
+            second = i;
+            break;
+        }
+    }
+    for (unsigned i = last; i-- > 0;) {
+        if (written[i]) {
+            second_last = i;
+            break;
+        }
+    }
+
+    // errors within a run of interpolated frames add up, across runs they
+    // are taken as independent
+    double sum = 0., i_sum = 0., min = 0., max = 0.;
+    double gap_err = 0., gap_i_err = 0., err_sq = 0., err_i_sq = 0.;
+    double low = 0., high = 0.;
+    bool interpolated = false;
+    unsigned a = first, b = first; ///< scored frames around i
+    for (unsigned i = 0; i < cnt; i++) {
+        double v = written[i] ? score[i] : 0., u = 0.;
+        if (written[i]) {
+            a = i;
+        } else if (i < first) {
+            v = score[first];
+            u = fabs(score[second] - score[first]) / 2. + jitter;
+        } else if (i > last) {
+            v = score[last];
+            u = fabs(score[last] - score[second_last]) / 2. + jitter;
+        } else {
+            if (b < i)
+                for (b = i + 1; !written[b]; b++);
+            v = score[a] + (score[b] - score[a]) * (i - a) / (b - a);
+            u = fabs(score[b] - score[a]) / 2. + jitter;
+        }
+
+        sum += v;
+        i_sum += 1. / (v + 1.);
+        gap_err += u;
+        gap_i_err += u / ((v + 1.) * (v + 1.));
+        if (written[i] || i == cnt - 1) {
+            err_sq += gap_err * gap_err;
+            err_i_sq += gap_i_err * gap_i_err;
+            gap_err = gap_i_err = 0.;
+        }
+        if (!i || v < min) min = v;
+        if (!i || v > max) max = v;
+        if (!written[i]) {
+            if (!interpolated || v - u < low) low = v - u;
+            if (!interpolated || v + u > high) high = v + u;
+            interpolated = true;
+        }
+    }
+
+    switch (pool_method) {
+    case VMAF_POOL_METHOD_MEAN:
+        *pooled = sum / cnt;
+        *error = sqrt(err_sq) / cnt;
+        break;
+    case VMAF_POOL_METHOD_MIN:
+        *pooled = min;
+        *error = interpolated && low < min ? min - low : 0.;
+        break;
+    case VMAF_POOL_METHOD_MAX:
+        *pooled = max;
+        *error = interpolated && high > max ? high - max : 0.;
+        break;
+    case VMAF_POOL_METHOD_HARMONIC_MEAN:
+        *pooled = cnt / i_sum - 1.;
+        *error = sqrt(err_i_sq) * (*pooled + 1.) * (*pooled + 1.) / cnt;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+void vmaf_subsampler_destroy(VmafSubsampler *subsampler)
+{
+    if (!subsampler) return;
+    free(subsampler->selected);
+    free(subsampler);
+}
@@ -0,0 +1,75 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_SUBSAMPLE_H__
+#define __VMAF_SUBSAMPLE_H__
+
+#include <stdbool.h>
+
+#include "libvmaf/libvmaf.h"
+#include "libvmaf/picture.h"
+
+/*
+ * Decides which frames non-temporal extractors score. With a fixed stride,
+ * every `n_subsample`th index. Adaptively, `n_subsample` is the longest
+ * stride, used in static shots. It shortens as the mean absolute luma
+ * difference to the previous reference grows, down to every frame in high
+ * motion, and the frames following a scene cut are all scored. A frame is
+ * also scored when the reference to distorted difference drifts from the
+ * last scored frame. Differences are measured on a sparse grid, so the
+ * choice costs little and does not depend on extraction order.
+ */
+
+typedef struct VmafSubsampler VmafSubsampler;
+
+int vmaf_subsampler_init(VmafSubsampler **subsampler, unsigned n_subsample,
+                         bool adaptive);
+
+/**
+ * Choose whether frame `index` is scored. `prev_ref` is the previously read
+ * reference, or NULL for the first frame. Pictures which are not readable
+ * on the host are passed as NULL, falling back to the longest stride.
+ */
+int vmaf_subsampler_select(VmafSubsampler *subsampler,
+                           const VmafPicture *prev_ref, const VmafPicture *ref,
+                           const VmafPicture *dist, unsigned index,
+                           bool *selected);
+
+/**
+ * Whether frame `index` is scored. Always true for a NULL `subsampler`.
+ */
+bool vmaf_subsampler_selected(const VmafSubsampler *subsampler,
+                              unsigned index);
+
+bool vmaf_subsampler_adaptive(const VmafSubsampler *subsampler);
+
+/**
+ * Pool `cnt` scores, with `written[i]` false for frames that were not
+ * scored. Those take the linear interpolation of their scored neighbours.
+ * `error` is set to an estimate of how far `score` may be from pooling
+ * every frame, from the difference of each interpolated frame's neighbours
+ * and the frame to frame variation of consecutively scored frames. Errors
+ * are summed within a run of unscored frames and in quadrature across runs.
+ */
+int vmaf_subsample_pool(const double *score, const bool *written,
+                        unsigned cnt, enum VmafPoolingMethod pool_method,
+                        double *pooled, double *error);
+
+void vmaf_subsampler_destroy(VmafSubsampler *subsampler);
+
+#endif /* __VMAF_SUBSAMPLE_H__ */
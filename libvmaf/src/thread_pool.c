@@ -18,26 +18,59 @@
 
 #include <errno.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "affinity.h"
+#include "log.h"
+#include "perf.h"
+#include "thread_pool.h"
+
 typedef struct VmafThreadPoolJob {
     void (*func)(void *data);
     void *data;
+    struct VmafThreadPool *pool;
     struct VmafThreadPoolJob *next;
+#if VMAF_PERF_STATS
+    uint64_t enqueued_ns;
+#endif
 } VmafThreadPoolJob;
 
-typedef struct VmafTreadPool {
+/*
+ * Workers, or the host's tasks, shared by one or more pools. Each pool has
+ * its own queue, jobs are taken from the queues in turn.
+ */
+typedef struct VmafExecutor {
+    pthread_mutex_t lock;
+    pthread_cond_t empty;
+    pthread_cond_t stopped;
+    struct VmafThreadPool *pools; ///< attached pools
+    struct VmafThreadPool *next; ///< first pool to take a job from
+    unsigned n_threads;
+    unsigned n_alive; ///< workers running, or host tasks outstanding
+    bool stop;
+    bool pinned;
+    bool pin_failed; ///< reported once, by the first worker which failed
+    VmafAffinity affinity;
+    int (*submit)(void *user_data, void (*run)(void *arg), void *arg);
+    void *user_data;
+} VmafExecutor;
+
+typedef struct VmafThreadPool {
+    VmafExecutor *executor;
+    bool shared; ///< otherwise the executor is destroyed with the pool
     struct {
-        pthread_mutex_t lock;
-        pthread_cond_t empty;
         VmafThreadPoolJob *head, *tail;
     } queue;
     pthread_cond_t working;
-    unsigned n_threads;
     unsigned n_working;
-    bool stop;
+    struct VmafThreadPool *next;
+#if VMAF_PERF_STATS
+    bool timed; ///< set before the first job, see vmaf_thread_pool_time_queue()
+    VmafPerfTiming queue_wait;
+#endif
 } VmafThreadPool;
 
 static VmafThreadPoolJob *vmaf_thread_pool_fetch_job(VmafThreadPool *pool)
@@ -55,6 +88,23 @@ static VmafThreadPoolJob *vmaf_thread_pool_fetch_job(VmafThreadPool *pool)
     return job;
 }
 
+// round robin, the pool after the one served goes first next time
+static VmafThreadPoolJob *executor_fetch_job(VmafExecutor *ex)
+{
+    VmafThreadPool *pool = ex->next ? ex->next : ex->pools;
+    for (VmafThreadPool *p = pool; p;) {
+        VmafThreadPoolJob *job = vmaf_thread_pool_fetch_job(p);
+        if (job) {
+            ex->next = p->next;
+            p->n_working++;
+            return job;
+        }
+        p = p->next ? p->next : ex->pools;
+        if (p == pool) break;
+    }
+    return NULL;
+}
+
 static void vmaf_thread_pool_job_destroy(VmafThreadPoolJob *job)
 {
     if (!job) return;
@@ -62,59 +112,202 @@ static void vmaf_thread_pool_job_destroy(VmafThreadPoolJob *job)
     free(job);
 }
 
+// called and returns with the executor locked
+static void executor_run_job(VmafExecutor *ex, VmafThreadPoolJob *job)
+{
+    VmafThreadPool *pool = job->pool;
+#if VMAF_PERF_STATS
+    if (pool->timed) {
+        vmaf_perf_timing_add(&pool->queue_wait,
+                             vmaf_perf_wall_ns() - job->enqueued_ns, 0);
+    }
+#endif
+    pthread_mutex_unlock(&(ex->lock));
+    job->func(job->data);
+    vmaf_thread_pool_job_destroy(job);
+    pthread_mutex_lock(&(ex->lock));
+    if (--(pool->n_working) == 0 && !pool->queue.head)
+        pthread_cond_broadcast(&(pool->working));
+}
+
 static void *vmaf_thread_pool_runner(void *p)
 {
-    VmafThreadPool *pool = p;
+    VmafExecutor *ex = p;
 
+    // best effort, a worker which could not be pinned still does its jobs
+    const int err = ex->pinned ? vmaf_affinity_apply(&ex->affinity) : 0;
+
+    pthread_mutex_lock(&(ex->lock));
+    if (err && !ex->pin_failed) {
+        ex->pin_failed = true;
+        vmaf_log(VMAF_LOG_LEVEL_WARNING,
+                 "could not pin worker threads, error %d\n", err);
+    }
     for (;;) {
-        pthread_mutex_lock(&(pool->queue.lock));
-        if (!pool->queue.head && !pool->stop)
-            pthread_cond_wait(&(pool->queue.empty), &(pool->queue.lock));
-        if (pool->stop) break;
-        VmafThreadPoolJob *job = vmaf_thread_pool_fetch_job(pool);
-        pool->n_working++;
-        pthread_mutex_unlock(&(pool->queue.lock));
+        VmafThreadPoolJob *job = executor_fetch_job(ex);
         if (job) {
-            job->func(job->data);
-            vmaf_thread_pool_job_destroy(job);
+            executor_run_job(ex, job);
+            continue;
         }
-        pthread_mutex_lock(&(pool->queue.lock));
-        pool->n_working--;
-        if (!pool->stop && pool->n_working == 0 && !pool->queue.head)
-            pthread_cond_signal(&(pool->working));
-        pthread_mutex_unlock(&(pool->queue.lock));
+        if (ex->stop) break;
+        pthread_cond_wait(&(ex->empty), &(ex->lock));
     }
 
-    if (--(pool->n_threads) == 0)
-        pthread_cond_signal(&(pool->working));
+    if (--(ex->n_alive) == 0)
+        pthread_cond_signal(&(ex->stopped));
 
-    pthread_mutex_unlock(&(pool->queue.lock));
+    pthread_mutex_unlock(&(ex->lock));
     return NULL;
 }
 
-int vmaf_thread_pool_create(VmafThreadPool **pool, unsigned n_threads)
+// one host task per job enqueued, which need not be the job it runs
+static void executor_run_submitted(void *arg)
 {
-    if (!pool) return -EINVAL;
+    VmafExecutor *ex = arg;
+
+    pthread_mutex_lock(&(ex->lock));
+    VmafThreadPoolJob *job = executor_fetch_job(ex);
+    if (job)
+        executor_run_job(ex, job);
+    if (--(ex->n_alive) == 0 && ex->stop)
+        pthread_cond_signal(&(ex->stopped));
+    pthread_mutex_unlock(&(ex->lock));
+}
+
+static int executor_create(VmafExecutor **executor, unsigned n_threads,
+                           const VmafAffinity *affinity,
+                           int (*submit)(void *, void (*)(void *), void *),
+                           void *user_data)
+{
+    if (!executor) return -EINVAL;
     if (!n_threads) return -EINVAL;
 
-    VmafThreadPool *const p = *pool = malloc(sizeof(*p));
-    if (!p) return -ENOMEM;
-    memset(p, 0, sizeof(*p));
-    p->n_threads = n_threads;
+    VmafExecutor *const ex = *executor = malloc(sizeof(*ex));
+    if (!ex) return -ENOMEM;
+    memset(ex, 0, sizeof(*ex));
+    ex->n_threads = n_threads;
+    ex->submit = submit;
+    ex->user_data = user_data;
+    if (affinity) {
+        ex->pinned = true;
+        ex->affinity = *affinity;
+    }
 
-    pthread_mutex_init(&(p->queue.lock), NULL);
-    pthread_cond_init(&(p->queue.empty), NULL);
-    pthread_cond_init(&(p->working), NULL);
+    pthread_mutex_init(&(ex->lock), NULL);
+    pthread_cond_init(&(ex->empty), NULL);
+    pthread_cond_init(&(ex->stopped), NULL);
+
+    if (submit) return 0;
 
     for (unsigned i = 0; i < n_threads; i++) {
         pthread_t thread;
-        pthread_create(&thread, NULL, vmaf_thread_pool_runner, p);
+        if (pthread_create(&thread, NULL, vmaf_thread_pool_runner, ex))
+            break;
         pthread_detach(thread);
+        ex->n_alive++;
+    }
+
+    if (!ex->n_alive) {
+        pthread_mutex_destroy(&(ex->lock));
+        pthread_cond_destroy(&(ex->empty));
+        pthread_cond_destroy(&(ex->stopped));
+        free(ex);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+int vmaf_executor_create(VmafExecutor **executor,
+                         VmafExecutorConfiguration cfg)
+{
+    if (!executor) return -EINVAL;
+
+    VmafAffinity affinity;
+    if (cfg.cpu_affinity && !cfg.submit) {
+        int err = vmaf_affinity_parse(&affinity, cfg.cpu_affinity);
+        if (err) return err;
+    }
+
+    return executor_create(executor, cfg.n_threads,
+                           cfg.cpu_affinity && !cfg.submit ? &affinity : NULL,
+                           cfg.submit, cfg.user_data);
+}
+
+int vmaf_executor_destroy(VmafExecutor *executor)
+{
+    if (!executor) return -EINVAL;
+    VmafExecutor *const ex = executor;
+
+    pthread_mutex_lock(&(ex->lock));
+    if (ex->pools) {
+        pthread_mutex_unlock(&(ex->lock));
+        return -EBUSY;
     }
+    ex->stop = true;
+    pthread_cond_broadcast(&(ex->empty));
+    while (ex->n_alive)
+        pthread_cond_wait(&(ex->stopped), &(ex->lock));
+    pthread_mutex_unlock(&(ex->lock));
 
+    pthread_mutex_destroy(&(ex->lock));
+    pthread_cond_destroy(&(ex->empty));
+    pthread_cond_destroy(&(ex->stopped));
+    free(ex);
     return 0;
 }
 
+unsigned vmaf_executor_n_threads(const VmafExecutor *executor)
+{
+    return executor ? executor->n_threads : 0;
+}
+
+static int pool_create(VmafThreadPool **pool, VmafExecutor *executor,
+                       bool shared)
+{
+    VmafThreadPool *const p = *pool = malloc(sizeof(*p));
+    if (!p) return -ENOMEM;
+    memset(p, 0, sizeof(*p));
+    p->executor = executor;
+    p->shared = shared;
+    pthread_cond_init(&(p->working), NULL);
+
+    pthread_mutex_lock(&(executor->lock));
+    p->next = executor->pools;
+    executor->pools = p;
+    pthread_mutex_unlock(&(executor->lock));
+
+    return 0;
+}
+
+int vmaf_thread_pool_create_shared(VmafThreadPool **pool,
+                                   VmafExecutor *executor)
+{
+    if (!pool) return -EINVAL;
+    if (!executor) return -EINVAL;
+
+    return pool_create(pool, executor, true);
+}
+
+int vmaf_thread_pool_create_pinned(VmafThreadPool **pool, unsigned n_threads,
+                                   const VmafAffinity *affinity)
+{
+    if (!pool) return -EINVAL;
+    if (!n_threads) return -EINVAL;
+
+    VmafExecutor *executor;
+    int err = executor_create(&executor, n_threads, affinity, NULL, NULL);
+    if (err) return err;
+    err = pool_create(pool, executor, false);
+    if (err) vmaf_executor_destroy(executor);
+    return err;
+}
+
+int vmaf_thread_pool_create(VmafThreadPool **pool, unsigned n_threads)
+{
+    return vmaf_thread_pool_create_pinned(pool, n_threads, NULL);
+}
+
 int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
                              void *data, size_t data_sz)
 {
@@ -125,14 +318,20 @@ int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
     if (!job) return -ENOMEM;
     memset(job, 0, sizeof(*job));
     job->func = func;
+    job->pool = pool;
     if (data) {
         job->data = malloc(data_sz);
         if (!job->data) goto free_job;
         memcpy(job->data, data, data_sz);
     }
 
-    pthread_mutex_lock(&(pool->queue.lock));
+    VmafExecutor *const ex = pool->executor;
+    pthread_mutex_lock(&(ex->lock));
 
+#if VMAF_PERF_STATS
+    if (pool->timed)
+        job->enqueued_ns = vmaf_perf_wall_ns();
+#endif
     if (!pool->queue.head) {
         pool->queue.head = job;
         pool->queue.tail = pool->queue.head;
@@ -141,8 +340,17 @@ int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
         pool->queue.tail = job;
     }
 
-    pthread_cond_broadcast(&(pool->queue.empty));
-    pthread_mutex_unlock(&(pool->queue.lock));
+    if (!ex->submit) {
+        pthread_cond_signal(&(ex->empty));
+        pthread_mutex_unlock(&(ex->lock));
+        return 0;
+    }
+
+    ex->n_alive++;
+    pthread_mutex_unlock(&(ex->lock));
+    // not fatal, a job the host does not take runs here
+    if (ex->submit(ex->user_data, executor_run_submitted, ex))
+        executor_run_submitted(ex);
 
     return 0;
 
@@ -155,33 +363,168 @@ int vmaf_thread_pool_wait(VmafThreadPool *pool)
 {
     if (!pool) return -EINVAL;
 
-    pthread_mutex_lock(&(pool->queue.lock));
-    while((!pool->stop && (pool->n_working || pool->queue.head)) ||
-          (pool->stop && pool->n_threads))
-        pthread_cond_wait(&(pool->working), &(pool->queue.lock));
-    pthread_mutex_unlock(&(pool->queue.lock));
+    VmafExecutor *const ex = pool->executor;
+    pthread_mutex_lock(&(ex->lock));
+    while (pool->n_working || pool->queue.head)
+        pthread_cond_wait(&(pool->working), &(ex->lock));
+    pthread_mutex_unlock(&(ex->lock));
     return 0;
 }
+
+void vmaf_thread_pool_time_queue(VmafThreadPool *pool)
+{
+#if VMAF_PERF_STATS
+    if (pool) pool->timed = true;
+#else
+    (void) pool;
+#endif
+}
+
+int vmaf_thread_pool_queue_wait(VmafThreadPool *pool,
+                                VmafPerfTiming *queue_wait)
+{
+    if (!pool) return -EINVAL;
+    if (!queue_wait) return -EINVAL;
+
+#if VMAF_PERF_STATS
+    pthread_mutex_lock(&(pool->executor->lock));
+    *queue_wait = pool->queue_wait;
+    pthread_mutex_unlock(&(pool->executor->lock));
+    return 0;
+#else
+    return -ENOSYS;
+#endif
+}
+
+static void parallel_for_job(void *data);
+static void parallel_for_cancel_job(void *data);
+
 int vmaf_thread_pool_destroy(VmafThreadPool *pool)
 {
     if (!pool) return -EINVAL;
-    pthread_mutex_lock(&(pool->queue.lock));
+
+    VmafExecutor *const ex = pool->executor;
+    pthread_mutex_lock(&(ex->lock));
 
     VmafThreadPoolJob *job = pool->queue.head;
     while (job) {
         VmafThreadPoolJob *next_job = job->next;
+        // parallel_for helpers which never ran still hold a reference
+        if (job->func == parallel_for_job)
+            parallel_for_cancel_job(job->data);
         vmaf_thread_pool_job_destroy(job);
         job = next_job;
     }
+    pool->queue.head = pool->queue.tail = NULL;
 
-    pool->stop = true;
-    pthread_cond_broadcast(&(pool->queue.empty));
-    pthread_mutex_unlock(&(pool->queue.lock));
-    vmaf_thread_pool_wait(pool);
-    pthread_mutex_destroy(&(pool->queue.lock));
-    pthread_cond_destroy(&(pool->queue.empty));
+    while (pool->n_working)
+        pthread_cond_wait(&(pool->working), &(ex->lock));
+
+    VmafThreadPool **p = &ex->pools;
+    while (*p != pool) p = &(*p)->next;
+    *p = pool->next;
+    if (ex->next == pool)
+        ex->next = pool->next;
+
+    pthread_mutex_unlock(&(ex->lock));
     pthread_cond_destroy(&(pool->working));
+    if (!pool->shared)
+        vmaf_executor_destroy(ex);
 
     free(pool);
     return 0;
 }
+
+typedef struct VmafThreadPoolParallelFor {
+    void (*func)(void *data, unsigned idx);
+    void *data;
+    unsigned n_jobs;
+    atomic_uint next, done, ref_cnt;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} VmafThreadPoolParallelFor;
+
+static void parallel_for_run(VmafThreadPoolParallelFor *pf)
+{
+    unsigned idx;
+    while ((idx = atomic_fetch_add(&pf->next, 1)) < pf->n_jobs) {
+        pf->func(pf->data, idx);
+        if (atomic_fetch_add(&pf->done, 1) + 1 == pf->n_jobs) {
+            pthread_mutex_lock(&(pf->lock));
+            pthread_cond_signal(&(pf->finished));
+            pthread_mutex_unlock(&(pf->lock));
+        }
+    }
+}
+
+static void parallel_for_release(VmafThreadPoolParallelFor *pf, unsigned cnt)
+{
+    if (atomic_fetch_sub(&pf->ref_cnt, cnt) != cnt) return;
+    pthread_mutex_destroy(&(pf->lock));
+    pthread_cond_destroy(&(pf->finished));
+    free(pf);
+}
+
+static void parallel_for_job(void *data)
+{
+    VmafThreadPoolParallelFor *pf = *((VmafThreadPoolParallelFor **) data);
+    parallel_for_run(pf);
+    parallel_for_release(pf, 1);
+}
+
+static void parallel_for_cancel_job(void *data)
+{
+    VmafThreadPoolParallelFor *pf = *((VmafThreadPoolParallelFor **) data);
+    parallel_for_release(pf, 1);
+}
+
+int vmaf_thread_pool_parallel_for(VmafThreadPool *pool, unsigned n_jobs,
+                                  void (*func)(void *data, unsigned idx),
+                                  void *data)
+{
+    if (!func) return -EINVAL;
+
+    if (!pool || n_jobs <= 1) {
+        for (unsigned i = 0; i < n_jobs; i++)
+            func(data, i);
+        return 0;
+    }
+
+    VmafThreadPoolParallelFor *pf = malloc(sizeof(*pf));
+    if (!pf) return -ENOMEM;
+    memset(pf, 0, sizeof(*pf));
+    pf->func = func;
+    pf->data = data;
+    pf->n_jobs = n_jobs;
+    pthread_mutex_init(&(pf->lock), NULL);
+    pthread_cond_init(&(pf->finished), NULL);
+
+    // helper jobs which start after all indices are claimed return immediately,
+    // the last reference (caller or helper) frees the shared state
+    const unsigned n_helpers =
+        n_jobs - 1 < pool->executor->n_threads ?
+        n_jobs - 1 : pool->executor->n_threads;
+    atomic_init(&pf->next, 0);
+    atomic_init(&pf->done, 0);
+    atomic_init(&pf->ref_cnt, n_helpers + 1);
+
+    for (unsigned i = 0; i < n_helpers; i++) {
+        int err = vmaf_thread_pool_enqueue(pool, parallel_for_job, &pf,
+                                           sizeof(pf));
+        if (err) {
+            // not fatal, the calling thread picks up the remaining work
+            parallel_for_release(pf, n_helpers - i);
+            break;
+        }
+    }
+
+    parallel_for_run(pf);
+
+    pthread_mutex_lock(&(pf->lock));
+    while (atomic_load(&pf->done) < n_jobs)
+        pthread_cond_wait(&(pf->finished), &(pf->lock));
+    pthread_mutex_unlock(&(pf->lock));
+
+    parallel_for_release(pf, 1);
+    return 0;
+}
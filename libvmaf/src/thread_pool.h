@@ -21,15 +21,60 @@
 
 #include <pthread.h>
 
+#include "affinity.h"
+#include "libvmaf/libvmaf.h"
+
 typedef struct VmafThreadPool VmafThreadPool;
 
 int vmaf_thread_pool_create(VmafThreadPool **tpool, unsigned n_threads);
 
+/**
+ * Like `vmaf_thread_pool_create()`, every worker pins itself to `affinity`
+ * before running its first job, so buffers it allocates and touches end up
+ * on the preferred node. A NULL affinity leaves workers unpinned.
+ */
+int vmaf_thread_pool_create_pinned(VmafThreadPool **tpool, unsigned n_threads,
+                                   const VmafAffinity *affinity);
+
+/**
+ * A pool which runs its jobs on `executor`, alongside the other pools
+ * sharing it. Waiting on or destroying it only concerns its own jobs, the
+ * executor is left running.
+ */
+int vmaf_thread_pool_create_shared(VmafThreadPool **tpool,
+                                   VmafExecutor *executor);
+
+unsigned vmaf_executor_n_threads(const VmafExecutor *executor);
+
 int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
                              void *data, size_t data_sz);
 
 int vmaf_thread_pool_wait(VmafThreadPool *pool);
 
+/**
+ * Runs func(data, i) for every i in [0, n_jobs) and returns once all calls
+ * have completed. Work is shared between the pool workers and the calling
+ * thread, which keeps claiming indices itself, so it is safe to call from
+ * inside a job running on the same pool. A NULL pool runs all calls inline.
+ */
+int vmaf_thread_pool_parallel_for(VmafThreadPool *pool, unsigned n_jobs,
+                                  void (*func)(void *data, unsigned idx),
+                                  void *data);
+
+/**
+ * Start timing how long jobs spend queued, before the first job is enqueued.
+ * A no-op when built without perf stats.
+ */
+void vmaf_thread_pool_time_queue(VmafThreadPool *pool);
+
+/**
+ * Time jobs spent queued before a worker picked them up, see
+ * `vmaf_thread_pool_time_queue()`.
+ * Returns -ENOSYS when built without perf stats.
+ */
+int vmaf_thread_pool_queue_wait(VmafThreadPool *pool,
+                                VmafPerfTiming *queue_wait);
+
 int vmaf_thread_pool_destroy(VmafThreadPool *tpool);
 
 #endif /* __VMAF_THREAD_POOL_H__ */
@@ -0,0 +1,708 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+/*
+ * libvmaf benchmark suite.
+ *
+ * Runs every built-in feature extractor under every SIMD variant the host
+ * supports, the thread pool, the feature collector, SVM prediction and a
+ * complete VmafContext over deterministic synthetic content, and writes
+ * frames/s and ns/pixel (ops/s and ns/op for the non-pixel benchmarks) as
+ * JSON. On hosts with more than one NUMA node, the context is also run with
+ * its pictures on node 0 and its threads on each of nodes 0 and 1, showing
+ * the cost of cross-node memory access. See `vmaf_bench --help`.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "affinity.h"
+#include "bench_content.h"
+#include "cpu.h"
+#include "dict.h"
+#include "feature/feature_collector.h"
+#include "feature/feature_extractor.h"
+#include "feature/feature_name.h"
+#include "libvmaf/libvmaf.h"
+#include "model.h"
+#include "picture.h"
+#include "predict.h"
+#include "thread_pool.h"
+
+#define N_UNIQUE_FRAMES 3
+#define MAX_FORMATS 128
+
+static const struct {
+    const char *name;
+    unsigned w, h;
+} resolution[] = {
+    { "540p",   960,  540 },
+    { "720p",  1280,  720 },
+    { "1080p", 1920, 1080 },
+    { "1440p", 2560, 1440 },
+    { "2160p", 3840, 2160 },
+    { "4320p", 7680, 4320 },
+};
+#define N_RESOLUTIONS (sizeof(resolution) / sizeof(resolution[0]))
+
+static const enum VmafPixelFormat pix_fmts[] = {
+    VMAF_PIX_FMT_YUV420P, VMAF_PIX_FMT_YUV422P, VMAF_PIX_FMT_YUV444P,
+};
+static const unsigned bitdepths[] = { 8, 10, 12 };
+
+typedef struct BenchFormat {
+    const char *res;
+    unsigned w, h, bpc;
+    enum VmafPixelFormat pix_fmt;
+    char name[32];
+} BenchFormat;
+
+typedef struct BenchVariant {
+    const char *name;
+    unsigned cpumask;
+} BenchVariant;
+
+typedef struct Bench {
+    struct {
+        bool quick, full;
+        unsigned frames, threads;
+        const char *filter;
+        const char *output;
+    } cfg;
+    FILE *out;
+    unsigned n_results;
+    BenchVariant variant[4];
+    unsigned n_variants;
+    BenchFormat format[MAX_FORMATS];
+    unsigned n_formats;
+    unsigned n_nodes;
+} Bench;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const char *pix_fmt_name(enum VmafPixelFormat pix_fmt)
+{
+    switch (pix_fmt) {
+    case VMAF_PIX_FMT_YUV420P: return "420";
+    case VMAF_PIX_FMT_YUV422P: return "422";
+    case VMAF_PIX_FMT_YUV444P: return "444";
+    default: return "400";
+    }
+}
+
+static bool selected(Bench *b, const char *suite, const char *name,
+                     const char *variant, const BenchFormat *f)
+{
+    if (!b->cfg.filter) return true;
+    char key[256];
+    snprintf(key, sizeof(key), "%s/%s/%s/%s", suite, name,
+             variant ? variant : "", f ? f->name : "");
+    return strstr(key, b->cfg.filter);
+}
+
+static void result_begin(Bench *b, const char *suite, const char *name,
+                         const char *variant)
+{
+    fprintf(b->out, "%s\n    {\n", b->n_results++ ? "," : "");
+    fprintf(b->out, "      \"suite\": \"%s\",\n", suite);
+    fprintf(b->out, "      \"name\": \"%s\",\n", name);
+    if (variant)
+        fprintf(b->out, "      \"variant\": \"%s\",\n", variant);
+}
+
+static void write_frames_result(Bench *b, const char *suite, const char *name,
+                                const char *variant, const BenchFormat *f,
+                                unsigned frames, uint64_t ns, int err)
+{
+    result_begin(b, suite, name, variant);
+    fprintf(b->out, "      \"format\": \"%s\",\n", f->name);
+    fprintf(b->out, "      \"width\": %u,\n", f->w);
+    fprintf(b->out, "      \"height\": %u,\n", f->h);
+    fprintf(b->out, "      \"bpc\": %u,\n", f->bpc);
+    fprintf(b->out, "      \"pix_fmt\": \"%s\",\n", pix_fmt_name(f->pix_fmt));
+    if (err) {
+        fprintf(b->out, "      \"error\": %d\n    }", err);
+        fprintf(stderr, "%s/%s/%s/%s: error %d\n", suite, name,
+                variant ? variant : "", f->name, err);
+        return;
+    }
+
+    const double fps = frames / (ns / 1e9);
+    const double ns_per_pixel = (double) ns / frames / ((double) f->w * f->h);
+    fprintf(b->out, "      \"frames\": %u,\n", frames);
+    fprintf(b->out, "      \"seconds\": %.6f,\n", ns / 1e9);
+    fprintf(b->out, "      \"fps\": %.3f,\n", fps);
+    fprintf(b->out, "      \"ns_per_pixel\": %.4f\n    }", ns_per_pixel);
+    fprintf(stderr, "%s/%s/%s/%s: %.2f fps, %.3f ns/pixel\n", suite, name,
+            variant ? variant : "", f->name, fps, ns_per_pixel);
+}
+
+static void write_ops_result(Bench *b, const char *suite, const char *name,
+                             uint64_t ops, uint64_t ns, int err)
+{
+    result_begin(b, suite, name, NULL);
+    if (err) {
+        fprintf(b->out, "      \"error\": %d\n    }", err);
+        fprintf(stderr, "%s/%s: error %d\n", suite, name, err);
+        return;
+    }
+
+    const double ops_per_s = ops / (ns / 1e9);
+    const double ns_per_op = (double) ns / ops;
+    fprintf(b->out, "      \"ops\": %" PRIu64 ",\n", ops);
+    fprintf(b->out, "      \"seconds\": %.6f,\n", ns / 1e9);
+    fprintf(b->out, "      \"ops_per_s\": %.3f,\n", ops_per_s);
+    fprintf(b->out, "      \"ns_per_op\": %.4f\n    }", ns_per_op);
+    fprintf(stderr, "%s/%s: %.0f ops/s, %.1f ns/op\n", suite, name, ops_per_s,
+            ns_per_op);
+}
+
+static void add_format(Bench *b, unsigned r, enum VmafPixelFormat pix_fmt,
+                       unsigned bpc)
+{
+    if (b->n_formats == MAX_FORMATS) return;
+    BenchFormat *f = &b->format[b->n_formats++];
+    f->res = resolution[r].name;
+    f->w = resolution[r].w;
+    f->h = resolution[r].h;
+    f->bpc = bpc;
+    f->pix_fmt = pix_fmt;
+    snprintf(f->name, sizeof(f->name), "%s_%s_%ubit", f->res,
+             pix_fmt_name(pix_fmt), bpc);
+}
+
+static void init_formats(Bench *b)
+{
+    const unsigned n_pix_fmts = sizeof(pix_fmts) / sizeof(pix_fmts[0]);
+    const unsigned n_bitdepths = sizeof(bitdepths) / sizeof(bitdepths[0]);
+
+    if (b->cfg.full) {
+        for (unsigned r = 0; r < N_RESOLUTIONS; r++) {
+            for (unsigned p = 0; p < n_pix_fmts; p++) {
+                for (unsigned d = 0; d < n_bitdepths; d++)
+                    add_format(b, r, pix_fmts[p], bitdepths[d]);
+            }
+        }
+        return;
+    }
+
+    // sweep one axis at a time around 8-bit 420
+    const unsigned base = b->cfg.quick ? 0 : 2;
+    for (unsigned r = 0; r < N_RESOLUTIONS; r++) {
+        if (b->cfg.quick && r != 0 && r != 2) continue;
+        add_format(b, r, VMAF_PIX_FMT_YUV420P, 8);
+    }
+    for (unsigned d = 1; d < n_bitdepths; d++)
+        add_format(b, base, VMAF_PIX_FMT_YUV420P, bitdepths[d]);
+    for (unsigned p = 1; p < n_pix_fmts; p++)
+        add_format(b, base, pix_fmts[p], 8);
+}
+
+static void init_variants(Bench *b)
+{
+    const unsigned flags = vmaf_get_cpu_flags();
+    b->variant[b->n_variants++] = (BenchVariant) { "c", 0 };
+#if ARCH_X86
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
+        b->variant[b->n_variants++] = (BenchVariant) {
+            "avx2", (VMAF_X86_CPU_FLAG_AVX2 << 1) - 1
+        };
+    }
+    if (flags & VMAF_X86_CPU_FLAG_AVX512)
+        b->variant[b->n_variants++] = (BenchVariant) { "avx512", ~0u };
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON)
+        b->variant[b->n_variants++] = (BenchVariant) { "neon", ~0u };
+#else
+    (void) flags;
+#endif
+}
+
+static int bench_extractor(VmafFeatureExtractor *fex, const BenchVariant *v,
+                           const BenchFormat *f, VmafPicture *ref,
+                           VmafPicture *dist, unsigned frames, uint64_t *ns)
+{
+    int err = 0;
+    vmaf_set_cpu_flags_mask(v->cpumask);
+
+    VmafFeatureCollector *fc;
+    err = vmaf_feature_collector_init(&fc);
+    if (err) goto reset_mask;
+    VmafFeatureExtractorContext *fex_ctx;
+    err = vmaf_feature_extractor_context_create(&fex_ctx, fex, NULL);
+    if (err) goto destroy_fc;
+
+    // kernels are selected in init, keep it out of the measurement
+    err = vmaf_feature_extractor_context_init(fex_ctx, f->pix_fmt, f->bpc,
+                                              f->w, f->h);
+    if (err) goto destroy_ctx;
+
+    const uint64_t t0 = now_ns();
+    for (unsigned i = 0; i < frames; i++) {
+        const unsigned n = i % N_UNIQUE_FRAMES;
+        err = vmaf_feature_extractor_context_extract(fex_ctx, &ref[n], NULL,
+                                                     &dist[n], NULL, i, fc);
+        if (err) goto close_ctx;
+    }
+    err = vmaf_feature_extractor_context_flush(fex_ctx, fc);
+    *ns = now_ns() - t0;
+
+close_ctx:
+    err |= vmaf_feature_extractor_context_close(fex_ctx);
+destroy_ctx:
+    vmaf_feature_extractor_context_destroy(fex_ctx);
+destroy_fc:
+    vmaf_feature_collector_destroy(fc);
+reset_mask:
+    vmaf_set_cpu_flags_mask(~0u);
+    return err;
+}
+
+static int bench_context(Bench *b, VmafModel *model, unsigned n_threads,
+                         const char *cpu_affinity, VmafPicture *ref,
+                         VmafPicture *dist, uint64_t *ns)
+{
+    VmafConfiguration cfg = {
+        .log_level = VMAF_LOG_LEVEL_ERROR,
+        .n_threads = n_threads,
+        .cpu_affinity = cpu_affinity,
+    };
+
+    VmafContext *vmaf;
+    int err = vmaf_init(&vmaf, cfg);
+    if (err) return err;
+    err = vmaf_use_features_from_model(vmaf, model);
+    if (err) goto close;
+
+    const uint64_t t0 = now_ns();
+    for (unsigned i = 0; i < b->cfg.frames; i++) {
+        const unsigned n = i % N_UNIQUE_FRAMES;
+        VmafPicture r, d;
+        vmaf_picture_ref(&r, &ref[n]);
+        vmaf_picture_ref(&d, &dist[n]);
+        err = vmaf_read_pictures(vmaf, &r, &d, i);
+        if (err) goto close;
+    }
+    err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+    if (err) goto close;
+    double score;
+    err = vmaf_score_pooled(vmaf, model, VMAF_POOL_METHOD_MEAN, &score, 0,
+                            b->cfg.frames - 1);
+    *ns = now_ns() - t0;
+
+close:
+    vmaf_close(vmaf);
+    return err;
+}
+
+static int alloc_content(const BenchFormat *f, VmafPicture *ref,
+                         VmafPicture *dist)
+{
+    unsigned n = 0;
+    int err = 0;
+    for (; n < N_UNIQUE_FRAMES; n++) {
+        err = bench_content_synthetic(&ref[n], f->pix_fmt, f->bpc, f->w, f->h,
+                                      n, 1);
+        if (err) break;
+        err = bench_content_inject_noise(&dist[n], &ref[n], 4, n + 1);
+        if (err) {
+            vmaf_picture_unref(&ref[n]);
+            break;
+        }
+    }
+    if (!err) return 0;
+
+    while (n--) {
+        vmaf_picture_unref(&ref[n]);
+        vmaf_picture_unref(&dist[n]);
+    }
+    return err;
+}
+
+typedef struct NumaArgs {
+    Bench *b;
+    const BenchFormat *f;
+    VmafModel *model;
+} NumaArgs;
+
+/*
+ * Runs on a thread of its own, so that the affinity and memory policy it
+ * sets end with it.
+ */
+static void *bench_numa_thread(void *p)
+{
+    NumaArgs *args = p;
+    Bench *b = args->b;
+    const BenchFormat *f = args->f;
+    VmafAffinity node[2];
+    int err = 0;
+    for (unsigned n = 0; n < 2 && !err; n++) {
+        char affinity[16];
+        snprintf(affinity, sizeof(affinity), "node:%u", n);
+        err = vmaf_affinity_parse(&node[n], affinity);
+    }
+    if (err) {
+        fprintf(stderr, "could not read NUMA topology, error %d\n", err);
+        return NULL;
+    }
+
+    // the calling thread first touches the pictures, place them on node 0
+    VmafPicture ref[N_UNIQUE_FRAMES], dist[N_UNIQUE_FRAMES];
+    err = vmaf_affinity_apply(&node[0]);
+    if (!err) err = alloc_content(f, ref, dist);
+    if (err) {
+        fprintf(stderr, "could not allocate %s content on node 0\n", f->name);
+        return NULL;
+    }
+
+    for (unsigned n = 0; n < 2; n++) {
+        char affinity[16], variant[32];
+        snprintf(affinity, sizeof(affinity), "node:%u", n);
+        snprintf(variant, sizeof(variant), "cpu_node%u_mem_node0", n);
+        uint64_t ns = 0;
+        err = vmaf_affinity_apply(&node[n]);
+        if (!err)
+            err = bench_context(b, args->model, b->cfg.threads, affinity,
+                                ref, dist, &ns);
+        write_frames_result(b, "numa", "vmaf_v0.6.1", variant, f,
+                            b->cfg.frames, ns, err);
+    }
+
+    for (unsigned i = 0; i < N_UNIQUE_FRAMES; i++) {
+        vmaf_picture_unref(&ref[i]);
+        vmaf_picture_unref(&dist[i]);
+    }
+    return NULL;
+}
+
+static void bench_numa(Bench *b, const BenchFormat *f, VmafModel *model)
+{
+    NumaArgs args = { .b = b, .f = f, .model = model };
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, bench_numa_thread, &args)) {
+        fprintf(stderr, "could not start the NUMA benchmark\n");
+        return;
+    }
+    pthread_join(thread, NULL);
+}
+
+static void run_format(Bench *b, const BenchFormat *f, VmafModel *model)
+{
+    bool any = false;
+    for (unsigned i = 0; vmaf_get_feature_extractor_by_index(i); i++) {
+        VmafFeatureExtractor *fex = vmaf_get_feature_extractor_by_index(i);
+        for (unsigned v = 0; v < b->n_variants; v++)
+            any |= selected(b, "extractor", fex->name, b->variant[v].name, f);
+    }
+    any |= selected(b, "context", "vmaf_v0.6.1", NULL, f);
+    if (b->n_nodes > 1 && b->cfg.threads && model &&
+        selected(b, "numa", "vmaf_v0.6.1", NULL, f))
+    {
+        bench_numa(b, f, model);
+    }
+    if (!any) return;
+
+    VmafPicture ref[N_UNIQUE_FRAMES], dist[N_UNIQUE_FRAMES];
+    int err = alloc_content(f, ref, dist);
+    if (err) {
+        fprintf(stderr, "could not allocate %s content\n", f->name);
+        return;
+    }
+
+    for (unsigned i = 0; vmaf_get_feature_extractor_by_index(i); i++) {
+        VmafFeatureExtractor *fex = vmaf_get_feature_extractor_by_index(i);
+        if (fex->flags & VMAF_FEATURE_EXTRACTOR_CUDA) continue;
+        if (!strcmp(fex->name, "null")) continue;
+
+        for (unsigned v = 0; v < b->n_variants; v++) {
+            const BenchVariant *var = &b->variant[v];
+            if (!selected(b, "extractor", fex->name, var->name, f)) continue;
+            uint64_t ns = 0;
+            err = bench_extractor(fex, var, f, ref, dist, b->cfg.frames, &ns);
+            write_frames_result(b, "extractor", fex->name, var->name, f,
+                                b->cfg.frames, ns, err);
+        }
+    }
+
+    if (model && selected(b, "context", "vmaf_v0.6.1", NULL, f)) {
+        const unsigned threads[] = { 0, b->cfg.threads };
+        for (unsigned t = 0; t < 2; t++) {
+            if (t && !b->cfg.threads) break;
+            char variant[32];
+            snprintf(variant, sizeof(variant), "threads_%u", threads[t]);
+            uint64_t ns = 0;
+            err = bench_context(b, model, threads[t], NULL, ref, dist, &ns);
+            write_frames_result(b, "context", "vmaf_v0.6.1", variant, f,
+                                b->cfg.frames, ns, err);
+        }
+    }
+
+    for (unsigned i = 0; i < N_UNIQUE_FRAMES; i++) {
+        vmaf_picture_unref(&ref[i]);
+        vmaf_picture_unref(&dist[i]);
+    }
+}
+
+static void nop_job(void *data)
+{
+    (void) data;
+}
+
+static void nop_for(void *data, unsigned idx)
+{
+    (void) data;
+    (void) idx;
+}
+
+static void bench_thread_pool(Bench *b)
+{
+    if (!b->cfg.threads) return;
+    const unsigned n_jobs = b->cfg.quick ? 10000 : 100000;
+
+    VmafThreadPool *pool;
+    int err = vmaf_thread_pool_create(&pool, b->cfg.threads);
+    if (err) {
+        write_ops_result(b, "thread_pool", "enqueue", 0, 0, err);
+        return;
+    }
+
+    if (selected(b, "thread_pool", "enqueue", NULL, NULL)) {
+        const uint64_t t0 = now_ns();
+        for (unsigned i = 0; i < n_jobs && !err; i++)
+            err = vmaf_thread_pool_enqueue(pool, nop_job, NULL, 0);
+        err |= vmaf_thread_pool_wait(pool);
+        write_ops_result(b, "thread_pool", "enqueue", n_jobs,
+                         now_ns() - t0, err);
+    }
+
+    if (selected(b, "thread_pool", "parallel_for", NULL, NULL)) {
+        const unsigned n_calls = n_jobs / 10;
+        err = 0;
+        const uint64_t t0 = now_ns();
+        for (unsigned i = 0; i < n_calls && !err; i++)
+            err = vmaf_thread_pool_parallel_for(pool, 64, nop_for, NULL);
+        write_ops_result(b, "thread_pool", "parallel_for", n_calls,
+                         now_ns() - t0, err);
+    }
+
+    vmaf_thread_pool_destroy(pool);
+}
+
+static void bench_collector(Bench *b)
+{
+    const unsigned n_features = 16;
+    const unsigned n_frames = b->cfg.quick ? 2000 : 20000;
+    char name[16][32];
+    for (unsigned j = 0; j < n_features; j++)
+        snprintf(name[j], sizeof(name[j]), "bench_feature_%u", j);
+
+    VmafFeatureCollector *fc;
+    int err = vmaf_feature_collector_init(&fc);
+    if (err) {
+        write_ops_result(b, "collector", "append", 0, 0, err);
+        return;
+    }
+
+    uint64_t t0 = now_ns();
+    for (unsigned i = 0; i < n_frames && !err; i++) {
+        for (unsigned j = 0; j < n_features && !err; j++)
+            err = vmaf_feature_collector_append(fc, name[j], i + j, i);
+    }
+    if (selected(b, "collector", "append", NULL, NULL)) {
+        write_ops_result(b, "collector", "append", n_frames * n_features,
+                         now_ns() - t0, err);
+    }
+
+    if (!err && selected(b, "collector", "get_score", NULL, NULL)) {
+        double score;
+        t0 = now_ns();
+        for (unsigned i = 0; i < n_frames && !err; i++) {
+            for (unsigned j = 0; j < n_features && !err; j++)
+                err = vmaf_feature_collector_get_score(fc, name[j], &score, i);
+        }
+        write_ops_result(b, "collector", "get_score", n_frames * n_features,
+                         now_ns() - t0, err);
+    }
+
+    vmaf_feature_collector_destroy(fc);
+}
+
+static int model_feature_name(VmafModelFeature *feature, char **name)
+{
+    VmafFeatureExtractor *fex =
+        vmaf_get_feature_extractor_by_feature_name(feature->name, 0);
+    if (!fex) return -EINVAL;
+
+    VmafDictionary *opts_dict = NULL;
+    if (feature->opts_dict) {
+        int err = vmaf_dictionary_copy(&feature->opts_dict, &opts_dict);
+        if (err) return err;
+    }
+    VmafFeatureExtractorContext *fex_ctx;
+    int err = vmaf_feature_extractor_context_create(&fex_ctx, fex, opts_dict);
+    if (err) {
+        vmaf_dictionary_free(&opts_dict);
+        return err;
+    }
+    *name = vmaf_feature_name_from_options(feature->name,
+                                           fex_ctx->fex->options,
+                                           fex_ctx->fex->priv);
+    vmaf_feature_extractor_context_destroy(fex_ctx);
+    return *name ? 0 : -ENOMEM;
+}
+
+static void bench_predict(Bench *b, VmafModel *model)
+{
+    if (!selected(b, "predict", "vmaf_v0.6.1", NULL, NULL)) return;
+    const unsigned n_frames = b->cfg.quick ? 200 : 2000;
+
+    VmafFeatureCollector *fc;
+    int err = vmaf_feature_collector_init(&fc);
+    if (err) {
+        write_ops_result(b, "predict", "vmaf_v0.6.1", 0, 0, err);
+        return;
+    }
+
+    for (unsigned j = 0; j < model->n_features && !err; j++) {
+        char *name;
+        err = model_feature_name(&model->feature[j], &name);
+        if (err) break;
+        for (unsigned i = 0; i < n_frames && !err; i++) {
+            const double score = 0.5 + 0.4 * ((i * 7 + j * 3) % 11) / 10.;
+            err = vmaf_feature_collector_append(fc, name, score, i);
+        }
+        free(name);
+    }
+
+    const uint64_t t0 = now_ns();
+    for (unsigned i = 0; i < n_frames && !err; i++) {
+        double score;
+        err = vmaf_predict_score_at_index(model, fc, i, &score, true, false, 0);
+    }
+    write_ops_result(b, "predict", "vmaf_v0.6.1", n_frames, now_ns() - t0,
+                     err);
+
+    vmaf_feature_collector_destroy(fc);
+}
+
+static void usage(const char *app)
+{
+    fprintf(stderr, "Usage: %s [options]\n\n", app);
+    fprintf(stderr, "Supported options:\n"
+            " --quick:              small formats and few frames\n"
+            " --full:               every resolution, pixel format and\n"
+            "                       bitdepth combination, instead of sweeping\n"
+            "                       one axis at a time\n"
+            " --frames $unsigned:   frames per measurement\n"
+            " --threads $unsigned:  threads for the thread pool and context\n"
+            "                       benchmarks, 0 to skip them\n"
+            " --filter $string:     only run benchmarks whose\n"
+            "                       suite/name/variant/format contains $string\n"
+            " --output/-o $path:    write JSON results to $path, default stdout\n"
+           );
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    Bench b = {
+        .cfg = {
+            .frames = 0,
+            .threads = 4,
+        },
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(arg, "--quick")) {
+            b.cfg.quick = true;
+        } else if (!strcmp(arg, "--full")) {
+            b.cfg.full = true;
+        } else if (!strcmp(arg, "--frames") && has_value) {
+            b.cfg.frames = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(arg, "--threads") && has_value) {
+            b.cfg.threads = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(arg, "--filter") && has_value) {
+            b.cfg.filter = argv[++i];
+        } else if ((!strcmp(arg, "--output") || !strcmp(arg, "-o")) &&
+                   has_value) {
+            b.cfg.output = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!b.cfg.frames)
+        b.cfg.frames = b.cfg.quick ? 3 : 8;
+
+    b.out = b.cfg.output ? fopen(b.cfg.output, "w") : stdout;
+    if (!b.out) {
+        fprintf(stderr, "could not open file: %s\n", b.cfg.output);
+        return -1;
+    }
+
+    vmaf_init_cpu();
+    init_formats(&b);
+    init_variants(&b);
+    b.n_nodes = vmaf_affinity_node_cnt();
+    if (b.n_nodes < 2)
+        fprintf(stderr, "single NUMA node, skipping cross-node benchmarks\n");
+
+    VmafModel *model = NULL;
+    VmafModelConfig model_cfg = { .name = "vmaf" };
+    if (vmaf_model_load(&model, &model_cfg, "vmaf_v0.6.1"))
+        fprintf(stderr, "built-in vmaf_v0.6.1 unavailable, skipping model "
+                        "benchmarks\n");
+
+    fprintf(b.out, "{\n");
+    fprintf(b.out, "  \"version\": \"%s\",\n", vmaf_version());
+    fprintf(b.out, "  \"cpu_flags\": %u,\n", vmaf_get_cpu_flags());
+    fprintf(b.out, "  \"frames\": %u,\n", b.cfg.frames);
+    fprintf(b.out, "  \"threads\": %u,\n", b.cfg.threads);
+    fprintf(b.out, "  \"results\": [");
+
+    bench_thread_pool(&b);
+    bench_collector(&b);
+    if (model)
+        bench_predict(&b, model);
+    for (unsigned i = 0; i < b.n_formats; i++)
+        run_format(&b, &b.format[i], model);
+
+    fprintf(b.out, "\n  ]\n}\n");
+
+    if (model)
+        vmaf_model_destroy(model);
+    if (b.out != stdout)
+        fclose(b.out);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "bench_content.h"
+
+static inline uint32_t hash32(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+static inline void store(VmafPicture *pic, unsigned p, unsigned i, unsigned j,
+                         unsigned v)
+{
+    if (pic->bpc == 8) {
+        uint8_t *data = pic->data[p];
+        data[i * pic->stride[p] + j] = v;
+    } else {
+        uint16_t *data = pic->data[p];
+        data[i * (pic->stride[p] / 2) + j] = v;
+    }
+}
+
+static inline unsigned load(VmafPicture *pic, unsigned p, unsigned i,
+                            unsigned j)
+{
+    if (pic->bpc == 8) {
+        const uint8_t *data = pic->data[p];
+        return data[i * pic->stride[p] + j];
+    }
+    const uint16_t *data = pic->data[p];
+    return data[i * (pic->stride[p] / 2) + j];
+}
+
+int bench_content_synthetic(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
+                            unsigned bpc, unsigned w, unsigned h,
+                            unsigned frame, uint32_t seed)
+{
+    if (!pic) return -EINVAL;
+    if (bpc < 8 || bpc > 16) return -EINVAL;
+
+    int err = vmaf_picture_alloc(pic, pix_fmt, bpc, w, h);
+    if (err) return err;
+
+    const unsigned n_planes = pix_fmt == VMAF_PIX_FMT_YUV400P ? 1 : 3;
+    const unsigned shift = bpc - 8;
+
+    for (unsigned p = 0; p < n_planes; p++) {
+        const unsigned pw = pic->w[p], ph = pic->h[p];
+        // edge and texture sizes follow the picture size, so all
+        // resolutions show the same scene
+        const unsigned cell = (pw / 30) | 1;
+        const unsigned grain = (pw / 960) + 1;
+        const uint32_t plane_seed = hash32(seed ^ (p * 0x9e3779b9));
+
+        for (unsigned i = 0; i < ph; i++) {
+            for (unsigned j = 0; j < pw; j++) {
+                int v = 48 + (int) (((uint64_t) (i + j) * 128) / (pw + ph));
+                if ((((j + frame * cell / 8) / cell) ^ (i / cell)) & 1)
+                    v += p ? 16 : 40;
+                const uint32_t r =
+                    hash32(plane_seed ^ ((i / grain) * 65537 + j / grain));
+                v += (int) (r & 31) - 16;
+                v = v < 16 ? 16 : v > 235 ? 235 : v;
+
+                unsigned s = (unsigned) v << shift;
+                if (shift)
+                    s |= hash32(r ^ frame) & ((1u << shift) - 1);
+                store(pic, p, i, j, s);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int bench_content_inject_noise(VmafPicture *dist, VmafPicture *ref,
+                               unsigned strength, uint32_t seed)
+{
+    if (!dist) return -EINVAL;
+    if (!ref) return -EINVAL;
+
+    int err = vmaf_picture_alloc(dist, ref->pix_fmt, ref->bpc, ref->w[0],
+                                 ref->h[0]);
+    if (err) return err;
+
+    const unsigned n_planes = ref->pix_fmt == VMAF_PIX_FMT_YUV400P ? 1 : 3;
+    const int max = (1 << ref->bpc) - 1;
+    const uint32_t range = (strength << (ref->bpc - 8)) + 1;
+
+    for (unsigned p = 0; p < n_planes; p++) {
+        const uint32_t plane_seed = hash32(seed ^ (p * 0x9e3779b9));
+        for (unsigned i = 0; i < ref->h[p]; i++) {
+            for (unsigned j = 0; j < ref->w[p]; j++) {
+                const uint32_t r = hash32(plane_seed ^ (i * 65537 + j));
+                const int noise = (int) ((r & 0xffff) % range) +
+                                  (int) ((r >> 16) % range) - (int) range + 1;
+                int v = (int) load(ref, p, i, j) + noise;
+                v = v < 0 ? 0 : v > max ? max : v;
+                store(dist, p, i, j, v);
+            }
+        }
+    }
+
+    return 0;
+}
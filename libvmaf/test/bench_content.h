@@ -0,0 +1,47 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#ifndef __VMAF_BENCH_CONTENT_H__
+#define __VMAF_BENCH_CONTENT_H__
+
+#include <stdint.h>
+
+#include "libvmaf/picture.h"
+
+/*
+ * Deterministic content for benchmarking. Output only depends on the
+ * arguments, so results are comparable across machines and builds.
+ */
+
+/**
+ * Allocate `pic` and fill it with a synthetic frame: a smooth gradient, a
+ * checkerboard of hard edges which moves with `frame` and fine texture.
+ * High bitdepths get random low bits so every bit is exercised.
+ */
+int bench_content_synthetic(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
+                            unsigned bpc, unsigned w, unsigned h,
+                            unsigned frame, uint32_t seed);
+
+/**
+ * Allocate `dist` as a copy of `ref` with triangular noise of up to
+ * +/- `strength` 8-bit code values added to every sample.
+ */
+int bench_content_inject_noise(VmafPicture *dist, VmafPicture *ref,
+                               unsigned strength, uint32_t seed);
+
+#endif /* __VMAF_BENCH_CONTENT_H__ */
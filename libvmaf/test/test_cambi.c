@@ -136,6 +136,35 @@ static int get_sample_image_8x8(VmafPicture *pic, int pic_index)
 }
 
 
+static int get_banded_image(VmafPicture *pic, unsigned bpc, unsigned w, unsigned h, unsigned seed)
+{
+    int err = vmaf_picture_alloc(pic, VMAF_PIX_FMT_YUV400P, bpc, w, h);
+    if (err) return err;
+    const unsigned max_val = (1 << bpc) - 1;
+    for (unsigned i = 0; i < h; i++) {
+        for (unsigned j = 0; j < w; j++) {
+            seed = seed * 1103515245 + 12345;
+            // smooth gradient quantized into wide bands, with sparse noise on top
+            unsigned val = (((i + 2 * j) * max_val) / (h + 2 * w)) & ~7u;
+            if ((seed >> 16) % 7 == 0) val += (seed >> 8) % 3;
+            if (val > max_val) val = max_val;
+            if (bpc == 8)
+                ((uint8_t *)pic->data[0])[i * pic->stride[0] + j] = val;
+            else
+                ((uint16_t *)pic->data[0])[i * (pic->stride[0] >> 1) + j] = val;
+        }
+    }
+    return 0;
+}
+
+static int copy_picture(VmafPicture *dst, VmafPicture *src)
+{
+    int err = vmaf_picture_alloc(dst, src->pix_fmt, src->bpc, src->w[0], src->h[0]);
+    if (err) return err;
+    memcpy(dst->data[0], src->data[0], src->stride[0] * src->h[0]);
+    return 0;
+}
+
 /* Preprocessing functions */
 static char *test_anti_dithering_filter()
 {
@@ -145,7 +174,7 @@ static char *test_anti_dithering_filter()
     err |= get_sample_image(&pic, 0);
     err |= get_sample_image(&filtered_pic, 1);
     mu_assert("test_anti_dithering_filter alloc error", !err);
-    anti_dithering_filter(&pic, pic.w[0], pic.h[0]);
+    anti_dithering_filter(pic.data[0], pic.w[0], pic.h[0], pic.stride[0] >> 1);
     bool equal = pic_data_equality(&pic, &filtered_pic);
     mu_assert("anti_dithering_filter output pic wrong", equal);
 
@@ -167,7 +196,7 @@ static char *test_decimate()
     uint16_t width = pic.w[0]>>1;
     uint16_t height = pic.h[0]>>1;
 
-    decimate(&pic, width, height);
+    decimate(data, width, height, stride);
 
     mu_assert("decimate pic wrong pixel value (0,0)", data[0]==1);
     mu_assert("decimate pic wrong pixel value (1,0)", data[1]==0);
@@ -274,12 +303,12 @@ static char *test_filter_mode()
     data[1 * stride + 2] = 1; data[2 * stride + 2] = 1;
     data[1 * stride + 3] = 1; data[3 * stride + 3] = 1;
     memcpy(filtered_data, data, stride * h * sizeof(uint16_t));
-    filter_mode(&filtered_image, w, h, buffer);
+    filter_mode(filtered_data, w, h, output_stride, buffer);
     mu_assert("filter_mode: all zeros", data_pic_sum(&filtered_image)==0);
 
     data[3 * stride + 4] = 1;
     memcpy(filtered_data, data, stride * h * sizeof(uint16_t));
-    filter_mode(&filtered_image, w, h, buffer);
+    filter_mode(filtered_data, w, h, output_stride, buffer);
 
     mu_assert("filter_mode: one one sum check", data_pic_sum(&filtered_image)==1);
     mu_assert("filter_mode: zero (3,3) check", filtered_data[3 * output_stride + 3]==0);
@@ -288,15 +317,15 @@ static char *test_filter_mode()
     data[0 * stride + 0] = 2;
     data[0 * stride + 1] = 1;
     memcpy(filtered_data, data, stride * h * sizeof(uint16_t));
-    filter_mode(&filtered_image, w, h, buffer);
+    filter_mode(filtered_data, w, h, output_stride, buffer);
     mu_assert("filter_mode: two in the corner check", filtered_data[0 * output_stride + 0]==2);
     data[1 * stride + 0] = 1;
     memcpy(filtered_data, data, stride * h * sizeof(uint16_t));
-    filter_mode(&filtered_image, w, h, buffer);
+    filter_mode(filtered_data, w, h, output_stride, buffer);
     mu_assert("filter_mode: two in the corner and adjacent one check", filtered_data[0 * output_stride + 1]==1);
     data[2 * stride + 0] = 2;
     memcpy(filtered_data, data, stride * h * sizeof(uint16_t));
-    filter_mode(&filtered_image, w, h, buffer);
+    filter_mode(filtered_data, w, h, output_stride, buffer);
     mu_assert("filter_mode: two in corner and edge check", filtered_data[1 * output_stride + 0]==2);
 
     vmaf_picture_unref(&image);
@@ -347,11 +376,11 @@ static char *test_get_spatial_mask_for_index()
     err |= get_sample_image(&mask, 3);
     mu_assert("test_get_spatial_mask_for_index alloc #2 error", !err);
 
-    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 2, filter_size, width, height, get_derivative_data_for_row);
+    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 2, filter_size, width, height, get_derivative_data_for_row, get_spatial_mask_row);
     mu_assert("spatial_mask_for_index wrong mask for index=2, image=3", data_pic_sum(&mask)==14);
-    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 1, filter_size, width, height, get_derivative_data_for_row);
+    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 1, filter_size, width, height, get_derivative_data_for_row, get_spatial_mask_row);
     mu_assert("spatial_mask_for_index wrong mask for index=1, image=3", data_pic_sum(&mask)==16);
-    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 0, filter_size, width, height, get_derivative_data_for_row);
+    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 0, filter_size, width, height, get_derivative_data_for_row, get_spatial_mask_row);
     mu_assert("spatial_mask_for_index wrong mask for index=0, image=3", data_pic_sum(&mask)==16);
 
     vmaf_picture_unref(&image);
@@ -359,11 +388,11 @@ static char *test_get_spatial_mask_for_index()
     err |= get_sample_image(&image, 4);
     mu_assert("test_get_spatial_mask_for_index alloc #3 error", !err);
 
-    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 3, filter_size, width, height, get_derivative_data_for_row);
+    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 3, filter_size, width, height, get_derivative_data_for_row, get_spatial_mask_row);
     mu_assert("spatial_mask_for_index wrong mask for index=3, image=4", data_pic_sum(&mask)==0);
-    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 2, filter_size, width, height, get_derivative_data_for_row);
+    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 2, filter_size, width, height, get_derivative_data_for_row, get_spatial_mask_row);
     mu_assert("spatial_mask_for_index wrong mask for index=2, image=4", data_pic_sum(&mask)==6);
-    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 1, filter_size, width, height, get_derivative_data_for_row);
+    get_spatial_mask_for_index(&image, &mask, mask_dp, derivative_buffer, 1, filter_size, width, height, get_derivative_data_for_row, get_spatial_mask_row);
     mu_assert("spatial_mask_for_index wrong mask for index=1, image=4", data_pic_sum(&mask)==9);
 
     vmaf_picture_unref(&image);
@@ -397,7 +426,7 @@ static char *test_calculate_c_values()
 
     calculate_c_values(&input, &mask, combined_c_values, histograms, window_size,
                        num_diffs, tvi_for_diff, diff_weights, all_diffs, width, height, 
-                       increment_range, decrement_range);
+                       increment_range, decrement_range, calculate_c_values_row);
 
     for (unsigned i=0; i<16; i++) {
         mu_assert("calculate_c_values error ws=3",
@@ -414,7 +443,7 @@ static char *test_calculate_c_values()
     uint16_t histograms_8x8[8*1032];
     calculate_c_values(&input_8x8, &mask_8x8, combined_c_values_8x8, histograms_8x8,
                        window_size, num_diffs, tvi_for_diff, diff_weights, all_diffs, 8, 8, 
-                       increment_range, decrement_range);
+                       increment_range, decrement_range, calculate_c_values_row);
 
     double sum = 0;
     for (unsigned i = 0; i < 64; i++) {
@@ -476,16 +505,16 @@ static char *test_spatial_pooling()
 {
     float arr[12] = {0, 1, 2, 3, 4, 5, 10, 7, 8, 9, 6, 11};
 
-    double average = spatial_pooling(arr, 0, 4, 3);
+    double average = spatial_pooling(arr, 0, 4, 3, average_topk_elements_select, NULL);
     mu_assert("spatial_pooling for topk=0", average==11);
 
-    average = spatial_pooling(arr, 0.1, 4, 3);
+    average = spatial_pooling(arr, 0.1, 4, 3, average_topk_elements_select, NULL);
     mu_assert("spatial_pooling for topk=0.1", average==11);
 
-    average = spatial_pooling(arr, 0.2, 4, 3);
+    average = spatial_pooling(arr, 0.2, 4, 3, average_topk_elements_select, NULL);
     mu_assert("spatial_pooling for topk=0.2", average==10.5);
 
-    average = spatial_pooling(arr, 1.0, 4, 3);
+    average = spatial_pooling(arr, 1.0, 4, 3, average_topk_elements_select, NULL);
     mu_assert("spatial_pooling for topk=1.0", average==5.5);
 
     return NULL;
@@ -708,6 +737,279 @@ static char *test_tvi_hard_threshold_condition()
     return NULL;
 }
 
+/* SIMD kernels, compared against the scalar reference implementations */
+static char *test_simd_preprocessing_kernels()
+{
+    CambiState scalar, simd;
+    vmaf_init_cpu();
+    init_callbacks(&scalar, 0);
+    init_callbacks(&simd, vmaf_get_cpu_flags());
+
+    const unsigned w = 263, h = 147;
+    VmafPicture pic, pic_simd;
+    int err = get_banded_image(&pic, 10, w, h, 1);
+    err |= copy_picture(&pic_simd, &pic);
+    mu_assert("test_simd_preprocessing_kernels alloc error", !err);
+    ptrdiff_t stride = pic.stride[0] >> 1;
+
+    scalar.anti_dithering_callback(pic.data[0], w, h, stride);
+    simd.anti_dithering_callback(pic_simd.data[0], w, h, stride);
+    mu_assert("anti_dithering_filter simd output differs", pic_data_equality(&pic, &pic_simd));
+
+    uint16_t *buffer = malloc(3 * w * sizeof(uint16_t));
+    uint16_t *buffer_simd = malloc(3 * w * sizeof(uint16_t));
+    mu_assert("test_simd_preprocessing_kernels buffer alloc error", buffer && buffer_simd);
+    scalar.filter_mode_callback(pic.data[0], w, h, stride, buffer);
+    simd.filter_mode_callback(pic_simd.data[0], w, h, stride, buffer_simd);
+    mu_assert("filter_mode simd output differs", pic_data_equality(&pic, &pic_simd));
+
+    unsigned scaled_w = w, scaled_h = h;
+    for (unsigned scale = 1; scale < NUM_SCALES; scale++) {
+        scaled_w = (scaled_w + 1) >> 1;
+        scaled_h = (scaled_h + 1) >> 1;
+        scalar.decimate_callback(pic.data[0], scaled_w, scaled_h, stride);
+        simd.decimate_callback(pic_simd.data[0], scaled_w, scaled_h, stride);
+        mu_assert("decimate simd output differs", pic_data_equality(&pic, &pic_simd));
+    }
+
+    free(buffer);
+    free(buffer_simd);
+    vmaf_picture_unref(&pic);
+    vmaf_picture_unref(&pic_simd);
+
+    return NULL;
+}
+
+static char *test_simd_spatial_mask()
+{
+    CambiState scalar, simd;
+    vmaf_init_cpu();
+    init_callbacks(&scalar, 0);
+    init_callbacks(&simd, vmaf_get_cpu_flags());
+
+    const unsigned w = 263, h = 147;
+    VmafPicture image, mask, mask_simd;
+    int err = get_banded_image(&image, 10, w, h, 2);
+    err |= vmaf_picture_alloc(&mask, VMAF_PIX_FMT_YUV400P, 10, w, h);
+    err |= vmaf_picture_alloc(&mask_simd, VMAF_PIX_FMT_YUV400P, 10, w, h);
+    mu_assert("test_simd_spatial_mask alloc error", !err);
+
+    const int pad_size = MASK_FILTER_SIZE >> 1;
+    uint32_t *dp = malloc((w + 2 * pad_size + 1) * (2 * pad_size + 2) * sizeof(uint32_t));
+    uint16_t *derivative_buffer = malloc(w * sizeof(uint16_t));
+    mu_assert("test_simd_spatial_mask buffer alloc error", dp && derivative_buffer);
+
+    get_spatial_mask(&image, &mask, dp, derivative_buffer, w, h,
+                     scalar.derivative_callback, scalar.spatial_mask_row_callback);
+    get_spatial_mask(&image, &mask_simd, dp, derivative_buffer, w, h,
+                     simd.derivative_callback, simd.spatial_mask_row_callback);
+    mu_assert("spatial mask simd output differs", pic_data_equality(&mask, &mask_simd));
+    mu_assert("spatial mask should be partially set", data_pic_sum(&mask) > 0);
+
+    free(dp);
+    free(derivative_buffer);
+    vmaf_picture_unref(&image);
+    vmaf_picture_unref(&mask);
+    vmaf_picture_unref(&mask_simd);
+
+    return NULL;
+}
+
+static char *test_simd_calculate_c_values()
+{
+    CambiState scalar, simd;
+    vmaf_init_cpu();
+    init_callbacks(&scalar, 0);
+    init_callbacks(&simd, vmaf_get_cpu_flags());
+
+    const unsigned w = 263, h = 147;
+    const uint16_t num_diffs = 4;
+    const uint16_t window_size = 9;
+    uint16_t tvi_for_diff[4] = {178 + 4, 305 + 4, 432 + 4, 559 + 4};
+    uint16_t *diffs_to_consider = NULL;
+    int *diff_weights = NULL;
+    int *all_diffs = NULL;
+    int err = set_contrast_arrays(num_diffs, &diffs_to_consider, &diff_weights, &all_diffs);
+    mu_assert("test_simd_calculate_c_values contrast arrays error", !err);
+
+    VmafPicture image, mask;
+    err |= get_banded_image(&image, 10, w, h, 3);
+    err |= get_banded_image(&mask, 10, w, h, 4);
+    mu_assert("test_simd_calculate_c_values alloc error", !err);
+    uint16_t *mask_data = mask.data[0];
+    ptrdiff_t stride = mask.stride[0] >> 1;
+    for (unsigned i = 0; i < h; i++) {
+        for (unsigned j = 0; j < w; j++)
+            mask_data[i * stride + j] = (mask_data[i * stride + j] & 8) == 0;
+    }
+
+    const unsigned num_bins = 1024 + 2 * num_diffs;
+    // SIMD kernels gather 32 bits per histogram entry, see the padding in init()
+    uint16_t *histograms = aligned_malloc(ALIGN_CEIL(w * num_bins * sizeof(uint16_t)) + 32, 32);
+    float *c_values = aligned_malloc(w * h * sizeof(float), 32);
+    float *c_values_simd = aligned_malloc(w * h * sizeof(float), 32);
+    mu_assert("test_simd_calculate_c_values buffer alloc error", histograms && c_values && c_values_simd);
+
+    calculate_c_values(&image, &mask, c_values, histograms, window_size, num_diffs, tvi_for_diff,
+                       diff_weights, all_diffs, w, h, scalar.inc_range_callback,
+                       scalar.dec_range_callback, scalar.c_values_row_callback);
+    calculate_c_values(&image, &mask, c_values_simd, histograms, window_size, num_diffs, tvi_for_diff,
+                       diff_weights, all_diffs, w, h, simd.inc_range_callback,
+                       simd.dec_range_callback, simd.c_values_row_callback);
+
+    double sum = 0.;
+    for (unsigned i = 0; i < w * h; i++)
+        sum += c_values[i];
+    mu_assert("c_values should not be all zero", sum > 0.);
+    mu_assert("calculate_c_values simd output differs",
+              !memcmp(c_values, c_values_simd, w * h * sizeof(float)));
+
+    aligned_free(histograms);
+    aligned_free(c_values);
+    aligned_free(c_values_simd);
+    aligned_free(diffs_to_consider);
+    aligned_free(diff_weights);
+    aligned_free(all_diffs);
+    vmaf_picture_unref(&image);
+    vmaf_picture_unref(&mask);
+
+    return NULL;
+}
+
+static char *test_simd_spatial_pooling()
+{
+    CambiState scalar, simd;
+    vmaf_init_cpu();
+    init_callbacks(&scalar, 0);
+    init_callbacks(&simd, vmaf_get_cpu_flags());
+
+    const unsigned w = 263, h = 147;
+    float *arr = malloc(w * h * sizeof(float));
+    float *arr_simd = malloc(w * h * sizeof(float));
+    float *buffer = malloc(w * h * sizeof(float));
+    mu_assert("test_simd_spatial_pooling alloc error", arr && arr_simd && buffer);
+
+    const double topk[5] = {0.0001, 0.01, 0.2, 0.6, 1.0};
+    unsigned seed = 5;
+    for (unsigned i = 0; i < w * h; i++) {
+        seed = seed * 1103515245 + 12345;
+        // many zeros and repeated values, as in real c_values
+        arr[i] = (seed >> 16) % 3 ? 0.f : (float)((seed >> 8) % 97) / 7.f;
+    }
+    for (unsigned t = 0; t < 5; t++) {
+        for (unsigned n = 1; n <= w * h; n = n * 3 + 1) {
+            memcpy(arr_simd, arr, w * h * sizeof(float));
+            double average_simd = spatial_pooling(arr_simd, topk[t], n, 1, simd.topk_callback, buffer);
+            memcpy(arr_simd, arr, w * h * sizeof(float));
+            double average = spatial_pooling(arr_simd, topk[t], n, 1, scalar.topk_callback, NULL);
+            mu_assert("spatial_pooling simd output differs", almost_equal(average, average_simd));
+        }
+    }
+
+    free(arr);
+    free(arr_simd);
+    free(buffer);
+
+    return NULL;
+}
+
+static char *test_simd_cambi_score()
+{
+    const unsigned w = 384, h = 216;
+    const unsigned bpc[2] = {8, 10};
+
+    vmaf_init_cpu();
+    for (unsigned b = 0; b < 2; b++) {
+        VmafFeatureExtractor fex = vmaf_fex_cambi;
+        CambiState *s = fex.priv = calloc(1, sizeof(CambiState));
+        mu_assert("test_simd_cambi_score alloc error", s);
+        s->window_size = DEFAULT_CAMBI_WINDOW_SIZE;
+        s->topk = DEFAULT_CAMBI_TOPK_POOLING;
+        s->tvi_threshold = DEFAULT_CAMBI_TVI;
+        s->max_log_contrast = DEFAULT_CAMBI_MAX_LOG_CONTRAST;
+        s->eotf = DEFAULT_CAMBI_EOTF;
+        int err = fex.init(&fex, VMAF_PIX_FMT_YUV400P, bpc[b], w, h);
+        mu_assert("test_simd_cambi_score init error", !err);
+
+        VmafPicture pic;
+        err = get_banded_image(&pic, bpc[b], w, h, 6);
+        mu_assert("test_simd_cambi_score picture alloc error", !err);
+
+        double score, score_simd;
+        init_callbacks(s, 0);
+        err = preprocess_and_extract_cambi(s, &pic, &score, false, 0);
+        mu_assert("test_simd_cambi_score scalar extract error", !err);
+        init_callbacks(s, vmaf_get_cpu_flags());
+        err = preprocess_and_extract_cambi(s, &pic, &score_simd, false, 0);
+        mu_assert("test_simd_cambi_score simd extract error", !err);
+        mu_assert("cambi score should be non-zero for a banded image", score > 0.);
+        mu_assert("cambi simd score differs", almost_equal(score, score_simd));
+
+        vmaf_picture_unref(&pic);
+        fex.close(&fex);
+        free(s);
+    }
+
+    return NULL;
+}
+
+static char *test_threaded_cambi_score()
+{
+    const unsigned w = 1024, h = 216;
+
+    VmafThreadPool *pool;
+    int err = vmaf_thread_pool_create(&pool, 4);
+    mu_assert("test_threaded_cambi_score thread pool error", !err);
+
+    VmafFeatureExtractor fex = vmaf_fex_cambi;
+    fex.thread_pool = pool;
+    CambiState *s = fex.priv = calloc(1, sizeof(CambiState));
+    mu_assert("test_threaded_cambi_score alloc error", s);
+    s->window_size = DEFAULT_CAMBI_WINDOW_SIZE;
+    s->topk = DEFAULT_CAMBI_TOPK_POOLING;
+    s->tvi_threshold = DEFAULT_CAMBI_TVI;
+    s->max_log_contrast = DEFAULT_CAMBI_MAX_LOG_CONTRAST;
+    s->eotf = DEFAULT_CAMBI_EOTF;
+    s->full_ref = true;
+    err = fex.init(&fex, VMAF_PIX_FMT_YUV400P, 10, w, h);
+    mu_assert("test_threaded_cambi_score init error", !err);
+    mu_assert("source pipeline should have its own buffers", s->src_buffers.c_values);
+
+    VmafPicture ref, dist;
+    err = get_banded_image(&ref, 10, w, h, 3);
+    err |= get_banded_image(&dist, 10, w, h, 7);
+    mu_assert("test_threaded_cambi_score picture alloc error", !err);
+
+    VmafFeatureCollector *fc;
+    err = vmaf_feature_collector_init(&fc);
+    mu_assert("test_threaded_cambi_score collector error", !err);
+    err = fex.extract(&fex, &ref, NULL, &dist, NULL, 0, fc);
+    mu_assert("test_threaded_cambi_score extract error", !err);
+
+    double dist_score, src_score;
+    err = vmaf_feature_collector_get_score(fc, "cambi", &dist_score, 0);
+    err |= vmaf_feature_collector_get_score(fc, "cambi_source", &src_score, 0);
+    mu_assert("test_threaded_cambi_score missing scores", !err);
+
+    s->thread_pool = NULL;
+    double dist_serial, src_serial;
+    err = preprocess_and_extract_cambi(s, &dist, &dist_serial, false, 0);
+    err |= preprocess_and_extract_cambi(s, &ref, &src_serial, true, 0);
+    mu_assert("test_threaded_cambi_score serial extract error", !err);
+    mu_assert("threaded cambi score differs", dist_score == dist_serial);
+    mu_assert("threaded cambi_source score differs", src_score == src_serial);
+
+    s->thread_pool = pool;
+    vmaf_feature_collector_destroy(fc);
+    vmaf_picture_unref(&ref);
+    vmaf_picture_unref(&dist);
+    fex.close(&fex);
+    free(s);
+    vmaf_thread_pool_destroy(pool);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     /* Preprocessing functions */
@@ -739,5 +1041,13 @@ char *run_tests()
     mu_run_test(test_set_contrast_arrays);
     mu_run_test(test_tvi_hard_threshold_condition);
 
+    /* SIMD kernels */
+    mu_run_test(test_simd_preprocessing_kernels);
+    mu_run_test(test_simd_spatial_mask);
+    mu_run_test(test_simd_calculate_c_values);
+    mu_run_test(test_simd_spatial_pooling);
+    mu_run_test(test_simd_cambi_score);
+    mu_run_test(test_threaded_cambi_score);
+
     return NULL;
 }
\ No newline at end of file
@@ -16,6 +16,12 @@
  *
  */
 
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
 #include "test.h"
 #include "libvmaf/libvmaf.h"
 
@@ -33,6 +39,26 @@ static char *test_context_init_and_close()
     return NULL;
 }
 
+static char *test_context_init_errors()
+{
+    VmafContext *vmaf;
+    VmafConfiguration cfg = {
+        .log_level = VMAF_LOG_LEVEL_NONE,
+        .cpu_affinity = "0",
+    };
+
+    int err = vmaf_init(&vmaf, cfg);
+    mu_assert("cpu_affinity requires threads", err == -EINVAL);
+
+    cfg.n_threads = 1;
+    cfg.cpu_affinity = "node:x";
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("invalid cpu_affinity should be reported as such",
+              err == -EINVAL);
+
+    return NULL;
+}
+
 static char *test_get_feature_score()
 {
     int err = 0;
@@ -70,9 +96,557 @@ static char *test_get_feature_score()
     return NULL;
 }
 
+static int alloc_frame(VmafPicture *ref, VmafPicture *dist,
+                       unsigned ref_seed, unsigned dist_seed)
+{
+    int err = 0;
+    err |= vmaf_picture_alloc(ref, VMAF_PIX_FMT_YUV420P, 8, 64, 48);
+    err |= vmaf_picture_alloc(dist, VMAF_PIX_FMT_YUV420P, 8, 64, 48);
+    if (err) return err;
+    for (unsigned p = 0; p < 3; p++) {
+        uint8_t *r = ref->data[p], *d = dist->data[p];
+        for (unsigned y = 0; y < ref->h[p]; y++) {
+            for (unsigned x = 0; x < ref->w[p]; x++) {
+                r[y * ref->stride[p] + x] = (x * ref_seed + y * 3) & 0xff;
+                d[y * dist->stride[p] + x] = (x * dist_seed + y * 3) & 0xff;
+            }
+        }
+    }
+    return 0;
+}
+
+static int read_frame(VmafContext *vmaf, unsigned ref_seed,
+                      unsigned dist_seed, unsigned index)
+{
+    VmafPicture ref, dist;
+    int err = alloc_frame(&ref, &dist, ref_seed, dist_seed);
+    if (err) return err;
+    return vmaf_read_pictures(vmaf, &ref, &dist, index);
+}
+
+static char *test_unchanged_frames()
+{
+    int err = 0;
+    VmafContext *vmaf;
+    VmafConfiguration cfg = { 0 };
+
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+    err = vmaf_use_feature(vmaf, "float_ssim", NULL);
+    err |= vmaf_use_feature(vmaf, "motion", NULL);
+    mu_assert("problem during vmaf_use_feature", !err);
+
+    // frames 1 and 2 repeat frame 0, frame 3 only repeats the reference
+    const unsigned seed[][2] = { { 7, 5 }, { 7, 5 }, { 7, 5 }, { 7, 6 }, { 9, 6 } };
+    for (unsigned i = 0; i < 5; i++) {
+        err = read_frame(vmaf, seed[i][0], seed[i][1], i);
+        mu_assert("problem during vmaf_read_pictures", !err);
+    }
+    err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+    mu_assert("problem flushing context", !err);
+
+    double ssim[5], motion2[5];
+    for (unsigned i = 0; i < 5; i++) {
+        err = vmaf_feature_score_at_index(vmaf, "float_ssim", &ssim[i], i);
+        err |= vmaf_feature_score_at_index(vmaf,
+                "VMAF_integer_feature_motion2_score", &motion2[i], i);
+        mu_assert("problem during vmaf_feature_score_at_index", !err);
+    }
+    mu_assert("repeated frames should repeat spatial scores",
+              ssim[1] == ssim[0] && ssim[2] == ssim[0]);
+    mu_assert("a changed distorted frame should be extracted",
+              ssim[3] != ssim[0]);
+    mu_assert("repeated references have no motion",
+              motion2[1] == 0. && motion2[2] == 0. && motion2[3] == 0.);
+    mu_assert("changed references have motion", motion2[4] != 0.);
+
+    err = vmaf_close(vmaf);
+    mu_assert("problem during vmaf_close", !err);
+
+    return NULL;
+}
+
+static char *test_import_feature_scores()
+{
+    int err = 0;
+    VmafContext *vmaf;
+    VmafConfiguration cfg = { 0 };
+
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+
+    const double a[5] = { 1. / 3, 2. / 3, 1., 4. / 3, 5. / 3 };
+    const double b[2] = { 0.1, 0.2 };
+    err = vmaf_import_feature_scores(vmaf, "a", a, 0, 5);
+    err |= vmaf_import_feature_scores(vmaf, "b", b, 2, 2);
+    err |= vmaf_import_feature_scores(vmaf, "vmaf_x", b, 0, 2);
+    mu_assert("problem during vmaf_import_feature_scores", !err);
+    err = vmaf_import_feature_scores(vmaf, "b", b, 3, 2);
+    mu_assert("overlapping scores should not be imported", err);
+    double score;
+    err = vmaf_feature_score_at_index(vmaf, "b", &score, 4);
+    mu_assert("a failed import should not write any score", err);
+
+    err = vmaf_write_output(vmaf, "test_import.bin", VMAF_OUTPUT_FORMAT_BINARY);
+    err |= vmaf_write_output(vmaf, "test_import.json", VMAF_OUTPUT_FORMAT_JSON);
+    mu_assert("problem during vmaf_write_output", !err);
+    err = vmaf_close(vmaf);
+    mu_assert("problem during vmaf_close", !err);
+
+    const char *const path[2] = { "test_import.bin", "test_import.json" };
+    const char *const exclude[] = { "vmaf", NULL };
+    for (unsigned i = 0; i < 2; i++) {
+        err = vmaf_init(&vmaf, cfg);
+        mu_assert("problem during vmaf_init", !err);
+        unsigned frame_cnt;
+        err = vmaf_import_feature_scores_from_path(vmaf, path[i], exclude,
+                                                   &frame_cnt);
+        mu_assert("problem during vmaf_import_feature_scores_from_path", !err);
+        mu_assert("frame_cnt should cover all scores", frame_cnt == 5);
+
+        for (unsigned j = 0; j < 5; j++) {
+            err = vmaf_feature_score_at_index(vmaf, "a", &score, j);
+            mu_assert("problem during vmaf_feature_score_at_index", !err);
+            if (i == 0)
+                mu_assert("binary scores should be exact", score == a[j]);
+            else
+                mu_assert("json scores should be rounded",
+                          score > a[j] - 1e-6 && score < a[j] + 1e-6);
+        }
+        err = vmaf_feature_score_at_index(vmaf, "b", &score, 3);
+        mu_assert("problem during vmaf_feature_score_at_index", !err);
+        mu_assert("imported score should match", score == b[1]);
+        err = vmaf_feature_score_at_index(vmaf, "b", &score, 1);
+        mu_assert("unwritten scores should not be imported", err);
+        err = vmaf_feature_score_at_index(vmaf, "vmaf_x", &score, 0);
+        mu_assert("excluded scores should not be imported", err);
+
+        err = vmaf_close(vmaf);
+        mu_assert("problem during vmaf_close", !err);
+        remove(path[i]);
+    }
+
+    return NULL;
+}
+
+static char *test_scratch_arena()
+{
+    int err = 0;
+    const unsigned arena[2] = {
+        0, VMAF_SCRATCH_ARENA_HUGE_PAGES | VMAF_SCRATCH_ARENA_PREFAULT,
+    };
+    double adm2[2][3], vif[2][3];
+
+    for (unsigned a = 0; a < 2; a++) {
+        VmafContext *vmaf;
+        VmafConfiguration cfg = { .n_threads = 2, .scratch_arena = arena[a] };
+        err = vmaf_init(&vmaf, cfg);
+        mu_assert("problem during vmaf_init", !err);
+        err = vmaf_use_feature(vmaf, "adm", NULL);
+        err |= vmaf_use_feature(vmaf, "vif", NULL);
+        err |= vmaf_use_feature(vmaf, "float_motion", NULL);
+        mu_assert("problem during vmaf_use_feature", !err);
+
+        for (unsigned i = 0; i < 3; i++) {
+            err = read_frame(vmaf, i + 1, i + 4, i);
+            mu_assert("problem during vmaf_read_pictures", !err);
+        }
+        err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+        mu_assert("problem flushing context", !err);
+
+        for (unsigned i = 0; i < 3; i++) {
+            err = vmaf_feature_score_at_index(vmaf,
+                    "VMAF_integer_feature_adm2_score", &adm2[a][i], i);
+            err |= vmaf_feature_score_at_index(vmaf,
+                    "VMAF_integer_feature_vif_scale0_score", &vif[a][i], i);
+            mu_assert("problem during vmaf_feature_score_at_index", !err);
+        }
+
+        VmafArenaStats stats;
+        err = vmaf_get_arena_stats(vmaf, &stats);
+        mu_assert("problem during vmaf_get_arena_stats", !err);
+        if (a) {
+            mu_assert("arena should hold the extractor scratch",
+                      stats.peak && stats.reserved >= stats.peak);
+        } else {
+            mu_assert("no arena should report no usage",
+                      !stats.peak && !stats.reserved && !stats.huge_pages);
+        }
+
+        err = vmaf_close(vmaf);
+        mu_assert("problem during vmaf_close", !err);
+    }
+
+    for (unsigned i = 0; i < 3; i++) {
+        mu_assert("arena scratch should not change scores",
+                  adm2[0][i] == adm2[1][i] && vif[0][i] == vif[1][i]);
+    }
+
+    return NULL;
+}
+
+static char *test_shared_executor()
+{
+    int err = 0;
+    VmafExecutor *executor;
+    VmafExecutorConfiguration executor_cfg = { .n_threads = 2 };
+    err = vmaf_executor_create(&executor, executor_cfg);
+    mu_assert("problem during vmaf_executor_create", !err);
+
+    // two contexts read interleaved on the executor, a third on its own
+    VmafContext *vmaf[3];
+    double adm2[3][3], vif[3][3];
+    for (unsigned c = 0; c < 3; c++) {
+        VmafConfiguration cfg = { .n_threads = 2 };
+        if (c < 2) cfg.executor = executor;
+        err = vmaf_init(&vmaf[c], cfg);
+        mu_assert("problem during vmaf_init", !err);
+        err = vmaf_use_feature(vmaf[c], "adm", NULL);
+        err |= vmaf_use_feature(vmaf[c], "vif", NULL);
+        mu_assert("problem during vmaf_use_feature", !err);
+    }
+
+    for (unsigned i = 0; i < 3; i++) {
+        for (unsigned c = 0; c < 3; c++) {
+            err = read_frame(vmaf[c], i + 1, i + 4, i);
+            mu_assert("problem during vmaf_read_pictures", !err);
+        }
+    }
+    for (unsigned c = 0; c < 3; c++) {
+        err = vmaf_read_pictures(vmaf[c], NULL, NULL, 0);
+        mu_assert("problem flushing context", !err);
+        for (unsigned i = 0; i < 3; i++) {
+            err = vmaf_feature_score_at_index(vmaf[c],
+                    "VMAF_integer_feature_adm2_score", &adm2[c][i], i);
+            err |= vmaf_feature_score_at_index(vmaf[c],
+                    "VMAF_integer_feature_vif_scale0_score", &vif[c][i], i);
+            mu_assert("problem during vmaf_feature_score_at_index", !err);
+        }
+    }
+
+    err = vmaf_close(vmaf[0]);
+    mu_assert("problem during vmaf_close", !err);
+    mu_assert("executor in use should not be destroyed",
+              vmaf_executor_destroy(executor) == -EBUSY);
+    err = vmaf_close(vmaf[1]);
+    err |= vmaf_close(vmaf[2]);
+    mu_assert("problem during vmaf_close", !err);
+    err = vmaf_executor_destroy(executor);
+    mu_assert("problem during vmaf_executor_destroy", !err);
+
+    for (unsigned c = 0; c < 2; c++) {
+        for (unsigned i = 0; i < 3; i++) {
+            mu_assert("a shared executor should not change scores",
+                      adm2[c][i] == adm2[2][i] && vif[c][i] == vif[2][i]);
+        }
+    }
+
+    return NULL;
+}
+
+static char *test_segments()
+{
+    int err = 0;
+    double serial[6], segment[6];
+
+    // frames 0-2 and 3-5 scored apart, with frames either side extracted
+    // for motion, match a serial run
+    for (unsigned k = 0; k < 3; k++) {
+        VmafContext *vmaf;
+        VmafConfiguration cfg = { .n_threads = 2 };
+        err = vmaf_init(&vmaf, cfg);
+        mu_assert("problem during vmaf_init", !err);
+        err = vmaf_use_feature(vmaf, "motion", NULL);
+        mu_assert("problem during vmaf_use_feature", !err);
+
+        const unsigned low = k == 2 ? 3 : 0, high = k == 1 ? 2 : 5;
+        if (k) {
+            err = vmaf_set_read_range(vmaf, low, high);
+            mu_assert("problem during vmaf_set_read_range", !err);
+        }
+        // the second segment warms up with two frames, more than needed
+        const unsigned first = low ? low - 2 : low;
+        const unsigned last = high < 5 ? high + 1 : high;
+        for (unsigned i = first; i <= last; i++) {
+            err = read_frame(vmaf, i + 1, i + 4, i);
+            mu_assert("problem during vmaf_read_pictures", !err);
+        }
+        err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+        mu_assert("problem flushing context", !err);
+
+        for (unsigned i = 0; i < 6; i++) {
+            double score;
+            err = vmaf_feature_score_at_index(vmaf,
+                    "VMAF_integer_feature_motion2_score", &score, i);
+            if (i < low || i > high) {
+                mu_assert("frames outside a segment should not be scored",
+                          err);
+                continue;
+            }
+            mu_assert("problem during vmaf_feature_score_at_index", !err);
+            if (k) segment[i] = score;
+            else serial[i] = score;
+        }
+
+        if (k == 2) {
+            err = vmaf_write_output(vmaf, "test_segment.bin",
+                                    VMAF_OUTPUT_FORMAT_BINARY);
+            mu_assert("problem during vmaf_write_output", !err);
+        }
+        err = vmaf_close(vmaf);
+        mu_assert("problem during vmaf_close", !err);
+    }
+
+    for (unsigned i = 0; i < 6; i++)
+        mu_assert("segments should match a serial run", segment[i] == serial[i]);
+
+    VmafContext *vmaf;
+    VmafConfiguration cfg = { 0 };
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+    unsigned low, high;
+    err = vmaf_import_segment_from_path(vmaf, "test_segment.bin", NULL,
+                                        &low, &high);
+    mu_assert("problem during vmaf_import_segment_from_path", !err);
+    mu_assert("segment bounds should be those it read", low == 3 && high == 5);
+    err = vmaf_close(vmaf);
+    mu_assert("problem during vmaf_close", !err);
+    remove("test_segment.bin");
+
+    // aggregates over all pictures can not be merged from segments
+    cfg.log_level = VMAF_LOG_LEVEL_NONE;
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+    VmafFeatureDictionary *d = NULL;
+    err = vmaf_feature_dictionary_set(&d, "enable_apsnr", "true");
+    mu_assert("problem during vmaf_feature_dictionary_set", !err);
+    err = vmaf_use_feature(vmaf, "psnr", d);
+    mu_assert("problem during vmaf_use_feature", !err);
+    err = vmaf_set_read_range(vmaf, 3, 5);
+    mu_assert("a range with apsnr should be refused", err == -EINVAL);
+    err = vmaf_close(vmaf);
+    mu_assert("problem during vmaf_close", !err);
+
+    return NULL;
+}
+
+static char *test_output_range()
+{
+    int err = 0;
+    VmafContext *vmaf;
+    VmafConfiguration cfg = { 0 };
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+
+    // frames 0-1 and 4-5 of 8 are scored
+    const unsigned index[] = { 0, 1, 4, 5 };
+    for (unsigned i = 0; i < 4; i++)
+        err |= vmaf_import_feature_score(vmaf, "feature_a", 10. * i, index[i]);
+    mu_assert("problem during vmaf_import_feature_score", !err);
+
+    VmafPooledEstimate est;
+    err = vmaf_feature_score_pooled_estimate(vmaf, "feature_a",
+                                             VMAF_POOL_METHOD_MEAN, &est, 0, 7);
+    mu_assert("problem during vmaf_feature_score_pooled_estimate", !err);
+    mu_assert("estimate should pool the frames scored",
+              est.score == 15. && est.n_scored == 4);
+    mu_assert("interval should cover the estimate",
+              est.ci.lo <= est.score && est.ci.hi >= est.score);
+
+    err = vmaf_set_output_range(vmaf, 0, 7);
+    mu_assert("problem during vmaf_set_output_range", !err);
+    err = vmaf_write_output(vmaf, "test_output_range.json",
+                            VMAF_OUTPUT_FORMAT_JSON);
+    mu_assert("problem during vmaf_write_output", !err);
+
+    char buf[4096];
+    FILE *in = fopen("test_output_range.json", "r");
+    mu_assert("problem opening output", in);
+    const size_t sz = fread(buf, 1, sizeof(buf) - 1, in);
+    buf[sz] = '\0';
+    fclose(in);
+    remove("test_output_range.json");
+    mu_assert("output should pool the frames scored",
+              strstr(buf, "\"mean\": 15.000000"));
+    mu_assert("output should have the estimate",
+              strstr(buf, "\"ci_p95_lo\"") && strstr(buf, "\"n_scored\": 4"));
+
+    err = vmaf_close(vmaf);
+    mu_assert("problem during vmaf_close", !err);
+
+    return NULL;
+}
+
+static char *test_checkpoint()
+{
+    int err = 0;
+    double serial[6], resumed[6];
+
+    // a run interrupted after 3 of 6 frames resumes from its checkpoint
+    for (unsigned k = 0; k < 3; k++) {
+        VmafContext *vmaf;
+        VmafConfiguration cfg = { .n_threads = 2 };
+        err = vmaf_init(&vmaf, cfg);
+        mu_assert("problem during vmaf_init", !err);
+        err = vmaf_use_feature(vmaf, "motion", NULL);
+        mu_assert("problem during vmaf_use_feature", !err);
+
+        unsigned first = 0, last = k == 1 ? 2 : 5;
+        if (k == 2) {
+            err = vmaf_read_checkpoint(vmaf, "test_checkpoint.bin", &first);
+            mu_assert("problem during vmaf_read_checkpoint", !err);
+            mu_assert("the last frame read should be left for motion",
+                      first == 2);
+            first--;
+        }
+        for (unsigned i = first; i <= last; i++) {
+            err = read_frame(vmaf, i + 1, i + 4, i);
+            mu_assert("problem during vmaf_read_pictures", !err);
+        }
+        if (k == 1) {
+            unsigned index;
+            err = vmaf_write_checkpoint(vmaf, "test_checkpoint.bin", &index);
+            mu_assert("problem during vmaf_write_checkpoint", !err);
+            mu_assert("checkpoint should hold complete frames", index == 2);
+            err = vmaf_close(vmaf);
+            mu_assert("problem during vmaf_close", !err);
+            continue;
+        }
+        err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+        mu_assert("problem flushing context", !err);
+
+        for (unsigned i = 0; i < 6; i++) {
+            double score;
+            err = vmaf_feature_score_at_index(vmaf,
+                    "VMAF_integer_feature_motion2_score", &score, i);
+            mu_assert("problem during vmaf_feature_score_at_index", !err);
+            if (k) resumed[i] = score;
+            else serial[i] = score;
+        }
+
+        err = vmaf_close(vmaf);
+        mu_assert("problem during vmaf_close", !err);
+    }
+
+    for (unsigned i = 0; i < 6; i++)
+        mu_assert("a resumed run should match a serial one",
+                  resumed[i] == serial[i]);
+
+    // aggregates over all pictures would leave out the checkpointed ones
+    VmafContext *vmaf;
+    VmafConfiguration cfg = { .log_level = VMAF_LOG_LEVEL_NONE };
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+    VmafFeatureDictionary *d = NULL;
+    err = vmaf_feature_dictionary_set(&d, "enable_apsnr", "true");
+    mu_assert("problem during vmaf_feature_dictionary_set", !err);
+    err = vmaf_use_feature(vmaf, "psnr", d);
+    mu_assert("problem during vmaf_use_feature", !err);
+    unsigned index;
+    err = vmaf_read_checkpoint(vmaf, "test_checkpoint.bin", &index);
+    mu_assert("resuming apsnr should be refused", err == -EINVAL);
+    err = read_frame(vmaf, 1, 4, 0);
+    mu_assert("problem during vmaf_read_pictures", !err);
+    err = vmaf_write_checkpoint(vmaf, "test_checkpoint.bin", NULL);
+    mu_assert("checkpointing apsnr should be refused", err == -EINVAL);
+    err = vmaf_close(vmaf);
+    mu_assert("problem during vmaf_close", !err);
+    remove("test_checkpoint.bin");
+
+    return NULL;
+}
+
+typedef struct FrameLog {
+    unsigned index[8];
+    double vmaf[8], motion2[8];
+    unsigned cnt;
+} FrameLog;
+
+static void log_frame(void *data, const VmafFrameScores *frame)
+{
+    FrameLog *log = data;
+    const unsigned i = log->cnt++;
+    log->index[i] = frame->index;
+    log->vmaf[i] = log->motion2[i] = -1.;
+    for (unsigned j = 0; j < frame->cnt; j++) {
+        if (!strcmp(frame->feature_name[j], "vmaf"))
+            log->vmaf[i] = frame->score[j];
+        if (!strcmp(frame->feature_name[j],
+                    "VMAF_integer_feature_motion2_score"))
+            log->motion2[i] = frame->score[j];
+    }
+}
+
+static char *test_frame_callback()
+{
+    int err = 0;
+    VmafContext *vmaf;
+    VmafConfiguration cfg = { .n_threads = 2 };
+    err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+
+    VmafModel *model;
+    VmafModelConfig model_cfg = { 0 };
+    err = vmaf_model_load(&model, &model_cfg, "vmaf_v0.6.1");
+    mu_assert("problem during vmaf_model_load", !err);
+    err = vmaf_use_features_from_model(vmaf, model);
+    mu_assert("problem during vmaf_use_features_from_model", !err);
+
+    FrameLog log = { 0 };
+    VmafFrameCallbackConfiguration frame_cfg = {
+        .callback = log_frame,
+        .data = &log,
+        .flags = VMAF_FRAME_CALLBACK_IN_ORDER,
+        .max_pending = 2,
+    };
+    err = vmaf_read_pictures_async(vmaf, NULL, NULL, 0);
+    mu_assert("async reads should need a frame callback", err == -EINVAL);
+    err = vmaf_register_frame_callback(vmaf, frame_cfg);
+    mu_assert("problem during vmaf_register_frame_callback", !err);
+
+    for (unsigned i = 0; i < 6; i++) {
+        VmafPicture ref, dist;
+        err = alloc_frame(&ref, &dist, i + 1, i + 4);
+        mu_assert("problem during vmaf_picture_alloc", !err);
+        const struct timespec backoff = { .tv_nsec = 100000 };
+        while ((err = vmaf_read_pictures_async(vmaf, &ref, &dist, i)) == -EAGAIN)
+            nanosleep(&backoff, NULL);
+        mu_assert("problem during vmaf_read_pictures_async", !err);
+    }
+    err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+    mu_assert("problem flushing context", !err);
+
+    mu_assert("every frame should be passed once", log.cnt == 6);
+    for (unsigned i = 0; i < 6; i++) {
+        double score, motion2;
+        err = vmaf_score_at_index(vmaf, model, &score, i);
+        err |= vmaf_feature_score_at_index(vmaf,
+                "VMAF_integer_feature_motion2_score", &motion2, i);
+        mu_assert("problem during vmaf_score_at_index", !err);
+        mu_assert("frames should be passed in order", log.index[i] == i);
+        mu_assert("frames should be passed with their final scores",
+                  log.vmaf[i] == score && log.motion2[i] == motion2);
+    }
+
+    vmaf_model_destroy(model);
+    err = vmaf_close(vmaf);
+    mu_assert("problem during vmaf_close", !err);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_context_init_and_close);
+    mu_run_test(test_context_init_errors);
     mu_run_test(test_get_feature_score);
+    mu_run_test(test_unchanged_frames);
+    mu_run_test(test_import_feature_scores);
+    mu_run_test(test_scratch_arena);
+    mu_run_test(test_shared_executor);
+    mu_run_test(test_segments);
+    mu_run_test(test_output_range);
+    mu_run_test(test_checkpoint);
+    mu_run_test(test_frame_callback);
     return NULL;
 }
@@ -0,0 +1,196 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "config.h"
+#include "cpu.h"
+#include "mem.h"
+#include "feature/common/convolution.h"
+#include "feature/common/convolution_internal.h"
+
+enum { CONV_PLAIN, CONV_SQ, CONV_XY };
+
+typedef void (*conv_fn)(const float *filter, int filter_width,
+                        const float *src, float *dst, float *tmp,
+                        int width, int height, int src_stride, int dst_stride);
+
+typedef void (*conv_xy_fn)(const float *filter, int filter_width,
+                           const float *src1, const float *src2, float *dst,
+                           float *tmp, int width, int height, int src1_stride,
+                           int src2_stride, int dst_stride);
+
+typedef struct ConvolutionImpl {
+    conv_fn plain, sq;
+    conv_xy_fn xy;
+} ConvolutionImpl;
+
+static const int filter_widths[] = { 1, 3, 5, 7, 9, 11, 17, 33 };
+
+static void make_filter(float *filter, int filter_width)
+{
+    float sum = 0.f;
+    for (int k = 0; k < filter_width; k++) {
+        const int d = k - filter_width / 2;
+        filter[k] = expf(-(d * d) / (float) (filter_width * 2));
+        sum += filter[k];
+    }
+    for (int k = 0; k < filter_width; k++)
+        filter[k] /= sum;
+}
+
+static void fill(float *buf, int w, int h, int stride, unsigned seed)
+{
+    srand(seed);
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++)
+            buf[i * stride + j] = (float) (rand() % 256) - 128.f;
+    }
+}
+
+/* Mirrored two pass convolution, evaluated independently for every pixel. */
+static void reference(int kind, const float *filter, int filter_width,
+                      const float *src1, const float *src2, float *dst,
+                      float *tmp, int w, int h, int stride)
+{
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++) {
+            tmp[i * stride + j] = kind == CONV_SQ ?
+                convolution_edge_sq_s(false, filter, filter_width, src1, w, h, stride, i, j) :
+                kind == CONV_XY ?
+                convolution_edge_xy_s(false, filter, filter_width, src1, src2, w, h, stride, stride, i, j) :
+                convolution_edge_s(false, filter, filter_width, src1, w, h, stride, i, j);
+        }
+    }
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++)
+            dst[i * stride + j] = convolution_edge_s(true, filter, filter_width, tmp, w, h, stride, i, j);
+    }
+}
+
+static void run(const ConvolutionImpl *impl, int kind, const float *filter,
+                int filter_width, const float *src1, const float *src2,
+                float *dst, float *tmp, int w, int h, int stride)
+{
+    if (kind == CONV_SQ)
+        impl->sq(filter, filter_width, src1, dst, tmp, w, h, stride, stride);
+    else if (kind == CONV_XY)
+        impl->xy(filter, filter_width, src1, src2, dst, tmp, w, h, stride, stride, stride);
+    else
+        impl->plain(filter, filter_width, src1, dst, tmp, w, h, stride, stride);
+}
+
+/*
+ * Checks `impl` against the per-pixel reference and, when `exact` is set,
+ * for bit-exactness against `exact`, for every filter width and kind.
+ */
+static char *check_impl(const ConvolutionImpl *impl, const ConvolutionImpl *exact,
+                        int w, int h)
+{
+    const int stride = ALIGN_CEIL(w * sizeof(float)) / sizeof(float);
+    const size_t sz = stride * h * sizeof(float);
+    float *src1 = aligned_malloc(sz, 32), *src2 = aligned_malloc(sz, 32);
+    float *dst = aligned_malloc(sz, 32), *expected = aligned_malloc(sz, 32);
+    float *tmp = aligned_malloc(sz, 32);
+    mu_assert("buffer alloc error", src1 && src2 && dst && expected && tmp);
+    fill(src1, w, h, stride, 1);
+    fill(src2, w, h, stride, 2);
+
+    for (unsigned n = 0; n < sizeof(filter_widths) / sizeof(*filter_widths); n++) {
+        const int fw = filter_widths[n];
+        if (fw / 2 >= w || fw / 2 >= h) continue; // single reflection only
+        float filter[64];
+        make_filter(filter, fw);
+
+        for (int kind = CONV_PLAIN; kind <= CONV_XY; kind++) {
+            reference(kind, filter, fw, src1, src2, expected, tmp, w, h, stride);
+            memset(dst, 0, sz);
+            run(impl, kind, filter, fw, src1, src2, dst, tmp, w, h, stride);
+            for (int i = 0; i < h; i++) {
+                for (int j = 0; j < w; j++) {
+                    const float e = expected[i * stride + j];
+                    mu_assert("convolution does not match the reference",
+                              fabsf(dst[i * stride + j] - e) <= 1e-3f * (1.f + fabsf(e)));
+                }
+            }
+            if (!exact) continue;
+            run(exact, kind, filter, fw, src1, src2, expected, tmp, w, h, stride);
+            for (int i = 0; i < h; i++) {
+                mu_assert("convolution is not bit-exact with the avx path",
+                          !memcmp(dst + i * stride, expected + i * stride,
+                                  w * sizeof(float)));
+            }
+        }
+    }
+
+    aligned_free(src1);
+    aligned_free(src2);
+    aligned_free(dst);
+    aligned_free(expected);
+    aligned_free(tmp);
+    return NULL;
+}
+
+static char *test_convolution_simd()
+{
+    vmaf_init_cpu();
+    const unsigned flags = vmaf_get_cpu_flags();
+    char *msg;
+    (void) flags;
+    (void) msg;
+
+#if ARCH_X86
+    const ConvolutionImpl avx = {
+        convolution_f32_avx_s, convolution_f32_avx_sq_s, convolution_f32_avx_xy_s,
+    };
+    if (!(flags & VMAF_X86_CPU_FLAG_AVX2))
+        return NULL;
+    if ((msg = check_impl(&avx, NULL, 197, 61))) return msg;
+    if ((msg = check_impl(&avx, NULL, 64, 40))) return msg;
+    if ((msg = check_impl(&avx, NULL, 13, 9))) return msg;
+#if HAVE_AVX512
+    const ConvolutionImpl avx512 = {
+        convolution_f32_avx512_s, convolution_f32_avx512_sq_s, convolution_f32_avx512_xy_s,
+    };
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        if ((msg = check_impl(&avx512, &avx, 197, 61))) return msg;
+        if ((msg = check_impl(&avx512, &avx, 64, 40))) return msg;
+        if ((msg = check_impl(&avx512, &avx, 13, 9))) return msg;
+    }
+#endif
+#elif ARCH_AARCH64
+    const ConvolutionImpl neon = {
+        convolution_f32_neon_s, convolution_f32_neon_sq_s, convolution_f32_neon_xy_s,
+    };
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        if ((msg = check_impl(&neon, NULL, 197, 61))) return msg;
+        if ((msg = check_impl(&neon, NULL, 64, 40))) return msg;
+        if ((msg = check_impl(&neon, NULL, 13, 9))) return msg;
+    }
+#endif
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_convolution_simd);
+    return NULL;
+}
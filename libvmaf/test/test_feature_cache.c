@@ -0,0 +1,154 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include "libvmaf/libvmaf.h"
+
+#define CACHE_PATH "test_feature_cache.bin"
+#define N_FRAMES 4
+
+static long file_size(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static int run(const char *cache_path, VmafFeatureDictionary *opts,
+               double score[N_FRAMES])
+{
+    VmafConfiguration cfg = {
+        .log_level = VMAF_LOG_LEVEL_NONE,
+        .feature_cache = cache_path,
+    };
+    VmafContext *vmaf;
+    int err = vmaf_init(&vmaf, cfg);
+    if (err) return err;
+    err = vmaf_use_feature(vmaf, "float_ssim", opts);
+    if (err) goto close;
+
+    for (unsigned i = 0; i < N_FRAMES; i++) {
+        VmafPicture ref, dist;
+        err |= vmaf_picture_alloc(&ref, VMAF_PIX_FMT_YUV420P, 8, 64, 48);
+        err |= vmaf_picture_alloc(&dist, VMAF_PIX_FMT_YUV420P, 8, 64, 48);
+        if (err) goto close;
+        for (unsigned p = 0; p < 3; p++) {
+            uint8_t *r = ref.data[p], *d = dist.data[p];
+            for (unsigned y = 0; y < ref.h[p]; y++) {
+                for (unsigned x = 0; x < ref.w[p]; x++) {
+                    r[y * ref.stride[p] + x] = (x * 7 + y * 3) & 0xff;
+                    d[y * dist.stride[p] + x] = (x * 7 + y * 3 + x % (i + 2)) & 0xff;
+                }
+            }
+        }
+        err = vmaf_read_pictures(vmaf, &ref, &dist, i);
+        if (err) goto close;
+    }
+    err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+    if (err) goto close;
+
+    for (unsigned i = 0; i < N_FRAMES; i++) {
+        err = vmaf_feature_score_at_index(vmaf, "float_ssim", &score[i], i);
+        if (err) goto close;
+    }
+
+close:
+    vmaf_close(vmaf);
+    return err;
+}
+
+static char *test_feature_cache()
+{
+    remove(CACHE_PATH);
+
+    double expected[N_FRAMES], score[N_FRAMES];
+    int err = run(NULL, NULL, expected);
+    mu_assert("problem running without cache", !err);
+
+    err = run(CACHE_PATH, NULL, score);
+    mu_assert("problem running with a new cache", !err);
+    mu_assert("scores with a new cache should be unchanged",
+              !memcmp(score, expected, sizeof(score)));
+    const long size = file_size(CACHE_PATH);
+    mu_assert("misses should be stored", size > 16);
+
+    err = run(CACHE_PATH, NULL, score);
+    mu_assert("problem running with a warm cache", !err);
+    mu_assert("cached scores should be unchanged",
+              !memcmp(score, expected, sizeof(score)));
+    mu_assert("hits should not be stored again",
+              file_size(CACHE_PATH) == size);
+
+    VmafFeatureDictionary *opts = NULL;
+    vmaf_feature_dictionary_set(&opts, "enable_db", "true");
+    err = run(CACHE_PATH, opts, score);
+    mu_assert("problem running with different options", !err);
+    mu_assert("different options should not hit", score[0] != expected[0]);
+    mu_assert("different options should be stored",
+              file_size(CACHE_PATH) > size);
+
+    return NULL;
+}
+
+static char *test_feature_cache_corrupt()
+{
+    remove(CACHE_PATH);
+
+    double expected[N_FRAMES], score[N_FRAMES];
+    int err = run(CACHE_PATH, NULL, expected);
+    mu_assert("problem running with a new cache", !err);
+    const long size = file_size(CACHE_PATH);
+
+    // a torn record at the end, as left by an interrupted writer
+    FILE *f = fopen(CACHE_PATH, "ab");
+    mu_assert("could not open cache", f);
+    const uint32_t torn[3] = { 0x52434656, 1000, 0 };
+    fwrite(torn, sizeof(torn), 1, f);
+    fclose(f);
+
+    err = run(CACHE_PATH, NULL, score);
+    mu_assert("torn records should be skipped", !err);
+    mu_assert("cached scores should be unchanged",
+              !memcmp(score, expected, sizeof(score)));
+    mu_assert("hits should not be stored again",
+              file_size(CACHE_PATH) == size + (long) sizeof(torn));
+
+    f = fopen(CACHE_PATH, "wb");
+    mu_assert("could not open cache", f);
+    fprintf(f, "not a feature cache\n");
+    fclose(f);
+    err = run(CACHE_PATH, NULL, score);
+    mu_assert("other files should not be used as cache", err);
+
+    remove(CACHE_PATH);
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_feature_cache);
+    mu_run_test(test_feature_cache_corrupt);
+    return NULL;
+}
@@ -241,6 +241,41 @@ static char *test_feature_collector_init_append_get_and_destroy()
     return NULL;
 }
 
+static char *test_feature_collector_range()
+{
+    int err;
+    double score;
+
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+
+    feature_collector->range.set = true;
+    feature_collector->range.low = 2;
+    feature_collector->range.high = 3;
+    err  = vmaf_feature_collector_append(feature_collector, "feature", 1., 1);
+    err |= vmaf_feature_collector_append(feature_collector, "feature", 2., 2);
+    err |= vmaf_feature_collector_append(feature_collector, "feature", 4., 4);
+    mu_assert("appends outside of the range should be dropped quietly", !err);
+    err = vmaf_feature_collector_get_score(feature_collector, "feature",
+                                           &score, 2);
+    mu_assert("appends inside of the range should be kept",
+              !err && score == 2.);
+    err = vmaf_feature_collector_get_score(feature_collector, "feature",
+                                           &score, 1);
+    mu_assert("appends outside of the range should be dropped", err);
+    err = vmaf_feature_collector_get_score(feature_collector, "feature",
+                                           &score, 4);
+    mu_assert("appends outside of the range should be dropped", err);
+
+    feature_collector->range.set = false;
+    err = vmaf_feature_collector_append(feature_collector, "feature", 4., 4);
+    mu_assert("problem during vmaf_feature_collector_append", !err);
+
+    vmaf_feature_collector_destroy(feature_collector);
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_feature_vector_init_append_and_destroy);
@@ -249,5 +284,6 @@ char *run_tests()
     mu_run_test(test_model_mount);
     mu_run_test(test_model_unmount);
     mu_run_test(test_model_mount_with_use_features);
+    mu_run_test(test_feature_collector_range);
     return NULL;
 }
@@ -16,8 +16,12 @@
  *
  */
 
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "config.h"
 #include "dict.h"
@@ -84,6 +88,77 @@ static char *test_feature_extractor_context_pool()
     return NULL;
 }
 
+struct AquireData {
+    VmafFeatureExtractorContextPool *pool;
+    VmafFeatureExtractor *fex;
+    VmafFeatureExtractorContext *fex_ctx;
+    atomic_int done;
+};
+
+static void *aquire_func(void *arg)
+{
+    struct AquireData *d = arg;
+    vmaf_fex_ctx_pool_aquire(d->pool, d->fex, NULL, &d->fex_ctx);
+    atomic_store(&d->done, 1);
+    return NULL;
+}
+
+static char *test_feature_extractor_context_pool_scratch_budget()
+{
+    int err = 0;
+
+    VmafFeatureExtractor *fex = vmaf_get_feature_extractor_by_name("adm");
+    mu_assert("problem during vmaf_get_feature_extractor_by_name", fex);
+    const size_t scratch =
+        fex->scratch_size(fex, VMAF_PIX_FMT_YUV420P, 8, 1920, 1080);
+    mu_assert("adm should declare its scratch", scratch > 1920 * 1080);
+
+    VmafFeatureExtractorContextPool *pool;
+    err = vmaf_fex_ctx_pool_create(&pool, 8);
+    mu_assert("problem during vmaf_fex_ctx_pool_create", !err);
+    err = vmaf_fex_ctx_pool_set_scratch_budget(pool, 2 * scratch + 1,
+                                               VMAF_PIX_FMT_YUV420P, 8,
+                                               1920, 1080);
+    mu_assert("problem during vmaf_fex_ctx_pool_set_scratch_budget", !err);
+
+    VmafFeatureExtractorContext *fex_ctx[2];
+    for (unsigned i = 0; i < 2; i++) {
+        err = vmaf_fex_ctx_pool_aquire(pool, fex, NULL, &fex_ctx[i]);
+        mu_assert("problem during vmaf_fex_ctx_pool_aquire", !err);
+    }
+    VmafFeatureExtractorContext *f;
+    err = vmaf_fex_ctx_pool_try_aquire(pool, fex, NULL, &f);
+    mu_assert("try_aquire should not create contexts", err == -EAGAIN);
+
+    struct AquireData d = { .pool = pool, .fex = fex };
+    atomic_init(&d.done, 0);
+    pthread_t thread;
+    pthread_create(&thread, NULL, aquire_func, &d);
+    usleep(20000);
+    mu_assert("a context over budget should not be created",
+              !atomic_load(&d.done));
+    err = vmaf_fex_ctx_pool_release(pool, fex_ctx[1]);
+    mu_assert("problem during vmaf_fex_ctx_pool_release", !err);
+    pthread_join(thread, NULL);
+    mu_assert("a released context should be handed out",
+              d.fex_ctx == fex_ctx[1]);
+    mu_assert("peak scratch should be two contexts",
+              pool->scratch.peak == 2 * scratch);
+
+    err = vmaf_fex_ctx_pool_release(pool, fex_ctx[0]);
+    err |= vmaf_fex_ctx_pool_release(pool, d.fex_ctx);
+    mu_assert("problem during vmaf_fex_ctx_pool_release", !err);
+    err = vmaf_fex_ctx_pool_try_aquire(pool, fex, NULL, &f);
+    mu_assert("try_aquire should hand out idle contexts", !err);
+    err = vmaf_fex_ctx_pool_release(pool, f);
+    mu_assert("problem during vmaf_fex_ctx_pool_release", !err);
+
+    err = vmaf_fex_ctx_pool_destroy(pool);
+    mu_assert("problem during vmaf_fex_ctx_pool_destroy", !err);
+
+    return NULL;
+}
+
 static char *test_feature_extractor_flush()
 {
     int err = 0;
@@ -188,6 +263,7 @@ char *run_tests()
 {
     mu_run_test(test_get_feature_extractor_by_name_and_feature_name);
     mu_run_test(test_feature_extractor_context_pool);
+    mu_run_test(test_feature_extractor_context_pool_scratch_budget);
     mu_run_test(test_feature_extractor_flush);
     mu_run_test(test_feature_extractor_initialization_options);
     return NULL;
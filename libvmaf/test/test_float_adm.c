@@ -0,0 +1,389 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "config.h"
+#include "cpu.h"
+#include "mem.h"
+#include "feature/adm.h"
+#include "feature/adm_options.h"
+#include "feature/adm_tools.h"
+
+#if ARCH_X86
+#include "feature/x86/float_adm_avx2.h"
+#if HAVE_AVX512
+#include "feature/x86/float_adm_avx512.h"
+#endif
+#elif ARCH_AARCH64
+#include "feature/arm64/float_adm_neon.h"
+#endif
+
+/*
+ * The kernels follow the operation order of the scalar code and are built
+ * with -ffp-contract=off, so they are bit-exact with it as long as the scalar
+ * code is not contracted either: on x86 without -mfma, or with GCC in ISO C
+ * mode. clang contracts within expressions by default, which on aarch64 turns
+ * some of the scalar code into fused multiply-adds. Contracting all of it
+ * (-ffp-contract=fast -mfma on x86) moves the results by up to 3e-5 relative.
+ */
+#if ARCH_X86 || (defined(__STRICT_ANSI__) && !defined(__clang__))
+#define ADM_TOLERANCE 0.0
+#else
+#define ADM_TOLERANCE 5e-5
+#endif
+
+static int close_enough(double a, double b)
+{
+    if (a == b || (a != a && b != b)) return 1;
+    return fabs(a - b) <= ADM_TOLERANCE * (1.0 + fabs(a));
+}
+
+static int bands_close(const float *a, const float *b, int w, int h, int stride)
+{
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++) {
+            if (!close_enough(a[i * stride + j], b[i * stride + j]))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+typedef struct Bands {
+    adm_dwt_band_t_s b;
+    float *data;
+} Bands;
+
+static int bands_alloc(Bands *bands, int stride, int h)
+{
+    const size_t sz = (size_t) stride * h * sizeof(float);
+    bands->data = aligned_malloc(4 * sz, 32);
+    if (!bands->data) return -1;
+    memset(bands->data, 0, 4 * sz);
+    bands->b.band_a = bands->data;
+    bands->b.band_v = bands->data + stride * h;
+    bands->b.band_h = bands->data + 2 * stride * h;
+    bands->b.band_d = bands->data + 3 * stride * h;
+    return 0;
+}
+
+static void fill(float *buf, int w, int h, int stride, float scale)
+{
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++)
+            buf[i * stride + j] = scale * ((float) (rand() % 1024) - 512.f);
+    }
+}
+
+/* distorted band: mostly an attenuated or amplified copy of the reference,
+ * so that both branches of the angle test in adm_decouple_s() are taken */
+static void distort(const float *ref, float *dis, int w, int h, int stride)
+{
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++) {
+            const float r = ref[i * stride + j];
+            switch (rand() % 4) {
+            case 0: dis[i * stride + j] = r * 1.25f; break;
+            case 1: dis[i * stride + j] = r * 0.5f; break;
+            case 2: dis[i * stride + j] = 0.f; break;
+            default: dis[i * stride + j] = (float) (rand() % 1024) - 512.f;
+            }
+        }
+    }
+}
+
+static char *check_kernels(const AdmFloatKernels *k, int w, int h)
+{
+    const int stride = ALIGN_CEIL(w * sizeof(float)) / sizeof(float);
+    const int stride_bytes = stride * sizeof(float);
+    const int bw = (w + 1) / 2, bh = (h + 1) / 2;
+    float *src = aligned_malloc(stride_bytes * h, 32);
+    Bands ref, dis, r0, a0, r1, a1, f0, f1;
+    int *ind_y[4], *ind_x[4];
+    int err = !src;
+    err |= bands_alloc(&ref, stride, h);
+    err |= bands_alloc(&dis, stride, h);
+    err |= bands_alloc(&r0, stride, h);
+    err |= bands_alloc(&a0, stride, h);
+    err |= bands_alloc(&r1, stride, h);
+    err |= bands_alloc(&a1, stride, h);
+    err |= bands_alloc(&f0, stride, h);
+    err |= bands_alloc(&f1, stride, h);
+    for (int n = 0; n < 4; n++) {
+        ind_y[n] = malloc(sizeof(int) * h);
+        ind_x[n] = malloc(sizeof(int) * w);
+        err |= !ind_y[n] || !ind_x[n];
+    }
+    mu_assert("buffer alloc error", !err);
+
+    /* dwt2 */
+    fill(src, w, h, stride, 1.f);
+    dwt2_src_indices_filt_s(ind_y, ind_x, w, h);
+    adm_dwt2_s(src, &r0.b, ind_y, ind_x, w, h, stride_bytes, stride_bytes, NULL);
+    adm_dwt2_s(src, &r1.b, ind_y, ind_x, w, h, stride_bytes, stride_bytes, k);
+    mu_assert("adm_dwt2_s band a mismatch",
+              bands_close(r0.b.band_a, r1.b.band_a, bw, bh, stride));
+    mu_assert("adm_dwt2_s band v mismatch",
+              bands_close(r0.b.band_v, r1.b.band_v, bw, bh, stride));
+    mu_assert("adm_dwt2_s band h mismatch",
+              bands_close(r0.b.band_h, r1.b.band_h, bw, bh, stride));
+    mu_assert("adm_dwt2_s band d mismatch",
+              bands_close(r0.b.band_d, r1.b.band_d, bw, bh, stride));
+
+    /* decouple, with a gain limit the kernels take and one they leave to
+     * the scalar code */
+    const double egl[] = { DEFAULT_ADM_ENHN_GAIN_LIMIT, 1.0, 1.2 };
+    fill(ref.b.band_h, w, h, stride, 1.f);
+    fill(ref.b.band_v, w, h, stride, 1.f);
+    fill(ref.b.band_d, w, h, stride, 1.f);
+    distort(ref.b.band_h, dis.b.band_h, w, h, stride);
+    distort(ref.b.band_v, dis.b.band_v, w, h, stride);
+    distort(ref.b.band_d, dis.b.band_d, w, h, stride);
+    for (unsigned n = 0; n < sizeof(egl) / sizeof(*egl); n++) {
+        adm_decouple_s(&ref.b, &dis.b, &r0.b, &a0.b, w, h, stride_bytes,
+                       stride_bytes, stride_bytes, stride_bytes,
+                       ADM_BORDER_FACTOR, egl[n], NULL);
+        adm_decouple_s(&ref.b, &dis.b, &r1.b, &a1.b, w, h, stride_bytes,
+                       stride_bytes, stride_bytes, stride_bytes,
+                       ADM_BORDER_FACTOR, egl[n], k);
+        mu_assert("adm_decouple_s r mismatch",
+                  bands_close(r0.b.band_h, r1.b.band_h, w, h, stride) &&
+                  bands_close(r0.b.band_v, r1.b.band_v, w, h, stride) &&
+                  bands_close(r0.b.band_d, r1.b.band_d, w, h, stride));
+        mu_assert("adm_decouple_s a mismatch",
+                  bands_close(a0.b.band_h, a1.b.band_h, w, h, stride) &&
+                  bands_close(a0.b.band_v, a1.b.band_v, w, h, stride) &&
+                  bands_close(a0.b.band_d, a1.b.band_d, w, h, stride));
+    }
+
+    for (int scale = 0; scale < 4; scale++) {
+        /* csf */
+        adm_csf_s(&a0.b, &r0.b, &f0.b, h, scale, w, h, stride_bytes,
+                  stride_bytes, ADM_BORDER_FACTOR, DEFAULT_ADM_NORM_VIEW_DIST,
+                  DEFAULT_ADM_REF_DISPLAY_HEIGHT, DEFAULT_ADM_CSF_MODE, NULL);
+        adm_csf_s(&a0.b, &r1.b, &f1.b, h, scale, w, h, stride_bytes,
+                  stride_bytes, ADM_BORDER_FACTOR, DEFAULT_ADM_NORM_VIEW_DIST,
+                  DEFAULT_ADM_REF_DISPLAY_HEIGHT, DEFAULT_ADM_CSF_MODE, k);
+        mu_assert("adm_csf_s csf_a mismatch",
+                  bands_close(r0.b.band_h, r1.b.band_h, w, h, stride) &&
+                  bands_close(r0.b.band_v, r1.b.band_v, w, h, stride) &&
+                  bands_close(r0.b.band_d, r1.b.band_d, w, h, stride));
+        mu_assert("adm_csf_s csf_f mismatch",
+                  bands_close(f0.b.band_h, f1.b.band_h, w, h, stride) &&
+                  bands_close(f0.b.band_v, f1.b.band_v, w, h, stride) &&
+                  bands_close(f0.b.band_d, f1.b.band_d, w, h, stride));
+
+        /* denominator */
+        const float den0 =
+            adm_csf_den_scale_s(&ref.b, h, scale, w, h, stride_bytes,
+                                ADM_BORDER_FACTOR, DEFAULT_ADM_NORM_VIEW_DIST,
+                                DEFAULT_ADM_REF_DISPLAY_HEIGHT,
+                                DEFAULT_ADM_CSF_MODE, NULL);
+        const float den1 =
+            adm_csf_den_scale_s(&ref.b, h, scale, w, h, stride_bytes,
+                                ADM_BORDER_FACTOR, DEFAULT_ADM_NORM_VIEW_DIST,
+                                DEFAULT_ADM_REF_DISPLAY_HEIGHT,
+                                DEFAULT_ADM_CSF_MODE, k);
+        mu_assert("adm_csf_den_scale_s mismatch", close_enough(den0, den1));
+
+        /* numerator, with and without the frame border in the window */
+        const double border[] = { ADM_BORDER_FACTOR, 0.0 };
+        for (unsigned n = 0; n < sizeof(border) / sizeof(*border); n++) {
+            const float num0 =
+                adm_cm_s(&ref.b, &f0.b, &r0.b, w, h, stride_bytes, stride_bytes,
+                         stride_bytes, border[n], scale,
+                         DEFAULT_ADM_NORM_VIEW_DIST,
+                         DEFAULT_ADM_REF_DISPLAY_HEIGHT, DEFAULT_ADM_CSF_MODE,
+                         NULL);
+            const float num1 =
+                adm_cm_s(&ref.b, &f0.b, &r0.b, w, h, stride_bytes, stride_bytes,
+                         stride_bytes, border[n], scale,
+                         DEFAULT_ADM_NORM_VIEW_DIST,
+                         DEFAULT_ADM_REF_DISPLAY_HEIGHT, DEFAULT_ADM_CSF_MODE,
+                         k);
+            mu_assert("adm_cm_s mismatch", close_enough(num0, num1));
+        }
+    }
+
+    /* full pipeline */
+    fill(src, w, h, stride, 1.f / 4);
+    float *dst = r0.data;
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++)
+            dst[i * stride + j] = src[i * stride + j] * 0.9f + (rand() % 8);
+    }
+    double score[2], num[2], den[2], scores[2][8];
+    for (int n = 0; n < 2; n++) {
+        err = compute_adm(src, dst, w, h, stride_bytes, stride_bytes,
+                          &score[n], &num[n], &den[n], scores[n],
+                          ADM_BORDER_FACTOR, DEFAULT_ADM_ENHN_GAIN_LIMIT,
+                          DEFAULT_ADM_NORM_VIEW_DIST,
+                          DEFAULT_ADM_REF_DISPLAY_HEIGHT, DEFAULT_ADM_CSF_MODE,
+                          n ? k : NULL);
+        mu_assert("compute_adm failed", !err);
+    }
+    mu_assert("compute_adm score mismatch", close_enough(score[0], score[1]));
+    for (int n = 0; n < 8; n++)
+        mu_assert("compute_adm scale score mismatch",
+                  close_enough(scores[0][n], scores[1][n]));
+
+    aligned_free(src);
+    aligned_free(ref.data);
+    aligned_free(dis.data);
+    aligned_free(r0.data);
+    aligned_free(a0.data);
+    aligned_free(r1.data);
+    aligned_free(a1.data);
+    aligned_free(f0.data);
+    aligned_free(f1.data);
+    for (int n = 0; n < 4; n++) {
+        free(ind_y[n]);
+        free(ind_x[n]);
+    }
+    return NULL;
+}
+
+/*
+ * The row reductions are checked directly: differences in single pixels
+ * mostly vanish in the pooled scores above.
+ */
+static char *check_row_kernels(const AdmFloatKernels *k)
+{
+    enum { W = 75 };
+    const int h = k->rows + 2, stride = W + 5;
+    const float rfactor[3] = { 0.37f, 0.37f, 0.61f };
+    float *buf = malloc(sizeof(float) * 9 * stride * h);
+    mu_assert("buffer alloc error", buf);
+    const float *src[3], *csf_a[3], *csf_f[3];
+    for (int t = 0; t < 3; t++) {
+        float *s = buf + (3 * t) * stride * h;
+        float *a = buf + (3 * t + 1) * stride * h;
+        float *f = buf + (3 * t + 2) * stride * h;
+        fill(s, W, h, stride, 1.f / 2);
+        fill(a, W, h, stride, 1.f / 8);
+        for (int n = 0; n < stride * h; n++)
+            f[n] = fabsf(a[n]) * (float) FLOAT_ONE_BY_30 * (1 + rand() % 3);
+        src[t] = s;
+        csf_a[t] = a;
+        csf_f[t] = f;
+    }
+
+    float accum[ADM_KERNEL_MAX_ROWS][3], expected[ADM_KERNEL_MAX_ROWS][3];
+    const float *src_rows[3], *a_rows[3], *f_rows[3];
+    for (int t = 0; t < 3; t++) {
+        src_rows[t] = src[t] + stride;
+        a_rows[t] = csf_a[t] + stride;
+        f_rows[t] = csf_f[t] + stride;
+    }
+
+    /* cm_rows, continuing from a nonzero accumulator as after j = 0 */
+    for (int r = 0; r < k->rows; r++) {
+        for (int t = 0; t < 3; t++)
+            accum[r][t] = expected[r][t] = 1.5f;
+    }
+    int j_vec = k->cm_rows(src_rows, stride, a_rows, f_rows, stride, rfactor,
+                           1, W - 1, accum);
+    for (int r = 0; r < k->rows; r++) {
+        const int i = r + 1;
+        for (int j = 1; j < W - 1; j++) {
+            float thr;
+            ADM_CM_THRESH_S_I_J(csf_a, csf_f, stride, &thr, W, h, i, j);
+            for (int t = 0; t < 3; t++) {
+                float x = fabsf(src[t][i * stride + j] * rfactor[t]) - thr;
+                x = x < 0.0f ? 0.0f : x;
+                expected[r][t] += x * x * x;
+                if (j >= j_vec) accum[r][t] += x * x * x;
+            }
+        }
+        for (int t = 0; t < 3; t++)
+            mu_assert("cm_rows mismatch", close_enough(expected[r][t], accum[r][t]));
+    }
+
+    /* csf_den_rows */
+    memset(accum, 0, sizeof(accum));
+    memset(expected, 0, sizeof(expected));
+    j_vec = k->csf_den_rows(src_rows, stride, rfactor, 0, W, accum);
+    for (int r = 0; r < k->rows; r++) {
+        for (int j = 0; j < W; j++) {
+            for (int t = 0; t < 3; t++) {
+                const float x = fabsf(rfactor[t] * src_rows[t][r * stride + j]);
+                expected[r][t] += x * x * x;
+                if (j >= j_vec) accum[r][t] += x * x * x;
+            }
+        }
+        for (int t = 0; t < 3; t++)
+            mu_assert("csf_den_rows mismatch", close_enough(expected[r][t], accum[r][t]));
+    }
+
+    free(buf);
+    return NULL;
+}
+
+static char *check_kernels_all_sizes(const AdmFloatKernels *k)
+{
+    char *msg;
+    if ((msg = check_row_kernels(k))) return msg;
+    srand(1);
+    if ((msg = check_kernels(k, 197, 61))) return msg;
+    if ((msg = check_kernels(k, 128, 80))) return msg;
+    if ((msg = check_kernels(k, 37, 23))) return msg;
+    return NULL;
+}
+
+static char *test_float_adm_simd()
+{
+    vmaf_init_cpu();
+    const unsigned flags = vmaf_get_cpu_flags();
+    AdmFloatKernels k;
+    char *msg;
+    (void) flags;
+    (void) k;
+    (void) msg;
+
+#if ARCH_X86
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
+        memset(&k, 0, sizeof(k));
+        adm_float_kernels_avx2(&k);
+        if ((msg = check_kernels_all_sizes(&k))) return msg;
+    }
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        memset(&k, 0, sizeof(k));
+        adm_float_kernels_avx512(&k);
+        if ((msg = check_kernels_all_sizes(&k))) return msg;
+    }
+#endif
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        memset(&k, 0, sizeof(k));
+        adm_float_kernels_neon(&k);
+        if ((msg = check_kernels_all_sizes(&k))) return msg;
+    }
+#endif
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_float_adm_simd);
+    return NULL;
+}
@@ -0,0 +1,120 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "frame_queue.h"
+#include "test.h"
+
+typedef struct Delivered {
+    unsigned index[16];
+    unsigned cnt;
+} Delivered;
+
+static void deliver(void *data, unsigned index)
+{
+    Delivered *d = data;
+    d->index[d->cnt++] = index;
+}
+
+static char *test_frame_queue_in_order()
+{
+    int err = 0;
+    Delivered d = { 0 };
+    VmafFrameQueue *q;
+    err = vmaf_frame_queue_create(&q, 3, true, deliver, &d);
+    mu_assert("problem during vmaf_frame_queue_create", !err);
+
+    uint64_t id[4];
+    for (unsigned i = 0; i < 3; i++) {
+        err = vmaf_frame_queue_push(q, 10 + i, false, false, &id[i]);
+        mu_assert("problem during vmaf_frame_queue_push", !err);
+    }
+    err = vmaf_frame_queue_push(q, 13, false, false, &id[3]);
+    mu_assert("a full queue should return -EAGAIN", err == -EAGAIN);
+    mu_assert("pending should be limited", vmaf_frame_queue_pending(q) == 3);
+
+    err = vmaf_frame_queue_ref(q, id[0]);
+    err |= vmaf_frame_queue_unref(q, id[1]);
+    err |= vmaf_frame_queue_unref(q, id[0]);
+    mu_assert("problem during vmaf_frame_queue_unref", !err);
+    mu_assert("a finished frame should wait for earlier ones", !d.cnt);
+
+    err = vmaf_frame_queue_unref(q, id[0]);
+    mu_assert("problem during vmaf_frame_queue_unref", !err);
+    mu_assert("finished frames should be delivered in order",
+              d.cnt == 2 && d.index[0] == 10 && d.index[1] == 11);
+
+    err = vmaf_frame_queue_push(q, 13, false, false, &id[3]);
+    mu_assert("delivered frames should make room", !err);
+    err = vmaf_frame_queue_unref(q, id[3]);
+    err |= vmaf_frame_queue_unref(q, id[2]);
+    mu_assert("problem during vmaf_frame_queue_unref", !err);
+    mu_assert("all frames should be delivered",
+              d.cnt == 4 && d.index[2] == 12 && d.index[3] == 13);
+    err = vmaf_frame_queue_unref(q, id[2]);
+    mu_assert("a delivered frame should not be unreferenced", err);
+
+    vmaf_frame_queue_destroy(q);
+    return NULL;
+}
+
+static char *test_frame_queue_held()
+{
+    int err = 0;
+    Delivered d = { 0 };
+    VmafFrameQueue *q;
+    err = vmaf_frame_queue_create(&q, 4, false, deliver, &d);
+    mu_assert("problem during vmaf_frame_queue_create", !err);
+
+    uint64_t id[3];
+    for (unsigned i = 0; i < 3; i++) {
+        err = vmaf_frame_queue_push(q, i, true, false, &id[i]);
+        mu_assert("problem during vmaf_frame_queue_push", !err);
+    }
+
+    err = vmaf_frame_queue_unref(q, id[1]);
+    mu_assert("problem during vmaf_frame_queue_unref", !err);
+    mu_assert("a held frame should wait for the next", !d.cnt);
+
+    err = vmaf_frame_queue_unref(q, id[2]);
+    mu_assert("problem during vmaf_frame_queue_unref", !err);
+    mu_assert("a finished next frame should release the hold",
+              d.cnt == 1 && d.index[0] == 1);
+    err = vmaf_frame_queue_unref(q, id[0]);
+    mu_assert("problem during vmaf_frame_queue_unref", !err);
+    mu_assert("frames should be delivered as they finish",
+              d.cnt == 2 && d.index[1] == 0);
+
+    err = vmaf_frame_queue_release(q);
+    mu_assert("problem during vmaf_frame_queue_release", !err);
+    mu_assert("releasing should deliver the last frame",
+              d.cnt == 3 && d.index[2] == 2);
+    mu_assert("nothing should be pending", !vmaf_frame_queue_pending(q));
+
+    vmaf_frame_queue_destroy(q);
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_frame_queue_in_order);
+    mu_run_test(test_frame_queue_held);
+    return NULL;
+}
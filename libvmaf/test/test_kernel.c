@@ -0,0 +1,182 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include "cpu.h"
+#include "kernel.h"
+
+#define CACHE_PATH "test_kernel_cache.txt"
+
+static const VmafKernelVariant variants[] = {
+    { .name = "c" },
+    {
+        .name = "aligned",
+        .w_align = 16,
+    },
+    {
+        .name = "unsupported",
+        .cpu_flags = 1u << 30,
+    },
+    { 0 }
+};
+
+static const VmafKernel default_kernel = {
+    .name = "test_default",
+    .feature_extractor = "psnr",
+    .variant = variants,
+};
+
+static const VmafKernel tuned_kernel = {
+    .name = "test_tuned",
+    .feature_extractor = "psnr",
+    .variant = variants,
+};
+
+static const VmafKernel cached_kernel = {
+    .name = "test_cached",
+    .feature_extractor = "psnr",
+    .variant = variants,
+};
+
+static int find_selection(const char *kernel, unsigned w, unsigned h,
+                          VmafKernelSelection *sel)
+{
+    for (unsigned i = 0; !vmaf_kernel_selection(i, sel); i++) {
+        if (!strcmp(sel->kernel, kernel) && sel->w == w && sel->h == h)
+            return 0;
+    }
+    return -1;
+}
+
+static char *test_kernel_select_default()
+{
+    const VmafKernelVariant *v =
+        vmaf_kernel_select(&default_kernel, NULL, VMAF_PIX_FMT_YUV420P, 8,
+                           64, 48);
+    mu_assert("widest supported variant should be the default",
+              !strcmp(v->name, "aligned"));
+    v = vmaf_kernel_select(&default_kernel, NULL, VMAF_PIX_FMT_YUV420P, 8,
+                           72, 48);
+    mu_assert("variant requires a multiple of 16 width",
+              !strcmp(v->name, "c"));
+
+    VmafKernelSelection sel;
+    int err = find_selection("test_default", 64, 48, &sel);
+    mu_assert("selection should be reported", !err);
+    mu_assert("wrong variant reported", !strcmp(sel.variant, "aligned"));
+    mu_assert("default selection is not autotuned", !sel.autotuned);
+    err = find_selection("test_default", 72, 48, &sel);
+    mu_assert("selection should be reported", !err);
+    mu_assert("wrong variant reported", !strcmp(sel.variant, "c"));
+
+    return NULL;
+}
+
+static char *test_kernel_autotune()
+{
+    remove(CACHE_PATH);
+    char cache_path[] = CACHE_PATH;
+    const VmafKernelTuning tuning = {
+        .autotune = 1,
+        .cache_path = cache_path,
+    };
+
+    const VmafKernelVariant *v =
+        vmaf_kernel_select(&tuned_kernel, &tuning, VMAF_PIX_FMT_YUV420P, 8,
+                           64, 48);
+    mu_assert("should pick a supported variant",
+              !strcmp(v->name, "c") || !strcmp(v->name, "aligned"));
+    const VmafKernelVariant *again =
+        vmaf_kernel_select(&tuned_kernel, NULL, VMAF_PIX_FMT_YUV420P, 8,
+                           64, 48);
+    mu_assert("tuning result should be shared", v == again);
+
+    VmafKernelSelection sel;
+    int err = find_selection("test_tuned", 64, 48, &sel);
+    mu_assert("selection should be reported", !err);
+    mu_assert("selection should be autotuned", sel.autotuned);
+
+    char expected[128], line[128];
+    snprintf(expected, sizeof(expected), "test_tuned 64x48 8 0x%x %s\n",
+             vmaf_get_cpu_flags(), v->name);
+    FILE *f = fopen(CACHE_PATH, "r");
+    mu_assert("cache should be written", f);
+    int found = 0;
+    while (fgets(line, sizeof(line), f))
+        found |= !strcmp(line, expected);
+    fclose(f);
+    mu_assert("cache should contain the tuning result", found);
+
+    // selected untuned by test_kernel_select_default()
+    vmaf_kernel_select(&default_kernel, &tuning, VMAF_PIX_FMT_YUV420P, 8,
+                       64, 48);
+    err = find_selection("test_default", 64, 48, &sel);
+    mu_assert("selection should be reported", !err);
+    mu_assert("a default selection should be tuned again", sel.autotuned);
+
+    // tuning is up to the caller, a new size is not tuned without it
+    vmaf_kernel_select(&tuned_kernel, NULL, VMAF_PIX_FMT_YUV420P, 8, 80, 48);
+    err = find_selection("test_tuned", 80, 48, &sel);
+    mu_assert("selection should be reported", !err);
+    mu_assert("selection should not be autotuned", !sel.autotuned);
+
+    return NULL;
+}
+
+static char *test_kernel_autotune_cache()
+{
+    FILE *f = fopen(CACHE_PATH, "w");
+    mu_assert("could not write cache", f);
+    fprintf(f, "# comment\n");
+    fprintf(f, "malformed\n");
+    fprintf(f, "test_cached 64x48 8 0x%x c\n", vmaf_get_cpu_flags());
+    fclose(f);
+
+    int err = vmaf_kernel_load_cache(CACHE_PATH);
+    mu_assert("problem during vmaf_kernel_load_cache", !err);
+
+    char cache_path[] = CACHE_PATH;
+    const VmafKernelTuning tuning = {
+        .autotune = 1,
+        .cache_path = cache_path,
+    };
+    const VmafKernelVariant *v =
+        vmaf_kernel_select(&cached_kernel, &tuning, VMAF_PIX_FMT_YUV420P, 8,
+                           64, 48);
+    mu_assert("cached variant should be used", !strcmp(v->name, "c"));
+
+    VmafKernelSelection sel;
+    err = find_selection("test_cached", 64, 48, &sel);
+    mu_assert("selection should be reported", !err);
+    mu_assert("cached selection is autotuned", sel.autotuned);
+
+    remove(CACHE_PATH);
+    return NULL;
+}
+
+char *run_tests()
+{
+    vmaf_init_cpu();
+    mu_run_test(test_kernel_select_default);
+    mu_run_test(test_kernel_autotune);
+    mu_run_test(test_kernel_autotune_cache);
+    return NULL;
+}
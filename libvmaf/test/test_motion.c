@@ -0,0 +1,167 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "test.h"
+#include "cpu.h"
+#include "feature/integer_motion.c"
+
+static void fill_picture(VmafPicture *pic, unsigned seed)
+{
+    srand(seed);
+    for (unsigned i = 0; i < pic->h[0]; i++) {
+        for (unsigned j = 0; j < pic->w[0]; j++) {
+            const unsigned v = (i * 7 + j * 3 + rand() % 32) & ((1 << pic->bpc) - 1);
+            if (pic->bpc == 8)
+                ((uint8_t *) pic->data[0])[i * pic->stride[0] + j] = v;
+            else
+                ((uint16_t *) pic->data[0])[i * (pic->stride[0] / 2) + j] = v;
+        }
+    }
+}
+
+/* Two pass mirrored 5-tap blur, evaluated independently for every pixel. */
+static void reference_blur(VmafPicture *pic, uint16_t *tmp, uint16_t *dst)
+{
+    const int w = pic->w[0], h = pic->h[0];
+    const unsigned shift = pic->bpc;
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++) {
+            uint32_t accum = 0;
+            for (int k = 0; k < filter_width; k++) {
+                const int i_tap = mirror(i - filter_width / 2 + k, h);
+                accum += filter[k] * (pic->bpc == 8 ?
+                    ((uint8_t *) pic->data[0])[i_tap * pic->stride[0] + j] :
+                    ((uint16_t *) pic->data[0])[i_tap * (pic->stride[0] / 2) + j]);
+            }
+            tmp[i * w + j] = (accum + (1u << (shift - 1))) >> shift;
+        }
+    }
+    for (int i = 0; i < h; i++) {
+        for (int j = 0; j < w; j++) {
+            dst[i * w + j] =
+                (edge_16(true, tmp, w, h, w, i, j) + 32768) >> 16;
+        }
+    }
+}
+
+static char *test_blur_and_sad(unsigned bpc, unsigned flags)
+{
+    const unsigned w = 197, h = 61;
+    MotionState s = { 0 };
+    s.tmp = aligned_malloc(ALIGN_CEIL((w + filter_width) * sizeof(uint16_t)), 32);
+    s.y_convolution = bpc == 8 ? y_convolution_8 : y_convolution_16;
+    s.x_convolution = x_convolution_16;
+    s.sad = sad_c;
+
+#if ARCH_X86
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
+        s.y_convolution = bpc == 8 ? y_convolution_8_avx2 : y_convolution_16_avx2;
+        s.x_convolution = x_convolution_16_avx2;
+        s.sad = sad_avx2;
+    }
+#if HAVE_AVX512
+    if (flags & VMAF_X86_CPU_FLAG_AVX512) {
+        s.y_convolution = bpc == 8 ? y_convolution_8_avx512 : y_convolution_16_avx512;
+        s.x_convolution = x_convolution_16_avx512;
+        s.sad = sad_avx512;
+    }
+#endif
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        s.y_convolution = bpc == 8 ? y_convolution_8_neon : y_convolution_16_neon;
+        s.x_convolution = x_convolution_16_neon;
+        s.sad = sad_neon;
+    }
+#else
+    (void) flags;
+#endif
+
+    VmafPicture pic[2], blur[2];
+    int err = 0;
+    for (unsigned i = 0; i < 2; i++) {
+        err |= vmaf_picture_alloc(&pic[i], VMAF_PIX_FMT_YUV400P, bpc, w, h);
+        err |= vmaf_picture_alloc(&blur[i], VMAF_PIX_FMT_YUV400P, 16, w, h);
+    }
+    mu_assert("picture alloc error", !err && s.tmp);
+    fill_picture(&pic[0], 1);
+    fill_picture(&pic[1], 2);
+
+    uint16_t *tmp = malloc(w * h * sizeof(uint16_t));
+    uint16_t *expected[2] = {
+        malloc(w * h * sizeof(uint16_t)), malloc(w * h * sizeof(uint16_t)),
+    };
+    reference_blur(&pic[0], tmp, expected[0]);
+    reference_blur(&pic[1], tmp, expected[1]);
+
+    uint64_t sad = 0, expected_sad = 0;
+    blur_frame(&s, &pic[0], &blur[0], NULL, &sad, 0, h);
+    mu_assert("sad should be zero without a previous frame", sad == 0);
+    // row ranges accumulate into the same sad
+    blur_frame(&s, &pic[1], &blur[1], &blur[0], &sad, 0, h / 3);
+    blur_frame(&s, &pic[1], &blur[1], &blur[0], &sad, h / 3, h);
+
+    for (unsigned i = 0; i < h; i++) {
+        for (unsigned j = 0; j < w; j++) {
+            for (unsigned n = 0; n < 2; n++) {
+                const uint16_t *b = blur[n].data[0];
+                mu_assert("blurred frame does not match the two pass reference",
+                          b[i * (blur[n].stride[0] / 2) + j] == expected[n][i * w + j]);
+            }
+            expected_sad += abs(expected[0][i * w + j] - expected[1][i * w + j]);
+        }
+    }
+    mu_assert("sad does not match the reference", sad == expected_sad);
+
+    free(tmp);
+    free(expected[0]);
+    free(expected[1]);
+    aligned_free(s.tmp);
+    for (unsigned i = 0; i < 2; i++) {
+        vmaf_picture_unref(&pic[i]);
+        vmaf_picture_unref(&blur[i]);
+    }
+    return NULL;
+}
+
+static char *test_blur_and_sad_c()
+{
+    char *msg;
+    if ((msg = test_blur_and_sad(8, 0))) return msg;
+    if ((msg = test_blur_and_sad(10, 0))) return msg;
+    return test_blur_and_sad(16, 0);
+}
+
+static char *test_blur_and_sad_simd()
+{
+    vmaf_init_cpu();
+    const unsigned flags = vmaf_get_cpu_flags();
+    char *msg;
+    if ((msg = test_blur_and_sad(8, flags))) return msg;
+    if ((msg = test_blur_and_sad(10, flags))) return msg;
+    return test_blur_and_sad(16, flags);
+}
+
+char *run_tests()
+{
+    mu_run_test(test_blur_and_sad_c);
+    mu_run_test(test_blur_and_sad_simd);
+    return NULL;
+}
@@ -0,0 +1,183 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "test.h"
+#include "perf.h"
+#include "libvmaf/libvmaf.h"
+
+#define N_FRAMES 5
+
+static int run_context(VmafContext *vmaf)
+{
+    int err = vmaf_use_feature(vmaf, "psnr", NULL);
+    if (err) return err;
+
+    for (unsigned i = 0; i < N_FRAMES; i++) {
+        VmafPicture ref, dist;
+        err |= vmaf_picture_alloc(&ref, VMAF_PIX_FMT_YUV420P, 8, 64, 48);
+        err |= vmaf_picture_alloc(&dist, VMAF_PIX_FMT_YUV420P, 8, 64, 48);
+        if (err) return err;
+        for (unsigned p = 0; p < 3; p++) {
+            memset(ref.data[p], 100, ref.stride[p] * ref.h[p]);
+            memset(dist.data[p], 100 + i, dist.stride[p] * dist.h[p]);
+        }
+        err = vmaf_read_pictures(vmaf, &ref, &dist, i);
+        if (err) return err;
+    }
+    return vmaf_read_pictures(vmaf, NULL, NULL, 0);
+}
+
+#if VMAF_PERF_STATS
+
+static uint64_t histogram_sum(const VmafPerfTiming *t)
+{
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < VMAF_PERF_HISTOGRAM_BINS; i++)
+        sum += t->histogram[i];
+    return sum;
+}
+
+static char *test_perf_timing_add()
+{
+    VmafPerfTiming t = { 0 };
+    vmaf_perf_timing_add(&t, 999, 10);
+    vmaf_perf_timing_add(&t, 1000, 10);
+    vmaf_perf_timing_add(&t, 3999, 10);
+    vmaf_perf_timing_add(&t, UINT64_MAX / 2, 10);
+
+    mu_assert("wrong count", t.count == 4);
+    mu_assert("wrong cpu_ns", t.cpu_ns == 40);
+    mu_assert("wrong max_wall_ns", t.max_wall_ns == UINT64_MAX / 2);
+    mu_assert("< 1us should land in bin 0", t.histogram[0] == 1);
+    mu_assert("[1, 2)us should land in bin 1", t.histogram[1] == 1);
+    mu_assert("[2, 4)us should land in bin 2", t.histogram[2] == 1);
+    mu_assert("long calls should land in the last bin",
+              t.histogram[VMAF_PERF_HISTOGRAM_BINS - 1] == 1);
+
+    return NULL;
+}
+
+static char *test_perf_stats(unsigned n_threads)
+{
+    VmafConfiguration cfg = {
+        .n_threads = n_threads,
+        .perf_stats = 1,
+    };
+    VmafContext *vmaf;
+    int err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+    err = run_context(vmaf);
+    mu_assert("problem extracting features", !err);
+
+    VmafPerfStats stats;
+    err = vmaf_get_perf_stats(vmaf, &stats);
+    mu_assert("problem during vmaf_get_perf_stats", !err);
+
+    mu_assert("psnr should be the only extractor", stats.n_extractors == 1);
+    const VmafPerfExtractorStats *e = &stats.extractor[0];
+    mu_assert("wrong extractor name", !strcmp(e->name, "psnr"));
+    mu_assert("psnr is initialized once per extractor context",
+              e->init.count >= 1 &&
+              e->init.count <= (n_threads ? n_threads : 1));
+    mu_assert("extract should be timed for every frame",
+              e->extract.count == N_FRAMES);
+    mu_assert("histogram should cover every call",
+              histogram_sum(&e->extract) == N_FRAMES);
+    mu_assert("max should not exceed the total",
+              e->extract.max_wall_ns <= e->extract.wall_ns);
+    mu_assert("every score goes through the collector lock",
+              stats.collector_lock.acquired >= N_FRAMES);
+    mu_assert("pictures are allocated through the aligned allocator",
+              stats.bytes_allocated > 0);
+
+    if (n_threads) {
+        mu_assert("pool wait should be timed for every frame",
+                  e->pool_wait.count == N_FRAMES);
+        mu_assert("queue wait should be timed for every job",
+                  stats.queue_wait.count >= N_FRAMES);
+        mu_assert("waits use no cpu time", !e->pool_wait.cpu_ns);
+    } else {
+        mu_assert("no pool wait without threads", !e->pool_wait.count);
+        mu_assert("no queue wait without threads", !stats.queue_wait.count);
+    }
+
+    vmaf_close(vmaf);
+    return NULL;
+}
+
+static char *test_perf_stats_threads()
+{
+    char *msg;
+    if ((msg = test_perf_stats(0))) return msg;
+    if ((msg = test_perf_stats(2))) return msg;
+    return NULL;
+}
+
+static char *test_perf_stats_disabled()
+{
+    VmafConfiguration cfg = { 0 };
+    VmafContext *vmaf;
+    int err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+    err = run_context(vmaf);
+    mu_assert("problem extracting features", !err);
+
+    VmafPerfStats stats;
+    err = vmaf_get_perf_stats(vmaf, &stats);
+    mu_assert("perf stats were not requested", err == -EINVAL);
+
+    vmaf_close(vmaf);
+    return NULL;
+}
+
+#else
+
+static char *test_perf_stats_compiled_out()
+{
+    VmafConfiguration cfg = { .perf_stats = 1 };
+    VmafContext *vmaf;
+    int err = vmaf_init(&vmaf, cfg);
+    mu_assert("problem during vmaf_init", !err);
+    err = run_context(vmaf);
+    mu_assert("problem extracting features", !err);
+
+    VmafPerfStats stats;
+    err = vmaf_get_perf_stats(vmaf, &stats);
+    mu_assert("perf stats are compiled out", err == -ENOSYS);
+
+    vmaf_close(vmaf);
+    return NULL;
+}
+
+#endif /* VMAF_PERF_STATS */
+
+char *run_tests()
+{
+#if VMAF_PERF_STATS
+    mu_run_test(test_perf_timing_add);
+    mu_run_test(test_perf_stats_threads);
+    mu_run_test(test_perf_stats_disabled);
+#else
+    mu_run_test(test_perf_stats_compiled_out);
+#endif
+    return NULL;
+}
@@ -16,6 +16,8 @@
  *
  */
 
+#include <errno.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "test.h"
@@ -65,9 +67,92 @@ static char *test_picture_data_alignment()
     return NULL;
 }
 
+static unsigned derive_calls;
+
+static int derive_offset(VmafPicture *pic, void *dst, ptrdiff_t dst_stride,
+                         int offset)
+{
+    derive_calls++;
+    for (unsigned i = 0; i < pic->h[0]; i++) {
+        float *row = (float *)((uint8_t *) dst + i * dst_stride);
+        for (unsigned j = 0; j < pic->w[0]; j++)
+            row[j] = offset;
+    }
+    return 0;
+}
+
+static int derive_fail(VmafPicture *pic, void *dst, ptrdiff_t dst_stride,
+                       int offset)
+{
+    (void) pic;
+    (void) dst;
+    (void) dst_stride;
+    (void) offset;
+    derive_calls++;
+    return -EINVAL;
+}
+
+static char *test_picture_derived()
+{
+    int err;
+    const void *data_a, *data_b, *data_c;
+    ptrdiff_t stride_a, stride_b, stride_c;
+
+    VmafPicture pic_a, pic_b;
+    err = vmaf_picture_alloc(&pic_a, VMAF_PIX_FMT_YUV420P, 8, 33, 9);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    err = vmaf_picture_ref(&pic_b, &pic_a);
+    mu_assert("problem during vmaf_picture_ref", !err);
+
+    derive_calls = 0;
+    err = vmaf_picture_get_derived(&pic_a, VMAF_PICTURE_DERIVED_FLOAT_LUMA,
+                                   -128, pic_a.w[0] * sizeof(float),
+                                   derive_offset, &data_a, &stride_a);
+    mu_assert("problem during vmaf_picture_get_derived", !err);
+    mu_assert("derived plane should be produced once", derive_calls == 1);
+    mu_assert("derived plane is not 32-byte aligned",
+              !(((uintptr_t) data_a) % 32) && !(stride_a % 32) &&
+              stride_a >= (ptrdiff_t)(pic_a.w[0] * sizeof(float)));
+    const float *last_row = (const float *)((const uint8_t *) data_a +
+                                            (pic_a.h[0] - 1) * stride_a);
+    mu_assert("derived plane has wrong contents",
+              last_row[pic_a.w[0] - 1] == -128.f);
+
+    err = vmaf_picture_get_derived(&pic_b, VMAF_PICTURE_DERIVED_FLOAT_LUMA,
+                                   -128, pic_b.w[0] * sizeof(float),
+                                   derive_offset, &data_b, &stride_b);
+    mu_assert("problem during vmaf_picture_get_derived", !err);
+    mu_assert("derived plane should be shared between references",
+              derive_calls == 1 && data_a == data_b && stride_a == stride_b);
+
+    err = vmaf_picture_get_derived(&pic_b, VMAF_PICTURE_DERIVED_FLOAT_LUMA,
+                                   0, pic_b.w[0] * sizeof(float),
+                                   derive_offset, &data_c, &stride_c);
+    mu_assert("problem during vmaf_picture_get_derived", !err);
+    mu_assert("derived planes should be keyed by offset",
+              derive_calls == 2 && data_c != data_a);
+
+    for (unsigned i = 0; i < 2; i++) {
+        err = vmaf_picture_get_derived(&pic_a, VMAF_PICTURE_DERIVED_FLOAT_LUMA,
+                                       1, pic_a.w[0] * sizeof(float),
+                                       derive_fail, &data_c, &stride_c);
+        mu_assert("derive errors should be returned", err == -EINVAL);
+    }
+    mu_assert("failed derived plane should not be produced twice",
+              derive_calls == 3);
+
+    err = vmaf_picture_unref(&pic_a);
+    mu_assert("problem during vmaf_picture_unref", !err);
+    err = vmaf_picture_unref(&pic_b);
+    mu_assert("problem during vmaf_picture_unref", !err);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_picture_alloc_ref_and_unref);
     mu_run_test(test_picture_data_alignment);
+    mu_run_test(test_picture_derived);
     return NULL;
 }
@@ -155,6 +155,75 @@ static char* test_propagate_metadata()
 
 }
 
+static void count_meta(void *data, VmafMetadata *metadata)
+{
+    unsigned *cnt = data;
+    cnt[metadata->picture_index]++;
+}
+
+static char *test_propagate_metadata_once()
+{
+    int err;
+
+    unsigned vmaf_cnt[3] = { 0 }, feature_cnt[3] = { 0 };
+    VmafMetadataConfiguration m[2] = {
+        { .feature_name = "vmaf", .callback = count_meta, .data = vmaf_cnt },
+        { .feature_name = "VMAF_integer_feature_motion2_score",
+          .callback = count_meta, .data = feature_cnt },
+    };
+
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+    for (unsigned i = 0; i < 2; i++) {
+        err = vmaf_feature_collector_register_metadata(feature_collector, m[i]);
+        mu_assert("problem during vmaf_feature_collector_register_metadata",
+                  !err);
+    }
+
+    VmafModel *model;
+    VmafModelConfig cfg = {
+        .name = "vmaf",
+        .flags = VMAF_MODEL_FLAGS_DEFAULT,
+    };
+    err = vmaf_model_load(&model, &cfg, "vmaf_v0.6.1");
+    mu_assert("problem during vmaf_model_load", !err);
+
+    // frame 2 is partly written before the model is mounted
+    err = vmaf_feature_collector_append(feature_collector,
+                                        model->feature[0].name, 60., 2);
+    mu_assert("problem during vmaf_feature_collector_append", !err);
+    err = vmaf_feature_collector_mount_model(feature_collector, model);
+    mu_assert("problem during vmaf_mount_model", !err);
+
+    // interleave frames, the last feature of each frame arrives last
+    for (unsigned i = 0; i < model->n_features; i++) {
+        for (unsigned j = 0; j < 3; j++) {
+            if (j == 2 && i == 0) continue;
+            mu_assert("prediction should wait for every feature",
+                      !vmaf_cnt[j]);
+            err = vmaf_feature_collector_append(feature_collector,
+                                                model->feature[i].name, 60., j);
+            mu_assert("problem during vmaf_feature_collector_append", !err);
+        }
+    }
+
+    for (unsigned j = 0; j < 3; j++) {
+        mu_assert("prediction should be propagated exactly once",
+                  vmaf_cnt[j] == 1);
+        mu_assert("feature should be propagated exactly once",
+                  feature_cnt[j] == 1);
+        double score;
+        err = vmaf_feature_collector_get_score(feature_collector, "vmaf",
+                                               &score, j);
+        mu_assert("prediction should be written", !err && score == 100.);
+    }
+
+    vmaf_feature_collector_destroy(feature_collector);
+    vmaf_model_destroy(model);
+    return NULL;
+}
+
 static char *test_find_linear_function_parameters()
 {
     int err;
@@ -266,11 +335,47 @@ static char *test_piecewise_linear_mapping()
     return NULL;
 }
 
+static char *test_bootstrap_ratio_ci()
+{
+    int err;
+    double lo, hi;
+
+    const double num[] = { 80., 90., 170., 100., 60., 95. };
+    const double den[] = { 1., 1., 2., 1., 1., 1. };
+    err = vmaf_bootstrap_ratio_ci(num, den, 6, 6, 500, &lo, &hi);
+    mu_assert("problem during vmaf_bootstrap_ratio_ci", !err);
+    const double ratio = 595. / 7.;
+    mu_assert("the interval should contain the ratio",
+              lo < ratio && ratio < hi && hi - lo < 40.);
+
+    double lo_s, hi_s;
+    err = vmaf_bootstrap_ratio_ci(num, den, 6, 2, 500, &lo_s, &hi_s);
+    mu_assert("problem during vmaf_bootstrap_ratio_ci", !err);
+    mu_assert("the stratified interval should contain the ratio",
+              lo_s < ratio && ratio < hi_s);
+
+    const double flat[] = { 90., 90., 90., 90. };
+    const double ones[] = { 1., 1., 1., 1. };
+    err = vmaf_bootstrap_ratio_ci(flat, ones, 4, 2, 100, &lo, &hi);
+    mu_assert("problem during vmaf_bootstrap_ratio_ci", !err);
+    mu_assert("equal clusters should give an empty interval",
+              lo == 90. && hi == 90.);
+
+    err = vmaf_bootstrap_ratio_ci(flat, ones, 1, 1, 100, &lo, &hi);
+    mu_assert("a single cluster should fail", err);
+    err = vmaf_bootstrap_ratio_ci(flat, ones, 3, 4, 100, &lo, &hi);
+    mu_assert("fewer clusters than a stratum should fail", err);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_predict_score_at_index);
     mu_run_test(test_find_linear_function_parameters);
     mu_run_test(test_piecewise_linear_mapping);
     mu_run_test(test_propagate_metadata);
+    mu_run_test(test_propagate_metadata_once);
+    mu_run_test(test_bootstrap_ratio_ci);
     return NULL;
 }
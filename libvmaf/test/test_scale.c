@@ -0,0 +1,221 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "config.h"
+#include "cpu.h"
+#include "libvmaf/picture.h"
+#include "scale.h"
+
+#if ARCH_X86
+#include "feature/x86/scale_avx2.h"
+#elif ARCH_AARCH64
+#include "feature/arm64/scale_neon.h"
+#endif
+
+static void fill_picture(VmafPicture *pic, unsigned seed, bool flat)
+{
+    for (unsigned p = 0; p < 3; p++) {
+        for (unsigned y = 0; y < pic->h[p]; y++) {
+            uint8_t *row = (uint8_t *) pic->data[p] + y * pic->stride[p];
+            for (unsigned x = 0; x < pic->w[p]; x++) {
+                seed = seed * 1103515245u + 12345u;
+                const unsigned v = flat ? 100 + p : (seed >> 16) & 0xff;
+                if (pic->bpc == 8)
+                    row[x] = v;
+                else
+                    ((uint16_t *) row)[x] = v << (pic->bpc - 8);
+            }
+        }
+    }
+}
+
+static bool pictures_equal(VmafPicture *a, VmafPicture *b)
+{
+    for (unsigned p = 0; p < 3; p++) {
+        const size_t row_sz = a->w[p] * (a->bpc > 8 ? 2 : 1);
+        for (unsigned y = 0; y < a->h[p]; y++) {
+            if (memcmp((uint8_t *) a->data[p] + y * a->stride[p],
+                       (uint8_t *) b->data[p] + y * b->stride[p], row_sz))
+                return false;
+        }
+    }
+    return true;
+}
+
+static char *test_scale_same_size()
+{
+    int err = 0;
+    const enum VmafScaleFilter filter[] = {
+        VMAF_SCALE_FILTER_BICUBIC, VMAF_SCALE_FILTER_BILINEAR,
+        VMAF_SCALE_FILTER_LANCZOS,
+    };
+
+    for (unsigned i = 0; i < 3; i++) {
+        VmafScaler *s;
+        err = vmaf_scaler_init(&s, filter[i]);
+        mu_assert("problem during vmaf_scaler_init", !err);
+
+        VmafPicture src, dst;
+        err |= vmaf_picture_alloc(&src, VMAF_PIX_FMT_YUV420P, 10, 64, 36);
+        err |= vmaf_picture_alloc(&dst, VMAF_PIX_FMT_YUV420P, 10, 64, 36);
+        mu_assert("problem during vmaf_picture_alloc", !err);
+        fill_picture(&src, i, false);
+        err = vmaf_scaler_scale(s, &dst, &src);
+        mu_assert("problem during vmaf_scaler_scale", !err);
+        mu_assert("scaling to the same size should copy the picture",
+                  pictures_equal(&src, &dst));
+
+        vmaf_picture_unref(&src);
+        vmaf_picture_unref(&dst);
+        vmaf_scaler_destroy(s);
+    }
+
+    VmafScaler *s;
+    err = vmaf_scaler_init(&s, VMAF_SCALE_FILTER_LANCZOS + 1);
+    mu_assert("an unknown filter should fail", err);
+
+    return NULL;
+}
+
+static char *test_scale_flat()
+{
+    int err = 0;
+    VmafScaler *s;
+    err = vmaf_scaler_init(&s, VMAF_SCALE_FILTER_LANCZOS);
+    mu_assert("problem during vmaf_scaler_init", !err);
+
+    // up, then down, reusing the scaler for other sizes
+    const unsigned size[][4] = { { 50, 30, 133, 71 }, { 133, 71, 20, 16 } };
+    for (unsigned i = 0; i < 2; i++) {
+        VmafPicture src, dst, flat;
+        err |= vmaf_picture_alloc(&src, VMAF_PIX_FMT_YUV420P, 8,
+                                  size[i][0], size[i][1]);
+        err |= vmaf_picture_alloc(&dst, VMAF_PIX_FMT_YUV420P, 8,
+                                  size[i][2], size[i][3]);
+        err |= vmaf_picture_alloc(&flat, VMAF_PIX_FMT_YUV420P, 8,
+                                  size[i][2], size[i][3]);
+        mu_assert("problem during vmaf_picture_alloc", !err);
+        fill_picture(&src, 0, true);
+        fill_picture(&flat, 0, true);
+        err = vmaf_scaler_scale(s, &dst, &src);
+        mu_assert("problem during vmaf_scaler_scale", !err);
+        mu_assert("a flat picture should stay flat",
+                  pictures_equal(&dst, &flat));
+        vmaf_picture_unref(&src);
+        vmaf_picture_unref(&dst);
+        vmaf_picture_unref(&flat);
+    }
+
+    VmafPicture src, dst;
+    err |= vmaf_picture_alloc(&src, VMAF_PIX_FMT_YUV420P, 8, 32, 32);
+    err |= vmaf_picture_alloc(&dst, VMAF_PIX_FMT_YUV420P, 10, 64, 64);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    err = vmaf_scaler_scale(s, &dst, &src);
+    mu_assert("scaling to another bitdepth should fail", err);
+    vmaf_picture_unref(&src);
+    vmaf_picture_unref(&dst);
+
+    vmaf_scaler_destroy(s);
+    return NULL;
+}
+
+static char *check_kernels(void (*scale_h)(const float *, float *, unsigned,
+                                           const int32_t *, const float *,
+                                           ptrdiff_t, unsigned),
+                           void (*scale_v)(const float *const *, const float *,
+                                           unsigned, void *, unsigned,
+                                           unsigned))
+{
+    enum { W = 45, TAPS = 6, PAD = 8 };
+    float src[W + 2 * PAD], coef[TAPS * 48], rows[TAPS][W];
+    float dst_c[W], dst_simd[W];
+    int32_t pos[48];
+    uint16_t out_c[W], out_simd[W];
+
+    unsigned seed = 1;
+    for (unsigned i = 0; i < W + 2 * PAD; i++) {
+        seed = seed * 1103515245u + 12345u;
+        src[i] = (seed >> 16) % 1024;
+    }
+    for (unsigned i = 0; i < TAPS * 48; i++) {
+        seed = seed * 1103515245u + 12345u;
+        coef[i] = ((seed >> 16) % 2000) / 1000.f - 0.5f;
+    }
+    for (unsigned x = 0; x < W; x++)
+        pos[x] = (int) (x * 2 / 3) - 3;
+
+    vmaf_scale_h_c(src + PAD, dst_c, W, pos, coef, 48, TAPS);
+    scale_h(src + PAD, dst_simd, W, pos, coef, 48, TAPS);
+    mu_assert("horizontal kernel should match the c version",
+              !memcmp(dst_c, dst_simd, sizeof(dst_c)));
+
+    const float *r[TAPS];
+    for (unsigned k = 0; k < TAPS; k++) {
+        for (unsigned x = 0; x < W; x++)
+            rows[k][x] = dst_c[(x + k) % W] / 2.f;
+        r[k] = rows[k];
+    }
+    const unsigned bpc[] = { 8, 10 };
+    for (unsigned i = 0; i < 2; i++) {
+        memset(out_c, 0, sizeof(out_c));
+        memset(out_simd, 0, sizeof(out_simd));
+        vmaf_scale_v_c(r, coef, TAPS, out_c, W, bpc[i]);
+        scale_v(r, coef, TAPS, out_simd, W, bpc[i]);
+        mu_assert("vertical kernel should match the c version",
+                  !memcmp(out_c, out_simd, sizeof(out_c)));
+    }
+
+    return NULL;
+}
+
+static char *test_scale_kernels()
+{
+    vmaf_init_cpu();
+    const unsigned flags = vmaf_get_cpu_flags();
+    char *msg;
+    (void) flags;
+    (void) msg;
+
+#if ARCH_X86
+    if (flags & VMAF_X86_CPU_FLAG_AVX2) {
+        if ((msg = check_kernels(vmaf_scale_h_avx2, vmaf_scale_v_avx2)))
+            return msg;
+    }
+#elif ARCH_AARCH64
+    if (flags & VMAF_ARM_CPU_FLAG_NEON) {
+        if ((msg = check_kernels(vmaf_scale_h_neon, vmaf_scale_v_neon)))
+            return msg;
+    }
+#endif
+
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_scale_same_size);
+    mu_run_test(test_scale_flat);
+    mu_run_test(test_scale_kernels);
+    return NULL;
+}
@@ -0,0 +1,172 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libvmaf/picture.h"
+#include "subsample.h"
+#include "test.h"
+
+static int fill_picture(VmafPicture *pic, uint8_t value)
+{
+    int err = vmaf_picture_alloc(pic, VMAF_PIX_FMT_YUV420P, 8, 64, 32);
+    if (err) return err;
+    for (unsigned y = 0; y < pic->h[0]; y++)
+        memset((uint8_t *) pic->data[0] + y * pic->stride[0], value, pic->w[0]);
+    return 0;
+}
+
+/*
+ * Reads `cnt` frames of flat luma `level[i]`, with the distorted picture
+ * offset by a constant, and counts the selected frames.
+ */
+static int select_frames(VmafSubsampler *s, const uint8_t *level, unsigned cnt,
+                         bool *selected, unsigned *n_selected)
+{
+    int err = 0;
+    VmafPicture prev, ref, dist;
+    *n_selected = 0;
+
+    for (unsigned i = 0; i < cnt; i++) {
+        err |= fill_picture(&ref, level[i]);
+        err |= fill_picture(&dist, level[i] + 2);
+        if (err) return err;
+        err = vmaf_subsampler_select(s, i ? &prev : NULL, &ref, &dist, i,
+                                     &selected[i]);
+        if (err) return err;
+        *n_selected += selected[i];
+        if (i) vmaf_picture_unref(&prev);
+        vmaf_picture_unref(&dist);
+        prev = ref;
+    }
+    vmaf_picture_unref(&prev);
+    return 0;
+}
+
+static char *test_subsample_fixed()
+{
+    int err = 0;
+    VmafSubsampler *s;
+    err = vmaf_subsampler_init(&s, 3, false);
+    mu_assert("problem during vmaf_subsampler_init", !err);
+    mu_assert("a fixed stride should not be adaptive",
+              !vmaf_subsampler_adaptive(s));
+
+    for (unsigned i = 0; i < 9; i++) {
+        bool selected;
+        err = vmaf_subsampler_select(s, NULL, NULL, NULL, i, &selected);
+        mu_assert("problem during vmaf_subsampler_select", !err);
+        mu_assert("every 3rd frame should be selected",
+                  selected == !(i % 3) &&
+                  vmaf_subsampler_selected(s, i) == selected);
+    }
+    mu_assert("without a subsampler, every frame should be selected",
+              vmaf_subsampler_selected(NULL, 7));
+
+    vmaf_subsampler_destroy(s);
+    return NULL;
+}
+
+static char *test_subsample_adaptive()
+{
+    int err = 0;
+    uint8_t level[48];
+    bool selected[48];
+    unsigned n_selected;
+
+    VmafSubsampler *s;
+    err = vmaf_subsampler_init(&s, 8, true);
+    mu_assert("problem during vmaf_subsampler_init", !err);
+    memset(level, 16, sizeof(level));
+    err = select_frames(s, level, 48, selected, &n_selected);
+    mu_assert("problem during select_frames", !err);
+    mu_assert("a static shot should use the longest stride",
+              n_selected == 6 && selected[0] && selected[8] && !selected[9]);
+    vmaf_subsampler_destroy(s);
+
+    err = vmaf_subsampler_init(&s, 8, true);
+    mu_assert("problem during vmaf_subsampler_init", !err);
+    memset(level + 20, 200, sizeof(level) - 20);
+    err = select_frames(s, level, 48, selected, &n_selected);
+    mu_assert("problem during select_frames", !err);
+    mu_assert("frames after a scene cut should be selected",
+              selected[20] && selected[21] && selected[22] && !selected[23]);
+    mu_assert("selection should be recorded",
+              vmaf_subsampler_selected(s, 21) &&
+              !vmaf_subsampler_selected(s, 23));
+    vmaf_subsampler_destroy(s);
+
+    err = vmaf_subsampler_init(&s, 8, true);
+    mu_assert("problem during vmaf_subsampler_init", !err);
+    for (unsigned i = 0; i < 48; i++)
+        level[i] = 16 + 16 * i;
+    err = select_frames(s, level, 12, selected, &n_selected);
+    mu_assert("problem during select_frames", !err);
+    mu_assert("high motion should select every frame", n_selected == 12);
+    vmaf_subsampler_destroy(s);
+
+    return NULL;
+}
+
+static char *test_subsample_pool()
+{
+    int err = 0;
+    double pooled, error;
+    const double score[] = { 90., 0., 0., 96., 0., 80., 0. };
+    const bool written[] = { true, false, false, true, false, true, false };
+
+    err = vmaf_subsample_pool(score, written, 7, VMAF_POOL_METHOD_MEAN,
+                              &pooled, &error);
+    mu_assert("problem during vmaf_subsample_pool", !err);
+    const double mean = (90. + 92. + 94. + 96. + 88. + 80. + 80.) / 7.;
+    mu_assert("unscored frames should be interpolated",
+              fabs(pooled - mean) < 1e-9);
+    mu_assert("interpolated frames should carry an error",
+              error > 0. && error < 8.);
+
+    err = vmaf_subsample_pool(score, written, 7, VMAF_POOL_METHOD_MIN,
+                              &pooled, &error);
+    mu_assert("problem during vmaf_subsample_pool", !err);
+    mu_assert("min should include the interpolated frames",
+              pooled == 80. && error > 0.);
+
+    const bool none[] = { false, false };
+    err = vmaf_subsample_pool(score, none, 2, VMAF_POOL_METHOD_MEAN,
+                              &pooled, &error);
+    mu_assert("pooling without scored frames should fail", err);
+
+    const bool all[] = { true, true, true, true };
+    err = vmaf_subsample_pool(score, all, 4, VMAF_POOL_METHOD_MAX,
+                              &pooled, &error);
+    mu_assert("problem during vmaf_subsample_pool", !err);
+    mu_assert("every frame scored should carry no error",
+              pooled == 96. && error == 0.);
+
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_subsample_fixed);
+    mu_run_test(test_subsample_adaptive);
+    mu_run_test(test_subsample_pool);
+    return NULL;
+}
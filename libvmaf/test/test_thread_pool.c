@@ -16,7 +16,14 @@
  *
  */
 
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "test.h"
 #include "thread_pool.h"
@@ -77,8 +84,288 @@ static char *test_thread_pool_create_enqueue_wait_and_destroy()
     return NULL;
 }
 
+typedef struct Squares {
+    unsigned *out;
+    VmafThreadPool *pool;
+} Squares;
+
+static void fn_square(void *data, unsigned idx)
+{
+    Squares *sq = data;
+    sq->out[idx] = idx * idx;
+}
+
+static void fn_nested(void *data, unsigned idx)
+{
+    Squares *sq = data;
+    Squares inner = { .out = &sq->out[idx * 16], .pool = sq->pool };
+    vmaf_thread_pool_parallel_for(sq->pool, 16, fn_square, &inner);
+}
+
+static char *test_thread_pool_parallel_for()
+{
+    int err;
+    unsigned out[64 * 16];
+
+    VmafThreadPool *pool;
+    err = vmaf_thread_pool_create(&pool, 4);
+    mu_assert("problem during vmaf_thread_pool_init", !err);
+
+    Squares sq = { .out = out, .pool = pool };
+    memset(out, 0, sizeof(out));
+    err = vmaf_thread_pool_parallel_for(pool, 64, fn_square, &sq);
+    mu_assert("problem during vmaf_thread_pool_parallel_for", !err);
+    for (unsigned i = 0; i < 64; i++)
+        mu_assert("parallel_for did not run every index", out[i] == i * i);
+
+    memset(out, 0, sizeof(out));
+    err = vmaf_thread_pool_parallel_for(pool, 64, fn_nested, &sq);
+    mu_assert("problem during nested vmaf_thread_pool_parallel_for", !err);
+    for (unsigned i = 0; i < 64 * 16; i++)
+        mu_assert("nested parallel_for did not run every index",
+                  out[i] == (i % 16) * (i % 16));
+
+    memset(out, 0, sizeof(out));
+    err = vmaf_thread_pool_parallel_for(NULL, 64, fn_square, &sq);
+    mu_assert("parallel_for without a pool should run inline", !err);
+    for (unsigned i = 0; i < 64; i++)
+        mu_assert("inline parallel_for did not run every index", out[i] == i * i);
+
+    err = vmaf_thread_pool_destroy(pool);
+    mu_assert("problem during vmaf_thread_pool_destroy", !err);
+
+    return NULL;
+}
+
+static void fn_get_affinity(void *data)
+{
+    VmafAffinity *aff = *((VmafAffinity **) data);
+    vmaf_affinity_get(aff);
+}
+
+static char *test_thread_pool_pinned()
+{
+    int err;
+    VmafAffinity aff;
+
+    err = vmaf_affinity_parse(&aff, "0-3,8,62-65");
+    mu_assert("problem during vmaf_affinity_parse", !err);
+    mu_assert("cpu list parsed incorrectly",
+              aff.cpu[0] == (0xfull | 1ull << 8 | 3ull << 62) &&
+              aff.cpu[1] == 3 && aff.node == -1);
+    mu_assert("reversed range should fail",
+              vmaf_affinity_parse(&aff, "3-1") == -EINVAL);
+    mu_assert("trailing garbage should fail",
+              vmaf_affinity_parse(&aff, "1,x") == -EINVAL);
+    mu_assert("empty list should fail",
+              vmaf_affinity_parse(&aff, "") == -EINVAL);
+    mu_assert("unknown node should fail",
+              vmaf_affinity_parse(&aff, "node:1023") == -ENOENT);
+
+#ifdef __linux__
+    // pin to the first CPU this process may run on
+    VmafAffinity cur;
+    err = vmaf_affinity_get(&cur);
+    mu_assert("problem during vmaf_affinity_get", !err);
+    unsigned cpu = 0;
+    while (!(cur.cpu[cpu / 64] & (1ull << (cpu % 64)))) cpu++;
+    char str[16];
+    snprintf(str, sizeof(str), "%u", cpu);
+    err = vmaf_affinity_parse(&aff, str);
+    mu_assert("problem during vmaf_affinity_parse", !err);
+
+    VmafThreadPool *pool;
+    err = vmaf_thread_pool_create_pinned(&pool, 2, &aff);
+    mu_assert("problem during vmaf_thread_pool_create_pinned", !err);
+    VmafAffinity got[4];
+    memset(got, 0, sizeof(got));
+    for (unsigned i = 0; i < 4; i++) {
+        VmafAffinity *g = &got[i];
+        err = vmaf_thread_pool_enqueue(pool, fn_get_affinity, &g, sizeof(g));
+        mu_assert("problem during vmaf_thread_pool_enqueue", !err);
+    }
+    err = vmaf_thread_pool_wait(pool);
+    mu_assert("problem during vmaf_thread_pool_wait", !err);
+    for (unsigned i = 0; i < 4; i++) {
+        mu_assert("worker was not pinned",
+                  !memcmp(got[i].cpu, aff.cpu, sizeof(aff.cpu)));
+    }
+    err = vmaf_thread_pool_destroy(pool);
+    mu_assert("problem during vmaf_thread_pool_destroy", !err);
+#endif
+
+    return NULL;
+}
+
+typedef struct Order {
+    pthread_mutex_t *gate;
+    atomic_bool *started;
+    unsigned *order, *cnt;
+    unsigned id;
+} Order;
+
+static void fn_gate(void *data)
+{
+    Order *o = data;
+    atomic_store(o->started, true);
+    pthread_mutex_lock(o->gate);
+    pthread_mutex_unlock(o->gate);
+}
+
+static void fn_order(void *data)
+{
+    Order *o = data;
+    o->order[(*o->cnt)++] = o->id;
+}
+
+static char *test_thread_pool_shared()
+{
+    int err;
+    pthread_mutex_t gate = PTHREAD_MUTEX_INITIALIZER;
+    unsigned order[8], cnt = 0;
+
+    VmafExecutor *executor;
+    VmafExecutorConfiguration cfg = { .n_threads = 1 };
+    err = vmaf_executor_create(&executor, cfg);
+    mu_assert("problem during vmaf_executor_create", !err);
+    VmafThreadPool *a, *b;
+    err = vmaf_thread_pool_create_shared(&a, executor);
+    err |= vmaf_thread_pool_create_shared(&b, executor);
+    mu_assert("problem during vmaf_thread_pool_create_shared", !err);
+    mu_assert("executor in use should not be destroyed",
+              vmaf_executor_destroy(executor) == -EBUSY);
+
+    // the single worker is held while both pools queue up
+    atomic_bool started = false;
+    pthread_mutex_lock(&gate);
+    Order o = {
+        .gate = &gate, .started = &started, .order = order, .cnt = &cnt,
+    };
+    err = vmaf_thread_pool_enqueue(a, fn_gate, &o, sizeof(o));
+    while (!atomic_load(&started)) sched_yield();
+    for (unsigned i = 0; i < 4; i++)
+        err |= vmaf_thread_pool_enqueue(a, fn_order, &o, sizeof(o));
+    o.id = 1;
+    for (unsigned i = 0; i < 4; i++)
+        err |= vmaf_thread_pool_enqueue(b, fn_order, &o, sizeof(o));
+    mu_assert("problem during vmaf_thread_pool_enqueue", !err);
+    pthread_mutex_unlock(&gate);
+
+    err = vmaf_thread_pool_wait(a);
+    err |= vmaf_thread_pool_wait(b);
+    mu_assert("problem during vmaf_thread_pool_wait", !err);
+    mu_assert("not every job ran", cnt == 8);
+    for (unsigned i = 1; i < 8; i++)
+        mu_assert("pools were not served in turn", order[i] != order[i - 1]);
+
+    err = vmaf_thread_pool_destroy(a);
+    err |= vmaf_thread_pool_destroy(b);
+    mu_assert("problem during vmaf_thread_pool_destroy", !err);
+    err = vmaf_executor_destroy(executor);
+    mu_assert("problem during vmaf_executor_destroy", !err);
+
+    return NULL;
+}
+
+static char *test_thread_pool_shared_wait()
+{
+    int err;
+    pthread_mutex_t gate = PTHREAD_MUTEX_INITIALIZER;
+    unsigned order[4], cnt = 0;
+
+    VmafExecutor *executor;
+    VmafExecutorConfiguration cfg = { .n_threads = 2 };
+    err = vmaf_executor_create(&executor, cfg);
+    mu_assert("problem during vmaf_executor_create", !err);
+    VmafThreadPool *a, *b;
+    err = vmaf_thread_pool_create_shared(&a, executor);
+    err |= vmaf_thread_pool_create_shared(&b, executor);
+    mu_assert("problem during vmaf_thread_pool_create_shared", !err);
+
+    // waiting on one pool returns while the other still has a job running
+    atomic_bool started = false;
+    pthread_mutex_lock(&gate);
+    Order o = {
+        .gate = &gate, .started = &started, .order = order, .cnt = &cnt,
+        .id = 1,
+    };
+    err = vmaf_thread_pool_enqueue(a, fn_gate, &o, sizeof(o));
+    for (unsigned i = 0; i < 4; i++)
+        err |= vmaf_thread_pool_enqueue(b, fn_order, &o, sizeof(o));
+    mu_assert("problem during vmaf_thread_pool_enqueue", !err);
+    err = vmaf_thread_pool_wait(b);
+    mu_assert("problem during vmaf_thread_pool_wait", !err);
+    mu_assert("wait returned before the pool's jobs ran", cnt == 4);
+    pthread_mutex_unlock(&gate);
+
+    err = vmaf_thread_pool_destroy(a);
+    err |= vmaf_thread_pool_destroy(b);
+    mu_assert("problem during vmaf_thread_pool_destroy", !err);
+    err = vmaf_executor_destroy(executor);
+    mu_assert("problem during vmaf_executor_destroy", !err);
+
+    return NULL;
+}
+
+typedef struct Host {
+    void (*run[64])(void *arg);
+    void *arg[64];
+    unsigned cnt;
+} Host;
+
+static int host_submit(void *user_data, void (*run)(void *arg), void *arg)
+{
+    Host *host = user_data;
+    if (host->cnt == 64) return -ENOMEM;
+    host->run[host->cnt] = run;
+    host->arg[host->cnt++] = arg;
+    return 0;
+}
+
+static char *test_thread_pool_submit()
+{
+    int err;
+    unsigned order[8], cnt = 0;
+    Host host = { .cnt = 0 };
+
+    VmafExecutor *executor;
+    VmafExecutorConfiguration cfg = {
+        .n_threads = 4,
+        .submit = host_submit,
+        .user_data = &host,
+    };
+    err = vmaf_executor_create(&executor, cfg);
+    mu_assert("problem during vmaf_executor_create", !err);
+    VmafThreadPool *pool;
+    err = vmaf_thread_pool_create_shared(&pool, executor);
+    mu_assert("problem during vmaf_thread_pool_create_shared", !err);
+
+    Order o = { .order = order, .cnt = &cnt };
+    for (unsigned i = 0; i < 8; i++)
+        err |= vmaf_thread_pool_enqueue(pool, fn_order, &o, sizeof(o));
+    mu_assert("problem during vmaf_thread_pool_enqueue", !err);
+    mu_assert("jobs should wait for the host", host.cnt == 8 && !cnt);
+    for (unsigned i = 0; i < host.cnt; i++)
+        host.run[i](host.arg[i]);
+    err = vmaf_thread_pool_wait(pool);
+    mu_assert("problem during vmaf_thread_pool_wait", !err);
+    mu_assert("host did not run every job", cnt == 8);
+
+    err = vmaf_thread_pool_destroy(pool);
+    mu_assert("problem during vmaf_thread_pool_destroy", !err);
+    err = vmaf_executor_destroy(executor);
+    mu_assert("problem during vmaf_executor_destroy", !err);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_thread_pool_create_enqueue_wait_and_destroy);
+    mu_run_test(test_thread_pool_parallel_for);
+    mu_run_test(test_thread_pool_pinned);
+    mu_run_test(test_thread_pool_shared);
+    mu_run_test(test_thread_pool_shared_wait);
+    mu_run_test(test_thread_pool_submit);
     return NULL;
 }
@@ -0,0 +1,195 @@
+/**
+ *
+ *  Copyright 2016-2020 Netflix, Inc.
+ *
+ *     Licensed under the BSD+Patent License (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         https://opensource.org/licenses/BSDplusPatent
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "test.h"
+#include "dict.h"
+#include "feature/feature_collector.h"
+#include "feature/feature_extractor.h"
+#include "feature/integer_vmaf_core.h"
+#include "libvmaf/picture.h"
+
+#define N_FRAMES 4
+
+static void fill_picture(VmafPicture *pic, unsigned seed, unsigned noise)
+{
+    srand(seed);
+    for (unsigned i = 0; i < pic->h[0]; i++) {
+        for (unsigned j = 0; j < pic->w[0]; j++) {
+            const unsigned v =
+                ((i * 5 + j * 3 + seed * 2) % 200 + rand() % (noise + 1)) &
+                ((1 << pic->bpc) - 1);
+            if (pic->bpc == 8)
+                ((uint8_t *) pic->data[0])[i * pic->stride[0] + j] = v;
+            else
+                ((uint16_t *) pic->data[0])[i * (pic->stride[0] / 2) + j] = v;
+        }
+    }
+}
+
+static int extract_sequence(VmafFeatureExtractorContext **fex_ctx,
+                            unsigned n_ctx, VmafPicture *ref,
+                            VmafPicture *dist, VmafFeatureCollector *fc)
+{
+    int err = 0;
+    for (unsigned i = 0; i < N_FRAMES; i++) {
+        for (unsigned n = 0; n < n_ctx; n++) {
+            err = vmaf_feature_extractor_context_extract(fex_ctx[n], &ref[i],
+                                                         NULL, &dist[i], NULL,
+                                                         i, fc);
+            if (err) return err;
+        }
+    }
+    for (unsigned n = 0; n < n_ctx; n++) {
+        err |= vmaf_feature_extractor_context_flush(fex_ctx[n], fc);
+        err |= vmaf_feature_extractor_context_close(fex_ctx[n]);
+        err |= vmaf_feature_extractor_context_destroy(fex_ctx[n]);
+    }
+    return err;
+}
+
+static char *test_vmaf_core_matches_separate(unsigned bpc, unsigned w,
+                                             unsigned h)
+{
+    int err = 0;
+
+    VmafPicture ref[N_FRAMES], dist[N_FRAMES];
+    for (unsigned i = 0; i < N_FRAMES; i++) {
+        err |= vmaf_picture_alloc(&ref[i], VMAF_PIX_FMT_YUV400P, bpc, w, h);
+        err |= vmaf_picture_alloc(&dist[i], VMAF_PIX_FMT_YUV400P, bpc, w, h);
+        fill_picture(&ref[i], i + 1, 8);
+        fill_picture(&dist[i], i + 1, 40);
+    }
+    mu_assert("problem during vmaf_picture_alloc", !err);
+
+    const char *names[] = { "vif", "adm", "motion" };
+    VmafFeatureExtractorContext *separate[3];
+    for (unsigned n = 0; n < 3; n++) {
+        err |= vmaf_feature_extractor_context_create(&separate[n],
+                   vmaf_get_feature_extractor_by_name(names[n]), NULL);
+    }
+    mu_assert("problem during vmaf_feature_extractor_context_create", !err);
+
+    VmafFeatureCollector *expected;
+    err = vmaf_feature_collector_init(&expected);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+    err = extract_sequence(separate, 3, ref, dist, expected);
+    mu_assert("problem extracting with separate extractors", !err);
+
+    VmafFeatureExtractor *core = vmaf_get_feature_extractor_by_name("vmaf_core");
+    mu_assert("vmaf_core should be registered", core);
+
+    // 0 is a single stripe at these sizes, the others split inside the
+    // vif filter and dwt footprints
+    const char *stripe_height[] = { "0", "2", "16", "30" };
+    for (unsigned s = 0; s < 4; s++) {
+        VmafDictionary *d = NULL;
+        err = vmaf_dictionary_set(&d, "stripe_height", stripe_height[s], 0);
+        VmafFeatureExtractorContext *fused;
+        err |= vmaf_feature_extractor_context_create(&fused, core, d);
+        mu_assert("problem during vmaf_feature_extractor_context_create", !err);
+
+        VmafFeatureCollector *fc;
+        err = vmaf_feature_collector_init(&fc);
+        mu_assert("problem during vmaf_feature_collector_init", !err);
+        err = extract_sequence(&fused, 1, ref, dist, fc);
+        mu_assert("problem extracting with vmaf_core", !err);
+
+        for (unsigned i = 0; i < N_FRAMES; i++) {
+            for (unsigned j = 0; core->provided_features[j]; j++) {
+                const char *name = core->provided_features[j];
+                double a, b;
+                err = vmaf_feature_collector_get_score(expected, name, &a, i);
+                err |= vmaf_feature_collector_get_score(fc, name, &b, i);
+                mu_assert("vmaf_core is missing a score", !err);
+                mu_assert("vmaf_core does not match the separate extractors",
+                          a == b);
+            }
+        }
+        vmaf_feature_collector_destroy(fc);
+    }
+
+    vmaf_feature_collector_destroy(expected);
+    for (unsigned i = 0; i < N_FRAMES; i++) {
+        vmaf_picture_unref(&ref[i]);
+        vmaf_picture_unref(&dist[i]);
+    }
+
+    return NULL;
+}
+
+static char *test_vmaf_core()
+{
+    char *msg;
+    if ((msg = test_vmaf_core_matches_separate(8, 176, 144))) return msg;
+    if ((msg = test_vmaf_core_matches_separate(8, 170, 98))) return msg;
+    if ((msg = test_vmaf_core_matches_separate(10, 176, 144))) return msg;
+    return NULL;
+}
+
+static char *test_vmaf_core_provides()
+{
+    int err = 0;
+
+    VmafDictionary *d = NULL;
+    err |= vmaf_dictionary_set(&d, "vif_enhn_gain_limit", "1.0", 0);
+    VmafFeatureExtractorContext *core;
+    err |= vmaf_feature_extractor_context_create(&core,
+               vmaf_get_feature_extractor_by_name("vmaf_core"), d);
+
+    VmafDictionary *d_vif = NULL;
+    err |= vmaf_dictionary_set(&d_vif, "vif_enhn_gain_limit", "1.0", 0);
+    VmafFeatureExtractorContext *vif, *vif_default, *adm, *psnr;
+    err |= vmaf_feature_extractor_context_create(&vif,
+               vmaf_get_feature_extractor_by_name("vif"), d_vif);
+    err |= vmaf_feature_extractor_context_create(&vif_default,
+               vmaf_get_feature_extractor_by_name("vif"), NULL);
+    err |= vmaf_feature_extractor_context_create(&adm,
+               vmaf_get_feature_extractor_by_name("adm"), NULL);
+    err |= vmaf_feature_extractor_context_create(&psnr,
+               vmaf_get_feature_extractor_by_name("psnr"), NULL);
+    mu_assert("problem during vmaf_feature_extractor_context_create", !err);
+
+    mu_assert("vif with the same parameters should be covered",
+              vmaf_core_provides(core, vif));
+    mu_assert("vif with different parameters should not be covered",
+              !vmaf_core_provides(core, vif_default));
+    mu_assert("adm with default parameters should be covered",
+              vmaf_core_provides(core, adm));
+    mu_assert("other extractors should not be covered",
+              !vmaf_core_provides(core, psnr));
+    mu_assert("only vmaf_core covers other extractors",
+              !vmaf_core_provides(vif, vif));
+
+    vmaf_feature_extractor_context_destroy(core);
+    vmaf_feature_extractor_context_destroy(vif);
+    vmaf_feature_extractor_context_destroy(vif_default);
+    vmaf_feature_extractor_context_destroy(adm);
+    vmaf_feature_extractor_context_destroy(psnr);
+
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_vmaf_core);
+    mu_run_test(test_vmaf_core_provides);
+    return NULL;
+}
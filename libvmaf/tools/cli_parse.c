@@ -19,9 +19,18 @@ enum {
     ARG_OUTPUT_JSON,
     ARG_OUTPUT_CSV,
     ARG_OUTPUT_SUB,
+    ARG_OUTPUT_BINARY,
     ARG_THREADS,
     ARG_FEATURE,
     ARG_SUBSAMPLE,
+    ARG_SUBSAMPLE_ADAPTIVE,
+    ARG_PROGRESSIVE,
+    ARG_SEGMENT,
+    ARG_SEGMENT_WARMUP,
+    ARG_CHECKPOINT,
+    ARG_CHECKPOINT_INTERVAL,
+    ARG_Y4M_INDEX,
+    ARG_SCALE_FILTER,
     ARG_CPUMASK,
     ARG_GPUMASK,
     ARG_AOM_CTC,
@@ -29,6 +38,14 @@ enum {
     ARG_FRAME_CNT,
     ARG_FRAME_SKIP_REF,
     ARG_FRAME_SKIP_DIST,
+    ARG_PERF,
+    ARG_AUTOTUNE,
+    ARG_AUTOTUNE_CACHE,
+    ARG_FEATURE_CACHE,
+    ARG_IMPORT,
+    ARG_SCRATCH_BUDGET,
+    ARG_CPU_AFFINITY,
+    ARG_SCRATCH_ARENA,
 };
 
 static const struct option long_opts[] = {
@@ -44,9 +61,18 @@ static const struct option long_opts[] = {
     { "json",             0, NULL, ARG_OUTPUT_JSON },
     { "csv",              0, NULL, ARG_OUTPUT_CSV },
     { "sub",              0, NULL, ARG_OUTPUT_SUB },
+    { "bin",              0, NULL, ARG_OUTPUT_BINARY },
     { "threads",          1, NULL, ARG_THREADS },
     { "feature",          1, NULL, ARG_FEATURE },
     { "subsample",        1, NULL, ARG_SUBSAMPLE },
+    { "subsample_adaptive", 0, NULL, ARG_SUBSAMPLE_ADAPTIVE },
+    { "progressive",      1, NULL, ARG_PROGRESSIVE },
+    { "segment",          1, NULL, ARG_SEGMENT },
+    { "segment_warmup",   1, NULL, ARG_SEGMENT_WARMUP },
+    { "checkpoint",       1, NULL, ARG_CHECKPOINT },
+    { "checkpoint_interval", 1, NULL, ARG_CHECKPOINT_INTERVAL },
+    { "y4m_index",        0, NULL, ARG_Y4M_INDEX },
+    { "scale_filter",     1, NULL, ARG_SCALE_FILTER },
     { "cpumask",          1, NULL, ARG_CPUMASK },
     { "gpumask",          1, NULL, ARG_GPUMASK },
     { "aom_ctc",          1, NULL, ARG_AOM_CTC },
@@ -54,6 +80,14 @@ static const struct option long_opts[] = {
     { "frame_cnt",        1, NULL, ARG_FRAME_CNT },
     { "frame_skip_ref",   1, NULL, ARG_FRAME_SKIP_REF },
     { "frame_skip_dist",  1, NULL, ARG_FRAME_SKIP_DIST },
+    { "perf",             0, NULL, ARG_PERF },
+    { "autotune",         0, NULL, ARG_AUTOTUNE },
+    { "autotune_cache",   1, NULL, ARG_AUTOTUNE_CACHE },
+    { "feature_cache",    1, NULL, ARG_FEATURE_CACHE },
+    { "import",           1, NULL, ARG_IMPORT },
+    { "scratch_budget",   1, NULL, ARG_SCRATCH_BUDGET },
+    { "cpu_affinity",     1, NULL, ARG_CPU_AFFINITY },
+    { "scratch_arena",    1, NULL, ARG_SCRATCH_ARENA },
     { "no_prediction",    0, NULL, 'n' },
     { "version",          0, NULL, 'v' },
     { "quiet",            0, NULL, 'q' },
@@ -85,14 +119,50 @@ static void usage(const char *const app, const char *const reason, ...) {
             " --json:                      write output file as JSON\n"
             " --csv:                       write output file as CSV\n"
             " --sub:                       write output file as subtitle\n"
+            " --bin:                       write output file as lossless binary\n"
+            "                              feature scores, see --import\n"
             " --threads $unsigned:         number of threads to use\n"
+            " --scale_filter $string:      filter scaling a distorted input of\n"
+            "                              another size, bicubic (default),\n"
+            "                              bilinear or lanczos\n"
+            " --scratch_budget $unsigned:  MiB of extractor scratch buffers the\n"
+            "                              threads may allocate, 0 for no limit\n"
+            " --cpu_affinity $string:      pin the reader and threads to a CPU\n"
+            "                              list (e.g. 0-7,16-23) or node:N\n"
+            " --scratch_arena $string:     allocate extractor scratch from one\n"
+            "                              arena, comma separated on/huge/prefault\n"
             " --feature $string:           additional feature\n"
             " --cpumask: $bitmask          restrict permitted CPU instruction sets\n"
             " --gpumask: $bitmask          restrict permitted GPU operations\n"
             " --frame_cnt $unsigned:       maximum number of frames to process\n"
             " --frame_skip_ref $unsigned:  skip the first N frames in reference\n"
             " --frame_skip_dist $unsigned: skip the first N frames in distorted\n"
+            " --y4m_index:                 keep the frame offsets of .y4m inputs\n"
+            "                              beside them, as $path.idx, for seeking\n"
             " --subsample: $unsigned       compute scores only every N frames\n"
+            " --subsample_adaptive:        adapt the subsampling to motion and\n"
+            "                              scene cuts, N as the longest stride\n"
+            " --progressive $float:        score frames out of order, stopping when\n"
+            "                              the 95%% interval of the pooled mean is\n"
+            "                              within +/- $float, seekable input only\n"
+            " --segment $low:$high:        score frames $low to $high only, write\n"
+            "                              --bin output to merge with --import\n"
+            " --segment_warmup $unsigned:  frames read either side of a --segment\n"
+            "                              for temporal features, not scored (1)\n"
+            " --checkpoint $path:          save progress to $path, resume from it\n"
+            "                              if it exists, seekable input only\n"
+            " --checkpoint_interval $unsigned:\n"
+            "                              seconds between checkpoints (60)\n"
+            " --perf:                      report per-extractor timing, also\n"
+            "                              written to the XML/JSON output\n"
+            " --autotune:                  time SIMD kernel variants on the first\n"
+            "                              frame and use the fastest\n"
+            " --autotune_cache $path:      autotune, reusing results stored in $path\n"
+            " --feature_cache $path:       reuse per-frame feature scores stored in\n"
+            "                              $path, append new ones\n"
+            " --import $path:              score models from the features in a\n"
+            "                              --bin or --json output, without\n"
+            "                              reading -r/-d, repeat to merge segments\n"
             " --quiet/-q:                  disable FPS meter when run in a TTY\n"
             " --no_prediction/-n:          no prediction, extract features only\n"
             " --version/-v:                print version and exit\n"
@@ -129,6 +199,29 @@ static unsigned parse_unsigned(const char *const optarg, const int option,
     return res;
 }
 
+static double parse_double(const char *const optarg, const int option,
+                           const char *const app)
+{
+    char *end;
+    const double res = strtod(optarg, &end);
+    if (*end || end == optarg) error(app, optarg, option, "a number");
+    return res;
+}
+
+static void parse_segment(const char *const optarg, const int option,
+                          const char *const app, CLISettings *const settings)
+{
+    char *end;
+    settings->segment_low = (unsigned) strtoul(optarg, &end, 0);
+    if (end == optarg || *end != ':')
+        error(app, optarg, option, "two frame indices, $low:$high");
+    const char *high = end + 1;
+    settings->segment_high = (unsigned) strtoul(high, &end, 0);
+    if (end == high || *end || settings->segment_high < settings->segment_low)
+        error(app, optarg, option, "two frame indices, $low:$high");
+    settings->segment = true;
+}
+
 static unsigned parse_bitdepth(const char *const optarg, const int option,
                                const char *const app)
 {
@@ -157,6 +250,41 @@ static enum VmafPixelFormat parse_pix_fmt(const char *const optarg,
     return pix_fmt;
 }
 
+static enum VmafScaleFilter parse_scale_filter(const char *const optarg,
+                                               const int option,
+                                               const char *const app)
+{
+    if (!strcmp(optarg, "bicubic"))
+        return VMAF_SCALE_FILTER_BICUBIC;
+    if (!strcmp(optarg, "bilinear"))
+        return VMAF_SCALE_FILTER_BILINEAR;
+    if (!strcmp(optarg, "lanczos"))
+        return VMAF_SCALE_FILTER_LANCZOS;
+
+    error(app, optarg, option, "a valid scale filter "
+                               "(bicubic/bilinear/lanczos)");
+    return VMAF_SCALE_FILTER_BICUBIC;
+}
+
+static unsigned parse_scratch_arena(const char *const optarg,
+                                    const int option, const char *const app)
+{
+    unsigned flags = VMAF_SCRATCH_ARENA;
+
+    for (const char *p = optarg; *p;) {
+        const size_t len = strcspn(p, ",");
+        if (len == 4 && !strncmp(p, "huge", len))
+            flags |= VMAF_SCRATCH_ARENA_HUGE_PAGES;
+        else if (len == 8 && !strncmp(p, "prefault", len))
+            flags |= VMAF_SCRATCH_ARENA_PREFAULT;
+        else if (len != 2 || strncmp(p, "on", len))
+            error(app, optarg, option, "a list of on/huge/prefault");
+        p += len + (p[len] == ',');
+    }
+
+    return flags;
+}
+
 #ifndef HAVE_STRSEP
 static char *strsep(char **sp, char *sep)
 {
@@ -404,6 +532,8 @@ void cli_parse(const int argc, char *const *const argv,
                CLISettings *const settings)
 {
     memset(settings, 0, sizeof(*settings));
+    settings->checkpoint_interval = CLI_SETTINGS_CHECKPOINT_INTERVAL;
+    settings->segment_warmup = CLI_SETTINGS_SEGMENT_WARMUP;
     int o;
 
     while ((o = getopt_long(argc, argv, short_opts, long_opts, NULL)) >= 0) {
@@ -445,6 +575,9 @@ void cli_parse(const int argc, char *const *const argv,
         case ARG_OUTPUT_SUB:
             settings->output_fmt = VMAF_OUTPUT_FORMAT_SUB;
             break;
+        case ARG_OUTPUT_BINARY:
+            settings->output_fmt = VMAF_OUTPUT_FORMAT_BINARY;
+            break;
         case 'm':
             if (settings->model_cnt == CLI_SETTINGS_STATIC_ARRAY_LEN) {
                 usage(argv[0], "A maximum of %d models are supported\n",
@@ -467,6 +600,34 @@ void cli_parse(const int argc, char *const *const argv,
         case ARG_SUBSAMPLE:
             settings->subsample = parse_unsigned(optarg, 's', argv[0]);
             break;
+        case ARG_SUBSAMPLE_ADAPTIVE:
+            settings->subsample_adaptive = true;
+            break;
+        case ARG_PROGRESSIVE:
+            settings->progressive =
+                parse_double(optarg, ARG_PROGRESSIVE, argv[0]);
+            if (!(settings->progressive > 0.))
+                error(argv[0], optarg, ARG_PROGRESSIVE, "a positive number");
+            break;
+        case ARG_SEGMENT:
+            parse_segment(optarg, ARG_SEGMENT, argv[0], settings);
+            break;
+        case ARG_SEGMENT_WARMUP:
+            settings->segment_warmup =
+                parse_unsigned(optarg, ARG_SEGMENT_WARMUP, argv[0]);
+            if (!settings->segment_warmup)
+                error(argv[0], optarg, ARG_SEGMENT_WARMUP, "at least 1 frame");
+            break;
+        case ARG_CHECKPOINT:
+            settings->checkpoint_path = optarg;
+            break;
+        case ARG_CHECKPOINT_INTERVAL:
+            settings->checkpoint_interval =
+                parse_unsigned(optarg, ARG_CHECKPOINT_INTERVAL, argv[0]);
+            break;
+        case ARG_Y4M_INDEX:
+            settings->y4m_index = true;
+            break;
         case ARG_CPUMASK:
             settings->cpumask = parse_unsigned(optarg, 'c', argv[0]);
             break;
@@ -489,6 +650,41 @@ void cli_parse(const int argc, char *const *const argv,
         case ARG_FRAME_SKIP_DIST:
             settings->frame_skip_dist = parse_unsigned(optarg, ARG_FRAME_SKIP_DIST, argv[0]);
             break;
+        case ARG_PERF:
+            settings->perf_stats = true;
+            break;
+        case ARG_AUTOTUNE:
+            settings->autotune = true;
+            break;
+        case ARG_AUTOTUNE_CACHE:
+            settings->autotune = true;
+            settings->autotune_cache = optarg;
+            break;
+        case ARG_FEATURE_CACHE:
+            settings->feature_cache = optarg;
+            break;
+        case ARG_IMPORT:
+            if (settings->import_cnt == CLI_SETTINGS_IMPORT_LEN) {
+                usage(argv[0], "A maximum of %d imports are supported\n",
+                      CLI_SETTINGS_IMPORT_LEN);
+            }
+            settings->import_path[settings->import_cnt++] = optarg;
+            break;
+        case ARG_SCRATCH_BUDGET:
+            settings->scratch_budget =
+                parse_unsigned(optarg, ARG_SCRATCH_BUDGET, argv[0]);
+            break;
+        case ARG_CPU_AFFINITY:
+            settings->cpu_affinity = optarg;
+            break;
+        case ARG_SCALE_FILTER:
+            settings->scale_filter =
+                parse_scale_filter(optarg, ARG_SCALE_FILTER, argv[0]);
+            break;
+        case ARG_SCRATCH_ARENA:
+            settings->scratch_arena =
+                parse_scratch_arena(optarg, ARG_SCRATCH_ARENA, argv[0]);
+            break;
         case 'n':
             settings->no_prediction = true;
             break;
@@ -505,12 +701,36 @@ void cli_parse(const int argc, char *const *const argv,
 
     if (!settings->output_fmt)
         settings->output_fmt = VMAF_OUTPUT_FORMAT_XML;
-    if (!settings->path_ref)
+    if (settings->progressive &&
+        (settings->import_cnt || settings->no_prediction ||
+         settings->subsample_adaptive))
+    {
+        usage(argv[0], "--progressive can not be combined with --import, "
+                       "--no_prediction or --subsample_adaptive");
+    }
+    if (settings->segment &&
+        (settings->import_cnt || settings->progressive ||
+         settings->subsample_adaptive))
+    {
+        usage(argv[0], "--segment can not be combined with --import, "
+                       "--progressive or --subsample_adaptive");
+    }
+    if (settings->checkpoint_path &&
+        (settings->import_cnt || settings->progressive || settings->segment ||
+         settings->subsample_adaptive))
+    {
+        usage(argv[0], "--checkpoint can not be combined with --import, "
+                       "--progressive, --segment or --subsample_adaptive");
+    }
+    if (settings->import_cnt && (settings->path_ref || settings->path_dist))
+        usage(argv[0], "--import can not be combined with -r/-d");
+    if (!settings->path_ref && !settings->import_cnt)
         usage(argv[0], "Reference .y4m or .yuv (-r/--reference) is required");
-    if (!settings->path_dist)
+    if (!settings->path_dist && !settings->import_cnt)
         usage(argv[0], "Distorted .y4m or .yuv (-d/--distorted) is required");
-    if (settings->use_yuv && !(settings->width && settings->height &&
-        settings->pix_fmt && settings->bitdepth))
+    if (!settings->import_cnt && settings->use_yuv &&
+        !(settings->width && settings->height &&
+          settings->pix_fmt && settings->bitdepth))
     {
         usage(argv[0], "The following options are required for .yuv input:\n"
                        "  --width/-w\n"
@@ -9,6 +9,9 @@
 #include "libvmaf/feature.h"
 
 #define CLI_SETTINGS_STATIC_ARRAY_LEN 32
+#define CLI_SETTINGS_IMPORT_LEN 1024 ///< segments merged at once
+#define CLI_SETTINGS_CHECKPOINT_INTERVAL 60 ///< seconds
+#define CLI_SETTINGS_SEGMENT_WARMUP 1 ///< frames either side of a segment
 
 typedef struct {
     const char *name;
@@ -45,12 +48,29 @@ typedef struct {
     unsigned feature_cnt;
     enum VmafLogLevel log_level;
     unsigned subsample;
+    bool subsample_adaptive;
+    double progressive;
+    bool segment;
+    unsigned segment_low, segment_high, segment_warmup;
+    const char *checkpoint_path;
+    unsigned checkpoint_interval;
+    bool y4m_index;
+    enum VmafScaleFilter scale_filter;
     unsigned thread_cnt;
     bool no_prediction;
     bool quiet;
     bool common_bitdepth;
     unsigned cpumask;
     unsigned gpumask;
+    bool perf_stats;
+    bool autotune;
+    const char *autotune_cache;
+    const char *feature_cache;
+    const char *import_path[CLI_SETTINGS_IMPORT_LEN];
+    unsigned import_cnt;
+    unsigned scratch_budget;
+    const char *cpu_affinity;
+    unsigned scratch_arena;
 } CLISettings;
 
 void cli_parse(const int argc, char *const *const argv,
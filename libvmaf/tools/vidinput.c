@@ -67,6 +67,21 @@ int video_input_fetch_frame(video_input *_vid,
   return (*_vid->vtbl->fetch_frame)(_vid->ctx,_vid->fin,_ycbcr,_tag);
 }
 
+int video_input_seek_frame(video_input *_vid,unsigned _frame) {
+  if (!_vid->vtbl->seek_frame) return -1;
+  return (*_vid->vtbl->seek_frame)(_vid->ctx,_vid->fin,_frame);
+}
+
+int video_input_frame_cnt(video_input *_vid,unsigned *_cnt) {
+  if (!_vid->vtbl->frame_cnt) return -1;
+  return (*_vid->vtbl->frame_cnt)(_vid->ctx,_vid->fin,_cnt);
+}
+
+int video_input_set_index(video_input *_vid,const char *_path) {
+  if (!_vid->vtbl->set_index) return 0;
+  return (*_vid->vtbl->set_index)(_vid->ctx,_vid->fin,_path);
+}
+
 void video_input_close(video_input *_vid) {
   (*_vid->vtbl->close)(_vid->ctx);
   free(_vid->ctx);
@@ -35,6 +35,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 # endif
 # include <stdio.h>
 # include <stdint.h>
+# if defined(_MSC_VER)
+#  define fseeko _fseeki64
+#  define ftello _ftelli64
+# endif
 
 # if defined(__cplusplus)
 extern "C" {
@@ -55,6 +59,12 @@ typedef void* (*video_input_open_func)(FILE *_fin);
 typedef void (*video_input_get_info_func)(void *_ctx,video_input_info *_ti);
 typedef int (*video_input_fetch_frame_func)(void *_ctx,FILE *_fin,
  video_input_ycbcr _ycbcr,char _tag[5]);
+typedef int (*video_input_seek_frame_func)(void *_ctx,FILE *_fin,
+ unsigned _frame);
+typedef int (*video_input_frame_cnt_func)(void *_ctx,FILE *_fin,
+ unsigned *_cnt);
+typedef int (*video_input_set_index_func)(void *_ctx,FILE *_fin,
+ const char *_path);
 typedef void (*video_input_close_func)(void *_ctx);
 typedef void* (*raw_input_open_func)(FILE *_fin,
                                      unsigned width, unsigned height,
@@ -68,6 +78,9 @@ struct video_input_vtbl {
   video_input_get_info_func     get_info;
   video_input_fetch_frame_func  fetch_frame;
   video_input_close_func        close;
+  video_input_seek_frame_func   seek_frame;
+  video_input_frame_cnt_func    frame_cnt;
+  video_input_set_index_func    set_index;
 };
 
 struct video_input {
@@ -86,6 +99,16 @@ void video_input_close(video_input *_vid);
 void video_input_get_info(video_input *_vid, video_input_info *_ti);
 int video_input_fetch_frame(video_input *_vid, video_input_ycbcr _ycbcr,
                             char _tag[5]);
+/*Position the input so that the next fetch returns frame _frame (counted
+   from the start of the file). Fails on inputs which cannot seek.*/
+int video_input_seek_frame(video_input *_vid, unsigned _frame);
+/*The number of frames in the input. Fails on inputs which cannot seek.*/
+int video_input_frame_cnt(video_input *_vid, unsigned *_cnt);
+/*Keep the frame index of an input which needs one to seek, such as y4m, in
+   the file _path: it is loaded from there if it matches the input, and the
+   frames located while reading are saved back on close. Inputs which seek
+   without an index ignore it.*/
+int video_input_set_index(video_input *_vid, const char *_path);
 
 typedef enum {
   /** Chroma decimation by 2 in both the X and Y directions (4:2:0).
@@ -1,3 +1,5 @@
+#include <errno.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -35,12 +37,6 @@ static int validate_videos(video_input *vid1, video_input *vid2, bool common_bit
     video_input_get_info(vid1, &info1);
     video_input_get_info(vid2, &info2);
 
-    if ((info1.frame_w != info2.frame_w) || (info1.frame_h != info2.frame_h)) {
-        fprintf(stderr, "dimensions do not match: %dx%d, %dx%d\n",
-                info1.frame_w, info1.frame_h, info2.frame_w, info2.frame_h);
-        err_cnt++;
-    }
-
     if (info1.pixel_fmt != info2.pixel_fmt) {
         fprintf(stderr, "pixel formats do not match: %d, %d\n",
                 info1.pixel_fmt, info2.pixel_fmt);
@@ -166,77 +162,479 @@ static int fetch_picture(video_input *vid, VmafPicture *pic, int depth)
     return 0;
 }
 
-int main(int argc, char *argv[])
+static void print_perf_stats(VmafContext *vmaf)
 {
-    int err = 0;
-    const int istty = isatty(fileno(stderr));
-
-    CLISettings c;
-    cli_parse(argc, argv, &c);
+    VmafPerfStats stats;
+    int err = vmaf_get_perf_stats(vmaf, &stats);
+    if (err == -ENOSYS) {
+        fprintf(stderr, "perf: libvmaf was built without perf stats\n");
+        return;
+    }
+    if (err) {
+        fprintf(stderr, "problem getting perf stats\n");
+        return;
+    }
 
-    if (istty && !c.quiet) {
-        fprintf(stderr, "VMAF version %s\n", vmaf_version());
+    fprintf(stderr, "%-24s %8s %10s %12s %10s %8s %12s\n", "extractor",
+            "frames", "init ms", "extract ms", "max ms", "cpu %",
+            "pool wait ms");
+    for (unsigned i = 0; i < stats.n_extractors; i++) {
+        const VmafPerfExtractorStats *e = &stats.extractor[i];
+        const VmafPerfTiming *x = &e->extract;
+        fprintf(stderr, "%-24s %8"PRIu64" %10.3f %12.3f %10.3f %8.1f %12.3f\n",
+                e->name, x->count, e->init.wall_ns / 1e6,
+                x->count ? x->wall_ns / 1e6 / x->count : 0.,
+                x->max_wall_ns / 1e6,
+                x->wall_ns ? 100. * x->cpu_ns / x->wall_ns : 0.,
+                e->pool_wait.wall_ns / 1e6);
+    }
+    if (stats.queue_wait.count) {
+        fprintf(stderr, "thread pool queue wait: %.3f ms avg, %.3f ms max\n",
+                stats.queue_wait.wall_ns / 1e6 / stats.queue_wait.count,
+                stats.queue_wait.max_wall_ns / 1e6);
     }
+    fprintf(stderr, "collector lock: %"PRIu64" acquired, %"PRIu64" contended, "
+            "%.3f ms waiting\n", stats.collector_lock.acquired,
+            stats.collector_lock.contended,
+            stats.collector_lock.wait_ns / 1e6);
+    fprintf(stderr, "allocated: %.1f MiB\n",
+            stats.bytes_allocated / (1024. * 1024.));
+    if (stats.scratch_peak) {
+        fprintf(stderr, "extractor scratch peak: %.1f MiB\n",
+                stats.scratch_peak / (1024. * 1024.));
+    }
+}
 
-    FILE *file_ref = fopen(c.path_ref, "rb");
+// the frame index of a .y4m input is kept beside it
+static int set_index(video_input *vid, const char *path)
+{
+    const size_t sz = strlen(path) + sizeof(".idx");
+    char *index_path = malloc(sz);
+    if (!index_path) return -1;
+    snprintf(index_path, sz, "%s.idx", path);
+    int err = video_input_set_index(vid, index_path);
+    if (err)
+        fprintf(stderr, "problem with frame index: %s\n", index_path);
+    free(index_path);
+    return err;
+}
+
+static int open_videos(const CLISettings *c, video_input *vid_ref,
+                       video_input *vid_dist, int *common_bitdepth)
+{
+    int err;
+
+    FILE *file_ref = fopen(c->path_ref, "rb");
     if (!file_ref) {
-        fprintf(stderr, "could not open file: %s\n", c.path_ref);
+        fprintf(stderr, "could not open file: %s\n", c->path_ref);
         return -1;
     }
 
-    FILE *file_dist = fopen(c.path_dist, "rb");
+    FILE *file_dist = fopen(c->path_dist, "rb");
     if (!file_dist) {
-        fprintf(stderr, "could not open file: %s\n", c.path_dist);
+        fprintf(stderr, "could not open file: %s\n", c->path_dist);
         return -1;
     }
 
-    video_input vid_ref;
-    if (c.use_yuv) {
-        err = raw_input_open(&vid_ref, file_ref,
-                             c.width, c.height, c.pix_fmt, c.bitdepth);
+    if (c->use_yuv) {
+        err = raw_input_open(vid_ref, file_ref,
+                             c->width, c->height, c->pix_fmt, c->bitdepth);
     } else {
-        err = video_input_open(&vid_ref, file_ref);
+        err = video_input_open(vid_ref, file_ref);
     }
     if (err) {
-        fprintf(stderr, "problem with reference file: %s\n", c.path_ref);
+        fprintf(stderr, "problem with reference file: %s\n", c->path_ref);
         return -1;
     }
 
-    video_input vid_dist;
-    if (c.use_yuv) {
-        err = raw_input_open(&vid_dist, file_dist,
-                             c.width, c.height, c.pix_fmt, c.bitdepth);
+    if (c->use_yuv) {
+        err = raw_input_open(vid_dist, file_dist,
+                             c->width, c->height, c->pix_fmt, c->bitdepth);
     } else {
-        err = video_input_open(&vid_dist, file_dist);
+        err = video_input_open(vid_dist, file_dist);
     }
     if (err) {
-        fprintf(stderr, "problem with distorted file: %s\n", c.path_dist);
+        fprintf(stderr, "problem with distorted file: %s\n", c->path_dist);
         return -1;
     }
 
-    err = validate_videos(&vid_ref, &vid_dist, c.common_bitdepth);
+    if (c->y4m_index && !c->use_yuv) {
+        err = set_index(vid_ref, c->path_ref);
+        err |= set_index(vid_dist, c->path_dist);
+        if (err) return -1;
+    }
+
+    err = validate_videos(vid_ref, vid_dist, c->common_bitdepth);
     if (err) {
         fprintf(stderr, "videos are incompatible, %d %s.\n",
                 err, err == 1 ? "problem" : "problems");
         return -1;
     }
 
-    int common_bitdepth;
-    if (c.use_yuv) {
-        common_bitdepth = c.bitdepth;
+    if (c->use_yuv) {
+        *common_bitdepth = c->bitdepth;
     } else {
         video_input_info info1, info2;
-        video_input_get_info(&vid_ref, &info1);
-        video_input_get_info(&vid_dist, &info2);
-        common_bitdepth = info1.depth > info2.depth ? info1.depth : info2.depth;
+        video_input_get_info(vid_ref, &info1);
+        video_input_get_info(vid_dist, &info2);
+        *common_bitdepth = info1.depth > info2.depth ? info1.depth : info2.depth;
+    }
+
+    return 0;
+}
+
+#define PROGRESSIVE_WINDOW 16 ///< consecutive frames read at once
+
+static unsigned bit_reverse(unsigned v, unsigned bits)
+{
+    unsigned r = 0;
+    for (unsigned i = 0; i < bits; i++, v >>= 1)
+        r = (r << 1) | (v & 1);
+    return r;
+}
+
+static int progressive_converged(VmafContext *vmaf, VmafModel **model,
+                                 unsigned model_cnt, unsigned frame_cnt,
+                                 double tolerance)
+{
+    for (unsigned i = 0; i < model_cnt; i++) {
+        VmafPooledEstimate est;
+        int err = vmaf_score_pooled_estimate(vmaf, model[i],
+                                             VMAF_POOL_METHOD_MEAN, &est,
+                                             0, frame_cnt - 1);
+        if (err) return 0;
+        if ((est.ci.hi - est.ci.lo) / 2. > tolerance) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Reads frames `low` to `high` of `n` with `warmup` frames either side for
+ * the temporal features, which are extracted but not scored. Those in this
+ * tree only look one frame back and ahead.
+ */
+static int read_range(VmafContext *vmaf, const CLISettings *c,
+                      video_input *vid_ref, video_input *vid_dist, int depth,
+                      unsigned low, unsigned high, unsigned n, unsigned warmup)
+{
+    int err = vmaf_set_read_range(vmaf, low, high);
+    if (err) {
+        fprintf(stderr, "\nproblem setting read range\n");
+        return err;
+    }
+
+    const unsigned first = low > warmup ? low - warmup : 0;
+    const unsigned last = n - 1 - high > warmup ? high + warmup : n - 1;
+    if (video_input_seek_frame(vid_ref, c->frame_skip_ref + first) ||
+        video_input_seek_frame(vid_dist, c->frame_skip_dist + first))
+    {
+        fprintf(stderr, "\nproblem seeking to frame %u\n", first);
+        return -1;
+    }
+
+    for (unsigned i = first; i <= last; i++) {
+        VmafPicture pic_ref, pic_dist;
+        int ret1 = fetch_picture(vid_ref, &pic_ref, depth);
+        int ret2 = fetch_picture(vid_dist, &pic_dist, depth);
+        if (ret1 || ret2) {
+            if (!ret1) vmaf_picture_unref(&pic_ref);
+            if (!ret2) vmaf_picture_unref(&pic_dist);
+            fprintf(stderr, "\nproblem while reading pictures\n");
+            return -1;
+        }
+
+        err = vmaf_read_pictures(vmaf, &pic_ref, &pic_dist, i);
+        if (err) {
+            fprintf(stderr, "\nproblem reading pictures\n");
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+static int seekable_frame_cnt(const CLISettings *c, video_input *vid_ref,
+                              video_input *vid_dist, unsigned *frame_cnt)
+{
+    unsigned cnt_ref, cnt_dist;
+    if (video_input_frame_cnt(vid_ref, &cnt_ref) ||
+        video_input_frame_cnt(vid_dist, &cnt_dist))
+    {
+        return -1;
+    }
+    cnt_ref = cnt_ref > c->frame_skip_ref ? cnt_ref - c->frame_skip_ref : 0;
+    cnt_dist = cnt_dist > c->frame_skip_dist ? cnt_dist - c->frame_skip_dist : 0;
+    unsigned n = cnt_ref < cnt_dist ? cnt_ref : cnt_dist;
+    if (c->frame_cnt && c->frame_cnt < n)
+        n = c->frame_cnt;
+    *frame_cnt = n;
+    return 0;
+}
+
+/*
+ * Reads windows of frames in bit-reversed order, so that the windows read
+ * so far are spread over the whole clip, until the pooled mean of every
+ * model is known to within the requested tolerance. The last window is
+ * read last, its final frame's temporal features are written on flush.
+ */
+static int read_progressive(VmafContext *vmaf, const CLISettings *c,
+                            video_input *vid_ref, video_input *vid_dist,
+                            int depth, VmafModel **model, bool progress,
+                            unsigned *frame_cnt)
+{
+    unsigned n;
+    if (seekable_frame_cnt(c, vid_ref, vid_dist, &n)) {
+        fprintf(stderr, "--progressive requires seekable input\n");
+        return -1;
+    }
+    if (!n) {
+        fprintf(stderr, "no frames to read\n");
+        return -1;
+    }
+
+    const unsigned n_win = (n + PROGRESSIVE_WINDOW - 1) / PROGRESSIVE_WINDOW;
+    unsigned bits = 0;
+    while ((1u << bits) < n_win) bits++;
+
+    unsigned win_cnt = 0, check = 8, pic_cnt = 0;
+    for (unsigned k = 0; k <= (1u << bits); k++) {
+        // past the bit-reversed order, the last window
+        const unsigned w = k < (1u << bits) ? bit_reverse(k, bits) : n_win - 1;
+        if (k < (1u << bits) && w >= n_win - 1) continue;
+
+        const unsigned low = w * PROGRESSIVE_WINDOW;
+        const unsigned high = low + PROGRESSIVE_WINDOW - 1 < n - 1 ?
+                              low + PROGRESSIVE_WINDOW - 1 : n - 1;
+        int err = read_range(vmaf, c, vid_ref, vid_dist, depth, low, high, n,
+                             1);
+        if (err) return err;
+        pic_cnt += high - low + 1;
+
+        if (progress) {
+            fprintf(stderr, "\r%u of %u frames %s\033[K", pic_cnt, n,
+                    spinner[win_cnt % spinner_length]);
+            fflush(stderr);
+        }
+
+        if (++win_cnt < check || win_cnt == n_win) continue;
+        if (progressive_converged(vmaf, model, c->model_cnt, n,
+                                  c->progressive))
+        {
+            break;
+        }
+        check += check / 2;
+    }
+    if (progress)
+        fprintf(stderr, "\n");
+
+    *frame_cnt = n;
+    return 0;
+}
+
+/*
+ * Reads one segment of a longer clip, with --segment_warmup frames either
+ * side. Its --bin output holds the scores of the segment's frames only, as a
+ * serial run would have them, so segments scored separately are merged by
+ * importing them all with --import.
+ */
+static int read_segment(VmafContext *vmaf, const CLISettings *c,
+                        video_input *vid_ref, video_input *vid_dist,
+                        int depth, unsigned *frame_cnt)
+{
+    unsigned n;
+    if (seekable_frame_cnt(c, vid_ref, vid_dist, &n)) {
+        fprintf(stderr, "--segment requires seekable input\n");
+        return -1;
+    }
+    if (c->segment_low >= n) {
+        fprintf(stderr, "segment starts past the last frame, %u\n", n - 1);
+        return -1;
+    }
+
+    const unsigned high = c->segment_high < n ? c->segment_high : n - 1;
+    int err = read_range(vmaf, c, vid_ref, vid_dist, depth, c->segment_low,
+                         high, n, c->segment_warmup);
+    if (err) return err;
+
+    *frame_cnt = high + 1;
+    return 0;
+}
+
+/*
+ * Skips the first `n` frames of an input, seeking past them. An input which
+ * can not seek is read through, without converting its frames to pictures.
+ */
+static void skip_frames(video_input *vid, unsigned n)
+{
+    if (!n || !video_input_seek_frame(vid, n))
+        return;
+
+    video_input_ycbcr ycbcr;
+    for (unsigned i = 0; i < n; i++) {
+        if (video_input_fetch_frame(vid, ycbcr, NULL) < 1)
+            break;
+    }
+}
+
+/*
+ * Resumes from the --checkpoint file, if there is one. Reading continues
+ * one frame before the first frame it does not hold, which warms up the
+ * temporal features without scoring it again.
+ */
+static int resume_checkpoint(VmafContext *vmaf, const CLISettings *c,
+                             video_input *vid_ref, video_input *vid_dist,
+                             unsigned *first, bool *resumed)
+{
+    *first = 0;
+    *resumed = false;
+    if (access(c->checkpoint_path, F_OK))
+        return 0;
+
+    unsigned index;
+    int err = vmaf_read_checkpoint(vmaf, c->checkpoint_path, &index);
+    if (err) {
+        fprintf(stderr, "problem reading checkpoint: %s\n", c->checkpoint_path);
+        return err;
+    }
+
+    *first = index ? index - 1 : 0;
+    if (video_input_seek_frame(vid_ref, c->frame_skip_ref + *first) ||
+        video_input_seek_frame(vid_dist, c->frame_skip_dist + *first))
+    {
+        fprintf(stderr, "--checkpoint requires seekable input to resume\n");
+        return -1;
+    }
+    *resumed = true;
+    if (!c->quiet)
+        fprintf(stderr, "resuming at frame %u\n", index);
+    return 0;
+}
+
+typedef struct Segment {
+    const char *path;
+    unsigned low, high;
+} Segment;
+
+static int segment_cmp(const void *a, const void *b)
+{
+    const Segment *s0 = a, *s1 = b;
+    return s0->low < s1->low ? -1 : s0->low > s1->low;
+}
+
+/*
+ * Imports every --import file, in any order. Together they must cover the
+ * clip from frame 0 without gaps or overlaps, as segments scored apart do.
+ * Their bounds are read first, so that they are imported in order and the
+ * output lists features as a serial run would.
+ */
+static int import_segments(VmafContext *vmaf, const CLISettings *c,
+                           const char *const *exclude, unsigned *frame_cnt)
+{
+    Segment *segment = malloc(sizeof(*segment) * c->import_cnt);
+    if (!segment) return -1;
+
+    int err = 0;
+    for (unsigned i = 0; i < c->import_cnt; i++) {
+        segment[i].path = c->import_path[i];
+        VmafContext *probe;
+        VmafConfiguration cfg = { .log_level = VMAF_LOG_LEVEL_INFO };
+        err = vmaf_init(&probe, cfg);
+        if (err) goto free_segment;
+        err = vmaf_import_segment_from_path(probe, c->import_path[i], exclude,
+                                            &segment[i].low,
+                                            &segment[i].high);
+        vmaf_close(probe);
+        if (err) {
+            fprintf(stderr, "problem importing feature scores: %s\n",
+                    c->import_path[i]);
+            goto free_segment;
+        }
+    }
+
+    qsort(segment, c->import_cnt, sizeof(*segment), segment_cmp);
+    if (segment[0].low) {
+        fprintf(stderr, "frames 0 to %u are missing before %s\n",
+                segment[0].low - 1, segment[0].path);
+        err = -1;
+        goto free_segment;
+    }
+    for (unsigned i = 1; i < c->import_cnt; i++) {
+        const Segment *prev = &segment[i - 1], *next = &segment[i];
+        if (next->low <= prev->high) {
+            fprintf(stderr, "%s overlaps %s at frames %u to %u\n",
+                    next->path, prev->path, next->low,
+                    next->high < prev->high ? next->high : prev->high);
+            err = -1;
+            goto free_segment;
+        }
+        if (next->low > prev->high + 1) {
+            fprintf(stderr, "frames %u to %u are missing between %s and %s\n",
+                    prev->high + 1, next->low - 1, prev->path, next->path);
+            err = -1;
+            goto free_segment;
+        }
+    }
+
+    for (unsigned i = 0; i < c->import_cnt; i++) {
+        err = vmaf_import_feature_scores_from_path(vmaf, segment[i].path,
+                                                   exclude, NULL);
+        if (err) {
+            fprintf(stderr, "problem importing feature scores: %s\n",
+                    segment[i].path);
+            goto free_segment;
+        }
+    }
+    *frame_cnt = segment[c->import_cnt - 1].high + 1;
+
+free_segment:
+    free(segment);
+    return err;
+}
+
+int main(int argc, char *argv[])
+{
+    int err = 0;
+    const int istty = isatty(fileno(stderr));
+
+    CLISettings c;
+    cli_parse(argc, argv, &c);
+
+    if (istty && !c.quiet) {
+        fprintf(stderr, "VMAF version %s\n", vmaf_version());
+    }
+
+    // pictures are first touched by this thread, keep them on the same node
+    if (c.cpu_affinity) {
+        err = vmaf_set_thread_affinity(c.cpu_affinity);
+        if (err) {
+            fprintf(stderr, "problem setting cpu affinity: %s\n",
+                    c.cpu_affinity);
+            return -1;
+        }
+    }
+
+    video_input vid_ref, vid_dist;
+    int common_bitdepth = 0;
+    if (!c.import_cnt) {
+        err = open_videos(&c, &vid_ref, &vid_dist, &common_bitdepth);
+        if (err) return -1;
     }
 
     VmafConfiguration cfg = {
         .log_level = VMAF_LOG_LEVEL_INFO,
         .n_threads = c.thread_cnt,
         .n_subsample = c.subsample,
+        .subsample_adaptive = c.subsample_adaptive,
+        .scale_filter = c.scale_filter,
         .cpumask = c.cpumask,
         .gpumask = c.gpumask,
+        .perf_stats = c.perf_stats,
+        .autotune = c.autotune,
+        .autotune_cache = c.autotune_cache,
+        .feature_cache = c.feature_cache,
+        .scratch_budget = (uint64_t) c.scratch_budget << 20,
+        .cpu_affinity = c.thread_cnt ? c.cpu_affinity : NULL,
+        .scratch_arena = c.scratch_arena,
     };
 
     VmafContext *vmaf;
@@ -379,97 +777,181 @@ int main(int argc, char *argv[])
         }
     }
 
-    VmafPicture pic_ref, pic_dist;
+    unsigned picture_index = 0, index_low = 0;
+    if (c.import_cnt) {
+        const char *exclude[CLI_SETTINGS_STATIC_ARRAY_LEN + 1] = { 0 };
+        for (unsigned i = 0; i < c.model_cnt; i++)
+            exclude[i] = c.model_config[i].cfg.name;
+        err = import_segments(vmaf, &c, exclude, &picture_index);
+        if (err) return -1;
+    } else if (c.segment) {
+        err = read_segment(vmaf, &c, &vid_ref, &vid_dist, common_bitdepth,
+                           &picture_index);
+        if (err) return -1;
+        index_low = c.segment_low;
+
+        err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+        if (err) {
+            fprintf(stderr, "problem flushing context\n");
+            return err;
+        }
+    } else if (c.progressive) {
+        err = read_progressive(vmaf, &c, &vid_ref, &vid_dist, common_bitdepth,
+                               model, istty && !c.quiet, &picture_index);
+        if (err) return -1;
+        // the output estimates the scores of every frame
+        err = vmaf_set_output_range(vmaf, 0, picture_index - 1);
+        if (err) return -1;
+
+        err = vmaf_read_pictures(vmaf, NULL, NULL, 0);
+        if (err) {
+            fprintf(stderr, "problem flushing context\n");
+            return err;
+        }
+    } else {
+        unsigned first = 0;
+        bool resumed = false;
+        if (c.checkpoint_path) {
+            err = resume_checkpoint(vmaf, &c, &vid_ref, &vid_dist, &first,
+                                    &resumed);
+            if (err) return -1;
+        }
 
-    for (unsigned i = 0; i < c.frame_skip_ref; i++)
-        fetch_picture(&vid_ref, &pic_ref, common_bitdepth);
+        if (!resumed) {
+            skip_frames(&vid_ref, c.frame_skip_ref);
+            skip_frames(&vid_dist, c.frame_skip_dist);
+        }
 
-    for (unsigned i = 0; i < c.frame_skip_dist; i++)
-        fetch_picture(&vid_dist, &pic_dist, common_bitdepth);
+        float fps = 0.;
+        const time_t t0 = clock();
+        time_t t_checkpoint = time(NULL);
+        for (picture_index = first ;; picture_index++) {
 
-    float fps = 0.;
-    const time_t t0 = clock();
-    unsigned picture_index;
-    for (picture_index = 0 ;; picture_index++) {
+            if (c.frame_cnt && picture_index >= c.frame_cnt)
+                break;
 
-        if (c.frame_cnt && picture_index >= c.frame_cnt)
-            break;
+            VmafPicture pic_ref, pic_dist;
+            int ret1 = fetch_picture(&vid_ref, &pic_ref, common_bitdepth);
+            int ret2 = fetch_picture(&vid_dist, &pic_dist, common_bitdepth);
 
-        VmafPicture pic_ref, pic_dist;
-        int ret1 = fetch_picture(&vid_ref, &pic_ref, common_bitdepth);
-        int ret2 = fetch_picture(&vid_dist, &pic_dist, common_bitdepth);
+            if (ret1 && ret2) {
+                break;
+            } else if (ret1 < 0 || ret2 < 0) {
+                fprintf(stderr, "\nproblem while reading pictures\n");
+                break;
+            } else if (ret1) {
+                fprintf(stderr, "\n\"%s\" ended before \"%s\".\n",
+                        c.path_ref, c.path_dist);
+                int err = vmaf_picture_unref(&pic_dist);
+                if (err)
+                    fprintf(stderr, "\nproblem during vmaf_picture_unref\n");
+                break;
+            } else if (ret2) {
+                fprintf(stderr, "\n\"%s\" ended before \"%s\".\n",
+                        c.path_dist, c.path_ref);
+                int err = vmaf_picture_unref(&pic_ref);
+                if (err)
+                    fprintf(stderr, "\nproblem during vmaf_picture_unref\n");
+                break;
+            }
 
-        if (ret1 && ret2) {
-            break;
-        } else if (ret1 < 0 || ret2 < 0) {
-            fprintf(stderr, "\nproblem while reading pictures\n");
-            break;
-        } else if (ret1) {
-            fprintf(stderr, "\n\"%s\" ended before \"%s\".\n",
-                    c.path_ref, c.path_dist);
-            int err = vmaf_picture_unref(&pic_dist);
-            if (err)
-                fprintf(stderr, "\nproblem during vmaf_picture_unref\n");
-            break;
-        } else if (ret2) {
-            fprintf(stderr, "\n\"%s\" ended before \"%s\".\n",
-                    c.path_dist, c.path_ref);
-            int err = vmaf_picture_unref(&pic_ref);
-            if (err)
-                fprintf(stderr, "\nproblem during vmaf_picture_unref\n");
-            break;
-        }
+            if (istty && !c.quiet) {
+                if (picture_index > 0 && !(picture_index % 10)) {
+                    fps = (picture_index - first + 1) /
+                          (((float)clock() - t0) / CLOCKS_PER_SEC);
+                }
 
-        if (istty && !c.quiet) {
-            if (picture_index > 0 && !(picture_index % 10)) {
-                fps = (picture_index + 1) /
-                      (((float)clock() - t0) / CLOCKS_PER_SEC);
+                fprintf(stderr, "\r%d frame%s %s %.2f FPS\033[K",
+                        picture_index + 1, picture_index ? "s" : " ",
+                        spinner[picture_index % spinner_length], fps);
+                fflush(stderr);
             }
 
-            fprintf(stderr, "\r%d frame%s %s %.2f FPS\033[K",
-                    picture_index + 1, picture_index ? "s" : " ",
-                    spinner[picture_index % spinner_length], fps);
-            fflush(stderr);
+            err = vmaf_read_pictures(vmaf, &pic_ref, &pic_dist, picture_index);
+            if (err) {
+                fprintf(stderr, "\nproblem reading pictures\n");
+                break;
+            }
+
+            if (c.checkpoint_path &&
+                time(NULL) - t_checkpoint >= (time_t) c.checkpoint_interval)
+            {
+                err = vmaf_write_checkpoint(vmaf, c.checkpoint_path, NULL);
+                if (err) {
+                    fprintf(stderr, "\nproblem writing checkpoint\n");
+                    break;
+                }
+                t_checkpoint = time(NULL);
+            }
         }
+        if (istty && !c.quiet)
+            fprintf(stderr, "\n");
 
-        err = vmaf_read_pictures(vmaf, &pic_ref, &pic_dist, picture_index);
+        err |= vmaf_read_pictures(vmaf, NULL, NULL, 0);
         if (err) {
-            fprintf(stderr, "\nproblem reading pictures\n");
-            break;
+            fprintf(stderr, "problem flushing context\n");
+            return err;
         }
     }
-    if (istty && !c.quiet)
-        fprintf(stderr, "\n");
-
-    err |= vmaf_read_pictures(vmaf, NULL, NULL, 0);
-    if (err) {
-        fprintf(stderr, "problem flushing context\n");
-        return err;
-    }
 
     if (!c.no_prediction) {
-        for (unsigned i = 0; i < c.model_cnt; i++) {
+        for (unsigned i = 0; i < c.model_cnt && c.progressive; i++) {
+            VmafPooledEstimate est;
+            err = vmaf_score_pooled_estimate(vmaf, model[i],
+                                             VMAF_POOL_METHOD_MEAN, &est,
+                                             index_low, picture_index - 1);
+            if (err) {
+                fprintf(stderr, "problem estimating pooled VMAF score\n");
+                return -1;
+            }
+
+            if (istty && (!c.quiet || !c.output_path)) {
+                fprintf(stderr, "%s: %f, ci.p95: [%f, %f], %u of %u frames\n",
+                        c.model_config[i].version ?
+                            c.model_config[i].version : c.model_config[i].path,
+                        est.score, est.ci.lo, est.ci.hi, est.n_scored,
+                        picture_index);
+            }
+        }
+
+        for (unsigned i = 0; i < c.model_cnt && !c.progressive; i++) {
             double vmaf_score;
             err = vmaf_score_pooled(vmaf, model[i], VMAF_POOL_METHOD_MEAN,
-                                    &vmaf_score, 0, picture_index - 1);
+                                    &vmaf_score, index_low,
+                                    picture_index - 1);
             if (err) {
                 fprintf(stderr, "problem generating pooled VMAF score\n");
                 return -1;
             }
 
+            double vmaf_error = 0.;
+            if (c.subsample_adaptive) {
+                err = vmaf_score_pooled_error(vmaf, model[i],
+                                              VMAF_POOL_METHOD_MEAN,
+                                              &vmaf_error, index_low,
+                                              picture_index - 1);
+                if (err) {
+                    fprintf(stderr, "problem estimating pooled VMAF error\n");
+                    return -1;
+                }
+            }
+
             if (istty && (!c.quiet || !c.output_path)) {
-                fprintf(stderr, "%s: %f\n",
-                        c.model_config[i].version ?
-                            c.model_config[i].version : c.model_config[i].path,
-                        vmaf_score);
+                const char *label = c.model_config[i].version ?
+                    c.model_config[i].version : c.model_config[i].path;
+                if (c.subsample_adaptive)
+                    fprintf(stderr, "%s: %f (estimated error: %f)\n", label,
+                            vmaf_score, vmaf_error);
+                else
+                    fprintf(stderr, "%s: %f\n", label, vmaf_score);
             }
         }
 
-        for (unsigned i = 0; i < model_collection_cnt; i++) {
+        for (unsigned i = 0; i < model_collection_cnt && !c.progressive; i++) {
             VmafModelCollectionScore score = { 0 };
             err = vmaf_score_pooled_model_collection(vmaf, model_collection[i],
                                                      VMAF_POOL_METHOD_MEAN, &score,
-                                                     0, picture_index - 1);
+                                                     index_low, picture_index - 1);
             if (err) {
                 fprintf(stderr, "problem generating pooled VMAF score\n");
                 return -1;
@@ -491,8 +973,15 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (c.perf_stats)
+        print_perf_stats(vmaf);
+
+    int ret = 0;
     if (c.output_path)
-        vmaf_write_output(vmaf, c.output_path, c.output_fmt);
+        ret = vmaf_write_output(vmaf, c.output_path, c.output_fmt);
+    // the scores are safely written, a later run starts over
+    if (c.checkpoint_path && !ret && !err)
+        remove(c.checkpoint_path);
 
     for (unsigned i = 0; i < c.model_cnt; i++)
         vmaf_model_destroy(model[i]);
@@ -502,8 +991,10 @@ int main(int argc, char *argv[])
         vmaf_model_collection_destroy(model_collection[i]);
     free(model_collection);
 
-    video_input_close(&vid_ref);
-    video_input_close(&vid_dist);
+    if (!c.import_cnt) {
+        video_input_close(&vid_ref);
+        video_input_close(&vid_dist);
+    }
     vmaf_close(vmaf);
     cli_free(&c);
     return err;
@@ -73,6 +73,23 @@ struct y4m_input{
   y4m_convert_func  convert;
   unsigned char    *dst_buf;
   unsigned char    *aux_buf;
+  /*The file offset of the first frame header.*/
+  int64_t           data_offset;
+  /*The file offsets of the frame headers located so far, built as frames are
+     sought.*/
+  int64_t          *frame_offset;
+  unsigned          frame_cnt;
+  unsigned          frame_cap;
+  /*The file offset of the first frame header not yet located.*/
+  int64_t           frame_next;
+  /*Whether every frame is located.*/
+  int               frame_end;
+  /*The file the index is kept in, if any, the size of the input it indexes
+     and the number of frames it held when loaded.*/
+  char             *index_path;
+  int64_t           index_file_sz;
+  unsigned          index_cnt;
+  int               index_end;
 };
 
 static int y4m_parse_tags(y4m_input *_y4m,char *_tags){
@@ -701,6 +718,15 @@ static int y4m_input_open_impl(y4m_input *_y4m,FILE *_fin){
   _y4m->pic_y=(_y4m->frame_h-_y4m->pic_h)>>1&~1;
   _y4m->dst_buf=(unsigned char *)malloc(_y4m->dst_buf_sz);
   _y4m->aux_buf=_y4m->aux_buf_sz?(unsigned char *)malloc(_y4m->aux_buf_sz):NULL;
+  _y4m->data_offset=ftello(_fin);
+  _y4m->frame_offset=NULL;
+  _y4m->frame_cnt=_y4m->frame_cap=0;
+  _y4m->frame_next=_y4m->data_offset;
+  _y4m->frame_end=0;
+  _y4m->index_path=NULL;
+  _y4m->index_file_sz=0;
+  _y4m->index_cnt=0;
+  _y4m->index_end=0;
   return 0;
 }
 
@@ -798,7 +824,168 @@ static int y4m_input_fetch_frame(y4m_input *_y4m,FILE *_fin,
   return 1;
 }
 
+static int64_t y4m_file_sz(FILE *_fin){
+  int64_t pos;
+  int64_t end;
+  pos=ftello(_fin);
+  if(pos<0||fseeko(_fin,0,SEEK_END))return -1;
+  end=ftello(_fin);
+  if(fseeko(_fin,pos,SEEK_SET))return -1;
+  return end;
+}
+
+/*Frame headers may carry parameters, so frames are not a fixed size apart.
+   Instead frames are located by reading only their headers, skipping the
+   frame data, and their offsets are kept so that each is located once.*/
+static int y4m_index_frames(y4m_input *_y4m,FILE *_fin,unsigned _frame){
+  int64_t file_sz;
+  int64_t frame_sz;
+  int64_t pos;
+  char    frame[6];
+  char    c;
+  int     j;
+  if(_y4m->data_offset<0)return -1;
+  if(_frame<_y4m->frame_cnt||_y4m->frame_end)return 0;
+  pos=ftello(_fin);
+  file_sz=y4m_file_sz(_fin);
+  if(pos<0||file_sz<0)return -1;
+  frame_sz=(int64_t)_y4m->dst_buf_read_sz+_y4m->aux_buf_read_sz;
+  while(_y4m->frame_cnt<=_frame){
+    if(fseeko(_fin,_y4m->frame_next,SEEK_SET))return -1;
+    if(fread(frame,1,6,_fin)<6){
+      _y4m->frame_end=1;
+      break;
+    }
+    if(memcmp(frame,"FRAME",5)){
+      fprintf(stderr,"Loss of framing in YUV input data\n");
+      return -1;
+    }
+    j=0;
+    if(frame[5]!='\n'){
+      for(;j<79&&fread(&c,1,1,_fin)&&c!='\n';j++);
+      if(j==79){
+        fprintf(stderr,"Error parsing YUV frame header\n");
+        return -1;
+      }
+      j++;
+    }
+    /*An incomplete last frame is not counted.*/
+    if(_y4m->frame_next+6+j+frame_sz>file_sz){
+      _y4m->frame_end=1;
+      break;
+    }
+    if(_y4m->frame_cnt==_y4m->frame_cap){
+      unsigned  cap;
+      int64_t  *frame_offset;
+      cap=_y4m->frame_cap?2*_y4m->frame_cap:1024;
+      frame_offset=(int64_t *)realloc(_y4m->frame_offset,
+       cap*sizeof(*frame_offset));
+      if(frame_offset==NULL)return -1;
+      _y4m->frame_offset=frame_offset;
+      _y4m->frame_cap=cap;
+    }
+    _y4m->frame_offset[_y4m->frame_cnt++]=_y4m->frame_next;
+    _y4m->frame_next+=6+j+frame_sz;
+  }
+  return fseeko(_fin,pos,SEEK_SET)?-1:0;
+}
+
+static int y4m_input_seek_frame(y4m_input *_y4m,FILE *_fin,unsigned _frame){
+  if(y4m_index_frames(_y4m,_fin,_frame)<0)return -1;
+  if(_frame>=_y4m->frame_cnt){
+    /*Seeking to the end leaves nothing to fetch.*/
+    if(_frame>_y4m->frame_cnt)return -1;
+    return fseeko(_fin,_y4m->frame_next,SEEK_SET)?-1:0;
+  }
+  return fseeko(_fin,_y4m->frame_offset[_frame],SEEK_SET)?-1:0;
+}
+
+static int y4m_input_frame_cnt(y4m_input *_y4m,FILE *_fin,unsigned *_cnt){
+  if(y4m_index_frames(_y4m,_fin,(unsigned)-1)<0)return -1;
+  *_cnt=_y4m->frame_cnt;
+  return 0;
+}
+
+/*The index file holds, in native byte order:
+     char magic[8]; int64_t file_sz, data_offset, frame_next;
+     uint32_t frame_end, frame_cnt; int64_t frame_offset[frame_cnt];
+   It is only used for a file of the same size and header.*/
+#define Y4M_INDEX_MAGIC "Y4MINDEX"
+
+static int y4m_input_set_index(y4m_input *_y4m,FILE *_fin,const char *_path){
+  FILE     *f;
+  char      magic[8];
+  int64_t   hdr[3];
+  uint32_t  cnt[2];
+  int64_t  *frame_offset;
+  if(_y4m->data_offset<0)return -1;
+  _y4m->index_file_sz=y4m_file_sz(_fin);
+  if(_y4m->index_file_sz<0)return -1;
+  _y4m->index_path=(char *)malloc(strlen(_path)+1);
+  if(_y4m->index_path==NULL)return -1;
+  strcpy(_y4m->index_path,_path);
+  f=fopen(_path,"rb");
+  /*A missing index is written on close.*/
+  if(f==NULL)return 0;
+  if(fread(magic,1,8,f)!=8||memcmp(magic,Y4M_INDEX_MAGIC,8)||
+   fread(hdr,sizeof(*hdr),3,f)!=3||fread(cnt,sizeof(*cnt),2,f)!=2||
+   hdr[0]!=_y4m->index_file_sz||hdr[1]!=_y4m->data_offset||!cnt[1]){
+    fclose(f);
+    return 0;
+  }
+  frame_offset=(int64_t *)malloc(cnt[1]*sizeof(*frame_offset));
+  if(frame_offset==NULL||
+   fread(frame_offset,sizeof(*frame_offset),cnt[1],f)!=cnt[1]||
+   frame_offset[0]!=_y4m->data_offset){
+    free(frame_offset);
+    fclose(f);
+    return 0;
+  }
+  fclose(f);
+  free(_y4m->frame_offset);
+  _y4m->frame_offset=frame_offset;
+  _y4m->frame_cnt=_y4m->frame_cap=_y4m->index_cnt=cnt[1];
+  _y4m->frame_next=hdr[2];
+  _y4m->frame_end=_y4m->index_end=cnt[0]!=0;
+  return 0;
+}
+
+static void y4m_write_index(y4m_input *_y4m){
+  FILE     *f;
+  int64_t   hdr[3];
+  uint32_t  cnt[2];
+  int       err;
+  if(_y4m->frame_cnt==_y4m->index_cnt&&_y4m->frame_end==_y4m->index_end){
+    return;
+  }
+  hdr[0]=_y4m->index_file_sz;
+  hdr[1]=_y4m->data_offset;
+  hdr[2]=_y4m->frame_next;
+  cnt[0]=_y4m->frame_end;
+  cnt[1]=_y4m->frame_cnt;
+  f=fopen(_y4m->index_path,"wb");
+  if(f==NULL){
+    fprintf(stderr,"Could not write y4m index: %s\n",_y4m->index_path);
+    return;
+  }
+  fwrite(Y4M_INDEX_MAGIC,1,8,f);
+  fwrite(hdr,sizeof(*hdr),3,f);
+  fwrite(cnt,sizeof(*cnt),2,f);
+  fwrite(_y4m->frame_offset,sizeof(*_y4m->frame_offset),_y4m->frame_cnt,f);
+  err=ferror(f);
+  err|=fclose(f);
+  if(err){
+    fprintf(stderr,"Could not write y4m index: %s\n",_y4m->index_path);
+    remove(_y4m->index_path);
+  }
+}
+
 static void y4m_input_close(y4m_input *_y4m){
+  if(_y4m->index_path!=NULL){
+    if(_y4m->frame_cnt>0)y4m_write_index(_y4m);
+    free(_y4m->index_path);
+  }
+  free(_y4m->frame_offset);
   free(_y4m->dst_buf);
   free(_y4m->aux_buf);
 }
@@ -808,5 +995,8 @@ OC_EXTERN const video_input_vtbl Y4M_INPUT_VTBL={
   (video_input_open_func)y4m_input_open,
   (video_input_get_info_func)y4m_input_get_info,
   (video_input_fetch_frame_func)y4m_input_fetch_frame,
-  (video_input_close_func)y4m_input_close
+  (video_input_close_func)y4m_input_close,
+  (video_input_seek_frame_func)y4m_input_seek_frame,
+  (video_input_frame_cnt_func)y4m_input_frame_cnt,
+  (video_input_set_index_func)y4m_input_set_index
 };
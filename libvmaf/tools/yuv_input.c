@@ -136,6 +136,21 @@ static int yuv_input_fetch_frame(yuv_input *yuv, FILE *fin,
     return 1;
 }
 
+static int yuv_input_seek_frame(yuv_input *yuv, FILE *fin, unsigned frame)
+{
+    return fseeko(fin, (int64_t) frame * yuv->dst_buf_sz, SEEK_SET) ? -1 : 0;
+}
+
+static int yuv_input_frame_cnt(yuv_input *yuv, FILE *fin, unsigned *cnt)
+{
+    const int64_t pos = ftello(fin);
+    if (pos < 0 || fseeko(fin, 0, SEEK_END)) return -1;
+    const int64_t end = ftello(fin);
+    if (end < 0 || fseeko(fin, pos, SEEK_SET)) return -1;
+    *cnt = end / yuv->dst_buf_sz;
+    return 0;
+}
+
 static void yuv_input_close(yuv_input *_yuv){
   free(_yuv->dst_buf);
 }
@@ -145,5 +160,8 @@ OC_EXTERN const video_input_vtbl YUV_INPUT_VTBL={
   (video_input_open_func)NULL,
   (video_input_get_info_func)yuv_input_get_info,
   (video_input_fetch_frame_func)yuv_input_fetch_frame,
-  (video_input_close_func)yuv_input_close
+  (video_input_close_func)yuv_input_close,
+  (video_input_seek_frame_func)yuv_input_seek_frame,
+  (video_input_frame_cnt_func)yuv_input_frame_cnt,
+  (video_input_set_index_func)NULL
 };